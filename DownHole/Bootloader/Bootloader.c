@@ -0,0 +1,468 @@
+/*******************************************************************************
+*       @brief      This module is the bootloader.  It sits in the first two
+*                   sectors of the internal flash, installs a firmware image
+*                   the application has taken into the serial flash and
+*                   checked, and starts the application linked after it.
+*       @file       Downhole/Bootloader/Bootloader.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The update record in the backup SRAM says what to install, see
+// FirmwareUpdate.h.  The image in the serial flash is checked against the
+// record's CRC and its vector table looked at before the internal flash is
+// touched, so a bad image leaves the application that is there.  Once the
+// sectors are erased the only way back is to finish: a flash error leaves
+// the record ready, and the install is tried again, here and on the next
+// start.  The serial flash is read a byte at a time with the SPI polled,
+// there are no interrupts or DMA to set up and give back.
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include <stm32f4xx.h>
+#include "main.h"
+#include "board.h"
+#include "crc.h"
+#include "FlashMemory.h"
+#include "FirmwareUpdate.h"
+#include "Bootloader.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the AT45DB321, as FlashMemory.c finds it from its ID
+#define BOOT_DATAFLASH_MANUFACTURER	0x1F
+#define BOOT_DATAFLASH_TYPE		0x27
+#define BOOT_DATAFLASH_PAGES		8192ul
+#define BOOT_FIRMWARE_START_PAGE	(BOOT_DATAFLASH_PAGES - FIRMWARE_IMAGE_PAGES)
+
+// the internal flash after the bootloader, and the RAM an initial stack
+// pointer can be in
+#define BOOT_APPLICATION_SIZE		(0x100000ul - FIRMWARE_BOOTLOADER_SIZE)
+#define BOOT_RAM_END			(SRAM1_BASE + 0x20000ul)
+
+// SPI waits for a byte, and status reads for the serial flash to finish
+// what it was doing, a page erase at most takes 35mS
+#define BOOT_SPI_TIMEOUT		65000
+#define BOOT_READY_POLLS		100000ul
+
+// installs tried before the application, or nothing, is started
+#define BOOT_INSTALL_ATTEMPTS		3
+
+#define BOOT_FLASH_FLAGS		(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | \
+					 FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR)
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	U_INT32 nAddress;
+	U_INT16 nSector;		// FLASH_Sector_x
+} BOOT_SECTOR;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// the sectors of the application, in order
+static const BOOT_SECTOR m_Sectors[] =
+{
+	{ 0x08008000ul, FLASH_Sector_2 },
+	{ 0x0800C000ul, FLASH_Sector_3 },
+	{ 0x08010000ul, FLASH_Sector_4 },
+	{ 0x08020000ul, FLASH_Sector_5 },
+	{ 0x08040000ul, FLASH_Sector_6 },
+	{ 0x08060000ul, FLASH_Sector_7 },
+	{ 0x08080000ul, FLASH_Sector_8 },
+	{ 0x080A0000ul, FLASH_Sector_9 },
+	{ 0x080C0000ul, FLASH_Sector_10 },
+	{ 0x080E0000ul, FLASH_Sector_11 },
+};
+#define BOOT_SECTORS			(sizeof(m_Sectors) / sizeof(m_Sectors[0]))
+
+static FIRMWARE_UPDATE * const m_pUpdate = (FIRMWARE_UPDATE *)FIRMWARE_UPDATE_ADDRESS;
+
+// counts down while waiting for the SPI, 0 once a byte did not come
+static U_INT32 m_nSpiTimeout;
+static U_BYTE m_nPage[CHIP_PAGE_SIZE];
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void Boot_InitSpi(void);
+static U_BYTE Boot_TransferByte(U_BYTE nDataByte);
+static BOOL Boot_WaitForDataFlash(void);
+static BOOL Boot_IsDataFlashThere(void);
+static BOOL Boot_ReadImagePage(U_INT32 nPage);
+static BOOL Boot_IsVectorTable(const U_INT32 *pVectors, U_INT32 nSize);
+static BOOL Boot_CheckImage(const FIRMWARE_UPDATE *pUpdate, BOOL *pbGood);
+static BOOL Boot_ProgramImage(const FIRMWARE_UPDATE *pUpdate);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   A flash error is tried again straight away, it may have been the supply
+*   dipping.  With no application in the internal flash there is nothing to
+*   run, it waits for the programmer.
+*******************************************************************************/
+int main(void)
+{
+	U_BYTE nAttempt;
+
+	Bootloader_Initialize();
+	for(nAttempt = 0; nAttempt < BOOT_INSTALL_ATTEMPTS; nAttempt++)
+	{
+		if(Bootloader_InstallUpdate() != BOOT_FLASH_ERROR)
+		{
+			break;
+		}
+	}
+	if(Bootloader_IsApplicationValid())
+	{
+		Bootloader_StartApplication();
+	}
+	while(1)
+	{
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void Bootloader_Initialize(void)
+{
+	// the update record is in the backup SRAM
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
+	PWR_BackupAccessCmd(ENABLE);
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_BKPSRAM, ENABLE);
+	Boot_InitSpi();
+}
+
+/*******************************************************************************
+*       @details
+*   Nothing is erased until the image in the serial flash has checked out.
+*   The installed copy is checked against the CRC too before the record is
+*   put back to idle.
+*******************************************************************************/
+U_BYTE Bootloader_InstallUpdate(void)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+	CRC32_CONTEXT crc;
+	BOOL bGood;
+
+	if((pUpdate->nMagic != FIRMWARE_UPDATE_MAGIC) || (pUpdate->nState != FIRMWARE_STATE_READY))
+	{
+		return BOOT_NO_UPDATE;
+	}
+	if(!Boot_WaitForDataFlash() || !Boot_IsDataFlashThere())
+	{
+		return BOOT_FLASH_ERROR;
+	}
+	if(!Boot_CheckImage(pUpdate, &bGood))
+	{
+		return BOOT_FLASH_ERROR;
+	}
+	if(!bGood)
+	{
+		pUpdate->nState = FIRMWARE_STATE_FAILED;
+		return BOOT_IMAGE_BAD;
+	}
+	if(!Boot_ProgramImage(pUpdate))
+	{
+		return BOOT_FLASH_ERROR;
+	}
+	CRC32_Start(&crc);
+	CRC32_Update(&crc, (const U_BYTE *)FIRMWARE_APPLICATION_ADDRESS, pUpdate->nSize);
+	if(CRC32_Finish(&crc) != pUpdate->nCRC)
+	{
+		return BOOT_FLASH_ERROR;
+	}
+	pUpdate->nState = FIRMWARE_STATE_IDLE;
+	return BOOT_INSTALLED;
+}
+
+/*******************************************************************************
+*       @details
+*   Erased flash has no stack pointer in the RAM, that is what a board that
+*   was never programmed, or lost power part way through an install, shows.
+*******************************************************************************/
+BOOL Bootloader_IsApplicationValid(void)
+{
+	return Boot_IsVectorTable((const U_INT32 *)FIRMWARE_APPLICATION_ADDRESS, BOOT_APPLICATION_SIZE);
+}
+
+/*******************************************************************************
+*       @details
+*   The application's SystemInit() sets the clocks up from the reset state,
+*   and its startup code expects the peripherals it uses at their reset
+*   values.
+*******************************************************************************/
+void Bootloader_StartApplication(void)
+{
+	const U_INT32 *pVectors = (const U_INT32 *)FIRMWARE_APPLICATION_ADDRESS;
+	void (*pfReset)(void) = (void (*)(void))pVectors[1];
+
+	SPI_Cmd(SPI1, DISABLE);
+	SPI_I2S_DeInit(SPI1);
+	GPIO_DeInit(GPIOA);
+	GPIO_DeInit(GPIOB);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_SPI1, DISABLE);
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_GPIOB, DISABLE);
+	RCC_DeInit();
+	__disable_irq();
+	SysTick->CTRL = 0;
+	SCB->VTOR = FIRMWARE_APPLICATION_ADDRESS;
+	__set_MSP(pVectors[0]);
+	__enable_irq();
+	pfReset();
+}
+
+/*******************************************************************************
+*       @details
+*   The same pins and bus settings as SPI_InitPins() and SPI_Initialize().
+*******************************************************************************/
+static void Boot_InitSpi(void)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+	SPI_InitTypeDef SPI_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA | RCC_AHB1Periph_GPIOB, ENABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_SPI1, ENABLE);
+
+	// both chip selects high before the pins are driven
+	GPIO_SetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	GPIO_SetBits(FRAM_CS_PORT, FRAM_CS_PIN);
+	GPIO_StructInit(&GPIO_InitStructure);
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_OUT;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+	GPIO_InitStructure.GPIO_Pin = DATAFLASH_CS_PIN | FRAM_CS_PIN;
+	GPIO_Init(DATAFLASH_CS_PORT, &GPIO_InitStructure);
+
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF;
+	GPIO_InitStructure.GPIO_Pin = SPI_MISO | SPI_MOSI | SPI_SCK;
+	GPIO_Init(SPI_DATA_PORT, &GPIO_InitStructure);
+	GPIO_PinAFConfig(SPI_DATA_PORT, GPIO_PinSource5, GPIO_AF_SPI1);
+	GPIO_PinAFConfig(SPI_DATA_PORT, GPIO_PinSource6, GPIO_AF_SPI1);
+	GPIO_PinAFConfig(SPI_DATA_PORT, GPIO_PinSource7, GPIO_AF_SPI1);
+
+	SPI_StructInit(&SPI_InitStructure);
+	SPI_InitStructure.SPI_Direction = SPI_Direction_2Lines_FullDuplex;
+	SPI_InitStructure.SPI_Mode = SPI_Mode_Master;
+	SPI_InitStructure.SPI_DataSize = SPI_DataSize_8b;
+	SPI_InitStructure.SPI_CPOL = SPI_CPOL_Low;
+	SPI_InitStructure.SPI_CPHA = SPI_CPHA_1Edge;
+	SPI_InitStructure.SPI_NSS = SPI_NSS_Soft | SPI_NSSInternalSoft_Set;
+	SPI_InitStructure.SPI_BaudRatePrescaler = SPI_BaudRatePrescaler_16;
+	SPI_InitStructure.SPI_FirstBit = SPI_FirstBit_MSB;
+	SPI_InitStructure.SPI_CRCPolynomial = 7;
+	SPI_Init(SPI1, &SPI_InitStructure);
+	SPI_Cmd(SPI1, ENABLE);
+}
+
+/*******************************************************************************
+*       @details
+*   As SPI_TransferByte(), once a byte has not come the rest are not sent.
+*******************************************************************************/
+static U_BYTE Boot_TransferByte(U_BYTE nDataByte)
+{
+	if(m_nSpiTimeout == 0)
+	{
+		return 0;
+	}
+	SPI_SendData(SPI1, nDataByte);
+	while(SPI_GetFlagStatus(SPI1, SPI_FLAG_RXNE) == RESET)
+	{
+		if(--m_nSpiTimeout == 0)
+		{
+			return 0;
+		}
+	}
+	return (U_BYTE)SPI_ReceiveData(SPI1);
+}
+
+/*******************************************************************************
+*       @details
+*   The reset may have come part way through a page write of the
+*   application, the chip finishes it on its own.  The status register is
+*   sent again and again for as long as the chip is selected.
+*******************************************************************************/
+static BOOL Boot_WaitForDataFlash(void)
+{
+	U_INT32 nPolls;
+	U_BYTE nStatus = 0;
+
+	m_nSpiTimeout = BOOT_SPI_TIMEOUT;
+	GPIO_ResetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	(void)Boot_TransferByte(SERFLASH45_READ_STATUS_OPCODE);
+	for(nPolls = 0; (nPolls < BOOT_READY_POLLS) && ((nStatus & FLASH_STATUS_BUSY_BIT) == 0); nPolls++)
+	{
+		nStatus = Boot_TransferByte(0);
+	}
+	GPIO_SetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	return ((m_nSpiTimeout != 0) && ((nStatus & FLASH_STATUS_BUSY_BIT) != 0)) ? TRUE : FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   With no chip MISO reads all ones, which would pass for a ready status
+*   and an erased image, so the ID is checked before the image is judged.
+*******************************************************************************/
+static BOOL Boot_IsDataFlashThere(void)
+{
+	U_BYTE nManufacturer;
+	U_BYTE nType;
+
+	m_nSpiTimeout = BOOT_SPI_TIMEOUT;
+	GPIO_ResetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	(void)Boot_TransferByte(SERFLASH45_READ_JDECID);
+	nManufacturer = Boot_TransferByte(0);
+	nType = Boot_TransferByte(0);
+	GPIO_SetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	return ((m_nSpiTimeout != 0) && (nManufacturer == BOOT_DATAFLASH_MANUFACTURER) &&
+	        (nType == BOOT_DATAFLASH_TYPE)) ? TRUE : FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   Page nPage of the firmware image area into m_nPage, the first
+*   CHIP_PAGE_SIZE bytes of the page as Serflash_program_firmware() puts
+*   them.
+*******************************************************************************/
+static BOOL Boot_ReadImagePage(U_INT32 nPage)
+{
+	U_INT32 nAddress = (BOOT_FIRMWARE_START_PAGE + nPage) << 10;
+	U_INT16 i;
+
+	m_nSpiTimeout = BOOT_SPI_TIMEOUT;
+	GPIO_ResetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	(void)Boot_TransferByte(SERFLASH45_READ_PAGE_OPCODE);
+	(void)Boot_TransferByte((U_BYTE)(nAddress >> 16));
+	(void)Boot_TransferByte((U_BYTE)(nAddress >> 8));
+	(void)Boot_TransferByte((U_BYTE)nAddress);
+	for(i = 0; i < 4; i++)
+	{
+		(void)Boot_TransferByte(0);
+	}
+	for(i = 0; i < CHIP_PAGE_SIZE; i++)
+	{
+		m_nPage[i] = Boot_TransferByte(0);
+	}
+	GPIO_SetBits(DATAFLASH_CS_PORT, DATAFLASH_CS_PIN);
+	return (m_nSpiTimeout != 0) ? TRUE : FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   The initial stack pointer is in the RAM and the reset handler is thumb
+*   code within the nSize bytes of the application.
+*******************************************************************************/
+static BOOL Boot_IsVectorTable(const U_INT32 *pVectors, U_INT32 nSize)
+{
+	U_INT32 nStack = pVectors[0];
+	U_INT32 nReset = pVectors[1];
+
+	return ((nStack > SRAM1_BASE) && (nStack <= BOOT_RAM_END) && ((nReset & 1) != 0) &&
+	        (nReset > FIRMWARE_APPLICATION_ADDRESS) &&
+	        (nReset < (FIRMWARE_APPLICATION_ADDRESS + nSize))) ? TRUE : FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   The image in the serial flash against the record's CRC, the same check
+*   FirmwareUpdate_Service() made, as the backup SRAM may not have kept the
+*   image it made it on.  FALSE if the serial flash could not be read.
+*******************************************************************************/
+static BOOL Boot_CheckImage(const FIRMWARE_UPDATE *pUpdate, BOOL *pbGood)
+{
+	CRC32_CONTEXT crc;
+	U_INT32 nPage;
+	U_INT32 nLength;
+
+	*pbGood = FALSE;
+	if((pUpdate->nSize < (2 * sizeof(U_INT32))) || (pUpdate->nSize > BOOT_APPLICATION_SIZE) ||
+	   (pUpdate->nSize > (FIRMWARE_IMAGE_PAGES * CHIP_PAGE_SIZE)))
+	{
+		return TRUE;
+	}
+	CRC32_Start(&crc);
+	for(nPage = 0; (nPage * CHIP_PAGE_SIZE) < pUpdate->nSize; nPage++)
+	{
+		if(!Boot_ReadImagePage(nPage))
+		{
+			return FALSE;
+		}
+		if((nPage == 0) && !Boot_IsVectorTable((const U_INT32 *)m_nPage, pUpdate->nSize))
+		{
+			return TRUE;
+		}
+		nLength = pUpdate->nSize - (nPage * CHIP_PAGE_SIZE);
+		if(nLength > CHIP_PAGE_SIZE)
+		{
+			nLength = CHIP_PAGE_SIZE;
+		}
+		CRC32_Update(&crc, m_nPage, nLength);
+		IWDG_ReloadCounter();
+	}
+	*pbGood = (CRC32_Finish(&crc) == pUpdate->nCRC) ? TRUE : FALSE;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Erases the sectors the image reaches into and programs it a word at a
+*   time, the last word padded as erased flash reads.  The flash is locked
+*   again whatever happened.
+*******************************************************************************/
+static BOOL Boot_ProgramImage(const FIRMWARE_UPDATE *pUpdate)
+{
+	U_INT32 nAddress = FIRMWARE_APPLICATION_ADDRESS;
+	U_INT32 nPage;
+	U_INT32 nLength;
+	U_INT32 nWord;
+	U_INT16 i;
+	BOOL bProgrammed = TRUE;
+
+	FLASH_Unlock();
+	FLASH_ClearFlag(BOOT_FLASH_FLAGS);
+	for(i = 0; bProgrammed && (i < BOOT_SECTORS); i++)
+	{
+		if(m_Sectors[i].nAddress < (FIRMWARE_APPLICATION_ADDRESS + pUpdate->nSize))
+		{
+			bProgrammed = (FLASH_EraseSector(m_Sectors[i].nSector, VoltageRange_3) == FLASH_COMPLETE) ? TRUE : FALSE;
+			IWDG_ReloadCounter();
+		}
+	}
+	for(nPage = 0; bProgrammed && ((nPage * CHIP_PAGE_SIZE) < pUpdate->nSize); nPage++)
+	{
+		bProgrammed = Boot_ReadImagePage(nPage);
+		nLength = pUpdate->nSize - (nPage * CHIP_PAGE_SIZE);
+		if(nLength > CHIP_PAGE_SIZE)
+		{
+			nLength = CHIP_PAGE_SIZE;
+		}
+		memset(&m_nPage[nLength], 0xFF, CHIP_PAGE_SIZE - nLength);
+		for(i = 0; bProgrammed && (i < nLength); i += sizeof(nWord))
+		{
+			memcpy(&nWord, &m_nPage[i], sizeof(nWord));
+			bProgrammed = (FLASH_ProgramWord(nAddress + i, nWord) == FLASH_COMPLETE) ? TRUE : FALSE;
+		}
+		nAddress += CHIP_PAGE_SIZE;
+		IWDG_ReloadCounter();
+	}
+	FLASH_Lock();
+	return bProgrammed;
+}
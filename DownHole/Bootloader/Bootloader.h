@@ -0,0 +1,58 @@
+/*******************************************************************************
+*       @brief      Contains header information for the bootloader, which
+*                   installs a firmware image the application has taken into
+*                   the serial flash and checked, then starts the application.
+*       @file       Downhole/Bootloader/Bootloader.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef BOOTLOADER_H
+#define BOOTLOADER_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// what became of the update
+// 0 there is no image ready to install
+// 1 the image is in the internal flash and checked, the record is idle
+// 2 the image in the serial flash does not check out, the record is failed
+//   and the internal flash was not touched
+// 3 the serial or internal flash could not be read or written, the record
+//   is left ready so the next start tries again
+#define BOOT_NO_UPDATE			0
+#define BOOT_INSTALLED			1
+#define BOOT_IMAGE_BAD			2
+#define BOOT_FLASH_ERROR		3
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Turns on the backup SRAM and the serial flash's SPI
+	void Bootloader_Initialize(void);
+	// Installs the image the update record has as ready.  Returns BOOT_xxx
+	U_BYTE Bootloader_InstallUpdate(void);
+	// TRUE if the internal flash holds what looks like an application
+	BOOL Bootloader_IsApplicationValid(void);
+	// Puts back what the bootloader changed and jumps to the application,
+	// does not return
+	void Bootloader_StartApplication(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,139 @@
+/*******************************************************************************
+*       @brief      Checks the firmware image in a DataFlash image file.
+*                   Reads the update record from the backup SRAM image and
+*                   the image it describes from the DataFlash image, and
+*                   compares the CRC of the image with the one recorded.
+*       @file       Downhole/HostSim/FlashCheck/FlashCheck.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The files are those HostSim keeps its DataFlash and backup SRAM in, and
+// a dump of the boards' parts read out the same way: the AT45DB321 as its
+// 8192 pages of 528 bytes in page order, and the backup SRAM from its
+// first byte.  The firmware image area is the top FIRMWARE_IMAGE_PAGES
+// pages, the image in the first CHIP_PAGE_SIZE bytes of each.  The CRC is
+// crc.c's own, as FirmwareUpdate.c took it.
+//
+//  build/FlashCheck <flash image> <backup SRAM image>
+//
+// Exits 1 when an image the record has as ready for the bootloader does not
+// match its CRC, 2 when a file cannot be read, otherwise 0.  The CRC of an
+// image still being received is shown but not held against it.
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <string.h>
+#include "stm32f4xx.h"
+#include "crc.h"
+#include "FlashMemory.h"
+#include "FirmwareUpdate.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define DATAFLASH_PAGES         8192ul
+#define DATAFLASH_PAGE_SIZE     528ul
+#define FIRMWARE_START_PAGE     (DATAFLASH_PAGES - FIRMWARE_IMAGE_PAGES)
+#define FIRMWARE_CAPACITY       (FIRMWARE_IMAGE_PAGES * CHIP_PAGE_SIZE)
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const char * const m_pszStates[] =
+{
+	"idle", "receiving", "verifying", "ready", "failed"
+};
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   The CRC of nSize bytes of the firmware image area, FALSE if the file
+*   ends first.
+*******************************************************************************/
+static BOOL flashCheck_ImageCRC(FILE *pFlash, U_INT32 nSize, U_INT32 *pCRC)
+{
+	U_BYTE nPage[CHIP_PAGE_SIZE];
+	CRC32_CONTEXT crc;
+	U_INT32 nPageNumber;
+	U_INT32 nLength;
+
+	CRC32_Start(&crc);
+	for (nPageNumber = 0; (nPageNumber * CHIP_PAGE_SIZE) < nSize; nPageNumber++)
+	{
+		nLength = nSize - (nPageNumber * CHIP_PAGE_SIZE);
+		nLength = (nLength > CHIP_PAGE_SIZE) ? CHIP_PAGE_SIZE : nLength;
+		if ((fseek(pFlash, (long)((FIRMWARE_START_PAGE + nPageNumber) * DATAFLASH_PAGE_SIZE), SEEK_SET) != 0) ||
+		    (fread(nPage, 1, nLength, pFlash) != nLength))
+		{
+			return FALSE;
+		}
+		CRC32_Update(&crc, nPage, nLength);
+	}
+	*pCRC = CRC32_Finish(&crc);
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+	FIRMWARE_UPDATE update;
+	FILE *pFlash;
+	FILE *pBackup;
+	U_INT32 nCRC = 0;
+	BOOL bRead;
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s <flash image> <backup SRAM image>\n", argv[0]);
+		return 2;
+	}
+	pFlash = fopen(argv[1], "rb");
+	pBackup = fopen(argv[2], "rb");
+	bRead = (pFlash != NULL) && (pBackup != NULL) &&
+	        (fseek(pBackup, (long)(FIRMWARE_UPDATE_ADDRESS - BKPSRAM_BASE), SEEK_SET) == 0) &&
+	        (fread(&update, sizeof(update), 1, pBackup) == 1);
+	if (!bRead)
+	{
+		fprintf(stderr, "FlashCheck: cannot read %s\n", (pFlash == NULL) ? argv[1] : argv[2]);
+		return 2;
+	}
+	fclose(pBackup);
+
+	if (update.nMagic != FIRMWARE_UPDATE_MAGIC)
+	{
+		printf("FlashCheck: no update record\n");
+		fclose(pFlash);
+		return 0;
+	}
+	printf("FlashCheck: update %s, %u bytes, %u chunks in, CRC 0x%08X\n",
+	       (update.nState <= FIRMWARE_STATE_FAILED) ? m_pszStates[update.nState] : "unknown",
+	       (unsigned)update.nSize, (unsigned)update.nReceived, (unsigned)update.nCRC);
+	if (update.nSize > FIRMWARE_CAPACITY)
+	{
+		printf("FlashCheck: the image is larger than the image area\n");
+		fclose(pFlash);
+		return (update.nState == FIRMWARE_STATE_READY) ? 1 : 0;
+	}
+	bRead = flashCheck_ImageCRC(pFlash, update.nSize, &nCRC);
+	fclose(pFlash);
+	if (!bRead)
+	{
+		fprintf(stderr, "FlashCheck: %s ends inside the image\n", argv[1]);
+		return 2;
+	}
+	printf("FlashCheck: image CRC 0x%08X, %s\n", (unsigned)nCRC, (nCRC == update.nCRC) ? "good" : "BAD");
+	return ((update.nState == FIRMWARE_STATE_READY) && (nCRC != update.nCRC)) ? 1 : 0;
+}
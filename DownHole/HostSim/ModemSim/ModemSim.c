@@ -0,0 +1,598 @@
+/*******************************************************************************
+*       @brief      Yitran modem simulator.  Gives the UpHole and DownHole
+*                   hosts a pty each in place of their modem port and runs
+*                   the two modems and the powerline between them.
+*       @file       Downhole/HostSim/ModemSim/ModemSim.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// Settings (environment):
+//  MODEMSIM_UPHOLE         uphole host, "pty", "pty:<link>", a host serial
+//                          device, or "poll" for the built-in uphole
+//  MODEMSIM_DOWNHOLE       downhole host, as above less "poll"
+//  MODEMSIM_UART_BAUD      modem to host byte rate, default 38400
+//  MODEMSIM_UART_BER       bit error rate on the host serial lines
+//  MODEMSIM_CONFIGURED     1 starts both modems already set up and saved
+//  MODEMSIM_RUN_MS         stop after this long, 0 runs until killed
+//  MODEMSIM_REPORT_MS      print the statistics this often, 0 only at exit
+//  MODEMSIM_SEED           random number seed
+// and the modem, channel and poller settings in their own files.
+//
+// For example, with the DownHole firmware under HostSim..
+//  MODEMSIM_UPHOLE=poll MODEMSIM_DOWNHOLE=pty:/tmp/downhole-modem build/ModemSim
+//  HOSTSIM_USART1=/tmp/downhole-modem build/DownHoleSim
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ModemSim.h"
+// termios delay masks collide with the peripheral register names
+#undef CR1
+#undef CR2
+#undef CR3
+#include <termios.h>
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define HOST_QUEUE_SIZE         4096
+#define HOST_READ_SIZE          256
+// ten bit times per byte, budget kept in byte/1000 units per millisecond tick
+#define BUDGET_PER_BYTE         (10ul * 1000ul)
+// a frame that stops arriving for this long is dropped, mS
+#define FRAME_GAP_TIMEOUT       50
+
+// decoder states
+enum
+{
+	DECODE_COMMAND,
+	DECODE_LENGTH_LOW,
+	DECODE_LENGTH_HIGH,
+	DECODE_TYPE,
+	DECODE_OPCODE,
+	DECODE_DATA,
+	DECODE_CHECKSUM
+};
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	const char *pszEndpoint;
+	BOOL bPoller;
+	int nFd;
+	int nSlaveFd;
+	U_BYTE nQueue[HOST_QUEUE_SIZE];
+	U_INT32 nHead;
+	U_INT32 nTail;
+	U_INT32 nBudget;
+	U_INT32 nTxBytes;
+	U_INT32 nRxBytes;
+	U_INT32 nOverflows;
+	U_INT32 nBitErrors;
+} MODEMSIM_HOST;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static MODEMSIM_HOST m_Hosts[MODEMSIM_SIDES];
+static U_INT32 m_nTicks;
+static U_INT64 m_nRandomState;
+static U_INT32 m_nBaudRate;
+static REAL64 m_fUartBER;
+static volatile sig_atomic_t m_bStop;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 ModemSim_GetTicks(void)
+{
+	return m_nTicks;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+INT32 ModemSim_GetSetting(const char *pszName, INT32 nDefault)
+{
+	const char *pszValue = getenv(pszName);
+	return (pszValue != NULL && *pszValue != '\0') ? (INT32)strtol(pszValue, NULL, 0) : nDefault;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+REAL64 ModemSim_GetSettingReal(const char *pszName, REAL64 fDefault)
+{
+	const char *pszValue = getenv(pszName);
+	return (pszValue != NULL && *pszValue != '\0') ? strtod(pszValue, NULL) : fDefault;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const char *ModemSim_GetSettingText(const char *pszName, const char *pszDefault)
+{
+	const char *pszValue = getenv(pszName);
+	return (pszValue != NULL && *pszValue != '\0') ? pszValue : pszDefault;
+}
+
+/*******************************************************************************
+*       @details
+*   xorshift64*, uniform in (0, 1].  Seeded from MODEMSIM_SEED so a run can
+*   be repeated, as far as the hosts' own timing allows.
+*******************************************************************************/
+REAL64 ModemSim_RandomUniform(void)
+{
+	m_nRandomState ^= m_nRandomState >> 12;
+	m_nRandomState ^= m_nRandomState << 25;
+	m_nRandomState ^= m_nRandomState >> 27;
+	return ((REAL64)((m_nRandomState * 0x2545F4914F6CDD1Dull) >> 11) + 1.0) / 9007199254740992.0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_Log(const char *pszFormat, ...)
+{
+	va_list args;
+
+	fprintf(stderr, "ModemSim %8lu: ", (unsigned long)m_nTicks);
+	va_start(args, pszFormat);
+	vfprintf(stderr, pszFormat, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const char *ModemSim_SideName(MODEMSIM_SIDE eSide)
+{
+	return (eSide == MODEMSIM_UPHOLE) ? "uphole" : "downhole";
+}
+
+/*******************************************************************************
+*       @details
+*   The same framing the boards decode, the length counts the type and
+*   opcode and the checksum is the 8 bit sum from the length on.
+*******************************************************************************/
+BOOL ModemSim_DecodeByte(MODEMSIM_DECODER *pDecoder, U_BYTE nByte)
+{
+	MODEMSIM_FRAME *pFrame = &pDecoder->Frame;
+
+	if ((pDecoder->nState != DECODE_COMMAND) &&
+	    ((m_nTicks - pDecoder->nLastByte) >= FRAME_GAP_TIMEOUT))
+	{
+		pDecoder->nErrors++;
+		pDecoder->nState = DECODE_COMMAND;
+	}
+	pDecoder->nLastByte = m_nTicks;
+	switch (pDecoder->nState)
+	{
+	case DECODE_COMMAND:
+		if ((nByte == COMMAND_CONSTANT) || (nByte == CONFIGURATION_CONSTANT))
+		{
+			pFrame->nCommand = nByte;
+			pDecoder->nState = DECODE_LENGTH_LOW;
+		}
+		break;
+	case DECODE_LENGTH_LOW:
+		pDecoder->nLength = nByte;
+		pDecoder->nSum = nByte;
+		pDecoder->nState = DECODE_LENGTH_HIGH;
+		break;
+	case DECODE_LENGTH_HIGH:
+		pDecoder->nLength |= (U_INT16)(nByte << 8);
+		pDecoder->nSum += nByte;
+		if ((pDecoder->nLength < MODEM_REQUEST_BASE_LENGTH) ||
+		    (pDecoder->nLength > (MODEM_MESSAGE_BUFFER_SIZE + MODEM_REQUEST_BASE_LENGTH)))
+		{
+			pDecoder->nErrors++;
+			pDecoder->nState = DECODE_COMMAND;
+			break;
+		}
+		pFrame->nLength = pDecoder->nLength - MODEM_REQUEST_BASE_LENGTH;
+		pDecoder->nState = DECODE_TYPE;
+		break;
+	case DECODE_TYPE:
+		pFrame->nType = nByte;
+		pDecoder->nSum += nByte;
+		pDecoder->nState = DECODE_OPCODE;
+		break;
+	case DECODE_OPCODE:
+		pFrame->nOpCode = nByte;
+		pDecoder->nSum += nByte;
+		pDecoder->nCount = 0;
+		pDecoder->nState = (pFrame->nLength > 0) ? DECODE_DATA : DECODE_CHECKSUM;
+		break;
+	case DECODE_DATA:
+		pFrame->nData[pDecoder->nCount++] = nByte;
+		pDecoder->nSum += nByte;
+		if (pDecoder->nCount >= pFrame->nLength)
+		{
+			pDecoder->nState = DECODE_CHECKSUM;
+		}
+		break;
+	default:
+		pDecoder->nState = DECODE_COMMAND;
+		if (nByte != pDecoder->nSum)
+		{
+			pDecoder->nErrors++;
+			break;
+		}
+		pDecoder->nFrames++;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 ModemSim_EncodeFrame(U_BYTE *pFrame, U_BYTE nType, U_BYTE nOpCode,
+                             const U_BYTE *pData, U_INT16 nLength)
+{
+	U_INT16 nFrameLength = nLength + MODEM_REQUEST_BASE_LENGTH;
+	U_BYTE nSum;
+
+	pFrame[0] = COMMAND_CONSTANT;
+	pFrame[1] = (U_BYTE)nFrameLength;
+	pFrame[2] = (U_BYTE)(nFrameLength >> 8);
+	pFrame[3] = nType;
+	pFrame[4] = nOpCode;
+	if (nLength > 0)
+	{
+		memcpy(&pFrame[5], pData, nLength);
+	}
+	nSum = 0;
+	for (U_INT32 i = 1; i < (5u + nLength); i++)
+	{
+		nSum += pFrame[i];
+	}
+	pFrame[5 + nLength] = nSum;
+	return 6u + nLength;
+}
+
+/*******************************************************************************
+*       @details
+*   Each bit of each byte is flipped with probability MODEMSIM_UART_BER.
+*******************************************************************************/
+static void modemSim_SpoilBytes(MODEMSIM_HOST *pHost, U_BYTE *pData, U_INT32 nLength)
+{
+	if (m_fUartBER <= 0.0)
+	{
+		return;
+	}
+	for (U_INT32 i = 0; i < nLength; i++)
+	{
+		for (U_INT32 nBit = 0; nBit < 8; nBit++)
+		{
+			if (ModemSim_RandomUniform() <= m_fUartBER)
+			{
+				pData[i] ^= (U_BYTE)(1u << nBit);
+				pHost->nBitErrors++;
+			}
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_HostWrite(MODEMSIM_SIDE eSide, const U_BYTE *pData, U_INT32 nLength)
+{
+	MODEMSIM_HOST *pHost = &m_Hosts[eSide];
+
+	for (U_INT32 i = 0; i < nLength; i++)
+	{
+		U_INT32 nNext = (pHost->nHead + 1) % HOST_QUEUE_SIZE;
+
+		if (nNext == pHost->nTail)
+		{
+			pHost->nOverflows++;
+			return;
+		}
+		pHost->nQueue[pHost->nHead] = pData[i];
+		pHost->nHead = nNext;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_MakeRaw(int nFd)
+{
+	struct termios tio;
+
+	if (tcgetattr(nFd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tcsetattr(nFd, TCSANOW, &tio);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The slave side is held open so the master never reads EOF/EIO while no
+*   host is attached, a board that restarts finds its modem still there.
+*******************************************************************************/
+static int modemSim_OpenPty(MODEMSIM_HOST *pHost, MODEMSIM_SIDE eSide, const char *pszLink)
+{
+	int nFd = posix_openpt(O_RDWR | O_NOCTTY);
+	const char *pszSlave;
+
+	if ((nFd < 0) || (grantpt(nFd) != 0) || (unlockpt(nFd) != 0) ||
+	    ((pszSlave = ptsname(nFd)) == NULL))
+	{
+		ModemSim_Log("%s: cannot create a pty: %s", ModemSim_SideName(eSide), strerror(errno));
+		return -1;
+	}
+	pHost->nSlaveFd = open(pszSlave, O_RDWR | O_NOCTTY);
+	if (pHost->nSlaveFd >= 0)
+	{
+		modemSim_MakeRaw(pHost->nSlaveFd);
+	}
+	modemSim_MakeRaw(nFd);
+	if (pszLink != NULL)
+	{
+		(void)unlink(pszLink);
+		if (symlink(pszSlave, pszLink) != 0)
+		{
+			ModemSim_Log("%s: cannot link %s: %s", ModemSim_SideName(eSide), pszLink, strerror(errno));
+		}
+	}
+	ModemSim_Log("%s host on %s%s%s", ModemSim_SideName(eSide), pszSlave,
+	             (pszLink != NULL) ? " -> " : "", (pszLink != NULL) ? pszLink : "");
+	return nFd;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_HostAttach(MODEMSIM_SIDE eSide, const char *pszEndpoint)
+{
+	MODEMSIM_HOST *pHost = &m_Hosts[eSide];
+
+	memset(pHost, 0, sizeof(*pHost));
+	pHost->pszEndpoint = pszEndpoint;
+	pHost->nFd = -1;
+	pHost->nSlaveFd = -1;
+	if ((eSide == MODEMSIM_UPHOLE) && (strcmp(pszEndpoint, "poll") == 0))
+	{
+		pHost->bPoller = TRUE;
+		ModemSim_Log("%s host is the built-in poller", ModemSim_SideName(eSide));
+	}
+	else if (strcmp(pszEndpoint, "pty") == 0)
+	{
+		pHost->nFd = modemSim_OpenPty(pHost, eSide, NULL);
+	}
+	else if (strncmp(pszEndpoint, "pty:", 4) == 0)
+	{
+		pHost->nFd = modemSim_OpenPty(pHost, eSide, &pszEndpoint[4]);
+	}
+	else
+	{
+		pHost->nFd = open(pszEndpoint, O_RDWR | O_NOCTTY);
+		if (pHost->nFd < 0)
+		{
+			ModemSim_Log("%s: cannot open %s: %s", ModemSim_SideName(eSide), pszEndpoint, strerror(errno));
+		}
+		else
+		{
+			if (isatty(pHost->nFd))
+			{
+				modemSim_MakeRaw(pHost->nFd);
+			}
+			ModemSim_Log("%s host on %s", ModemSim_SideName(eSide), pszEndpoint);
+		}
+	}
+	if (pHost->nFd >= 0)
+	{
+		fcntl(pHost->nFd, F_SETFL, fcntl(pHost->nFd, F_GETFL) | O_NONBLOCK);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   What the host sent is taken as it comes, the pty already delivered it at
+*   the host's own rate.  What goes back is paced at MODEMSIM_UART_BAUD.
+*******************************************************************************/
+static void modemSim_HostTick(MODEMSIM_SIDE eSide)
+{
+	MODEMSIM_HOST *pHost = &m_Hosts[eSide];
+	U_BYTE nData[HOST_READ_SIZE];
+	ssize_t nCount;
+	U_INT32 nBytes = 0;
+
+	if (pHost->nFd >= 0)
+	{
+		while ((nCount = read(pHost->nFd, nData, sizeof(nData))) > 0)
+		{
+			pHost->nRxBytes += (U_INT32)nCount;
+			modemSim_SpoilBytes(pHost, nData, (U_INT32)nCount);
+			ModemSim_ModemReceive(eSide, nData, (U_INT32)nCount);
+		}
+	}
+
+	pHost->nBudget += m_nBaudRate;
+	if (pHost->nBudget > (BUDGET_PER_BYTE * HOST_READ_SIZE))
+	{
+		pHost->nBudget = BUDGET_PER_BYTE * HOST_READ_SIZE;
+	}
+	while ((pHost->nTail != pHost->nHead) && (pHost->nBudget >= BUDGET_PER_BYTE) &&
+	       (nBytes < sizeof(nData)))
+	{
+		nData[nBytes++] = pHost->nQueue[pHost->nTail];
+		pHost->nTail = (pHost->nTail + 1) % HOST_QUEUE_SIZE;
+		pHost->nBudget -= BUDGET_PER_BYTE;
+	}
+	if (pHost->nTail == pHost->nHead)
+	{
+		// an idle line saves up no more than a byte
+		pHost->nBudget = (pHost->nBudget > BUDGET_PER_BYTE) ? BUDGET_PER_BYTE : pHost->nBudget;
+	}
+	if (nBytes == 0)
+	{
+		return;
+	}
+	modemSim_SpoilBytes(pHost, nData, nBytes);
+	pHost->nTxBytes += nBytes;
+	if (pHost->bPoller)
+	{
+		ModemSim_PollerReceive(nData, nBytes);
+	}
+	else if (pHost->nFd >= 0)
+	{
+		// a host that is not reading loses what its buffer cannot hold
+		(void)write(pHost->nFd, nData, nBytes);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_Report(void)
+{
+	for (U_INT32 i = 0; i < MODEMSIM_SIDES; i++)
+	{
+		MODEMSIM_HOST *pHost = &m_Hosts[i];
+
+		ModemSim_Log("%s host: %lu bytes sent, %lu received, %lu overflowed, %lu bit errors",
+		             ModemSim_SideName((MODEMSIM_SIDE)i), (unsigned long)pHost->nTxBytes,
+		             (unsigned long)pHost->nRxBytes, (unsigned long)pHost->nOverflows,
+		             (unsigned long)pHost->nBitErrors);
+		ModemSim_ModemReport((MODEMSIM_SIDE)i);
+	}
+	ModemSim_ChannelReport();
+	if (m_Hosts[MODEMSIM_UPHOLE].bPoller)
+	{
+		ModemSim_PollerReport();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_Stop(int nSignal)
+{
+	(void)nSignal;
+	m_bStop = 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 modemSim_Clock(const struct timespec *pStart)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (U_INT32)(((now.tv_sec - pStart->tv_sec) * 1000) + ((now.tv_nsec - pStart->tv_nsec) / 1000000));
+}
+
+/*******************************************************************************
+*       @details
+*   Everything steps once a millisecond, catching up when the process was
+*   held off.
+*******************************************************************************/
+int main(void)
+{
+	struct sigaction action;
+	struct pollfd fds[MODEMSIM_SIDES];
+	struct timespec start;
+	U_INT32 nRunTicks;
+	U_INT32 nReportTicks;
+	U_INT32 nNextReport;
+	U_INT32 nFds;
+	BOOL bConfigured;
+
+	m_nRandomState = 0x9E3779B97F4A7C15ull ^ (U_INT64)ModemSim_GetSetting("MODEMSIM_SEED", 1);
+	m_nBaudRate = (U_INT32)ModemSim_GetSetting("MODEMSIM_UART_BAUD", 38400);
+	m_fUartBER = ModemSim_GetSettingReal("MODEMSIM_UART_BER", 0.0);
+	nRunTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_RUN_MS", 0);
+	nReportTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_REPORT_MS", 0);
+	bConfigured = ModemSim_GetSetting("MODEMSIM_CONFIGURED", 0) != 0;
+
+	modemSim_HostAttach(MODEMSIM_UPHOLE, ModemSim_GetSettingText("MODEMSIM_UPHOLE", "pty"));
+	modemSim_HostAttach(MODEMSIM_DOWNHOLE, ModemSim_GetSettingText("MODEMSIM_DOWNHOLE", "pty"));
+	ModemSim_ChannelInitialize();
+	// the built-in uphole does not set its modem up, so that one starts ready
+	ModemSim_ModemInitialize(MODEMSIM_UPHOLE, bConfigured || m_Hosts[MODEMSIM_UPHOLE].bPoller);
+	ModemSim_ModemInitialize(MODEMSIM_DOWNHOLE, bConfigured);
+	if (m_Hosts[MODEMSIM_UPHOLE].bPoller)
+	{
+		ModemSim_PollerInitialize();
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = modemSim_Stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	nNextReport = nReportTicks;
+	while (!m_bStop && ((nRunTicks == 0) || (m_nTicks < nRunTicks)))
+	{
+		U_INT32 nNow;
+
+		nFds = 0;
+		for (U_INT32 i = 0; i < MODEMSIM_SIDES; i++)
+		{
+			if (m_Hosts[i].nFd >= 0)
+			{
+				fds[nFds].fd = m_Hosts[i].nFd;
+				fds[nFds].events = POLLIN;
+				nFds++;
+			}
+		}
+		(void)poll(fds, nFds, 1);
+		nNow = modemSim_Clock(&start);
+		while (m_nTicks < nNow)
+		{
+			m_nTicks++;
+			for (U_INT32 i = 0; i < MODEMSIM_SIDES; i++)
+			{
+				modemSim_HostTick((MODEMSIM_SIDE)i);
+				ModemSim_ModemTick((MODEMSIM_SIDE)i);
+			}
+			ModemSim_ChannelTick();
+			if (m_Hosts[MODEMSIM_UPHOLE].bPoller)
+			{
+				ModemSim_PollerTick();
+			}
+			if ((nReportTicks != 0) && (m_nTicks >= nNextReport))
+			{
+				nNextReport += nReportTicks;
+				modemSim_Report();
+			}
+		}
+	}
+	ModemSim_Log("ran %lu ms", (unsigned long)m_nTicks);
+	modemSim_Report();
+	return 0;
+}
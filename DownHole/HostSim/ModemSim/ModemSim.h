@@ -0,0 +1,192 @@
+/*******************************************************************************
+*       @brief      Interface between the parts of the Yitran modem simulator,
+*                   a host process that stands in for the pair of powerline
+*                   modems between the UpHole and DownHole boards.
+*       @file       Downhole/HostSim/ModemSim/ModemSim.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// How it works..
+// Each board talks to its modem over a serial port.  ModemSim gives each
+// side a pty in place of that port and answers the modem host interface on
+// it: the reset banner, the operation mode and serial number parameters,
+// save, online and offline, the network database queries, and TX_PACKET.
+// The two modems join a network once both are online, one as the network
+// controller and one as a station, and the packets each host sends cross a
+// simulated powerline with latency, jitter, frame loss, bit errors and a
+// bandwidth limit, are acknowledged, retried, and handed to the other host
+// as RX_PACKET indications.
+//
+// ModemSim_Modem.c    the host interface of one modem
+// ModemSim_Channel.c  the powerline between them
+// ModemSim_Poller.c   a built-in uphole that asks for surveys
+// ModemSim.c          ptys, the clock, settings and the statistics
+
+#ifndef MODEM_SIM_H
+#define MODEM_SIM_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+#include "ModemDataHandler.h"
+#include "ModemManager.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the two ends of the link
+typedef enum
+{
+	MODEMSIM_UPHOLE,
+	MODEMSIM_DOWNHOLE,
+	MODEMSIM_SIDES
+} MODEMSIM_SIDE;
+
+// the modem operation modes the boards set, table 6 index 0x31
+#define MODEMSIM_MODE_STATION		0x00
+#define MODEMSIM_MODE_CONTROLLER	0x03
+
+// TX_PACKET request header before the payload, RX_PACKET indication header
+#define MODEMSIM_TX_HEADER_LENGTH	15
+#define MODEMSIM_RX_HEADER_LENGTH	25
+
+// largest frame either way, start, length, type, opcode, data and checksum
+#define MODEMSIM_FRAME_MAX		(MODEM_MESSAGE_BUFFER_SIZE + 6)
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// A frame of the host interface, the data is what follows the opcode.
+typedef struct
+{
+	U_BYTE nCommand;
+	U_BYTE nType;
+	U_BYTE nOpCode;
+	U_INT16 nLength;
+	U_BYTE nData[MODEM_MESSAGE_BUFFER_SIZE];
+} MODEMSIM_FRAME;
+
+// Byte at a time decoder of host interface frames.
+typedef struct
+{
+	MODEMSIM_FRAME Frame;
+	U_INT32 nState;
+	U_INT16 nLength;
+	U_INT16 nCount;
+	U_BYTE nSum;
+	U_INT32 nLastByte;
+	U_INT32 nFrames;
+	U_INT32 nErrors;
+} MODEMSIM_DECODER;
+
+// A payload on its way across the powerline.
+typedef struct
+{
+	MODEMSIM_SIDE eFrom;
+	U_INT32 nSequence;		// per sender, the receiver drops repeats
+	U_INT16 nTag;
+	U_INT32 nQueued;		// when the host handed it over, mS
+	U_INT16 nLength;
+	U_BYTE nData[MODEM_MESSAGE_BUFFER_SIZE];
+} MODEMSIM_PACKET;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    ///@brief  Milliseconds since the simulator started.
+    U_INT32 ModemSim_GetTicks(void);
+
+    ///@brief  Read an integer setting from the environment.
+    INT32 ModemSim_GetSetting(const char *pszName, INT32 nDefault);
+
+    ///@brief  Read a real setting from the environment.
+    REAL64 ModemSim_GetSettingReal(const char *pszName, REAL64 fDefault);
+
+    ///@brief  Read a string setting from the environment.
+    const char *ModemSim_GetSettingText(const char *pszName, const char *pszDefault);
+
+    ///@brief  Write a line to stderr.
+    void ModemSim_Log(const char *pszFormat, ...) __attribute__((format(printf, 1, 2)));
+
+    ///@brief  Uniform random number in (0, 1], repeatable with MODEMSIM_SEED.
+    REAL64 ModemSim_RandomUniform(void);
+
+    ///@brief  Name of a side for the log.
+    const char *ModemSim_SideName(MODEMSIM_SIDE eSide);
+
+    ///@brief  Queue bytes for the host of a side, paced at the UART rate.
+    void ModemSim_HostWrite(MODEMSIM_SIDE eSide, const U_BYTE *pData, U_INT32 nLength);
+
+    ///@brief  Feed a byte to a decoder, TRUE once a whole good frame is in.
+    BOOL ModemSim_DecodeByte(MODEMSIM_DECODER *pDecoder, U_BYTE nByte);
+
+    ///@brief  Build a host interface frame, returns its length in bytes.
+    U_INT32 ModemSim_EncodeFrame(U_BYTE *pFrame, U_BYTE nType, U_BYTE nOpCode,
+                                 const U_BYTE *pData, U_INT16 nLength);
+
+    ///@brief  Start the modem of a side, TRUE to start it configured.
+    void ModemSim_ModemInitialize(MODEMSIM_SIDE eSide, BOOL bConfigured);
+
+    ///@brief  Bytes the host of a side sent to its modem.
+    void ModemSim_ModemReceive(MODEMSIM_SIDE eSide, const U_BYTE *pData, U_INT32 nLength);
+
+    ///@brief  Run the modem timers.
+    void ModemSim_ModemTick(MODEMSIM_SIDE eSide);
+
+    ///@brief  TRUE while the modem of a side is in the network.
+    BOOL ModemSim_ModemIsJoined(MODEMSIM_SIDE eSide);
+
+    ///@brief  A packet came across the powerline for this side's host.
+    void ModemSim_ModemDeliver(MODEMSIM_SIDE eSide, const MODEMSIM_PACKET *pPacket);
+
+    ///@brief  The far modem acknowledged a packet, or it ran out of retries.
+    void ModemSim_ModemSent(MODEMSIM_SIDE eSide, const MODEMSIM_PACKET *pPacket, BOOL bAcked);
+
+    ///@brief  Print the modem statistics.
+    void ModemSim_ModemReport(MODEMSIM_SIDE eSide);
+
+    ///@brief  Read the channel settings.
+    void ModemSim_ChannelInitialize(void);
+
+    ///@brief  Put a packet on the powerline, FALSE when the sender is full.
+    BOOL ModemSim_ChannelSend(const MODEMSIM_PACKET *pPacket);
+
+    ///@brief  Drop whatever a side still had to send, its modem left the
+    ///        network.
+    void ModemSim_ChannelFlush(MODEMSIM_SIDE eSide);
+
+    ///@brief  Move the frames in flight on to now.
+    void ModemSim_ChannelTick(void);
+
+    ///@brief  Print the channel statistics.
+    void ModemSim_ChannelReport(void);
+
+    ///@brief  Start the built-in uphole host.
+    void ModemSim_PollerInitialize(void);
+
+    ///@brief  Bytes the uphole modem sent to the built-in host.
+    void ModemSim_PollerReceive(const U_BYTE *pData, U_INT32 nLength);
+
+    ///@brief  Run the built-in host.
+    void ModemSim_PollerTick(void);
+
+    ///@brief  Print the survey round trip statistics.
+    void ModemSim_PollerReport(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MODEM_SIM_H
@@ -0,0 +1,399 @@
+/*******************************************************************************
+*       @brief      The powerline between the two simulated modems.  One
+*                   shared half duplex medium, each packet acknowledged by the
+*                   far modem and sent again until it is or the retries run
+*                   out.
+*       @file       Downhole/HostSim/ModemSim/ModemSim_Channel.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// A frame holds the medium for its airtime, the payload and a fixed overhead
+// at MODEMSIM_BANDWIDTH_BPS, then arrives after the latency and up to the
+// jitter more.  It is lost outright with MODEMSIM_LOSS, otherwise each of its
+// bits is wrong with MODEMSIM_BER and a frame with any wrong bit fails the
+// modem CRC and is dropped.  Acknowledgements are frames too and suffer the
+// same.  Each modem sends one packet at a time.
+//
+// Settings (environment):
+//  MODEMSIM_BANDWIDTH_BPS  powerline bit rate, default 7500
+//  MODEMSIM_OVERHEAD       bytes of preamble, header and CRC a frame carries
+//                          besides the payload, default 24
+//  MODEMSIM_LATENCY_MS     end of a frame to its arrival, default 20
+//  MODEMSIM_JITTER_MS      most extra arrival delay, uniform, default 5
+//  MODEMSIM_LOSS           probability a frame is lost, default 0
+//  MODEMSIM_BER            powerline bit error rate, default 0
+//  MODEMSIM_RETRIES        sends after the first before giving up, default 3
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <math.h>
+#include <string.h>
+#include "ModemSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// packets a modem holds to send, the boards send one at a time
+#define SEND_QUEUE_SIZE         4
+// frames in the air at once, at most a data frame and an ack each way
+#define FLIGHT_SIZE             16
+// waited for an ack past the longest it could take
+#define ACK_MARGIN_MS           50
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	BOOL bUsed;
+	BOOL bAck;
+	BOOL bSpoilt;
+	MODEMSIM_SIDE eTo;
+	U_INT32 nArrival;
+	MODEMSIM_PACKET Packet;		// only the sender and sequence of an ack
+} CHANNEL_FLIGHT;
+
+typedef struct
+{
+	MODEMSIM_PACKET Queue[SEND_QUEUE_SIZE];
+	U_INT32 nHead;
+	U_INT32 nCount;
+	BOOL bInFlight;
+	U_INT32 nAttempts;
+	U_INT32 nAckDue;
+	U_INT32 nLastDelivered;		// sequence of the last packet from the far side
+	// statistics of what this side sent
+	U_INT32 nPackets;
+	U_INT32 nFrames;
+	U_INT32 nLost;
+	U_INT32 nCorrupt;
+	U_INT32 nDelivered;
+	U_INT32 nRepeats;
+	U_INT32 nAcksSpoilt;
+	U_INT32 nFailed;
+	U_INT32 nBytes;
+	U_INT32 nLatencySum;
+	U_INT32 nLatencyMin;
+	U_INT32 nLatencyMax;
+	U_INT32 nFirstQueued;
+	U_INT32 nLastDeliveredTick;
+} CHANNEL_SENDER;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static CHANNEL_SENDER m_Senders[MODEMSIM_SIDES];
+static CHANNEL_FLIGHT m_Flights[FLIGHT_SIZE];
+static U_INT32 m_nMediumFree;
+static U_INT32 m_nAirtime;
+
+static REAL64 m_fBitsPerSecond;
+static U_INT32 m_nOverhead;
+static U_INT32 m_nLatency;
+static U_INT32 m_nJitter;
+static REAL64 m_fLoss;
+static REAL64 m_fBER;
+static U_INT32 m_nRetries;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ChannelInitialize(void)
+{
+	m_fBitsPerSecond = ModemSim_GetSettingReal("MODEMSIM_BANDWIDTH_BPS", 7500.0);
+	m_nOverhead = (U_INT32)ModemSim_GetSetting("MODEMSIM_OVERHEAD", 24);
+	m_nLatency = (U_INT32)ModemSim_GetSetting("MODEMSIM_LATENCY_MS", 20);
+	m_nJitter = (U_INT32)ModemSim_GetSetting("MODEMSIM_JITTER_MS", 5);
+	m_fLoss = ModemSim_GetSettingReal("MODEMSIM_LOSS", 0.0);
+	m_fBER = ModemSim_GetSettingReal("MODEMSIM_BER", 0.0);
+	m_nRetries = (U_INT32)ModemSim_GetSetting("MODEMSIM_RETRIES", 3);
+	if (m_fBitsPerSecond < 1.0)
+	{
+		m_fBitsPerSecond = 1.0;
+	}
+	memset(m_Senders, 0, sizeof(m_Senders));
+	memset(m_Flights, 0, sizeof(m_Flights));
+	for (U_INT32 i = 0; i < MODEMSIM_SIDES; i++)
+	{
+		m_Senders[i].nLatencyMin = 0xFFFFFFFFul;
+	}
+	ModemSim_Log("powerline %.0f bit/s, %lu ms latency, %lu ms jitter, loss %g, BER %g, %lu retries",
+	             m_fBitsPerSecond, (unsigned long)m_nLatency, (unsigned long)m_nJitter,
+	             m_fLoss, m_fBER, (unsigned long)m_nRetries);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 channel_Airtime(U_INT32 nPayload)
+{
+	return (U_INT32)ceil(((REAL64)(m_nOverhead + nPayload) * 8.0 * 1000.0) / m_fBitsPerSecond);
+}
+
+/*******************************************************************************
+*       @details
+*   Waits for the medium, holds it for the airtime and puts the frame in
+*   the air.  Returns when it ends.
+*******************************************************************************/
+static U_INT32 channel_Transmit(const MODEMSIM_PACKET *pPacket, MODEMSIM_SIDE eTo, BOOL bAck)
+{
+	CHANNEL_SENDER *pSender = &m_Senders[pPacket->eFrom];
+	U_INT32 nNow = ModemSim_GetTicks();
+	U_INT32 nPayload = bAck ? 0 : pPacket->nLength;
+	U_INT32 nAirtime = channel_Airtime(nPayload);
+	U_INT32 nStart = ((INT32)(m_nMediumFree - nNow) > 0) ? m_nMediumFree : nNow;
+	REAL64 fBits = (REAL64)(m_nOverhead + nPayload) * 8.0;
+	CHANNEL_FLIGHT *pFlight = NULL;
+
+	m_nMediumFree = nStart + nAirtime;
+	m_nAirtime += nAirtime;
+	for (U_INT32 i = 0; i < FLIGHT_SIZE; i++)
+	{
+		if (!m_Flights[i].bUsed)
+		{
+			pFlight = &m_Flights[i];
+			break;
+		}
+	}
+	if (pFlight == NULL)
+	{
+		// cannot happen with one packet each way, counted as lost if it does
+		pSender->nLost++;
+		return m_nMediumFree;
+	}
+	pFlight->bUsed = TRUE;
+	pFlight->bAck = bAck;
+	pFlight->eTo = eTo;
+	pFlight->nArrival = m_nMediumFree + m_nLatency + (U_INT32)(ModemSim_RandomUniform() * m_nJitter);
+	pFlight->bSpoilt = FALSE;
+	if (ModemSim_RandomUniform() <= m_fLoss)
+	{
+		pFlight->bSpoilt = TRUE;
+		if (!bAck)
+		{
+			pSender->nLost++;
+		}
+	}
+	else if ((m_fBER > 0.0) && (ModemSim_RandomUniform() <= (1.0 - pow(1.0 - m_fBER, fBits))))
+	{
+		pFlight->bSpoilt = TRUE;
+		if (!bAck)
+		{
+			pSender->nCorrupt++;
+		}
+	}
+	if (bAck)
+	{
+		pFlight->Packet.eFrom = pPacket->eFrom;
+		pFlight->Packet.nSequence = pPacket->nSequence;
+	}
+	else
+	{
+		pFlight->Packet = *pPacket;
+	}
+	return m_nMediumFree;
+}
+
+/*******************************************************************************
+*       @details
+*   The ack can wait behind a data frame from the far side before it goes.
+*******************************************************************************/
+static void channel_SendHead(MODEMSIM_SIDE eSide)
+{
+	CHANNEL_SENDER *pSender = &m_Senders[eSide];
+	const MODEMSIM_PACKET *pPacket = &pSender->Queue[pSender->nHead];
+	MODEMSIM_SIDE eTo = (eSide == MODEMSIM_UPHOLE) ? MODEMSIM_DOWNHOLE : MODEMSIM_UPHOLE;
+	U_INT32 nEnd = channel_Transmit(pPacket, eTo, FALSE);
+
+	pSender->bInFlight = TRUE;
+	pSender->nAttempts++;
+	pSender->nFrames++;
+	pSender->nAckDue = nEnd + (2 * (m_nLatency + m_nJitter)) + channel_Airtime(0) +
+	                   channel_Airtime(MODEM_MESSAGE_BUFFER_SIZE) + ACK_MARGIN_MS;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void channel_Finish(MODEMSIM_SIDE eSide, BOOL bAcked)
+{
+	CHANNEL_SENDER *pSender = &m_Senders[eSide];
+	MODEMSIM_PACKET packet = pSender->Queue[pSender->nHead];
+
+	pSender->bInFlight = FALSE;
+	pSender->nAttempts = 0;
+	pSender->nHead = (pSender->nHead + 1) % SEND_QUEUE_SIZE;
+	pSender->nCount--;
+	if (!bAcked)
+	{
+		pSender->nFailed++;
+	}
+	ModemSim_ModemSent(eSide, &packet, bAcked);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL ModemSim_ChannelSend(const MODEMSIM_PACKET *pPacket)
+{
+	CHANNEL_SENDER *pSender = &m_Senders[pPacket->eFrom];
+
+	if (pSender->nCount >= SEND_QUEUE_SIZE)
+	{
+		return FALSE;
+	}
+	pSender->Queue[(pSender->nHead + pSender->nCount) % SEND_QUEUE_SIZE] = *pPacket;
+	pSender->nCount++;
+	if (pSender->nPackets++ == 0)
+	{
+		pSender->nFirstQueued = ModemSim_GetTicks();
+	}
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ChannelFlush(MODEMSIM_SIDE eSide)
+{
+	CHANNEL_SENDER *pSender = &m_Senders[eSide];
+
+	pSender->nCount = 0;
+	pSender->bInFlight = FALSE;
+	pSender->nAttempts = 0;
+}
+
+/*******************************************************************************
+*       @details
+*   A data frame is acknowledged whenever it arrives, even a repeat, since
+*   the ack for the first may be what was lost.
+*******************************************************************************/
+static void channel_Arrive(CHANNEL_FLIGHT *pFlight)
+{
+	CHANNEL_SENDER *pSender = &m_Senders[pFlight->Packet.eFrom];
+	CHANNEL_SENDER *pReceiver = &m_Senders[pFlight->eTo];
+	U_INT32 nLatency;
+
+	if (pFlight->bAck)
+	{
+		if (pFlight->bSpoilt)
+		{
+			pSender->nAcksSpoilt++;
+		}
+		else if (pSender->bInFlight && (pSender->Queue[pSender->nHead].nSequence == pFlight->Packet.nSequence))
+		{
+			channel_Finish(pFlight->Packet.eFrom, TRUE);
+		}
+		return;
+	}
+	if (pFlight->bSpoilt || !ModemSim_ModemIsJoined(pFlight->eTo))
+	{
+		return;
+	}
+	if (pReceiver->nLastDelivered == pFlight->Packet.nSequence)
+	{
+		pSender->nRepeats++;
+	}
+	else
+	{
+		pReceiver->nLastDelivered = pFlight->Packet.nSequence;
+		nLatency = ModemSim_GetTicks() - pFlight->Packet.nQueued;
+		pSender->nDelivered++;
+		pSender->nBytes += pFlight->Packet.nLength;
+		pSender->nLatencySum += nLatency;
+		pSender->nLatencyMin = (nLatency < pSender->nLatencyMin) ? nLatency : pSender->nLatencyMin;
+		pSender->nLatencyMax = (nLatency > pSender->nLatencyMax) ? nLatency : pSender->nLatencyMax;
+		pSender->nLastDeliveredTick = ModemSim_GetTicks();
+		ModemSim_ModemDeliver(pFlight->eTo, &pFlight->Packet);
+	}
+	// the ack goes from the receiver, but is filed under the data's sender
+	(void)channel_Transmit(&pFlight->Packet, pFlight->Packet.eFrom, TRUE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ChannelTick(void)
+{
+	U_INT32 nNow = ModemSim_GetTicks();
+
+	for (U_INT32 i = 0; i < FLIGHT_SIZE; i++)
+	{
+		CHANNEL_FLIGHT *pFlight = &m_Flights[i];
+
+		if (pFlight->bUsed && ((INT32)(nNow - pFlight->nArrival) >= 0))
+		{
+			pFlight->bUsed = FALSE;
+			channel_Arrive(pFlight);
+		}
+	}
+	for (U_INT32 i = 0; i < MODEMSIM_SIDES; i++)
+	{
+		CHANNEL_SENDER *pSender = &m_Senders[i];
+
+		if (pSender->bInFlight && ((INT32)(nNow - pSender->nAckDue) >= 0))
+		{
+			if (pSender->nAttempts > m_nRetries)
+			{
+				channel_Finish((MODEMSIM_SIDE)i, FALSE);
+			}
+			else
+			{
+				channel_SendHead((MODEMSIM_SIDE)i);
+			}
+		}
+		if (!pSender->bInFlight && (pSender->nCount > 0))
+		{
+			channel_SendHead((MODEMSIM_SIDE)i);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Throughput is the payload delivered over the time from the first packet
+*   taken to the last one delivered.
+*******************************************************************************/
+void ModemSim_ChannelReport(void)
+{
+	U_INT32 nNow = ModemSim_GetTicks();
+
+	for (U_INT32 i = 0; i < MODEMSIM_SIDES; i++)
+	{
+		CHANNEL_SENDER *pSender = &m_Senders[i];
+		MODEMSIM_SIDE eTo = (i == MODEMSIM_UPHOLE) ? MODEMSIM_DOWNHOLE : MODEMSIM_UPHOLE;
+		U_INT32 nSpan = pSender->nLastDeliveredTick - pSender->nFirstQueued;
+
+		ModemSim_Log("%s to %s: %lu packets, %lu frames, %lu lost, %lu corrupt, %lu delivered, "
+		             "%lu repeats, %lu acks spoilt, %lu failed",
+		             ModemSim_SideName((MODEMSIM_SIDE)i), ModemSim_SideName(eTo),
+		             (unsigned long)pSender->nPackets, (unsigned long)pSender->nFrames,
+		             (unsigned long)pSender->nLost, (unsigned long)pSender->nCorrupt,
+		             (unsigned long)pSender->nDelivered, (unsigned long)pSender->nRepeats,
+		             (unsigned long)pSender->nAcksSpoilt, (unsigned long)pSender->nFailed);
+		if (pSender->nDelivered == 0)
+		{
+			continue;
+		}
+		ModemSim_Log("%s to %s: latency min %lu avg %lu max %lu ms, %lu bytes at %.0f bit/s",
+		             ModemSim_SideName((MODEMSIM_SIDE)i), ModemSim_SideName(eTo),
+		             (unsigned long)pSender->nLatencyMin,
+		             (unsigned long)(pSender->nLatencySum / pSender->nDelivered),
+		             (unsigned long)pSender->nLatencyMax, (unsigned long)pSender->nBytes,
+		             (nSpan > 0) ? ((REAL64)pSender->nBytes * 8000.0 / nSpan) : 0.0);
+	}
+	ModemSim_Log("powerline busy %.1f%% of the time",
+	             (nNow > 0) ? (100.0 * m_nAirtime / nNow) : 0.0);
+}
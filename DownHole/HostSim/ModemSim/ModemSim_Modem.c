@@ -0,0 +1,652 @@
+/*******************************************************************************
+*       @brief      Host interface of a simulated Yitran IT700 modem.  Boots
+*                   with the reset banner, keeps the operation mode and serial
+*                   number, goes online, joins the other modem and passes
+*                   packets to and from the powerline.
+*       @file       Downhole/HostSim/ModemSim/ModemSim_Modem.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The boards reset their modem with a GPIO line a pty cannot carry, so the
+// modem reboots instead when it is offline and its host has said nothing
+// for MODEMSIM_RESET_QUIET_MS since the last byte or the last banner.  The
+// boards hold the line for half a second then wait up to five for the
+// banner, which that rule answers.  A reboot reloads the saved parameters.
+//
+// Settings (environment):
+//  MODEMSIM_BOOT_MS        reboot to reset banner, default 100
+//  MODEMSIM_RESET_QUIET_MS quiet host taken as a reset, default 2000
+//  MODEMSIM_HOST_LOST_MS   quiet host taken as gone while online, the modem
+//                          leaves the network, default 30000, 0 never
+//  MODEMSIM_JOIN_MS        both online to the network formed, default 1000
+//  MODEMSIM_FRAME_GAP_MS   least time between frames to a host, so the
+//                          board has taken one before the next, default 10
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "ModemSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define OUT_QUEUE_FRAMES        16
+
+// parameter table 5 index of the serial number, table 6 of the mode
+#define SERIAL_NUMBER_INDEX     0xBAAB
+
+// what the controller hands out, and its database
+#define NETWORK_ID              0x0123
+#define NODE_DB_SIZE            16
+#define STATION_NODE_INDEX      1
+
+// GET_NODE_INFO response layout
+#define NODE_INFO_INDEX         1
+#define NODE_INFO_SERIAL        5
+#define NODE_INFO_CONNECTED     21
+#define NODE_INFO_LENGTH        22
+
+// CONNECTIVITY_STATUS indication layout
+#define CONNECTIVITY_SERIAL     2
+#define CONNECTIVITY_CONNECTED  18
+#define CONNECTIVITY_LENGTH     19
+
+// TX_PACKET response numbers
+#define TX_ACCEPTED             1
+#define TX_DELIVERED            3
+
+typedef enum
+{
+	MODEM_BOOT,
+	MODEM_OFFLINE,
+	MODEM_ONLINE
+} MODEM_STATE;
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	U_INT16 nMode;
+	U_BYTE sSerial[MODEM_SN_LENGTH];
+} MODEM_PARAMETERS;
+
+typedef struct
+{
+	U_INT32 nLength;
+	U_BYTE nData[MODEMSIM_FRAME_MAX];
+} MODEM_OUT_FRAME;
+
+typedef struct
+{
+	MODEMSIM_SIDE eSide;
+	MODEM_STATE eState;
+	U_INT32 nStateTick;
+	U_INT32 nLastHostByte;
+	U_INT32 nLastBanner;
+	MODEM_PARAMETERS Working;
+	MODEM_PARAMETERS Saved;
+	BOOL bJoined;
+	U_INT32 nSequence;
+	MODEMSIM_DECODER Decoder;
+	MODEM_OUT_FRAME Out[OUT_QUEUE_FRAMES];
+	U_INT32 nOutHead;
+	U_INT32 nOutTail;
+	U_INT32 nNextOut;
+	U_INT32 nBoots;
+	U_INT32 nRequests;
+	U_INT32 nUnknown;
+	U_INT32 nTxAccepted;
+	U_INT32 nTxRefused;
+	U_INT32 nTxDelivered;
+	U_INT32 nTxFailed;
+	U_INT32 nRxIndications;
+	U_INT32 nOutDropped;
+} MODEMSIM_MODEM;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static MODEMSIM_MODEM m_Modems[MODEMSIM_SIDES];
+
+static U_INT32 m_nBootTicks;
+static U_INT32 m_nResetQuietTicks;
+static U_INT32 m_nHostLostTicks;
+static U_INT32 m_nJoinTicks;
+static U_INT32 m_nFrameGapTicks;
+static U_INT32 m_nUartBaud;
+// both modems online since, 0 while they are not
+static U_INT32 m_nBothOnlineTick;
+
+// what the boards program, a fresh modem has neither
+static const U_BYTE m_sControllerSerial[MODEM_SN_LENGTH] = {0xAA, 0x55};
+static const U_BYTE m_sStationSerial[MODEM_SN_LENGTH] = {0x69, 0x96};
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void modemSim_Send(MODEMSIM_MODEM *pModem, U_BYTE nType, U_BYTE nOpCode,
+                          const U_BYTE *pData, U_INT16 nLength);
+static void modemSim_Boot(MODEMSIM_MODEM *pModem);
+static void modemSim_Leave(MODEMSIM_MODEM *pModem);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static MODEMSIM_MODEM *modemSim_Other(MODEMSIM_MODEM *pModem)
+{
+	return &m_Modems[(pModem->eSide == MODEMSIM_UPHOLE) ? MODEMSIM_DOWNHOLE : MODEMSIM_UPHOLE];
+}
+
+/*******************************************************************************
+*       @details
+*   A configured modem starts with what its board would have saved, the
+*   uphole the controller and the downhole a station.
+*******************************************************************************/
+void ModemSim_ModemInitialize(MODEMSIM_SIDE eSide, BOOL bConfigured)
+{
+	MODEMSIM_MODEM *pModem = &m_Modems[eSide];
+
+	m_nBootTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_BOOT_MS", 100);
+	m_nResetQuietTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_RESET_QUIET_MS", 2000);
+	m_nHostLostTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_HOST_LOST_MS", 30000);
+	m_nJoinTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_JOIN_MS", 1000);
+	m_nFrameGapTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_FRAME_GAP_MS", 10);
+	m_nUartBaud = (U_INT32)ModemSim_GetSetting("MODEMSIM_UART_BAUD", 38400);
+
+	memset(pModem, 0, sizeof(*pModem));
+	pModem->eSide = eSide;
+	if (bConfigured)
+	{
+		pModem->Saved.nMode = (eSide == MODEMSIM_UPHOLE) ? MODEMSIM_MODE_CONTROLLER : MODEMSIM_MODE_STATION;
+		memcpy(pModem->Saved.sSerial, (eSide == MODEMSIM_UPHOLE) ? m_sControllerSerial : m_sStationSerial,
+		       MODEM_SN_LENGTH);
+	}
+	else
+	{
+		// the factory mode is neither, so the board has to set it
+		pModem->Saved.nMode = 0x0001;
+	}
+	modemSim_Boot(pModem);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_Boot(MODEMSIM_MODEM *pModem)
+{
+	modemSim_Leave(pModem);
+	pModem->eState = MODEM_BOOT;
+	pModem->nStateTick = ModemSim_GetTicks();
+	pModem->Working = pModem->Saved;
+	// whatever was on its way to the host went with the reset
+	pModem->nOutHead = pModem->nOutTail = 0;
+	pModem->nBoots++;
+}
+
+/*******************************************************************************
+*       @details
+*   Out of the network, and the packets still to go are dropped.  The other
+*   side is told the way the real network would tell it.
+*******************************************************************************/
+static void modemSim_Leave(MODEMSIM_MODEM *pModem)
+{
+	MODEMSIM_MODEM *pOther = modemSim_Other(pModem);
+	U_BYTE nStatus[CONNECTIVITY_LENGTH];
+
+	if (pModem->eState == MODEM_ONLINE)
+	{
+		pModem->eState = MODEM_OFFLINE;
+		pModem->nStateTick = ModemSim_GetTicks();
+	}
+	m_nBothOnlineTick = 0;
+	if (!pModem->bJoined)
+	{
+		return;
+	}
+	ModemSim_Log("%s modem left the network", ModemSim_SideName(pModem->eSide));
+	pModem->bJoined = FALSE;
+	pOther->bJoined = FALSE;
+	ModemSim_ChannelFlush(pModem->eSide);
+	ModemSim_ChannelFlush(pOther->eSide);
+	if (pOther->Working.nMode == MODEMSIM_MODE_CONTROLLER)
+	{
+		memset(nStatus, 0, sizeof(nStatus));
+		nStatus[0] = STATION_NODE_INDEX;
+		memcpy(&nStatus[CONNECTIVITY_SERIAL], pModem->Working.sSerial, MODEM_SN_LENGTH);
+		modemSim_Send(pOther, TYPE_INDICATION, MODEM_OPCODE_CONNECTIVITY_STATUS, nStatus, sizeof(nStatus));
+	}
+	else
+	{
+		// a station without its controller drops off line
+		modemSim_Send(pOther, TYPE_INDICATION, MODEM_OPCODE_DISCONNECTED_FROM_NC, NULL, 0);
+		pOther->eState = MODEM_OFFLINE;
+		pOther->nStateTick = ModemSim_GetTicks();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   One controller and one station, both online, make a network.
+*******************************************************************************/
+static void modemSim_Join(void)
+{
+	MODEMSIM_MODEM *pController = &m_Modems[MODEMSIM_UPHOLE];
+	MODEMSIM_MODEM *pStation = &m_Modems[MODEMSIM_DOWNHOLE];
+	U_BYTE nStatus[CONNECTIVITY_LENGTH];
+	U_BYTE nNetwork[2] = {(U_BYTE)NETWORK_ID, (U_BYTE)(NETWORK_ID >> 8)};
+
+	if (pController->Working.nMode != MODEMSIM_MODE_CONTROLLER)
+	{
+		pController = &m_Modems[MODEMSIM_DOWNHOLE];
+		pStation = &m_Modems[MODEMSIM_UPHOLE];
+	}
+	if (pController->bJoined || (pController->eState != MODEM_ONLINE) || (pStation->eState != MODEM_ONLINE) ||
+	    (pController->Working.nMode != MODEMSIM_MODE_CONTROLLER) ||
+	    (pStation->Working.nMode != MODEMSIM_MODE_STATION))
+	{
+		if (!pController->bJoined)
+		{
+			m_nBothOnlineTick = 0;
+		}
+		return;
+	}
+	if (m_nBothOnlineTick == 0)
+	{
+		m_nBothOnlineTick = ModemSim_GetTicks();
+	}
+	if ((ModemSim_GetTicks() - m_nBothOnlineTick) < m_nJoinTicks)
+	{
+		return;
+	}
+	pController->bJoined = TRUE;
+	pStation->bJoined = TRUE;
+	ModemSim_Log("%s modem joined the %s controller", ModemSim_SideName(pStation->eSide),
+	             ModemSim_SideName(pController->eSide));
+	memset(nStatus, 0, sizeof(nStatus));
+	nStatus[0] = STATION_NODE_INDEX;
+	memcpy(&nStatus[CONNECTIVITY_SERIAL], pStation->Working.sSerial, MODEM_SN_LENGTH);
+	nStatus[CONNECTIVITY_CONNECTED] = 1;
+	modemSim_Send(pController, TYPE_INDICATION, MODEM_OPCODE_CONNECTIVITY_STATUS, nStatus, sizeof(nStatus));
+	modemSim_Send(pStation, TYPE_INDICATION, MODEM_OPCODE_NET_ID_ASSIGNED, nNetwork, sizeof(nNetwork));
+	modemSim_Send(pStation, TYPE_INDICATION, MODEM_OPCODE_CONNECTED_TO_NC, NULL, 0);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_Send(MODEMSIM_MODEM *pModem, U_BYTE nType, U_BYTE nOpCode,
+                          const U_BYTE *pData, U_INT16 nLength)
+{
+	U_INT32 nNext = (pModem->nOutHead + 1) % OUT_QUEUE_FRAMES;
+	MODEM_OUT_FRAME *pOut = &pModem->Out[pModem->nOutHead];
+
+	if (nNext == pModem->nOutTail)
+	{
+		pModem->nOutDropped++;
+		return;
+	}
+	pOut->nLength = ModemSim_EncodeFrame(pOut->nData, nType, nOpCode, pData, nLength);
+	pModem->nOutHead = nNext;
+}
+
+/*******************************************************************************
+*       @details
+*   The parameters the boards use, table 6 index 0x31 the operation mode and
+*   table 5 index 0xBAAB the serial number.  Any other table 6 parameter
+*   reads as zero.
+*******************************************************************************/
+static void modemSim_GetParameter(MODEMSIM_MODEM *pModem, const MODEMSIM_FRAME *pFrame)
+{
+	U_BYTE nReply[1 + MODEM_SN_LENGTH];
+	U_INT16 nIndex;
+	U_INT16 nCount;
+
+	memset(nReply, 0, sizeof(nReply));
+	if (pFrame->nLength < sizeof(CONFIG_PARAM_STRUCT))
+	{
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, 1);
+		return;
+	}
+	nIndex = (U_INT16)(pFrame->nData[1] | (pFrame->nData[2] << 8));
+	nCount = (U_INT16)(pFrame->nData[3] | (pFrame->nData[4] << 8));
+	nReply[0] = COMMAND_SUCCESS;
+	if ((pFrame->nData[0] == TABLE_SERIAL_NUMBER) && (nIndex == SERIAL_NUMBER_INDEX) &&
+	    (nCount == MODEM_SN_LENGTH))
+	{
+		memcpy(&nReply[1], pModem->Working.sSerial, MODEM_SN_LENGTH);
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, 1 + MODEM_SN_LENGTH);
+	}
+	else if ((pFrame->nData[0] == TABLE_CONFIG_PARAMETER) && (nCount <= 2))
+	{
+		if (nIndex == MODEM_CONFIG_OPERATION_MODE)
+		{
+			nReply[1] = (U_BYTE)pModem->Working.nMode;
+			nReply[2] = (U_BYTE)(pModem->Working.nMode >> 8);
+		}
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, 3);
+	}
+	else
+	{
+		nReply[0] = COMMAND_FAILED;
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, 1);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemSim_SetParameter(MODEMSIM_MODEM *pModem, const MODEMSIM_FRAME *pFrame)
+{
+	U_BYTE nStatus = COMMAND_FAILED;
+	U_INT16 nIndex;
+
+	if (pFrame->nLength >= 3)
+	{
+		nIndex = (U_INT16)(pFrame->nData[1] | (pFrame->nData[2] << 8));
+		if ((pFrame->nData[0] == TABLE_SERIAL_NUMBER) && (nIndex == SERIAL_NUMBER_INDEX) &&
+		    (pFrame->nLength == (3 + MODEM_SN_LENGTH)))
+		{
+			memcpy(pModem->Working.sSerial, &pFrame->nData[3], MODEM_SN_LENGTH);
+			nStatus = COMMAND_SUCCESS;
+		}
+		else if ((pFrame->nData[0] == TABLE_CONFIG_PARAMETER) && (pFrame->nLength == 5))
+		{
+			if (nIndex == MODEM_CONFIG_OPERATION_MODE)
+			{
+				pModem->Working.nMode = (U_INT16)(pFrame->nData[3] | (pFrame->nData[4] << 8));
+			}
+			nStatus = COMMAND_SUCCESS;
+		}
+	}
+	modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, &nStatus, 1);
+}
+
+/*******************************************************************************
+*       @details
+*   The controller's database holds the station at STATION_NODE_INDEX.
+*******************************************************************************/
+static void modemSim_GetNodeInfo(MODEMSIM_MODEM *pModem, const MODEMSIM_FRAME *pFrame)
+{
+	MODEMSIM_MODEM *pOther = modemSim_Other(pModem);
+	U_BYTE nReply[NODE_INFO_LENGTH];
+	U_INT16 nNode;
+
+	memset(nReply, 0, sizeof(nReply));
+	if ((pFrame->nLength < 3) || (pModem->Working.nMode != MODEMSIM_MODE_CONTROLLER))
+	{
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, 1);
+		return;
+	}
+	nNode = (U_INT16)(pFrame->nData[1] | (pFrame->nData[2] << 8));
+	nReply[0] = COMMAND_SUCCESS;
+	nReply[NODE_INFO_INDEX] = pFrame->nData[1];
+	nReply[NODE_INFO_INDEX + 1] = pFrame->nData[2];
+	if (nNode == STATION_NODE_INDEX)
+	{
+		memcpy(&nReply[NODE_INFO_SERIAL], pOther->Working.sSerial, MODEM_SN_LENGTH);
+		nReply[NODE_INFO_CONNECTED] = pModem->bJoined ? 1 : 0;
+	}
+	modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, sizeof(nReply));
+}
+
+/*******************************************************************************
+*       @details
+*   Header, then the payload.  The response says the packet was taken, and
+*   a second one later says whether the far modem acknowledged it.
+*******************************************************************************/
+static void modemSim_TxPacket(MODEMSIM_MODEM *pModem, const MODEMSIM_FRAME *pFrame)
+{
+	MODEMSIM_PACKET packet;
+	U_BYTE nReply[2] = {COMMAND_FAILED, TX_ACCEPTED};
+
+	if ((pModem->eState == MODEM_ONLINE) && (pFrame->nLength > MODEMSIM_TX_HEADER_LENGTH))
+	{
+		memset(&packet, 0, sizeof(packet));
+		packet.eFrom = pModem->eSide;
+		packet.nSequence = ++pModem->nSequence;
+		packet.nTag = (U_INT16)(pFrame->nData[5] | (pFrame->nData[6] << 8));
+		packet.nQueued = ModemSim_GetTicks();
+		packet.nLength = pFrame->nLength - MODEMSIM_TX_HEADER_LENGTH;
+		memcpy(packet.nData, &pFrame->nData[MODEMSIM_TX_HEADER_LENGTH], packet.nLength);
+		if (ModemSim_ChannelSend(&packet))
+		{
+			nReply[0] = COMMAND_SUCCESS;
+		}
+	}
+	if (nReply[0] == COMMAND_SUCCESS)
+	{
+		pModem->nTxAccepted++;
+	}
+	else
+	{
+		pModem->nTxRefused++;
+	}
+	modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nReply, sizeof(nReply));
+}
+
+/*******************************************************************************
+*       @details
+*   A booting modem is deaf, the board waits for the banner first.
+*******************************************************************************/
+static void modemSim_Request(MODEMSIM_MODEM *pModem, const MODEMSIM_FRAME *pFrame)
+{
+	U_BYTE nStatus = COMMAND_SUCCESS;
+	U_BYTE nNetwork[2] = {(U_BYTE)NETWORK_ID, (U_BYTE)(NETWORK_ID >> 8)};
+	U_BYTE nSize[5] = {COMMAND_SUCCESS, NODE_DB_SIZE, 0, 0, 0};
+
+	if ((pFrame->nCommand != COMMAND_CONSTANT) || (pFrame->nType != TYPE_REQUEST) ||
+	    (pModem->eState == MODEM_BOOT))
+	{
+		return;
+	}
+	pModem->nRequests++;
+	switch (pFrame->nOpCode)
+	{
+	case MODEM_OPCODE_RESET:
+		modemSim_Boot(pModem);
+		break;
+	case MODEM_OPCODE_GO_ONLINE:
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, &nStatus, 1);
+		if (pModem->eState != MODEM_ONLINE)
+		{
+			pModem->eState = MODEM_ONLINE;
+			pModem->nStateTick = ModemSim_GetTicks();
+			if (pModem->Working.nMode == MODEMSIM_MODE_CONTROLLER)
+			{
+				modemSim_Send(pModem, TYPE_INDICATION, MODEM_OPCODE_NET_ID_ASSIGNED, nNetwork, sizeof(nNetwork));
+			}
+		}
+		break;
+	case MODEM_OPCODE_GO_OFFLINE:
+		modemSim_Leave(pModem);
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, &nStatus, 1);
+		break;
+	case MODEM_OPCODE_GET_DEVICE_PARAM:
+		modemSim_GetParameter(pModem, pFrame);
+		break;
+	case MODEM_OPCODE_SET_DEVICE_PARAM:
+		modemSim_SetParameter(pModem, pFrame);
+		break;
+	case MODEM_OPCODE_SAVE_DEVICE_PARAM:
+		pModem->Saved = pModem->Working;
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, &nStatus, 1);
+		break;
+	case MODEM_OPCODE_GET_DB_SIZE:
+		nSize[3] = pModem->bJoined ? STATION_NODE_INDEX + 1 : 0;
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, nSize, sizeof(nSize));
+		break;
+	case MODEM_OPCODE_GET_NODE_INFO:
+		modemSim_GetNodeInfo(pModem, pFrame);
+		break;
+	case MODEM_OPCODE_DELETE_NODE_INFO:
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, &nStatus, 1);
+		break;
+	case MODEM_OPCODE_TX_PACKET:
+		modemSim_TxPacket(pModem, pFrame);
+		break;
+	default:
+		pModem->nUnknown++;
+		nStatus = COMMAND_FAILED;
+		modemSim_Send(pModem, TYPE_RESPONSE, pFrame->nOpCode, &nStatus, 1);
+		break;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ModemReceive(MODEMSIM_SIDE eSide, const U_BYTE *pData, U_INT32 nLength)
+{
+	MODEMSIM_MODEM *pModem = &m_Modems[eSide];
+
+	if (nLength > 0)
+	{
+		pModem->nLastHostByte = ModemSim_GetTicks();
+	}
+	for (U_INT32 i = 0; i < nLength; i++)
+	{
+		if (ModemSim_DecodeByte(&pModem->Decoder, pData[i]))
+		{
+			modemSim_Request(pModem, &pModem->Decoder.Frame);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ModemTick(MODEMSIM_SIDE eSide)
+{
+	MODEMSIM_MODEM *pModem = &m_Modems[eSide];
+	U_INT32 nNow = ModemSim_GetTicks();
+	U_INT32 nQuiet = nNow - ((pModem->nLastHostByte > pModem->nLastBanner) ?
+	                         pModem->nLastHostByte : pModem->nLastBanner);
+	U_BYTE nBanner = RESET_SUCCESS;
+
+	switch (pModem->eState)
+	{
+	case MODEM_BOOT:
+		if ((nNow - pModem->nStateTick) >= m_nBootTicks)
+		{
+			pModem->eState = MODEM_OFFLINE;
+			pModem->nStateTick = nNow;
+			pModem->nLastBanner = nNow;
+			modemSim_Send(pModem, TYPE_RESPONSE, MODEM_OPCODE_RESET, &nBanner, 1);
+		}
+		break;
+	case MODEM_OFFLINE:
+		if (nQuiet >= m_nResetQuietTicks)
+		{
+			modemSim_Boot(pModem);
+		}
+		break;
+	default:
+		if ((m_nHostLostTicks != 0) && (nQuiet >= m_nHostLostTicks) &&
+		    ((nNow - pModem->nStateTick) >= m_nHostLostTicks))
+		{
+			ModemSim_Log("%s host quiet for %lu ms", ModemSim_SideName(eSide), (unsigned long)nQuiet);
+			modemSim_Leave(pModem);
+		}
+		break;
+	}
+	modemSim_Join();
+
+	if ((pModem->nOutTail != pModem->nOutHead) && ((INT32)(nNow - pModem->nNextOut) >= 0))
+	{
+		MODEM_OUT_FRAME *pOut = &pModem->Out[pModem->nOutTail];
+
+		ModemSim_HostWrite(eSide, pOut->nData, pOut->nLength);
+		pModem->nOutTail = (pModem->nOutTail + 1) % OUT_QUEUE_FRAMES;
+		// the frame takes its own time on the line, then the gap
+		pModem->nNextOut = nNow + m_nFrameGapTicks + ((pOut->nLength * 10000u) / m_nUartBaud);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL ModemSim_ModemIsJoined(MODEMSIM_SIDE eSide)
+{
+	return m_Modems[eSide].bJoined;
+}
+
+/*******************************************************************************
+*       @details
+*   The indication header has the source address at the start and the tag
+*   after it, the boards only use what follows the header.
+*******************************************************************************/
+void ModemSim_ModemDeliver(MODEMSIM_SIDE eSide, const MODEMSIM_PACKET *pPacket)
+{
+	MODEMSIM_MODEM *pModem = &m_Modems[eSide];
+	U_BYTE nIndication[MODEMSIM_RX_HEADER_LENGTH + MODEM_MESSAGE_BUFFER_SIZE];
+	U_INT16 nSource = (pPacket->eFrom == MODEMSIM_UPHOLE) ? 0 : STATION_NODE_INDEX;
+	U_INT16 nLength = pPacket->nLength;
+
+	if (nLength > (MODEM_MESSAGE_BUFFER_SIZE - MODEMSIM_RX_HEADER_LENGTH))
+	{
+		nLength = MODEM_MESSAGE_BUFFER_SIZE - MODEMSIM_RX_HEADER_LENGTH;
+	}
+	memset(nIndication, 0, MODEMSIM_RX_HEADER_LENGTH);
+	nIndication[0] = (U_BYTE)nSource;
+	nIndication[1] = (U_BYTE)(nSource >> 8);
+	nIndication[2] = (U_BYTE)pPacket->nTag;
+	nIndication[3] = (U_BYTE)(pPacket->nTag >> 8);
+	memcpy(&nIndication[MODEMSIM_RX_HEADER_LENGTH], pPacket->nData, nLength);
+	pModem->nRxIndications++;
+	modemSim_Send(pModem, TYPE_INDICATION, MODEM_OPCODE_RX_PACKET, nIndication,
+	              (U_INT16)(MODEMSIM_RX_HEADER_LENGTH + nLength));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ModemSent(MODEMSIM_SIDE eSide, const MODEMSIM_PACKET *pPacket, BOOL bAcked)
+{
+	MODEMSIM_MODEM *pModem = &m_Modems[eSide];
+	U_BYTE nReply[2] = {bAcked ? COMMAND_SUCCESS : COMMAND_FAILED, TX_DELIVERED};
+
+	(void)pPacket;
+	if (bAcked)
+	{
+		pModem->nTxDelivered++;
+	}
+	else
+	{
+		pModem->nTxFailed++;
+	}
+	modemSim_Send(pModem, TYPE_RESPONSE, MODEM_OPCODE_TX_PACKET, nReply, sizeof(nReply));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_ModemReport(MODEMSIM_SIDE eSide)
+{
+	MODEMSIM_MODEM *pModem = &m_Modems[eSide];
+	static const char *pszStates[] = {"booting", "offline", "online"};
+
+	ModemSim_Log("%s modem: %s%s, mode %u, %lu boots, %lu requests, %lu unknown, %lu bad frames",
+	             ModemSim_SideName(eSide), pszStates[pModem->eState], pModem->bJoined ? " joined" : "",
+	             (unsigned)pModem->Working.nMode, (unsigned long)pModem->nBoots,
+	             (unsigned long)pModem->nRequests, (unsigned long)pModem->nUnknown,
+	             (unsigned long)pModem->Decoder.nErrors);
+	ModemSim_Log("%s modem: tx %lu taken %lu refused %lu acked %lu failed, rx %lu, %lu frames to host dropped",
+	             ModemSim_SideName(eSide), (unsigned long)pModem->nTxAccepted,
+	             (unsigned long)pModem->nTxRefused, (unsigned long)pModem->nTxDelivered,
+	             (unsigned long)pModem->nTxFailed, (unsigned long)pModem->nRxIndications,
+	             (unsigned long)pModem->nOutDropped);
+}
@@ -0,0 +1,297 @@
+/*******************************************************************************
+*       @brief      Built-in uphole host.  Takes its modem on line and, once
+*                   the downhole has joined, asks it for a survey at a fixed
+*                   rate and times each answer.
+*       @file       Downhole/HostSim/ModemSim/ModemSim_Poller.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// There is no host build of the UpHole, so this stands in for it when
+// MODEMSIM_UPHOLE is "poll".  A request is the TargetProtocol frame of the
+// command with no data, the answer is the first frame back that starts with
+// the same command.  The round trip runs from the TX_PACKET request to the
+// RX_PACKET indication, both on the uphole serial line, so it includes the
+// downhole firmware and both host interfaces as well as the powerline.
+//
+// Settings (environment):
+//  MODEMSIM_POLL_MS        time between requests, default 1000
+//  MODEMSIM_POLL_COMMAND   TargetProtocol command asked for, default 0, the
+//                          full data set
+//  MODEMSIM_POLL_TIMEOUT_MS  request given up on, default 5000
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "ModemSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the uphole asks its modem about the network this often
+#define HEARTBEAT_MS            20000
+
+// CONNECTIVITY_STATUS indication, the connected flag
+#define CONNECTIVITY_CONNECTED  18
+
+typedef enum
+{
+	POLLER_WAIT_BANNER,
+	POLLER_GO_ONLINE,
+	POLLER_ONLINE
+} POLLER_STATE;
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	POLLER_STATE eState;
+	MODEMSIM_DECODER Decoder;
+	BOOL bConnected;
+	BOOL bWaiting;
+	U_INT32 nSent;
+	U_INT32 nNextPoll;
+	U_INT32 nNextHeartbeat;
+	U_INT32 nTransaction;
+	U_INT32 nRequests;
+	U_INT32 nAnswers;
+	U_INT32 nTimeouts;
+	U_INT32 nBadAnswers;
+	U_INT32 nOther;
+	U_INT32 nTxFailed;
+	U_INT32 nBytes;
+	U_INT32 nRoundTripSum;
+	U_INT32 nRoundTripMin;
+	U_INT32 nRoundTripMax;
+	U_INT32 nFirstRequest;
+	U_INT32 nLastAnswer;
+} MODEMSIM_POLLER;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static MODEMSIM_POLLER m_Poller;
+
+static U_INT32 m_nPollTicks;
+static U_INT32 m_nTimeoutTicks;
+static U_BYTE m_nCommand;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_PollerInitialize(void)
+{
+	memset(&m_Poller, 0, sizeof(m_Poller));
+	m_Poller.nRoundTripMin = 0xFFFFFFFFul;
+	m_nPollTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_POLL_MS", 1000);
+	m_nTimeoutTicks = (U_INT32)ModemSim_GetSetting("MODEMSIM_POLL_TIMEOUT_MS", 5000);
+	m_nCommand = (U_BYTE)ModemSim_GetSetting("MODEMSIM_POLL_COMMAND", 0);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void poller_Request(U_BYTE nOpCode, const U_BYTE *pData, U_INT16 nLength)
+{
+	U_BYTE nFrame[MODEMSIM_FRAME_MAX];
+	U_INT32 nFrameLength = ModemSim_EncodeFrame(nFrame, TYPE_REQUEST, nOpCode, pData, nLength);
+
+	ModemSim_ModemReceive(MODEMSIM_UPHOLE, nFrame, nFrameLength);
+}
+
+/*******************************************************************************
+*       @details
+*   The header is the one the UpHole sends, acknowledged, to node 1.
+*******************************************************************************/
+static void poller_SendSurveyRequest(void)
+{
+	MODEMSIM_POLLER *pPoller = &m_Poller;
+	U_BYTE nPacket[MODEMSIM_TX_HEADER_LENGTH + 3] = {1, 0, 1, 1, 7, 0, 0, 0, 0, 1, 0};
+
+	pPoller->nTransaction++;
+	nPacket[11] = (U_BYTE)pPoller->nTransaction;
+	nPacket[12] = (U_BYTE)(pPoller->nTransaction >> 8);
+	nPacket[13] = (U_BYTE)(pPoller->nTransaction >> 16);
+	nPacket[14] = (U_BYTE)(pPoller->nTransaction >> 24);
+	// the command, no data, and the checksum of no data
+	nPacket[MODEMSIM_TX_HEADER_LENGTH] = m_nCommand;
+	nPacket[MODEMSIM_TX_HEADER_LENGTH + 1] = 0;
+	nPacket[MODEMSIM_TX_HEADER_LENGTH + 2] = 0xFF;
+	poller_Request(MODEM_OPCODE_TX_PACKET, nPacket, sizeof(nPacket));
+	if (pPoller->nRequests++ == 0)
+	{
+		pPoller->nFirstRequest = ModemSim_GetTicks();
+	}
+	pPoller->bWaiting = TRUE;
+	pPoller->nSent = ModemSim_GetTicks();
+}
+
+/*******************************************************************************
+*       @details
+*   Command, byte count, the data and the inverted sum of the data.
+*******************************************************************************/
+static void poller_Answer(const U_BYTE *pData, U_INT32 nLength)
+{
+	MODEMSIM_POLLER *pPoller = &m_Poller;
+	U_INT32 nRoundTrip = ModemSim_GetTicks() - pPoller->nSent;
+	U_BYTE nSum = 0;
+
+	if ((nLength < 3) || (pData[0] != m_nCommand) || !pPoller->bWaiting)
+	{
+		pPoller->nOther++;
+		return;
+	}
+	if (nLength < (3u + pData[1]))
+	{
+		pPoller->nBadAnswers++;
+		return;
+	}
+	for (U_INT32 i = 0; i < pData[1]; i++)
+	{
+		nSum += pData[2 + i];
+	}
+	if ((U_BYTE)~nSum != pData[2 + pData[1]])
+	{
+		pPoller->nBadAnswers++;
+		return;
+	}
+	pPoller->bWaiting = FALSE;
+	pPoller->nAnswers++;
+	pPoller->nBytes += nLength;
+	pPoller->nRoundTripSum += nRoundTrip;
+	pPoller->nRoundTripMin = (nRoundTrip < pPoller->nRoundTripMin) ? nRoundTrip : pPoller->nRoundTripMin;
+	pPoller->nRoundTripMax = (nRoundTrip > pPoller->nRoundTripMax) ? nRoundTrip : pPoller->nRoundTripMax;
+	pPoller->nLastAnswer = ModemSim_GetTicks();
+}
+
+/*******************************************************************************
+*       @details
+*   A banner at any time means the modem rebooted and is off line again.
+*******************************************************************************/
+static void poller_Frame(const MODEMSIM_FRAME *pFrame)
+{
+	MODEMSIM_POLLER *pPoller = &m_Poller;
+
+	if ((pFrame->nType == TYPE_RESPONSE) && (pFrame->nOpCode == MODEM_OPCODE_RESET))
+	{
+		ModemSim_Log("poller: modem reset, going on line");
+		pPoller->eState = POLLER_GO_ONLINE;
+		pPoller->bConnected = FALSE;
+		poller_Request(MODEM_OPCODE_GO_ONLINE, NULL, 0);
+		return;
+	}
+	if (pFrame->nType == TYPE_RESPONSE)
+	{
+		if ((pFrame->nOpCode == MODEM_OPCODE_GO_ONLINE) && (pPoller->eState == POLLER_GO_ONLINE))
+		{
+			pPoller->eState = POLLER_ONLINE;
+			pPoller->nNextHeartbeat = ModemSim_GetTicks() + HEARTBEAT_MS;
+		}
+		else if ((pFrame->nOpCode == MODEM_OPCODE_TX_PACKET) && (pFrame->nLength >= 2) &&
+		         (pFrame->nData[0] != COMMAND_SUCCESS))
+		{
+			pPoller->nTxFailed++;
+		}
+		return;
+	}
+	switch (pFrame->nOpCode)
+	{
+	case MODEM_OPCODE_CONNECTIVITY_STATUS:
+		if (pFrame->nLength > CONNECTIVITY_CONNECTED)
+		{
+			pPoller->bConnected = (pFrame->nData[CONNECTIVITY_CONNECTED] != 0);
+			ModemSim_Log("poller: downhole %s", pPoller->bConnected ? "connected" : "disconnected");
+			pPoller->nNextPoll = ModemSim_GetTicks();
+		}
+		break;
+	case MODEM_OPCODE_RX_PACKET:
+		if (pFrame->nLength > MODEMSIM_RX_HEADER_LENGTH)
+		{
+			poller_Answer(&pFrame->nData[MODEMSIM_RX_HEADER_LENGTH], pFrame->nLength - MODEMSIM_RX_HEADER_LENGTH);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_PollerReceive(const U_BYTE *pData, U_INT32 nLength)
+{
+	for (U_INT32 i = 0; i < nLength; i++)
+	{
+		if (ModemSim_DecodeByte(&m_Poller.Decoder, pData[i]))
+		{
+			poller_Frame(&m_Poller.Decoder.Frame);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   A request goes once the last was answered or given up on, no sooner
+*   than MODEMSIM_POLL_MS after the one before.
+*******************************************************************************/
+void ModemSim_PollerTick(void)
+{
+	MODEMSIM_POLLER *pPoller = &m_Poller;
+	U_INT32 nNow = ModemSim_GetTicks();
+
+	if (pPoller->eState != POLLER_ONLINE)
+	{
+		return;
+	}
+	if ((INT32)(nNow - pPoller->nNextHeartbeat) >= 0)
+	{
+		pPoller->nNextHeartbeat = nNow + HEARTBEAT_MS;
+		poller_Request(MODEM_OPCODE_GET_DB_SIZE, NULL, 0);
+	}
+	if (pPoller->bWaiting && ((nNow - pPoller->nSent) >= m_nTimeoutTicks))
+	{
+		pPoller->bWaiting = FALSE;
+		pPoller->nTimeouts++;
+	}
+	if (pPoller->bConnected && !pPoller->bWaiting && ((INT32)(nNow - pPoller->nNextPoll) >= 0))
+	{
+		pPoller->nNextPoll = nNow + m_nPollTicks;
+		poller_SendSurveyRequest();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void ModemSim_PollerReport(void)
+{
+	MODEMSIM_POLLER *pPoller = &m_Poller;
+	U_INT32 nSpan = pPoller->nLastAnswer - pPoller->nFirstRequest;
+
+	ModemSim_Log("poller: %lu requests, %lu answered, %lu timed out, %lu bad, %lu other, %lu not delivered",
+	             (unsigned long)pPoller->nRequests, (unsigned long)pPoller->nAnswers,
+	             (unsigned long)pPoller->nTimeouts, (unsigned long)pPoller->nBadAnswers,
+	             (unsigned long)pPoller->nOther, (unsigned long)pPoller->nTxFailed);
+	if (pPoller->nAnswers == 0)
+	{
+		return;
+	}
+	ModemSim_Log("poller: round trip min %lu avg %lu max %lu ms, %.2f answers/s, %.0f bit/s of answers",
+	             (unsigned long)pPoller->nRoundTripMin,
+	             (unsigned long)(pPoller->nRoundTripSum / pPoller->nAnswers),
+	             (unsigned long)pPoller->nRoundTripMax,
+	             (nSpan > 0) ? (1000.0 * pPoller->nAnswers / nSpan) : 0.0,
+	             (nSpan > 0) ? (8000.0 * pPoller->nBytes / nSpan) : 0.0);
+}
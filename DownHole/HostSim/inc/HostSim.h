@@ -0,0 +1,162 @@
+/*******************************************************************************
+*       @brief      Public interface of the host (Linux) peripheral simulation
+*                   that lets the DownHole firmware run as a native process.
+*       @file       Downhole/HostSim/inc/HostSim.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// How it works..
+// The peripheral register blocks (APB/AHB, the Cortex-M private peripheral
+// bus, internal flash and the system memory page) are mapped at their real
+// addresses, so the firmware and the ST peripheral library run unmodified and
+// read and write ordinary memory.  A 1 ms interval timer plays the part of
+// the hardware: every tick it advances the peripheral models (USART + DMA,
+// SPI DataFlash, ADC, TIM ETR counter, RTC, IWDG, RCC ready flags) and then
+// delivers pending interrupts the way the NVIC would, honouring ISER,
+// priorities, PRIMASK and BASEPRI.  Interrupt handlers run in signal context,
+// so they preempt the superloop exactly like the real exceptions do.
+//
+// The few register side effects that cannot be seen from plain memory
+// (SPI data register write, GPIO set/reset, write-zero-to-clear status bits)
+// are caught by linking with --wrap on the matching ST library functions.
+//
+// The build links non-PIE so that the addresses of the firmware's static DMA
+// buffers fit in the 32 bit DMA address registers.
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stm32f4xx.h>
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// Period of the simulated hardware clock, everything is stepped at this rate.
+#define HOSTSIM_TICK_MICRO_SECONDS	1000
+
+// Causes recorded in RCC->CSR after a simulated reset.
+typedef enum
+{
+	HOSTSIM_RESET_POWER_ON,
+	HOSTSIM_RESET_SOFTWARE,
+	HOSTSIM_RESET_WATCHDOG
+} HOSTSIM_RESET_CAUSE;
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// A device model wired straight onto a simulated USART instead of a host
+// file descriptor.
+typedef struct
+{
+	// Called with the bytes the firmware transmitted during this tick.
+	void (*pfReceive)(const U_BYTE *pData, U_INT32 nLength);
+	// Fills at most nMax bytes for the firmware to receive, returns the count.
+	U_INT32 (*pfTransmit)(U_BYTE *pData, U_INT32 nMax);
+	// Called every tick so the device can run its own timers.
+	void (*pfTick)(void);
+	// Called at exit to print the device statistics.
+	void (*pfReport)(void);
+} HOSTSIM_SERIAL_DEVICE;
+
+// Tenfoot directional sensor model, see HostSim_Compass.c.
+extern const HOSTSIM_SERIAL_DEVICE HostSim_TenfootCompass;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    ///@brief  Milliseconds of simulated hardware time since power on.
+    U_INT32 HostSim_GetTicks(void);
+
+    ///@brief  Mark an interrupt pending, it is delivered once enabled and
+    ///        unmasked.
+    void HostSim_SetPending(IRQn_Type eIRQ);
+
+    ///@brief  Restart the firmware image the way a reset would, the DataFlash
+    ///        and backup SRAM contents survive.
+    void HostSim_SystemReset(HOSTSIM_RESET_CAUSE eCause);
+
+    ///@brief  Read an integer setting from the environment.
+    INT32 HostSim_GetSetting(const char *pszName, INT32 nDefault);
+
+    ///@brief  Read a real setting from the environment.
+    REAL64 HostSim_GetSettingReal(const char *pszName, REAL64 fDefault);
+
+    ///@brief  Read a string setting from the environment.
+    const char *HostSim_GetSettingText(const char *pszName, const char *pszDefault);
+
+    ///@brief  Write a line to stderr, safe to call from the tick.
+    void HostSim_Log(const char *pszFormat, ...) __attribute__((format(printf, 1, 2)));
+
+    ///@brief  Connect a USART to "pty", "null", a host file/device path or a
+    ///        built-in device model.
+    void HostSim_UsartAttach(USART_TypeDef *pUSART, const char *pszName,
+                             const char *pszEndpoint, const HOSTSIM_SERIAL_DEVICE *pDevice);
+
+    ///@brief  Connect an AT45DB321 DataFlash to an SPI bus and chip select,
+    ///        backed by an image file on the host.
+    void HostSim_SpiAttachDataFlash(SPI_TypeDef *pSPI, GPIO_TypeDef *pCSPort,
+                                    U_INT16 nCSPin, const char *pszImage);
+
+    ///@brief  Set the voltage seen on an ADC input, in raw counts.
+    void HostSim_AnalogSetInput(ADC_TypeDef *pADC, U_BYTE nChannel, U_INT16 nCounts);
+
+    ///@brief  Add normally distributed noise to every conversion, counts rms.
+    void HostSim_AnalogSetNoise(ADC_TypeDef *pADC, U_INT16 nCounts);
+
+    ///@brief  Drive the external trigger input of a timer with Poisson
+    ///        distributed pulses at the given mean rate.
+    void HostSim_TimerAttachPulseSource(TIM_TypeDef *pTIM, REAL64 fCountsPerSecond);
+
+    ///@brief  Uniform random number in (0, 1], repeatable with HOSTSIM_SEED.
+    REAL64 HostSim_RandomUniform(void);
+
+    ///@brief  Normally distributed random number, zero mean and unit sigma.
+    REAL64 HostSim_RandomNormal(void);
+
+    ///@brief  The enabled DMA stream serving a peripheral data register in
+    ///        the given direction, NULL when there is none.
+    DMA_Stream_TypeDef *HostSim_DmaFindStream(volatile void *pRegister, U_INT32 nDirection);
+
+    ///@brief  Move one item through a stream, FALSE once it has stopped.
+    BOOL HostSim_DmaWriteItem(DMA_Stream_TypeDef *pStream, U_INT32 nValue);
+    BOOL HostSim_DmaReadItem(DMA_Stream_TypeDef *pStream, U_INT32 *pValue);
+
+    ///@brief  Follow a chip select line after a GPIO output change.
+    void HostSim_SpiChipSelectChanged(GPIO_TypeDef *pGPIO);
+
+    ///@brief  Board specific wiring, provided by HostSim_Board.c.
+    void HostSim_BoardInitialize(void);
+
+    // Peripheral model steps, called from the tick in this order.
+    void HostSim_SystemStep(void);
+    void HostSim_GpioStep(void);
+    void HostSim_DmaStep(void);
+    void HostSim_UsartStep(void);
+    void HostSim_SpiStep(void);
+    void HostSim_AnalogStep(void);
+
+    // Exit reports.
+    void HostSim_UsartReport(void);
+    void HostSim_SpiReport(void);
+    void HostSim_FlashReport(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // HOST_SIM_H
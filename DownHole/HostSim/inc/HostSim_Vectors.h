@@ -0,0 +1,94 @@
+/*******************************************************************************
+*       @brief      STM32F40x/41x interrupt vector list, IRQ 0 to 81, in NVIC
+*                   order.  Include after defining HOSTSIM_VECTOR(name).
+*       @file       Downhole/HostSim/inc/HostSim_Vectors.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// No include guard, this file is expanded once per use.
+
+HOSTSIM_VECTOR(WWDG)
+HOSTSIM_VECTOR(PVD)
+HOSTSIM_VECTOR(TAMP_STAMP)
+HOSTSIM_VECTOR(RTC_WKUP)
+HOSTSIM_VECTOR(FLASH)
+HOSTSIM_VECTOR(RCC)
+HOSTSIM_VECTOR(EXTI0)
+HOSTSIM_VECTOR(EXTI1)
+HOSTSIM_VECTOR(EXTI2)
+HOSTSIM_VECTOR(EXTI3)
+HOSTSIM_VECTOR(EXTI4)
+HOSTSIM_VECTOR(DMA1_Stream0)
+HOSTSIM_VECTOR(DMA1_Stream1)
+HOSTSIM_VECTOR(DMA1_Stream2)
+HOSTSIM_VECTOR(DMA1_Stream3)
+HOSTSIM_VECTOR(DMA1_Stream4)
+HOSTSIM_VECTOR(DMA1_Stream5)
+HOSTSIM_VECTOR(DMA1_Stream6)
+HOSTSIM_VECTOR(ADC)
+HOSTSIM_VECTOR(CAN1_TX)
+HOSTSIM_VECTOR(CAN1_RX0)
+HOSTSIM_VECTOR(CAN1_RX1)
+HOSTSIM_VECTOR(CAN1_SCE)
+HOSTSIM_VECTOR(EXTI9_5)
+HOSTSIM_VECTOR(TIM1_BRK_TIM9)
+HOSTSIM_VECTOR(TIM1_UP_TIM10)
+HOSTSIM_VECTOR(TIM1_TRG_COM_TIM11)
+HOSTSIM_VECTOR(TIM1_CC)
+HOSTSIM_VECTOR(TIM2)
+HOSTSIM_VECTOR(TIM3)
+HOSTSIM_VECTOR(TIM4)
+HOSTSIM_VECTOR(I2C1_EV)
+HOSTSIM_VECTOR(I2C1_ER)
+HOSTSIM_VECTOR(I2C2_EV)
+HOSTSIM_VECTOR(I2C2_ER)
+HOSTSIM_VECTOR(SPI1)
+HOSTSIM_VECTOR(SPI2)
+HOSTSIM_VECTOR(USART1)
+HOSTSIM_VECTOR(USART2)
+HOSTSIM_VECTOR(USART3)
+HOSTSIM_VECTOR(EXTI15_10)
+HOSTSIM_VECTOR(RTC_Alarm)
+HOSTSIM_VECTOR(OTG_FS_WKUP)
+HOSTSIM_VECTOR(TIM8_BRK_TIM12)
+HOSTSIM_VECTOR(TIM8_UP_TIM13)
+HOSTSIM_VECTOR(TIM8_TRG_COM_TIM14)
+HOSTSIM_VECTOR(TIM8_CC)
+HOSTSIM_VECTOR(DMA1_Stream7)
+HOSTSIM_VECTOR(FSMC)
+HOSTSIM_VECTOR(SDIO)
+HOSTSIM_VECTOR(TIM5)
+HOSTSIM_VECTOR(SPI3)
+HOSTSIM_VECTOR(UART4)
+HOSTSIM_VECTOR(UART5)
+HOSTSIM_VECTOR(TIM6_DAC)
+HOSTSIM_VECTOR(TIM7)
+HOSTSIM_VECTOR(DMA2_Stream0)
+HOSTSIM_VECTOR(DMA2_Stream1)
+HOSTSIM_VECTOR(DMA2_Stream2)
+HOSTSIM_VECTOR(DMA2_Stream3)
+HOSTSIM_VECTOR(DMA2_Stream4)
+HOSTSIM_VECTOR(ETH)
+HOSTSIM_VECTOR(ETH_WKUP)
+HOSTSIM_VECTOR(CAN2_TX)
+HOSTSIM_VECTOR(CAN2_RX0)
+HOSTSIM_VECTOR(CAN2_RX1)
+HOSTSIM_VECTOR(CAN2_SCE)
+HOSTSIM_VECTOR(OTG_FS)
+HOSTSIM_VECTOR(DMA2_Stream5)
+HOSTSIM_VECTOR(DMA2_Stream6)
+HOSTSIM_VECTOR(DMA2_Stream7)
+HOSTSIM_VECTOR(USART6)
+HOSTSIM_VECTOR(I2C3_EV)
+HOSTSIM_VECTOR(I2C3_ER)
+HOSTSIM_VECTOR(OTG_HS_EP1_OUT)
+HOSTSIM_VECTOR(OTG_HS_EP1_IN)
+HOSTSIM_VECTOR(OTG_HS_WKUP)
+HOSTSIM_VECTOR(OTG_HS)
+HOSTSIM_VECTOR(DCMI)
+HOSTSIM_VECTOR(CRYP)
+HOSTSIM_VECTOR(HASH_RNG)
+HOSTSIM_VECTOR(FPU)
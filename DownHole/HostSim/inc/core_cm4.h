@@ -0,0 +1,87 @@
+/*******************************************************************************
+*       @brief      Host wrapper around the CMSIS Cortex-M4 core header.  The
+*                   NVIC set/clear registers are write-one-to-act on silicon,
+*                   which plain memory cannot reproduce, so the inline NVIC
+*                   helpers are redirected to the HostSim interrupt controller.
+*       @file       Downhole/HostSim/inc/core_cm4.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef HOST_SIM_CORE_CM4_H
+#define HOST_SIM_CORE_CM4_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#define NVIC_EnableIRQ          CMSIS_NVIC_EnableIRQ
+#define NVIC_DisableIRQ         CMSIS_NVIC_DisableIRQ
+#define NVIC_GetPendingIRQ      CMSIS_NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ      CMSIS_NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ    CMSIS_NVIC_ClearPendingIRQ
+#define NVIC_SystemReset        CMSIS_NVIC_SystemReset
+
+#include_next <core_cm4.h>
+
+#undef NVIC_EnableIRQ
+#undef NVIC_DisableIRQ
+#undef NVIC_GetPendingIRQ
+#undef NVIC_SetPendingIRQ
+#undef NVIC_ClearPendingIRQ
+#undef NVIC_SystemReset
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void HostSim_NvicSetEnable(IRQn_Type eIRQ, uint8_t bEnable);
+    uint32_t HostSim_NvicGetPending(IRQn_Type eIRQ);
+    void HostSim_NvicSetPending(IRQn_Type eIRQ, uint8_t bPending);
+    void HostSim_NvicSystemReset(void) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+//============================================================================//
+//      INTRINSICS                                                            //
+//============================================================================//
+
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+	HostSim_NvicSetEnable(IRQn, 1U);
+}
+
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+	HostSim_NvicSetEnable(IRQn, 0U);
+}
+
+__STATIC_INLINE uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+	return HostSim_NvicGetPending(IRQn);
+}
+
+__STATIC_INLINE void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+	HostSim_NvicSetPending(IRQn, 1U);
+}
+
+__STATIC_INLINE void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+	HostSim_NvicSetPending(IRQn, 0U);
+}
+
+__STATIC_INLINE void NVIC_SystemReset(void)
+{
+	HostSim_NvicSystemReset();
+}
+
+#endif // HOST_SIM_CORE_CM4_H
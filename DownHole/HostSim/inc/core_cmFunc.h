@@ -0,0 +1,111 @@
+/*******************************************************************************
+*       @brief      Host replacement for the CMSIS core register access
+*                   functions.  PRIMASK and BASEPRI are routed to the HostSim
+*                   interrupt controller so critical sections behave as they
+*                   do on the Cortex-M4.
+*       @file       Downhole/HostSim/inc/core_cmFunc.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef __CORE_CMFUNC_H
+#define __CORE_CMFUNC_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdint.h>
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void HostSim_EnableIrq(void);
+    void HostSim_DisableIrq(void);
+    uint32_t HostSim_GetPrimask(void);
+    uint32_t HostSim_GetBasepri(void);
+    void HostSim_SetBasepri(uint32_t nBasepri);
+    uint32_t HostSim_GetIpsr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+//============================================================================//
+//      INTRINSICS                                                            //
+//============================================================================//
+
+#define __enable_irq()          HostSim_EnableIrq()
+#define __disable_irq()         HostSim_DisableIrq()
+#define __enable_fault_irq()    HostSim_EnableIrq()
+#define __disable_fault_irq()   HostSim_DisableIrq()
+
+// IAR intrinsics used by InterruptEnabling.c
+#define __get_interrupt_state() HostSim_GetPrimask()
+#define __disable_interrupt()   HostSim_DisableIrq()
+
+__STATIC_INLINE uint32_t __get_PRIMASK(void)
+{
+	return HostSim_GetPrimask();
+}
+
+__STATIC_INLINE void __set_PRIMASK(uint32_t priMask)
+{
+	if (priMask & 1U)
+	{
+		HostSim_DisableIrq();
+	}
+	else
+	{
+		HostSim_EnableIrq();
+	}
+}
+
+__STATIC_INLINE uint32_t __get_BASEPRI(void)
+{
+	return HostSim_GetBasepri();
+}
+
+__STATIC_INLINE void __set_BASEPRI(uint32_t value)
+{
+	HostSim_SetBasepri(value & 0xFFU);
+}
+
+__STATIC_INLINE void __set_BASEPRI_MAX(uint32_t value)
+{
+	uint32_t current = HostSim_GetBasepri();
+	value &= 0xFFU;
+	if ((value != 0U) && ((current == 0U) || (value < current)))
+	{
+		HostSim_SetBasepri(value);
+	}
+}
+
+__STATIC_INLINE uint32_t __get_IPSR(void)
+{
+	return HostSim_GetIpsr();
+}
+
+// The host runs everything privileged on one stack; these registers only
+// exist so that code touching them still links.
+__STATIC_INLINE uint32_t __get_CONTROL(void)            { return 0U; }
+__STATIC_INLINE void __set_CONTROL(uint32_t control)    { (void)control; }
+__STATIC_INLINE uint32_t __get_APSR(void)               { return 0U; }
+__STATIC_INLINE uint32_t __get_xPSR(void)               { return HostSim_GetIpsr(); }
+__STATIC_INLINE uint32_t __get_PSP(void)                { return 0U; }
+__STATIC_INLINE void __set_PSP(uint32_t topOfProcStack) { (void)topOfProcStack; }
+__STATIC_INLINE uint32_t __get_MSP(void)                { return 0U; }
+__STATIC_INLINE void __set_MSP(uint32_t topOfMainStack) { (void)topOfMainStack; }
+__STATIC_INLINE uint32_t __get_FAULTMASK(void)          { return 0U; }
+__STATIC_INLINE void __set_FAULTMASK(uint32_t faultMask){ (void)faultMask; }
+__STATIC_INLINE uint32_t __get_FPSCR(void)              { return 0U; }
+__STATIC_INLINE void __set_FPSCR(uint32_t fpscr)        { (void)fpscr; }
+
+#endif // __CORE_CMFUNC_H
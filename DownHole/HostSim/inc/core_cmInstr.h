@@ -0,0 +1,116 @@
+/*******************************************************************************
+*       @brief      Host replacement for the CMSIS core instruction intrinsics.
+*                   Shadows TargetLibrary/Inc/core_cmInstr.h in the HostSim
+*                   build so core_cm4.h compiles with the native compiler.
+*       @file       Downhole/HostSim/inc/core_cmInstr.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef __CORE_CMINSTR_H
+#define __CORE_CMINSTR_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdint.h>
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    ///@brief  Park the main loop until the next simulated interrupt.
+    void HostSim_WaitForInterrupt(void);
+
+    ///@brief  Report a breakpoint instruction and stop the simulation.
+    void HostSim_Breakpoint(uint32_t nValue);
+
+#ifdef __cplusplus
+}
+#endif
+
+//============================================================================//
+//      INTRINSICS                                                            //
+//============================================================================//
+
+// Barriers only have to stop the compiler reordering around the simulated
+// interrupts, which are delivered as signals on the same thread.
+#define __NOP()     __asm volatile ("nop")
+#define __ISB()     __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __DSB()     __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __DMB()     __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __WFI()     HostSim_WaitForInterrupt()
+#define __WFE()     HostSim_WaitForInterrupt()
+#define __SEV()     ((void)0)
+#define __BKPT(v)   HostSim_Breakpoint(v)
+#define __CLREX()   ((void)0)
+
+__STATIC_INLINE uint32_t __REV(uint32_t value)
+{
+	return __builtin_bswap32(value);
+}
+
+__STATIC_INLINE uint32_t __REV16(uint32_t value)
+{
+	return ((value & 0xFF00FF00UL) >> 8) | ((value & 0x00FF00FFUL) << 8);
+}
+
+__STATIC_INLINE int32_t __REVSH(int32_t value)
+{
+	return (int16_t)__builtin_bswap16((uint16_t)value);
+}
+
+__STATIC_INLINE uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+	op2 &= 31U;
+	return (op2 == 0U) ? op1 : ((op1 >> op2) | (op1 << (32U - op2)));
+}
+
+__STATIC_INLINE uint32_t __RBIT(uint32_t value)
+{
+	uint32_t result = 0;
+	for (int i = 0; i < 32; i++)
+	{
+		result = (result << 1) | (value & 1U);
+		value >>= 1;
+	}
+	return result;
+}
+
+__STATIC_INLINE uint8_t __CLZ(uint32_t value)
+{
+	return (value == 0U) ? 32U : (uint8_t)__builtin_clz(value);
+}
+
+// Exclusive access always succeeds, there is only one bus master on the host.
+__STATIC_INLINE uint8_t  __LDREXB(volatile uint8_t *addr)  { return *addr; }
+__STATIC_INLINE uint16_t __LDREXH(volatile uint16_t *addr) { return *addr; }
+__STATIC_INLINE uint32_t __LDREXW(volatile uint32_t *addr) { return *addr; }
+__STATIC_INLINE uint32_t __STREXB(uint8_t value, volatile uint8_t *addr)    { *addr = value; return 0; }
+__STATIC_INLINE uint32_t __STREXH(uint16_t value, volatile uint16_t *addr)  { *addr = value; return 0; }
+__STATIC_INLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)  { *addr = value; return 0; }
+
+__STATIC_INLINE int32_t __SSAT_host(int32_t value, uint32_t bits)
+{
+	const int32_t max = (int32_t)((1UL << (bits - 1U)) - 1U);
+	const int32_t min = -max - 1;
+	return (value > max) ? max : ((value < min) ? min : value);
+}
+
+__STATIC_INLINE uint32_t __USAT_host(int32_t value, uint32_t bits)
+{
+	const int32_t max = (int32_t)((1UL << bits) - 1U);
+	return (value > max) ? (uint32_t)max : ((value < 0) ? 0U : (uint32_t)value);
+}
+
+#define __SSAT(value, bits)  __SSAT_host((value), (bits))
+#define __USAT(value, bits)  __USAT_host((value), (bits))
+
+#endif // __CORE_CMINSTR_H
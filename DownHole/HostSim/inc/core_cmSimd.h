@@ -0,0 +1,15 @@
+/*******************************************************************************
+*       @brief      Host replacement for the CMSIS SIMD intrinsics header.
+*                   The DownHole firmware does not use the Cortex-M4 DSP
+*                   instructions, so this only has to satisfy core_cm4.h.
+*       @file       Downhole/HostSim/inc/core_cmSimd.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef __CORE_CMSIMD_H
+#define __CORE_CMSIMD_H
+
+#endif // __CORE_CMSIMD_H
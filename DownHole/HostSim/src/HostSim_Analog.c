@@ -0,0 +1,426 @@
+/*******************************************************************************
+*       @brief      ADC and timer input models: ADC conversions of settable
+*                   channel voltages, through DMA or the data register, timer
+*                   triggered or not, timers counting the internal clock, and
+*                   random (Poisson) pulses on a timer external clock input.
+*       @file       Downhole/HostSim/src/HostSim_Analog.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <math.h>
+#include <string.h>
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define NUM_ADCS                3
+#define NUM_CHANNELS            19
+#define MAX_PULSE_SOURCES       2
+// conversions moved per tick, enough to fill any of the firmware buffers
+#define MAX_CONVERSIONS_PER_TICK 64
+// general purpose timers that can count the internal clock, TIM2 to TIM5
+#define NUM_TIMERS              4
+// CR2 external trigger enable and select, and the TIM2 TRGO select
+#define ADC_CR2_EXTEN_MASK      0x30000000ul
+#define ADC_CR2_EXTSEL_MASK     0x0F000000ul
+#define ADC_EXTSEL_T2_TRGO      0x06000000ul
+// timer CR2 master mode, TRGO on update
+#define TIM_CR2_MMS_MASK        0x0070ul
+#define TIM_CR2_MMS_UPDATE      0x0020ul
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	BOOL bRunning;
+	U_INT16 nInput[NUM_CHANNELS];
+	U_INT16 nNoise;		// counts rms added to each conversion
+	U_INT32 nConversions;
+} HOSTSIM_ADC;
+
+typedef struct
+{
+	TIM_TypeDef *pTIM;
+	REAL64 fMeanPerTick;
+	U_INT32 nPulses;
+} HOSTSIM_PULSE_SOURCE;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static HOSTSIM_ADC m_Adcs[NUM_ADCS];
+static HOSTSIM_PULSE_SOURCE m_PulseSources[MAX_PULSE_SOURCES];
+static U_INT32 m_nPulseSources;
+// update events of each internal clock timer this tick
+static U_INT32 m_nTimerUpdates[NUM_TIMERS];
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static ADC_TypeDef *hostSim_Adc(U_INT32 nIndex)
+{
+	static ADC_TypeDef *const pAdc[NUM_ADCS] = { ADC1, ADC2, ADC3 };
+	return pAdc[nIndex];
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_AnalogSetInput(ADC_TypeDef *pADC, U_BYTE nChannel, U_INT16 nCounts)
+{
+	for (U_INT32 i = 0; i < NUM_ADCS; i++)
+	{
+		if ((hostSim_Adc(i) == pADC) && (nChannel < NUM_CHANNELS))
+		{
+			m_Adcs[i].nInput[nChannel] = nCounts & 0x0FFF;
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_AnalogSetNoise(ADC_TypeDef *pADC, U_INT16 nCounts)
+{
+	for (U_INT32 i = 0; i < NUM_ADCS; i++)
+	{
+		if (hostSim_Adc(i) == pADC)
+		{
+			m_Adcs[i].nNoise = nCounts;
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT16 hostSim_AdcSample(HOSTSIM_ADC *pModel, U_BYTE nChannel)
+{
+	INT32 nValue = pModel->nInput[nChannel];
+
+	if (pModel->nNoise != 0)
+	{
+		nValue += (INT32)floor((pModel->nNoise * HostSim_RandomNormal()) + 0.5);
+		nValue = (nValue < 0) ? 0 : ((nValue > 0x0FFF) ? 0x0FFF : nValue);
+	}
+	return (U_INT16)nValue;
+}
+
+/*******************************************************************************
+*       @details
+*   Pulses in one tick.  Counting for small means, a normal approximation
+*   once the mean is large enough for it to be indistinguishable.
+*******************************************************************************/
+static U_INT32 hostSim_Poisson(REAL64 fMean)
+{
+	if (fMean <= 0.0)
+	{
+		return 0;
+	}
+	if (fMean < 30.0)
+	{
+		REAL64 fLimit = exp(-fMean), fProduct = HostSim_RandomUniform();
+		U_INT32 nCount = 0;
+
+		while (fProduct > fLimit)
+		{
+			nCount++;
+			fProduct *= HostSim_RandomUniform();
+		}
+		return nCount;
+	}
+	REAL64 fCount = floor(fMean + (sqrt(fMean) * HostSim_RandomNormal()) + 0.5);
+	return (fCount > 0.0) ? (U_INT32)fCount : 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_TimerAttachPulseSource(TIM_TypeDef *pTIM, REAL64 fCountsPerSecond)
+{
+	if (m_nPulseSources < MAX_PULSE_SOURCES)
+	{
+		m_PulseSources[m_nPulseSources].pTIM = pTIM;
+		m_PulseSources[m_nPulseSources].fMeanPerTick = fCountsPerSecond * HOSTSIM_TICK_MICRO_SECONDS / 1.0e6;
+		m_nPulseSources++;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static IRQn_Type hostSim_TimerIRQ(TIM_TypeDef *pTIM)
+{
+	return (pTIM == TIM2) ? TIM2_IRQn :
+	       (pTIM == TIM3) ? TIM3_IRQn :
+	       (pTIM == TIM4) ? TIM4_IRQn : TIM5_IRQn;
+}
+
+/*******************************************************************************
+*       @details
+*   External clock mode: each pulse on ETR counts once, the counter wraps
+*   at ARR and raises the update event.
+*******************************************************************************/
+static void hostSim_PulseStep(HOSTSIM_PULSE_SOURCE *pSource)
+{
+	TIM_TypeDef *pTIM = pSource->pTIM;
+	U_INT32 nPulses = hostSim_Poisson(pSource->fMeanPerTick);
+	U_INT32 nPeriod, nCount;
+
+	if (((pTIM->CR1 & TIM_CR1_CEN) == 0) || (nPulses == 0))
+	{
+		return;
+	}
+	pSource->nPulses += nPulses;
+	nPeriod = (pTIM->ARR & 0xFFFF) + 1;
+	nCount = (pTIM->CNT & 0xFFFF) + nPulses;
+	if (nCount >= nPeriod)
+	{
+		pTIM->SR |= TIM_SR_UIF;
+		if (pTIM->DIER & TIM_DIER_UIE)
+		{
+			HostSim_SetPending(hostSim_TimerIRQ(pTIM));
+		}
+	}
+	pTIM->CNT = nCount % nPeriod;
+}
+
+/*******************************************************************************
+*       @details
+*   A timer on its internal clock, not driven by a pulse source, counts one
+*   tick of the APB1 timer clock, twice PCLK1 when APB1 is divided down.
+*******************************************************************************/
+static void hostSim_TimerStep(U_INT32 nIndex)
+{
+	static TIM_TypeDef *const pTimers[NUM_TIMERS] = { TIM2, TIM3, TIM4, TIM5 };
+	TIM_TypeDef *pTIM = pTimers[nIndex];
+	RCC_ClocksTypeDef clocks;
+	U_INT64 nCount, nPeriod;
+	U_INT32 nClock;
+
+	m_nTimerUpdates[nIndex] = 0;
+	if (((pTIM->CR1 & TIM_CR1_CEN) == 0) || (pTIM->SMCR & (TIM_SMCR_SMS | TIM_SMCR_ECE)))
+	{
+		return;
+	}
+	RCC_GetClocksFreq(&clocks);
+	nClock = clocks.PCLK1_Frequency;
+	if (clocks.PCLK1_Frequency != clocks.HCLK_Frequency)
+	{
+		nClock *= 2;
+	}
+	nPeriod = (U_INT64)((pTIM == TIM2) || (pTIM == TIM5) ? pTIM->ARR : (pTIM->ARR & 0xFFFF)) + 1;
+	nCount = (U_INT64)pTIM->CNT + ((U_INT64)nClock * HOSTSIM_TICK_MICRO_SECONDS / 1000000ull) / ((pTIM->PSC & 0xFFFF) + 1);
+	m_nTimerUpdates[nIndex] = (U_INT32)(nCount / nPeriod);
+	pTIM->CNT = (U_INT32)(nCount % nPeriod);
+	if (m_nTimerUpdates[nIndex] != 0)
+	{
+		pTIM->SR |= TIM_SR_UIF;
+		if (pTIM->DIER & TIM_DIER_UIE)
+		{
+			HostSim_SetPending(hostSim_TimerIRQ(pTIM));
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Conversions an external trigger started this tick, only TIM2 TRGO on
+*   update is modelled.
+*******************************************************************************/
+static U_INT32 hostSim_AdcTriggers(ADC_TypeDef *pADC)
+{
+	if (((pADC->CR2 & ADC_CR2_EXTSEL_MASK) == ADC_EXTSEL_T2_TRGO) &&
+	    ((TIM2->CR2 & TIM_CR2_MMS_MASK) == TIM_CR2_MMS_UPDATE))
+	{
+		return m_nTimerUpdates[0];
+	}
+	return 0;
+}
+
+/*******************************************************************************
+*       @details
+*   Each trigger converts the first regular channel once, into the DMA when
+*   it is on, the data register otherwise.
+*******************************************************************************/
+static void hostSim_AdcTriggeredStep(U_INT32 nIndex)
+{
+	ADC_TypeDef *pADC = hostSim_Adc(nIndex);
+	HOSTSIM_ADC *pModel = &m_Adcs[nIndex];
+	DMA_Stream_TypeDef *pStream = NULL;
+	U_INT32 nTriggers = hostSim_AdcTriggers(pADC);
+	U_INT16 nValue;
+
+	if (nTriggers > MAX_CONVERSIONS_PER_TICK)
+	{
+		nTriggers = MAX_CONVERSIONS_PER_TICK;
+	}
+	if (pADC->CR2 & ADC_CR2_DMA)
+	{
+		pStream = HostSim_DmaFindStream(&pADC->DR, DMA_DIR_PeripheralToMemory);
+	}
+	for (U_INT32 i = 0; i < nTriggers; i++)
+	{
+		nValue = hostSim_AdcSample(pModel, pADC->SQR3 & 0x1F);
+		pADC->DR = nValue;
+		pADC->SR |= ADC_SR_STRT;
+		pModel->nConversions++;
+		if ((pStream == NULL) || !HostSim_DmaWriteItem(pStream, nValue))
+		{
+			pADC->SR |= ADC_SR_EOC;
+		}
+	}
+	if ((pADC->SR & ADC_SR_EOC) && (pADC->CR1 & ADC_CR1_EOCIE))
+	{
+		HostSim_SetPending(ADC_IRQn);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   A software start (or a continuous conversion already running) converts
+*   the first regular channel.
+*******************************************************************************/
+static void hostSim_AdcStep(U_INT32 nIndex)
+{
+	ADC_TypeDef *pADC = hostSim_Adc(nIndex);
+	HOSTSIM_ADC *pModel = &m_Adcs[nIndex];
+	U_INT16 nValue;
+
+	if ((pADC->CR2 & ADC_CR2_ADON) == 0)
+	{
+		pModel->bRunning = FALSE;
+		return;
+	}
+	if (((pADC->CR2 & ADC_CR2_EXTEN_MASK) != 0) && ((pADC->CR2 & ADC_CR2_SWSTART) == 0))
+	{
+		hostSim_AdcTriggeredStep(nIndex);
+		return;
+	}
+	if (pADC->CR2 & ADC_CR2_SWSTART)
+	{
+		// SWSTART is cleared by hardware as the conversion starts
+		pADC->CR2 &= ~ADC_CR2_SWSTART;
+		pADC->SR |= ADC_SR_STRT;
+		pModel->bRunning = TRUE;
+	}
+	if (!pModel->bRunning)
+	{
+		return;
+	}
+	nValue = hostSim_AdcSample(pModel, pADC->SQR3 & 0x1F);
+	if (pADC->CR2 & ADC_CR2_DMA)
+	{
+		DMA_Stream_TypeDef *pStream = HostSim_DmaFindStream(&pADC->DR, DMA_DIR_PeripheralToMemory);
+
+		for (U_INT32 i = 0; (pStream != NULL) && (i < MAX_CONVERSIONS_PER_TICK); i++)
+		{
+			U_INT32 nRemaining = pStream->NDTR;
+
+			pADC->DR = nValue;
+			pModel->nConversions++;
+			if (!HostSim_DmaWriteItem(pStream, nValue) || (nRemaining == 1))
+			{
+				// stop at the end of the buffer, the handler gets a look at it
+				break;
+			}
+		}
+		if (pStream == NULL)
+		{
+			pADC->DR = nValue;
+			pADC->SR |= ADC_SR_EOC;
+		}
+	}
+	else
+	{
+		pADC->DR = nValue;
+		pADC->SR |= ADC_SR_EOC;
+		pModel->nConversions++;
+	}
+	if ((pADC->CR2 & ADC_CR2_CONT) == 0)
+	{
+		pModel->bRunning = FALSE;
+	}
+	if ((pADC->SR & ADC_SR_EOC) && (pADC->CR1 & ADC_CR1_EOCIE))
+	{
+		HostSim_SetPending(ADC_IRQn);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_AnalogStep(void)
+{
+	for (U_INT32 i = 0; i < NUM_TIMERS; i++)
+	{
+		hostSim_TimerStep(i);
+	}
+	for (U_INT32 i = 0; i < NUM_ADCS; i++)
+	{
+		hostSim_AdcStep(i);
+	}
+	for (U_INT32 i = 0; i < m_nPulseSources; i++)
+	{
+		hostSim_PulseStep(&m_PulseSources[i]);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The ADC and timer status flags are cleared by writing zero.
+*******************************************************************************/
+void __wrap_ADC_ClearFlag(ADC_TypeDef *ADCx, uint8_t ADC_FLAG)
+{
+	ADCx->SR &= ~(U_INT32)ADC_FLAG;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_ADC_ClearITPendingBit(ADC_TypeDef *ADCx, uint16_t ADC_IT)
+{
+	ADCx->SR &= ~(U_INT32)(ADC_IT >> 8);
+}
+
+/*******************************************************************************
+*       @details
+*   Reading DR clears EOC.
+*******************************************************************************/
+uint16_t __wrap_ADC_GetConversionValue(ADC_TypeDef *ADCx)
+{
+	ADCx->SR &= ~ADC_SR_EOC;
+	return (uint16_t)ADCx->DR;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_TIM_ClearFlag(TIM_TypeDef *TIMx, uint16_t TIM_FLAG)
+{
+	TIMx->SR &= (uint16_t)~TIM_FLAG;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t TIM_IT)
+{
+	TIMx->SR &= (uint16_t)~TIM_IT;
+}
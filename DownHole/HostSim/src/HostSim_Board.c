@@ -0,0 +1,89 @@
+/*******************************************************************************
+*       @brief      DownHole board wiring for the host simulation: which host
+*                   endpoint or model sits on each serial port, the DataFlash
+*                   on SPI1, the analog inputs and the gamma counter.
+*       @file       Downhole/HostSim/src/HostSim_Board.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// Settings (environment):
+//  HOSTSIM_USART1        datalink (modem) endpoint, default "pty"
+//  HOSTSIM_USART2        compass endpoint, default the "tenfoot" model
+//  HOSTSIM_FLASH_IMAGE   DataFlash image file, created erased if missing
+//  HOSTSIM_BATTERY_MV    battery voltage seen by ADC3 channel 10
+//  HOSTSIM_PEAK_MV       peak detector voltage seen by ADC1 channel 11
+//  HOSTSIM_ADC_NOISE     noise on both of those, counts rms
+//  HOSTSIM_GAMMA_CPS     mean gamma count rate on the TIM3 ETR input
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "board.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// Battery divider 1K / 5.6K on a 3.3V reference, as scaled in adc.c
+#define BATTERY_FULL_SCALE_MV   21780
+#define PEAK_FULL_SCALE_MV      3300
+#define ADC_FULL_SCALE_COUNTS   4095
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT16 hostSim_MilliVoltsToCounts(INT32 nMilliVolts, INT32 nFullScale)
+{
+	INT32 nCounts = (nMilliVolts * ADC_FULL_SCALE_COUNTS) / nFullScale;
+
+	if (nCounts < 0)
+	{
+		nCounts = 0;
+	}
+	if (nCounts > ADC_FULL_SCALE_COUNTS)
+	{
+		nCounts = ADC_FULL_SCALE_COUNTS;
+	}
+	return (U_INT16)nCounts;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_BoardInitialize(void)
+{
+	const char *pszCompass = HostSim_GetSettingText("HOSTSIM_USART2", "tenfoot");
+
+	HostSim_UsartAttach(USART1, "datalink", HostSim_GetSettingText("HOSTSIM_USART1", "pty"), NULL);
+	if (strcmp(pszCompass, "tenfoot") == 0)
+	{
+		HostSim_UsartAttach(USART2, "compass", pszCompass, &HostSim_TenfootCompass);
+	}
+	else
+	{
+		HostSim_UsartAttach(USART2, "compass", pszCompass, NULL);
+	}
+
+	HostSim_SpiAttachDataFlash(SPI1, DATAFLASH_CS_PORT, DATAFLASH_CS_PIN,
+	                           HostSim_GetSettingText("HOSTSIM_FLASH_IMAGE", "dataflash.bin"));
+
+	HostSim_AnalogSetInput(ADC3, 10,
+	                       hostSim_MilliVoltsToCounts(HostSim_GetSetting("HOSTSIM_BATTERY_MV", 14400),
+	                                                  BATTERY_FULL_SCALE_MV));
+	HostSim_AnalogSetInput(ADC1, 11,
+	                       hostSim_MilliVoltsToCounts(HostSim_GetSetting("HOSTSIM_PEAK_MV", 280),
+	                                                  PEAK_FULL_SCALE_MV));
+	HostSim_AnalogSetNoise(ADC3, (U_INT16)HostSim_GetSetting("HOSTSIM_ADC_NOISE", 0));
+	HostSim_AnalogSetNoise(ADC1, (U_INT16)HostSim_GetSetting("HOSTSIM_ADC_NOISE", 0));
+	HostSim_TimerAttachPulseSource(TIM3, HostSim_GetSettingReal("HOSTSIM_GAMMA_CPS", 40.0));
+}
@@ -0,0 +1,328 @@
+/*******************************************************************************
+*       @brief      Built-in Tenfoot directional sensor.  Answers each 'L'
+*                   request with the 33 byte binary survey frame, computed
+*                   from a configured tool attitude and earth field.
+*       @file       Downhole/HostSim/src/HostSim_Compass.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The frame is eight big endian INT32 values scaled by 4096: Hx, Hy, Hz in
+// nT, Gx, Gy, Gz in mG, temperature in 0.1 degC and supply volts, followed by
+// the 8 bit sum of those 32 bytes.
+//
+// Settings (environment):
+//  HOSTSIM_AZIMUTH, HOSTSIM_INCLINATION, HOSTSIM_TOOLFACE   attitude, degrees
+//  HOSTSIM_AZIMUTH_RATE, HOSTSIM_INCLINATION_RATE,
+//  HOSTSIM_TOOLFACE_RATE                                    turning, deg/s
+//  HOSTSIM_DIP, HOSTSIM_FIELD_NT                            earth field
+//  HOSTSIM_TEMPERATURE                                      degC
+//  HOSTSIM_COMPASS_LATENCY_MS                               request to answer
+//  HOSTSIM_COMPASS_NOISE                                    sigma, mG and
+//                                                           the same fraction
+//                                                           of the field in nT
+//  HOSTSIM_HARD_IRON_X, _Y, _Z                              offset, nT
+//  HOSTSIM_SOFT_IRON_X, _Y, _Z, HOSTSIM_SOFT_IRON_XY        axis gains and
+//                                                           the x-y coupling
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <math.h>
+#include <string.h>
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define TENFOOT_FRAME_LENGTH    33
+#define TENFOOT_REQUEST         'L'
+#define TENFOOT_SCALE           4096.0
+#define EARTH_GRAVITY_MG        1000.0
+#define DEGREES_TO_RADIANS      (M_PI / 180.0)
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	REAL64 fAzimuth;
+	REAL64 fInclination;
+	REAL64 fToolface;
+	REAL64 fDip;
+	REAL64 fField;
+	REAL64 fTemperature;
+	REAL64 fNoise;
+	REAL64 fRate[3];	// azimuth, inclination, toolface
+	REAL64 fHardIron[3];
+	REAL64 fSoftIron[3][3];
+	U_INT32 nLatency;
+	BOOL bConfigured;
+	// reply in progress
+	U_BYTE nFrame[TENFOOT_FRAME_LENGTH];
+	U_INT32 nFrameIndex;
+	U_INT32 nFrameLength;
+	U_INT32 nReplyDue;
+	BOOL bRequestPending;
+	// request turnaround, reply complete to the next request
+	BOOL bReplied;
+	U_INT32 nReplyDoneTick;
+	U_INT32 nRequests;
+	U_INT32 nTurnarounds;
+	U_INT32 nTurnaroundMin;
+	U_INT32 nTurnaroundMax;
+	U_INT64 nTurnaroundSum;
+} HOSTSIM_TENFOOT;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void hostSim_TenfootReceive(const U_BYTE *pData, U_INT32 nLength);
+static U_INT32 hostSim_TenfootTransmit(U_BYTE *pData, U_INT32 nMax);
+static void hostSim_TenfootTick(void);
+static void hostSim_TenfootReport(void);
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+const HOSTSIM_SERIAL_DEVICE HostSim_TenfootCompass =
+{
+	hostSim_TenfootReceive,
+	hostSim_TenfootTransmit,
+	hostSim_TenfootTick,
+	hostSim_TenfootReport,
+};
+
+static HOSTSIM_TENFOOT m_Tenfoot;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_TenfootConfigure(HOSTSIM_TENFOOT *pSensor)
+{
+	pSensor->fAzimuth = HostSim_GetSettingReal("HOSTSIM_AZIMUTH", 45.0);
+	pSensor->fInclination = HostSim_GetSettingReal("HOSTSIM_INCLINATION", 30.0);
+	pSensor->fToolface = HostSim_GetSettingReal("HOSTSIM_TOOLFACE", 90.0);
+	pSensor->fDip = HostSim_GetSettingReal("HOSTSIM_DIP", 60.0);
+	pSensor->fField = HostSim_GetSettingReal("HOSTSIM_FIELD_NT", 50000.0);
+	pSensor->fTemperature = HostSim_GetSettingReal("HOSTSIM_TEMPERATURE", 85.0);
+	pSensor->fNoise = HostSim_GetSettingReal("HOSTSIM_COMPASS_NOISE", 0.0);
+	pSensor->fRate[0] = HostSim_GetSettingReal("HOSTSIM_AZIMUTH_RATE", 0.0);
+	pSensor->fRate[1] = HostSim_GetSettingReal("HOSTSIM_INCLINATION_RATE", 0.0);
+	pSensor->fRate[2] = HostSim_GetSettingReal("HOSTSIM_TOOLFACE_RATE", 0.0);
+	pSensor->fHardIron[0] = HostSim_GetSettingReal("HOSTSIM_HARD_IRON_X", 0.0);
+	pSensor->fHardIron[1] = HostSim_GetSettingReal("HOSTSIM_HARD_IRON_Y", 0.0);
+	pSensor->fHardIron[2] = HostSim_GetSettingReal("HOSTSIM_HARD_IRON_Z", 0.0);
+	memset(pSensor->fSoftIron, 0, sizeof(pSensor->fSoftIron));
+	pSensor->fSoftIron[0][0] = HostSim_GetSettingReal("HOSTSIM_SOFT_IRON_X", 1.0);
+	pSensor->fSoftIron[1][1] = HostSim_GetSettingReal("HOSTSIM_SOFT_IRON_Y", 1.0);
+	pSensor->fSoftIron[2][2] = HostSim_GetSettingReal("HOSTSIM_SOFT_IRON_Z", 1.0);
+	pSensor->fSoftIron[0][1] = HostSim_GetSettingReal("HOSTSIM_SOFT_IRON_XY", 0.0);
+	pSensor->fSoftIron[1][0] = pSensor->fSoftIron[0][1];
+	pSensor->nLatency = (U_INT32)HostSim_GetSetting("HOSTSIM_COMPASS_LATENCY_MS", 400);
+	pSensor->nTurnaroundMin = 0xFFFFFFFF;
+	pSensor->bConfigured = TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_TenfootPut(U_BYTE *pFrame, REAL64 fValue)
+{
+	INT32 nValue = (INT32)lround(fValue * TENFOOT_SCALE);
+	U_INT32 nBits = (U_INT32)nValue;
+
+	pFrame[0] = (U_BYTE)(nBits >> 24);
+	pFrame[1] = (U_BYTE)(nBits >> 16);
+	pFrame[2] = (U_BYTE)(nBits >> 8);
+	pFrame[3] = (U_BYTE)nBits;
+}
+
+/*******************************************************************************
+*       @details
+*   Sensor axes follow the firmware's conventions: inclination from Gz and
+*   the radial gravity, highside from (Gx, -Gy), and azimuth from the pair
+*   x = H.(GxGz, GyGz, Gr^2), y = H.|G|(Gy, -Gx, 0).  Those two vectors are
+*   orthogonal, so the field is built on them to decode to the set azimuth.
+*   The hard and soft iron of the tool then distort the field the sensor
+*   reports.
+*******************************************************************************/
+static void hostSim_TenfootBuildFrame(HOSTSIM_TENFOOT *pSensor)
+{
+	REAL64 fSeconds = HostSim_GetTicks() / 1000.0;
+	REAL64 fInc = (pSensor->fInclination + (pSensor->fRate[1] * fSeconds)) * DEGREES_TO_RADIANS;
+	REAL64 fTF = (pSensor->fToolface + (pSensor->fRate[2] * fSeconds)) * DEGREES_TO_RADIANS;
+	REAL64 fAz = (pSensor->fAzimuth + (pSensor->fRate[0] * fSeconds)) * DEGREES_TO_RADIANS;
+	REAL64 fDip = pSensor->fDip * DEGREES_TO_RADIANS;
+	REAL64 fG[3], fH[3], fA[3], fB[3], fC[3], fEarth[3];
+	REAL64 fGradial, fGtotal, fLengthA, fLengthB;
+	U_BYTE nSum = 0;
+
+	fGradial = EARTH_GRAVITY_MG * cos(fInc);
+	fG[0] = -fGradial * sin(fTF);
+	fG[1] = -fGradial * cos(fTF);
+	fG[2] = -EARTH_GRAVITY_MG * sin(fInc);
+	fGtotal = EARTH_GRAVITY_MG;
+
+	fA[0] = fG[0] * fG[2];
+	fA[1] = fG[1] * fG[2];
+	fA[2] = fGradial * fGradial;
+	fB[0] = fGtotal * fG[1];
+	fB[1] = -fGtotal * fG[0];
+	fB[2] = 0.0;
+	fLengthA = sqrt((fA[0] * fA[0]) + (fA[1] * fA[1]) + (fA[2] * fA[2]));
+	fLengthB = sqrt((fB[0] * fB[0]) + (fB[1] * fB[1]));
+	if ((fLengthA == 0.0) || (fLengthB == 0.0))
+	{
+		// vertical hole, azimuth is undefined: put the field in the xz plane
+		fA[0] = 0.0; fA[1] = 0.0; fA[2] = 1.0; fLengthA = 1.0;
+		fB[0] = 1.0; fB[1] = 0.0; fB[2] = 0.0; fLengthB = 1.0;
+	}
+	for (U_INT32 i = 0; i < 3; i++)
+	{
+		fA[i] /= fLengthA;
+		fB[i] /= fLengthB;
+	}
+	fC[0] = (fA[1] * fB[2]) - (fA[2] * fB[1]);
+	fC[1] = (fA[2] * fB[0]) - (fA[0] * fB[2]);
+	fC[2] = (fA[0] * fB[1]) - (fA[1] * fB[0]);
+	for (U_INT32 i = 0; i < 3; i++)
+	{
+		fEarth[i] = pSensor->fField * ((cos(fDip) * cos(fAz) * fA[i]) +
+		                               (cos(fDip) * sin(fAz) * fB[i]) + (sin(fDip) * fC[i]));
+	}
+	for (U_INT32 i = 0; i < 3; i++)
+	{
+		fH[i] = pSensor->fHardIron[i];
+		for (U_INT32 j = 0; j < 3; j++)
+		{
+			fH[i] += pSensor->fSoftIron[i][j] * fEarth[j];
+		}
+		fH[i] += pSensor->fNoise * pSensor->fField / EARTH_GRAVITY_MG * HostSim_RandomNormal();
+		fG[i] += pSensor->fNoise * HostSim_RandomNormal();
+	}
+
+	for (U_INT32 i = 0; i < 3; i++)
+	{
+		hostSim_TenfootPut(&pSensor->nFrame[4 * i], fH[i]);
+		hostSim_TenfootPut(&pSensor->nFrame[12 + (4 * i)], fG[i]);
+	}
+	hostSim_TenfootPut(&pSensor->nFrame[24], pSensor->fTemperature * 10.0);
+	hostSim_TenfootPut(&pSensor->nFrame[28], 12.0);
+	for (U_INT32 i = 0; i < (TENFOOT_FRAME_LENGTH - 1); i++)
+	{
+		nSum += pSensor->nFrame[i];
+	}
+	pSensor->nFrame[TENFOOT_FRAME_LENGTH - 1] = nSum;
+	pSensor->nFrameIndex = 0;
+	pSensor->nFrameLength = TENFOOT_FRAME_LENGTH;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_TenfootReceive(const U_BYTE *pData, U_INT32 nLength)
+{
+	HOSTSIM_TENFOOT *pSensor = &m_Tenfoot;
+
+	if (!pSensor->bConfigured)
+	{
+		hostSim_TenfootConfigure(pSensor);
+	}
+	for (U_INT32 i = 0; i < nLength; i++)
+	{
+		if ((pData[i] != TENFOOT_REQUEST) || pSensor->bRequestPending)
+		{
+			continue;
+		}
+		pSensor->nRequests++;
+		if (pSensor->bReplied)
+		{
+			U_INT32 nTurnaround = HostSim_GetTicks() - pSensor->nReplyDoneTick;
+
+			pSensor->bReplied = FALSE;
+			pSensor->nTurnarounds++;
+			pSensor->nTurnaroundSum += nTurnaround;
+			if (nTurnaround < pSensor->nTurnaroundMin)
+			{
+				pSensor->nTurnaroundMin = nTurnaround;
+			}
+			if (nTurnaround > pSensor->nTurnaroundMax)
+			{
+				pSensor->nTurnaroundMax = nTurnaround;
+			}
+		}
+		pSensor->bRequestPending = TRUE;
+		pSensor->nReplyDue = HostSim_GetTicks() + pSensor->nLatency;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_TenfootTick(void)
+{
+	HOSTSIM_TENFOOT *pSensor = &m_Tenfoot;
+
+	if (pSensor->bRequestPending && ((INT32)(HostSim_GetTicks() - pSensor->nReplyDue) >= 0))
+	{
+		pSensor->bRequestPending = FALSE;
+		hostSim_TenfootBuildFrame(pSensor);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 hostSim_TenfootTransmit(U_BYTE *pData, U_INT32 nMax)
+{
+	HOSTSIM_TENFOOT *pSensor = &m_Tenfoot;
+	U_INT32 nCount = pSensor->nFrameLength - pSensor->nFrameIndex;
+
+	if (nCount == 0)
+	{
+		return 0;
+	}
+	if (nCount > nMax)
+	{
+		nCount = nMax;
+	}
+	memcpy(pData, &pSensor->nFrame[pSensor->nFrameIndex], nCount);
+	pSensor->nFrameIndex += nCount;
+	if (pSensor->nFrameIndex == pSensor->nFrameLength)
+	{
+		pSensor->nFrameIndex = pSensor->nFrameLength = 0;
+		pSensor->bReplied = TRUE;
+		pSensor->nReplyDoneTick = HostSim_GetTicks();
+	}
+	return nCount;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_TenfootReport(void)
+{
+	HOSTSIM_TENFOOT *pSensor = &m_Tenfoot;
+
+	if (pSensor->nTurnarounds == 0)
+	{
+		HostSim_Log("compass: %lu requests", (unsigned long)pSensor->nRequests);
+		return;
+	}
+	HostSim_Log("compass: %lu requests, turnaround min %lu avg %lu max %lu ms",
+	            (unsigned long)pSensor->nRequests, (unsigned long)pSensor->nTurnaroundMin,
+	            (unsigned long)(pSensor->nTurnaroundSum / pSensor->nTurnarounds),
+	            (unsigned long)pSensor->nTurnaroundMax);
+}
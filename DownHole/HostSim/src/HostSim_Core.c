@@ -0,0 +1,1062 @@
+/*******************************************************************************
+*       @brief      Core of the host peripheral simulation: register memory
+*                   map, power on/reset sequence, simulated NVIC and the 1 ms
+*                   hardware clock that steps every peripheral model.
+*       @file       Downhole/HostSim/src/HostSim_Core.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define NUM_IRQS                82
+#define NUM_IRQ_WORDS           ((NUM_IRQS + 31) / 32)
+// a misbehaving model must not be able to lock up the tick
+#define MAX_DISPATCH_PER_TICK   64
+// SysTick is IRQ -1, so nothing pending needs a value outside the IRQn range
+#define NO_PENDING_IRQ          (-0x7FFF)
+
+// RCC->CSR reset flags
+#define CSR_RMVF                (1ul << 24)
+#define CSR_BORRSTF             (1ul << 25)
+#define CSR_PINRSTF             (1ul << 26)
+#define CSR_PORRSTF             (1ul << 27)
+#define CSR_SFTRSTF             (1ul << 28)
+#define CSR_IWDGRSTF            (1ul << 29)
+
+#define IWDG_KEY_RELOAD         0xAAAA
+#define IWDG_KEY_ENABLE         0xCCCC
+#define LSI_FREQUENCY_HZ        32000ul
+// bit-band alias words hold this until the firmware writes one
+#define BIT_BAND_UNWRITTEN      0xB17BA4D5ul
+// RTC wakeup event is EXTI line 22
+#define RTC_WAKEUP_EXTI_LINE    (1ul << 22)
+#define BKPSRAM_SIZE            0x1000
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef void (*HOSTSIM_HANDLER)(void);
+
+typedef struct
+{
+	uintptr_t nBase;
+	size_t nSize;
+	U_BYTE nFill;
+} HOSTSIM_REGION;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+extern void SystemInit(void);
+extern void SysTick_Handler(void) __attribute__((weak));
+
+// The vector table.  Handlers the firmware does not define stay NULL.
+#define HOSTSIM_VECTOR(name) extern void name##_IRQHandler(void) __attribute__((weak));
+#include "HostSim_Vectors.h"
+#undef HOSTSIM_VECTOR
+
+static void hostSim_MapBackupSram(void);
+static void hostSim_ClockTick(int nSignal);
+static void hostSim_Dispatch(void);
+static void hostSim_SysTickStep(void);
+static void hostSim_CycleCounterStep(void);
+static BOOL hostSim_IrqPending(void);
+static void hostSim_Shutdown(int nSignal);
+static void hostSim_Report(void);
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const HOSTSIM_REGION m_Regions[] =
+{
+	{ FLASH_BASE,           0x00100000, 0xFF },	// internal flash
+	{ 0x1FFF0000,           0x00010000, 0xFF },	// system memory, OTP, device ID
+	{ PERIPH_BASE,          0x00080000, 0x00 },	// APB1, APB2, AHB1 and BKPSRAM
+	{ PERIPH_BB_BASE,       0x01000000, 0x00 },	// bit-band alias of the above
+	{ AHB2PERIPH_BASE,      0x00061000, 0x00 },	// AHB2
+	{ 0xE0000000,           0x00100000, 0x00 },	// Cortex-M4 private peripheral bus
+};
+
+// Registers the library addresses through the bit-band alias
+static const HOSTSIM_REGION m_BitBandWindows[] =
+{
+	{ PWR_BASE,             0x00000008, 0x00 },
+	{ SYSCFG_BASE,          0x00000024, 0x00 },
+	{ RCC_BASE,             0x00000090, 0x00 },
+};
+
+static const HOSTSIM_HANDLER m_Vectors[NUM_IRQS] =
+{
+#define HOSTSIM_VECTOR(name) name##_IRQHandler,
+#include "HostSim_Vectors.h"
+#undef HOSTSIM_VECTOR
+};
+
+static volatile U_INT32 m_nTicks;
+static volatile sig_atomic_t m_bPrimask;
+static volatile U_INT32 m_nBasepri;
+static volatile U_INT32 m_nActiveIRQ;
+static U_INT32 m_nEnabled[NUM_IRQ_WORDS];
+static U_INT32 m_nPending[NUM_IRQ_WORDS];
+static volatile BOOL m_bSysTickPending;
+static sigset_t m_TickMask;
+static char **m_pArgv;
+static U_INT32 m_nRunTicks;
+static BOOL m_bWatchdogModel;
+static BOOL m_bWatchdogRunning;
+static U_INT64 m_nWatchdogCount;	// in LSI periods x 1000
+static U_INT32 m_nIrqCount;
+static U_INT64 m_nRandomState;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 HostSim_GetTicks(void)
+{
+	return m_nTicks;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+INT32 HostSim_GetSetting(const char *pszName, INT32 nDefault)
+{
+	const char *pszValue = getenv(pszName);
+	return (pszValue != NULL && *pszValue != '\0') ? (INT32)strtol(pszValue, NULL, 0) : nDefault;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+REAL64 HostSim_GetSettingReal(const char *pszName, REAL64 fDefault)
+{
+	const char *pszValue = getenv(pszName);
+	return (pszValue != NULL && *pszValue != '\0') ? strtod(pszValue, NULL) : fDefault;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const char *HostSim_GetSettingText(const char *pszName, const char *pszDefault)
+{
+	const char *pszValue = getenv(pszName);
+	return (pszValue != NULL && *pszValue != '\0') ? pszValue : pszDefault;
+}
+
+/*******************************************************************************
+*       @details
+*   xorshift64*, uniform in (0, 1].  Seeded from HOSTSIM_SEED so a run can
+*   be repeated exactly.
+*******************************************************************************/
+REAL64 HostSim_RandomUniform(void)
+{
+	m_nRandomState ^= m_nRandomState >> 12;
+	m_nRandomState ^= m_nRandomState << 25;
+	m_nRandomState ^= m_nRandomState >> 27;
+	return ((REAL64)((m_nRandomState * 0x2545F4914F6CDD1Dull) >> 11) + 1.0) / 9007199254740992.0;
+}
+
+/*******************************************************************************
+*       @details
+*   Standard normal, Box-Muller.
+*******************************************************************************/
+REAL64 HostSim_RandomNormal(void)
+{
+	REAL64 fRadius = sqrt(-2.0 * log(HostSim_RandomUniform()));
+	return fRadius * cos(2.0 * M_PI * HostSim_RandomUniform());
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_Log(const char *pszFormat, ...)
+{
+	char sLine[256];
+	int nLength;
+	va_list args;
+
+	nLength = snprintf(sLine, sizeof(sLine), "HostSim %8lu: ", (unsigned long)m_nTicks);
+	va_start(args, pszFormat);
+	nLength += vsnprintf(&sLine[nLength], sizeof(sLine) - (size_t)nLength - 1, pszFormat, args);
+	va_end(args);
+	if (nLength > (int)sizeof(sLine) - 2)
+	{
+		nLength = (int)sizeof(sLine) - 2;
+	}
+	sLine[nLength++] = '\n';
+	(void)!write(STDERR_FILENO, sLine, (size_t)nLength);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static volatile U_INT32 *hostSim_BitBandAlias(uintptr_t nAddress)
+{
+	return (volatile U_INT32 *)(PERIPH_BB_BASE + ((nAddress - PERIPH_BASE) * 32));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_MapRegions(void)
+{
+	for (size_t i = 0; i < sizeof(m_Regions) / sizeof(m_Regions[0]); i++)
+	{
+		void *pAddress = mmap((void *)m_Regions[i].nBase, m_Regions[i].nSize,
+		                      PROT_READ | PROT_WRITE,
+		                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (pAddress != (void *)m_Regions[i].nBase)
+		{
+			HostSim_Log("cannot map 0x%08lx (%s), is the build non-PIE?",
+			            (unsigned long)m_Regions[i].nBase, strerror(errno));
+			_exit(EXIT_FAILURE);
+		}
+		if (m_Regions[i].nFill != 0)
+		{
+			memset(pAddress, m_Regions[i].nFill, m_Regions[i].nSize);
+		}
+	}
+	for (size_t i = 0; i < sizeof(m_BitBandWindows) / sizeof(m_BitBandWindows[0]); i++)
+	{
+		volatile U_INT32 *pAlias = hostSim_BitBandAlias(m_BitBandWindows[i].nBase);
+
+		for (size_t j = 0; j < m_BitBandWindows[i].nSize * 8; j++)
+		{
+			pAlias[j] = BIT_BAND_UNWRITTEN;
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The backup SRAM is the HOSTSIM_BACKUP_IMAGE file mapped over its place in
+*   the peripheral region, so it keeps its contents when the image is
+*   re-executed.  Whether it is kept is up to the backup regulator, which
+*   HostSim_SystemReset hands on.
+*******************************************************************************/
+static void hostSim_MapBackupSram(void)
+{
+	const char *pszImage = HostSim_GetSettingText("HOSTSIM_BACKUP_IMAGE", "backupsram.bin");
+	void *pAddress = MAP_FAILED;
+	int nFd;
+
+	nFd = open(pszImage, O_RDWR | O_CREAT, 0644);
+	if ((nFd >= 0) && (ftruncate(nFd, BKPSRAM_SIZE) == 0))
+	{
+		pAddress = mmap((void *)BKPSRAM_BASE, BKPSRAM_SIZE, PROT_READ | PROT_WRITE,
+		                MAP_SHARED | MAP_FIXED, nFd, 0);
+	}
+	if (nFd >= 0)
+	{
+		close(nFd);
+	}
+	if (pAddress != (void *)BKPSRAM_BASE)
+	{
+		HostSim_Log("backup SRAM: cannot map %s (%s), contents will not survive a reset",
+		            pszImage, strerror(errno));
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The library sets a few RCC, PWR and SYSCFG bits through their bit-band
+*   alias.  Alias words are primed with a marker, anything else found there
+*   was written by the firmware and is applied to the register bit.
+*******************************************************************************/
+static void hostSim_BitBandStep(void)
+{
+	for (size_t i = 0; i < sizeof(m_BitBandWindows) / sizeof(m_BitBandWindows[0]); i++)
+	{
+		volatile U_INT32 *pAlias = hostSim_BitBandAlias(m_BitBandWindows[i].nBase);
+
+		for (size_t j = 0; j < m_BitBandWindows[i].nSize * 8; j++)
+		{
+			if (pAlias[j] != BIT_BAND_UNWRITTEN)
+			{
+				volatile U_INT32 *pRegister = (volatile U_INT32 *)(m_BitBandWindows[i].nBase + ((j / 32) * 4));
+
+				if (pAlias[j] & 1)
+				{
+					*pRegister |= 1ul << (j % 32);
+				}
+				else
+				{
+					*pRegister &= ~(1ul << (j % 32));
+				}
+				pAlias[j] = BIT_BAND_UNWRITTEN;
+			}
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Registers that are not zero out of reset, from RM0090.
+*******************************************************************************/
+static void hostSim_ResetValues(HOSTSIM_RESET_CAUSE eCause)
+{
+	RCC->CR = 0x00000083;
+	RCC->PLLCFGR = 0x24003010;
+	RCC->AHB1ENR = 0x00100000;
+	RCC->AHB1LPENR = 0x7E6791FF;
+	switch (eCause)
+	{
+		case HOSTSIM_RESET_WATCHDOG:
+			RCC->CSR = CSR_IWDGRSTF | CSR_PINRSTF;
+			break;
+		case HOSTSIM_RESET_SOFTWARE:
+			RCC->CSR = CSR_SFTRSTF | CSR_PINRSTF;
+			break;
+		default:
+			RCC->CSR = CSR_PORRSTF | CSR_PINRSTF | CSR_BORRSTF;
+			break;
+	}
+	IWDG->RLR = 0x0FFF;
+	PWR->CR = 0x0000C000;
+	RTC->PRER = 0x007F00FF;
+	RTC->WUTR = 0x0000FFFF;
+	RTC->DR = 0x00002101;
+	RTC->ISR = 0x00000007;
+	FLASH->CR = FLASH_CR_LOCK;
+	FLASH->OPTCR = 0x0FFFAAED;
+	DBGMCU->IDCODE = 0x10076413;
+	*(volatile U_INT32 *)&SCB->CPUID = 0x410FC241;
+	SCB->AIRCR = 0xFA050000;
+	*(volatile U_INT32 *)&SysTick->CALIB = 0x00004E20;
+	USART1->SR = USART2->SR = USART3->SR = USART6->SR = 0x00C0;
+	UART4->SR = UART5->SR = 0x00C0;
+	SPI1->SR = SPI2->SR = SPI3->SR = 0x0002;
+	for (GPIO_TypeDef *pGPIO = GPIOA; pGPIO <= GPIOI; pGPIO = (GPIO_TypeDef *)((uintptr_t)pGPIO + 0x400))
+	{
+		pGPIO->MODER = (pGPIO == GPIOA) ? 0xA8000000 : ((pGPIO == GPIOB) ? 0x00000280 : 0);
+		pGPIO->OSPEEDR = (pGPIO == GPIOB) ? 0x000000C0 : 0;
+		pGPIO->PUPDR = (pGPIO == GPIOA) ? 0x64000000 : ((pGPIO == GPIOB) ? 0x00000100 : 0);
+	}
+	// 96 bit unique device ID
+	*(volatile U_INT32 *)0x1FFF7A10 = 0x00360041;
+	*(volatile U_INT32 *)0x1FFF7A14 = 0x30345111;
+	*(volatile U_INT32 *)0x1FFF7A18 = 0x31373833;
+	// flash size register, in kbytes
+	*(volatile U_INT16 *)0x1FFF7A22 = 1024;
+}
+
+/*******************************************************************************
+*       @details
+*   Ready flags follow their enables one clock after the write, the same way
+*   the oscillators and regulators settle on the real part.
+*******************************************************************************/
+static void hostSim_ClockAndPowerStep(void)
+{
+	U_INT32 nCR = RCC->CR;
+
+	nCR = (nCR & ~(RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY | RCC_CR_PLLI2SRDY)) |
+	      ((nCR & RCC_CR_HSION) ? RCC_CR_HSIRDY : 0) |
+	      ((nCR & RCC_CR_HSEON) ? RCC_CR_HSERDY : 0) |
+	      ((nCR & RCC_CR_PLLON) ? RCC_CR_PLLRDY : 0) |
+	      ((nCR & RCC_CR_PLLI2SON) ? RCC_CR_PLLI2SRDY : 0);
+	RCC->CR = nCR;
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SWS) | ((RCC->CFGR & RCC_CFGR_SW) << 2);
+	RCC->BDCR = (RCC->BDCR & ~RCC_BDCR_LSERDY) | ((RCC->BDCR & RCC_BDCR_LSEON) ? RCC_BDCR_LSERDY : 0);
+	if (RCC->CSR & CSR_RMVF)
+	{
+		RCC->CSR &= 0x00FFFFFF;
+	}
+	RCC->CSR = (RCC->CSR & ~RCC_CSR_LSIRDY) | ((RCC->CSR & RCC_CSR_LSION) ? RCC_CSR_LSIRDY : 0);
+	PWR->CSR = (PWR->CSR & ~PWR_CSR_BRR) | ((PWR->CSR & PWR_CSR_BRE) ? PWR_CSR_BRR : 0);
+	// CWUF and CSBF clear their flag and always read back zero
+	if (PWR->CR & PWR_CR_CWUF)
+	{
+		PWR->CSR &= ~PWR_CSR_WUF;
+	}
+	if (PWR->CR & PWR_CR_CSBF)
+	{
+		PWR->CSR &= ~PWR_CSR_SBF;
+	}
+	PWR->CR &= ~(PWR_CR_CWUF | PWR_CR_CSBF);
+}
+
+/*******************************************************************************
+*       @details
+*   The IWDG counts LSI periods through its prescaler, a reload key restarts
+*   the count and running out restarts the firmware.
+*******************************************************************************/
+static void hostSim_WatchdogStep(void)
+{
+	U_INT32 nKey = IWDG->KR;
+	U_INT32 nDivider = 4ul << (IWDG->PR & 0x7);
+
+	if (nKey == IWDG_KEY_ENABLE)
+	{
+		m_bWatchdogRunning = TRUE;
+	}
+	if ((nKey == IWDG_KEY_ENABLE) || (nKey == IWDG_KEY_RELOAD))
+	{
+		m_nWatchdogCount = (U_INT64)(IWDG->RLR & 0xFFF) * 1000ull;
+	}
+	IWDG->KR = 0;
+	if (!m_bWatchdogRunning || !m_bWatchdogModel)
+	{
+		return;
+	}
+	// counts per millisecond scaled by 1000
+	U_INT64 nStep = (U_INT64)LSI_FREQUENCY_HZ / nDivider;
+	if (m_nWatchdogCount <= nStep)
+	{
+		HostSim_SystemReset(HOSTSIM_RESET_WATCHDOG);
+	}
+	m_nWatchdogCount -= nStep;
+}
+
+/*******************************************************************************
+*       @details
+*   Adds one to a packed BCD field, returns TRUE when it wrapped past nLast.
+*******************************************************************************/
+static BOOL hostSim_BcdIncrement(U_INT32 *pRegister, U_INT32 nShift, U_INT32 nFirst, U_INT32 nLast)
+{
+	U_INT32 nField = (*pRegister >> nShift) & 0xFF;
+	U_INT32 nValue = ((nField >> 4) * 10) + (nField & 0x0F) + 1;
+	BOOL bWrapped = (nValue > nLast);
+
+	if (bWrapped)
+	{
+		nValue = nFirst;
+	}
+	*pRegister = (*pRegister & ~(0xFFul << nShift)) | ((((nValue / 10) << 4) | (nValue % 10)) << nShift);
+	return bWrapped;
+}
+
+/*******************************************************************************
+*       @details
+*   Calendar and wakeup timer, clocked from a 32.768 kHz LSE with the
+*   prescalers the firmware programs (CK_SPRE = 1 Hz).
+*******************************************************************************/
+static void hostSim_RealTimeClockStep(void)
+{
+	static const U_BYTE nDaysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+	static U_INT32 nSecondTicks;
+	static U_INT64 nWakeupPhase;
+	U_INT32 nISR = RTC->ISR;
+
+	// INITF follows INIT, shadow registers are always in sync and WUTR may
+	// be written at any time
+	nISR = (nISR & ~(RTC_ISR_INITF | RTC_ISR_INITS)) | ((nISR & RTC_ISR_INIT) ? RTC_ISR_INITF : 0);
+	nISR |= RTC_ISR_RSF | RTC_ISR_WUTWF;
+	if ((RTC->DR & 0x00FF0000) != 0)
+	{
+		nISR |= RTC_ISR_INITS;
+	}
+	RTC->ISR = nISR;
+
+	if (((RCC->BDCR & RCC_BDCR_RTCEN) == 0) || ((nISR & RTC_ISR_INIT) != 0))
+	{
+		return;
+	}
+	if (++nSecondTicks >= 1000)
+	{
+		U_INT32 nTR = RTC->TR, nDR = RTC->DR;
+		U_INT32 nMonth = (((nDR >> 12) & 1) * 10) + ((nDR >> 8) & 0xF);
+		U_INT32 nYear = (((nDR >> 20) & 0xF) * 10) + ((nDR >> 16) & 0xF);
+		U_INT32 nLastDay = ((nMonth >= 1) && (nMonth <= 12)) ? nDaysInMonth[nMonth - 1] : 31;
+
+		if ((nMonth == 2) && ((nYear & 3) == 0))
+		{
+			nLastDay = 29;
+		}
+		nSecondTicks = 0;
+		if (hostSim_BcdIncrement(&nTR, 0, 0, 59) && hostSim_BcdIncrement(&nTR, 8, 0, 59) &&
+		    hostSim_BcdIncrement(&nTR, 16, 0, 23))
+		{
+			nDR = (nDR & ~0xE000ul) | ((((nDR >> 13) & 7) % 7 + 1) << 13);
+			if (hostSim_BcdIncrement(&nDR, 0, 1, nLastDay))
+			{
+				// the month field shares its byte with the week day
+				U_INT32 nWeekDay = nDR & 0xE000;
+				nDR &= ~0xE000ul;
+				if (hostSim_BcdIncrement(&nDR, 8, 1, 12))
+				{
+					hostSim_BcdIncrement(&nDR, 16, 0, 99);
+				}
+				nDR |= nWeekDay;
+			}
+		}
+		RTC->TR = nTR;
+		RTC->DR = nDR;
+	}
+
+	if ((RTC->CR & RTC_CR_WUTE) == 0)
+	{
+		nWakeupPhase = 0;
+		return;
+	}
+	// wakeup clock in Hz: RTCCLK/16, /8, /4, /2 or CK_SPRE
+	U_INT32 nSelect = RTC->CR & RTC_CR_WUCKSEL;
+	U_INT32 nRate = (nSelect < 4) ? (32768ul >> (4 - nSelect)) : 1;
+	U_INT64 nPeriod = ((U_INT64)(RTC->WUTR & 0xFFFF) + ((nSelect >= 6) ? 0x10001 : 1)) * 1000ull;
+
+	nWakeupPhase += nRate;
+	if (nWakeupPhase >= nPeriod)
+	{
+		nWakeupPhase -= nPeriod;
+		RTC->ISR |= RTC_ISR_WUTF;
+		if ((EXTI->IMR | EXTI->EMR) & RTC_WAKEUP_EXTI_LINE)
+		{
+			EXTI->PR |= RTC_WAKEUP_EXTI_LINE;
+		}
+		if ((RTC->CR & RTC_CR_WUTIE) && (EXTI->IMR & RTC_WAKEUP_EXTI_LINE))
+		{
+			HostSim_SetPending(RTC_WKUP_IRQn);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   RTC_WaitForSynchro() clears RSF and polls for the hardware to set it again
+*   within a loop count, far shorter than a tick on the host.  The library
+*   copy is weakened at build time so its internal callers get this one.
+*******************************************************************************/
+ErrorStatus RTC_WaitForSynchro(void)
+{
+	RTC->ISR |= RTC_ISR_RSF;
+	return SUCCESS;
+}
+
+/*******************************************************************************
+*       @details
+*   The RTC status flags are cleared by writing zero.
+*******************************************************************************/
+void __wrap_RTC_ClearFlag(uint32_t RTC_FLAG)
+{
+	RTC->ISR &= ~(RTC_FLAG & 0x0001FFFF & ~RTC_ISR_INIT);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_RTC_ClearITPendingBit(uint32_t RTC_IT)
+{
+	RTC->ISR &= ~((RTC_IT >> 4) & 0x0000FFFF & ~RTC_ISR_INIT);
+}
+
+/*******************************************************************************
+*       @details
+*   The EXTI pending register is cleared by writing one.
+*******************************************************************************/
+void __wrap_EXTI_ClearITPendingBit(uint32_t EXTI_Line)
+{
+	EXTI->PR &= ~EXTI_Line;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_EXTI_ClearFlag(uint32_t EXTI_Line)
+{
+	EXTI->PR &= ~EXTI_Line;
+}
+
+/*******************************************************************************
+*       @details
+*   Starts the watchdog as the key is written, the firmware reloads it
+*   straight after and that key would hide this one from the next clock.
+*******************************************************************************/
+void __wrap_IWDG_Enable(void)
+{
+	m_nWatchdogCount = (U_INT64)(IWDG->RLR & 0xFFF) * 1000ull;
+	m_bWatchdogRunning = TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_SystemStep(void)
+{
+	hostSim_BitBandStep();
+	hostSim_ClockAndPowerStep();
+	HostSim_GpioStep();
+	hostSim_RealTimeClockStep();
+	hostSim_WatchdogStep();
+	if ((SCB->AIRCR & SCB_AIRCR_SYSRESETREQ_Msk) != 0)
+	{
+		HostSim_SystemReset(HOSTSIM_RESET_SOFTWARE);
+	}
+	hostSim_SysTickStep();
+	hostSim_CycleCounterStep();
+}
+
+/*******************************************************************************
+*       @details
+*   Counts the SysTick down by one millisecond of HCLK.  A counter that reads
+*   zero was written since the last step and takes the reload first.  The
+*   step is the clock, so at most one tick a step: the counter reloads when
+*   it fires and the rest of the step is dropped.
+*******************************************************************************/
+static void hostSim_SysTickStep(void)
+{
+	RCC_ClocksTypeDef clocks;
+	U_INT32 nCycles, nVal, nLoad;
+
+	nLoad = SysTick->LOAD & SysTick_LOAD_RELOAD_Msk;
+	if (((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) == 0) || (nLoad == 0))
+	{
+		return;
+	}
+	RCC_GetClocksFreq(&clocks);
+	nCycles = clocks.HCLK_Frequency / 1000;
+	nVal = SysTick->VAL & SysTick_VAL_CURRENT_Msk;
+	if (nVal == 0)
+	{
+		nVal = nLoad;
+		nCycles--;
+	}
+	if (nCycles < nVal)
+	{
+		SysTick->VAL = nVal - nCycles;
+		return;
+	}
+	SysTick->VAL = nLoad;
+	SysTick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+	if ((SysTick->CTRL & SysTick_CTRL_TICKINT_Msk) != 0)
+	{
+		HostSim_NvicSetPending(SysTick_IRQn, 1);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Advances the DWT cycle counter by one millisecond of HCLK once the
+*   firmware has enabled it, so run times measured with it come out in whole
+*   steps.
+*******************************************************************************/
+static void hostSim_CycleCounterStep(void)
+{
+	RCC_ClocksTypeDef clocks;
+
+	if (((CoreDebug->DEMCR & CoreDebug_DEMCR_TRCENA_Msk) == 0) ||
+		((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0))
+	{
+		return;
+	}
+	RCC_GetClocksFreq(&clocks);
+	DWT->CYCCNT += clocks.HCLK_Frequency / 1000;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_NvicSetEnable(IRQn_Type eIRQ, uint8_t bEnable)
+{
+	U_INT32 nWord, nBit;
+
+	if ((eIRQ < 0) || (eIRQ >= NUM_IRQS))
+	{
+		return;
+	}
+	nWord = (U_INT32)eIRQ >> 5;
+	nBit = 1ul << ((U_INT32)eIRQ & 0x1F);
+	if (bEnable)
+	{
+		m_nEnabled[nWord] |= nBit;
+	}
+	else
+	{
+		m_nEnabled[nWord] &= ~nBit;
+	}
+	NVIC->ISER[nWord] = m_nEnabled[nWord];
+	NVIC->ICER[nWord] = m_nEnabled[nWord];
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+uint32_t HostSim_NvicGetPending(IRQn_Type eIRQ)
+{
+	if ((eIRQ < 0) || (eIRQ >= NUM_IRQS))
+	{
+		return 0;
+	}
+	return (m_nPending[(U_INT32)eIRQ >> 5] >> ((U_INT32)eIRQ & 0x1F)) & 1ul;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_NvicSetPending(IRQn_Type eIRQ, uint8_t bPending)
+{
+	U_INT32 nWord, nBit;
+
+	if (eIRQ == SysTick_IRQn)
+	{
+		m_bSysTickPending = bPending;
+		if (bPending)
+		{
+			SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+		}
+		else
+		{
+			SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+		}
+		return;
+	}
+	if ((eIRQ < 0) || (eIRQ >= NUM_IRQS))
+	{
+		return;
+	}
+	nWord = (U_INT32)eIRQ >> 5;
+	nBit = 1ul << ((U_INT32)eIRQ & 0x1F);
+	if (bPending)
+	{
+		m_nPending[nWord] |= nBit;
+	}
+	else
+	{
+		m_nPending[nWord] &= ~nBit;
+	}
+	NVIC->ISPR[nWord] = m_nPending[nWord];
+	NVIC->ICPR[nWord] = m_nPending[nWord];
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_SetPending(IRQn_Type eIRQ)
+{
+	HostSim_NvicSetPending(eIRQ, 1);
+}
+
+/*******************************************************************************
+*       @details
+*   NVIC_Init() in misc.c writes ISER/ICER directly, let it program the
+*   priority and then record the enable in the simulated controller.
+*******************************************************************************/
+extern void __real_NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct);
+void __wrap_NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct)
+{
+	__real_NVIC_Init(NVIC_InitStruct);
+	HostSim_NvicSetEnable((IRQn_Type)NVIC_InitStruct->NVIC_IRQChannel,
+	                      NVIC_InitStruct->NVIC_IRQChannelCmd != DISABLE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_NvicSystemReset(void)
+{
+	HostSim_SystemReset(HOSTSIM_RESET_SOFTWARE);
+	while (1);
+}
+
+/*******************************************************************************
+*       @details
+*   Deliver pending, enabled interrupts in priority order.  Called with the
+*   clock signal blocked, so a handler always runs to completion before the
+*   next tick, as an exception would.
+*******************************************************************************/
+static void hostSim_Dispatch(void)
+{
+	for (U_INT32 nCount = 0; (nCount < MAX_DISPATCH_PER_TICK) && !m_bPrimask; nCount++)
+	{
+		INT32 nBest = NO_PENDING_IRQ;
+		U_INT32 nBestPriority = 0x100;
+
+		if (m_bSysTickPending && (SysTick_Handler != NULL))
+		{
+			nBest = SysTick_IRQn;
+			nBestPriority = SCB->SHP[11];
+		}
+		for (INT32 nIRQ = 0; nIRQ < NUM_IRQS; nIRQ++)
+		{
+			U_INT32 nBit = 1ul << (nIRQ & 0x1F);
+			if ((m_nPending[nIRQ >> 5] & m_nEnabled[nIRQ >> 5] & nBit) &&
+			    (NVIC->IP[nIRQ] < nBestPriority))
+			{
+				nBest = nIRQ;
+				nBestPriority = NVIC->IP[nIRQ];
+			}
+		}
+		if ((nBest == NO_PENDING_IRQ) || ((m_nBasepri != 0) && (nBestPriority >= m_nBasepri)))
+		{
+			return;
+		}
+		HostSim_NvicSetPending((IRQn_Type)nBest, 0);
+		m_nActiveIRQ = (U_INT32)(nBest + 16);
+		m_nIrqCount++;
+		if (nBest == SysTick_IRQn)
+		{
+			SysTick_Handler();
+		}
+		else if (m_Vectors[nBest] != NULL)
+		{
+			m_Vectors[nBest]();
+		}
+		m_nActiveIRQ = 0;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_EnableIrq(void)
+{
+	sigset_t oldMask;
+
+	sigprocmask(SIG_BLOCK, &m_TickMask, &oldMask);
+	m_bPrimask = 0;
+	if (m_nActiveIRQ == 0)
+	{
+		hostSim_Dispatch();
+	}
+	sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_DisableIrq(void)
+{
+	m_bPrimask = 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+uint32_t HostSim_GetPrimask(void)
+{
+	return (uint32_t)m_bPrimask;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+uint32_t HostSim_GetBasepri(void)
+{
+	return m_nBasepri;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_SetBasepri(uint32_t nBasepri)
+{
+	sigset_t oldMask;
+
+	sigprocmask(SIG_BLOCK, &m_TickMask, &oldMask);
+	m_nBasepri = nBasepri;
+	if (m_nActiveIRQ == 0)
+	{
+		hostSim_Dispatch();
+	}
+	sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+uint32_t HostSim_GetIpsr(void)
+{
+	return m_nActiveIRQ;
+}
+
+/*******************************************************************************
+*       @details
+*   WFI parks the process until an interrupt is pending or has been taken,
+*   so idle time shows up as sleep in the profiler instead of as superloop
+*   spinning.  As on the core, a pending interrupt ends the wait even when
+*   PRIMASK holds it off.
+*******************************************************************************/
+void HostSim_WaitForInterrupt(void)
+{
+	sigset_t oldMask, waitMask;
+	U_INT32 nIrqCount;
+
+	sigprocmask(SIG_BLOCK, &m_TickMask, &oldMask);
+	waitMask = oldMask;
+	sigdelset(&waitMask, SIGALRM);
+	nIrqCount = m_nIrqCount;
+	while ((m_nIrqCount == nIrqCount) && !hostSim_IrqPending())
+	{
+		sigsuspend(&waitMask);
+	}
+	sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL hostSim_IrqPending(void)
+{
+	if (m_bSysTickPending)
+	{
+		return TRUE;
+	}
+	for (U_INT32 nWord = 0; nWord < NUM_IRQ_WORDS; nWord++)
+	{
+		if (m_nPending[nWord] & m_nEnabled[nWord])
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_Breakpoint(uint32_t nValue)
+{
+	HostSim_Log("BKPT #%lu hit, stopping", (unsigned long)nValue);
+	abort();
+}
+
+/*******************************************************************************
+*       @details
+*   Re-executes the image.  The DataFlash image and the backup SRAM file are
+*   shared mappings, so like the real parts they keep their contents.
+*******************************************************************************/
+void HostSim_SystemReset(HOSTSIM_RESET_CAUSE eCause)
+{
+	static const struct itimerval stopTimer = { { 0, 0 }, { 0, 0 } };
+	static const char *pszCause[] = { "power on", "software", "watchdog" };
+
+	HostSim_Log("%s reset", pszCause[eCause]);
+	setitimer(ITIMER_REAL, &stopTimer, NULL);
+	setenv("HOSTSIM_RESET_CAUSE", (eCause == HOSTSIM_RESET_WATCHDOG) ? "2" : "1", 1);
+	// the backup domain is only reset by power on
+	setenv("HOSTSIM_BACKUP_REGULATOR", (PWR->CSR & PWR_CSR_BRE) ? "1" : "0", 1);
+	execv("/proc/self/exe", m_pArgv);
+	HostSim_Log("reset failed: %s", strerror(errno));
+	_exit(EXIT_FAILURE);
+}
+
+/*******************************************************************************
+*       @details
+*   The simulated hardware clock.  Runs as a signal handler with the clock
+*   signal blocked, so models and interrupt handlers never nest.
+*******************************************************************************/
+static void hostSim_ClockTick(int nSignal)
+{
+	int nSavedErrno = errno;
+
+	(void)nSignal;
+	m_nTicks++;
+	HostSim_SystemStep();
+	HostSim_DmaStep();
+	HostSim_UsartStep();
+	HostSim_SpiStep();
+	HostSim_AnalogStep();
+	if (m_nActiveIRQ == 0)
+	{
+		hostSim_Dispatch();
+	}
+	if ((m_nRunTicks != 0) && (m_nTicks >= m_nRunTicks))
+	{
+		exit(EXIT_SUCCESS);
+	}
+	errno = nSavedErrno;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_Shutdown(int nSignal)
+{
+	(void)nSignal;
+	exit(EXIT_SUCCESS);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_Report(void)
+{
+	static const struct itimerval stopTimer = { { 0, 0 }, { 0, 0 } };
+
+	setitimer(ITIMER_REAL, &stopTimer, NULL);
+	HostSim_Log("ran %lu ms, %lu interrupts delivered",
+	            (unsigned long)m_nTicks, (unsigned long)m_nIrqCount);
+	HostSim_UsartReport();
+	HostSim_SpiReport();
+	HostSim_FlashReport();
+}
+
+/*******************************************************************************
+*       @details
+*   Runs before main(), taking the place of the reset vector: bring up the
+*   register map, wire the board, start the hardware clock and call
+*   SystemInit() as the startup code does.
+*******************************************************************************/
+__attribute__((constructor))
+static void hostSim_PowerOn(int argc, char **argv)
+{
+	struct sigaction action;
+	struct itimerval tickTimer;
+	HOSTSIM_RESET_CAUSE eCause;
+
+	(void)argc;
+	m_pArgv = argv;
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	eCause = (HOSTSIM_RESET_CAUSE)HostSim_GetSetting("HOSTSIM_RESET_CAUSE", HOSTSIM_RESET_POWER_ON);
+	unsetenv("HOSTSIM_RESET_CAUSE");
+
+	hostSim_MapRegions();
+	hostSim_MapBackupSram();
+	hostSim_ResetValues(eCause);
+	if (HostSim_GetSetting("HOSTSIM_BACKUP_REGULATOR", 0) != 0)
+	{
+		PWR->CSR |= PWR_CSR_BRE | PWR_CSR_BRR;
+	}
+	unsetenv("HOSTSIM_BACKUP_REGULATOR");
+	m_bWatchdogModel = HostSim_GetSetting("HOSTSIM_WATCHDOG", 1) != 0;
+	m_nRunTicks = (U_INT32)HostSim_GetSetting("HOSTSIM_RUN_MS", 0);
+	m_nRandomState = 0x9E3779B97F4A7C15ull ^ (U_INT64)HostSim_GetSetting("HOSTSIM_SEED", 1);
+	HostSim_BoardInitialize();
+
+	sigemptyset(&m_TickMask);
+	sigaddset(&m_TickMask, SIGALRM);
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = hostSim_ClockTick;
+	action.sa_mask = m_TickMask;
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGALRM, &action, NULL);
+	action.sa_handler = hostSim_Shutdown;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	sigprocmask(SIG_UNBLOCK, &m_TickMask, NULL);
+	atexit(hostSim_Report);
+
+	tickTimer.it_interval.tv_sec = 0;
+	tickTimer.it_interval.tv_usec = HOSTSIM_TICK_MICRO_SECONDS;
+	tickTimer.it_value = tickTimer.it_interval;
+	setitimer(ITIMER_REAL, &tickTimer, NULL);
+
+	SystemInit();
+}
@@ -0,0 +1,300 @@
+/*******************************************************************************
+*       @brief      DMA1/DMA2 stream model shared by the peripheral models.
+*                   A peripheral finds the stream pointed at its data register
+*                   and moves items through it, this module keeps NDTR, the
+*                   memory position, circular reload and the HT/TC flags and
+*                   interrupts as the DMA controller does.
+*       @file       Downhole/HostSim/src/HostSim_Dma.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define NUM_STREAMS             16
+#define STREAM_STRIDE           0x18
+
+#define FLAG_TCIF               0x20ul
+#define FLAG_HTIF               0x10ul
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	BOOL bEnabled;		// EN as seen at the last step, to catch the edge
+	U_INT32 nReload;	// NDTR programmed when the stream was enabled
+} HOSTSIM_DMA_STREAM;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const IRQn_Type m_eStreamIRQ[NUM_STREAMS] =
+{
+	DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+	DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+	DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+	DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn,
+};
+
+static const U_BYTE m_nFlagShift[4] = { 0, 6, 16, 22 };
+
+static HOSTSIM_DMA_STREAM m_Streams[NUM_STREAMS];
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static DMA_Stream_TypeDef *hostSim_DmaStream(U_INT32 nIndex)
+{
+	uintptr_t nBase = (nIndex < 8) ? (uintptr_t)DMA1_Stream0 : (uintptr_t)DMA2_Stream0;
+	return (DMA_Stream_TypeDef *)(nBase + ((nIndex & 7) * STREAM_STRIDE));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 hostSim_DmaIndex(DMA_Stream_TypeDef *pStream)
+{
+	uintptr_t nAddress = (uintptr_t)pStream;
+
+	if (nAddress >= (uintptr_t)DMA2_Stream0)
+	{
+		return 8 + (U_INT32)((nAddress - (uintptr_t)DMA2_Stream0) / STREAM_STRIDE);
+	}
+	return (U_INT32)((nAddress - (uintptr_t)DMA1_Stream0) / STREAM_STRIDE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_DmaSetFlag(U_INT32 nIndex, U_INT32 nFlag)
+{
+	DMA_TypeDef *pDMA = (nIndex < 8) ? DMA1 : DMA2;
+	U_INT32 nShifted = nFlag << m_nFlagShift[nIndex & 3];
+
+	if ((nIndex & 7) < 4)
+	{
+		pDMA->LISR |= nShifted;
+	}
+	else
+	{
+		pDMA->HISR |= nShifted;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The interrupt flag clear registers are write-one-to-clear and read as
+*   zero.
+*******************************************************************************/
+static void hostSim_DmaApplyClears(DMA_TypeDef *pDMA)
+{
+	pDMA->LISR &= ~pDMA->LIFCR;
+	pDMA->HISR &= ~pDMA->HIFCR;
+	pDMA->LIFCR = 0;
+	pDMA->HIFCR = 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_DmaStep(void)
+{
+	hostSim_DmaApplyClears(DMA1);
+	hostSim_DmaApplyClears(DMA2);
+	for (U_INT32 i = 0; i < NUM_STREAMS; i++)
+	{
+		DMA_Stream_TypeDef *pStream = hostSim_DmaStream(i);
+		BOOL bEnabled = (pStream->CR & DMA_SxCR_EN) != 0;
+
+		// a stream reprogrammed without a visible disable still starts over
+		if ((bEnabled && !m_Streams[i].bEnabled) || (pStream->NDTR > m_Streams[i].nReload))
+		{
+			m_Streams[i].nReload = pStream->NDTR & 0xFFFF;
+		}
+		m_Streams[i].bEnabled = bEnabled;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Find the enabled stream that serves a peripheral data register in the
+*   given direction (DMA_DIR_PeripheralToMemory or DMA_DIR_MemoryToPeripheral).
+*******************************************************************************/
+DMA_Stream_TypeDef *HostSim_DmaFindStream(volatile void *pRegister, U_INT32 nDirection)
+{
+	U_INT32 nAddress = (U_INT32)(uintptr_t)pRegister;
+
+	for (U_INT32 i = 0; i < NUM_STREAMS; i++)
+	{
+		DMA_Stream_TypeDef *pStream = hostSim_DmaStream(i);
+
+		if (((pStream->CR & DMA_SxCR_EN) != 0) && (pStream->PAR == nAddress) &&
+		    ((pStream->CR & DMA_SxCR_DIR) == nDirection) && (pStream->NDTR != 0))
+		{
+			if (!m_Streams[i].bEnabled || (m_Streams[i].nReload == 0))
+			{
+				m_Streams[i].bEnabled = TRUE;
+				m_Streams[i].nReload = pStream->NDTR & 0xFFFF;
+			}
+			return pStream;
+		}
+	}
+	return NULL;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static volatile U_BYTE *hostSim_DmaMemory(DMA_Stream_TypeDef *pStream, U_INT32 *pSize)
+{
+	U_INT32 nIndex = hostSim_DmaIndex(pStream);
+	U_INT32 nSize = 1ul << ((pStream->CR & DMA_SxCR_MSIZE) >> 13);
+	U_INT32 nPosition = 0;
+
+	if (pStream->CR & DMA_SxCR_MINC)
+	{
+		nPosition = (m_Streams[nIndex].nReload - pStream->NDTR) * nSize;
+	}
+	*pSize = nSize;
+	return (volatile U_BYTE *)(uintptr_t)(pStream->M0AR + nPosition);
+}
+
+/*******************************************************************************
+*       @details
+*   Account for one item moved: half transfer and transfer complete flags,
+*   circular reload or end of transfer.
+*******************************************************************************/
+static void hostSim_DmaAdvance(DMA_Stream_TypeDef *pStream)
+{
+	U_INT32 nIndex = hostSim_DmaIndex(pStream);
+	U_INT32 nReload = m_Streams[nIndex].nReload;
+	U_INT32 nRemaining = pStream->NDTR - 1;
+	BOOL bInterrupt = FALSE;
+
+	pStream->NDTR = nRemaining;
+	if (nRemaining == (nReload / 2))
+	{
+		hostSim_DmaSetFlag(nIndex, FLAG_HTIF);
+		bInterrupt |= (pStream->CR & DMA_SxCR_HTIE) != 0;
+	}
+	if (nRemaining == 0)
+	{
+		hostSim_DmaSetFlag(nIndex, FLAG_TCIF);
+		bInterrupt |= (pStream->CR & DMA_SxCR_TCIE) != 0;
+		if (pStream->CR & DMA_SxCR_CIRC)
+		{
+			pStream->NDTR = nReload;
+		}
+		else
+		{
+			pStream->CR &= ~DMA_SxCR_EN;
+			m_Streams[nIndex].bEnabled = FALSE;
+		}
+	}
+	if (bInterrupt)
+	{
+		HostSim_SetPending(m_eStreamIRQ[nIndex]);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Peripheral to memory: store one item, returns FALSE once the stream has
+*   stopped.
+*******************************************************************************/
+BOOL HostSim_DmaWriteItem(DMA_Stream_TypeDef *pStream, U_INT32 nValue)
+{
+	U_INT32 nSize;
+	volatile U_BYTE *pMemory;
+
+	if ((pStream->CR & DMA_SxCR_EN) == 0 || pStream->NDTR == 0)
+	{
+		return FALSE;
+	}
+	pMemory = hostSim_DmaMemory(pStream, &nSize);
+	switch (nSize)
+	{
+		case 1:
+			*pMemory = (U_BYTE)nValue;
+			break;
+		case 2:
+			*(volatile U_INT16 *)pMemory = (U_INT16)nValue;
+			break;
+		default:
+			*(volatile U_INT32 *)pMemory = nValue;
+			break;
+	}
+	hostSim_DmaAdvance(pStream);
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Memory to peripheral: fetch one item, returns FALSE once the stream has
+*   stopped.
+*******************************************************************************/
+BOOL HostSim_DmaReadItem(DMA_Stream_TypeDef *pStream, U_INT32 *pValue)
+{
+	U_INT32 nSize;
+	volatile U_BYTE *pMemory;
+
+	if ((pStream->CR & DMA_SxCR_EN) == 0 || pStream->NDTR == 0)
+	{
+		return FALSE;
+	}
+	pMemory = hostSim_DmaMemory(pStream, &nSize);
+	switch (nSize)
+	{
+		case 1:
+			*pValue = *pMemory;
+			break;
+		case 2:
+			*pValue = *(volatile U_INT16 *)pMemory;
+			break;
+		default:
+			*pValue = *(volatile U_INT32 *)pMemory;
+			break;
+	}
+	hostSim_DmaAdvance(pStream);
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Flags cleared from an interrupt handler must be gone before the handler
+*   re-reads them, not at the next tick.
+*******************************************************************************/
+extern void __real_DMA_ClearFlag(DMA_Stream_TypeDef *DMAy_Streamx, uint32_t DMA_FLAG);
+void __wrap_DMA_ClearFlag(DMA_Stream_TypeDef *DMAy_Streamx, uint32_t DMA_FLAG)
+{
+	__real_DMA_ClearFlag(DMAy_Streamx, DMA_FLAG);
+	hostSim_DmaApplyClears((DMAy_Streamx < DMA2_Stream0) ? DMA1 : DMA2);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+extern void __real_DMA_ClearITPendingBit(DMA_Stream_TypeDef *DMAy_Streamx, uint32_t DMA_IT);
+void __wrap_DMA_ClearITPendingBit(DMA_Stream_TypeDef *DMAy_Streamx, uint32_t DMA_IT)
+{
+	__real_DMA_ClearITPendingBit(DMAy_Streamx, DMA_IT);
+	hostSim_DmaApplyClears((DMAy_Streamx < DMA2_Stream0) ? DMA1 : DMA2);
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+*       @brief      Internal flash controller model.  An erase sets a sector
+*                   to 0xFF and programming can only clear bits, as on the
+*                   part, so a copy made without the erase shows.
+*       @file       Downhole/HostSim/src/HostSim_Flash.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The internal flash is host memory mapped at FLASH_BASE.  The library's
+// erase and program calls wait on the busy flag of a controller there is
+// no model of, so they are replaced here, the rest of the library works on
+// the registers as they are.  CR comes out of reset locked and the key
+// sequence of FLASH_Unlock() is taken as written right; an erase or a
+// program while locked is refused and counted.
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define FLASH_MODEL_SIZE        0x00100000ul
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// sector sizes of the 1 Mbyte part, four of 16K, one of 64K, seven of 128K
+static const U_INT32 m_nSectorSize[] =
+{
+	0x4000, 0x4000, 0x4000, 0x4000, 0x10000,
+	0x20000, 0x20000, 0x20000, 0x20000, 0x20000, 0x20000, 0x20000
+};
+#define FLASH_MODEL_SECTORS     (sizeof(m_nSectorSize) / sizeof(m_nSectorSize[0]))
+
+static U_INT32 m_nErases;
+static U_INT32 m_nPrograms;
+static U_INT32 m_nRefused;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_FLASH_Unlock(void)
+{
+	FLASH->CR &= ~FLASH_CR_LOCK;
+}
+
+/*******************************************************************************
+*       @details
+*   FLASH_Sector_x is the sector number shifted up to the SNB field.
+*******************************************************************************/
+FLASH_Status __wrap_FLASH_EraseSector(uint32_t FLASH_Sector, uint8_t VoltageRange)
+{
+	U_INT32 nSector = FLASH_Sector >> 3;
+	U_INT32 nAddress = FLASH_BASE;
+	U_INT32 i;
+
+	(void)VoltageRange;
+	if (((FLASH->CR & FLASH_CR_LOCK) != 0) || (nSector >= FLASH_MODEL_SECTORS))
+	{
+		m_nRefused++;
+		return FLASH_ERROR_PROGRAM;
+	}
+	for (i = 0; i < nSector; i++)
+	{
+		nAddress += m_nSectorSize[i];
+	}
+	memset((void *)(uintptr_t)nAddress, 0xFF, m_nSectorSize[nSector]);
+	m_nErases++;
+	return FLASH_COMPLETE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+FLASH_Status __wrap_FLASH_ProgramWord(uint32_t Address, uint32_t Data)
+{
+	if (((FLASH->CR & FLASH_CR_LOCK) != 0) || ((Address & 3) != 0) || (Address < FLASH_BASE) ||
+	    (Address >= (FLASH_BASE + FLASH_MODEL_SIZE)))
+	{
+		m_nRefused++;
+		return FLASH_ERROR_PROGRAM;
+	}
+	*(volatile U_INT32 *)(uintptr_t)Address &= Data;
+	m_nPrograms++;
+	return FLASH_COMPLETE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_FlashReport(void)
+{
+	if ((m_nErases | m_nPrograms | m_nRefused) != 0)
+	{
+		HostSim_Log("internal flash: %lu sector erases, %lu words programmed, %lu refused",
+		            (unsigned long)m_nErases, (unsigned long)m_nPrograms, (unsigned long)m_nRefused);
+	}
+}
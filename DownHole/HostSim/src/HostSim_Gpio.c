@@ -0,0 +1,97 @@
+/*******************************************************************************
+*       @brief      GPIO output model.  BSRR is write-only set/reset on the
+*                   part, here the writes are applied to ODR and fed back to
+*                   IDR so outputs read back and chip selects can be followed.
+*       @file       Downhole/HostSim/src/HostSim_Gpio.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "HostSim.h"
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_GpioUpdate(GPIO_TypeDef *pGPIO, U_INT32 nODR)
+{
+	pGPIO->ODR = nODR & 0xFFFF;
+	pGPIO->IDR = nODR & 0xFFFF;
+	HostSim_SpiChipSelectChanged(pGPIO);
+}
+
+/*******************************************************************************
+*       @details
+*   Catches direct BSRR writes that did not go through the library.
+*******************************************************************************/
+void HostSim_GpioStep(void)
+{
+	for (uintptr_t nPort = GPIOA_BASE; nPort <= GPIOI_BASE; nPort += 0x400)
+	{
+		GPIO_TypeDef *pGPIO = (GPIO_TypeDef *)nPort;
+
+		if ((pGPIO->BSRRL | pGPIO->BSRRH) != 0)
+		{
+			U_INT32 nODR = (pGPIO->ODR | pGPIO->BSRRL) & ~(U_INT32)pGPIO->BSRRH;
+			pGPIO->BSRRL = 0;
+			pGPIO->BSRRH = 0;
+			hostSim_GpioUpdate(pGPIO, nODR);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	hostSim_GpioUpdate(GPIOx, GPIOx->ODR | GPIO_Pin);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	hostSim_GpioUpdate(GPIOx, GPIOx->ODR & ~(U_INT32)GPIO_Pin);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_GPIO_WriteBit(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, BitAction BitVal)
+{
+	if (BitVal != Bit_RESET)
+	{
+		hostSim_GpioUpdate(GPIOx, GPIOx->ODR | GPIO_Pin);
+	}
+	else
+	{
+		hostSim_GpioUpdate(GPIOx, GPIOx->ODR & ~(U_INT32)GPIO_Pin);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_GPIO_Write(GPIO_TypeDef *GPIOx, uint16_t PortVal)
+{
+	hostSim_GpioUpdate(GPIOx, PortVal);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_GPIO_ToggleBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	hostSim_GpioUpdate(GPIOx, GPIOx->ODR ^ GPIO_Pin);
+}
@@ -0,0 +1,465 @@
+/*******************************************************************************
+*       @brief      SPI bus model with an Atmel/Adesto AT45DB321 DataFlash on
+*                   a GPIO chip select.  The array is a memory mapped host
+*                   file, so stored data survives resets and runs.
+*       @file       Downhole/HostSim/src/HostSim_Spi.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The AT45DB321 in its default 528 byte page mode: 8192 pages, two SRAM
+// buffers, addresses of 13 page bits and 10 byte bits.  Command timing is
+// the datasheet typical value, the status register reports busy until then.
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define AT45_PAGES              8192ul
+#define AT45_PAGE_SIZE          528ul
+#define AT45_PAGES_PER_BLOCK    8ul
+#define AT45_ARRAY_SIZE         (AT45_PAGES * AT45_PAGE_SIZE)
+#define AT45_STATUS_READY       0x80
+#define AT45_STATUS_DENSITY     0x34	// 32 Mbit, 528 byte pages
+
+#define AT45_PAGE_PROGRAM_MS    3
+#define AT45_ERASE_PROGRAM_MS   17
+#define AT45_PAGE_ERASE_MS      15
+#define AT45_BLOCK_ERASE_MS     45
+#define AT45_TRANSFER_MS        1
+#define AT45_CHIP_ERASE_MS      40000
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	SPI_TypeDef *pSPI;
+	GPIO_TypeDef *pCSPort;
+	U_INT16 nCSPin;
+	BOOL bSelected;
+	U_BYTE *pArray;
+	U_BYTE nBuffer[2][AT45_PAGE_SIZE];
+	U_INT32 nBusyUntil;
+	// command in progress while selected
+	U_BYTE nCommand[8];
+	U_INT32 nIndex;
+	U_INT32 nPage;
+	U_INT32 nOffset;
+	// statistics
+	U_INT32 nReads;
+	U_INT32 nPrograms;
+	U_INT32 nErases;
+	U_INT32 nIgnored;
+} HOSTSIM_DATAFLASH;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static HOSTSIM_DATAFLASH m_DataFlash;
+static U_INT32 m_nSpiBudget;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_SpiAttachDataFlash(SPI_TypeDef *pSPI, GPIO_TypeDef *pCSPort,
+                                U_INT16 nCSPin, const char *pszImage)
+{
+	HOSTSIM_DATAFLASH *pFlash = &m_DataFlash;
+	struct stat status;
+	off_t nOldSize = 0;
+	int nFd;
+
+	memset(pFlash, 0, sizeof(*pFlash));
+	pFlash->pSPI = pSPI;
+	pFlash->pCSPort = pCSPort;
+	pFlash->nCSPin = nCSPin;
+	memset(pFlash->nBuffer, 0xFF, sizeof(pFlash->nBuffer));
+
+	nFd = open(pszImage, O_RDWR | O_CREAT, 0644);
+	if ((nFd >= 0) && (fstat(nFd, &status) == 0))
+	{
+		nOldSize = status.st_size;
+		if ((nOldSize < (off_t)AT45_ARRAY_SIZE) && (ftruncate(nFd, AT45_ARRAY_SIZE) != 0))
+		{
+			close(nFd);
+			nFd = -1;
+		}
+	}
+	if (nFd >= 0)
+	{
+		pFlash->pArray = mmap(NULL, AT45_ARRAY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+		close(nFd);
+	}
+	if ((nFd < 0) || (pFlash->pArray == MAP_FAILED))
+	{
+		HostSim_Log("DataFlash: cannot map %s (%s), contents will not persist",
+		            pszImage, strerror(errno));
+		pFlash->pArray = mmap(NULL, AT45_ARRAY_SIZE, PROT_READ | PROT_WRITE,
+		                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		nOldSize = 0;
+	}
+	// an erased part reads all ones
+	if (nOldSize < (off_t)AT45_ARRAY_SIZE)
+	{
+		memset(&pFlash->pArray[nOldSize], 0xFF, AT45_ARRAY_SIZE - (size_t)nOldSize);
+	}
+	HostSim_Log("DataFlash image %s", pszImage);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL hostSim_DataFlashBusy(const HOSTSIM_DATAFLASH *pFlash)
+{
+	return (INT32)(HostSim_GetTicks() - pFlash->nBusyUntil) < 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_BYTE *hostSim_DataFlashPage(HOSTSIM_DATAFLASH *pFlash, U_INT32 nPage)
+{
+	return &pFlash->pArray[(nPage % AT45_PAGES) * AT45_PAGE_SIZE];
+}
+
+/*******************************************************************************
+*       @details
+*   Number of address and dummy bytes that follow each opcode.
+*******************************************************************************/
+static U_INT32 hostSim_DataFlashHeaderLength(U_BYTE nOpcode)
+{
+	switch (nOpcode)
+	{
+		case 0xD2: case 0xE8:			// page read, legacy continuous read
+			return 8;
+		case 0x0B:				// continuous read, high frequency
+			return 5;
+		case 0xD4: case 0xD6:			// buffer read with dummy byte
+			return 5;
+		case 0x9F: case 0xD7:			// ID and status have no address
+			return 1;
+		default:
+			return 4;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Returns the byte shifted out on MISO while nMosi is shifted in.
+*******************************************************************************/
+static U_BYTE hostSim_DataFlashTransfer(HOSTSIM_DATAFLASH *pFlash, U_BYTE nMosi)
+{
+	static const U_BYTE nDeviceID[] = { 0x1F, 0x27, 0x01, 0x01, 0x00 };
+	U_BYTE nOpcode = pFlash->nCommand[0];
+	U_INT32 nHeader;
+	U_BYTE nMiso = 0xFF;
+
+	if (pFlash->nIndex < sizeof(pFlash->nCommand))
+	{
+		pFlash->nCommand[pFlash->nIndex] = nMosi;
+	}
+	if (pFlash->nIndex == 0)
+	{
+		pFlash->nIndex++;
+		return nMiso;
+	}
+	if (pFlash->nIndex == 3)
+	{
+		U_INT32 nAddress = ((U_INT32)pFlash->nCommand[1] << 16) |
+		                   ((U_INT32)pFlash->nCommand[2] << 8) | nMosi;
+		pFlash->nPage = (nAddress >> 10) & (AT45_PAGES - 1);
+		pFlash->nOffset = nAddress & 0x3FF;
+	}
+	nHeader = hostSim_DataFlashHeaderLength(nOpcode);
+	if (pFlash->nIndex >= nHeader)
+	{
+		U_INT32 nData = pFlash->nIndex - nHeader;
+
+		switch (nOpcode)
+		{
+			case 0xD7:
+				nMiso = AT45_STATUS_DENSITY | (hostSim_DataFlashBusy(pFlash) ? 0 : AT45_STATUS_READY);
+				break;
+			case 0x9F:
+				nMiso = (nData < sizeof(nDeviceID)) ? nDeviceID[nData] : 0x00;
+				break;
+			case 0xD2:
+				// a main memory page read wraps within the page
+				if (!hostSim_DataFlashBusy(pFlash))
+				{
+					nMiso = hostSim_DataFlashPage(pFlash, pFlash->nPage)[pFlash->nOffset % AT45_PAGE_SIZE];
+				}
+				pFlash->nOffset = (pFlash->nOffset + 1) % AT45_PAGE_SIZE;
+				break;
+			case 0x03: case 0x0B: case 0xE8:
+				// continuous reads carry on into the next page
+				if (!hostSim_DataFlashBusy(pFlash))
+				{
+					nMiso = hostSim_DataFlashPage(pFlash, pFlash->nPage)[pFlash->nOffset % AT45_PAGE_SIZE];
+				}
+				if (++pFlash->nOffset >= AT45_PAGE_SIZE)
+				{
+					pFlash->nOffset = 0;
+					pFlash->nPage = (pFlash->nPage + 1) % AT45_PAGES;
+				}
+				break;
+			case 0xD1: case 0xD4:
+			case 0xD3: case 0xD6:
+				nMiso = pFlash->nBuffer[(nOpcode == 0xD1 || nOpcode == 0xD4) ? 0 : 1][pFlash->nOffset % AT45_PAGE_SIZE];
+				pFlash->nOffset = (pFlash->nOffset + 1) % AT45_PAGE_SIZE;
+				break;
+			case 0x84: case 0x82:
+			case 0x87: case 0x85:
+				// buffer writes are allowed during an array operation
+				pFlash->nBuffer[(nOpcode == 0x84 || nOpcode == 0x82) ? 0 : 1][pFlash->nOffset % AT45_PAGE_SIZE] = nMosi;
+				pFlash->nOffset = (pFlash->nOffset + 1) % AT45_PAGE_SIZE;
+				break;
+			default:
+				break;
+		}
+	}
+	pFlash->nIndex++;
+	return nMiso;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_DataFlashProgram(HOSTSIM_DATAFLASH *pFlash, U_INT32 nBuffer, BOOL bErase)
+{
+	U_BYTE *pPage = hostSim_DataFlashPage(pFlash, pFlash->nPage);
+
+	if (bErase)
+	{
+		memcpy(pPage, pFlash->nBuffer[nBuffer], AT45_PAGE_SIZE);
+		pFlash->nErases++;
+	}
+	else
+	{
+		// programming can only clear bits
+		for (U_INT32 i = 0; i < AT45_PAGE_SIZE; i++)
+		{
+			pPage[i] &= pFlash->nBuffer[nBuffer][i];
+		}
+	}
+	pFlash->nPrograms++;
+	pFlash->nBusyUntil = HostSim_GetTicks() + (bErase ? AT45_ERASE_PROGRAM_MS : AT45_PAGE_PROGRAM_MS);
+}
+
+/*******************************************************************************
+*       @details
+*   Array operations start when chip select goes high at the end of the
+*   command.
+*******************************************************************************/
+static void hostSim_DataFlashDeselect(HOSTSIM_DATAFLASH *pFlash)
+{
+	U_BYTE nOpcode = pFlash->nCommand[0];
+	BOOL bAddressed = pFlash->nIndex >= 4;
+
+	if (!bAddressed || (pFlash->nIndex == 0))
+	{
+		if ((pFlash->nIndex == 4) && (memcmp(pFlash->nCommand, "\xC7\x94\x80\x9A", 4) == 0))
+		{
+			// chip erase
+			memset(pFlash->pArray, 0xFF, AT45_ARRAY_SIZE);
+			pFlash->nErases += AT45_PAGES;
+			pFlash->nBusyUntil = HostSim_GetTicks() + AT45_CHIP_ERASE_MS;
+		}
+		return;
+	}
+	switch (nOpcode)
+	{
+		case 0x83: case 0x86: case 0x88: case 0x89:
+		case 0x81: case 0x50: case 0x53: case 0x55:
+		case 0x82: case 0x85:
+			if (hostSim_DataFlashBusy(pFlash))
+			{
+				pFlash->nIgnored++;
+				return;
+			}
+			break;
+		default:
+			break;
+	}
+	switch (nOpcode)
+	{
+		case 0x83: case 0x82:
+			hostSim_DataFlashProgram(pFlash, 0, TRUE);
+			break;
+		case 0x86: case 0x85:
+			hostSim_DataFlashProgram(pFlash, 1, TRUE);
+			break;
+		case 0x88:
+			hostSim_DataFlashProgram(pFlash, 0, FALSE);
+			break;
+		case 0x89:
+			hostSim_DataFlashProgram(pFlash, 1, FALSE);
+			break;
+		case 0x81:
+			memset(hostSim_DataFlashPage(pFlash, pFlash->nPage), 0xFF, AT45_PAGE_SIZE);
+			pFlash->nErases++;
+			pFlash->nBusyUntil = HostSim_GetTicks() + AT45_PAGE_ERASE_MS;
+			break;
+		case 0x50:
+			memset(hostSim_DataFlashPage(pFlash, pFlash->nPage & ~(AT45_PAGES_PER_BLOCK - 1)),
+			       0xFF, AT45_PAGE_SIZE * AT45_PAGES_PER_BLOCK);
+			pFlash->nErases += AT45_PAGES_PER_BLOCK;
+			pFlash->nBusyUntil = HostSim_GetTicks() + AT45_BLOCK_ERASE_MS;
+			break;
+		case 0x53: case 0x55:
+			memcpy(pFlash->nBuffer[(nOpcode == 0x53) ? 0 : 1],
+			       hostSim_DataFlashPage(pFlash, pFlash->nPage), AT45_PAGE_SIZE);
+			pFlash->nBusyUntil = HostSim_GetTicks() + AT45_TRANSFER_MS;
+			break;
+		case 0xD2: case 0x03: case 0x0B: case 0xE8:
+			pFlash->nReads++;
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Called after any GPIO output change, follows the chip select line.
+*******************************************************************************/
+void HostSim_SpiChipSelectChanged(GPIO_TypeDef *pGPIO)
+{
+	HOSTSIM_DATAFLASH *pFlash = &m_DataFlash;
+	BOOL bSelected;
+
+	if ((pFlash->pArray == NULL) || (pGPIO != pFlash->pCSPort))
+	{
+		return;
+	}
+	bSelected = (pGPIO->ODR & pFlash->nCSPin) == 0;
+	if (bSelected && !pFlash->bSelected)
+	{
+		pFlash->nIndex = 0;
+		memset(pFlash->nCommand, 0, sizeof(pFlash->nCommand));
+	}
+	else if (!bSelected && pFlash->bSelected)
+	{
+		hostSim_DataFlashDeselect(pFlash);
+	}
+	pFlash->bSelected = bSelected;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_BYTE hostSim_SpiExchange(SPI_TypeDef *pSPI, U_BYTE nMosi)
+{
+	if ((m_DataFlash.pSPI == pSPI) && m_DataFlash.bSelected)
+	{
+		return hostSim_DataFlashTransfer(&m_DataFlash, nMosi);
+	}
+	// nothing drives MISO, the pull up wins
+	return 0xFF;
+}
+
+/*******************************************************************************
+*       @details
+*   DMA driven transfers: every byte the transmit stream hands the bus comes
+*   back through the receive stream, at the SPI clock rate.
+*******************************************************************************/
+void HostSim_SpiStep(void)
+{
+	SPI_TypeDef *pSPI = m_DataFlash.pSPI;
+	DMA_Stream_TypeDef *pTxStream, *pRxStream;
+	RCC_ClocksTypeDef clocks;
+	U_INT32 nValue;
+
+	if ((pSPI == NULL) || ((pSPI->CR1 & SPI_CR1_SPE) == 0) ||
+	    ((pSPI->CR2 & SPI_CR2_TXDMAEN) == 0))
+	{
+		m_nSpiBudget = 0;
+		return;
+	}
+	pTxStream = HostSim_DmaFindStream(&pSPI->DR, DMA_DIR_MemoryToPeripheral);
+	pRxStream = (pSPI->CR2 & SPI_CR2_RXDMAEN) ?
+	            HostSim_DmaFindStream(&pSPI->DR, DMA_DIR_PeripheralToMemory) : NULL;
+	if (pTxStream == NULL)
+	{
+		m_nSpiBudget = 0;
+		return;
+	}
+	RCC_GetClocksFreq(&clocks);
+	// bytes per millisecond at PCLK / 2^(BR+1), eight clocks a byte
+	m_nSpiBudget += ((pSPI == SPI1) ? clocks.PCLK2_Frequency : clocks.PCLK1_Frequency) /
+	                (2ul << ((pSPI->CR1 & SPI_CR1_BR) >> 3)) / 8000ul;
+	while ((m_nSpiBudget != 0) && HostSim_DmaReadItem(pTxStream, &nValue))
+	{
+		U_BYTE nMiso = hostSim_SpiExchange(pSPI, (U_BYTE)nValue);
+
+		m_nSpiBudget--;
+		if (pRxStream != NULL)
+		{
+			(void)HostSim_DmaWriteItem(pRxStream, nMiso);
+		}
+		else
+		{
+			pSPI->DR = nMiso;
+			pSPI->SR |= SPI_SR_RXNE;
+		}
+	}
+	pSPI->SR |= SPI_SR_TXE;
+	pSPI->SR &= ~SPI_SR_BSY;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_SpiReport(void)
+{
+	if (m_DataFlash.pArray != NULL)
+	{
+		HostSim_Log("DataFlash: %lu page reads, %lu programs, %lu page erases, %lu commands ignored while busy",
+		            (unsigned long)m_DataFlash.nReads, (unsigned long)m_DataFlash.nPrograms,
+		            (unsigned long)m_DataFlash.nErases, (unsigned long)m_DataFlash.nIgnored);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   A write to DR clocks one byte each way, the answer is ready at once.
+*******************************************************************************/
+void __wrap_SPI_I2S_SendData(SPI_TypeDef *SPIx, uint16_t Data)
+{
+	if ((SPIx->CR1 & SPI_CR1_SPE) == 0)
+	{
+		return;
+	}
+	SPIx->DR = hostSim_SpiExchange(SPIx, (U_BYTE)Data);
+	SPIx->SR |= SPI_SR_RXNE | SPI_SR_TXE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+uint16_t __wrap_SPI_I2S_ReceiveData(SPI_TypeDef *SPIx)
+{
+	SPIx->SR &= ~SPI_SR_RXNE;
+	return SPIx->DR;
+}
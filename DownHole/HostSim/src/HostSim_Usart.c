@@ -0,0 +1,473 @@
+/*******************************************************************************
+*       @brief      USART model.  Moves bytes between the firmware (through
+*                   DMA or the data register) and a host endpoint or built-in
+*                   device model at the programmed baud rate.
+*       @file       Downhole/HostSim/src/HostSim_Usart.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// Endpoints..
+// "pty"          a pseudo terminal is created and its name logged, connect a
+//                terminal program or a test script to it.
+// "pty:<link>"   as above, plus a symbolic link at <link> to the slave side.
+// "null"         transmitted bytes are dropped, nothing is ever received.
+// anything else  is opened as a host file or serial device.
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+// termios delay masks collide with the peripheral register names
+#undef CR1
+#undef CR2
+#undef CR3
+#include "HostSim.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define MAX_USARTS              4
+#define RX_HOLD_SIZE            256
+// ten bit times per byte, budget kept in byte/1000 units per millisecond tick
+#define BUDGET_PER_BYTE         (10ul * 1000ul)
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	USART_TypeDef *pUSART;
+	const char *pszName;
+	const HOSTSIM_SERIAL_DEVICE *pDevice;
+	int nFd;
+	int nSlaveFd;
+	U_INT32 nTxBudget;
+	U_INT32 nRxBudget;
+	BOOL bTxActive;
+	BOOL bRxActive;
+	U_BYTE nRxHold[RX_HOLD_SIZE];
+	U_INT32 nRxHoldCount;
+	U_INT32 nTxPending;		// byte written to DR, 0x100 flags a valid byte
+	U_INT32 nTxBytes;
+	U_INT32 nRxBytes;
+	U_INT32 nRxDropped;
+} HOSTSIM_USART;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static HOSTSIM_USART m_Usarts[MAX_USARTS];
+static U_INT32 m_nUsarts;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static HOSTSIM_USART *hostSim_UsartFind(USART_TypeDef *pUSART)
+{
+	for (U_INT32 i = 0; i < m_nUsarts; i++)
+	{
+		if (m_Usarts[i].pUSART == pUSART)
+		{
+			return &m_Usarts[i];
+		}
+	}
+	return NULL;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_UsartMakeRaw(int nFd)
+{
+	struct termios tio;
+
+	if (tcgetattr(nFd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tcsetattr(nFd, TCSANOW, &tio);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The slave side is held open so the master never reads EOF/EIO while no
+*   client is attached.
+*******************************************************************************/
+static int hostSim_UsartOpenPty(HOSTSIM_USART *pPort, const char *pszLink)
+{
+	int nFd = posix_openpt(O_RDWR | O_NOCTTY);
+	const char *pszSlave;
+
+	if ((nFd < 0) || (grantpt(nFd) != 0) || (unlockpt(nFd) != 0) ||
+	    ((pszSlave = ptsname(nFd)) == NULL))
+	{
+		HostSim_Log("%s: cannot create a pty: %s", pPort->pszName, strerror(errno));
+		return -1;
+	}
+	pPort->nSlaveFd = open(pszSlave, O_RDWR | O_NOCTTY);
+	if (pPort->nSlaveFd >= 0)
+	{
+		hostSim_UsartMakeRaw(pPort->nSlaveFd);
+	}
+	hostSim_UsartMakeRaw(nFd);
+	if (pszLink != NULL)
+	{
+		(void)unlink(pszLink);
+		if (symlink(pszSlave, pszLink) != 0)
+		{
+			HostSim_Log("%s: cannot link %s: %s", pPort->pszName, pszLink, strerror(errno));
+		}
+	}
+	HostSim_Log("%s on %s%s%s", pPort->pszName, pszSlave,
+	            (pszLink != NULL) ? " -> " : "", (pszLink != NULL) ? pszLink : "");
+	return nFd;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_UsartAttach(USART_TypeDef *pUSART, const char *pszName,
+                         const char *pszEndpoint, const HOSTSIM_SERIAL_DEVICE *pDevice)
+{
+	HOSTSIM_USART *pPort;
+
+	if (m_nUsarts >= MAX_USARTS)
+	{
+		return;
+	}
+	pPort = &m_Usarts[m_nUsarts++];
+	memset(pPort, 0, sizeof(*pPort));
+	pPort->pUSART = pUSART;
+	pPort->pszName = pszName;
+	pPort->pDevice = pDevice;
+	pPort->nFd = -1;
+	pPort->nSlaveFd = -1;
+	if (pDevice != NULL)
+	{
+		HostSim_Log("%s on built-in %s", pszName, pszEndpoint);
+	}
+	else if (strcmp(pszEndpoint, "pty") == 0)
+	{
+		pPort->nFd = hostSim_UsartOpenPty(pPort, NULL);
+	}
+	else if (strncmp(pszEndpoint, "pty:", 4) == 0)
+	{
+		pPort->nFd = hostSim_UsartOpenPty(pPort, &pszEndpoint[4]);
+	}
+	else if (strcmp(pszEndpoint, "null") != 0)
+	{
+		pPort->nFd = open(pszEndpoint, O_RDWR | O_NOCTTY | O_CREAT, 0644);
+		if (pPort->nFd < 0)
+		{
+			HostSim_Log("%s: cannot open %s: %s", pszName, pszEndpoint, strerror(errno));
+		}
+		else
+		{
+			if (isatty(pPort->nFd))
+			{
+				hostSim_UsartMakeRaw(pPort->nFd);
+			}
+			HostSim_Log("%s on %s", pszName, pszEndpoint);
+		}
+	}
+	if (pPort->nFd >= 0)
+	{
+		fcntl(pPort->nFd, F_SETFL, fcntl(pPort->nFd, F_GETFL) | O_NONBLOCK);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 hostSim_UsartBaudRate(USART_TypeDef *pUSART)
+{
+	RCC_ClocksTypeDef clocks;
+	U_INT32 nDivider = pUSART->BRR;
+
+	if (nDivider == 0)
+	{
+		return 0;
+	}
+	RCC_GetClocksFreq(&clocks);
+	if ((pUSART == USART1) || (pUSART == USART6))
+	{
+		return clocks.PCLK2_Frequency / nDivider;
+	}
+	return clocks.PCLK1_Frequency / nDivider;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_UsartTransmit(HOSTSIM_USART *pPort, U_INT32 nBaudRate)
+{
+	USART_TypeDef *pUSART = pPort->pUSART;
+	DMA_Stream_TypeDef *pStream = NULL;
+	U_BYTE nData[256];
+	U_INT32 nCount = 0;
+	U_INT32 nValue;
+
+	pPort->nTxBudget += nBaudRate;
+	if ((pUSART->CR3 & USART_CR3_DMAT) != 0)
+	{
+		pStream = HostSim_DmaFindStream(&pUSART->DR, DMA_DIR_MemoryToPeripheral);
+	}
+	while ((pPort->nTxBudget >= BUDGET_PER_BYTE) && (nCount < sizeof(nData)))
+	{
+		if (pPort->nTxPending & 0x100)
+		{
+			nData[nCount++] = (U_BYTE)pPort->nTxPending;
+			pPort->nTxPending = 0;
+		}
+		else if ((pStream != NULL) && HostSim_DmaReadItem(pStream, &nValue))
+		{
+			nData[nCount++] = (U_BYTE)nValue;
+		}
+		else
+		{
+			break;
+		}
+		pPort->nTxBudget -= BUDGET_PER_BYTE;
+	}
+	if (nCount != 0)
+	{
+		pPort->bTxActive = TRUE;
+		pPort->nTxBytes += nCount;
+		pUSART->SR &= ~USART_SR_TC;
+		if (pPort->pDevice != NULL)
+		{
+			pPort->pDevice->pfReceive(nData, nCount);
+		}
+		else if (pPort->nFd >= 0)
+		{
+			(void)!write(pPort->nFd, nData, nCount);
+		}
+	}
+	else
+	{
+		// an idle line does not save up bit times
+		if (pPort->nTxBudget > BUDGET_PER_BYTE)
+		{
+			pPort->nTxBudget = BUDGET_PER_BYTE;
+		}
+		if (pPort->bTxActive)
+		{
+			// the last stop bit has gone out
+			pPort->bTxActive = FALSE;
+			pUSART->SR |= USART_SR_TC;
+		}
+	}
+	if ((pPort->nTxPending & 0x100) == 0)
+	{
+		pUSART->SR |= USART_SR_TXE;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void hostSim_UsartReceive(HOSTSIM_USART *pPort, U_INT32 nBaudRate)
+{
+	USART_TypeDef *pUSART = pPort->pUSART;
+	DMA_Stream_TypeDef *pStream = NULL;
+	U_INT32 nIndex = 0;
+	BOOL bReceived = FALSE;
+
+	if (pPort->nRxHoldCount < RX_HOLD_SIZE)
+	{
+		U_INT32 nSpace = RX_HOLD_SIZE - pPort->nRxHoldCount;
+		long nRead = 0;
+
+		if (pPort->pDevice != NULL)
+		{
+			nRead = (long)pPort->pDevice->pfTransmit(&pPort->nRxHold[pPort->nRxHoldCount], nSpace);
+		}
+		else if (pPort->nFd >= 0)
+		{
+			nRead = read(pPort->nFd, &pPort->nRxHold[pPort->nRxHoldCount], nSpace);
+		}
+		if (nRead > 0)
+		{
+			pPort->nRxHoldCount += (U_INT32)nRead;
+		}
+	}
+	if ((pUSART->CR1 & USART_CR1_RE) == 0)
+	{
+		pPort->nRxDropped += pPort->nRxHoldCount;
+		pPort->nRxHoldCount = 0;
+		return;
+	}
+	pPort->nRxBudget += nBaudRate;
+	if ((pUSART->CR3 & USART_CR3_DMAR) != 0)
+	{
+		pStream = HostSim_DmaFindStream(&pUSART->DR, DMA_DIR_PeripheralToMemory);
+	}
+	while ((pPort->nRxBudget >= BUDGET_PER_BYTE) && (nIndex < pPort->nRxHoldCount))
+	{
+		if (pStream != NULL)
+		{
+			if (!HostSim_DmaWriteItem(pStream, pPort->nRxHold[nIndex]))
+			{
+				break;
+			}
+		}
+		else if ((pUSART->SR & USART_SR_RXNE) == 0)
+		{
+			pUSART->DR = pPort->nRxHold[nIndex];
+			pUSART->SR |= USART_SR_RXNE;
+		}
+		else
+		{
+			// the byte in DR has not been read, this one stays put
+			break;
+		}
+		nIndex++;
+		pPort->nRxBudget -= BUDGET_PER_BYTE;
+		bReceived = TRUE;
+	}
+	if (nIndex != 0)
+	{
+		pPort->nRxHoldCount -= nIndex;
+		memmove(pPort->nRxHold, &pPort->nRxHold[nIndex], pPort->nRxHoldCount);
+		pPort->nRxBytes += nIndex;
+	}
+	if (pPort->nRxHoldCount == 0 && pPort->nRxBudget > BUDGET_PER_BYTE)
+	{
+		pPort->nRxBudget = BUDGET_PER_BYTE;
+	}
+	// IDLE is set after a quiet character time and stays until the firmware
+	// reads SR then DR, even when interrupts are held off across a step
+	if (!bReceived && pPort->bRxActive)
+	{
+		pUSART->SR |= USART_SR_IDLE;
+	}
+	pPort->bRxActive = bReceived;
+}
+
+/*******************************************************************************
+*       @details
+*   The USART interrupt is level sensitive on its enabled status flags.
+*******************************************************************************/
+static void hostSim_UsartInterrupt(USART_TypeDef *pUSART)
+{
+	U_INT32 nSR = pUSART->SR, nCR1 = pUSART->CR1;
+	IRQn_Type eIRQ;
+
+	if (((nSR & USART_SR_TC) && (nCR1 & USART_CR1_TCIE)) ||
+	    ((nSR & USART_SR_TXE) && (nCR1 & USART_CR1_TXEIE)) ||
+	    ((nSR & (USART_SR_RXNE | USART_SR_ORE)) && (nCR1 & USART_CR1_RXNEIE)) ||
+	    ((nSR & USART_SR_IDLE) && (nCR1 & USART_CR1_IDLEIE)))
+	{
+		eIRQ = (pUSART == USART1) ? USART1_IRQn :
+		       (pUSART == USART2) ? USART2_IRQn :
+		       (pUSART == USART3) ? USART3_IRQn :
+		       (pUSART == UART4) ? UART4_IRQn :
+		       (pUSART == UART5) ? UART5_IRQn : USART6_IRQn;
+		HostSim_SetPending(eIRQ);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_UsartStep(void)
+{
+	for (U_INT32 i = 0; i < m_nUsarts; i++)
+	{
+		HOSTSIM_USART *pPort = &m_Usarts[i];
+		USART_TypeDef *pUSART = pPort->pUSART;
+		U_INT32 nBaudRate = hostSim_UsartBaudRate(pUSART);
+
+		if (pPort->pDevice != NULL && pPort->pDevice->pfTick != NULL)
+		{
+			pPort->pDevice->pfTick();
+		}
+		if (((pUSART->CR1 & USART_CR1_UE) == 0) || (nBaudRate == 0))
+		{
+			continue;
+		}
+		if (pUSART->CR1 & USART_CR1_TE)
+		{
+			hostSim_UsartTransmit(pPort, nBaudRate);
+		}
+		hostSim_UsartReceive(pPort, nBaudRate);
+		hostSim_UsartInterrupt(pUSART);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostSim_UsartReport(void)
+{
+	for (U_INT32 i = 0; i < m_nUsarts; i++)
+	{
+		HostSim_Log("%s: %lu bytes sent, %lu received, %lu dropped", m_Usarts[i].pszName,
+		            (unsigned long)m_Usarts[i].nTxBytes, (unsigned long)m_Usarts[i].nRxBytes,
+		            (unsigned long)m_Usarts[i].nRxDropped);
+		if (m_Usarts[i].pDevice != NULL && m_Usarts[i].pDevice->pfReport != NULL)
+		{
+			m_Usarts[i].pDevice->pfReport();
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   A write to DR hands one byte to the transmitter.
+*******************************************************************************/
+void __wrap_USART_SendData(USART_TypeDef *USARTx, uint16_t Data)
+{
+	HOSTSIM_USART *pPort = hostSim_UsartFind(USARTx);
+
+	USARTx->DR = Data & 0x01FF;
+	USARTx->SR &= ~USART_SR_TXE;
+	if (pPort != NULL)
+	{
+		pPort->nTxPending = 0x100 | (Data & 0xFF);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   A read of DR clears RXNE, and after a read of SR the error and IDLE flags.
+*******************************************************************************/
+uint16_t __wrap_USART_ReceiveData(USART_TypeDef *USARTx)
+{
+	USARTx->SR &= ~(USART_SR_RXNE | USART_SR_IDLE | USART_SR_ORE | USART_SR_NE | USART_SR_FE);
+	return (uint16_t)(USARTx->DR & 0x01FF);
+}
+
+/*******************************************************************************
+*       @details
+*   The USART status flags are cleared by writing zero.
+*******************************************************************************/
+void __wrap_USART_ClearFlag(USART_TypeDef *USARTx, uint16_t USART_FLAG)
+{
+	USARTx->SR &= (uint16_t)~USART_FLAG;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_USART_ClearITPendingBit(USART_TypeDef *USARTx, uint16_t USART_IT)
+{
+	USARTx->SR &= (uint16_t)~(1u << (USART_IT >> 8));
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************
+*       @brief      The Tenfoot survey math of compass.c, built once in single
+*                   and once in double precision for the accuracy test.
+*       @file       Downhole/HostSim/tests/CompassMath.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The whole of compass.c is taken in, so the math is the firmware's own,
+// compiled with COMPASS_MATH_FLOAT32 set one way or the other and
+// COMPASS_MATH_ENTRY naming what comes out.  The Makefile makes every
+// other symbol of each copy local, so both sit beside the firmware's.
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "compass.c"
+#include "CompassMath.h"
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Scaled to the vectors as Compass_DecodeTenfoot() does.
+*******************************************************************************/
+void COMPASS_MATH_ENTRY(const INT32 *pnCounts, REAL32 *pfAngles)
+{
+	COMPASS_VECTORS vectors;
+	COMPASS_READING reading;
+
+	vectors.fHx = pnCounts[COMPASS_MATH_HX] / TENFOOT_SCALE;
+	vectors.fHy = pnCounts[COMPASS_MATH_HY] / TENFOOT_SCALE;
+	vectors.fHz = pnCounts[COMPASS_MATH_HZ] / TENFOOT_SCALE;
+	vectors.fGx = pnCounts[COMPASS_MATH_GX] / TENFOOT_SCALE;
+	vectors.fGy = pnCounts[COMPASS_MATH_GY] / TENFOOT_SCALE;
+	vectors.fGz = pnCounts[COMPASS_MATH_GZ] / TENFOOT_SCALE;
+	vectors.fTemperature = COMPASS_CONST(0.0);
+	Compass_SolveTenfoot(&vectors, &reading);
+	pfAngles[COMPASS_MATH_INCLINATION] = reading.fPitch;
+	pfAngles[COMPASS_MATH_AZIMUTH] = reading.fAzimuth;
+	pfAngles[COMPASS_MATH_TOOLFACE] = reading.fRoll;
+	pfAngles[COMPASS_MATH_DIP] = reading.fDip;
+}
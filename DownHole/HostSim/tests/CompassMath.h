@@ -0,0 +1,56 @@
+/*******************************************************************************
+*       @brief      The Tenfoot survey math of compass.c, built once in single
+*                   and once in double precision for the accuracy test.
+*       @file       Downhole/HostSim/tests/CompassMath.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef COMPASS_MATH_H
+#define COMPASS_MATH_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the Tenfoot answer, sensor counts
+#define COMPASS_MATH_HX             0
+#define COMPASS_MATH_HY             1
+#define COMPASS_MATH_HZ             2
+#define COMPASS_MATH_GX             3
+#define COMPASS_MATH_GY             4
+#define COMPASS_MATH_GZ             5
+#define COMPASS_MATH_COUNTS         6
+
+// what comes out of it, degrees
+#define COMPASS_MATH_INCLINATION    0
+#define COMPASS_MATH_AZIMUTH        1
+#define COMPASS_MATH_TOOLFACE       2
+#define COMPASS_MATH_DIP            3
+#define COMPASS_MATH_ANGLES         4
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    ///@brief  Solves a Tenfoot answer as the firmware does, in REAL32.
+    void CompassMath_Solve32(const INT32 *pnCounts, REAL32 *pfAngles);
+    ///@brief  Solves a Tenfoot answer as the firmware does, in REAL64.
+    void CompassMath_Solve64(const INT32 *pnCounts, REAL32 *pfAngles);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,84 @@
+/*******************************************************************************
+*       @brief      Checks shared by the HostSim test programs.
+*       @file       Downhole/HostSim/tests/HostTest.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "HostTest.h"
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const char *m_pszName = "HostTest";
+static U_INT32 m_nChecks;
+static U_INT32 m_nFailures;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostTest_Begin(const char *pszName)
+{
+	m_pszName = pszName;
+	m_nChecks = 0;
+	m_nFailures = 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void HostTest_Print(const char *pszFormat, ...)
+{
+	va_list args;
+
+	printf("%s: ", m_pszName);
+	va_start(args, pszFormat);
+	vprintf(pszFormat, args);
+	va_end(args);
+	printf("\n");
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL HostTest_Check(BOOL bPassed, const char *pszFormat, ...)
+{
+	va_list args;
+
+	m_nChecks++;
+	if (!bPassed)
+	{
+		m_nFailures++;
+	}
+	printf("%s: %s ", m_pszName, bPassed ? "PASS" : "FAIL");
+	va_start(args, pszFormat);
+	vprintf(pszFormat, args);
+	va_end(args);
+	printf("\n");
+	return bPassed;
+}
+
+/*******************************************************************************
+*       @details
+*   The HostSim report at exit follows, so the verdict goes first.
+*******************************************************************************/
+int HostTest_Result(void)
+{
+	printf("%s: %s, %u of %u checks failed\n", m_pszName, (m_nFailures == 0) ? "PASSED" : "FAILED",
+	       (unsigned)m_nFailures, (unsigned)m_nChecks);
+	return (m_nFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,45 @@
+/*******************************************************************************
+*       @brief      Checks shared by the HostSim test programs.
+*       @file       Downhole/HostSim/tests/HostTest.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// A test program is linked with the whole firmware, its main() renamed out
+// of the way, and the HostSim peripheral models, which are up and clocking
+// before the test's own main() runs.  It brings up only the parts of the
+// firmware it needs, drives them directly, and returns HostTest_Result()
+// from main(), so `make test` stops at the first one that fails.
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    ///@brief  Names the test in what it prints.
+    void HostTest_Begin(const char *pszName);
+    ///@brief  Prints a result or a note, prefixed by the test name.
+    void HostTest_Print(const char *pszFormat, ...) __attribute__((format(printf, 1, 2)));
+    ///@brief  Records a check, printing it with PASS or FAIL in front.
+    BOOL HostTest_Check(BOOL bPassed, const char *pszFormat, ...) __attribute__((format(printf, 2, 3)));
+    ///@brief  Prints the summary, returns the process exit status.
+    int HostTest_Result(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
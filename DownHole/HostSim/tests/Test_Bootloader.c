@@ -0,0 +1,297 @@
+/*******************************************************************************
+*       @brief      Installing a firmware update.  Takes an image into the
+*                   serial flash through the firmware update, runs the
+*                   bootloader over it and checks the image ends up in the
+*                   internal flash and nothing else there changed, and that
+*                   an image spoilt after its check is not installed.
+*       @file       Downhole/HostSim/tests/Test_Bootloader.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The bootloader is linked in with its main() renamed, and the test plays
+// out what a reset does: the application has taken the image and checked
+// it, then Bootloader_Initialize() and Bootloader_InstallUpdate() run on
+// the serial flash and backup SRAM it left.  The internal flash starts as a
+// programmer would have left it, random bytes through the bootloader and
+// the application sectors, so a sector the install should have erased and
+// did not, or one it should have left and did not, shows.  The image is
+// random too, bar a vector table that points into it, and reaches part way
+// into the 64K sector.  The application's SPI is set up again after each
+// bootloader run, as the application would after the jump.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the images and the flash
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "crc.h"
+#include "BlackBox.h"
+#include "Bootloader.h"
+#include "CommDriver_Flash.h"
+#include "CommDriver_SPI.h"
+#include "FirmwareUpdate.h"
+#include "FlashMemory.h"
+#include "NV_Power.h"
+#include "SysTick.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// an image that ends part way into the 64K sector 4, and not on a word
+#define TEST_CHUNKS                 313
+#define TEST_IMAGE_SIZE             ((TEST_CHUNKS * FIRMWARE_CHUNK_SIZE) - 45)
+
+// the internal flash the test looks at, the bootloader, sectors 2 to 4 and
+// sector 5, which the image does not reach
+#define TEST_SECTOR_5               0x08020000ul
+#define TEST_FLASH_SIZE             (TEST_SECTOR_5 + 0x20000ul - FLASH_BASE)
+
+#define TEST_INITIAL_STACK          0x20020000ul
+#define TEST_RESET_HANDLER          (FIRMWARE_APPLICATION_ADDRESS + 0x189)
+
+// a chunk of the image spoilt in the serial flash
+#define TEST_SPOILT_CHUNK           200
+
+// service runs while the application checks the image
+#define TEST_MAX_SERVICE_RUNS       1000
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static U_BYTE m_nImage[TEST_IMAGE_SIZE];
+static U_BYTE m_nFlash[TEST_FLASH_SIZE];
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_Random(U_INT32 nRange)
+{
+	U_INT32 nValue = (U_INT32)(HostSim_RandomUniform() * nRange);
+
+	return (nValue < nRange) ? nValue : nRange - 1;
+}
+
+/*******************************************************************************
+*       @details
+*   A random image with the vector table of an application.
+*******************************************************************************/
+static void test_MakeImage(void)
+{
+	U_INT32 nVectors[2] = { TEST_INITIAL_STACK, TEST_RESET_HANDLER };
+	U_INT32 i;
+
+	for (i = 0; i < TEST_IMAGE_SIZE; i++)
+	{
+		m_nImage[i] = (U_BYTE)test_Random(256);
+	}
+	memcpy(m_nImage, nVectors, sizeof(nVectors));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_ImageCRC(void)
+{
+	CRC32_CONTEXT crc;
+
+	CRC32_Start(&crc);
+	CRC32_Update(&crc, m_nImage, TEST_IMAGE_SIZE);
+	return CRC32_Finish(&crc);
+}
+
+/*******************************************************************************
+*       @details
+*   The image into the serial flash and checked, as the uphole's transfer
+*   would leave it.  Returns the update state at the end.
+*******************************************************************************/
+static U_BYTE test_Transfer(void)
+{
+	U_INT32 nImageCRC = test_ImageCRC();
+	CRC32_CONTEXT crc;
+	U_BYTE nNumber[2];
+	U_BYTE nLength;
+	U_INT16 nChunk;
+	U_INT16 nRuns;
+
+	(void)FirmwareUpdate_Start(0, 0);
+	if (!FirmwareUpdate_Start(TEST_IMAGE_SIZE, nImageCRC))
+	{
+		return FirmwareUpdate_GetState();
+	}
+	for (nChunk = 0; nChunk < TEST_CHUNKS; nChunk++)
+	{
+		nLength = (nChunk == (TEST_CHUNKS - 1)) ? (TEST_IMAGE_SIZE % FIRMWARE_CHUNK_SIZE) : FIRMWARE_CHUNK_SIZE;
+		nNumber[0] = (U_BYTE)nChunk;
+		nNumber[1] = (U_BYTE)(nChunk >> 8);
+		CRC32_Start(&crc);
+		CRC32_Update(&crc, nNumber, sizeof(nNumber));
+		CRC32_Update(&crc, &m_nImage[nChunk * FIRMWARE_CHUNK_SIZE], nLength);
+		(void)FirmwareUpdate_WriteChunk(nChunk, &m_nImage[nChunk * FIRMWARE_CHUNK_SIZE], nLength,
+		                                CRC32_Finish(&crc));
+	}
+	(void)FirmwareUpdate_Commit(nImageCRC);
+	for (nRuns = 0; (nRuns < TEST_MAX_SERVICE_RUNS) && (FirmwareUpdate_GetState() == FIRMWARE_STATE_VERIFYING);
+	     nRuns++)
+	{
+		FirmwareUpdate_Service();
+	}
+	return FirmwareUpdate_GetState();
+}
+
+/*******************************************************************************
+*       @details
+*   A reset into the bootloader, and back to the application's SPI after.
+*******************************************************************************/
+static U_BYTE test_RunBootloader(void)
+{
+	U_BYTE nResult;
+
+	while (FLASH_IsBusy())
+	{
+	}
+	Bootloader_Initialize();
+	nResult = Bootloader_InstallUpdate();
+	SPI_Initialize();
+	return nResult;
+}
+
+/*******************************************************************************
+*       @details
+*   Bytes of the internal flash from nFrom for nLength that are not as the
+*   copy of it has them.
+*******************************************************************************/
+static U_INT32 test_CountChanged(U_INT32 nFrom, U_INT32 nLength)
+{
+	const U_BYTE *pFlash = (const U_BYTE *)(uintptr_t)nFrom;
+	U_INT32 nChanged = 0;
+	U_INT32 i;
+
+	for (i = 0; i < nLength; i++)
+	{
+		nChanged += (pFlash[i] != m_nFlash[nFrom - FLASH_BASE + i]) ? 1 : 0;
+	}
+	return nChanged;
+}
+
+/*******************************************************************************
+*       @details
+*   A good image installed over what was there.
+*******************************************************************************/
+static void test_Install(void)
+{
+	const U_BYTE *pApplication = (const U_BYTE *)(uintptr_t)FIRMWARE_APPLICATION_ADDRESS;
+	U_INT32 nEnd = FIRMWARE_APPLICATION_ADDRESS + TEST_IMAGE_SIZE;
+	U_INT32 nErased = 0;
+	U_BYTE nState;
+	U_BYTE nResult;
+	U_INT32 i;
+
+	test_MakeImage();
+	nState = test_Transfer();
+	if (!HostTest_Check(nState == FIRMWARE_STATE_READY, "a %u byte image ready to install, state %u",
+	                    TEST_IMAGE_SIZE, nState))
+	{
+		return;
+	}
+	nResult = test_RunBootloader();
+	HostTest_Check(nResult == BOOT_INSTALLED, "the bootloader installed it, %u", nResult);
+	HostTest_Check(memcmp(pApplication, m_nImage, TEST_IMAGE_SIZE) == 0, "the internal flash holds the image");
+	for (i = nEnd; i < TEST_SECTOR_5; i++)
+	{
+		nErased += (*(const U_BYTE *)(uintptr_t)i == 0xFF) ? 1 : 0;
+	}
+	HostTest_Check(nErased == (TEST_SECTOR_5 - nEnd), "%u of %u bytes after it erased", (unsigned)nErased,
+	               (unsigned)(TEST_SECTOR_5 - nEnd));
+	HostTest_Check((test_CountChanged(FLASH_BASE, FIRMWARE_BOOTLOADER_SIZE) == 0) &&
+	               (test_CountChanged(TEST_SECTOR_5, 0x20000) == 0), "the bootloader and sector 5 left as they were");
+	HostTest_Check(FirmwareUpdate_GetState() == FIRMWARE_STATE_IDLE, "the update is idle after, state %u",
+	               FirmwareUpdate_GetState());
+	HostTest_Check(Bootloader_IsApplicationValid(), "the application is taken as valid");
+	nResult = test_RunBootloader();
+	HostTest_Check(nResult == BOOT_NO_UPDATE, "the next start installs nothing, %u", nResult);
+	memcpy(m_nFlash, (const void *)(uintptr_t)FLASH_BASE, TEST_FLASH_SIZE);
+}
+
+/*******************************************************************************
+*       @details
+*   Images the bootloader must turn down, the internal flash left alone.
+*******************************************************************************/
+static void test_Refuse(void)
+{
+	U_INT32 nOffset = TEST_SPOILT_CHUNK * FIRMWARE_CHUNK_SIZE;
+	U_BYTE nChunk[FIRMWARE_CHUNK_SIZE];
+	U_INT32 nBadStack = 0xFFFFFFFFul;
+	U_BYTE nState;
+	U_BYTE nResult;
+
+	// a chunk spoilt in the serial flash after the image was checked
+	test_MakeImage();
+	nState = test_Transfer();
+	memcpy(nChunk, &m_nImage[nOffset], FIRMWARE_CHUNK_SIZE);
+	nChunk[test_Random(FIRMWARE_CHUNK_SIZE)] ^= (U_BYTE)(1 + test_Random(255));
+	(void)Serflash_program_firmware(nOffset, nChunk, FIRMWARE_CHUNK_SIZE, FALSE);
+	nResult = test_RunBootloader();
+	HostTest_Check((nState == FIRMWARE_STATE_READY) && (nResult == BOOT_IMAGE_BAD),
+	               "an image spoilt after its check is turned down, %u", nResult);
+	HostTest_Check(FirmwareUpdate_GetState() == FIRMWARE_STATE_FAILED, "the update is failed, state %u",
+	               FirmwareUpdate_GetState());
+	HostTest_Check(test_CountChanged(FLASH_BASE, TEST_FLASH_SIZE) == 0, "the internal flash left as it was");
+
+	// an image that checks out but has no vector table
+	test_MakeImage();
+	memcpy(m_nImage, &nBadStack, sizeof(nBadStack));
+	nState = test_Transfer();
+	nResult = test_RunBootloader();
+	HostTest_Check((nState == FIRMWARE_STATE_READY) && (nResult == BOOT_IMAGE_BAD),
+	               "an image with no stack pointer in the RAM is turned down, %u", nResult);
+	HostTest_Check(test_CountChanged(FLASH_BASE, TEST_FLASH_SIZE) == 0, "the internal flash left as it was");
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	U_INT32 i;
+
+	HostTest_Begin("Test_Bootloader");
+	// what of the firmware's start up the update needs
+	SysTick_Init();
+	NVPower_Initialize();
+	BlackBox_Initialize();
+	SPI_Initialize();
+	__enable_irq();
+	Serflash_read_DID_data();
+	FirmwareUpdate_Initialize();
+
+	// the internal flash as a programmer left it
+	for (i = 0; i < TEST_FLASH_SIZE; i++)
+	{
+		m_nFlash[i] = (U_BYTE)test_Random(256);
+	}
+	memcpy((void *)(uintptr_t)FLASH_BASE, m_nFlash, TEST_FLASH_SIZE);
+
+	test_Install();
+	test_Refuse();
+
+	// erased, the application sectors hold nothing to start
+	FLASH_Unlock();
+	(void)FLASH_EraseSector(FLASH_Sector_2, VoltageRange_3);
+	FLASH_Lock();
+	HostTest_Check(!Bootloader_IsApplicationValid(), "erased, no application is taken as valid");
+	return HostTest_Result();
+}
@@ -0,0 +1,499 @@
+/*******************************************************************************
+*       @brief      Compact data set over a lossy link.  Polls the DownHole
+*                   for the compact full data set while its numbers wander,
+*                   decodes the zigzag varint changes the way the UpHole
+*                   does, losing replies on the way, and checks every frame
+*                   decoded holds the numbers the downhole had.
+*       @file       Downhole/HostSim/tests/Test_CompactData.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The numbers of the data set are taken from the sensor getters, which the
+// test stands in for, so it knows what each frame should carry: mostly
+// small steps either way, now and then none, now and then a jump anywhere
+// in the range of the number.  Only the state bits and the on time left
+// come from the firmware itself, and are not judged.  The uphole side is a
+// copy of TargProtocol_DecodeCompactData() of the UpHole, which has no host
+// build: it acks the last frame it decoded and asks for a key frame when
+// it has none, as when the uphole restarts.  A lost reply leaves it acking
+// the frame before, which the downhole must build the next one on.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the numbers and the link
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "crc.h"
+#include "compass.h"
+#include "TargetProtocol.h"
+#include "version.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// number of the compact data set in the command list of TargetProtocol.c
+#define TEST_CMD_COMPACT            12
+
+// the frame, as in TargetProtocol.c
+#define TEST_COMPACT_VERSION        1
+#define TEST_REQUEST_IDENTITY       0x01
+#define TEST_REQUEST_KEYFRAME       0x02
+#define TEST_FRAME_KEYFRAME         0x01
+#define TEST_FRAME_IDENTITY         0x02
+#define TEST_HEADER_LENGTH          4
+#define TEST_DATE_LENGTH            16
+
+#define TEST_POLLS                  5000
+#define TEST_REPLY_LOSS             0.15
+#define TEST_RESTART                0.01
+
+// how the numbers wander between polls
+#define TEST_STEP_MOST              40
+#define TEST_UNCHANGED              0.3
+#define TEST_JUMP                   0.02
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// numbers of the compact data set, in the order of the field mask bits
+typedef enum
+{
+	TEST_STATE,
+	TEST_AZIMUTH,
+	TEST_PITCH,
+	TEST_ROLL,
+	TEST_TEMPERATURE,
+	TEST_GAMMA,
+	TEST_GAMMA_ERROR,
+	TEST_BATTERY,
+	TEST_SIGNAL,
+	TEST_TIME_LEFT,
+	TEST_GTOTAL,
+	TEST_HTOTAL,
+	TEST_DIP,
+	TEST_TEMPERATURE_DRIFT,
+	TEST_METRIC_SAMPLES,
+	TEST_GTOTAL_STD,
+	TEST_HTOTAL_STD,
+	TEST_SLEEP,
+	TEST_BATTERY_MIN,
+	TEST_SIGNAL_MAX,
+	TEST_FIELDS
+} TEST_FIELD;
+
+typedef struct
+{
+	INT32 nLeast;
+	INT32 nMost;
+} TEST_RANGE;
+
+typedef struct
+{
+	U_INT32 nPolls;
+	U_INT32 nRepliesLost;
+	U_INT32 nRestarts;
+	U_INT32 nKeyFrames;
+	U_INT32 nDeltaFrames;
+	U_INT32 nAfterLoss;         // delta frames built on a frame before a lost one
+	U_INT32 nDropped;           // built on a frame the uphole did not have
+	U_INT32 nBad;               // failed the CRC or would not decode
+	U_INT32 nWrong;             // decoded, but not to the numbers sent
+	U_INT32 nKeyBytes;
+	U_INT32 nDeltaBytes;
+} TEST_LINK_STATS;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// the range each number may take, the state and time left are not ours
+static const TEST_RANGE m_Ranges[TEST_FIELDS] =
+{
+	{ 0, 0 }, { -32768, 32767 }, { -32768, 32767 }, { -32768, 32767 },
+	{ 0, 65535 }, { 0, 65535 }, { 0, 65535 }, { 0, 65535 }, { 0, 65535 }, { 0, 0 },
+	{ 0, 65535 }, { 0, 65535 }, { -32768, 32767 }, { -32768, 32767 }, { 0, 255 },
+	{ 0, 65535 }, { 0, 65535 }, { 0, 1000 }, { 0, 65535 }, { 0, 65535 }
+};
+
+// the numbers the getters give
+static INT32 m_nSensors[TEST_FIELDS];
+
+// what the uphole has decoded
+static INT32 m_nValues[TEST_FIELDS];
+static U_BYTE m_nSequence;
+static BOOL m_bValid;
+static BOOL m_bIdentity;
+
+static U_BYTE m_nReply[256];
+static U_INT16 m_nReplyLength;
+
+static TEST_LINK_STATS m_Link;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Takes the place of the modem, keeping the answer for the link.
+*******************************************************************************/
+BOOL __wrap_Modem_MessageToSend(U_BYTE *pData, U_INT32 nLength)
+{
+	if (nLength > sizeof(m_nReply))
+	{
+		return FALSE;
+	}
+	memcpy(m_nReply, pData, nLength);
+	m_nReplyLength = (U_INT16)nLength;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   The sensor getters the compact data set is built from.
+*******************************************************************************/
+INT16 __wrap_Compass_GetSurveyAzimuth(void)
+{
+	return (INT16)m_nSensors[TEST_AZIMUTH];
+}
+
+INT16 __wrap_Compass_GetSurveyPitch(void)
+{
+	return (INT16)m_nSensors[TEST_PITCH];
+}
+
+INT16 __wrap_Compass_GetSurveyRoll(void)
+{
+	return (INT16)m_nSensors[TEST_ROLL];
+}
+
+INT16 __wrap_Compass_GetSurveyTemperature(void)
+{
+	return (INT16)m_nSensors[TEST_TEMPERATURE];
+}
+
+U_INT16 __wrap_GetCurrentGammaCount(void)
+{
+	return (U_INT16)m_nSensors[TEST_GAMMA];
+}
+
+U_INT16 __wrap_GetCurrentGammaError(void)
+{
+	return (U_INT16)m_nSensors[TEST_GAMMA_ERROR];
+}
+
+U_INT16 __wrap_GetBatteryInputVoltageU16(void)
+{
+	return (U_INT16)m_nSensors[TEST_BATTERY];
+}
+
+U_INT16 __wrap_GetPeakDetectInputU16(void)
+{
+	return (U_INT16)m_nSensors[TEST_SIGNAL];
+}
+
+U_INT16 __wrap_Power_GetSleepPermille(void)
+{
+	return (U_INT16)m_nSensors[TEST_SLEEP];
+}
+
+U_INT16 __wrap_GetBatteryMinimumVoltageU16(void)
+{
+	return (U_INT16)m_nSensors[TEST_BATTERY_MIN];
+}
+
+U_INT16 __wrap_GetPeakDetectMaximumU16(void)
+{
+	return (U_INT16)m_nSensors[TEST_SIGNAL_MAX];
+}
+
+void __wrap_Compass_GetSurveyMetrics(COMPASS_SURVEY_METRICS *pMetrics)
+{
+	pMetrics->nGtotal = (U_INT16)m_nSensors[TEST_GTOTAL];
+	pMetrics->nHtotal = (U_INT16)m_nSensors[TEST_HTOTAL];
+	pMetrics->nDip = (INT16)m_nSensors[TEST_DIP];
+	pMetrics->nTemperatureDrift = (INT16)m_nSensors[TEST_TEMPERATURE_DRIFT];
+	pMetrics->nSamples = (U_BYTE)m_nSensors[TEST_METRIC_SAMPLES];
+	pMetrics->nGtotalStd = (U_INT16)m_nSensors[TEST_GTOTAL_STD];
+	pMetrics->nHtotalStd = (U_INT16)m_nSensors[TEST_HTOTAL_STD];
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static INT32 test_Random(INT32 nLeast, INT32 nMost)
+{
+	INT32 nValue = nLeast + (INT32)(HostSim_RandomUniform() * ((nMost - nLeast) + 1));
+
+	return (nValue > nMost) ? nMost : nValue;
+}
+
+/*******************************************************************************
+*       @details
+*   Moves each number a small step, a jump, or not at all.
+*******************************************************************************/
+static void test_Wander(void)
+{
+	const TEST_RANGE *pRange;
+	REAL64 fChoice;
+	U_BYTE nField;
+
+	for (nField = 0; nField < TEST_FIELDS; nField++)
+	{
+		pRange = &m_Ranges[nField];
+		fChoice = HostSim_RandomUniform();
+		if (fChoice < TEST_JUMP)
+		{
+			m_nSensors[nField] = test_Random(pRange->nLeast, pRange->nMost);
+		}
+		else if (fChoice > TEST_UNCHANGED)
+		{
+			m_nSensors[nField] += test_Random(-TEST_STEP_MOST, TEST_STEP_MOST);
+		}
+		m_nSensors[nField] = (m_nSensors[nField] < pRange->nLeast) ? pRange->nLeast : m_nSensors[nField];
+		m_nSensors[nField] = (m_nSensors[nField] > pRange->nMost) ? pRange->nMost : m_nSensors[nField];
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The compact data set request, with the ack and flags the uphole sends.
+*******************************************************************************/
+static void test_Request(U_BYTE *pRequest)
+{
+	pRequest[0] = TEST_CMD_COMPACT;
+	pRequest[1] = 2;
+	pRequest[2] = m_nSequence;
+	pRequest[3] = (m_bIdentity ? 0 : TEST_REQUEST_IDENTITY) | (m_bValid ? 0 : TEST_REQUEST_KEYFRAME);
+	pRequest[4] = (U_BYTE)~(pRequest[2] + pRequest[3]);
+}
+
+/*******************************************************************************
+*       @details
+*   Seven bits at a time, low first, the top bit set on all but the last.
+*******************************************************************************/
+static BOOL test_ReadVarint(const U_BYTE *pData, U_BYTE nLength, U_BYTE *pIndex, U_INT32 *pValue)
+{
+	U_BYTE nShift;
+
+	*pValue = 0;
+	for (nShift = 0; nShift < 35; nShift += 7)
+	{
+		if (*pIndex >= nLength)
+		{
+			return FALSE;
+		}
+		*pValue |= (U_INT32)(pData[*pIndex] & 0x7F) << nShift;
+		if ((pData[(*pIndex)++] & 0x80) == 0)
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   Decodes the reply as the UpHole does, returns FALSE if it was dropped
+*   or would not decode.  The frame flags are left in *pnFlags.
+*******************************************************************************/
+static BOOL test_Decode(U_BYTE *pnFlags)
+{
+	const U_BYTE *pData = &m_nReply[2];
+	INT32 nValues[TEST_FIELDS];
+	U_INT32 nMask;
+	U_INT32 nChange;
+	U_BYTE nLength;
+	U_BYTE nIndex;
+	U_BYTE nField;
+
+	if ((m_nReplyLength < (TEST_HEADER_LENGTH + 5)) || (m_nReply[0] != TEST_CMD_COMPACT) ||
+	    (m_nReply[1] != (m_nReplyLength - 4)) ||
+	    (CRC16_Calculate(m_nReply, m_nReplyLength - 2) !=
+	     (U_INT16)(m_nReply[m_nReplyLength - 2] | (m_nReply[m_nReplyLength - 1] << 8))) ||
+	    (pData[0] != TEST_COMPACT_VERSION))
+	{
+		m_Link.nBad++;
+		return FALSE;
+	}
+	nLength = m_nReply[1];
+	*pnFlags = pData[3];
+	if (*pnFlags & TEST_FRAME_KEYFRAME)
+	{
+		memset(nValues, 0, sizeof(nValues));
+	}
+	else if (m_bValid && (pData[2] == m_nSequence))
+	{
+		memcpy(nValues, m_nValues, sizeof(nValues));
+	}
+	else
+	{
+		m_bValid = FALSE;
+		m_Link.nDropped++;
+		return FALSE;
+	}
+	nIndex = TEST_HEADER_LENGTH;
+	if (!test_ReadVarint(pData, nLength, &nIndex, &nMask))
+	{
+		m_Link.nBad++;
+		return FALSE;
+	}
+	for (nField = 0; nField < 32; nField++)
+	{
+		if ((nMask & (1ul << nField)) == 0)
+		{
+			continue;
+		}
+		if (!test_ReadVarint(pData, nLength, &nIndex, &nChange) || (nField >= TEST_FIELDS))
+		{
+			m_Link.nBad++;
+			return FALSE;
+		}
+		nValues[nField] += (INT32)(nChange >> 1) ^ -(INT32)(nChange & 1);
+	}
+	if (*pnFlags & TEST_FRAME_IDENTITY)
+	{
+		if (((nIndex + MAX_VERSION_LEN + TEST_DATE_LENGTH) != nLength) ||
+		    (strncmp((const char *)&pData[nIndex], GetSWVersion(), MAX_VERSION_LEN) != 0))
+		{
+			m_Link.nBad++;
+			return FALSE;
+		}
+		m_bIdentity = TRUE;
+	}
+	else if (nIndex != nLength)
+	{
+		m_Link.nBad++;
+		return FALSE;
+	}
+	memcpy(m_nValues, nValues, sizeof(m_nValues));
+	m_nSequence = pData[1];
+	m_bValid = TRUE;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   The decoded numbers against those the getters gave, as the downhole
+*   puts them in the frame.
+*******************************************************************************/
+static BOOL test_Matches(void)
+{
+	U_BYTE nField;
+
+	for (nField = 0; nField < TEST_FIELDS; nField++)
+	{
+		if ((nField == TEST_STATE) || (nField == TEST_TIME_LEFT))
+		{
+			continue;
+		}
+		if (nField == TEST_TEMPERATURE)
+		{
+			// the downhole sends the temperature as a U_INT16
+			if (m_nValues[nField] != (U_INT16)m_nSensors[nField])
+			{
+				return FALSE;
+			}
+		}
+		else if (m_nValues[nField] != m_nSensors[nField])
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   One poll over the link, the uphole perhaps restarting before it.
+*******************************************************************************/
+static void test_Poll(BOOL *pbLost)
+{
+	U_BYTE nRequest[5];
+	U_BYTE nFlags;
+
+	if (HostSim_RandomUniform() < TEST_RESTART)
+	{
+		m_bValid = FALSE;
+		m_bIdentity = FALSE;
+		m_Link.nRestarts++;
+	}
+	test_Wander();
+	test_Request(nRequest);
+	m_nReplyLength = 0;
+	m_Link.nPolls++;
+	ProcessTargetRXMessage(nRequest, sizeof(nRequest));
+	if (HostSim_RandomUniform() < TEST_REPLY_LOSS)
+	{
+		m_Link.nRepliesLost++;
+		*pbLost = TRUE;
+		return;
+	}
+	if (!test_Decode(&nFlags))
+	{
+		return;
+	}
+	if (nFlags & TEST_FRAME_KEYFRAME)
+	{
+		m_Link.nKeyFrames++;
+		m_Link.nKeyBytes += m_nReplyLength;
+	}
+	else
+	{
+		m_Link.nDeltaFrames++;
+		m_Link.nDeltaBytes += m_nReplyLength;
+		m_Link.nAfterLoss += *pbLost ? 1 : 0;
+	}
+	*pbLost = FALSE;
+	if (!test_Matches() && (m_Link.nWrong++ == 0))
+	{
+		HostTest_Print("poll %u decoded to numbers that were not sent", (unsigned)m_Link.nPolls);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	BOOL bLost = FALSE;
+	U_INT32 nDecoded;
+	U_INT32 nPoll;
+
+	HostTest_Begin("Test_CompactData");
+	for (nPoll = 0; nPoll < TEST_POLLS; nPoll++)
+	{
+		test_Poll(&bLost);
+	}
+	nDecoded = m_Link.nKeyFrames + m_Link.nDeltaFrames;
+
+	HostTest_Print("%u polls, %u replies lost, %u restarts", (unsigned)m_Link.nPolls,
+	               (unsigned)m_Link.nRepliesLost, (unsigned)m_Link.nRestarts);
+	HostTest_Print("%u key frames of %.1f bytes, %u delta frames of %.1f bytes", (unsigned)m_Link.nKeyFrames,
+	               (REAL64)m_Link.nKeyBytes / ((m_Link.nKeyFrames > 0) ? m_Link.nKeyFrames : 1),
+	               (unsigned)m_Link.nDeltaFrames,
+	               (REAL64)m_Link.nDeltaBytes / ((m_Link.nDeltaFrames > 0) ? m_Link.nDeltaFrames : 1));
+	HostTest_Check((m_Link.nBad == 0) && (m_Link.nDropped == 0), "every reply decoded, %u bad, %u dropped",
+	               (unsigned)m_Link.nBad, (unsigned)m_Link.nDropped);
+	HostTest_Check(m_Link.nWrong == 0, "%u of %u frames decoded to the numbers sent",
+	               (unsigned)(nDecoded - m_Link.nWrong), (unsigned)nDecoded);
+	HostTest_Check(nDecoded == (m_Link.nPolls - m_Link.nRepliesLost), "%u frames decoded of %u not lost",
+	               (unsigned)nDecoded, (unsigned)(m_Link.nPolls - m_Link.nRepliesLost));
+	HostTest_Check(m_Link.nAfterLoss > 0, "%u delta frames built on the frame before a lost reply",
+	               (unsigned)m_Link.nAfterLoss);
+	HostTest_Check(m_Link.nKeyFrames <= (m_Link.nRestarts + 1), "%u key frames for %u restarts",
+	               (unsigned)m_Link.nKeyFrames, (unsigned)m_Link.nRestarts);
+	HostTest_Check(m_Link.nDeltaBytes < (m_Link.nKeyBytes / m_Link.nKeyFrames) * m_Link.nDeltaFrames,
+	               "delta frames smaller than key frames");
+	return HostTest_Result();
+}
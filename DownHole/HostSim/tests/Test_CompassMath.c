@@ -0,0 +1,228 @@
+/*******************************************************************************
+*       @brief      Accuracy of the single precision survey math.  Solves a
+*                   sweep of magnetic and gravity vectors with compass.c built
+*                   with COMPASS_MATH_FLOAT32 and without it, and reports how
+*                   far the REAL32 angles are from the REAL64 ones.
+*       @file       Downhole/HostSim/tests/Test_CompassMath.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The sweep takes gravity and the field in random directions of the tool,
+// the field at a dip of up to 85 degrees either way, with the totals spread
+// over what the earth gives.  Both are turned into Tenfoot counts, so both
+// builds solve exactly what the sensor would send.  Errors are in 0.1
+// degree, the resolution the survey is kept and sent in, and the single
+// precision math passes if it is never a whole unit out.  Azimuth and
+// toolface are not defined with the tool vertical, within
+// TEST_VERTICAL_LIMIT of it they are reported but not judged.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the sweep
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <math.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "CompassMath.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define TEST_SURVEYS                200000
+
+// the earth's field, nT, and gravity, mG
+#define TEST_H_LEAST                25000.0
+#define TEST_H_MOST                 65000.0
+#define TEST_G_LEAST                990.0
+#define TEST_G_MOST                 1010.0
+#define TEST_DIP_MOST               85.0
+
+// counts per nT and mG
+#define TEST_TENFOOT_SCALE          4096.0
+
+// inclination, degrees from level, past which the tool is taken as vertical
+#define TEST_VERTICAL_LIMIT         85.0
+
+// what the single precision math may be out, 0.1 degree
+#define TEST_MAX_ERROR              1.0
+#define TEST_MAX_RMS                0.1
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	REAL64 fMost;
+	REAL64 fSquares;
+	U_INT32 nCount;
+} TEST_ERROR;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const char * const m_pszAngles[COMPASS_MATH_ANGLES] =
+{
+	"inclination", "azimuth", "toolface", "dip"
+};
+
+static TEST_ERROR m_Error[COMPASS_MATH_ANGLES];
+static TEST_ERROR m_Vertical[COMPASS_MATH_ANGLES];
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   A random direction, and one square to it.
+*******************************************************************************/
+static void test_Directions(REAL64 *pfDirection, REAL64 *pfSquare)
+{
+	REAL64 fOther[3];
+	REAL64 fLength = 0.0;
+	REAL64 fDot = 0.0;
+	U_BYTE nAxis;
+
+	while (fLength < 1.0e-3)
+	{
+		for (nAxis = 0; nAxis < 3; nAxis++)
+		{
+			pfDirection[nAxis] = HostSim_RandomNormal();
+			fOther[nAxis] = HostSim_RandomNormal();
+		}
+		fLength = sqrt((pfDirection[0] * pfDirection[0]) + (pfDirection[1] * pfDirection[1]) +
+		               (pfDirection[2] * pfDirection[2]));
+	}
+	for (nAxis = 0; nAxis < 3; nAxis++)
+	{
+		pfDirection[nAxis] /= fLength;
+		fDot += fOther[nAxis] * pfDirection[nAxis];
+	}
+	fLength = 0.0;
+	for (nAxis = 0; nAxis < 3; nAxis++)
+	{
+		pfSquare[nAxis] = fOther[nAxis] - (fDot * pfDirection[nAxis]);
+		fLength += pfSquare[nAxis] * pfSquare[nAxis];
+	}
+	fLength = sqrt(fLength);
+	for (nAxis = 0; nAxis < 3; nAxis++)
+	{
+		pfSquare[nAxis] /= fLength;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Tenfoot counts of a random survey of the sweep.
+*******************************************************************************/
+static void test_Survey(INT32 *pnCounts)
+{
+	REAL64 fDown[3];
+	REAL64 fAcross[3];
+	REAL64 fH = TEST_H_LEAST + ((TEST_H_MOST - TEST_H_LEAST) * HostSim_RandomUniform());
+	REAL64 fG = TEST_G_LEAST + ((TEST_G_MOST - TEST_G_LEAST) * HostSim_RandomUniform());
+	REAL64 fDip = (M_PI / 180.0) * TEST_DIP_MOST * ((2.0 * HostSim_RandomUniform()) - 1.0);
+	U_BYTE nAxis;
+
+	test_Directions(fDown, fAcross);
+	for (nAxis = 0; nAxis < 3; nAxis++)
+	{
+		pnCounts[COMPASS_MATH_GX + nAxis] = (INT32)lround(TEST_TENFOOT_SCALE * fG * fDown[nAxis]);
+		pnCounts[COMPASS_MATH_HX + nAxis] = (INT32)lround(TEST_TENFOOT_SCALE * fH *
+		                                                   ((sin(fDip) * fDown[nAxis]) + (cos(fDip) * fAcross[nAxis])));
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Difference of two angles in 0.1 degree, the shorter way round.
+*******************************************************************************/
+static REAL64 test_Difference(REAL32 fAngle, REAL32 fReference)
+{
+	REAL64 fDifference = fmod((REAL64)fAngle - (REAL64)fReference, 360.0);
+
+	if (fDifference > 180.0)
+	{
+		fDifference -= 360.0;
+	}
+	else if (fDifference < -180.0)
+	{
+		fDifference += 360.0;
+	}
+	return 10.0 * fDifference;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void test_Count(TEST_ERROR *pError, REAL64 fDifference)
+{
+	pError->fMost = fmax(pError->fMost, fabs(fDifference));
+	pError->fSquares += fDifference * fDifference;
+	pError->nCount++;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static REAL64 test_Rms(const TEST_ERROR *pError)
+{
+	return (pError->nCount > 0) ? sqrt(pError->fSquares / pError->nCount) : 0.0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	INT32 nCounts[COMPASS_MATH_COUNTS];
+	REAL32 fSingle[COMPASS_MATH_ANGLES];
+	REAL32 fDouble[COMPASS_MATH_ANGLES];
+	BOOL bVertical;
+	U_INT32 nSurvey;
+	U_BYTE nAngle;
+
+	HostTest_Begin("Test_CompassMath");
+	for (nSurvey = 0; nSurvey < TEST_SURVEYS; nSurvey++)
+	{
+		test_Survey(nCounts);
+		CompassMath_Solve32(nCounts, fSingle);
+		CompassMath_Solve64(nCounts, fDouble);
+		bVertical = (BOOL)(fabs(fDouble[COMPASS_MATH_INCLINATION]) > TEST_VERTICAL_LIMIT);
+		for (nAngle = 0; nAngle < COMPASS_MATH_ANGLES; nAngle++)
+		{
+			if (bVertical && ((nAngle == COMPASS_MATH_AZIMUTH) || (nAngle == COMPASS_MATH_TOOLFACE)))
+			{
+				test_Count(&m_Vertical[nAngle], test_Difference(fSingle[nAngle], fDouble[nAngle]));
+			}
+			else
+			{
+				test_Count(&m_Error[nAngle], test_Difference(fSingle[nAngle], fDouble[nAngle]));
+			}
+		}
+	}
+
+	HostTest_Print("%u surveys, REAL32 against REAL64, in 0.1 degree", (unsigned)TEST_SURVEYS);
+	for (nAngle = 0; nAngle < COMPASS_MATH_ANGLES; nAngle++)
+	{
+		if (m_Vertical[nAngle].nCount > 0)
+		{
+			HostTest_Print("%s within %.0f degrees of vertical: max %.4f, rms %.5f over %u", m_pszAngles[nAngle],
+			               90.0 - TEST_VERTICAL_LIMIT, m_Vertical[nAngle].fMost, test_Rms(&m_Vertical[nAngle]),
+			               (unsigned)m_Vertical[nAngle].nCount);
+		}
+		HostTest_Check((m_Error[nAngle].fMost < TEST_MAX_ERROR) && (test_Rms(&m_Error[nAngle]) < TEST_MAX_RMS),
+		               "%s: max %.4f, rms %.5f over %u", m_pszAngles[nAngle], m_Error[nAngle].fMost,
+		               test_Rms(&m_Error[nAngle]), (unsigned)m_Error[nAngle].nCount);
+	}
+	return HostTest_Result();
+}
@@ -0,0 +1,231 @@
+/*******************************************************************************
+*       @brief      Software CRCs of crc.c.  Checks the CRC-32 against the
+*                   STM32 CRC unit's reference values and a bit by bit model
+*                   of the unit, taken in one block and in pieces of any
+*                   size, and the CRC-16 against its check value.
+*       @file       Downhole/HostSim/tests/Test_Crc.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The host build has no CRC unit, CalculateCRC() and the rest use the
+// table driven CRC32_Word() of crc.c, which is what the target's software
+// CRC runs too.  The model here is the unit as its reference manual gives
+// it: polynomial 0x04C11DB7, the register from 0xFFFFFFFF, each 32 bit word
+// shifted in most significant bit first and no final XOR.  The pieces fed
+// to CRC32_Update() are 1 to TEST_MOST_PIECE bytes, so they start and end
+// at every place in a word, and a block that is not whole words is padded
+// with zeros as CRC32_Finish() does.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the blocks and pieces
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "crc.h"
+#include "FlashMemory.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the reference values of the STM32 CRC unit, of one word each
+#define TEST_REFERENCE_WORD_1       0x00000000ul
+#define TEST_REFERENCE_CRC_1        0xC704DD7Bul
+#define TEST_REFERENCE_WORD_2       0x12345678ul
+#define TEST_REFERENCE_CRC_2        0xDF8A8A2Bul
+
+// CRC-16/CCITT of "123456789"
+#define TEST_CRC16_CHECK            0x29B1
+
+#define TEST_MODEL_WORDS            130
+#define TEST_BLOCKS                 1000
+#define TEST_MOST_BLOCK             600
+#define TEST_MOST_PIECE             19
+
+// a slot of the DataFlash page, as CommDriver_Flash.c keeps them
+#define TEST_SLOT_SIZE              128
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_Random(U_INT32 nRange)
+{
+	U_INT32 nValue = (U_INT32)(HostSim_RandomUniform() * nRange);
+
+	return (nValue < nRange) ? nValue : nRange - 1;
+}
+
+/*******************************************************************************
+*       @details
+*   The CRC unit a bit at a time.
+*******************************************************************************/
+static U_INT32 test_ModelWord(U_INT32 nCRC, U_INT32 nWord)
+{
+	U_BYTE nBit;
+
+	nCRC ^= nWord;
+	for (nBit = 0; nBit < 32; nBit++)
+	{
+		nCRC = (nCRC & 0x80000000ul) ? ((nCRC << 1) ^ 0x04C11DB7ul) : (nCRC << 1);
+	}
+	return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*   The model of a block of bytes, packed into words lowest first and the
+*   last padded with zeros.
+*******************************************************************************/
+static U_INT32 test_ModelBytes(const U_BYTE *pData, U_INT32 nLength)
+{
+	U_INT32 nCRC = CRC32_INITIAL;
+	U_INT32 nWord;
+	U_INT32 i;
+
+	for (i = 0; i < nLength; i += 4)
+	{
+		nWord = 0;
+		memcpy(&nWord, &pData[i], ((nLength - i) < 4) ? (nLength - i) : 4);
+		nCRC = test_ModelWord(nCRC, nWord);
+	}
+	return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void test_Reference(void)
+{
+	U_INT32 nWords[2] = { TEST_REFERENCE_WORD_1, TEST_REFERENCE_WORD_2 };
+	U_INT32 nCRC1 = CRC32_Calculate(&nWords[0], 1);
+	U_INT32 nCRC2 = CRC32_Calculate(&nWords[1], 1);
+	U_INT32 nBlockCRC = 0;
+	BOOL bBlock = CalculateCRC((U_BYTE *)&nWords[1], sizeof(nWords[1]), &nBlockCRC);
+
+	HostTest_Check(nCRC1 == TEST_REFERENCE_CRC_1, "CRC of 0x%08X is 0x%08X, 0x%08X expected",
+	               (unsigned)TEST_REFERENCE_WORD_1, (unsigned)nCRC1, (unsigned)TEST_REFERENCE_CRC_1);
+	HostTest_Check(nCRC2 == TEST_REFERENCE_CRC_2, "CRC of 0x%08X is 0x%08X, 0x%08X expected",
+	               (unsigned)TEST_REFERENCE_WORD_2, (unsigned)nCRC2, (unsigned)TEST_REFERENCE_CRC_2);
+	HostTest_Check(bBlock && (nBlockCRC == TEST_REFERENCE_CRC_2), "CalculateCRC() gives the same, 0x%08X",
+	               (unsigned)nBlockCRC);
+	HostTest_Check(!CalculateCRC((U_BYTE *)nWords, 3, &nBlockCRC), "CalculateCRC() refuses a part word");
+}
+
+/*******************************************************************************
+*       @details
+*   A block of words, and a byte at a time from ResetCRC(), against the model.
+*******************************************************************************/
+static void test_Model(void)
+{
+	U_INT32 nWords[TEST_MODEL_WORDS];
+	U_INT32 nModel = CRC32_INITIAL;
+	U_INT32 nByteCRC;
+	U_INT32 nByteModel = CRC32_INITIAL;
+	U_INT32 nCRC;
+	U_INT32 i;
+
+	for (i = 0; i < TEST_MODEL_WORDS; i++)
+	{
+		nWords[i] = (U_INT32)test_Random(0x10000) | ((U_INT32)test_Random(0x10000) << 16);
+		nModel = test_ModelWord(nModel, nWords[i]);
+	}
+	nCRC = CRC32_Calculate(nWords, TEST_MODEL_WORDS);
+	HostTest_Check(nCRC == nModel, "%u words: 0x%08X, the bit by bit model 0x%08X", TEST_MODEL_WORDS,
+	               (unsigned)nCRC, (unsigned)nModel);
+
+	ResetCRC(&nByteCRC);
+	for (i = 0; i < TEST_MODEL_WORDS; i++)
+	{
+		CRC_CalculateOnByte(&nByteCRC, (U_BYTE)nWords[i]);
+		nByteModel = test_ModelWord(nByteModel, (U_BYTE)nWords[i]);
+	}
+	HostTest_Check(nByteCRC == nByteModel, "%u bytes a word each: 0x%08X, the model 0x%08X", TEST_MODEL_WORDS,
+	               (unsigned)nByteCRC, (unsigned)nByteModel);
+}
+
+/*******************************************************************************
+*       @details
+*   Blocks of any length fed in pieces against the one shot CRC and the
+*   model, with more added after a look at the CRC part way.
+*******************************************************************************/
+static void test_Pieces(void)
+{
+	U_BYTE nData[TEST_MOST_BLOCK];
+	CRC32_CONTEXT whole;
+	CRC32_CONTEXT pieces;
+	U_INT32 nWrong = 0;
+	U_INT32 nLength;
+	U_INT32 nDone;
+	U_INT32 nPiece;
+	U_INT32 nBlock;
+	U_INT32 i;
+
+	for (nBlock = 0; nBlock < TEST_BLOCKS; nBlock++)
+	{
+		nLength = test_Random(TEST_MOST_BLOCK + 1);
+		for (i = 0; i < nLength; i++)
+		{
+			nData[i] = (U_BYTE)test_Random(256);
+		}
+		CRC32_Start(&whole);
+		CRC32_Update(&whole, nData, nLength);
+		CRC32_Start(&pieces);
+		for (nDone = 0; nDone < nLength; nDone += nPiece)
+		{
+			nPiece = 1 + test_Random(TEST_MOST_PIECE);
+			nPiece = (nPiece > (nLength - nDone)) ? (nLength - nDone) : nPiece;
+			CRC32_Update(&pieces, &nData[nDone], nPiece);
+			(void)CRC32_Finish(&pieces);
+		}
+		if ((CRC32_Finish(&pieces) != CRC32_Finish(&whole)) ||
+		    (CRC32_Finish(&whole) != test_ModelBytes(nData, nLength)))
+		{
+			if (nWrong++ == 0)
+			{
+				HostTest_Print("block %u of %u bytes: pieces 0x%08X, whole 0x%08X, model 0x%08X",
+				               (unsigned)nBlock, (unsigned)nLength, (unsigned)CRC32_Finish(&pieces),
+				               (unsigned)CRC32_Finish(&whole), (unsigned)test_ModelBytes(nData, nLength));
+			}
+		}
+	}
+	HostTest_Check(nWrong == 0, "%u of %u blocks in pieces of 1 to %u bytes match", (unsigned)(TEST_BLOCKS - nWrong),
+	               TEST_BLOCKS, TEST_MOST_PIECE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	U_INT32 nSlot[TEST_SLOT_SIZE / 4];
+	U_INT32 nCRC = 0;
+	U_INT16 nCRC16;
+
+	HostTest_Begin("Test_Crc");
+	test_Reference();
+	test_Model();
+	test_Pieces();
+
+	// an erased slot reads back as empty
+	memset(nSlot, 0xFF, sizeof(nSlot));
+	(void)CalculateCRC((U_BYTE *)nSlot, sizeof(nSlot), &nCRC);
+	HostTest_Check(nCRC == EMPTY_SLOT_CRC, "an erased slot's CRC is 0x%08X, 0x%08X expected", (unsigned)nCRC,
+	               (unsigned)EMPTY_SLOT_CRC);
+
+	nCRC16 = CRC16_Calculate((const U_BYTE *)"123456789", 9);
+	HostTest_Check(nCRC16 == TEST_CRC16_CHECK, "CRC-16 of \"123456789\" is 0x%04X, 0x%04X expected", nCRC16,
+	               TEST_CRC16_CHECK);
+	return HostTest_Result();
+}
@@ -0,0 +1,240 @@
+/*******************************************************************************
+*       @brief      Finding the end of the event log after a power up.  Fills
+*                   the serial flash event area to many levels, on and off
+*                   the page boundaries, and checks the binary search over
+*                   the first slot of each page counts the events stored.
+*       @file       Downhole/HostSim/tests/Test_EventSearch.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The event area of the AT45DB321 is some seven thousand pages, more than
+// the test can fill in reasonable time, so the area is cut down to
+// TEST_PAGES pages, an odd number so the search halves unevenly.  The log
+// is filled in random steps, each step a power up: Serflash_recover_events()
+// must count exactly the events the test has stored, and the events must
+// read back as written.  A step ends on a page boundary, a slot either side
+// of one, or anywhere, and the last fills the area.  The log is then
+// emptied from the top a page at a time the way the downhole clears it,
+// the count found again after each page.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the steps and the events
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "BlackBox.h"
+#include "CommDriver_Flash.h"
+#include "CommDriver_SPI.h"
+#include "FlashMemory.h"
+#include "NV_Power.h"
+#include "SysTick.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define TEST_PAGES                  37
+#define TEST_CAPACITY               (TEST_PAGES * EVENTS_PER_PAGE)
+
+// events added at most in one step
+#define TEST_MOST_STEP              (3 * EVENTS_PER_PAGE)
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// where a step of the fill ends
+typedef enum
+{
+	TEST_ANYWHERE,
+	TEST_ON_PAGE,
+	TEST_BEFORE_PAGE,
+	TEST_AFTER_PAGE,
+	TEST_ENDS
+} TEST_END;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+extern volatile Flash_chip_type Serial_Flash_Chip;
+
+// the events stored, as written
+static U_BYTE m_nEvents[TEST_CAPACITY][EVENT_SLOT_SIZE];
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_Random(U_INT32 nRange)
+{
+	U_INT32 nValue = (U_INT32)(HostSim_RandomUniform() * nRange);
+
+	return (nValue < nRange) ? nValue : nRange - 1;
+}
+
+/*******************************************************************************
+*       @details
+*   The number of events a step of the fill ends at, past nFrom.
+*******************************************************************************/
+static U_INT32 test_StepEnd(U_INT32 nFrom)
+{
+	U_INT32 nEnd = nFrom + 1 + test_Random(TEST_MOST_STEP);
+	U_INT32 nPage = (nEnd + (EVENTS_PER_PAGE / 2)) / EVENTS_PER_PAGE;
+
+	switch ((TEST_END)test_Random(TEST_ENDS))
+	{
+		case TEST_ON_PAGE:
+			nEnd = nPage * EVENTS_PER_PAGE;
+			break;
+		case TEST_BEFORE_PAGE:
+			nEnd = (nPage * EVENTS_PER_PAGE) - 1;
+			break;
+		case TEST_AFTER_PAGE:
+			nEnd = (nPage * EVENTS_PER_PAGE) + 1;
+			break;
+		default:
+			break;
+	}
+	if (nEnd <= nFrom)
+	{
+		nEnd = nFrom + 1;
+	}
+	return (nEnd > TEST_CAPACITY) ? TEST_CAPACITY : nEnd;
+}
+
+/*******************************************************************************
+*       @details
+*   Stores events up to nEnd, returns FALSE if the flash refused one.
+*******************************************************************************/
+static BOOL test_Fill(U_INT32 nEnd)
+{
+	U_INT32 nEvent;
+	U_BYTE nByte;
+
+	for (nEvent = GetEventRecordCount(); nEvent < nEnd; nEvent++)
+	{
+		for (nByte = 0; nByte < EVENT_SLOT_SIZE; nByte++)
+		{
+			m_nEvents[nEvent][nByte] = (U_BYTE)test_Random(256);
+		}
+		// an event never starts 0xFF 0xFF, that marks a blank slot
+		m_nEvents[nEvent][0] &= 0x7F;
+		if (Serflash_program_event(m_nEvents[nEvent], EVENT_SLOT_SIZE) == 0)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Events of the log that do not read back as written.
+*******************************************************************************/
+static U_INT32 test_CountBadEvents(U_INT32 nEvents)
+{
+	U_BYTE nEvent[EVENT_SLOT_SIZE];
+	U_INT32 nBad = 0;
+	U_INT32 i;
+
+	for (i = 0; i < nEvents; i++)
+	{
+		if ((Serflash_get_event(i, EVENT_SLOT_SIZE, nEvent) == 0) ||
+		    (memcmp(nEvent, m_nEvents[i], EVENT_SLOT_SIZE) != 0))
+		{
+			nBad++;
+		}
+	}
+	return nBad;
+}
+
+/*******************************************************************************
+*       @details
+*   The count a power up finds, with the count kept beforehand spoilt so
+*   only the search can give it.
+*******************************************************************************/
+static U_INT32 test_PowerUp(void)
+{
+	Serial_Flash_Chip.event_number = 0x5A5A5A5Aul;
+	return Serflash_recover_events();
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	U_INT32 nStored = 0;
+	U_INT32 nFound;
+	U_INT32 nSteps = 0;
+	U_INT32 nMissed = 0;
+	U_INT32 nPages = 0;
+	BOOL bStored = TRUE;
+
+	HostTest_Begin("Test_EventSearch");
+	// what of the firmware's start up the event log needs
+	SysTick_Init();
+	NVPower_Initialize();
+	BlackBox_Initialize();
+	SPI_Initialize();
+	__enable_irq();
+	Serflash_read_DID_data();
+	if (!HostTest_Check(GetEventRecordCapacity() > TEST_CAPACITY, "an event area of %u events",
+	                    (unsigned)GetEventRecordCapacity()))
+	{
+		return HostTest_Result();
+	}
+	Serial_Flash_Chip.EVENTS_pages_available = TEST_PAGES;
+	Serflash_Events_Clear();
+	nFound = test_PowerUp();
+	HostTest_Check(nFound == 0, "%u events found in the cleared log", (unsigned)nFound);
+
+	// filled a step at a time, each step carrying on from a power up
+	while (bStored && (nStored < TEST_CAPACITY))
+	{
+		nStored = test_StepEnd(nStored);
+		bStored = test_Fill(nStored);
+		nFound = test_PowerUp();
+		if (nFound != nStored)
+		{
+			if (nMissed++ == 0)
+			{
+				HostTest_Print("%u events found of %u stored", (unsigned)nFound, (unsigned)nStored);
+			}
+			Serial_Flash_Chip.event_number = nStored;
+		}
+		nSteps++;
+	}
+	HostTest_Check(bStored, "the flash took %u events", (unsigned)nStored);
+	HostTest_Check(nMissed == 0, "the count found after each of %u steps", (unsigned)nSteps);
+	HostTest_Check(test_CountBadEvents(nStored) == 0, "%u events read back as written", (unsigned)nStored);
+	HostTest_Check(Serflash_program_event(m_nEvents[0], EVENT_SLOT_SIZE) == 0, "the full log takes no more");
+
+	// emptied from the top, the count found at each page
+	nMissed = 0;
+	while (Serflash_erase_last_event())
+	{
+		while (FLASH_IsBusy())
+		{
+		}
+		nStored = GetEventRecordCount();
+		nPages++;
+		nFound = test_PowerUp();
+		nMissed += (nFound != nStored) ? 1 : 0;
+	}
+	HostTest_Check((nPages == TEST_PAGES) && (nMissed == 0), "the count found after each of %u pages erased",
+	               (unsigned)nPages);
+	return HostTest_Result();
+}
@@ -0,0 +1,510 @@
+/*******************************************************************************
+*       @brief      Firmware transfer over a lossy link.  Sends an image to
+*                   the DownHole firmware update in chunks, losing and
+*                   spoiling messages and resetting the downhole on the way,
+*                   and checks the image ends up whole in the serial flash.
+*       @file       Downhole/HostSim/tests/Test_FirmwareUpdate.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// There is no host build of the UpHole, so the test plays the part of its
+// DownholeUpdate: start, read the received chunk bitmap, send the chunks
+// missing from it, again until none are, then commit and poll until the
+// downhole has checked the image.  Messages go straight to
+// ProcessTargetRXMessage() and the answers are taken from
+// Modem_MessageToSend(), with the modem and powerline in between replaced
+// by a link that loses requests and replies and spoils chunk data past the
+// frame checksum, so only the chunk CRC can catch it.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the image and the link
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "crc.h"
+#include "BlackBox.h"
+#include "CommDriver_SPI.h"
+#include "FirmwareUpdate.h"
+#include "FlashMemory.h"
+#include "NV_Power.h"
+#include "SysTick.h"
+#include "TargetProtocol.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// numbers of the firmware commands in the command list of TargetProtocol.c
+#define TEST_CMD_FIRMWARE_START     15
+#define TEST_CMD_FIRMWARE_CHUNK     16
+#define TEST_CMD_FIRMWARE_STATUS    17
+#define TEST_CMD_FIRMWARE_COMMIT    18
+
+// an image that does not end on a chunk or page boundary
+#define TEST_CHUNKS                 300
+#define TEST_IMAGE_SIZE             ((TEST_CHUNKS * FIRMWARE_CHUNK_SIZE) - 45)
+
+// the link
+#define TEST_REQUEST_LOSS           0.10
+#define TEST_REPLY_LOSS             0.10
+#define TEST_CHUNK_SPOIL            0.05
+
+// chunks sent before the uphole gives up the first time, and before the
+// downhole resets in the middle of the second transfer
+#define TEST_FIRST_CHUNKS           (TEST_CHUNKS / 3)
+#define TEST_RESET_CHUNKS           (TEST_CHUNKS / 4)
+
+// tries at a request before the uphole gives up
+#define TEST_MAX_TRIES              20
+// passes over the bitmap, each sends the chunks still missing
+#define TEST_MAX_PASSES             10
+// status polls while the downhole checks the image
+#define TEST_MAX_POLLS              200
+
+// bitmap bytes in one status reply
+#define TEST_BITMAP_READ_MAX        64
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// the firmware status reply
+typedef struct
+{
+	U_BYTE nState;
+	U_INT32 nSize;
+	U_INT32 nCRC;
+	U_INT16 nReceived;
+} TEST_STATUS;
+
+typedef struct
+{
+	U_INT32 nRequests;
+	U_INT32 nRequestsLost;
+	U_INT32 nRepliesLost;
+	U_INT32 nChunksSent;
+	U_INT32 nChunksSpoilt;
+	U_INT32 nChunksRefused;     // answered FIRMWARE_CHUNK_BAD_CRC
+} TEST_LINK_STATS;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static U_BYTE m_nImage[TEST_IMAGE_SIZE];
+static U_INT32 m_nImageCRC;
+static BOOL m_bHave[TEST_CHUNKS];
+
+static U_BYTE m_nRequest[256];
+static U_INT16 m_nRequestLength;
+static U_BYTE m_nReply[256];
+static U_INT16 m_nReplyLength;
+
+static TEST_LINK_STATS m_Link;
+static U_INT32 m_nResetAtChunk;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Takes the place of the modem, keeping the answer for the link.
+*******************************************************************************/
+BOOL __wrap_Modem_MessageToSend(U_BYTE *pData, U_INT32 nLength)
+{
+	if (nLength > sizeof(m_nReply))
+	{
+		return FALSE;
+	}
+	memcpy(m_nReply, pData, nLength);
+	m_nReplyLength = (U_INT16)nLength;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT16 test_Get16(const U_BYTE *pData)
+{
+	return (U_INT16)(pData[0] | (pData[1] << 8));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_Get32(const U_BYTE *pData)
+{
+	return test_Get16(pData) | ((U_INT32)test_Get16(&pData[2]) << 16);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_BYTE *test_Put16(U_BYTE *pData, U_INT16 nValue)
+{
+	*pData++ = (U_BYTE)nValue;
+	*pData++ = (U_BYTE)(nValue >> 8);
+	return pData;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_BYTE *test_Put32(U_BYTE *pData, U_INT32 nValue)
+{
+	pData = test_Put16(pData, (U_INT16)nValue);
+	return test_Put16(pData, (U_INT16)(nValue >> 16));
+}
+
+/*******************************************************************************
+*       @details
+*   The command, the byte count, the data and the inverted sum of the data.
+*******************************************************************************/
+static void test_Frame(U_BYTE nCommand, const U_BYTE *pData, U_BYTE nLength)
+{
+	U_BYTE nSum = 0;
+	U_BYTE i;
+
+	m_nRequest[0] = nCommand;
+	m_nRequest[1] = nLength;
+	for (i = 0; i < nLength; i++)
+	{
+		m_nRequest[2 + i] = pData[i];
+		nSum += pData[i];
+	}
+	m_nRequest[2 + nLength] = (U_BYTE)~nSum;
+	m_nRequestLength = nLength + 3;
+}
+
+/*******************************************************************************
+*       @details
+*   Flips a bit of the chunk data and mends the frame checksum.
+*******************************************************************************/
+static void test_SpoilChunk(void)
+{
+	U_BYTE nLength = m_nRequest[1] - 6;
+	U_BYTE nByte = 4 + (U_BYTE)(HostSim_RandomUniform() * nLength);
+
+	m_nRequest[nByte] ^= (U_BYTE)(1 << (U_BYTE)(HostSim_RandomUniform() * 8));
+	test_Frame(m_nRequest[0], &m_nRequest[2], m_nRequest[1]);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the request over the link, TRUE with the answer to it in m_nReply
+*   when it came back.
+*******************************************************************************/
+static BOOL test_Exchange(void)
+{
+	U_BYTE nSum = 0;
+	U_INT16 i;
+
+	m_Link.nRequests++;
+	m_nReplyLength = 0;
+	if (HostSim_RandomUniform() < TEST_REQUEST_LOSS)
+	{
+		m_Link.nRequestsLost++;
+		return FALSE;
+	}
+	if ((m_nRequest[0] == TEST_CMD_FIRMWARE_CHUNK) && (HostSim_RandomUniform() < TEST_CHUNK_SPOIL))
+	{
+		test_SpoilChunk();
+		m_Link.nChunksSpoilt++;
+	}
+	ProcessTargetRXMessage(m_nRequest, m_nRequestLength);
+	if ((m_nReplyLength < 3) || (m_nReply[0] != m_nRequest[0]) || (m_nReply[1] != (m_nReplyLength - 3)))
+	{
+		return FALSE;
+	}
+	if (HostSim_RandomUniform() < TEST_REPLY_LOSS)
+	{
+		m_Link.nRepliesLost++;
+		return FALSE;
+	}
+	for (i = 2; i < (m_nReplyLength - 1); i++)
+	{
+		nSum += m_nReply[i];
+	}
+	return (BOOL)((U_BYTE)~nSum == m_nReply[m_nReplyLength - 1]);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the request until an answer comes back, the firmware status then
+*   taken from it.  The bitmap bytes it carries are kept in m_bHave.
+*******************************************************************************/
+static BOOL test_Request(TEST_STATUS *pStatus)
+{
+	const U_BYTE *pData = &m_nReply[2];
+	U_INT16 nFirst;
+	U_BYTE nBytes;
+	U_BYTE nByte;
+	U_BYTE nBit;
+	U_BYTE nTry;
+
+	for (nTry = 0; nTry < TEST_MAX_TRIES; nTry++)
+	{
+		if (test_Exchange() && (m_nReply[1] >= 14))
+		{
+			pStatus->nState = pData[0];
+			pStatus->nSize = test_Get32(&pData[1]);
+			pStatus->nCRC = test_Get32(&pData[5]);
+			pStatus->nReceived = test_Get16(&pData[9]);
+			nFirst = test_Get16(&pData[11]);
+			nBytes = pData[13];
+			for (nByte = 0; nByte < nBytes; nByte++)
+			{
+				for (nBit = 0; nBit < 8; nBit++)
+				{
+					if ((nFirst + (nByte * 8) + nBit) < TEST_CHUNKS)
+					{
+						m_bHave[nFirst + (nByte * 8) + nBit] = (pData[14 + nByte] >> nBit) & 1;
+					}
+				}
+			}
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL test_Start(U_INT32 nSize, U_INT32 nCRC, TEST_STATUS *pStatus)
+{
+	U_BYTE nData[8];
+
+	test_Put32(test_Put32(nData, nSize), nCRC);
+	test_Frame(TEST_CMD_FIRMWARE_START, nData, sizeof(nData));
+	return test_Request(pStatus);
+}
+
+/*******************************************************************************
+*       @details
+*   Reads the whole received chunk bitmap into m_bHave.
+*******************************************************************************/
+static BOOL test_ReadBitmap(TEST_STATUS *pStatus)
+{
+	U_BYTE nData[2];
+	U_INT16 nFirst;
+
+	for (nFirst = 0; nFirst < TEST_CHUNKS; nFirst += TEST_BITMAP_READ_MAX * 8)
+	{
+		test_Put16(nData, nFirst);
+		test_Frame(TEST_CMD_FIRMWARE_STATUS, nData, sizeof(nData));
+		if (!test_Request(pStatus))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Sends a chunk once, a lost one is sent again on the next pass.  The
+*   downhole resets after the m_nResetAtChunk-th chunk sent.
+*******************************************************************************/
+static void test_SendChunk(U_INT16 nChunk)
+{
+	U_BYTE nData[2 + FIRMWARE_CHUNK_SIZE + 4];
+	U_BYTE *pData;
+	U_INT32 nOffset = (U_INT32)nChunk * FIRMWARE_CHUNK_SIZE;
+	U_BYTE nLength = FIRMWARE_CHUNK_SIZE;
+	CRC32_CONTEXT crc;
+
+	if ((nOffset + nLength) > TEST_IMAGE_SIZE)
+	{
+		nLength = (U_BYTE)(TEST_IMAGE_SIZE - nOffset);
+	}
+	pData = test_Put16(nData, nChunk);
+	memcpy(pData, &m_nImage[nOffset], nLength);
+	CRC32_Start(&crc);
+	CRC32_Update(&crc, nData, 2 + nLength);
+	test_Put32(pData + nLength, CRC32_Finish(&crc));
+	test_Frame(TEST_CMD_FIRMWARE_CHUNK, nData, 2 + nLength + 4);
+	m_Link.nChunksSent++;
+	if (test_Exchange() && (m_nReply[4] == FIRMWARE_CHUNK_BAD_CRC))
+	{
+		m_Link.nChunksRefused++;
+	}
+	if (m_Link.nChunksSent == m_nResetAtChunk)
+	{
+		HostTest_Print("downhole reset with %u chunks in", FirmwareUpdate_GetReceivedCount());
+		FirmwareUpdate_Initialize();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the chunks the bitmap says are missing, pass after pass, at most
+*   nMaxChunks of them.  TRUE once the downhole has every chunk.
+*******************************************************************************/
+static BOOL test_SendImage(U_INT32 nMaxChunks, TEST_STATUS *pStatus)
+{
+	U_INT32 nSent = 0;
+	U_BYTE nPass;
+	U_INT16 nChunk;
+
+	for (nPass = 0; nPass < TEST_MAX_PASSES; nPass++)
+	{
+		if (!test_ReadBitmap(pStatus))
+		{
+			return FALSE;
+		}
+		if (pStatus->nReceived >= TEST_CHUNKS)
+		{
+			return TRUE;
+		}
+		for (nChunk = 0; nChunk < TEST_CHUNKS; nChunk++)
+		{
+			if (m_bHave[nChunk])
+				continue;
+			if (nSent++ >= nMaxChunks)
+				return FALSE;
+			test_SendChunk(nChunk);
+		}
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   Commits the image and polls while the downhole checks it, running its
+*   scheduler task between polls.  The downhole resets once part way.
+*******************************************************************************/
+static BOOL test_Commit(TEST_STATUS *pStatus)
+{
+	U_BYTE nData[4];
+	U_INT16 nPoll;
+
+	test_Put32(nData, m_nImageCRC);
+	test_Frame(TEST_CMD_FIRMWARE_COMMIT, nData, sizeof(nData));
+	if (!test_Request(pStatus))
+	{
+		return FALSE;
+	}
+	for (nPoll = 0; nPoll < TEST_MAX_POLLS; nPoll++)
+	{
+		FirmwareUpdate_Service();
+		if (nPoll == 2)
+		{
+			HostTest_Print("downhole reset while checking the image");
+			FirmwareUpdate_Initialize();
+		}
+		test_Put16(nData, 0);
+		test_Frame(TEST_CMD_FIRMWARE_STATUS, nData, 2);
+		if (test_Request(pStatus) && (pStatus->nState != FIRMWARE_STATE_VERIFYING))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   Counts the serial flash pages of the image area that differ from it.
+*******************************************************************************/
+static U_INT32 test_CountBadPages(void)
+{
+	static U_BYTE nPage[CHIP_PAGE_SIZE];
+	U_INT32 nOffset;
+	U_INT32 nLength;
+	U_INT32 nBad = 0;
+
+	for (nOffset = 0; nOffset < TEST_IMAGE_SIZE; nOffset += CHIP_PAGE_SIZE)
+	{
+		nLength = TEST_IMAGE_SIZE - nOffset;
+		if (nLength > CHIP_PAGE_SIZE)
+		{
+			nLength = CHIP_PAGE_SIZE;
+		}
+		if (!Serflash_read_firmware_page(nOffset / CHIP_PAGE_SIZE, nPage) ||
+		    (memcmp(nPage, &m_nImage[nOffset], nLength) != 0))
+		{
+			nBad++;
+		}
+	}
+	return nBad;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	TEST_STATUS status;
+	CRC32_CONTEXT crc;
+	U_INT32 i;
+	U_INT16 nBefore;
+	BOOL bDone;
+
+	HostTest_Begin("Test_FirmwareUpdate");
+	// what of the firmware's start up the update needs
+	SysTick_Init();
+	NVPower_Initialize();
+	BlackBox_Initialize();
+	SPI_Initialize();
+	__enable_irq();
+	Serflash_read_DID_data();
+	FirmwareUpdate_Initialize();
+
+	for (i = 0; i < TEST_IMAGE_SIZE; i++)
+	{
+		m_nImage[i] = (U_BYTE)(HostSim_RandomUniform() * 256);
+	}
+	CRC32_Start(&crc);
+	CRC32_Update(&crc, m_nImage, TEST_IMAGE_SIZE);
+	m_nImageCRC = CRC32_Finish(&crc);
+	HostTest_Print("%u byte image, %u chunks", (unsigned)TEST_IMAGE_SIZE, (unsigned)TEST_CHUNKS);
+
+	// an image left by an earlier run is dropped
+	HostTest_Check(test_Start(0, 0, &status) && (status.nState == FIRMWARE_STATE_IDLE),
+	               "a start of size 0 drops the image");
+
+	// the uphole gives up part way
+	HostTest_Check(test_Start(TEST_IMAGE_SIZE, m_nImageCRC, &status) &&
+	               (status.nState == FIRMWARE_STATE_RECEIVING) && (status.nReceived == 0),
+	               "the downhole takes the image");
+	(void)test_SendImage(TEST_FIRST_CHUNKS, &status);
+	nBefore = FirmwareUpdate_GetReceivedCount();
+	HostTest_Check((nBefore > 0) && (nBefore < TEST_CHUNKS), "%u chunks in when the uphole gave up", nBefore);
+	// the downhole resets in between
+	FirmwareUpdate_Initialize();
+	HostTest_Check(FirmwareUpdate_GetReceivedCount() == nBefore, "the downhole reset kept %u of %u chunks",
+	               FirmwareUpdate_GetReceivedCount(), nBefore);
+
+	// started again it carries on, the downhole resetting once more
+	bDone = test_Start(TEST_IMAGE_SIZE, m_nImageCRC, &status);
+	HostTest_Check(bDone && (status.nReceived == nBefore), "a second start carries on with %u chunks in",
+	               status.nReceived);
+	m_nResetAtChunk = m_Link.nChunksSent + TEST_RESET_CHUNKS;
+	bDone = test_SendImage(TEST_CHUNKS * 2, &status);
+	HostTest_Check(bDone, "every chunk in after %u sent for %u", (unsigned)m_Link.nChunksSent, (unsigned)TEST_CHUNKS);
+	HostTest_Check(m_Link.nChunksSent < ((TEST_CHUNKS * 3) / 2), "resends stay under half the image");
+
+	bDone = test_Commit(&status);
+	HostTest_Check(bDone && (status.nState == FIRMWARE_STATE_READY), "the image checked out, state %u",
+	               status.nState);
+	HostTest_Check(test_CountBadPages() == 0, "the serial flash holds the image");
+	HostTest_Check(test_Start(TEST_IMAGE_SIZE, m_nImageCRC, &status) && (status.nState == FIRMWARE_STATE_READY),
+	               "starting the same image again leaves it ready");
+
+	HostTest_Print("%u requests, %u lost, %u replies lost, %u chunks spoilt, %u refused",
+	               (unsigned)m_Link.nRequests, (unsigned)m_Link.nRequestsLost, (unsigned)m_Link.nRepliesLost,
+	               (unsigned)m_Link.nChunksSpoilt, (unsigned)m_Link.nChunksRefused);
+	HostTest_Check((m_Link.nRequestsLost > 0) && (m_Link.nRepliesLost > 0) && (m_Link.nChunksRefused > 0),
+	               "the link lost requests and replies and spoilt chunks");
+	return HostTest_Result();
+}
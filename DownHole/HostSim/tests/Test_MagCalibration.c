@@ -0,0 +1,294 @@
+/*******************************************************************************
+*       @brief      Magnetometer calibration fit.  Turns a simulated tool
+*                   with hard and soft iron in the earth's field, fits the
+*                   ellipsoid and checks the calibration takes the
+*                   distortion out, the fit converges and it fits the RAM.
+*       @file       Downhole/HostSim/tests/Test_MagCalibration.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The fit runs from the command handler on the main stack, of which the
+// linker script only promises _Min_Stack_Size, 0x400 bytes, past the end
+// of the static data.  The stack CompassCal_Finish() takes is measured by
+// painting the stack below the caller and looking for how far down the
+// paint was overwritten, with the clock signal held off meanwhile as its
+// handler runs on the same stack.  Its frames on the host are near enough
+// those of the Cortex-M4, both keep the REAL64 sums and scratch alike.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the turns and the noise
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "compass_cal.h"
+#include "FlashMemory.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// earth's field and the magnetometer noise, nT
+#define TEST_FIELD                  50000.0
+#define TEST_NOISE                  30.0
+
+// orientations offered to the calibration, close ones are turned away
+#define TEST_TURNS                  600
+// fresh orientations the calibration is checked on
+#define TEST_CHECKS                 200
+
+// what the fit must do
+#define TEST_MAX_RESIDUAL           (2.0 * TEST_NOISE)
+#define TEST_MAX_OFFSET_ERROR       100.0       // nT
+#define TEST_MAX_MAGNITUDE_SPREAD   0.002       // of the mean magnitude
+
+// stack the fit may take, leaving a quarter of the reserve to its callers
+// and an interrupt, and the most RAM the calibration may hold in all
+#define TEST_STACK_BUDGET           0x300
+#define TEST_RAM_BUDGET             2048
+#define TEST_STACK_PAINT            8192
+#define TEST_PAINT                  0xA5
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	const char *pszName;
+	REAL64 fOffset[3];          // hard iron, nT
+	REAL64 fSoftIron[3][3];     // applied to the true field
+	BOOL bOneAxis;              // the tool is only turned about z
+} TEST_CASE;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const TEST_CASE m_Cases[] =
+{
+	{ "hard and soft iron", { 3200.0, -1800.0, 900.0 },
+	  { { 1.08, 0.04, -0.03 }, { 0.04, 0.93, 0.05 }, { -0.03, 0.05, 1.01 } }, FALSE },
+	{ "hard iron only", { -4500.0, 600.0, 2500.0 },
+	  { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } }, FALSE },
+	{ "turned about one axis", { 3200.0, -1800.0, 900.0 },
+	  { { 1.08, 0.04, -0.03 }, { 0.04, 0.93, 0.05 }, { -0.03, 0.05, 1.01 } }, TRUE },
+};
+
+// bottom of the painted stack
+static uintptr_t m_nPaint;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   The field seen by the magnetometer in a random orientation.
+*******************************************************************************/
+static void test_Field(const TEST_CASE *pCase, REAL64 fNoise, REAL64 *pfField)
+{
+	REAL64 fTrue[3];
+	REAL64 fLength = 0.0;
+	REAL64 fAngle;
+	U_BYTE nRow;
+	U_BYTE nColumn;
+
+	if (pCase->bOneAxis)
+	{
+		fAngle = 2.0 * M_PI * HostSim_RandomUniform();
+		fTrue[0] = cos(fAngle) * cos(M_PI / 6.0);
+		fTrue[1] = sin(fAngle) * cos(M_PI / 6.0);
+		fTrue[2] = sin(M_PI / 6.0);
+		fLength = 1.0;
+	}
+	else
+	{
+		while (fLength < 1.0e-6)
+		{
+			for (nRow = 0; nRow < 3; nRow++)
+			{
+				fTrue[nRow] = HostSim_RandomNormal();
+			}
+			fLength = sqrt((fTrue[0] * fTrue[0]) + (fTrue[1] * fTrue[1]) + (fTrue[2] * fTrue[2]));
+		}
+	}
+	for (nRow = 0; nRow < 3; nRow++)
+	{
+		pfField[nRow] = pCase->fOffset[nRow] + (fNoise * HostSim_RandomNormal());
+		for (nColumn = 0; nColumn < 3; nColumn++)
+		{
+			pfField[nRow] += pCase->fSoftIron[nRow][nColumn] * TEST_FIELD * fTrue[nColumn] / fLength;
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Fills the stack below the caller's frame with the paint.
+*******************************************************************************/
+static __attribute__((noinline)) void test_PaintStack(void)
+{
+	volatile U_BYTE nStack[TEST_STACK_PAINT];
+	U_INT32 nByte;
+
+	for (nByte = 0; nByte < TEST_STACK_PAINT; nByte++)
+	{
+		nStack[nByte] = TEST_PAINT;
+	}
+	m_nPaint = (uintptr_t)nStack;
+}
+
+/*******************************************************************************
+*       @details
+*   Bytes of the painted stack overwritten since, counted from the bottom
+*   up to the first one that still holds the paint all the way down.
+*******************************************************************************/
+static U_INT32 test_StackUsed(void)
+{
+	const volatile U_BYTE *pPaint = (const volatile U_BYTE *)m_nPaint;
+	U_INT32 nUnused = 0;
+
+	while ((nUnused < TEST_STACK_PAINT) && (pPaint[nUnused] == TEST_PAINT))
+	{
+		nUnused++;
+	}
+	return TEST_STACK_PAINT - nUnused;
+}
+
+/*******************************************************************************
+*       @details
+*   Calibrates on the case, returns the calibration state.  The stack the
+*   fit took is left in *pnStack.
+*******************************************************************************/
+static U_BYTE test_Calibrate(const TEST_CASE *pCase, U_INT32 *pnStack)
+{
+	REAL64 fField[3];
+	sigset_t alarm;
+	sigset_t previous;
+	U_BYTE nState;
+	U_INT16 nTurn;
+
+	CompassCal_Start();
+	for (nTurn = 0; nTurn < TEST_TURNS; nTurn++)
+	{
+		test_Field(pCase, TEST_NOISE, fField);
+		(void)CompassCal_AddSample((REAL32)fField[0], (REAL32)fField[1], (REAL32)fField[2]);
+	}
+	sigemptyset(&alarm);
+	sigaddset(&alarm, SIGALRM);
+	sigprocmask(SIG_BLOCK, &alarm, &previous);
+	test_PaintStack();
+	nState = CompassCal_Finish();
+	*pnStack = test_StackUsed();
+	sigprocmask(SIG_SETMASK, &previous, NULL);
+	return nState;
+}
+
+/*******************************************************************************
+*       @details
+*   The largest difference of the corrected magnitude from its mean over
+*   fresh noiseless orientations, as a fraction of the mean.
+*******************************************************************************/
+static REAL64 test_MagnitudeSpread(const TEST_CASE *pCase, const REAL32 *pfOffset, const REAL32 *pfMatrix)
+{
+	REAL64 fMagnitude[TEST_CHECKS];
+	REAL64 fField[3];
+	REAL64 fCorrected;
+	REAL64 fSquare;
+	REAL64 fMean = 0.0;
+	REAL64 fSpread = 0.0;
+	U_INT16 nCheck;
+	U_BYTE nRow;
+	U_BYTE nColumn;
+
+	for (nCheck = 0; nCheck < TEST_CHECKS; nCheck++)
+	{
+		test_Field(pCase, 0.0, fField);
+		fSquare = 0.0;
+		for (nRow = 0; nRow < 3; nRow++)
+		{
+			fCorrected = 0.0;
+			for (nColumn = 0; nColumn < 3; nColumn++)
+			{
+				fCorrected += pfMatrix[(nRow * 3) + nColumn] * (fField[nColumn] - pfOffset[nColumn]);
+			}
+			fSquare += fCorrected * fCorrected;
+		}
+		fMagnitude[nCheck] = sqrt(fSquare);
+		fMean += fMagnitude[nCheck] / TEST_CHECKS;
+	}
+	for (nCheck = 0; nCheck < TEST_CHECKS; nCheck++)
+	{
+		fSpread = fmax(fSpread, fabs(fMagnitude[nCheck] - fMean) / fMean);
+	}
+	return fSpread;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	const TEST_CASE *pCase;
+	REAL32 fOffset[3];
+	REAL32 fMatrix[9];
+	REAL64 fOffsetError;
+	REAL64 fSpread;
+	U_INT32 nStack;
+	U_INT32 nMostStack = 0;
+	U_BYTE nState;
+	U_BYTE nCase;
+	U_BYTE nAxis;
+
+	HostTest_Begin("Test_MagCalibration");
+	for (nCase = 0; nCase < (sizeof(m_Cases) / sizeof(m_Cases[0])); nCase++)
+	{
+		pCase = &m_Cases[nCase];
+		nState = test_Calibrate(pCase, &nStack);
+		nMostStack = (nStack > nMostStack) ? nStack : nMostStack;
+		HostTest_Print("%s: %u samples, residual %u nT, %u sweeps, %u bytes of stack", pCase->pszName,
+		               CompassCal_GetSampleCount(), CompassCal_GetResidual(), CompassCal_GetSweeps(),
+		               (unsigned)nStack);
+		if (pCase->bOneAxis)
+		{
+			HostTest_Check(nState == COMPASS_CAL_FAILED, "%s: no fit, state %u", pCase->pszName, nState);
+			continue;
+		}
+		if (!HostTest_Check(nState == COMPASS_CAL_DONE, "%s: fitted, state %u", pCase->pszName, nState))
+		{
+			continue;
+		}
+		(void)GetMagCalibration(fOffset, fMatrix);
+		HostTest_Check(CompassCal_GetResidual() <= TEST_MAX_RESIDUAL, "%s: residual %u nT within %.0f",
+		               pCase->pszName, CompassCal_GetResidual(), TEST_MAX_RESIDUAL);
+		HostTest_Check(CompassCal_GetSweeps() < COMPASS_CAL_MAX_SWEEPS, "%s: %u sweeps within the %u allowed",
+		               pCase->pszName, CompassCal_GetSweeps(), COMPASS_CAL_MAX_SWEEPS);
+		fOffsetError = 0.0;
+		for (nAxis = 0; nAxis < 3; nAxis++)
+		{
+			fOffsetError = fmax(fOffsetError, fabs(fOffset[nAxis] - pCase->fOffset[nAxis]));
+		}
+		HostTest_Check(fOffsetError <= TEST_MAX_OFFSET_ERROR, "%s: hard iron found within %.0f nT",
+		               pCase->pszName, fOffsetError);
+		fSpread = test_MagnitudeSpread(pCase, fOffset, fMatrix);
+		HostTest_Check(fSpread <= TEST_MAX_MAGNITUDE_SPREAD, "%s: corrected field on a sphere within %.2f%%",
+		               pCase->pszName, 100.0 * fSpread);
+	}
+
+	HostTest_Check(nMostStack <= TEST_STACK_BUDGET, "the fit takes %u bytes of stack, %u allowed",
+	               (unsigned)nMostStack, TEST_STACK_BUDGET);
+	HostTest_Check((sizeof(COMPASS_CAL_SUMS) + nMostStack) <= TEST_RAM_BUDGET,
+	               "%u bytes of sums and stack in all, %u allowed",
+	               (unsigned)(sizeof(COMPASS_CAL_SUMS) + nMostStack), TEST_RAM_BUDGET);
+	return HostTest_Result();
+}
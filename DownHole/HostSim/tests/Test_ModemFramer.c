@@ -0,0 +1,311 @@
+/*******************************************************************************
+*       @brief      Yitran frame decoder.  Feeds modem serial frames to the
+*                   streaming decoder in pieces of any size, good ones mixed
+*                   with bad lengths, bad checksums, line noise and frames
+*                   that stop part way, and checks each good one comes out
+*                   whole, in order, and each bad one is counted.
+*       @file       Downhole/HostSim/tests/Test_ModemFramer.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The bytes go straight to ModemData_ReceiveData() as the UART receive
+// service would hand them on, in pieces of 1 to TEST_MOST_PIECE bytes, and
+// ProcessModemBuffer() runs between pieces as the main loop would.  A frame
+// that stops part way is aged by stamping its last piece older than the
+// decoder's 50mS timeout, rather than waiting.  Every good frame is a
+// response, taken from m_nResponse as the modem manager would and checked
+// against what was sent.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the frames and pieces
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "SysTick.h"
+#include "ModemDataHandler.h"
+#include "ModemDataRxHandler.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define TEST_FRAMES                 2000
+#define TEST_MOST_PIECE             40
+#define TEST_MOST_DATA              MODEM_MESSAGE_BUFFER_SIZE
+
+// older than the decoder's frame timeout, mS
+#define TEST_STALE                  100
+
+// replies the decoder holds, the one handed on and the queue behind it
+#define TEST_REPLIES_HELD           5
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// what goes on the line ahead of a good frame
+typedef enum
+{
+	TEST_CLEAN,
+	TEST_BAD_LENGTH,            // a frame too long, or too short to hold its opcode
+	TEST_BAD_CHECKSUM,
+	TEST_NOISE,                 // bytes that cannot start a frame
+	TEST_STOPPED,               // part of a frame, then a pause
+	TEST_KINDS
+} TEST_KIND;
+
+typedef struct
+{
+	U_INT32 nFrames;
+	U_INT32 nFramingErrors;
+	U_INT32 nChecksumErrors;
+} TEST_COUNTS;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static const char * const m_pszKinds[TEST_KINDS] =
+{
+	"clean", "bad length", "bad checksum", "noise", "stopped"
+};
+
+static U_BYTE m_nLine[TEST_MOST_DATA + 16];
+static U_INT16 m_nLineLength;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_Random(U_INT32 nRange)
+{
+	U_INT32 nValue = (U_INT32)(HostSim_RandomUniform() * nRange);
+
+	return (nValue < nRange) ? nValue : nRange - 1;
+}
+
+/*******************************************************************************
+*       @details
+*   A response frame of nData bytes of data, with its checksum.
+*******************************************************************************/
+static void test_Frame(U_BYTE nOpCode, const U_BYTE *pData, U_INT16 nData)
+{
+	U_INT16 nLength = nData + 2;
+	U_BYTE nSum;
+	U_INT16 i;
+
+	m_nLine[0] = COMMAND_CONSTANT;
+	m_nLine[1] = (U_BYTE)nLength;
+	m_nLine[2] = (U_BYTE)(nLength >> 8);
+	m_nLine[3] = TYPE_RESPONSE;
+	m_nLine[4] = nOpCode;
+	memcpy(&m_nLine[5], pData, nData);
+	nSum = m_nLine[1] + m_nLine[2] + m_nLine[3] + m_nLine[4];
+	for (i = 0; i < nData; i++)
+	{
+		nSum += pData[i];
+	}
+	m_nLine[5 + nData] = nSum;
+	m_nLineLength = nData + 6;
+}
+
+/*******************************************************************************
+*       @details
+*   Hands the line to the decoder in random pieces, stamped now, with a
+*   pass of the main loop after each.
+*******************************************************************************/
+static void test_Send(const U_BYTE *pLine, U_INT16 nLength)
+{
+	U_INT16 nPiece;
+
+	while (nLength > 0)
+	{
+		nPiece = 1 + (U_INT16)test_Random(TEST_MOST_PIECE);
+		nPiece = (nPiece > nLength) ? nLength : nPiece;
+		ModemData_ReceiveData(pLine, nPiece, ElapsedTimeLowRes(START_LOW_RES_TIMER));
+		ProcessModemBuffer();
+		pLine += nPiece;
+		nLength -= nPiece;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void test_GetCounts(TEST_COUNTS *pCounts)
+{
+	pCounts->nFrames = ModemData_GetRxFrameCount();
+	pCounts->nFramingErrors = ModemData_GetRxFramingErrors();
+	pCounts->nChecksumErrors = ModemData_GetRxChecksumErrors();
+}
+
+/*******************************************************************************
+*       @details
+*   Puts the bad bytes of the kind on the line, and what each should add to
+*   the decoder's counts.
+*******************************************************************************/
+static void test_SendBad(TEST_KIND eKind, TEST_COUNTS *pExpected)
+{
+	U_BYTE nData[TEST_MOST_DATA];
+	U_INT16 nLength;
+	U_INT16 i;
+
+	for (i = 0; i < sizeof(nData); i++)
+	{
+		nData[i] = (U_BYTE)test_Random(256);
+	}
+	switch (eKind)
+	{
+		case TEST_BAD_LENGTH:
+			nLength = (test_Random(2) == 0) ? test_Random(2) : (MODEM_MESSAGE_BUFFER_SIZE + 3 + test_Random(1000));
+			m_nLine[0] = COMMAND_CONSTANT;
+			m_nLine[1] = (U_BYTE)nLength;
+			m_nLine[2] = (U_BYTE)(nLength >> 8);
+			test_Send(m_nLine, 3);
+			pExpected->nFramingErrors++;
+			break;
+		case TEST_BAD_CHECKSUM:
+			test_Frame(MODEM_OPCODE_GET_DEVICE_PARAM, nData, (U_INT16)test_Random(TEST_MOST_DATA + 1));
+			m_nLine[m_nLineLength - 1] ^= (U_BYTE)(1 + test_Random(255));
+			test_Send(m_nLine, m_nLineLength);
+			pExpected->nChecksumErrors++;
+			break;
+		case TEST_NOISE:
+			nLength = 1 + (U_INT16)test_Random(20);
+			for (i = 0; i < nLength; i++)
+			{
+				while ((nData[i] == COMMAND_CONSTANT) || (nData[i] == CONFIGURATION_CONSTANT))
+				{
+					nData[i] = (U_BYTE)test_Random(256);
+				}
+			}
+			test_Send(nData, nLength);
+			// a run of noise is one error
+			pExpected->nFramingErrors++;
+			break;
+		case TEST_STOPPED:
+			test_Frame(MODEM_OPCODE_GET_DEVICE_PARAM, nData, (U_INT16)test_Random(TEST_MOST_DATA + 1));
+			nLength = 1 + (U_INT16)test_Random(m_nLineLength - 1);
+			ModemData_ReceiveData(m_nLine, nLength,
+			                      ElapsedTimeLowRes(START_LOW_RES_TIMER) - TEST_STALE);
+			ProcessModemBuffer();
+			pExpected->nFramingErrors++;
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Good frames mixed with the bad, each good one read back before the next.
+*******************************************************************************/
+static void test_Mixed(void)
+{
+	U_BYTE nData[TEST_MOST_DATA];
+	TEST_COUNTS expected;
+	TEST_COUNTS counts;
+	U_INT32 nKinds[TEST_KINDS] = { 0 };
+	U_INT32 nWrong = 0;
+	U_INT32 nFrame;
+	U_INT16 nLength;
+	U_INT16 i;
+	TEST_KIND eKind;
+
+	test_GetCounts(&expected);
+	for (nFrame = 0; nFrame < TEST_FRAMES; nFrame++)
+	{
+		eKind = (TEST_KIND)test_Random(TEST_KINDS);
+		nKinds[eKind]++;
+		test_SendBad(eKind, &expected);
+		nLength = (U_INT16)test_Random(TEST_MOST_DATA + 1);
+		for (i = 0; i < nLength; i++)
+		{
+			nData[i] = (U_BYTE)test_Random(256);
+		}
+		test_Frame(MODEM_OPCODE_GET_DEVICE_PARAM, nData, nLength);
+		test_Send(m_nLine, m_nLineLength);
+		expected.nFrames++;
+		if (!m_nResponse.bReplyReady || (m_nResponse.eReply != MODEM_RESPONSE_GET_PARAM) ||
+		    (m_nResponse.nLength != nLength) || (memcmp(m_nResponse.nData, nData, nLength) != 0))
+		{
+			if (nWrong++ == 0)
+			{
+				HostTest_Print("frame %u after %s: ready %u, length %u of %u", (unsigned)nFrame,
+				               m_pszKinds[eKind], m_nResponse.bReplyReady, m_nResponse.nLength, nLength);
+			}
+		}
+		ModemData_ResetRxResponse();
+	}
+
+	for (eKind = TEST_CLEAN; eKind < TEST_KINDS; eKind++)
+	{
+		HostTest_Print("%u frames after %s", (unsigned)nKinds[eKind], m_pszKinds[eKind]);
+	}
+	HostTest_Check(nWrong == 0, "%u of %u good frames came out whole", (unsigned)(TEST_FRAMES - nWrong),
+	               (unsigned)TEST_FRAMES);
+	test_GetCounts(&counts);
+	HostTest_Check(counts.nFrames == expected.nFrames, "%u frames counted, %u expected",
+	               (unsigned)counts.nFrames, (unsigned)expected.nFrames);
+	HostTest_Check(counts.nFramingErrors == expected.nFramingErrors, "%u framing errors counted, %u expected",
+	               (unsigned)counts.nFramingErrors, (unsigned)expected.nFramingErrors);
+	HostTest_Check(counts.nChecksumErrors == expected.nChecksumErrors, "%u checksum errors counted, %u expected",
+	               (unsigned)counts.nChecksumErrors, (unsigned)expected.nChecksumErrors);
+}
+
+/*******************************************************************************
+*       @details
+*   Responses back to back in one piece are handed on one at a time in
+*   order, those past what the decoder holds are dropped and counted.
+*******************************************************************************/
+static void test_BackToBack(void)
+{
+	U_BYTE nLine[(TEST_REPLIES_HELD + 2) * 8];
+	U_INT16 nLineLength = 0;
+	U_INT32 nOverflows = ModemData_GetRxOverflows();
+	BOOL bInOrder = TRUE;
+	U_BYTE nData;
+	U_BYTE nSent;
+
+	for (nData = 0; nData < (TEST_REPLIES_HELD + 2); nData++)
+	{
+		test_Frame(MODEM_OPCODE_TX_PACKET, &nData, 1);
+		memcpy(&nLine[nLineLength], m_nLine, m_nLineLength);
+		nLineLength += m_nLineLength;
+	}
+	ModemData_ReceiveData(nLine, nLineLength, ElapsedTimeLowRes(START_LOW_RES_TIMER));
+	for (nSent = 0; nSent < TEST_REPLIES_HELD; nSent++)
+	{
+		ProcessModemBuffer();
+		bInOrder = bInOrder && m_nResponse.bReplyReady && (m_nResponse.eReply == MODEM_RESPONSE_TX_PACKET) &&
+		           (m_nResponse.nData[0] == nSent);
+		ModemData_ResetRxResponse();
+	}
+	ProcessModemBuffer();
+	HostTest_Check(bInOrder && !m_nResponse.bReplyReady, "%u back to back responses handed on in order",
+	               TEST_REPLIES_HELD);
+	HostTest_Check((ModemData_GetRxOverflows() - nOverflows) == 2, "%u responses past those held dropped",
+	               (unsigned)(ModemData_GetRxOverflows() - nOverflows));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	HostTest_Begin("Test_ModemFramer");
+	test_Mixed();
+	test_BackToBack();
+	return HostTest_Result();
+}
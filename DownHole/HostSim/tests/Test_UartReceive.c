@@ -0,0 +1,302 @@
+/*******************************************************************************
+*       @brief      UART receive spans and overruns.  Streams bytes into the
+*                   compass USART and checks UART_ServiceRxBuffer() hands
+*                   every one to the client in order, in at most two spans a
+*                   call, and that a main loop too slow for the DMA buffer
+*                   is counted as an overrun and the client resynced.
+*       @file       Downhole/HostSim/tests/Test_UartReceive.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+// The compass USART is wired to a FIFO the test writes to, set up ahead of
+// the HostSim power on, so the bytes arrive through the USART and receive
+// DMA models at the baud rate, with the IDLE and half and full transfer
+// interrupts marking them as on the board.  The compass client is replaced
+// at link time to take the spans.  The bytes count up modulo a prime, so a
+// span from the wrong place of the 256 byte DMA buffer shows.  At 57600
+// baud the buffer holds about 44mS: the main loop is played by calls
+// TEST_MOST_GAP mS apart at most while streaming, then held off well past
+// a buffer and just short of one.
+//
+// Settings (environment):
+//  HOSTSIM_SEED            random number seed, of the bursts and the gaps
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HostSim.h"
+#include "HostTest.h"
+#include "CommDriver_UART.h"
+#include "SysTick.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define TEST_BAUD_RATE              BAUD_RATE_57600
+#define TEST_RX_BUFFER              256
+#define TEST_SEQUENCE               251
+
+// the stream while the main loop keeps up
+#define TEST_STREAM_BYTES           20000
+#define TEST_MOST_BURST             600
+#define TEST_MOST_GAP               15          // mS between calls
+
+// bytes the main loop is held off for, well past a buffer and just short
+#define TEST_OVERRUN_BYTES          1000
+#define TEST_SHORT_BYTES            (TEST_RX_BUFFER - 10)
+// and after the overrun, well within a buffer
+#define TEST_RESUME_BYTES           200
+
+// mS for bytes to arrive, at least one per 0.2mS at 57600 baud
+#define TEST_ARRIVAL(nBytes)        (20 + ((nBytes) / 5))
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	U_INT32 nSent;              // bytes written to the FIFO
+	U_INT32 nNext;              // of the sequence, the next byte due
+	U_INT32 nReceived;
+	U_INT32 nOutOfOrder;
+	U_INT32 nSpans;
+	U_INT32 nLongSpans;         // longer than the DMA buffer
+	U_INT32 nCallSpans;         // spans in the current call
+	U_INT32 nMostCallSpans;
+	U_INT32 nBadStamps;
+	U_INT32 nResyncs;
+	TIME_RT tWritten;           // when the last bytes were written
+} TEST_RX_STATS;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static char m_szFifo[64];
+static int m_nFifo = -1;
+static TEST_RX_STATS m_Rx;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Runs ahead of the HostSim power on, which opens the compass endpoint.
+*******************************************************************************/
+__attribute__((constructor(101)))
+static void test_MakeFifo(void)
+{
+	snprintf(m_szFifo, sizeof(m_szFifo), "/tmp/Test_UartReceive-%d", (int)getpid());
+	if (mkfifo(m_szFifo, 0600) == 0)
+	{
+		setenv("HOSTSIM_USART2", m_szFifo, 1);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Takes the place of the compass client.
+*******************************************************************************/
+void __wrap_Compass_ServiceRxData(const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp)
+{
+	U_INT16 i;
+
+	m_Rx.nSpans++;
+	m_Rx.nCallSpans++;
+	m_Rx.nLongSpans += (nLength > TEST_RX_BUFFER) ? 1 : 0;
+	// the stamp is when the last byte had arrived, after it was written
+	if ((ElapsedTimeLowRes(tStamp) > ElapsedTimeLowRes(m_Rx.tWritten)) || (tStamp > ElapsedTimeLowRes(0)))
+	{
+		m_Rx.nBadStamps++;
+	}
+	for (i = 0; i < nLength; i++)
+	{
+		if (pData[i] != (U_BYTE)(m_Rx.nNext % TEST_SEQUENCE))
+		{
+			m_Rx.nOutOfOrder++;
+		}
+		m_Rx.nNext++;
+	}
+	m_Rx.nReceived += nLength;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void __wrap_Compass_ResyncRx(void)
+{
+	m_Rx.nResyncs++;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 test_Random(U_INT32 nRange)
+{
+	U_INT32 nValue = (U_INT32)(HostSim_RandomUniform() * nRange);
+
+	return (nValue < nRange) ? nValue : nRange - 1;
+}
+
+/*******************************************************************************
+*       @details
+*   Lets nTicks mS of the hardware clock go by.
+*******************************************************************************/
+static void test_Wait(U_INT32 nTicks)
+{
+	U_INT32 nStart = HostSim_GetTicks();
+
+	while ((HostSim_GetTicks() - nStart) < nTicks)
+	{
+		usleep(200);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The next nBytes of the sequence into the FIFO.
+*******************************************************************************/
+static BOOL test_Write(U_INT32 nBytes)
+{
+	U_BYTE nData[TEST_MOST_BURST > TEST_OVERRUN_BYTES ? TEST_MOST_BURST : TEST_OVERRUN_BYTES];
+	U_INT32 i;
+
+	for (i = 0; i < nBytes; i++)
+	{
+		nData[i] = (U_BYTE)((m_Rx.nSent + i) % TEST_SEQUENCE);
+	}
+	m_Rx.tWritten = ElapsedTimeLowRes(0);
+	if (write(m_nFifo, nData, nBytes) != (ssize_t)nBytes)
+	{
+		return FALSE;
+	}
+	m_Rx.nSent += nBytes;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   One pass of the main loop over the received data.
+*******************************************************************************/
+static void test_Service(void)
+{
+	m_Rx.nCallSpans = 0;
+	UART_ServiceRxBuffer();
+	m_Rx.nMostCallSpans = (m_Rx.nCallSpans > m_Rx.nMostCallSpans) ? m_Rx.nCallSpans : m_Rx.nMostCallSpans;
+}
+
+/*******************************************************************************
+*       @details
+*   Bursts of the sequence with the main loop keeping up, every byte must
+*   come through.
+*******************************************************************************/
+static void test_Stream(void)
+{
+	U_INT32 nOverruns = UART_GetRxOverruns(CLIENT_COMPASS);
+	U_INT32 nBurst;
+	U_INT32 nCalls = 0;
+	BOOL bWritten = TRUE;
+
+	while (bWritten && (m_Rx.nSent < TEST_STREAM_BYTES))
+	{
+		nBurst = 1 + test_Random(TEST_MOST_BURST);
+		bWritten = test_Write(nBurst);
+		// the main loop runs while the burst arrives
+		while (m_Rx.nReceived < m_Rx.nSent)
+		{
+			test_Wait(1 + test_Random(TEST_MOST_GAP));
+			test_Service();
+			if (++nCalls > (TEST_STREAM_BYTES * 10))
+			{
+				break;
+			}
+		}
+	}
+	HostTest_Print("%u bytes in %u spans, %u main loop passes", (unsigned)m_Rx.nReceived, (unsigned)m_Rx.nSpans,
+	               (unsigned)nCalls);
+	HostTest_Check(bWritten && (m_Rx.nReceived == m_Rx.nSent), "%u of %u bytes received",
+	               (unsigned)m_Rx.nReceived, (unsigned)m_Rx.nSent);
+	HostTest_Check(m_Rx.nOutOfOrder == 0, "%u bytes out of order", (unsigned)m_Rx.nOutOfOrder);
+	HostTest_Check((m_Rx.nMostCallSpans <= 2) && (m_Rx.nLongSpans == 0),
+	               "at most %u spans a pass, none past the buffer", (unsigned)m_Rx.nMostCallSpans);
+	HostTest_Check(m_Rx.nBadStamps == 0, "%u spans stamped out of time", (unsigned)m_Rx.nBadStamps);
+	HostTest_Check((UART_GetRxOverruns(CLIENT_COMPASS) == nOverruns) && (m_Rx.nResyncs == 0),
+	               "no overruns while the main loop keeps up");
+}
+
+/*******************************************************************************
+*       @details
+*   The main loop held off while nBytes arrive, then run.  Returns the
+*   overruns counted.
+*******************************************************************************/
+static U_INT32 test_HoldOff(U_INT32 nBytes)
+{
+	U_INT32 nOverruns = UART_GetRxOverruns(CLIENT_COMPASS);
+
+	m_Rx.nReceived = 0;
+	(void)test_Write(nBytes);
+	test_Wait(TEST_ARRIVAL(nBytes));
+	test_Service();
+	return UART_GetRxOverruns(CLIENT_COMPASS) - nOverruns;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+	U_INT32 nOverruns;
+	U_INT32 nResyncs;
+
+	HostTest_Begin("Test_UartReceive");
+	m_nFifo = open(m_szFifo, O_WRONLY | O_NONBLOCK);
+	unlink(m_szFifo);
+	if (!HostTest_Check(m_nFifo >= 0, "the compass USART wired to the test"))
+	{
+		return HostTest_Result();
+	}
+	// what of the firmware's start up the UARTs need
+	SysTick_Init();
+	UART_InitPins();
+	Initialize_UARTs();
+	UART_SetBaudRate(CLIENT_COMPASS, TEST_BAUD_RATE);
+	__enable_irq();
+
+	test_Stream();
+
+	// held off past a buffer, everything unread is dropped
+	nResyncs = m_Rx.nResyncs;
+	nOverruns = test_HoldOff(TEST_OVERRUN_BYTES);
+	HostTest_Check((nOverruns == 1) && (m_Rx.nResyncs == nResyncs + 1) && (m_Rx.nReceived == 0),
+	               "%u bytes held off: %u overrun, %u resync, %u bytes handed on", TEST_OVERRUN_BYTES,
+	               (unsigned)nOverruns, (unsigned)(m_Rx.nResyncs - nResyncs), (unsigned)m_Rx.nReceived);
+	// then on from the next byte to arrive
+	m_Rx.nNext = m_Rx.nSent;
+	m_Rx.nOutOfOrder = 0;
+	nOverruns = test_HoldOff(TEST_RESUME_BYTES);
+	HostTest_Check((nOverruns == 0) && (m_Rx.nReceived == TEST_RESUME_BYTES) && (m_Rx.nOutOfOrder == 0),
+	               "after the overrun %u of %u bytes received in order", (unsigned)m_Rx.nReceived,
+	               TEST_RESUME_BYTES);
+
+	// held off just short of a buffer, nothing lost
+	m_Rx.nMostCallSpans = 0;
+	nOverruns = test_HoldOff(TEST_SHORT_BYTES);
+	HostTest_Check((nOverruns == 0) && (m_Rx.nReceived == TEST_SHORT_BYTES) && (m_Rx.nOutOfOrder == 0) &&
+	               (m_Rx.nMostCallSpans <= 2),
+	               "%u bytes held off: %u received in order in %u spans", TEST_SHORT_BYTES,
+	               (unsigned)m_Rx.nReceived, (unsigned)m_Rx.nMostCallSpans);
+	close(m_nFifo);
+	return HostTest_Result();
+}
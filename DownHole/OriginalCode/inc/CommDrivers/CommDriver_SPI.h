@@ -29,6 +29,9 @@ typedef enum
     SPI_DEVICE_FRAM
 }SPI_DEVICE;
 
+// called from the DMA interrupt when a transfer ends, TRUE if it completed
+typedef void (*SPI_TRANSFER_CALLBACK)(BOOL bComplete);
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -62,6 +65,27 @@ extern "C" {
     ///@return
     U_BYTE SPI_TransferByte(U_BYTE nDataByte);
 
+    ///@brief  Starts a DMA block transfer with the device that has the bus
+    ///@param  pTxData bytes to send, NULL sends zeros
+    ///@param  pRxData where the bytes read go, NULL drops them
+    ///@param  nLength number of bytes each way
+    ///@param  pCallback called when it ends, NULL to poll SPI_IsTransferBusy()
+    ///@return FALSE if a transfer is running or the bus has timed out
+    BOOL SPI_StartTransfer(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength,
+                           SPI_TRANSFER_CALLBACK pCallback);
+
+    ///@brief  TRUE while a DMA block transfer is running
+    ///@param
+    ///@return
+    BOOL SPI_IsTransferBusy(void);
+
+    ///@brief  A DMA block transfer that waits for the end
+    ///@param  pTxData bytes to send, NULL sends zeros
+    ///@param  pRxData where the bytes read go, NULL drops them
+    ///@param  nLength number of bytes each way
+    ///@return TRUE if every byte was moved
+    BOOL SPI_Transfer(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength);
+
 #ifdef __cplusplus
 }
 #endif
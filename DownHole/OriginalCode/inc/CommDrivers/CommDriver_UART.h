@@ -22,11 +22,16 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
-// UART transmit buffer of 128 bytes provides enough space to transmit most
-// messages in full. The Data Link is capable of sending a message larger
-// than bytes using the callback from the UART to send successive pieces
-// of a message to generate a complete message.
-#define UART_BUFFER_SIZE_TX 128
+// Each UART has a transmit queue that DMA empties in the background. 512
+// bytes holds a full modem frame (262 bytes) with the next one queued behind
+// it, a message that does not fit is refused whole rather than cut short.
+#define UART_TX_QUEUE_SIZE  512
+
+#define BAUD_RATE_9600			9600
+#define BAUD_RATE_19200			19200
+#define BAUD_RATE_38400			38400
+#define BAUD_RATE_57600			57600
+#define BAUD_RATE_115200		115200
 
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
@@ -40,6 +45,16 @@ typedef enum
 
 typedef void (*UART_CALLBACK_TX)(void);
 
+// transmit statistics of one UART
+typedef struct
+{
+    U_INT32 nMessages;  // messages queued
+    U_INT32 nBytes;     // bytes queued
+    U_INT32 nStalls;    // messages refused because the queue was full
+    U_INT16 nDepth;     // bytes waiting to go now
+    U_INT16 nMaxDepth;  // most bytes ever waiting
+}UART_TX_STATS;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -51,10 +66,14 @@ extern "C" {
 	void Initialize_UARTs(void);
     void UART_InitPins(void);
     void UART_Init(void);
-    void UART_ServiceRxBufferDMA(void);
     void UART_ServiceRxBuffer(void);
+    BOOL UART_IsRxPending(void);
 //	void UART_ProcessRxData(void);
-    void UART_SendMessage(UART_CLIENT eClient, const U_BYTE *pData, U_INT16 nDataLen);
+    BOOL UART_SendMessage(UART_CLIENT eClient, const U_BYTE *pData, U_INT16 nDataLen);
+    U_INT16 UART_GetTxFree(UART_CLIENT eClient);
+    void UART_GetTxStats(UART_CLIENT eClient, UART_TX_STATS *pStats);
+    U_INT32 UART_GetRxOverruns(UART_CLIENT eClient);
+    void UART_SetBaudRate(UART_CLIENT eClient, U_INT32 nBaudRate);
 
 #ifdef __cplusplus
 }
@@ -16,9 +16,6 @@
 
 #include "main.h"
 
-extern U_INT16 PeakDetectInputu16;
-extern BOOL PeakDetectInputIsValid;
-
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -33,7 +30,9 @@ extern "C" {
     void ADC_Start(void);
     void ADC_Disable(void);
     U_INT16 GetBatteryInputVoltageU16(void);
+    U_INT16 GetBatteryMinimumVoltageU16(void);
     U_INT16 GetPeakDetectInputU16(void);
+    U_INT16 GetPeakDetectMaximumU16(void);
 
 #ifdef __cplusplus
 }
@@ -31,6 +31,8 @@ extern "C" {
     TIME_RT GetIdleTimer(void);
     void StartSysOffTimer(void);
     TIME_RT GetSysOffTimer(void);
+    void Power_Idle(void);
+    U_INT16 Power_GetSleepPermille(void);
     void SetProcessorToStandbyModeUSE_RTC_Wakeup_Pin(U_INT16);
     void SetProcessorToStandbyModeUSE_RTC(void);
 	void EnableModemPower(BOOL bPower);
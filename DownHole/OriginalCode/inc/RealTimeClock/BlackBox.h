@@ -0,0 +1,93 @@
+/*******************************************************************************
+*       @brief      Contains header information for the black box, a ring of
+*                   events kept in the backup SRAM that survives a reset.
+*       @file       Downhole/inc/RealTimeClock/BlackBox.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef BLACK_BOX_H
+#define BLACK_BOX_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// events kept, the oldest is written over
+#define BLACKBOX_SIZE			64
+
+// nType of an event
+// 1 the core came out of reset, nData is the RCC CSR reset flags, bits 31 to
+//   24, in the low byte and the modem state in the high byte, nTask and tTime
+//   are where the run before it had got to
+// 2 the least free stack of the run before, nData is in words
+// 3 the modem went online, nData is its state
+// 4 the modem left online, nData is its state
+#define BLACKBOX_EVENT_RESET		1
+#define BLACKBOX_EVENT_STACK		2
+#define BLACKBOX_EVENT_MODEM_ONLINE	3
+#define BLACKBOX_EVENT_MODEM_OFFLINE	4
+
+// nTask when no scheduler task is running
+#define BLACKBOX_NO_TASK		0xFF
+
+// free stack where it is not measured
+#define BLACKBOX_STACK_UNKNOWN		0xFFFF
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// one event, two words
+typedef struct
+{
+	U_BYTE nType;			// BLACKBOX_EVENT_xxx
+	U_BYTE nTask;			// scheduler task running, BLACKBOX_NO_TASK
+	U_INT16 nData;
+	U_INT32 tTime;			// mS since that power up
+} BLACKBOX_EVENT;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Records why the core reset and where the run before got to, after
+	// NVPower_Initialize has the backup SRAM powered
+	void BlackBox_Initialize(void);
+	// Keeps the time alive and measures the stack, a scheduler task
+	void BlackBox_Service(void);
+	// Notes the scheduler task about to run, BLACKBOX_NO_TASK once it returns
+	void BlackBox_SetTask(U_BYTE nTask);
+	// Notes the modem state, with an event when it goes or leaves online
+	void BlackBox_SetModemState(U_BYTE nState, BOOL bOnline);
+	// Adds an event, from the main loop only
+	void BlackBox_Record(U_BYTE nType, U_INT16 nData);
+	// Returns the number of events in the ring
+	U_BYTE BlackBox_GetCount(void);
+	// Copies event nIndex, the oldest is 0, FALSE if there is no such event
+	BOOL BlackBox_GetEvent(U_BYTE nIndex, BLACKBOX_EVENT *pEvent);
+	// Returns the resets since the ring was started
+	U_INT16 BlackBox_GetResets(void);
+	// Returns the watchdog resets since the ring was started
+	U_INT16 BlackBox_GetWatchdogResets(void);
+	// Returns the least free stack of this run in words, BLACKBOX_STACK_UNKNOWN
+	U_INT16 BlackBox_GetStackFree(void);
+	// Empties the ring and starts the reset counts over
+	void BlackBox_Clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
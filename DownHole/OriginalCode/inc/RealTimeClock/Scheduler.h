@@ -0,0 +1,80 @@
+/*******************************************************************************
+*       @brief      Contains header information for the scheduler, which runs
+*                   the main loop tasks from a table and times them.
+*       @file       Downhole/inc/RealTimeClock/Scheduler.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// most tasks in the table
+#define SCHEDULER_MAX_TASKS		16
+
+// characters of a task name sent uphole
+#define SCHEDULER_NAME_LENGTH		4
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// one entry of the task table
+typedef struct
+{
+	void (*pfTask)(void);
+	const char *pName;		// SCHEDULER_NAME_LENGTH characters are sent
+	TIME_RT tPeriod;		// mS between runs, 0 runs it every pass
+	TIME_RT tDeadline;		// mS a run may start late before it is a miss
+} SCHEDULER_TASK;
+
+// what has been measured of a task since the statistics were cleared
+typedef struct
+{
+	U_INT32 nRuns;
+	U_INT32 nMisses;		// runs started more than tDeadline late
+	U_INT32 nWorstMicroSeconds;	// longest run
+	U_INT32 nAverageMicroSeconds;
+} SCHEDULER_STATS;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Takes the task table and starts the DWT cycle counter
+	void Scheduler_Initialize(const SCHEDULER_TASK *pTasks, U_BYTE nTasks);
+	// Runs every task that is due, in table order, once each pass
+	void Scheduler_Run(void);
+	// Returns the mS until the next timed task is due, 0 if one is due now
+	TIME_RT Scheduler_GetTimeToNext(void);
+	// Returns the number of tasks in the table
+	U_BYTE Scheduler_GetTaskCount(void);
+	// Returns the name of task nTask
+	const char *Scheduler_GetTaskName(U_BYTE nTask);
+	// Returns the period of task nTask, mS
+	TIME_RT Scheduler_GetTaskPeriod(U_BYTE nTask);
+	// Copies the statistics of task nTask, FALSE if there is no such task
+	BOOL Scheduler_GetStats(U_BYTE nTask, SCHEDULER_STATS *pStats);
+	// Starts the statistics of every task over
+	void Scheduler_ClearStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
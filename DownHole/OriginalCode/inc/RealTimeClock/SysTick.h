@@ -78,6 +78,7 @@ extern "C" {
 
 	void SysTick_Init(void);
 	void Process_SysTick_Events(void);
+	U_INT32 SysTick_Sleep(TIME_RT nTicks);
 	TIME_RT ElapsedTimeLowRes(TIME_RT nOldTime);
 
 	extern volatile BOOL Ten_mS_tick_flag;
@@ -0,0 +1,76 @@
+/*******************************************************************************
+*       @brief      Contains header information for the sample buffer, which
+*                   keeps the samples taken between uphole polls.
+*       @file       Downhole/inc/Sensors/SampleBuffer.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// samples kept, the oldest is dropped when a new one does not fit
+#define SAMPLE_BUFFER_SIZE		64
+
+// nFlags of a sample
+#define SAMPLE_FLAG_COMPASS		0x01	// compass was answering
+#define SAMPLE_FLAG_GAMMA		0x02	// gamma window was full
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+typedef struct
+{
+	TIME_RT tTime;			// mS since power up
+	U_BYTE nFlags;			// SAMPLE_FLAG_xxx
+	INT16 nAzimuth;			// degrees times 10
+	INT16 nPitch;			// degrees times 10
+	INT16 nRoll;			// degrees times 10
+	U_INT16 nTemperature;
+	U_INT16 nGamma;			// counts per second
+	U_INT16 nGammaError;		// 0.1 counts per second
+	U_INT16 nBattery;
+} SAMPLE_RECORD;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Takes a sample when one is due, called every 10mS
+	void SampleBuffer_Service(void);
+	// Sets the mS between samples, 0 stops sampling and empties the buffer
+	void SampleBuffer_SetInterval(U_INT16 nInterval);
+	// Returns the mS between samples
+	U_INT16 SampleBuffer_GetInterval(void);
+	// Drops the samples before nSequence, the uphole has them
+	void SampleBuffer_Release(U_INT16 nSequence);
+	// Returns the sequence number of the oldest sample kept
+	U_INT16 SampleBuffer_GetFirstSequence(void);
+	// Returns the number of samples kept
+	U_BYTE SampleBuffer_GetCount(void);
+	// Returns the samples dropped because the buffer was full, wraps
+	U_INT16 SampleBuffer_GetDropped(void);
+	// Copies the nIndex oldest sample, FALSE if there is no such sample
+	BOOL SampleBuffer_GetSample(U_BYTE nIndex, SAMPLE_RECORD *pSample);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
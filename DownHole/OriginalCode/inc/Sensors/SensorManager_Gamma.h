@@ -30,10 +30,16 @@ extern "C" {
     void GammaSensor_InitPins(void);
     // Initializes Gamma Sensor TIM Settings
     void Initialize_Gamma_Sensor(void);
-    // Updates Gamma Count
+    // Updates Gamma Count, called every 10mS
     void UpdateGammaCountsThisPeriod(void);
-    // Returns Gamma Count
+    // Returns Gamma Count, counts per second over the window
     U_INT16 GetCurrentGammaCount(void);
+    // Returns the standard error of the gamma count, 0.1 counts per second
+    U_INT16 GetCurrentGammaError(void);
+    // Sets the slot period and window in mS, and the dead time in nS
+    void SetGammaWindow(U_INT16 nPeriod, U_INT16 nWindow, U_INT16 nDeadTime);
+    // Returns the window in mS
+    U_INT16 GetGammaWindow(void);
 	void SetGammaPower(BOOL desiredState);
 
 #ifdef __cplusplus
@@ -22,18 +22,57 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
-// compass manufacturers.. use
-// 0 for Vector nav
-// 1 for APS 544
-// 2 for Tensteer
-#define COMPASS_VECTORNAV		0
-#define COMPASS_APS544			1
-#define COMPASS_TENFOOT			2
-#define COMPASS_MANUFACTURER	2
+// compass manufacturers, probed at boot and kept in the NV block
+// 0 not detected yet
+// 1 for Vector nav
+// 2 for APS 544
+// 3 for Tensteer
+#define COMPASS_UNKNOWN			0
+#define COMPASS_VECTORNAV		1
+#define COMPASS_APS544			2
+#define COMPASS_TENFOOT			3
+#define NUM_COMPASS_TYPES		4
+
+// Tenfoot survey math precision.. use
+// 1 for single precision, runs on the FPU
+// 0 for double precision, software emulated, kept as the reference
+#ifndef COMPASS_MATH_FLOAT32
+ #define COMPASS_MATH_FLOAT32	1
+#endif
 
 #ifndef M_PI
  #define M_PI 3.14159265358979323846
 #endif
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// survey latched while the tool was still, angles and degrees C times 10
+typedef struct
+{
+	INT16 nAzimuth;
+	INT16 nPitch;
+	INT16 nRoll;
+	INT16 nTemperature;
+	U_BYTE nQuality;	// 0 to 100, 100 for no movement at all
+	U_BYTE nSamples;	// raw samples averaged into it
+	TIME_RT tLatched;	// low res time it was taken
+	BOOL isValid;
+} COMPASS_BEST_SURVEY;
+
+// how far to trust a survey, 0 for anything the compass does not report
+typedef struct
+{
+	U_INT16 nGtotal;		// total gravity, mG
+	U_INT16 nHtotal;		// total field, 10 nT
+	INT16 nDip;			// dip, degrees times 10
+	INT16 nTemperatureDrift;	// 0.1 degrees C per minute
+	U_BYTE nSamples;		// raw samples averaged into the survey
+	U_INT16 nGtotalStd;		// spread of the total gravity, 0.1 mG
+	U_INT16 nHtotalStd;		// spread of the total field, nT
+} COMPASS_SURVEY_METRICS;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -44,10 +83,12 @@ extern "C" {
 
 	//  Initializes the compass
 	void Compass_Initialize(void);
-	// Retrieves data from the UART and places the data into the compass message buffer
-	// nData the incoming character to be put in the buffer
-	void Compass_ServiceRxData(U_BYTE nData);
-	// Processes the data in the compass message buffer
+	// Frames data from the UART receive buffer in the compass message buffer
+	// pData, nLength the bytes received, tStamp when they had arrived
+	void Compass_ServiceRxData(const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp);
+	// Drops a partial frame after the UART lost received bytes
+	void Compass_ResyncRx(void);
+	// Processes a complete frame in the compass message buffer
 	void Compass_ProcessRxData(void);
 	// Manages states and transitions between states for the compass State Machine
 	void Compass_StateManager(void);
@@ -61,6 +102,31 @@ extern "C" {
 	INT16 Compass_GetSurveyTemperature(void);
 	// Returns connection state of the compass
 	BOOL Compass_IsDataValid(void);
+	// Copies the Gtotal, Htotal, dip and spread that went with the survey
+	void Compass_GetSurveyMetrics(COMPASS_SURVEY_METRICS *pMetrics);
+	// Sets the mS between compass requests, 0 asks again as soon as answered
+	void Compass_SetStreamInterval(U_INT16 nInterval);
+	// Returns the mS between compass requests
+	U_INT16 Compass_GetStreamInterval(void);
+	// Replaces the survey with the outlier-free average of the raw samples
+	// from the last tWindow mS, returns the number of samples used
+	U_BYTE Compass_ReduceWindow(TIME_RT tWindow);
+	// Sets the mS the tool must be still before a survey is latched
+	void Compass_SetStillWindow(U_INT16 nWindow);
+	// Returns TRUE while the tool is still
+	BOOL Compass_IsStill(void);
+	// Copies the best survey of the latest still period, FALSE if none yet
+	BOOL Compass_GetBestSurvey(COMPASS_BEST_SURVEY *pSurvey);
+	// Returns the compass manufacturer in use, COMPASS_UNKNOWN while probing
+	U_BYTE Compass_GetType(void);
+	// Returns the number of compass frames decoded
+	U_INT32 Compass_GetFrameCount(void);
+	// Returns the number of compass frames that failed their checksum
+	U_INT32 Compass_GetChecksumErrorCount(void);
+	// Returns the number of bytes dropped because a frame was waiting or too long
+	U_INT32 Compass_GetOverrunCount(void);
+	// Returns the number of passes held back for room to send a request
+	U_INT32 Compass_GetTxWaitCount(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,88 @@
+/*!
+********************************************************************************
+*       @brief      This header file contains callable functions to the
+*                   magnetometer calibration.
+*       @file       Downhole/inc/Sensors/compass_cal.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef _COMPASS_CAL_H
+#define _COMPASS_CAL_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// calibration states
+// 0 nothing going on
+// 1 collecting field vectors while the tool is turned
+// 2 fitted, the coefficients are in the NV block
+// 3 too few samples, or no ellipsoid fits them
+#define COMPASS_CAL_IDLE		0
+#define COMPASS_CAL_COLLECTING		1
+#define COMPASS_CAL_DONE		2
+#define COMPASS_CAL_FAILED		3
+
+// terms of the general ellipsoid, x^2 y^2 z^2 2xy 2xz 2yz 2x 2y 2z
+#define COMPASS_CAL_TERMS		9
+
+// Jacobi sweeps allowed for the 3x3 eigen problems, 4 are usually enough
+#define COMPASS_CAL_MAX_SWEEPS		10
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// running sums of the least squares ellipsoid fit, the samples are not kept
+typedef struct
+{
+	REAL64 fNormal[COMPASS_CAL_TERMS][COMPASS_CAL_TERMS];	// upper triangle, the fit factors it into the lower
+	REAL64 fRight[COMPASS_CAL_TERMS];
+	REAL64 fScale;		// nT, field of the first sample
+	REAL32 fLast[3];	// last sample taken, nT
+	U_INT16 nSamples;
+} COMPASS_CAL_SUMS;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+	// Clears the sums and starts collecting field vectors
+	void CompassCal_Start(void);
+	// Stops collecting and throws the sums away
+	void CompassCal_Cancel(void);
+	// Takes one raw field vector in nT while collecting, returns TRUE if it
+	// was far enough from the last one to be used
+	BOOL CompassCal_AddSample(REAL32 fHx, REAL32 fHy, REAL32 fHz);
+	// Fits the ellipsoid and stores the coefficients, returns the new state
+	U_BYTE CompassCal_Finish(void);
+	// Returns the calibration state, COMPASS_CAL_xxx
+	U_BYTE CompassCal_GetState(void);
+	// Returns the number of field vectors collected
+	U_INT16 CompassCal_GetSampleCount(void);
+	// Returns the rms distance of the samples from the fitted ellipsoid, nT
+	U_INT16 CompassCal_GetResidual(void);
+	// Returns the most Jacobi sweeps an eigen problem of the last fit took
+	U_BYTE CompassCal_GetSweeps(void);
+	// Fits hard iron offset and soft iron matrix to the sums, so that
+	// M (h - offset) lies on a sphere, FALSE if the sums hold no ellipsoid.
+	// The sums are used up by it.
+	BOOL CompassCal_Fit(COMPASS_CAL_SUMS *pSums, REAL32 *pfOffset, REAL32 *pfMatrix, REAL32 *pfResidual);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,95 @@
+/*!
+********************************************************************************
+*       @brief      This header file contains callable functions to the gamma
+*                   and inclination log kept in the serial flash.
+*       @file       Downhole/inc/SerialFlash/DataLog.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef _DATA_LOG_H
+#define _DATA_LOG_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// log states
+// 0 not recording
+// 1 a record is taken every interval
+// 2 the log is being erased, it records again once empty if it was
+// 3 the event area is full
+#define DATALOG_STOPPED			0
+#define DATALOG_RECORDING		1
+#define DATALOG_CLEARING		2
+#define DATALOG_FULL			3
+
+// first byte of every record, a blank page reads 0xFF
+#define DATALOG_MARKER			0xA5
+
+// nFlags of a record
+#define DATALOG_FLAG_GAMMA		0x01	// gamma window was full
+#define DATALOG_FLAG_COMPASS		0x02	// compass was answering
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+#pragma pack(2)
+
+// one log record, as stored and as sent uphole, fills one EVENT_SLOT_SIZE slot
+typedef struct
+{
+	U_BYTE nMarker;			// DATALOG_MARKER
+	U_BYTE nFlags;			// DATALOG_FLAG_xxx
+	U_INT16 nSession;		// power ups since the log was cleared
+	U_INT32 tTime;			// mS since this power up
+	U_INT16 nGamma;			// counts per second
+	U_INT16 nGammaError;		// 0.1 counts per second
+	INT16 nInclination;		// compass pitch, degrees times 10
+	INT16 nToolface;		// compass roll, degrees times 10
+} DATALOG_RECORD;
+
+#pragma pack()
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+	// Finds the end of the log after the serial flash is found
+	void DataLog_Initialize(void);
+	// Takes a record when one is due and erases while clearing, every 10mS
+	void DataLog_Service(void);
+	// Starts recording every nInterval seconds, also after a power up
+	void DataLog_Start(U_INT16 nInterval);
+	// Stops recording
+	void DataLog_Stop(void);
+	// Erases the log a page at a time
+	void DataLog_Clear(void);
+	// Returns the log state, DATALOG_xxx
+	U_BYTE DataLog_GetState(void);
+	// Returns the seconds between records
+	U_INT16 DataLog_GetInterval(void);
+	// Returns the number of records in the log
+	U_INT32 DataLog_GetCount(void);
+	// Returns the number of records the log can hold
+	U_INT32 DataLog_GetCapacity(void);
+	// Copies record nIndex, FALSE if there is no such record
+	BOOL DataLog_GetRecord(U_INT32 nIndex, DATALOG_RECORD *pRecord);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,125 @@
+/*******************************************************************************
+*       @brief      Contains header information for the firmware update, an
+*                   image sent from uphole a chunk at a time into the serial
+*                   flash, then checked whole for the bootloader to install.
+*       @file       Downhole/inc/SerialFlash/FirmwareUpdate.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// bytes of the image in a chunk, the last chunk has what is left
+#define FIRMWARE_CHUNK_SIZE		128
+
+// chunks the record keeps a bit for, the whole firmware image area
+#define FIRMWARE_MAX_CHUNKS		4096
+
+// where the update record is kept, in the backup SRAM above the black box
+#define FIRMWARE_UPDATE_ADDRESS		(BKPSRAM_BASE + 0x400)
+
+// the bootloader takes the first two 16K sectors of the internal flash, the
+// application is linked to start after it, see STM32F405VGTX_BOOT.ld
+#define FIRMWARE_BOOTLOADER_SIZE	0x8000ul
+#define FIRMWARE_APPLICATION_ADDRESS	(FLASH_BASE + FIRMWARE_BOOTLOADER_SIZE)
+
+// marks the record as started, the SRAM is all 0xFF after the backup power
+// was lost, and changes whenever FIRMWARE_UPDATE does
+#define FIRMWARE_UPDATE_MAGIC		0x46575531ul
+
+// nState of the update
+// 0 there is no image
+// 1 chunks are being taken
+// 2 every chunk is in and the image is being checked against its CRC
+// 3 the image checked out, for the bootloader to install
+// 4 the image did not check out, it has to be sent again
+#define FIRMWARE_STATE_IDLE		0
+#define FIRMWARE_STATE_RECEIVING	1
+#define FIRMWARE_STATE_VERIFYING	2
+#define FIRMWARE_STATE_READY		3
+#define FIRMWARE_STATE_FAILED		4
+
+// what became of a chunk
+// 0 it is in the flash, or was already
+// 1 chunks are not being taken
+// 2 there is no such chunk, or it is the wrong length for it
+// 3 the data does not match its CRC, send it again
+// 4 the serial flash did not take it
+#define FIRMWARE_CHUNK_OK		0
+#define FIRMWARE_CHUNK_NOT_RECEIVING	1
+#define FIRMWARE_CHUNK_BAD_NUMBER	2
+#define FIRMWARE_CHUNK_BAD_CRC		3
+#define FIRMWARE_CHUNK_FLASH_ERROR	4
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// the update, kept through a reset so a transfer carries on where it got to.
+// The bootloader that finds FIRMWARE_STATE_READY copies nSize bytes from the
+// start of the firmware image area, the top FIRMWARE_IMAGE_PAGES pages of
+// the serial flash, to FIRMWARE_APPLICATION_ADDRESS, checks them against
+// nCRC and puts the state back to FIRMWARE_STATE_IDLE, see Bootloader.c.
+typedef struct
+{
+	U_INT32 nMagic;			// FIRMWARE_UPDATE_MAGIC
+	U_INT32 nSize;			// bytes of the image
+	U_INT32 nCRC;			// CRC32_Update of the image bytes
+	U_BYTE nState;			// FIRMWARE_STATE_xxx
+	U_BYTE nSpare;
+	U_INT16 nReceived;		// chunks in the flash
+	U_BYTE Received[FIRMWARE_MAX_CHUNKS / 8];	// chunk 0 is bit 0 of byte 0
+} FIRMWARE_UPDATE;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Picks up the update from before the reset, after BlackBox_Initialize
+	// and Serflash_read_DID_data
+	void FirmwareUpdate_Initialize(void);
+	// Checks the image once every chunk is in, a scheduler task
+	void FirmwareUpdate_Service(void);
+	// Starts taking an image, or carries on with the one of the same size
+	// and CRC.  A size of 0 drops the image.  FALSE if it does not fit.
+	BOOL FirmwareUpdate_Start(U_INT32 nSize, U_INT32 nCRC);
+	// Keeps chunk nChunk if it matches its CRC, that of the chunk number low
+	// byte first then the data.  Returns FIRMWARE_CHUNK_xxx
+	U_BYTE FirmwareUpdate_WriteChunk(U_INT16 nChunk, const U_BYTE *pData, U_BYTE nLength, U_INT32 nCRC);
+	// Starts checking the image, FALSE if a chunk is missing or nCRC is not
+	// the one it was started with
+	BOOL FirmwareUpdate_Commit(U_INT32 nCRC);
+	// Returns the update state, FIRMWARE_STATE_xxx
+	U_BYTE FirmwareUpdate_GetState(void);
+	// Returns the bytes of the image
+	U_INT32 FirmwareUpdate_GetSize(void);
+	// Returns the CRC the image was started with
+	U_INT32 FirmwareUpdate_GetCRC(void);
+	// Returns the number of chunks in the image
+	U_INT16 FirmwareUpdate_GetChunkCount(void);
+	// Returns the number of chunks in the flash
+	U_INT16 FirmwareUpdate_GetReceivedCount(void);
+	// Returns byte nIndex of the received chunk bitmap
+	U_BYTE FirmwareUpdate_GetReceived(U_INT16 nIndex);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
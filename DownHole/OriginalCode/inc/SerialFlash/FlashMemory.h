@@ -15,6 +15,7 @@
 //============================================================================//
 
 #include "main.h"
+#include "ModemManager.h"
 
 //============================================================================//
 //      CONSTANTS                                                             //
@@ -26,11 +27,13 @@
 #define SERFLASH45_READ_STATUS_OPCODE		0xD7	// status register read
 #define SERFLASH45_ERASE_PAGE_OPCODE		0x81	// page erase
 #define SERFLASH45_WRITE_BUFFER1_OPCODE		0x84	// Buffer 1 write
-#define SERFLASH45_WRITE_BUFFER2_OPCODE		0x87	// Buffer 1 write
+#define SERFLASH45_WRITE_BUFFER2_OPCODE		0x87	// Buffer 2 write
 #define SERFLASH45_BUF1_TO_PAGE_OPCODE		0x88	// Buf 1 to main mem page prog w/o erase
 #define SERFLASH45_BUF2_TO_PAGE_OPCODE		0x89	// Buf 2 to main mem page prog w/o erase
 #define SERFLASH45_BUF1_TO_PAGE_ERASE_OPCODE	0x83	// Buf 1 to main mem page prog with erase
 #define SERFLASH45_BUF2_TO_PAGE_ERASE_OPCODE	0x86	// Buf 2 to main mem page prog with erase
+#define SERFLASH45_PAGE_TO_BUF1_OPCODE		0x53	// main mem page to Buf 1 transfer
+#define SERFLASH45_PAGE_TO_BUF2_OPCODE		0x55	// main mem page to Buf 2 transfer
 #define FLASH_STATUS_BUSY_BIT       0x80
 #define FLASH_STATUS_BUSY           0
 #define EMPTY_SLOT_CRC              0xCDD54B59
@@ -41,6 +44,17 @@
 #define	AT45_PAGE_SIZE					512		// in 8 bit bytes
 #define CHIP_PAGE_SIZE 				AT45_PAGE_SIZE
 
+// the event area packs fixed size slots into each page, filled in order.
+// A slot that starts 0xFF 0xFF is blank, and so is every slot after it.
+#define EVENT_SLOT_SIZE				16		// in 8 bit bytes
+#define EVENTS_PER_PAGE				(CHIP_PAGE_SIZE / EVENT_SLOT_SIZE)
+// event_buffer_page when buffer 2 does not hold an event page
+#define EVENT_BUFFER_EMPTY			0xFFFFFFFFul
+
+// the firmware image area takes the top of the chip, below it is the event
+// area.  Half a megabyte, more than the internal flash an image can use.
+#define FIRMWARE_IMAGE_PAGES			1024ul
+
 // IMPORTANT!!
 // In order to use external tools to upload and interpret the NVRAM structures
 // we need to assure that the CRC locations are always deterministic.  Always
@@ -48,6 +62,19 @@
 // bytes are not unexpectedly inserted and offset the CRC address.
 // Also make sure multi-byte parameters, E.G., U_INT16, start on an even address.
 //
+// Each layout of the NV block adds to the end of the one before, just ahead
+// of the CRC, so the CRC of a block saved by older code is at the end of
+// that layout.  A block of an older layout is brought up to this one with
+// the new parameters at their defaults, see FLASH_CheckTheNVChecksum().
+// From layout 3 on nLayoutVersion is at the same place in every layout, new
+// parameters go after it.  Bump NV_LAYOUT_VERSION and add the layout to
+// FlashMemory.c for each change.
+//  1   nDownholeOnTime, bGamma, nCompassType
+//  2   the magnetometer calibration
+//  3   the gamma and inclination log, nLayoutVersion
+//  4   the modem configuration, formerly in the backup SRAM
+#define NV_LAYOUT_VERSION	4
+
 #pragma pack(2)
 
 typedef struct
@@ -55,6 +82,22 @@ typedef struct
 //	INT16 nDownholeOffTime;
 	INT16 nDownholeOnTime;
 	U_BYTE bGamma;
+	// takes the former alignment byte, blocks saved before it read as 0
+	U_BYTE nCompassType;
+	// magnetometer calibration, field = M (raw - offset)
+	U_BYTE bMagCalibrated;
+	U_BYTE nMagCalSpare;	// keeps the reals on an even address
+	REAL32 fMagOffset[3];	// hard iron, nT
+	REAL32 fMagMatrix[9];	// soft iron, row by row
+	// gamma and inclination log, carries on recording after a power up
+	U_INT16 nLogInterval;	// seconds between records
+	U_BYTE bLogRecording;
+	U_BYTE nLayoutVersion;	// NV_LAYOUT_VERSION
+	// the operation mode and serial number the modem was last found to have
+	U_INT16 nModemMode;		// table 6 index 0x31
+	U_BYTE nModemSerial[MODEM_SN_LENGTH];
+	U_BYTE bModemConfigured;
+	U_BYTE nModemSpare;		// keeps the CRC on an even address
 //	U_BYTE bDownholeDeepSleep;
 //	U_BYTE bGammaMonitor;
 
@@ -68,13 +111,15 @@ typedef struct {
 	U_BYTE	storage_capacity;	// 0x11 for 1Mbit part, and 0x16 for 32Mbit part.. see table for more
 	U_BYTE 	part_index;		// Index into table describing chip parameters, see file for index data.
 	U_BYTE 	ext_flash_working;
-	U_INT32 event_number;
+	U_INT32 event_number;		// events stored, the next one goes in this slot
+	U_INT32 event_buffer_page;	// event page copied in buffer 2
 	U_INT32 page_size;
 	U_INT32 Max_pages_available;
 	U_INT32	NV_test_page;
 	U_INT32	NV_param_start_page;
 	U_INT32	EVENTS_start_page;
 	U_INT32	EVENTS_pages_available;
+	U_INT32	FIRMWARE_start_page;
 } Flash_chip_type;
 
 typedef struct
@@ -109,6 +154,21 @@ void Set_NV_data_to_defaults(void);
 void Check_NV_data_boundaries(void);
 BOOL FLASH_CheckTheNVChecksum();
 
+// the event area, EVENTS_PER_PAGE events per page
+U_INT32 GetEventRecordCount(void);
+U_INT32 GetEventRecordCapacity(void);
+U_INT32 Serflash_recover_events(void);
+BOOL Serflash_erase_last_event(void);
+void Serflash_Events_Clear(void);
+U_INT32 Serflash_find_next_event_slot(U_INT32 event_block_size);
+U_BYTE Serflash_program_event(U_BYTE *this_event, U_INT32 event_block_size);
+U_BYTE Serflash_get_event(U_INT32 event_number, U_INT32 event_block_size, U_BYTE *theData);
+
+// the firmware image area, FIRMWARE_IMAGE_PAGES pages from the top of the chip
+U_INT32 GetFirmwareCapacity(void);
+U_BYTE Serflash_program_firmware(U_INT32 offset, const U_BYTE *theData, U_INT16 length, BOOL bBlankPage);
+U_BYTE Serflash_read_firmware_page(U_INT32 a_page, U_BYTE *theData);
+
 //void SetDownholeOffTime(U_INT16);
 //U_INT16 GetDownholeOffTime(void);
 void SetDownholeOnTime(U_INT16);
@@ -118,6 +178,19 @@ U_INT16 GetDownholeOnTime(void);
 // what does telemetry tell us to do with gamma?
 void SetGammaOnOff(BOOL);
 BOOL GetGammaOnOff(void);
+// the compass manufacturer last found, COMPASS_xxx
+void SetCompassType(U_BYTE);
+U_BYTE GetCompassType(void);
+// the magnetometer hard and soft iron calibration, FALSE clears it
+void SetMagCalibration(BOOL, const REAL32 *, const REAL32 *);
+BOOL GetMagCalibration(REAL32 *, REAL32 *);
+// the gamma and inclination log, interval in seconds
+void SetLogRecording(BOOL, U_INT16);
+BOOL GetLogRecording(void);
+U_INT16 GetLogInterval(void);
+// the modem operation mode and serial number last found good, FALSE clears it
+void SetModemConfig(BOOL, U_INT16, const U_BYTE *);
+BOOL GetModemConfig(U_INT16 *, U_BYTE *);
 // looks like gamma keeping track of it's state
 //void SetGammaMonitor(BOOL);
 //BOOL GetGammaMonitor(void);
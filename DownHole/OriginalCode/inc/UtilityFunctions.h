@@ -34,6 +34,8 @@ extern "C" {
 
     U_BYTE GetUnsignedByte(U_BYTE* packet);
 
+    U_INT32 GetUnsignedLong(U_BYTE* packet);
+
 
 
 #ifdef __cplusplus
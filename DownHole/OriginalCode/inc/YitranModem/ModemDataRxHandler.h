@@ -27,8 +27,6 @@
 #define NODE_CONNECTED_INDEX    21
 #define NODE_SERIAL_NUM_INDEX    5
 
-#define MODEM_RECEIVE_BUFFER_SIZE   512
-
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -57,9 +55,14 @@ extern "C" {
 //    const MODEM_REPLY_DATA_STRUCT* GetRxIndication(void);
     void ModemData_ResetRxResponse(void);
     void ModemData_ResetRxIndication(void);
-	void ModemData_ReceiveData(U_BYTE nData);
-	U_BYTE getBufferByte(void);
+	void ModemData_FlushRx(void);
+	void ModemData_ResyncRx(void);
+	void ModemData_ReceiveData(const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp);
 	void ProcessModemBuffer(void);
+	U_INT32 ModemData_GetRxFrameCount(void);
+	U_INT32 ModemData_GetRxFramingErrors(void);
+	U_INT32 ModemData_GetRxChecksumErrors(void);
+	U_INT32 ModemData_GetRxOverflows(void);
 
 #ifdef __cplusplus
 }
@@ -17,6 +17,15 @@
 #include "main.h"
 #include "ModemDataHandler.h"
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// header ModemData_ProcessTxPacketRequest puts in front of each message
+#define MODEM_TX_PACKET_HEADER_LENGTH   15
+// longest message Modem_MessageToSend takes, it goes out in one packet
+#define MODEM_MAX_MESSAGE_LENGTH        (MODEM_MESSAGE_BUFFER_SIZE - MODEM_TX_PACKET_HEADER_LENGTH)
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -65,6 +74,16 @@ extern "C" {
     ///@return
     void ModemData_ProcessGetSerialNumberRequest(void);
 
+    ///@brief sends the frame the UART had no room for, if one is held
+    void ModemData_SendHeldRequest(void);
+
+    ///@brief forgets a held frame
+    void ModemData_FlushTx(void);
+
+    ///@brief
+    ///@return frames held because the UART queue was full
+    U_INT32 ModemData_GetHeldFrames(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,25 @@
 
 #include "main.h"
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the CRC unit's register after a reset
+#define CRC32_INITIAL       0xFFFFFFFFul
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// a CRC-32 taken a piece at a time
+typedef struct
+{
+    U_INT32 nCRC;
+    U_INT32 nWord;      // bytes of a word not yet fed, the first lowest
+    U_BYTE nBytes;      // how many
+} CRC32_CONTEXT;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -39,6 +58,31 @@ extern "C" {
     ///@return
     void CRC_CalculateOnByte(U_INT32 *pCRC, U_BYTE nData);
 
+    ///@brief  CRC-16/CCITT of a block of bytes
+    ///@param  pData, nLength
+    ///@return the CRC
+    U_INT16 CRC16_Calculate(const U_BYTE *pData, U_INT16 nLength);
+
+    ///@brief  The CRC unit's CRC-32 of a block of words, in software
+    ///@param  pData32, nWords
+    ///@return the CRC, as CalculateCRC() gives
+    U_INT32 CRC32_Calculate(const U_INT32 *pData32, U_INT32 nWords);
+
+    ///@brief  Starts a CRC-32 taken a piece at a time
+    ///@param  pContext
+    ///@return
+    void CRC32_Start(CRC32_CONTEXT *pContext);
+
+    ///@brief  Adds a piece of any length
+    ///@param  pContext, pData, nLength
+    ///@return
+    void CRC32_Update(CRC32_CONTEXT *pContext, const U_BYTE *pData, U_INT32 nLength);
+
+    ///@brief  The CRC-32 of everything added so far
+    ///@param  pContext
+    ///@return the CRC
+    U_INT32 CRC32_Finish(const CRC32_CONTEXT *pContext);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,8 @@
 //      INCLUDES                                                              //
 //============================================================================//
 
+#include <stdint.h>
+
 //============================================================================//
 //      CONSTANTS                                                             //
 //============================================================================//
@@ -32,11 +34,11 @@ typedef char                CHAR;
 typedef unsigned char       BOOL;       //  8 bits, unsigned
 typedef signed char         BYTE;       //  8 bits, signed
 typedef signed short int    INT16;      // 16 bits, signed
-typedef signed long int     INT32;      // 32 bits, signed
+typedef int32_t             INT32;      // 32 bits, signed
 typedef long long           INT64;      // 64 bits, signed
 typedef unsigned char       U_BYTE;     //  8 bits, unsigned
 typedef unsigned short int  U_INT16;    // 16 bits, unsigned
-typedef unsigned long int   U_INT32;    // 32 bits, unsigned
+typedef uint32_t            U_INT32;    // 32 bits, unsigned
 typedef unsigned long long  U_INT64;    // 64 bits, unsigned
 typedef float               REAL32;     // 32 bits, floating point
 typedef double              REAL64;     // 64 bits, floating point
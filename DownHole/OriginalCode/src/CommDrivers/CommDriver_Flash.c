@@ -178,6 +178,7 @@ U_INT32 FLASH_ReadID(void)
 FLASH_PAGE_STATUS FLASH_ReadPage(U_BYTE *pData, U_INT32 nPageNumber)
 {
 	FLASH_PAGE_STATUS status;
+	BOOL bRead;
 	status.AsWord = PAGE_CORRUPT;
 	if(pData != NULL)
 	{
@@ -206,21 +207,18 @@ FLASH_PAGE_STATUS FLASH_ReadPage(U_BYTE *pData, U_INT32 nPageNumber)
 				(void)SPI_TransferByte(0x00);
 				m_nIndex++;
 			}
-			// Get the data
-			m_nIndex = 0;
-			while(m_nIndex < (FLASH_SLOT_DATA_SIZE * FLASH_SLOTS_PER_PAGE))
+			// Get the data and the CRC's by DMA
+			bRead = SPI_Transfer(NULL, m_pPageData, (FLASH_SLOT_DATA_SIZE * FLASH_SLOTS_PER_PAGE));
+			if(bRead)
 			{
-				*m_pPageData++ = SPI_TransferByte(0x00);
-				m_nIndex++;
+				bRead = SPI_Transfer(NULL, m_pPageCRC, (FLASH_SLOT_CRC_SIZE * FLASH_SLOTS_PER_PAGE));
 			}
-			// Get the CRC's
-			m_nIndex = 0;
-			while(m_nIndex < (FLASH_SLOT_CRC_SIZE * FLASH_SLOTS_PER_PAGE))
+			(void)SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+			// part of a page is stale, it is not to pass for good or empty
+			if(!bRead)
 			{
-				*m_pPageCRC++ = SPI_TransferByte(0x00);
-				m_nIndex++;
+				return status;
 			}
-			(void)SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
 			m_nIndex = 0;
 			while(m_nIndex < FLASH_SLOTS_PER_PAGE)
 			{
@@ -263,25 +261,11 @@ FLASH_PAGE_STATUS FLASH_ReadPage(U_BYTE *pData, U_INT32 nPageNumber)
 FLASH_PAGE_STATUS FLASH_WritePage(U_BYTE *pData, U_INT32 nPageNumber)
 {
 	FLASH_PAGE_STATUS status;
+	BOOL bSent = FALSE;
 	status.AsWord = PAGE_CORRUPT;
 	if((nPageNumber < MBIT16_LAST_PAGE) ||
 		((m_nDeviceSize == MBIT32_DEVICE) && (nPageNumber < MBIT32_LAST_PAGE)))
 	{
-		m_nAddress.AsWord = ERASE_PAGE_OPCODE;
-		m_nAddress.AsWord |= (nPageNumber << 10);
-		SPI_ResetTransferTimeOut();
-		// This is the FLASH PAGE ERASE
-		if(SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE))
-		{
-			m_nIndex = 4;
-			// Send the Address
-			while(m_nIndex != 0)
-			{
-				m_nIndex--;
-				(void)SPI_TransferByte(m_nAddress.AsBytes[m_nIndex]);
-			}
-			(void)SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
-		}
 		memcpy((void *)&m_nPageData[0][0], (const void *)pData,(FLASH_SLOT_DATA_SIZE * FLASH_SLOTS_PER_PAGE));
 		m_pPageData = &m_nPageData[0][0];
 		m_pPageCRC = (U_BYTE *)m_nPageCRC;
@@ -292,7 +276,9 @@ FLASH_PAGE_STATUS FLASH_WritePage(U_BYTE *pData, U_INT32 nPageNumber)
 			m_nIndex++;
 		}
 		m_nAddress.AsWord = WRITE_BUFFER_OPCODE;
-		// This is the transfer to the write buffer.
+		SPI_ResetTransferTimeOut();
+		// This is the transfer to the write buffer, done ahead of the erase
+		// so a transfer that does not finish leaves the page as it was
 		if(SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE))
 		{
 			m_nIndex = 4;
@@ -302,19 +288,29 @@ FLASH_PAGE_STATUS FLASH_WritePage(U_BYTE *pData, U_INT32 nPageNumber)
 				m_nIndex--;
 				(void)SPI_TransferByte(m_nAddress.AsBytes[m_nIndex]);
 			}
-			// Get the data
-			m_nIndex = 0;
-			while(m_nIndex < (FLASH_SLOT_DATA_SIZE * FLASH_SLOTS_PER_PAGE))
+			// Send the data and the CRC's by DMA
+			bSent = SPI_Transfer(m_pPageData, NULL, (FLASH_SLOT_DATA_SIZE * FLASH_SLOTS_PER_PAGE));
+			if(bSent)
 			{
-				(void)SPI_TransferByte(*m_pPageData++);
-				m_nIndex++;
+				bSent = SPI_Transfer(m_pPageCRC, NULL, (FLASH_SLOT_CRC_SIZE * FLASH_SLOTS_PER_PAGE));
 			}
-			// Get the CRC's
-			m_nIndex = 0;
-			while(m_nIndex < (FLASH_SLOT_CRC_SIZE * FLASH_SLOTS_PER_PAGE))
+			(void)SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+		}
+		if(!bSent)
+		{
+			return status;
+		}
+		m_nAddress.AsWord = ERASE_PAGE_OPCODE;
+		m_nAddress.AsWord |= (nPageNumber << 10);
+		// This is the FLASH PAGE ERASE
+		if(SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE))
+		{
+			m_nIndex = 4;
+			// Send the Address
+			while(m_nIndex != 0)
 			{
-				(void)SPI_TransferByte(*m_pPageCRC++);
-				m_nIndex++;
+				m_nIndex--;
+				(void)SPI_TransferByte(m_nAddress.AsBytes[m_nIndex]);
 			}
 			(void)SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
 		}
@@ -33,21 +33,14 @@
 #define INDEX_UART_DATA_LINK	0
 #define INDEX_UART_COMPASS		1
 #define NUM_UART_STREAMS		2
-#define BAUD_RATE_9600			9600
-#define BAUD_RATE_19200			19200
-#define BAUD_RATE_38400			38400
-#define BAUD_RATE_57600			57600
-#define BAUD_RATE_115200		115200
-
-// UART buffers are serviced from cycleHandler() every 10ms. At 19200 baud,
-// we could receive approximately 20 bytes per 10ms cycle. (20 is the absolute
-// minimum size of the RX_DMA buffer)
-//
-// The RX buffer is twice the size of the RX_DMA buffer because some UART
-// clients (i.e. RASP) are serviced on the alternate cycle (i.e. every 20ms)
-// and the RX_DMA buffer is transferred to the RX buffer every 10ms cycle.
-#define BUFFER_SIZE_RX_DMA  64
-#define BUFFER_SIZE_RX     128
+
+// Receive DMA runs circular into the RX_DMA buffer. The USART IDLE interrupt
+// and the DMA half and full transfer interrupts mark how far it has got, and
+// the clients read the data in place from the main loop. At 57600 baud, the
+// fastest the compass is set to, the buffer holds about 44ms of data, 67ms on
+// the 38400 baud data link and 267ms at 9600. A main loop pass slower than
+// that laps the reader, which is counted and the client's parser resynced.
+#define BUFFER_SIZE_RX_DMA  256
 
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
@@ -62,12 +55,17 @@ typedef struct
     U_INT32              nRxDMAChannel; // DMA receive channel
     U_INT32              nBaudRate;     // Transmission speed of this stream
     U_BYTE               nRxBufferDMA[BUFFER_SIZE_RX_DMA]; // DMA Receive Buffer
-    U_INT16              nRxHeadDMA;    // Leading index of DMA receive data
+    volatile U_INT16     nRxHeadDMA;    // Leading index of DMA receive data, set by the receive interrupts
     U_INT16              nRxTailDMA;    // Trailing index of DMA receive data
-    U_BYTE               nRxBuffer[BUFFER_SIZE_RX]; // Secondary Receive buffer
-    U_INT16              nRxHead;       // Leading index of secondary receive buffer
-    U_INT16              nRxTail;       // Trailing index of secondary receive buffer
-    U_BYTE               nTxBufferDMA[UART_BUFFER_SIZE_TX]; // Transmit buffer
+    volatile TIME_RT     tRxStamp;      // When the data up to nRxHeadDMA had arrived
+    volatile U_INT32     nRxWritten;    // Bytes the receive DMA has written, set by the receive interrupts
+    U_INT32              nRxRead;       // Bytes handed to the client or dropped
+    U_INT32              nRxOverruns;   // Times the receive DMA lapped the trailing index
+    U_BYTE               nTxQueue[UART_TX_QUEUE_SIZE]; // Transmit queue, DMA sends from it
+    volatile U_INT16     nTxHead;       // Leading index of the transmit queue, main loop only
+    volatile U_INT16     nTxTail;       // Trailing index of the transmit queue, DMA interrupt only
+    volatile U_INT16     nTxChunk;      // Bytes in the DMA transfer in progress, 0 when idle
+    UART_TX_STATS        TxStats;       // Transmit statistics
     UART_CLIENT          eClient;       // Peripheral client
     UART_CALLBACK_TX     pfCallbackTx;  // Callback function invoked when transmit is complete
 } UART_SELECT;
@@ -76,8 +74,14 @@ typedef struct
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
+static UART_SELECT* uARTx_Select(UART_CLIENT eClient);
 static void uARTx_Configure(UART_SELECT *pUARTx);
 static void uARTx_IRQHandler(UART_SELECT *pUARTx);
+static void uARTx_RxPublish(UART_SELECT *pUARTx);
+static void uARTx_RxDeliver(UART_SELECT *pUARTx, const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp);
+static void uARTx_RxResync(UART_SELECT *pUARTx);
+static void uARTx_StartTx(UART_SELECT *pUARTx);
+static void uARTx_TxComplete(UART_SELECT *pUARTx);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -164,14 +168,11 @@ void Initialize_UARTs(void)
 	pUARTx->nRxDMAChannel = DMA_Channel_4;
 	pUARTx->eClient = CLIENT_DATA_LINK;
 	pUARTx->pfCallbackTx = NULL;
-	pUARTx->nRxHeadDMA = 0;
-	pUARTx->nRxTailDMA = 0;
-	pUARTx->nRxHead = 0;
-	pUARTx->nRxTail = 0;
 	uARTx_Configure(pUARTx);
 //	NVIC_InitIrq(NVIC_UART1);
-	// Enable DMA2 Stream5 Channel 4 (USART1_RX)
-	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 12;
+	// Enable DMA2 Stream5 Channel 4 (USART1_RX), at the USART1 priority so
+	// neither interrupts the other while marking the received data
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 5;
 	NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream5_IRQn;
 	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
 	NVIC_Init(&NVIC_InitStructure);
@@ -197,29 +198,19 @@ void Initialize_UARTs(void)
 	// 3/2019 changed baud rate on second port for the compass
 	// to 115200 so that both port 1 and 2 were the same,
 	// so that calibration on either gives us the same update.
-#if COMPASS_MANUFACTURER == COMPASS_VECTORNAV
-	pUARTx->nBaudRate = BAUD_RATE_57600;
-#elif COMPASS_MANUFACTURER == COMPASS_APS544
+	// The compass module changes it with UART_SetBaudRate() while it looks
+	// for the compass that is fitted.
 	pUARTx->nBaudRate = BAUD_RATE_9600;
-#elif COMPASS_MANUFACTURER == COMPASS_TENFOOT
-	pUARTx->nBaudRate = BAUD_RATE_9600;
-#else
-	#error You must choose a COMPASS_MANUFACTURER
-#endif
 	pUARTx->pTxDMA = DMA1_Stream6;
 	pUARTx->nTxDMAChannel = DMA_Channel_4;
 	pUARTx->pRxDMA = DMA1_Stream5;
 	pUARTx->nRxDMAChannel = DMA_Channel_4;
 	pUARTx->eClient = CLIENT_COMPASS;
 	pUARTx->pfCallbackTx = NULL;
-	pUARTx->nRxHeadDMA = 0;
-	pUARTx->nRxTailDMA = 0;
-	pUARTx->nRxHead = 0;
-	pUARTx->nRxTail = 0;
 	uARTx_Configure(pUARTx);
 //	NVIC_InitIrq(NVIC_UART2);
-	// Enable DMA1 Stream1 Channel4 (USART1_RX)
-	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 12;
+	// Enable DMA1 Stream5 Channel4 (USART2_RX), at the USART2 priority
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 6;
 	NVIC_InitStructure.NVIC_IRQChannel = DMA1_Stream5_IRQn;
 	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
 	NVIC_Init(&NVIC_InitStructure);
@@ -240,96 +231,198 @@ void Initialize_UARTs(void)
 *******************************************************************************/
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 ; Function:
-;   UART_ServiceRxBufferDMA()
+;   UART_ServiceRxBuffer()
 ;
 ; Description:
-;   Services all clients that have received new data on their DMA RX channels
-;   since the last call to this function. The newly received data is
-;   transferred to the secondary receive buffer for the client.
+;   Hands each client the data its receive interrupts have marked since the
+;   last call, read in place from the DMA receive buffer, in at most two
+;   spans when the data wraps. The client should handle the newly received
+;   data, but should not initiate a transmission.
+;   When the DMA has written a whole buffer or more since the last call the
+;   unread data has been overwritten, so all of it is dropped, the overrun
+;   counted and the client's parser resynced.
 ;
 ; Reentrancy:
 ;   No
 ;
-; Assumptions:
-;   This function is called from cycleHandler() and the DMA interrupt. The
-;   DMA half transfer interrupt must be lower priority than cycleHandler().
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-void UART_ServiceRxBufferDMA(void)
+void UART_ServiceRxBuffer(void)
 {
 	U_BYTE i;
+	U_INT16 nHead, nCount;
+	U_INT32 nWritten;
+	TIME_RT tStamp;
 
 	for (i = 0; i < NUM_UART_STREAMS; i++)
 	{
-		m_UART[i].nRxHeadDMA = BUFFER_SIZE_RX_DMA - (U_INT16)m_UART[i].pRxDMA->NDTR;
-		while (m_UART[i].nRxHeadDMA != m_UART[i].nRxTailDMA)
+		// The stamp is read after the head, so it is never older than the data
+		__disable_irq();
+		nHead = m_UART[i].nRxHeadDMA;
+		nWritten = m_UART[i].nRxWritten;
+		__enable_irq();
+		tStamp = m_UART[i].tRxStamp;
+		if ((nWritten - m_UART[i].nRxRead) >= BUFFER_SIZE_RX_DMA)
 		{
-			m_UART[i].nRxBuffer[m_UART[i].nRxHead++] = m_UART[i].nRxBufferDMA[m_UART[i].nRxTailDMA++];
-			if (m_UART[i].nRxTailDMA >= BUFFER_SIZE_RX_DMA)
+			m_UART[i].nRxOverruns++;
+			m_UART[i].nRxTailDMA = nHead;
+			m_UART[i].nRxRead = nWritten;
+			uARTx_RxResync(&m_UART[i]);
+			continue;
+		}
+		m_UART[i].nRxRead = nWritten;
+		while (m_UART[i].nRxTailDMA != nHead)
+		{
+			if (nHead > m_UART[i].nRxTailDMA)
 			{
-				m_UART[i].nRxTailDMA = 0;
+				nCount = nHead - m_UART[i].nRxTailDMA;
 			}
-			if (m_UART[i].nRxHead >= BUFFER_SIZE_RX)
+			else
 			{
-				m_UART[i].nRxHead = 0;
+				nCount = BUFFER_SIZE_RX_DMA - m_UART[i].nRxTailDMA;
+			}
+			uARTx_RxDeliver(&m_UART[i], &m_UART[i].nRxBufferDMA[m_UART[i].nRxTailDMA], nCount, tStamp);
+			m_UART[i].nRxTailDMA += nCount;
+			// Wrap the tail
+			if (m_UART[i].nRxTailDMA >= BUFFER_SIZE_RX_DMA)
+			{
+				m_UART[i].nRxTailDMA = 0;
 			}
 		}
 	}
-} // End UART_ServiceRxBufferDMA()
+} // End UART_ServiceRxBuffer()
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 ; Function:
-;   UART_ServiceRxBuffer()
+;   UART_IsRxPending()
 ;
 ; Description:
-;   Services all clients that have received new data on their seconday receive
-;   buffer and then calls the service receive function for the client in
-;   which the client should handle any newly received data, but should not
-;   initiate a transmission.
+;   Returns TRUE when the receive interrupts have marked data that
+;   UART_ServiceRxBuffer() has not handed to its client yet.
 ;
 ; Reentrancy:
-;   No
+;   Yes
 ;
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-void UART_ServiceRxBuffer(void)
+BOOL UART_IsRxPending(void)
 {
-	U_BYTE i, nRxChar;
+	U_BYTE i;
 
 	for (i = 0; i < NUM_UART_STREAMS; i++)
 	{
-		while(m_UART[i].nRxHead != m_UART[i].nRxTail)
+		if (m_UART[i].nRxTailDMA != m_UART[i].nRxHeadDMA)
 		{
-			nRxChar = m_UART[i].nRxBuffer[m_UART[i].nRxTail++];
-			// Wrap the tail
-			if (m_UART[i].nRxTail >= BUFFER_SIZE_RX)
-			{
-				m_UART[i].nRxTail = 0;
-			}
-			switch (m_UART[i].eClient)
+			return TRUE;
+		}
+	}
+	return FALSE;
+} // End UART_IsRxPending()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxDeliver()
+;
+; Description:
+;   Passes a span of received data to the client of the UART.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => pointer to the UART select structure
+;   U_BYTE *pData => the received data, in the DMA receive buffer
+;   U_INT16 nLength => number of bytes
+;   TIME_RT tStamp => when the last of them had arrived
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_RxDeliver(UART_SELECT *pUARTx, const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp)
+{
+	switch (pUARTx->eClient)
+	{
+		case CLIENT_DATA_LINK:
+			if(GetModemIsPresent())
 			{
-				case CLIENT_DATA_LINK:
-					if(GetModemIsPresent())
-					{
-						// the new way handles the whole message
-						ModemData_ReceiveData(nRxChar);
-//						ModemData_ReceiveRxData(nRxChar);
-					}
-//					else
-//					{
-//						ServiceRxRASP(nRxChar);
-//					}
-					break;
-				case CLIENT_COMPASS:
-					Compass_ServiceRxData(nRxChar);
-					break;
-				default:
-					break;
+				// the new way handles the whole message
+				ModemData_ReceiveData(pData, nLength, tStamp);
 			}
-		}
+			break;
+		case CLIENT_COMPASS:
+			Compass_ServiceRxData(pData, nLength, tStamp);
+			break;
+		default:
+			break;
 	}
-} // End UART_ServiceRxBuffer()
+} // End uARTx_RxDeliver()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxResync()
+;
+; Description:
+;   Tells the client of the UART that received data was lost, so a frame it
+;   has part way is dropped and it waits for the start of the next one.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => pointer to the UART select structure
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_RxResync(UART_SELECT *pUARTx)
+{
+	switch (pUARTx->eClient)
+	{
+		case CLIENT_DATA_LINK:
+			ModemData_ResyncRx();
+			break;
+		case CLIENT_COMPASS:
+			Compass_ResyncRx();
+			break;
+		default:
+			break;
+	}
+} // End uARTx_RxResync()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxPublish()
+;
+; Description:
+;   Marks how far the receive DMA has written and when, called from the
+;   USART IDLE interrupt at the end of each burst and from the DMA half and
+;   full transfer interrupts during a long one.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => pointer to the UART select structure
+;
+; Reentrancy:
+;   No, the USART and its receive DMA interrupt have the same priority.
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_RxPublish(UART_SELECT *pUARTx)
+{
+	U_INT16 nHead;
+
+	nHead = BUFFER_SIZE_RX_DMA - (U_INT16)pUARTx->pRxDMA->NDTR;
+	if (nHead >= BUFFER_SIZE_RX_DMA)
+	{
+		nHead = 0;
+	}
+	// The half and full transfer interrupts come every half buffer, so the
+	// head never moves a whole buffer between two calls
+	pUARTx->nRxWritten += (U_INT16)(nHead + BUFFER_SIZE_RX_DMA - pUARTx->nRxHeadDMA) % BUFFER_SIZE_RX_DMA;
+	pUARTx->tRxStamp = ElapsedTimeLowRes(0);
+	pUARTx->nRxHeadDMA = nHead;
+} // End uARTx_RxPublish()
 
 /*******************************************************************************
 *       @details
@@ -381,36 +474,221 @@ void UART_ServiceRxBuffer(void)
 ;   UART_SendMessage()
 ;
 ; Description:
-;   Places a copy of the data to be sent into the client's transfer buffer
-;   then intiates a DMA transfer of the data.
+;   Places a copy of the data to be sent at the end of the client's transmit
+;   queue, and starts a DMA transfer if the queue was idle.  Messages already
+;   queued go out first, the DMA transfer complete interrupt starts each
+;   following piece of the queue.
 ;
 ; Parameters:
 ;   UART_CLIENT eClient => client to transfer the data to
 ;   U_BYTE *pData => pointer to the data to be transferred
 ;   U_INT16 nDataLen => number of bytes to be transferred
-;   UART_CALLBACK_TX pfCallbackTx => pointer to the function to be called
-;                                    when the transfer is complete
-;   BOOL bFinal => flag to indicate that this is the final transfer (i.e. if
-;                  a transfer is too large to perform with one call to this
-;                  function, set the flag to false until the final portion of
-;                  the message is being sent, then pass a true value)
+;
+; Returns:
+;   TRUE if the message was queued, FALSE if the queue has no room for all
+;   of it, in which case none of it is sent.
 ;
 ; Reentrancy:
 ;   No
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-void UART_SendMessage(
+BOOL UART_SendMessage(
 	UART_CLIENT eClient,
 	const U_BYTE *pData,
 	U_INT16 nDataLen)
 {
 	UART_SELECT *pUARTx;
+	U_INT16 nHead, nFirst, nDepth;
+
+	pUARTx = uARTx_Select(eClient);
+	if ((pData == NULL) || (pUARTx == NULL))
+	{
+		return FALSE;
+	}
+	if (nDataLen > UART_GetTxFree(eClient))
+	{
+		pUARTx->TxStats.nStalls++;
+		return FALSE;
+	}
+	// Copy the data into the queue, in two pieces if it wraps
+	nHead = pUARTx->nTxHead;
+	nFirst = UART_TX_QUEUE_SIZE - nHead;
+	if (nFirst > nDataLen)
+	{
+		nFirst = nDataLen;
+	}
+	(void)memcpy(&pUARTx->nTxQueue[nHead], pData, nFirst);
+	(void)memcpy(pUARTx->nTxQueue, &pData[nFirst], nDataLen - nFirst);
+	nHead += nDataLen;
+	if (nHead >= UART_TX_QUEUE_SIZE)
+	{
+		nHead -= UART_TX_QUEUE_SIZE;
+	}
+	// The head must move before the DMA state is looked at, a transfer that
+	// completes in between then sees the new data and carries on with it
+	pUARTx->nTxHead = nHead;
+	pUARTx->TxStats.nMessages++;
+	pUARTx->TxStats.nBytes += nDataLen;
+	nDepth = (UART_TX_QUEUE_SIZE - 1) - UART_GetTxFree(eClient);
+	if (nDepth > pUARTx->TxStats.nMaxDepth)
+	{
+		pUARTx->TxStats.nMaxDepth = nDepth;
+	}
+	if (pUARTx->nTxChunk == 0)
+	{
+		uARTx_StartTx(pUARTx);
+	}
+	return TRUE;
+} // End UART_SendMessage()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_GetTxFree()
+;
+; Description:
+;   Returns the number of bytes that can be queued to the client's UART now,
+;   so a client can hold a message back rather than have it refused.
+;
+; Parameters:
+;   UART_CLIENT eClient => the client whose UART is asked about
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT16 UART_GetTxFree(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
+	U_INT16 nHead, nTail;
 
-	if (pData == NULL)
+	pUARTx = uARTx_Select(eClient);
+	if (pUARTx == NULL)
+	{
+		return 0;
+	}
+	nHead = pUARTx->nTxHead;
+	nTail = pUARTx->nTxTail;
+	// One byte is left unused so a full queue is not mistaken for empty
+	if (nHead >= nTail)
 	{
+		return (UART_TX_QUEUE_SIZE - 1) - (nHead - nTail);
+	}
+	return (nTail - nHead) - 1;
+} // End UART_GetTxFree()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_GetTxStats()
+;
+; Description:
+;   Copies the transmit statistics of the client's UART, with the number of
+;   bytes waiting in the queue now.
+;
+; Parameters:
+;   UART_CLIENT eClient => the client whose UART is asked about
+;   UART_TX_STATS *pStats => where the statistics are copied to
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void UART_GetTxStats(UART_CLIENT eClient, UART_TX_STATS *pStats)
+{
+	UART_SELECT *pUARTx;
+
+	pUARTx = uARTx_Select(eClient);
+	if (pUARTx == NULL)
+	{
+		(void)memset(pStats, 0, sizeof(UART_TX_STATS));
 		return;
 	}
+	*pStats = pUARTx->TxStats;
+	pStats->nDepth = (UART_TX_QUEUE_SIZE - 1) - UART_GetTxFree(eClient);
+} // End UART_GetTxStats()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_GetRxOverruns()
+;
+; Description:
+;   Returns the number of times the receive DMA of the client's UART wrote
+;   over data that had not been read yet.
+;
+; Parameters:
+;   UART_CLIENT eClient => the client whose UART is asked about
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT32 UART_GetRxOverruns(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
+
+	pUARTx = uARTx_Select(eClient);
+	if (pUARTx == NULL)
+	{
+		return 0;
+	}
+	return pUARTx->nRxOverruns;
+} // End UART_GetRxOverruns()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_SetBaudRate()
+;
+; Description:
+;   Changes the transmission speed of the UART used by a client.  The UART
+;   and its DMA channels are configured again, so any data still in the
+;   receive DMA buffer is dropped.  Nothing is done if the speed is the
+;   one already in use.
+;
+; Parameters:
+;   UART_CLIENT eClient => the client whose UART is changed
+;   U_INT32 nBaudRate   => the new speed, one of the BAUD_RATE_xxx values
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void UART_SetBaudRate(UART_CLIENT eClient, U_INT32 nBaudRate)
+{
+	UART_SELECT *pUARTx;
+
+	pUARTx = uARTx_Select(eClient);
+	if ((pUARTx == NULL) || (pUARTx->nBaudRate == nBaudRate))
+	{
+		return;
+	}
+	pUARTx->nBaudRate = nBaudRate;
+	uARTx_Configure(pUARTx);
+} // End UART_SetBaudRate()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_Select()
+;
+; Description:
+;   Given a client, returns the pointer to the client's UART_SELECT
+;   structure, or NULL if no UART is configured for that client.
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static UART_SELECT* uARTx_Select(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
 
-	// Given a client, get the pointer to the client's UART_SELECT structure
 	switch (eClient)
 	{
 		case CLIENT_DATA_LINK:
@@ -420,32 +698,82 @@ void UART_SendMessage(
 			pUARTx = &m_UART[INDEX_UART_COMPASS];
 			break;
 		default:
-			pUARTx = NULL;
-			break;
+			return NULL;
 	}
-	// Verify the pointer to the UART_SELECT structure is valid
-	if (pUARTx != NULL)
+	// Verify the client configured in the UART_SELECT structure matches
+	return (eClient == pUARTx->eClient) ? pUARTx : NULL;
+} // End uARTx_Select()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_StartTx()
+;
+; Description:
+;   Starts a DMA transfer of the queued bytes up to the end of the queue
+;   buffer, the part that wraps to the start goes in the next transfer.
+;   Stops transmit DMA requests when the queue is empty.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => pointer to the UART select structure
+;
+; Reentrancy:
+;   No, called from the main loop only while the DMA stream is idle, and
+;   otherwise from the DMA transfer complete interrupt.
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_StartTx(UART_SELECT *pUARTx)
+{
+	U_INT16 nHead = pUARTx->nTxHead;
+	U_INT16 nTail = pUARTx->nTxTail;
+
+	if (nHead == nTail)
 	{
-		// Verify the client configured in the UART_SELECT structure matches
-		// the client that is requesting the transfer
-		if (eClient == pUARTx->eClient)
-		{
-			if (nDataLen > UART_BUFFER_SIZE_TX)
-			{
-				nDataLen = UART_BUFFER_SIZE_TX;
-			}
-			// Create a persistent copy of the data to be transferred
-			(void)memcpy(pUARTx->nTxBufferDMA, pData, nDataLen);
-			// Set the pointer to the data to be transmitted and the length of
-			// the data in the DMA registers before enabling DMA and starting
-			// the transfer
-			pUARTx->pTxDMA->M0AR = (U_INT32)(pUARTx->nTxBufferDMA);
-			pUARTx->pTxDMA->NDTR = nDataLen;
-			USART_DMACmd(pUARTx->pUART, USART_DMAReq_Tx, ENABLE);
-			DMA_Cmd(pUARTx->pTxDMA, ENABLE);
-		}
+		pUARTx->nTxChunk = 0;
+		USART_DMACmd(pUARTx->pUART, USART_DMAReq_Tx, DISABLE);
+		return;
 	}
-} // End UART_SendMessage()
+	pUARTx->nTxChunk = (nHead > nTail) ? (nHead - nTail) : (UART_TX_QUEUE_SIZE - nTail);
+	// Set the pointer to the data to be transmitted and the length of
+	// the data in the DMA registers before enabling DMA and starting
+	// the transfer
+	pUARTx->pTxDMA->M0AR = (U_INT32)(&pUARTx->nTxQueue[nTail]);
+	pUARTx->pTxDMA->NDTR = pUARTx->nTxChunk;
+	USART_DMACmd(pUARTx->pUART, USART_DMAReq_Tx, ENABLE);
+	DMA_Cmd(pUARTx->pTxDMA, ENABLE);
+} // End uARTx_StartTx()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_TxComplete()
+;
+; Description:
+;   Called from the DMA transfer complete interrupt, frees the bytes just
+;   sent and starts on whatever was queued behind them.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => pointer to the UART select structure
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_TxComplete(UART_SELECT *pUARTx)
+{
+	U_INT16 nTail;
+
+	DMA_Cmd(pUARTx->pTxDMA, DISABLE);
+	nTail = pUARTx->nTxTail + pUARTx->nTxChunk;
+	if (nTail >= UART_TX_QUEUE_SIZE)
+	{
+		nTail -= UART_TX_QUEUE_SIZE;
+	}
+	pUARTx->nTxTail = nTail;
+	uARTx_StartTx(pUARTx);
+} // End uARTx_TxComplete()
 
 /*******************************************************************************
 *       @details
@@ -490,15 +818,22 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
 	DMA_InitStructure.DMA_Channel = (U_INT32)(pUARTx->nRxDMAChannel);
 	DMA_Init(pUARTx->pRxDMA, &DMA_InitStructure);
-	DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TE), ENABLE);
+	DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TC | DMA_IT_TE), ENABLE);
 	// Reconfiguring the DMA will reset the leading receive buffer index
-	// and the trailing index must be reset manually to keep them synchronized
+	// and the marked and trailing indexes must be reset to keep them synchronized
+	pUARTx->nRxHeadDMA = 0;
 	pUARTx->nRxTailDMA = 0;
-	// DMA configuration for UARTx_TX (transmitting)
+	pUARTx->nRxWritten = 0;
+	pUARTx->nRxRead = 0;
+	// DMA configuration for UARTx_TX (transmitting), anything still queued
+	// is dropped, it was meant for the old settings
 	DMA_DeInit(pUARTx->pTxDMA);
-	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)(pUARTx->nTxBufferDMA);
+	pUARTx->nTxHead = 0;
+	pUARTx->nTxTail = 0;
+	pUARTx->nTxChunk = 0;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)(pUARTx->nTxQueue);
 	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
-	DMA_InitStructure.DMA_BufferSize = UART_BUFFER_SIZE_TX;
+	DMA_InitStructure.DMA_BufferSize = UART_TX_QUEUE_SIZE;
 	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
 	DMA_InitStructure.DMA_Channel = (U_INT32)(pUARTx->nTxDMAChannel);
 	DMA_Init(pUARTx->pTxDMA, &DMA_InitStructure);
@@ -528,6 +863,8 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 	// transfer complete interrupt (bitwise OR of the two interrupts sets
 	// incorrect bits in control register)
 	USART_ITConfig(pUARTx->pUART, USART_IT_ERR, ENABLE);
+	// The line going idle marks the end of each burst of received data
+	USART_ITConfig(pUARTx->pUART, USART_IT_IDLE, ENABLE);
 	// Enable the peripheral
 	USART_Cmd(pUARTx->pUART, ENABLE);
 	// Enable DMA for receiving data
@@ -555,16 +892,20 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 static void uARTx_IRQHandler(UART_SELECT *pUARTx)
 {
-	// Handle UART errors, the following errors are cleared by a software
-	// sequence of a read of the status register followed by a read of the data
-	// register (FE - framing error, NE - noise error, ORE - overrun error)
-	if ((pUARTx->pUART->SR & USART_FLAG_FE) || \
-		(pUARTx->pUART->SR & USART_FLAG_NE) || \
-		(pUARTx->pUART->SR & USART_FLAG_ORE))
-	{
-		(void)pUARTx->pUART->SR;
+	U_INT16 nStatus = pUARTx->pUART->SR;
+
+	// Handle UART errors and the idle line, the following are cleared by a
+	// software sequence of a read of the status register followed by a read
+	// of the data register (FE - framing error, NE - noise error, ORE -
+	// overrun error, IDLE - idle line)
+	if (nStatus & (USART_FLAG_FE | USART_FLAG_NE | USART_FLAG_ORE | USART_FLAG_IDLE))
+	{
 		(void)pUARTx->pUART->DR;
 	}
+	if (nStatus & USART_FLAG_IDLE)
+	{
+		uARTx_RxPublish(pUARTx);
+	}
 	if (pUARTx->pUART->SR & USART_FLAG_TC)
 	{
 		// Transfer complete
@@ -619,7 +960,9 @@ void DMA2_Stream7_IRQHandler(void)
 {
 	if (DMA_GetITStatus(DMA2_Stream7, DMA_IT_TEIF7))
 	{
-		DMA_ClearITPendingBit(DMA2_Stream7, DMA_IT_TEIF7);
+		// The stream stops on an error, drop the piece so the queue carries on
+		DMA_ClearITPendingBit(DMA2_Stream7, DMA_IT_TEIF7 | DMA_IT_TCIF7);
+		uARTx_TxComplete(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 	if (DMA_GetITStatus(DMA2_Stream7, DMA_IT_FEIF7))
 	{
@@ -631,10 +974,9 @@ void DMA2_Stream7_IRQHandler(void)
 	}
 	if (DMA_GetITStatus(DMA2_Stream7, DMA_IT_TCIF7))
 	{
-		// Transmit complete, disable DMA until next transmit request
+		// Transmit complete, send the rest of the queue if there is any
 		DMA_ClearITPendingBit(DMA2_Stream7, DMA_IT_TCIF7);
-		DMA_Cmd(DMA2_Stream7, DISABLE);
-		USART_DMACmd(USART1, USART_DMAReq_Tx, DISABLE);
+		uARTx_TxComplete(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 } // End DMA2_Channel7_IRQHandler()
 
@@ -664,10 +1006,12 @@ void DMA2_Stream5_IRQHandler(void)
 	if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_HTIF5))
 	{
 		DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_HTIF5);
+		uARTx_RxPublish(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 	if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_TCIF5))
 	{
 		DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_TCIF5);
+		uARTx_RxPublish(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 } // End DMA2_Channel5_IRQHandler()
 
@@ -713,7 +1057,9 @@ void DMA1_Stream6_IRQHandler(void)
 {
 	if (DMA_GetITStatus(DMA1_Stream6, DMA_IT_TEIF6))
 	{
-		DMA_ClearITPendingBit(DMA1_Stream6, DMA_IT_TEIF6);
+		// The stream stops on an error, drop the piece so the queue carries on
+		DMA_ClearITPendingBit(DMA1_Stream6, DMA_IT_TEIF6 | DMA_IT_TCIF6);
+		uARTx_TxComplete(&m_UART[INDEX_UART_COMPASS]);
 	}
 	if (DMA_GetITStatus(DMA1_Stream6, DMA_IT_FEIF6))
 	{
@@ -725,10 +1071,9 @@ void DMA1_Stream6_IRQHandler(void)
 	}
 	if (DMA_GetITStatus(DMA1_Stream6, DMA_IT_TCIF6))
 	{
-		// Transmit complete, disable DMA until next transmit request
+		// Transmit complete, send the rest of the queue if there is any
 		DMA_ClearITPendingBit(DMA1_Stream6, DMA_IT_TCIF6);
-		DMA_Cmd(DMA1_Stream6, DISABLE);
-		USART_DMACmd(USART2, USART_DMAReq_Tx, DISABLE);
+		uARTx_TxComplete(&m_UART[INDEX_UART_COMPASS]);
 	}
 }// End DMA1_Stream6_IRQHandler()
 
@@ -758,9 +1103,11 @@ void DMA1_Stream5_IRQHandler(void)
 	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_HTIF5))
 	{
 		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_HTIF5);
+		uARTx_RxPublish(&m_UART[INDEX_UART_COMPASS]);
 	}
 	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_TCIF5))
 	{
 		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TCIF5);
+		uARTx_RxPublish(&m_UART[INDEX_UART_COMPASS]);
 	}
 } // End DMA1_Channel5_IRQHandler()
@@ -12,6 +12,7 @@
 //============================================================================//
 
 #include <stm32f4xx.h>
+#include <string.h>
 #include "main.h"
 #include "adc.h"
 #include "board.h"
@@ -20,21 +21,50 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
+// TIM2 triggers a conversion of both channels this many times a second
+#define ADC_SAMPLE_RATE			1000
+// TIM2 counts at this rate, so the period is exact
+#define ADC_TIMER_RATE			1000000ul
+// samples summed by each half of the DMA buffer, the first filter stage,
+// which also brings the rate down to one sum each 32mS
+#define ADC_BLOCK_LENGTH		32
+#define ADC_BUFFER_LENGTH		(2 * ADC_BLOCK_LENGTH)
+// block sums in the moving average, the second stage, 256mS of samples
+#define ADC_AVERAGE_BLOCKS		8
+// blocks left out of the minimum and maximum while the inputs settle, 1S
+#define ADC_SETTLE_BLOCKS		32
+
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
-__IO uint16_t ADC3ConvertedValue[8] = {0};
-__IO uint16_t ADC1ConvertedValue[8] = {0};
-U_INT16 BatteryInputVoltageu16 = 0;
-BOOL BatteryInputVoltageIsValid = FALSE;
-U_INT16 PeakDetectInputu16 = 0;
-BOOL PeakDetectInputIsValid = FALSE;
+// filter of one channel, fed from the DMA interrupt
+typedef struct
+{
+	U_INT32 nBlockSums[ADC_AVERAGE_BLOCKS];
+	U_INT32 nTotal;			// of nBlockSums
+	U_BYTE nNext;			// oldest block sum, replaced next
+	U_BYTE nBlocks;			// block sums in the total, up to ADC_AVERAGE_BLOCKS
+	U_BYTE nSettle;			// blocks to go before the minimum and maximum
+	U_INT16 nFiltered;		// counts
+	U_INT16 nMinimum;		// counts, of a single block
+	U_INT16 nMaximum;
+} ADC_FILTER;
+
+static __IO uint16_t ADC3ConvertedValue[ADC_BUFFER_LENGTH];
+static __IO uint16_t ADC1ConvertedValue[ADC_BUFFER_LENGTH];
+static ADC_FILTER m_BatteryFilter;
+static ADC_FILTER m_PeakDetectFilter;
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
+static void ADC_ResetFilter(ADC_FILTER *pFilter);
+static void ADC_FilterBlock(ADC_FILTER *pFilter, __IO uint16_t *pSamples);
+static U_INT16 ADC_BatteryMilliVolts(U_INT16 nCounts);
+static U_INT16 ADC_PeakDetectMilliVolts(U_INT16 nCounts);
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -82,23 +112,46 @@ void ADC_SetMeasurementDividerPower(BOOL onoff)
 
 /*******************************************************************************
 *       @details
+*   TIM2 update triggers ADC3 (battery) and ADC1 (peak detect) together, and
+*   each fills its own circular DMA buffer.  The DMA interrupts at each half
+*   hand the finished half to the filter, nothing else runs per sample.
 *******************************************************************************/
 void ADC_Initialize(void)
 {
-	NVIC_InitTypeDef NVIC_InitStructure;
     #define ADC_DATA_REGISTER_OFFSET 0x4C
 
+    NVIC_InitTypeDef NVIC_InitStructure;
     ADC_InitTypeDef       ADC_InitStructure;
     ADC_CommonInitTypeDef ADC_CommonInitStructure;
     DMA_InitTypeDef       DMA_InitStructure;
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    RCC_ClocksTypeDef RCC_Clocks;
+    U_INT32 nTimerClock;
 
-    // DMA 2 Stream 0 channel 2 configuration
+    ADC_ResetFilter(&m_BatteryFilter);
+    ADC_ResetFilter(&m_PeakDetectFilter);
+
+    // TIM2 counts at ADC_TIMER_RATE, APB1 timers run at twice PCLK1 when
+    // APB1 is divided down
+    RCC_GetClocksFreq(&RCC_Clocks);
+    nTimerClock = RCC_Clocks.PCLK1_Frequency;
+    if(RCC_Clocks.PCLK1_Frequency != RCC_Clocks.HCLK_Frequency)
+        nTimerClock *= 2;
+    TIM_DeInit(TIM2);
+    TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+    TIM_TimeBaseStructure.TIM_Prescaler = (U_INT16)((nTimerClock / ADC_TIMER_RATE) - 1);
+    TIM_TimeBaseStructure.TIM_Period = (ADC_TIMER_RATE / ADC_SAMPLE_RATE) - 1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseInit(TIM2, &TIM_TimeBaseStructure);
+    TIM_SelectOutputTrigger(TIM2, TIM_TRGOSource_Update);
+
+    // DMA 2 Stream 0 channel 2 configuration, ADC3
     DMA_StructInit(&DMA_InitStructure);
     DMA_InitStructure.DMA_Channel = DMA_Channel_2;
     DMA_InitStructure.DMA_PeripheralBaseAddr = (U_INT32)ADC3 + ADC_DATA_REGISTER_OFFSET;
     DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)&ADC3ConvertedValue[0];
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
-    DMA_InitStructure.DMA_BufferSize = 8;
+    DMA_InitStructure.DMA_BufferSize = ADC_BUFFER_LENGTH;
     DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
     DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
@@ -111,31 +164,16 @@ void ADC_Initialize(void)
     DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
     DMA_DeInit(DMA2_Stream0);
     DMA_Init(DMA2_Stream0, &DMA_InitStructure);
-    DMA_ITConfig(DMA2_Stream0, DMA_IT_TC, ENABLE);
-    DMA_Cmd(DMA2_Stream0, ENABLE);
-#if 0
-    // DMA 2 Stream 0 channel 0 configuration
-    DMA_StructInit(&DMA_InitStructure);
+    DMA_ITConfig(DMA2_Stream0, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+    // DMA 2 Stream 4 channel 0 configuration, ADC1
     DMA_InitStructure.DMA_Channel = DMA_Channel_0;
     DMA_InitStructure.DMA_PeripheralBaseAddr = (U_INT32)ADC1 + ADC_DATA_REGISTER_OFFSET;
     DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)&ADC1ConvertedValue[0];
-    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
-    DMA_InitStructure.DMA_BufferSize = 8;
-    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
-    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
-    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
-    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
-    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
-    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
-    DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
-    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
-    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
     DMA_DeInit(DMA2_Stream4);
     DMA_Init(DMA2_Stream4, &DMA_InitStructure);
-    DMA_ITConfig(DMA2_Stream4, DMA_IT_TC, ENABLE);
-    DMA_Cmd(DMA2_Stream4, ENABLE);
-#endif
+    DMA_ITConfig(DMA2_Stream4, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
     // ADC Common Init
     ADC_CommonInitStructure.ADC_Mode = ADC_Mode_Independent;
     ADC_CommonInitStructure.ADC_Prescaler = ADC_Prescaler_Div2;
@@ -143,59 +181,62 @@ void ADC_Initialize(void)
     ADC_CommonInitStructure.ADC_TwoSamplingDelay = ADC_TwoSamplingDelay_5Cycles;
     ADC_CommonInit(&ADC_CommonInitStructure);
 
-    // ADC3 Init
+    // ADC3 Init, one conversion each TIM2 update
     ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
     ADC_InitStructure.ADC_ScanConvMode = DISABLE;
-    ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
-    ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
+    ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
+    ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+    ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T2_TRGO;
     ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
     ADC_InitStructure.ADC_NbrOfConversion = 1;
     ADC_Init(ADC3, &ADC_InitStructure);
-    // Enable ADC3 interrupt
-    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 7;
-    NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream0_IRQn;
-    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-    NVIC_Init(&NVIC_InitStructure);
     // ADC3 regular channel configuration
     ADC_RegularChannelConfig(ADC3, ADC_Channel_10, 1, ADC_SampleTime_15Cycles);
 
-	// ADC1 Init
-    ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
-    ADC_InitStructure.ADC_ScanConvMode = DISABLE;
-    ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
-    ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
-    ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
-    ADC_InitStructure.ADC_NbrOfConversion = 1;
+    // ADC1 Init, the same
     ADC_Init(ADC1, &ADC_InitStructure);
-    // Enable ADC1 interrupt
-//    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 7;
-//    NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream0_IRQn;
-//    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-//    NVIC_Init(&NVIC_InitStructure);
     // ADC1 regular channel configuration
     ADC_RegularChannelConfig(ADC1, ADC_Channel_11, 1, ADC_SampleTime_15Cycles);
+
+    // Enable the DMA interrupts
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 7;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream0_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream4_IRQn;
+    NVIC_Init(&NVIC_InitStructure);
 }
 
 /*******************************************************************************
 *       @details
+*   Starts the sampling, once the battery divider is powered.  The filters
+*   start over.
 *******************************************************************************/
 void ADC_Start(void)
 {
-    // Enable DMA request after last transfer (Single-ADC mode)
+    ADC_ResetFilter(&m_BatteryFilter);
+    ADC_ResetFilter(&m_PeakDetectFilter);
+    DMA_Cmd(DMA2_Stream0, ENABLE);
+    DMA_Cmd(DMA2_Stream4, ENABLE);
+
+    // Keep the DMA requests going after each buffer (Single-ADC mode)
     ADC_DMARequestAfterLastTransferCmd(ADC3, ENABLE);
     // Enable ADC3 DMA
     ADC_DMACmd(ADC3, ENABLE);
     // Enable ADC3
     ADC_Cmd(ADC3, ENABLE);
-    ADC_SoftwareStartConv(ADC3);
 
-    // Enable DMA request after last transfer (Single-ADC mode)
+    // Keep the DMA requests going after each buffer (Single-ADC mode)
     ADC_DMARequestAfterLastTransferCmd(ADC1, ENABLE);
     // Enable ADC1 DMA
     ADC_DMACmd(ADC1, ENABLE);
     // Enable ADC1
     ADC_Cmd(ADC1, ENABLE);
-    ADC_SoftwareStartConv(ADC1);
+
+    // the conversions start on the next update
+    TIM_SetCounter(TIM2, 0);
+    TIM_Cmd(TIM2, ENABLE);
 }
 
 /*******************************************************************************
@@ -203,6 +244,8 @@ void ADC_Start(void)
 *******************************************************************************/
 void ADC_Disable(void)
 {
+    TIM_Cmd(TIM2, DISABLE);
+
     /* Disable ADC3 DMA */
     ADC_DMACmd(ADC3, DISABLE);
     /* Disable ADC3 */
@@ -212,6 +255,61 @@ void ADC_Disable(void)
     ADC_DMACmd(ADC1, DISABLE);
     /* Disable ADC1 */
     ADC_Cmd(ADC1, DISABLE);
+
+    DMA_Cmd(DMA2_Stream0, DISABLE);
+    DMA_Cmd(DMA2_Stream4, DISABLE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void ADC_ResetFilter(ADC_FILTER *pFilter)
+{
+    memset(pFilter, 0, sizeof(ADC_FILTER));
+    pFilter->nSettle = ADC_SETTLE_BLOCKS;
+    pFilter->nMinimum = 0xFFFF;
+}
+
+/*******************************************************************************
+*       @details
+*   The block sum is a first order CIC decimating by ADC_BLOCK_LENGTH, the
+*   moving average of the block sums is the second stage.  The minimum and
+*   maximum are of single blocks, 32mS, short enough to see the battery sag
+*   while the modem transmits.
+*******************************************************************************/
+static void ADC_FilterBlock(ADC_FILTER *pFilter, __IO uint16_t *pSamples)
+{
+    U_INT32 nSum = 0;
+    U_INT16 nBlock;
+    U_BYTE loopy;
+
+    for(loopy = 0; loopy < ADC_BLOCK_LENGTH; loopy++)
+    {
+        nSum += pSamples[loopy];
+    }
+    pFilter->nTotal -= pFilter->nBlockSums[pFilter->nNext];
+    pFilter->nBlockSums[pFilter->nNext] = nSum;
+    pFilter->nTotal += nSum;
+    pFilter->nNext = (pFilter->nNext + 1) % ADC_AVERAGE_BLOCKS;
+    if(pFilter->nBlocks < ADC_AVERAGE_BLOCKS)
+    {
+        pFilter->nBlocks++;
+    }
+    pFilter->nFiltered = (U_INT16)(pFilter->nTotal / ((U_INT32)pFilter->nBlocks * ADC_BLOCK_LENGTH));
+    if(pFilter->nSettle != 0)
+    {
+        pFilter->nSettle--;
+        return;
+    }
+    nBlock = (U_INT16)(nSum / ADC_BLOCK_LENGTH);
+    if(nBlock < pFilter->nMinimum)
+    {
+        pFilter->nMinimum = nBlock;
+    }
+    if(nBlock > pFilter->nMaximum)
+    {
+        pFilter->nMaximum = nBlock;
+    }
 }
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -220,7 +318,8 @@ void ADC_Disable(void)
 ;
 ; Description:
 ;   Handles DMA2_Stream0 interrupts. DMA2_Stream0 interrupts are mapped to
-;   ADC3 for receiving data from ADC3.
+;   ADC3 for receiving data from ADC3.  Each half of the buffer is filtered
+;   while the DMA fills the other.
 ;
 ; Reentrancy:
 ;   No
@@ -230,46 +329,55 @@ void ADC_Disable(void)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void DMA2_Stream0_IRQHandler(void)
 {
-    U_INT16 ADC_sum=0;
-    uint8_t loopy;
-
-    /* Disable ADC3 */
-    ADC_Cmd(ADC3, DISABLE);
-    /* Disable ADC3 DMA */
-    ADC_DMACmd(ADC3, DISABLE);
     if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_TEIF0))
     {
         DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_TEIF0);
     }
+    if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_HTIF0))
+    {
+        DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_HTIF0);
+        ADC_FilterBlock(&m_BatteryFilter, &ADC3ConvertedValue[0]);
+    }
     if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_TCIF0))
     {
         DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_TCIF0);
-        // ADC3ConvertedVoltage = ADC3ConvertedValue* 3300/4095;
-        // On 64 pin Package Vref+ is connected to VDDA (Pin 13)
-        // and Vref- is connected to VSSA pin 12
-        // ON PCB layout VDDA (pin 13) is 3.3V but 3.6 V confirmed by Bill
-        ADC_sum = 0;
-        for(loopy=0; loopy<8; loopy++)
-        {
-            ADC_sum += ADC3ConvertedValue[loopy];
-        }
-        ADC_sum /= 8;
-        // Vin = Vbat * R2 / (R1+R2); R2 = 1K Ohms, R1 = 5.6K Ohms
-        // Vbat = Vin * 6.6
-//	BatteryInputVoltageu16 = (U_INT16) ((U_INT32)ADC_sum * 6600 * 3300 / 4095 / 1000);
-        BatteryInputVoltageu16 = (U_INT16) ((U_INT32)ADC_sum * 21780ul / 4095ul);
-        BatteryInputVoltageIsValid = TRUE;
-	}
+        ADC_FilterBlock(&m_BatteryFilter, &ADC3ConvertedValue[ADC_BLOCK_LENGTH]);
+    }
 }// End DMA2_Stream0_IRQHandler()
 
 /*******************************************************************************
 *       @details
+*   ADC3ConvertedVoltage = ADC3ConvertedValue* 3300/4095;
+*   On 64 pin Package Vref+ is connected to VDDA (Pin 13)
+*   and Vref- is connected to VSSA pin 12
+*   ON PCB layout VDDA (pin 13) is 3.3V but 3.6 V confirmed by Bill
+*   Vin = Vbat * R2 / (R1+R2); R2 = 1K Ohms, R1 = 5.6K Ohms
+*   Vbat = Vin * 6.6
+*******************************************************************************/
+static U_INT16 ADC_BatteryMilliVolts(U_INT16 nCounts)
+{
+    return (U_INT16) ((U_INT32)nCounts * 21780ul / 4095ul);
+}
+
+/*******************************************************************************
+*       @details
+*   The filtered battery voltage, mV, 0 until the first block is in.
 *******************************************************************************/
 U_INT16 GetBatteryInputVoltageU16(void)
 {
-    if(BatteryInputVoltageIsValid == TRUE)
-        return BatteryInputVoltageu16;
-    return 0;
+    return ADC_BatteryMilliVolts(m_BatteryFilter.nFiltered);
+}
+
+/*******************************************************************************
+*       @details
+*   The lowest battery voltage over 32mS since sampling started, mV, 0 until
+*   the inputs have settled.
+*******************************************************************************/
+U_INT16 GetBatteryMinimumVoltageU16(void)
+{
+    if(m_BatteryFilter.nMinimum > m_BatteryFilter.nMaximum)
+        return 0;
+    return ADC_BatteryMilliVolts(m_BatteryFilter.nMinimum);
 }
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -278,7 +386,8 @@ U_INT16 GetBatteryInputVoltageU16(void)
 ;
 ; Description:
 ;   Handles DMA2_Stream4 interrupts. DMA2_Stream4 interrupts are mapped to
-;   ADC1 for receiving data for the Peak Detect.
+;   ADC1 for receiving data for the Peak Detect.  Each half of the buffer is
+;   filtered while the DMA fills the other.
 ;
 ; Reentrancy:
 ;   No
@@ -288,38 +397,45 @@ U_INT16 GetBatteryInputVoltageU16(void)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void DMA2_Stream4_IRQHandler(void)
 {
-    U_INT16 ADC_sum=0;
-    uint8_t loopy;
-
-    /* Disable ADC1 */
-    ADC_Cmd(ADC1, DISABLE);
-    /* Disable ADC1 DMA */
-    ADC_DMACmd(ADC1, DISABLE);
-    if (DMA_GetITStatus(DMA2_Stream4, DMA_IT_TEIF0))
+    if (DMA_GetITStatus(DMA2_Stream4, DMA_IT_TEIF4))
     {
-        DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_TEIF0);
+        DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_TEIF4);
     }
-    if (DMA_GetITStatus(DMA2_Stream4, DMA_IT_TCIF0))
+    if (DMA_GetITStatus(DMA2_Stream4, DMA_IT_HTIF4))
     {
-        DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_TCIF0);
-        ADC_sum = 0;
-        for(loopy=0; loopy<8; loopy++)
-        {
-            ADC_sum += 345;//ADC1ConvertedValue[loopy];
-        }
-        ADC_sum /= 8;
-        PeakDetectInputu16 = ADC_sum;
-        PeakDetectInputIsValid = TRUE;
+        DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_HTIF4);
+        ADC_FilterBlock(&m_PeakDetectFilter, &ADC1ConvertedValue[0]);
+    }
+    if (DMA_GetITStatus(DMA2_Stream4, DMA_IT_TCIF4))
+    {
+        DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_TCIF4);
+        ADC_FilterBlock(&m_PeakDetectFilter, &ADC1ConvertedValue[ADC_BLOCK_LENGTH]);
     }
 }// End DMA2_Stream4_IRQHandler()
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
+static U_INT16 ADC_PeakDetectMilliVolts(U_INT16 nCounts)
+{
+    return (U_INT16)(3300u * (U_INT32)nCounts / 4095u);
+}
+
+/*******************************************************************************
+*       @details
+*   The filtered peak detector voltage, mV, 0 until the first block is in.
+*******************************************************************************/
 U_INT16 GetPeakDetectInputU16(void)
 {
-    if(PeakDetectInputIsValid == TRUE)
-        return PeakDetectInputu16;
-    return 0;
+    return ADC_PeakDetectMilliVolts(m_PeakDetectFilter.nFiltered);
 }
 
+/*******************************************************************************
+*       @details
+*   The highest peak detector voltage over 32mS since sampling started, mV,
+*   0 until the inputs have settled.
+*******************************************************************************/
+U_INT16 GetPeakDetectMaximumU16(void)
+{
+    return ADC_PeakDetectMilliVolts(m_PeakDetectFilter.nMaximum);
+}
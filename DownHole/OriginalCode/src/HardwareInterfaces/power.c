@@ -18,9 +18,18 @@
 #include "board.h"
 #include "power.h"
 #include "SysTick.h"
+#include "Scheduler.h"
 #include "RealTimeClock.h"
 #include "FlashMemory.h"
 #include "ModemDriver.h"
+#include "CommDriver_UART.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the sleep residency is worked out over this long
+#define SLEEP_WINDOW	TEN_SECOND
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -29,6 +38,9 @@
 static TIME_RT tIdleTimer = 0;
 static TIME_RT tSysOffTimer = 0;
 volatile BOOL PowerFlag = 0;
+static TIME_RT m_tSleepWindow = 0;
+static U_INT32 m_nSleepMicroSeconds = 0;
+static U_INT16 m_nSleepPermille = 0;
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -104,6 +116,59 @@ TIME_RT GetSysOffTimer(void)
 	return tSysOffTimer;
 }
 
+/*******************************************************************************
+*       @details
+*   Called at the end of each pass of the main loop.  The core sleeps until
+*   the scheduler has a task due, or until an interrupt brings in serial data
+*   sooner.  SLEEP, not STOP, as TIM3 counts the gamma pulses and the UART DMA
+*   receives while the core is off.  The loop kicks the watchdog every pass,
+*   so it is never left more than 10mS.
+*******************************************************************************/
+void Power_Idle(void)
+{
+	TIME_RT nTicks;
+	U_INT32 nSlept;
+
+	__disable_irq();
+	// an interrupt since the loop last looked has left work for it, serial
+	// data marked, or a tick that made a timed task due.  The tick flags
+	// are not looked at, nothing runs from them since the task table.
+	nTicks = Scheduler_GetTimeToNext();
+	if(UART_IsRxPending() || (nTicks == 0) || ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0))
+	{
+		__enable_irq();
+		return;
+	}
+	if(nTicks > TEN_MILLI_SECONDS)
+	{
+		nTicks = TEN_MILLI_SECONDS - (ElapsedTimeLowRes(0) % TEN_MILLI_SECONDS);
+	}
+	nSlept = SysTick_Sleep(nTicks);
+	__enable_irq();
+	m_nSleepMicroSeconds += nSlept;
+	if(ElapsedTimeLowRes(m_tSleepWindow) >= SLEEP_WINDOW)
+	{
+		// uS asleep per mS is parts per thousand
+		m_nSleepPermille = (U_INT16)(m_nSleepMicroSeconds / ElapsedTimeLowRes(m_tSleepWindow));
+		if(m_nSleepPermille > 1000)
+		{
+			m_nSleepPermille = 1000;
+		}
+		m_nSleepMicroSeconds = 0;
+		m_tSleepWindow = ElapsedTimeLowRes(0);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Parts per thousand of the last SLEEP_WINDOW the core was asleep, the duty
+*   cycle is the rest.
+*******************************************************************************/
+U_INT16 Power_GetSleepPermille(void)
+{
+	return m_nSleepPermille;
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -0,0 +1,322 @@
+/*******************************************************************************
+*       @brief      This module keeps a ring of events in the battery backed
+*                   SRAM, so why the tool reset, which task was running, what
+*                   the modem was doing and how deep the stack went can be
+*                   read back after the reset.
+*       @file       Downhole/src/RealTimeClock/BlackBox.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include <stm32f4xx.h>
+#include "main.h"
+#include "SysTick.h"
+#include "BlackBox.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// marks the ring as started, the SRAM is all 0xFF after the backup power
+// was lost, and changes whenever BLACKBOX does
+#define BLACKBOX_MAGIC			0x42425831ul
+
+// service runs between stack measurements
+#define BLACKBOX_STACK_EVERY		10
+
+// what the unused stack is painted with, and what is left unpainted below
+// the stack pointer while painting
+#define BLACKBOX_STACK_PAINT		0xA5C3A5C3ul
+#define BLACKBOX_STACK_MARGIN		64
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+typedef struct
+{
+	U_INT32 nMagic;			// BLACKBOX_MAGIC
+	U_INT16 nResets;
+	U_INT16 nWatchdogResets;
+	U_BYTE nNext;			// where the next event goes
+	U_BYTE nCount;			// events in the ring
+	// where this run has got to, the next reset event says
+	U_BYTE nTask;
+	U_BYTE nModemState;
+	U_INT32 tAlive;			// mS since power up, the last service run
+	U_INT16 nStackFree;		// least free stack, words
+	U_BYTE bModemOnline;
+	U_BYTE nSpare;
+	BLACKBOX_EVENT Events[BLACKBOX_SIZE];
+} BLACKBOX;
+
+#ifdef HOST_BUILD
+// the simulation keeps the backup SRAM at its address, and runs on the host
+// stack, which is not measured
+static BLACKBOX * const m_pBlackBox = (BLACKBOX *)BKPSRAM_BASE;
+#else
+static BLACKBOX __attribute__((__section__(".bbramsection"))) m_BlackBox;
+static BLACKBOX * const m_pBlackBox = &m_BlackBox;
+// from the linker script, the address of _Min_Heap_Size is its value
+extern U_INT32 _end;
+extern U_INT32 _Min_Heap_Size;
+#endif
+
+// the painted stack, from the top of the heap to below main's frame
+static U_INT32 *m_pStackBottom = NULL;
+static U_INT32 *m_pStackTop = NULL;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void BlackBox_Write(U_BYTE nType, U_BYTE nTask, U_INT16 nData, U_INT32 tTime);
+static void BlackBox_PaintStack(void);
+static void BlackBox_MeasureStack(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Runs with the interrupts still off, so nothing is stacked below main
+*   while the stack is painted.
+*******************************************************************************/
+void BlackBox_Initialize(void)
+{
+	BLACKBOX *pBox = m_pBlackBox;
+	U_INT16 nResetFlags;
+
+	// NVPower_Initialize leaves the backup domain write protected
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
+	PWR_BackupAccessCmd(ENABLE);
+	nResetFlags = (U_INT16)(RCC->CSR >> 24);
+	if((pBox->nMagic != BLACKBOX_MAGIC) || (pBox->nNext >= BLACKBOX_SIZE) ||
+	   (pBox->nCount > BLACKBOX_SIZE))
+	{
+		BlackBox_Clear();
+	}
+	pBox->nResets++;
+	if(RCC_GetFlagStatus(RCC_FLAG_IWDGRST) == SET)
+	{
+		pBox->nWatchdogResets++;
+	}
+	RCC_ClearFlag();
+	BlackBox_Write(BLACKBOX_EVENT_RESET, pBox->nTask,
+		nResetFlags | ((U_INT16)pBox->nModemState << 8), pBox->tAlive);
+	if(pBox->nStackFree != BLACKBOX_STACK_UNKNOWN)
+	{
+		BlackBox_Write(BLACKBOX_EVENT_STACK, BLACKBOX_NO_TASK, pBox->nStackFree, pBox->tAlive);
+	}
+	pBox->nTask = BLACKBOX_NO_TASK;
+	pBox->nModemState = 0;
+	pBox->bModemOnline = FALSE;
+	pBox->tAlive = 0;
+	pBox->nStackFree = BLACKBOX_STACK_UNKNOWN;
+	BlackBox_PaintStack();
+}
+
+/*******************************************************************************
+*       @details
+*   The stack is measured once a second, a reset loses at most the last
+*   second of it.
+*******************************************************************************/
+void BlackBox_Service(void)
+{
+	static U_BYTE nRuns = 0;
+
+	m_pBlackBox->tAlive = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	if(++nRuns >= BLACKBOX_STACK_EVERY)
+	{
+		nRuns = 0;
+		BlackBox_MeasureStack();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void BlackBox_SetTask(U_BYTE nTask)
+{
+	m_pBlackBox->nTask = nTask;
+}
+
+/*******************************************************************************
+*       @details
+*   Called every modem manager pass, only going or leaving online is worth
+*   an event, the reset and wait states come and go all the time.
+*******************************************************************************/
+void BlackBox_SetModemState(U_BYTE nState, BOOL bOnline)
+{
+	BLACKBOX *pBox = m_pBlackBox;
+
+	pBox->nModemState = nState;
+	if(bOnline != (BOOL)pBox->bModemOnline)
+	{
+		pBox->bModemOnline = bOnline;
+		BlackBox_Record(bOnline ? BLACKBOX_EVENT_MODEM_ONLINE : BLACKBOX_EVENT_MODEM_OFFLINE, nState);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void BlackBox_Record(U_BYTE nType, U_INT16 nData)
+{
+	BlackBox_Write(nType, m_pBlackBox->nTask, nData, ElapsedTimeLowRes(START_LOW_RES_TIMER));
+}
+
+/*******************************************************************************
+*       @details
+*   The event is filled before the index moves on, so a reset part way
+*   through never leaves a half written event as the newest.
+*******************************************************************************/
+static void BlackBox_Write(U_BYTE nType, U_BYTE nTask, U_INT16 nData, U_INT32 tTime)
+{
+	BLACKBOX *pBox = m_pBlackBox;
+	BLACKBOX_EVENT *pEvent = &pBox->Events[pBox->nNext];
+
+	pEvent->nType = nType;
+	pEvent->nTask = nTask;
+	pEvent->nData = nData;
+	pEvent->tTime = tTime;
+	pBox->nNext = (U_BYTE)((pBox->nNext + 1) % BLACKBOX_SIZE);
+	if(pBox->nCount < BLACKBOX_SIZE)
+	{
+		pBox->nCount++;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE BlackBox_GetCount(void)
+{
+	return m_pBlackBox->nCount;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL BlackBox_GetEvent(U_BYTE nIndex, BLACKBOX_EVENT *pEvent)
+{
+	BLACKBOX *pBox = m_pBlackBox;
+	U_BYTE nSlot;
+
+	if(nIndex >= pBox->nCount)
+	{
+		return FALSE;
+	}
+	nSlot = (U_BYTE)((pBox->nNext + BLACKBOX_SIZE - pBox->nCount + nIndex) % BLACKBOX_SIZE);
+	*pEvent = pBox->Events[nSlot];
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 BlackBox_GetResets(void)
+{
+	return m_pBlackBox->nResets;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 BlackBox_GetWatchdogResets(void)
+{
+	return m_pBlackBox->nWatchdogResets;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 BlackBox_GetStackFree(void)
+{
+	return m_pBlackBox->nStackFree;
+}
+
+/*******************************************************************************
+*       @details
+*   Where this run has got to is kept.
+*******************************************************************************/
+void BlackBox_Clear(void)
+{
+	BLACKBOX *pBox = m_pBlackBox;
+	U_BYTE nTask = BLACKBOX_NO_TASK;
+	U_BYTE nModemState = 0;
+	BOOL bModemOnline = FALSE;
+	U_INT32 tAlive = 0;
+	U_INT16 nStackFree = BLACKBOX_STACK_UNKNOWN;
+
+	if(pBox->nMagic == BLACKBOX_MAGIC)
+	{
+		nTask = pBox->nTask;
+		nModemState = pBox->nModemState;
+		bModemOnline = pBox->bModemOnline;
+		tAlive = pBox->tAlive;
+		nStackFree = pBox->nStackFree;
+	}
+	memset(pBox, 0, sizeof(BLACKBOX));
+	pBox->nTask = nTask;
+	pBox->nModemState = nModemState;
+	pBox->bModemOnline = bModemOnline;
+	pBox->tAlive = tAlive;
+	pBox->nStackFree = nStackFree;
+	pBox->nMagic = BLACKBOX_MAGIC;
+}
+
+/*******************************************************************************
+*       @details
+*   Paints from the top of the heap to just below the stack pointer.
+*******************************************************************************/
+static void BlackBox_PaintStack(void)
+{
+#ifndef HOST_BUILD
+	U_INT32 *pWord;
+
+	m_pStackBottom = (U_INT32 *)(((U_INT32)&_end + (U_INT32)&_Min_Heap_Size + 7) & ~7ul);
+	m_pStackTop = (U_INT32 *)((__get_MSP() - BLACKBOX_STACK_MARGIN) & ~3ul);
+	for(pWord = m_pStackBottom; pWord < m_pStackTop; pWord++)
+	{
+		*pWord = BLACKBOX_STACK_PAINT;
+	}
+#endif
+}
+
+/*******************************************************************************
+*       @details
+*   The stack is free up to the first word that is not paint.  Costs a read
+*   of each free word, about half a mS at most.
+*******************************************************************************/
+static void BlackBox_MeasureStack(void)
+{
+	U_INT32 *pWord = m_pStackBottom;
+	U_INT32 nFree;
+
+	if(pWord == NULL)
+	{
+		return;
+	}
+	while((pWord < m_pStackTop) && (*pWord == BLACKBOX_STACK_PAINT))
+	{
+		pWord++;
+	}
+	nFree = (U_INT32)(pWord - m_pStackBottom);
+	if(nFree >= BLACKBOX_STACK_UNKNOWN)
+	{
+		nFree = BLACKBOX_STACK_UNKNOWN - 1;
+	}
+	if(nFree < m_pBlackBox->nStackFree)
+	{
+		m_pBlackBox->nStackFree = (U_INT16)nFree;
+	}
+}
@@ -0,0 +1,260 @@
+/*******************************************************************************
+*       @brief      This module runs the main loop tasks from a table, each
+*                   at its own period, and keeps how late and how long each
+*                   run was, timed with the DWT cycle counter.
+*       @file       Downhole/src/RealTimeClock/Scheduler.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include <stm32f4xx.h>
+#include "main.h"
+#include "SysTick.h"
+#include "Scheduler.h"
+#include "BlackBox.h"
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+typedef struct
+{
+	TIME_RT tNextRun;		// timed tasks, when the next run is due
+	TIME_RT tLastRun;		// every pass tasks, when the last pass was
+	U_INT32 nRuns;
+	U_INT32 nMisses;
+	U_INT32 nWorstCycles;
+	U_INT64 nTotalCycles;
+} SCHEDULER_STATE;
+
+static const SCHEDULER_TASK *m_pTasks = NULL;
+static U_BYTE m_nTasks = 0;
+static SCHEDULER_STATE m_TaskState[SCHEDULER_MAX_TASKS];
+static U_INT32 m_nCyclesPerMicroSecond = 1;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void Scheduler_RunTask(U_BYTE nTask, TIME_RT tLate);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Timed tasks are due on the multiples of their period, so tasks with the
+*   same period run in the same pass, in table order.
+*******************************************************************************/
+void Scheduler_Initialize(const SCHEDULER_TASK *pTasks, U_BYTE nTasks)
+{
+	RCC_ClocksTypeDef RCC_Clocks;
+	TIME_RT tNow;
+	U_BYTE nTask;
+
+	if(nTasks > SCHEDULER_MAX_TASKS)
+	{
+		nTasks = SCHEDULER_MAX_TASKS;
+	}
+	m_pTasks = pTasks;
+	m_nTasks = nTasks;
+	RCC_GetClocksFreq(&RCC_Clocks);
+	m_nCyclesPerMicroSecond = RCC_Clocks.HCLK_Frequency / 1000000ul;
+	if(m_nCyclesPerMicroSecond == 0)
+	{
+		m_nCyclesPerMicroSecond = 1;
+	}
+	// the cycle counter is in the debug block, it runs without a debugger
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	Scheduler_ClearStats();
+	tNow = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	for(nTask = 0; nTask < m_nTasks; nTask++)
+	{
+		m_TaskState[nTask].tLastRun = tNow;
+		m_TaskState[nTask].tNextRun = tNow;
+		if(m_pTasks[nTask].tPeriod != 0)
+		{
+			m_TaskState[nTask].tNextRun += m_pTasks[nTask].tPeriod -
+				(tNow % m_pTasks[nTask].tPeriod);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   A timed task that fell a whole period behind skips the runs it missed,
+*   as the tick flags did, and is counted as a miss.
+*******************************************************************************/
+void Scheduler_Run(void)
+{
+	SCHEDULER_STATE *pState;
+	TIME_RT tNow, tPeriod;
+	U_BYTE nTask;
+
+	for(nTask = 0; nTask < m_nTasks; nTask++)
+	{
+		pState = &m_TaskState[nTask];
+		tPeriod = m_pTasks[nTask].tPeriod;
+		tNow = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+		if(tPeriod == 0)
+		{
+			// late is the time since the last pass
+			Scheduler_RunTask(nTask, tNow - pState->tLastRun);
+			pState->tLastRun = tNow;
+			continue;
+		}
+		if((INT32)(tNow - pState->tNextRun) < 0)
+		{
+			continue;
+		}
+		Scheduler_RunTask(nTask, tNow - pState->tNextRun);
+		pState->tNextRun += tPeriod;
+		if((INT32)(tNow - pState->tNextRun) >= 0)
+		{
+			pState->tNextRun = tNow + tPeriod - (tNow % tPeriod);
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Interrupts taken while the task runs are counted in its time, which is
+*   what makes a task late for the next one.
+*******************************************************************************/
+static void Scheduler_RunTask(U_BYTE nTask, TIME_RT tLate)
+{
+	SCHEDULER_STATE *pState = &m_TaskState[nTask];
+	U_INT32 nStart, nCycles;
+
+	if(tLate > m_pTasks[nTask].tDeadline)
+	{
+		pState->nMisses++;
+	}
+	// the black box says which task a reset stopped
+	BlackBox_SetTask(nTask);
+	nStart = DWT->CYCCNT;
+	m_pTasks[nTask].pfTask();
+	nCycles = DWT->CYCCNT - nStart;
+	BlackBox_SetTask(BLACKBOX_NO_TASK);
+	pState->nRuns++;
+	pState->nTotalCycles += nCycles;
+	if(nCycles > pState->nWorstCycles)
+	{
+		pState->nWorstCycles = nCycles;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Tasks run every pass are left out, they only have work when an interrupt
+*   brings it, and the interrupt wakes the core.
+*******************************************************************************/
+TIME_RT Scheduler_GetTimeToNext(void)
+{
+	TIME_RT tNow, tNext;
+	INT32 nUntil;
+	U_BYTE nTask;
+
+	tNow = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	tNext = TEN_MINUTE;
+	for(nTask = 0; nTask < m_nTasks; nTask++)
+	{
+		if(m_pTasks[nTask].tPeriod == 0)
+		{
+			continue;
+		}
+		nUntil = (INT32)(m_TaskState[nTask].tNextRun - tNow);
+		if(nUntil <= 0)
+		{
+			return 0;
+		}
+		if((TIME_RT)nUntil < tNext)
+		{
+			tNext = (TIME_RT)nUntil;
+		}
+	}
+	return tNext;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE Scheduler_GetTaskCount(void)
+{
+	return m_nTasks;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const char *Scheduler_GetTaskName(U_BYTE nTask)
+{
+	if(nTask >= m_nTasks)
+	{
+		return "";
+	}
+	return m_pTasks[nTask].pName;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+TIME_RT Scheduler_GetTaskPeriod(U_BYTE nTask)
+{
+	if(nTask >= m_nTasks)
+	{
+		return 0;
+	}
+	return m_pTasks[nTask].tPeriod;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL Scheduler_GetStats(U_BYTE nTask, SCHEDULER_STATS *pStats)
+{
+	SCHEDULER_STATE *pState;
+
+	if(nTask >= m_nTasks)
+	{
+		return FALSE;
+	}
+	pState = &m_TaskState[nTask];
+	pStats->nRuns = pState->nRuns;
+	pStats->nMisses = pState->nMisses;
+	pStats->nWorstMicroSeconds = pState->nWorstCycles / m_nCyclesPerMicroSecond;
+	pStats->nAverageMicroSeconds = 0;
+	if(pState->nRuns != 0)
+	{
+		pStats->nAverageMicroSeconds =
+			(U_INT32)((pState->nTotalCycles / pState->nRuns) / m_nCyclesPerMicroSecond);
+	}
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   The due times are kept, so clearing does not shift the schedule.
+*******************************************************************************/
+void Scheduler_ClearStats(void)
+{
+	U_BYTE nTask;
+
+	for(nTask = 0; nTask < SCHEDULER_MAX_TASKS; nTask++)
+	{
+		m_TaskState[nTask].nRuns = 0;
+		m_TaskState[nTask].nMisses = 0;
+		m_TaskState[nTask].nWorstCycles = 0;
+		m_TaskState[nTask].nTotalCycles = 0;
+	}
+}
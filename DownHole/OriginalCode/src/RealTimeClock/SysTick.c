@@ -20,6 +20,9 @@
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
+static void sysTick_Advance(TIME_RT nTicks);
+static void sysTick_Restart(U_INT32 nCycles);
+
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
@@ -30,6 +33,9 @@ volatile BOOL Thousand_mS_tick_flag=0;
 volatile TIME_RT makeupSystemTicks = 0;
 TIME_RT m_nRunTimeTicks = 0;
 static TIME_RT m_nSystemTicks = 0;
+static U_INT16 m_nRunTimeDiv = 0;
+// core clocks in one system tick, the usual SysTick reload plus one
+static U_INT32 m_nSysTickCyclesPerMs = 0;
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -51,15 +57,7 @@ static TIME_RT m_nSystemTicks = 0;
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void Process_SysTick_Events(void)
 {
-	static U_INT16 runTimeDiv = 0;
-
-	runTimeDiv++;
-	if(runTimeDiv > 1000)
-	{
-		runTimeDiv=0;
-		m_nRunTimeTicks++;
-	}
-	m_nSystemTicks++;
+	sysTick_Advance(1);
 	// while sleeping and clocks are off, the system ticks are not working.
 	// tack on the lost time.
 	if(makeupSystemTicks)
@@ -102,10 +100,132 @@ void SysTick_Init(void)
 {
 	RCC_ClocksTypeDef RCC_Clocks;
 	RCC_GetClocksFreq(&RCC_Clocks);
-	SysTick_Config(RCC_Clocks.HCLK_Frequency / 1000);
+	m_nSysTickCyclesPerMs = RCC_Clocks.HCLK_Frequency / 1000;
+	SysTick_Config(m_nSysTickCyclesPerMs);
 	NVIC_SetPriority(SysTick_IRQn, 1);
 } // End SysTick_Init()
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   SysTick_Sleep()
+;
+; Description:
+;   Sleeps the core (WFI) until an interrupt, at the latest until nTicks
+;   system ticks from now.  The SysTick reload is stretched over the ticks
+;   in between, so the core is not woken every mS for nothing.  The ticks
+;   slept through are counted when the core wakes, all but the last, which
+;   SysTick_Handler counts once interrupts are enabled, setting the 10, 100
+;   and 1000 mS flags as usual.
+;
+; Parameters:
+;   TIME_RT nTicks => system ticks until the next work is due, 1 or more
+;
+; Returns:
+;   U_INT32 => time asleep in uS
+;
+; Reentrancy:
+;   No
+;
+; Assumptions:
+;   Called with interrupts disabled.  A pending interrupt still ends the
+;   WFI, it is taken when interrupts are enabled again.
+;
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT32 SysTick_Sleep(TIME_RT nTicks)
+{
+	U_INT32 nVal, nNow, nPeriod, nElapsed, nLeft;
+	BOOL bFired;
+
+	nVal = SysTick->VAL;
+	// a tick that is due now or not yet taken ends the sleep at once
+	if((nTicks == 0) || (nVal == 0) || (m_nSysTickCyclesPerMs == 0) ||
+	   ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0))
+	{
+		return 0;
+	}
+	nPeriod = nVal + ((U_INT32)(nTicks - 1) * m_nSysTickCyclesPerMs);
+	if(nTicks > 1)
+	{
+		sysTick_Restart(nPeriod);
+		// the tick came in before the counter was started over, let it be
+		// taken and carry on at the usual period
+		if((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0)
+		{
+			sysTick_Restart(m_nSysTickCyclesPerMs);
+			return 0;
+		}
+	}
+	__WFI();
+	// the counter reloads as the tick pends, read it after the pending bit
+	bFired = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) ? TRUE : FALSE;
+	nNow = SysTick->VAL;
+	if(!bFired && ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0))
+	{
+		bFired = TRUE;
+		nNow = SysTick->VAL;
+	}
+	if(bFired)
+	{
+		// running at the usual period again since the tick
+		nElapsed = nPeriod + ((nNow == 0) ? 0 : (m_nSysTickCyclesPerMs - nNow));
+		sysTick_Advance(nTicks - 1);
+	}
+	else
+	{
+		// woken early, count the ticks passed and carry on from the next one
+		nElapsed = nPeriod - nNow;
+		nLeft = (nNow + m_nSysTickCyclesPerMs - 1) / m_nSysTickCyclesPerMs;
+		if(nLeft == 0)
+		{
+			nLeft = 1;
+		}
+		sysTick_Advance(nTicks - nLeft);
+		if(nLeft > 1)
+		{
+			sysTick_Restart(nNow - ((nLeft - 1) * m_nSysTickCyclesPerMs));
+		}
+	}
+	return nElapsed / (m_nSysTickCyclesPerMs / 1000);
+} // End SysTick_Sleep()
+
+/*******************************************************************************
+*       @details
+*   The run time counter keeps its period of 1001 ticks.
+*******************************************************************************/
+static void sysTick_Advance(TIME_RT nTicks)
+{
+	m_nRunTimeDiv += nTicks;
+	while(m_nRunTimeDiv > 1000)
+	{
+		m_nRunTimeDiv -= 1001;
+		m_nRunTimeTicks++;
+	}
+	m_nSystemTicks += nTicks;
+}
+
+/*******************************************************************************
+*       @details
+*   Starts the SysTick counter over, nCycles to the next tick, then the usual
+*   period after that.  The counter takes the reload a clock after VAL is
+*   written, only then can the usual reload go back.
+*******************************************************************************/
+static void sysTick_Restart(U_INT32 nCycles)
+{
+	if(nCycles < 2)
+	{
+		nCycles = 2;
+	}
+	SysTick->LOAD = nCycles - 1;
+	SysTick->VAL = 0;
+	while(SysTick->VAL == 0)
+	{
+	}
+	SysTick->LOAD = m_nSysTickCyclesPerMs - 1;
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
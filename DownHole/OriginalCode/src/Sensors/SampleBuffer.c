@@ -0,0 +1,193 @@
+/*******************************************************************************
+*       @brief      This module takes a survey, gamma and battery sample every
+*                   interval and keeps them until the uphole has them, so one
+*                   modem packet can carry several samples.
+*       @file       Downhole/src/Sensors/SampleBuffer.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "main.h"
+#include "adc.h"
+#include "SysTick.h"
+#include "compass.h"
+#include "SensorManager_Gamma.h"
+#include "SampleBuffer.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// limits of the sample interval, mS
+#define SAMPLE_MIN_INTERVAL		50
+#define SAMPLE_MAX_INTERVAL		60000
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static SAMPLE_RECORD m_Samples[SAMPLE_BUFFER_SIZE];
+// oldest sample kept and how many follow it
+static U_BYTE m_nSampleFirst = 0;
+static U_BYTE m_nSampleCount = 0;
+// sequence number of the oldest sample, each new one is one more
+static U_INT16 m_nSampleSequence = 0;
+static U_INT16 m_nSamplesDropped = 0;
+// 0 is not sampling
+static TIME_RT m_tSampleInterval = 0;
+static TIME_RT m_tSampleLast = 0;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void SampleBuffer_TakeSample(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void SampleBuffer_Service(void)
+{
+	if(m_tSampleInterval == 0)
+	{
+		return;
+	}
+	if(ElapsedTimeLowRes(m_tSampleLast) >= m_tSampleInterval)
+	{
+		SampleBuffer_TakeSample();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void SampleBuffer_TakeSample(void)
+{
+	SAMPLE_RECORD *pSample;
+
+	m_tSampleLast = ElapsedTimeLowRes(0);
+	if(m_nSampleCount >= SAMPLE_BUFFER_SIZE)
+	{
+		// nobody asked in time, lose the oldest
+		m_nSampleFirst = (m_nSampleFirst + 1) % SAMPLE_BUFFER_SIZE;
+		m_nSampleCount--;
+		m_nSampleSequence++;
+		m_nSamplesDropped++;
+	}
+	pSample = &m_Samples[(m_nSampleFirst + m_nSampleCount) % SAMPLE_BUFFER_SIZE];
+	m_nSampleCount++;
+	pSample->tTime = m_tSampleLast;
+	pSample->nFlags = 0;
+	if(Compass_IsDataValid())
+	{
+		pSample->nFlags |= SAMPLE_FLAG_COMPASS;
+	}
+	pSample->nAzimuth = Compass_GetSurveyAzimuth();
+	pSample->nPitch = Compass_GetSurveyPitch();
+	pSample->nRoll = Compass_GetSurveyRoll();
+	pSample->nTemperature = Compass_GetSurveyTemperature();
+	if(bValidGammaValues)
+	{
+		pSample->nFlags |= SAMPLE_FLAG_GAMMA;
+	}
+	pSample->nGamma = GetCurrentGammaCount();
+	pSample->nGammaError = GetCurrentGammaError();
+	pSample->nBattery = GetBatteryInputVoltageU16();
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void SampleBuffer_SetInterval(U_INT16 nInterval)
+{
+	if(nInterval == 0)
+	{
+		m_tSampleInterval = 0;
+		m_nSampleSequence += m_nSampleCount;
+		m_nSampleCount = 0;
+		return;
+	}
+	if(nInterval < SAMPLE_MIN_INTERVAL)
+		nInterval = SAMPLE_MIN_INTERVAL;
+	if(nInterval > SAMPLE_MAX_INTERVAL)
+		nInterval = SAMPLE_MAX_INTERVAL;
+	if(m_tSampleInterval == 0)
+	{
+		m_tSampleLast = ElapsedTimeLowRes(0);
+	}
+	m_tSampleInterval = nInterval;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 SampleBuffer_GetInterval(void)
+{
+	return (U_INT16)m_tSampleInterval;
+}
+
+/*******************************************************************************
+*       @details
+*   A sequence past the newest sample, as after a downhole power up, is not
+*   something the uphole could have, so nothing is dropped.
+*******************************************************************************/
+void SampleBuffer_Release(U_INT16 nSequence)
+{
+	U_INT16 nRelease;
+
+	nRelease = (U_INT16)(nSequence - m_nSampleSequence);
+	if(nRelease > m_nSampleCount)
+	{
+		return;
+	}
+	m_nSampleFirst = (m_nSampleFirst + nRelease) % SAMPLE_BUFFER_SIZE;
+	m_nSampleCount -= nRelease;
+	m_nSampleSequence = nSequence;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 SampleBuffer_GetFirstSequence(void)
+{
+	return m_nSampleSequence;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE SampleBuffer_GetCount(void)
+{
+	return m_nSampleCount;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 SampleBuffer_GetDropped(void)
+{
+	return m_nSamplesDropped;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL SampleBuffer_GetSample(U_BYTE nIndex, SAMPLE_RECORD *pSample)
+{
+	if(nIndex >= m_nSampleCount)
+	{
+		return FALSE;
+	}
+	*pSample = m_Samples[(m_nSampleFirst + nIndex) % SAMPLE_BUFFER_SIZE];
+	return TRUE;
+}
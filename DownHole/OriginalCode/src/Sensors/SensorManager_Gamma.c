@@ -13,6 +13,7 @@
 //============================================================================//
 
 
+#include <math.h>
 #include <stm32f4xx.h>
 #include "SysTick.h"
 #include "main.h"
@@ -26,28 +27,51 @@
 
 
 //============================================================================//
-//      DATA DEFINITIONS                                                      //
+//      CONSTANTS                                                             //
 //============================================================================//
 
-#define NUMGammaCount (ONE_SECOND/TWO_HUNDRED_MILLI_SECONDS)
+// most slots the window can hold
+#define GAMMA_MAX_SLOTS			64
+// limits of the slot period, mS
+#define GAMMA_MIN_PERIOD		50
+#define GAMMA_MAX_PERIOD		2000
+// past this fraction of dead time the correction is meaningless
+#define GAMMA_MAX_DEAD_FRACTION		0.5f
 
-// only after the first 5 readings do we allow values to spew forth.
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// only after the window first fills do we allow values to spew forth.
 BOOL bValidGammaValues = FALSE;
 
-static U_INT32 m_nPreviousGammaCount;
+static U_INT16 m_nPreviousGammaCount;
 // if first powered up, do not trust the previous gamma count.
 static BOOL bTossFirstReading;
 // if not powered, code returns null.
 static BOOL bWeArePowered = FALSE;
-// we take readings every 200mS, this array is 5 slots,
-// so after 1 second valid values begin to spew forth.
-static U_INT32 m_nGammaCountHz[NUMGammaCount];
+// counts and mS of each slot, the window is the last m_nGammaSlots of them
+static U_INT16 m_nGammaCountSlot[GAMMA_MAX_SLOTS];
+static U_INT16 m_nGammaTimeSlot[GAMMA_MAX_SLOTS];
+static U_INT16 m_nGammaSlotIndex;
+// running sums over the window, a slot is added as the oldest drops out
+static U_INT32 m_nGammaWindowCounts;
+static U_INT32 m_nGammaWindowTime;
+// start of the slot being counted
+static TIME_RT m_tGammaSlotStart;
+// slot period in mS and slots per window, 200mS by 5 makes the old 1 second
+static TIME_RT m_tGammaPeriod = TWO_HUNDRED_MILLI_SECONDS;
+static U_INT16 m_nGammaSlots = 5;
+// detector dead time, nS, 0 for no correction
+static U_INT16 m_nGammaDeadTime = 0;
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
 static void SetGammaPowerPin(BOOL bPower);
+static void ClearGammaWindow(void);
+static REAL32 GammaDeadTimeFactor(REAL32 fMeasured);
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -132,57 +156,175 @@ void Initialize_Gamma_Sensor(void)
     TIM_SelectSlaveMode(TIM3, TIM_SlaveMode_External1);
     TIM_Cmd(TIM3, ENABLE);
 
+	ClearGammaWindow();
+}
+
+/*******************************************************************************
+*       @details
+*   Throws away the window, it is valid again once it fills.
+*******************************************************************************/
+static void ClearGammaWindow(void)
+{
+	U_INT16 nIndex;
+
+	for(nIndex = 0; nIndex < GAMMA_MAX_SLOTS; nIndex++)
+	{
+		m_nGammaCountSlot[nIndex] = 0;
+		m_nGammaTimeSlot[nIndex] = 0;
+	}
+	m_nGammaSlotIndex = 0;
+	m_nGammaWindowCounts = 0;
+	m_nGammaWindowTime = 0;
 	bTossFirstReading = TRUE;
 	bValidGammaValues = FALSE;
 }
 
+/*******************************************************************************
+*       @details
+*   Sets the slot period and the window, both mS, and the detector dead time
+*   in nS.  A short window answers quickly, a long one is less noisy.  The
+*   window is rounded to whole slots and held to GAMMA_MAX_SLOTS of them,
+*   and to no more than 65535mS.
+*******************************************************************************/
+void SetGammaWindow(U_INT16 nPeriod, U_INT16 nWindow, U_INT16 nDeadTime)
+{
+	U_INT16 nSlots;
+
+	if(nPeriod < GAMMA_MIN_PERIOD)
+		nPeriod = GAMMA_MIN_PERIOD;
+	if(nPeriod > GAMMA_MAX_PERIOD)
+		nPeriod = GAMMA_MAX_PERIOD;
+	nSlots = (U_INT16)((nWindow + (nPeriod / 2)) / nPeriod);
+	if(nSlots < 1)
+		nSlots = 1;
+	if(nSlots > GAMMA_MAX_SLOTS)
+		nSlots = GAMMA_MAX_SLOTS;
+	// the window is reported in 16 bits
+	if(((U_INT32)nSlots * nPeriod) > 0xFFFF)
+		nSlots = (U_INT16)(0xFFFF / nPeriod);
+	m_tGammaPeriod = nPeriod;
+	m_nGammaSlots = nSlots;
+	m_nGammaDeadTime = nDeadTime;
+	ClearGammaWindow();
+}
+
+/*******************************************************************************
+*       @details
+*   Returns the mS covered by the window.
+*******************************************************************************/
+U_INT16 GetGammaWindow(void)
+{
+	return (U_INT16)(m_tGammaPeriod * m_nGammaSlots);
+}
+
 /*******************************************************************************
 *       @details
 * The sensor gives a train of pulses as the gamma count is detected.
-* These pulses are counted in TIM3
+* These pulses are counted in TIM3.  Called every 10mS, each time a slot
+* period has gone by its counts replace the oldest slot in the window.
 *******************************************************************************/
 void UpdateGammaCountsThisPeriod(void)
 {
-    U_INT32 nCurrentGammaCount;
-    static U_INT32 nIndex = 0;
+	U_INT16 nCurrentGammaCount;
+	U_INT16 nCounts;
+	TIME_RT tElapsed;
 
 	if(bWeArePowered == FALSE) return;
-	// we get here every 200mS
-	nCurrentGammaCount = TIM_GetCounter(TIM3);
 	if(bTossFirstReading)
 	{
 		bTossFirstReading = FALSE;
+		m_nPreviousGammaCount = (U_INT16)TIM_GetCounter(TIM3);
+		m_tGammaSlotStart = ElapsedTimeLowRes(0);
+		return;
 	}
-	else
+	tElapsed = ElapsedTimeLowRes(m_tGammaSlotStart);
+	if(tElapsed < m_tGammaPeriod) return;
+	m_tGammaSlotStart += tElapsed;
+	if(tElapsed > 0xFFFF)
+		tElapsed = 0xFFFF;
+	// TIM3 is 16 bits, the difference is right across a wrap
+	nCurrentGammaCount = (U_INT16)TIM_GetCounter(TIM3);
+	nCounts = (U_INT16)(nCurrentGammaCount - m_nPreviousGammaCount);
+	m_nPreviousGammaCount = nCurrentGammaCount;
+
+	m_nGammaWindowCounts += nCounts;
+	m_nGammaWindowCounts -= m_nGammaCountSlot[m_nGammaSlotIndex];
+	m_nGammaWindowTime += tElapsed;
+	m_nGammaWindowTime -= m_nGammaTimeSlot[m_nGammaSlotIndex];
+	m_nGammaCountSlot[m_nGammaSlotIndex] = nCounts;
+	m_nGammaTimeSlot[m_nGammaSlotIndex] = (U_INT16)tElapsed;
+	if(++m_nGammaSlotIndex >= m_nGammaSlots)
 	{
-		m_nGammaCountHz[nIndex++] = nCurrentGammaCount - m_nPreviousGammaCount;
-		if(nIndex >= NUMGammaCount)
-		{
-			nIndex = 0;
-			bValidGammaValues = TRUE;
-		}
+		m_nGammaSlotIndex = 0;
+		bValidGammaValues = TRUE;
 	}
-	m_nPreviousGammaCount = nCurrentGammaCount;
 }
 
 /*******************************************************************************
 *       @details
+*   Scale from the measured rate to the true rate for a detector that is
+*   blind for the dead time after each pulse, n = m / (1 - m tau).  Returns
+*   0 when the detector is too busy for the correction to mean anything.
+*******************************************************************************/
+static REAL32 GammaDeadTimeFactor(REAL32 fMeasured)
+{
+	REAL32 fDeadFraction;
+
+	fDeadFraction = fMeasured * (REAL32)m_nGammaDeadTime * 1.0e-9f;
+	if(fDeadFraction > GAMMA_MAX_DEAD_FRACTION)
+		return 0.0f;
+	return 1.0f / (1.0f - fDeadFraction);
+}
+
+/*******************************************************************************
+*       @details
+*   Returns the counts per second over the window, corrected for dead time.
 *******************************************************************************/
 U_INT16 GetCurrentGammaCount(void)
 {
-    U_INT32 nIndex = 0;
-    U_INT32 nCountSum = 0;
+	REAL32 fRate;
+	REAL32 fFactor;
+
+	if(bWeArePowered == FALSE) return 0;
+	if(bValidGammaValues == FALSE) return 0;
+	if(m_nGammaWindowTime == 0) return 0;
+
+	fRate = (REAL32)m_nGammaWindowCounts * 1000.0f / (REAL32)m_nGammaWindowTime;
+	fFactor = GammaDeadTimeFactor(fRate);
+	if(fFactor == 0.0f)
+		return 0xFFFF;
+	fRate *= fFactor;
+	if(fRate > 65535.0f)
+		fRate = 65535.0f;
+	return (U_INT16)(fRate + 0.5f);
+}
+
+/*******************************************************************************
+*       @details
+*   Returns the standard error of GetCurrentGammaCount() in 0.1 counts per
+*   second.  The counts are Poisson, so the error of the measured rate is
+*   sqrt(N) / T, and the dead time correction scales it by the factor
+*   squared.
+*******************************************************************************/
+U_INT16 GetCurrentGammaError(void)
+{
+	REAL32 fRate;
+	REAL32 fError;
+	REAL32 fFactor;
 
 	if(bWeArePowered == FALSE) return 0;
 	if(bValidGammaValues == FALSE) return 0;
+	if(m_nGammaWindowTime == 0) return 0;
 
-    while(nIndex < NUMGammaCount)
-    {
-        nCountSum = m_nGammaCountHz[nIndex++];
-    }
-	if(nCountSum > 0xFFFF)
-		nCountSum=0xFFFF;
-    return (U_INT16)nCountSum;
+	fRate = (REAL32)m_nGammaWindowCounts * 1000.0f / (REAL32)m_nGammaWindowTime;
+	fError = sqrtf((REAL32)m_nGammaWindowCounts) * 1000.0f / (REAL32)m_nGammaWindowTime;
+	fFactor = GammaDeadTimeFactor(fRate);
+	if(fFactor == 0.0f)
+		return 0xFFFF;
+	fError *= fFactor * fFactor * 10.0f;
+	if(fError > 65535.0f)
+		fError = 65535.0f;
+	return (U_INT16)(fError + 0.5f);
 }
 
 /*******************************************************************************
@@ -201,6 +343,9 @@ void SetGammaPower(BOOL desiredState)
 		if(GetGammaOnOff() == TRUE)
 		{
 			SetGammaPowerPin(TRUE);
+			// counts taken while off would spoil the window
+			if(bWeArePowered == FALSE)
+				ClearGammaWindow();
 			bWeArePowered = TRUE;
 		}
 		else
@@ -17,10 +17,12 @@
 #include <string.h>
 #include <math.h>
 #include "CommDriver_UART.h"
+#include "FlashMemory.h"
 #include "power.h"
 #include "RealTimeClock.h"
 #include "SysTick.h"
 #include "compass.h"
+#include "compass_cal.h"
 #include "wdt.h"
 
 //============================================================================//
@@ -28,20 +30,58 @@
 //============================================================================//
 
 #define COMPASS_RECEIVE_BUFFER_SIZE     256
-// shift values will be subtracted from the natural sensor value
-#if COMPASS_MANUFACTURER == COMPASS_VECTORNAV
- #define SHIFT_AZIMUTH	0.0
- #define SHIFT_ROLL		0.0
- #define SHIFT_PITCH	0.0
-#elif COMPASS_MANUFACTURER == COMPASS_APS544
- #define SHIFT_AZIMUTH	0.0
- #define SHIFT_ROLL		180.0
- #define SHIFT_PITCH	90.0
-#elif COMPASS_MANUFACTURER == COMPASS_TENFOOT
- #define SHIFT_AZIMUTH	0.0
- #define SHIFT_ROLL		0.0
- #define SHIFT_PITCH	0.0
+// Tenfoot reply: 8 x 4 byte values and a one byte sum of those 32 bytes
+#define TENFOOT_FRAME_LENGTH            33
+// time between survey requests when the compass does not answer
+#define COMPASS_SURVEY_INTERVAL         5000
+// time to wait for an answer before trying the next manufacturer,
+// the slowest (Tenfoot) answers in 400mS
+#define COMPASS_DETECT_TIMEOUT          ONE_SECOND
+// unanswered survey requests before the compass is probed again
+#define COMPASS_REDETECT_MISSES         6
+// room in the UART queue for the longest request, the VectorNav's
+#define COMPASS_REQUEST_ROOM            12
+// most significant digits kept by the number parser
+#define COMPASS_MAX_DIGITS              9
+// raw samples kept for window reduction, streaming the Tenfoot as fast as
+// it answers that is 25.6 seconds of data
+#define COMPASS_SAMPLE_RING_SIZE        64
+// fastest streaming rate, a request is only sent once the last one was
+// answered and the Tenfoot takes 400mS, as above, to answer
+#define COMPASS_MIN_STREAM_INTERVAL     400
+// samples further than this many standard deviations from the window
+// mean, on any axis, are left out of the reduced survey
+#define COMPASS_OUTLIER_SIGMA           2.5f
+// the tool is still when, over the still window, the gravity axes, the
+// total gravity and the total field all vary less than these
+#define COMPASS_STILL_WINDOW            3000
+#define COMPASS_STILL_MIN_SAMPLES       4
+// sum of the three axis variances, mG^2 (5mG rms each)
+#define COMPASS_STILL_G_VARIANCE        75.0f
+// mG^2 (3mG rms)
+#define COMPASS_STILL_GTOTAL_VARIANCE   9.0f
+// nT^2 (150nT rms)
+#define COMPASS_STILL_HTOTAL_VARIANCE   22500.0f
+// values looked at per sample, and the variances they are judged by
+#define COMPASS_STILL_VALUES            5
+#define COMPASS_STILL_ITEMS             3
+
+// math library and literals matching the selected precision, an unsuffixed
+// literal or a double function would pull the whole expression into
+// software emulated double precision
+#if COMPASS_MATH_FLOAT32
+ #define COMPASS_SQRT(x)		sqrtf(x)
+ #define COMPASS_ATAN2(y, x)	atan2f((y), (x))
+ #define COMPASS_SIN(x)			sinf(x)
+ #define COMPASS_CONST(x)		((REAL32)(x))
+#else
+ #define COMPASS_SQRT(x)		sqrt(x)
+ #define COMPASS_ATAN2(y, x)	atan2((y), (x))
+ #define COMPASS_SIN(x)			sin(x)
+ #define COMPASS_CONST(x)		((REAL64)(x))
 #endif
+#define RADIANS_TO_DEGREES		COMPASS_CONST(180.0 / M_PI)
+#define TENFOOT_SCALE			COMPASS_CONST(4096.0)
 
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
@@ -50,6 +90,7 @@
 typedef enum __COMPASS_STATE__
 {
 	COMPASS_INIT,
+	COMPASS_DETECT,
 	COMPASS_CONNECTED
 } COMPASS_STATE;
 
@@ -59,43 +100,169 @@ typedef struct __SURVEY_DATA_STRUCT__
 	INT16 nPitch;
 	INT16 nRoll;
 	INT16 nTemperature;
+	COMPASS_SURVEY_METRICS metrics;
 	BOOL isValid;
 } SURVEY_DATA_STRUCT;
 
+#if COMPASS_MATH_FLOAT32
+typedef REAL32 COMPASS_REAL;
+#else
+typedef REAL64 COMPASS_REAL;
+#endif
+
+// one decoded answer, in degrees and degrees C, the totals are 0 when the
+// compass does not report them
+typedef struct
+{
+	REAL32 fAzimuth;
+	REAL32 fPitch;
+	REAL32 fRoll;
+	REAL32 fTemperature;
+	REAL32 fGtotal;		// mG
+	REAL32 fHtotal;		// nT
+	REAL32 fDip;		// degrees
+	REAL32 fGtotalStd;	// mG, over the samples averaged
+	REAL32 fHtotalStd;	// nT
+	U_BYTE nSamples;
+} COMPASS_READING;
+
+// one raw Tenfoot answer, in sensor counts, and when it arrived
+typedef struct
+{
+	TIME_RT tTime;
+	INT32 nHx;
+	INT32 nHy;
+	INT32 nHz;
+	INT32 nGx;
+	INT32 nGy;
+	INT32 nGz;
+	INT32 nTemperature;
+} COMPASS_RAW_SAMPLE;
+
+// magnetic (nT) and gravity (mG) vectors, and degrees C * 10
+typedef struct
+{
+	COMPASS_REAL fHx;
+	COMPASS_REAL fHy;
+	COMPASS_REAL fHz;
+	COMPASS_REAL fGx;
+	COMPASS_REAL fGy;
+	COMPASS_REAL fGz;
+	COMPASS_REAL fTemperature;
+} COMPASS_VECTORS;
+
+// what differs between the manufacturers
+typedef struct
+{
+	// Command to get Azimuth, Pitch, and Roll
+	const char *pszRequest;
+	U_INT32 nBaudRate;
+	// frames one received byte, TRUE once a whole frame is in the buffer
+	BOOL (*pfFrame)(U_BYTE nData);
+	// decodes the frame in the buffer
+	BOOL (*pfDecode)(COMPASS_READING *pReading);
+	// shift values will be subtracted from the natural sensor value
+	REAL32 fShiftAzimuth;
+	REAL32 fShiftRoll;
+	REAL32 fShiftPitch;
+} COMPASS_PROFILE;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
 // Clears the compass receive buffer
 static void Compass_ClearReceiveBuffer(void);
+static void Compass_ClearBuffer(void);
+static void Compass_SelectType(U_BYTE nType);
+static void Compass_SendRequest(void);
 static INT32 GetTenfoot32(U_BYTE* packet);
+static BOOL Compass_ParseReal(const char **ppText, REAL32 *pfValue);
+static BOOL Compass_ParseField(const char *pszLabel, REAL32 *pfValue);
+static BOOL Compass_FrameVectorNav(U_BYTE nData);
+static BOOL Compass_FrameAPS544(U_BYTE nData);
+static BOOL Compass_FrameTenfoot(U_BYTE nData);
+static BOOL Compass_DecodeVectorNav(COMPASS_READING *pReading);
+static BOOL Compass_DecodeAPS544(COMPASS_READING *pReading);
+static BOOL Compass_DecodeTenfoot(COMPASS_READING *pReading);
+static void Compass_SolveTenfoot(const COMPASS_VECTORS *pVectors, COMPASS_READING *pReading);
+static void Compass_CorrectField(const COMPASS_VECTORS *pVectors, COMPASS_REAL *pfField);
+static void Compass_StoreSurvey(COMPASS_READING *pReading, SURVEY_DATA_STRUCT *pSurvey);
+static const COMPASS_RAW_SAMPLE *Compass_SampleAgo(U_BYTE nAgo);
+static U_BYTE Compass_SamplesInWindow(TIME_RT tWindow);
+static U_BYTE Compass_AverageSamples(U_BYTE nWindow, COMPASS_READING *pReading);
+static void Compass_CheckStationary(void);
+static void Compass_StillValues(const COMPASS_RAW_SAMPLE *pSample, REAL32 *pfValue);
+static REAL32 Compass_SampleAxis(const COMPASS_RAW_SAMPLE *pSample, U_BYTE nAxis);
+static INT16 Compass_TemperatureDrift(void);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
-static TIME_RT tCompassGapTimer;
+// indexed by the COMPASS_xxx manufacturer number
+static const COMPASS_PROFILE m_CompassProfiles[NUM_COMPASS_TYPES] =
+{
+	// COMPASS_UNKNOWN
+	{ NULL, BAUD_RATE_9600, NULL, NULL, 0.0f, 0.0f, 0.0f },
+	// COMPASS_VECTORNAV
+	{ "$VNRRG,8*XX\r", BAUD_RATE_57600, Compass_FrameVectorNav, Compass_DecodeVectorNav, 0.0f, 0.0f, 0.0f },
+	// COMPASS_APS544
+	{ "0SD\r", BAUD_RATE_9600, Compass_FrameAPS544, Compass_DecodeAPS544, 0.0f, 180.0f, 90.0f },
+	// COMPASS_TENFOOT
+	{ "L", BAUD_RATE_9600, Compass_FrameTenfoot, Compass_DecodeTenfoot, 0.0f, 0.0f, 0.0f },
+};
+
+// powers of ten for the number parser
+static const REAL32 m_fPowersOfTen[COMPASS_MAX_DIGITS + 1] =
+{
+	1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f, 100000.0f, 1000000.0f,
+	10000000.0f, 100000000.0f, 1000000000.0f
+};
+
 // State of compass
 static COMPASS_STATE m_nCompassStateMachine;
+// Manufacturer being talked to, or probed
+static U_BYTE m_nCompassType;
 // Data received from UART
 static U_BYTE m_nCompassReceiveBuffer[COMPASS_RECEIVE_BUFFER_SIZE];
 // Index of compass receive buffer
 static U_INT16 m_nCompassRxCount;
+// Index of the line being received
+static U_INT16 m_nCompassLineStart;
+// Set when the buffer holds a complete, checked frame
+static BOOL m_bCompassFrameReady;
+// when the frame waiting in the receive buffer had arrived
+static TIME_RT m_tCompassFrameTime;
+// Set while looking for the frame boundary after a bad frame
+static BOOL m_bCompassResync;
+// Receive statistics
+static U_INT32 m_nCompassFrames;
+static U_INT32 m_nCompassChecksumErrors;
+static U_INT32 m_nCompassOverruns;
+// passes of the state machine held back for room to send a request
+static U_INT32 m_nCompassTxWaits;
+// Survey requests sent without an answer
+static U_BYTE m_nCompassMissedReplies;
 // Struct to hold compass data
 static SURVEY_DATA_STRUCT m_CompassSurveyData;
 // Timer between surveys
 static TIME_RT m_tSurveyInterval;
-// Command to get Azimuth, Pitch, and Roll
-#define REQUEST_STRING_LENGTH 20
-#if COMPASS_MANUFACTURER == COMPASS_VECTORNAV
-	static U_BYTE requestString[REQUEST_STRING_LENGTH] = "$VNRRG,8*XX\r";
-#elif COMPASS_MANUFACTURER == COMPASS_APS544
-	static U_BYTE requestString[REQUEST_STRING_LENGTH] = "0SD\r";
-#elif COMPASS_MANUFACTURER == COMPASS_TENFOOT
-	static U_BYTE requestString[REQUEST_STRING_LENGTH] = "L";
-#endif
 // flag to see if an rx is seen after the tx
 static BOOL m_bCompassRx;
+// Raw samples, oldest overwritten first
+static COMPASS_RAW_SAMPLE m_CompassSamples[COMPASS_SAMPLE_RING_SIZE];
+// Where the next sample goes, and how many are held
+static U_BYTE m_nCompassSampleHead;
+static U_BYTE m_nCompassSampleCount;
+// mS between requests when streaming, 0 to ask again as soon as answered
+static U_INT16 m_nCompassStreamInterval;
+// mS the tool must be still before a survey is latched
+static TIME_RT m_tCompassStillWindow = COMPASS_STILL_WINDOW;
+// Set while the tool is still, cleared when it moves
+static BOOL m_bCompassStill;
+// Best survey of the latest still period
+static COMPASS_BEST_SURVEY m_CompassBestSurvey;
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -118,20 +285,196 @@ void Compass_Initialize(void)
 	}
 	//EnableCompassPower(TRUE);
 	m_nCompassStateMachine = COMPASS_INIT;
+	m_nCompassType = COMPASS_UNKNOWN;
 	Compass_ClearReceiveBuffer();
 }
 
 /*******************************************************************************
 *       @details
+*   Frames a span of bytes straight from the UART receive DMA buffer, tStamp
+*   is when the last of them had arrived.
+*******************************************************************************/
+void Compass_ServiceRxData(const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp)
+{
+	const COMPASS_PROFILE *pProfile = &m_CompassProfiles[m_nCompassType];
+
+	if(pProfile->pfFrame == NULL)
+	{
+		return;
+	}
+	while(nLength--)
+	{
+		// the previous frame has not been processed yet
+		if(m_bCompassFrameReady)
+		{
+			m_nCompassOverruns++;
+			continue;
+		}
+		m_bCompassFrameReady = pProfile->pfFrame(*pData++);
+		if(m_bCompassFrameReady)
+		{
+			m_tCompassFrameTime = tStamp;
+		}
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Drops a frame part way through after the UART lost some of the bytes
+*   received.  A whole frame waiting to be processed is kept.
+*******************************************************************************/
+void Compass_ResyncRx(void)
+{
+	if(!m_bCompassFrameReady)
+	{
+		Compass_ClearBuffer();
+		m_bCompassResync = FALSE;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Binary, fixed length, no start character.  The frame is complete when
+*   its checksum byte arrives.
+*******************************************************************************/
+static BOOL Compass_FrameTenfoot(U_BYTE nData)
+{
+	U_BYTE nSum = 0;
+	U_INT16 index;
+
+	m_nCompassReceiveBuffer[m_nCompassRxCount++] = nData;
+	if(m_nCompassRxCount < TENFOOT_FRAME_LENGTH)
+	{
+		return FALSE;
+	}
+	for(index = 0; index < (TENFOOT_FRAME_LENGTH - 1); index++)
+	{
+		nSum += m_nCompassReceiveBuffer[index];
+	}
+	if(nSum == m_nCompassReceiveBuffer[TENFOOT_FRAME_LENGTH - 1])
+	{
+		m_bCompassResync = FALSE;
+		return TRUE;
+	}
+	// count the bad frame once, then slide a byte at a time until the
+	// frame boundary is found again
+	if(!m_bCompassResync)
+	{
+		m_nCompassChecksumErrors++;
+		m_bCompassResync = TRUE;
+	}
+	memmove(m_nCompassReceiveBuffer, &m_nCompassReceiveBuffer[1], TENFOOT_FRAME_LENGTH - 1);
+	m_nCompassRxCount = TENFOOT_FRAME_LENGTH - 1;
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   $VNRRG,08,+022.167,+000.754,+000.291*5E<cr><lf>
+*   A '$' always starts a new sentence, anything before it is dropped.  The
+*   checksum is the XOR of the characters between '$' and '*', sent as two
+*   hex digits.
 *******************************************************************************/
-void Compass_ServiceRxData(U_BYTE nData)
+static BOOL Compass_FrameVectorNav(U_BYTE nData)
 {
+	U_BYTE nSum = 0;
+	U_BYTE nSent = 0;
+	U_INT16 index;
+	U_INT16 nDigit;
+
+	if(nData == '$')
+	{
+		m_nCompassRxCount = 0;
+	}
+	else if(m_nCompassRxCount == 0)
+	{
+		return FALSE;
+	}
+	if(m_nCompassRxCount >= (COMPASS_RECEIVE_BUFFER_SIZE - 1))
+	{
+		m_nCompassOverruns++;
+		m_nCompassRxCount = 0;
+		return FALSE;
+	}
 	m_nCompassReceiveBuffer[m_nCompassRxCount++] = nData;
-	if(m_nCompassRxCount >= COMPASS_RECEIVE_BUFFER_SIZE)
+	if(nData != '\n')
+	{
+		return FALSE;
+	}
+	m_nCompassReceiveBuffer[m_nCompassRxCount] = 0;
+	for(index = 1; (index < m_nCompassRxCount) && (m_nCompassReceiveBuffer[index] != '*'); index++)
+	{
+		nSum ^= m_nCompassReceiveBuffer[index];
+	}
+	for(nDigit = index + 1; nDigit < (index + 3); nDigit++)
 	{
+		nData = m_nCompassReceiveBuffer[nDigit];
+		nSent <<= 4;
+		if((nData >= '0') && (nData <= '9'))
+		{
+			nSent |= (U_BYTE)(nData - '0');
+		}
+		else if((nData >= 'A') && (nData <= 'F'))
+		{
+			nSent |= (U_BYTE)(nData - 'A' + 10);
+		}
+		else if((nData >= 'a') && (nData <= 'f'))
+		{
+			nSent |= (U_BYTE)(nData - 'a' + 10);
+		}
+		else
+		{
+			// no '*', or not followed by two hex digits
+			nSent = (U_BYTE)~nSum;
+			break;
+		}
+	}
+	if(nSent == nSum)
+	{
+		return TRUE;
+	}
+	m_nCompassChecksumErrors++;
+	m_nCompassRxCount = 0;
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   Four lines, ROLL: first and TEMP: last, no checksum.
+*******************************************************************************/
+static BOOL Compass_FrameAPS544(U_BYTE nData)
+{
+	U_BYTE *pLine;
+
+	if(m_nCompassRxCount >= (COMPASS_RECEIVE_BUFFER_SIZE - 1))
+	{
+		m_nCompassOverruns++;
 		m_nCompassRxCount = 0;
+		m_nCompassLineStart = 0;
+		return FALSE;
 	}
-	tCompassGapTimer = ElapsedTimeLowRes((TIME_RT)0);
+	m_nCompassReceiveBuffer[m_nCompassRxCount++] = nData;
+	if((nData != '\r') && (nData != '\n'))
+	{
+		return FALSE;
+	}
+	m_nCompassReceiveBuffer[m_nCompassRxCount] = 0;
+	pLine = &m_nCompassReceiveBuffer[m_nCompassLineStart];
+	while((*pLine == ' ') || (*pLine == '\t') || (*pLine == '\r') || (*pLine == '\n'))
+	{
+		pLine++;
+	}
+	m_nCompassLineStart = m_nCompassRxCount;
+	if(strncmp((char const *)pLine, "ROLL", 4) == 0)
+	{
+		// the block starts here, drop anything before it
+		m_nCompassRxCount -= (U_INT16)(pLine - m_nCompassReceiveBuffer);
+		memmove(m_nCompassReceiveBuffer, pLine, m_nCompassRxCount + 1);
+		m_nCompassLineStart = m_nCompassRxCount;
+		return FALSE;
+	}
+	return (BOOL)((strncmp((char const *)pLine, "TEMP", 4) == 0) &&
+	              (strncmp((char const *)m_nCompassReceiveBuffer, "ROLL", 4) == 0));
 }
 
 /*******************************************************************************
@@ -140,6 +483,8 @@ void Compass_ServiceRxData(U_BYTE nData)
 static void Compass_ClearBuffer(void)
 {
 	m_nCompassRxCount = 0;
+	m_nCompassLineStart = 0;
+	m_bCompassFrameReady = FALSE;
 }
 
 /*******************************************************************************
@@ -147,204 +492,337 @@ static void Compass_ClearBuffer(void)
 *******************************************************************************/
 void Compass_ProcessRxData(void)
 {
-//	char *pstr;
-//	char nMessage[100];
-	U_INT16 index;
-	REAL32 azimuth, pitch, roll, temperature;
-#if COMPASS_MANUFACTURER == COMPASS_TENFOOT
-	REAL32 TF_Hx, TF_Hy, TF_Hz; // in nT
-	REAL32 TF_Gx, TF_Gy, TF_Gz; // in mg
-	REAL32 TF_Temperature;
-//	REAL32 TF_Voltage;
-	U_BYTE checksum1;
-	U_BYTE checksum2;
-	REAL32 TF_y;
-	REAL32 TF_x;
-	REAL32 TF_Gradial; // magnitude in x and y
-	REAL32 TF_Gmagnitude;
-	REAL32 TF_Hmagnitude;
-	REAL32 TF_MagneticToolface;
-	REAL32 TF_Inclination;
-	REAL32 TF_Toolface;
-	REAL32 TF_Azimuth;
-	REAL32 TF_Dip;
-#endif
+	const COMPASS_PROFILE *pProfile = &m_CompassProfiles[m_nCompassType];
+	COMPASS_READING reading;
 
-	// only process if there are characters
-	if(m_nCompassRxCount == 0)
-		return;
-#if COMPASS_MANUFACTURER == COMPASS_VECTORNAV
-	// and some time has passed..
-	if(ElapsedTimeLowRes(tCompassGapTimer) < 10)
+	// only process once Compass_ServiceRxData() has a whole frame
+	if(!m_bCompassFrameReady)
 		return;
-	// the VectorNav answer will by typically..
-	// $VNRRG,08,+022.167,+000.754,+000.291*5E<cr><lf>
-	// we have a message, process it
-	// should have 41 or so characters
-	if(m_nCompassRxCount<30)
-		goto Compass_ProcessRxData_Fault;
-	if(m_nCompassRxCount>80)
-		goto Compass_ProcessRxData_Fault;
-	if(m_nCompassReceiveBuffer[0]!='$')
-		goto Compass_ProcessRxData_Fault;
-	// get past the second comma
-	strncpy(nMessage, (char const *)m_nCompassReceiveBuffer, 60);
-	if(strncmp(nMessage, "$VNRRG,08,", 10))
-		goto Compass_ProcessRxData_Fault;
-	// we expect to get 3 values out of the string, and text must match
-	if(sscanf(nMessage, "$VNRRG,08,%f,%f,%f", &azimuth, &pitch, &roll)!=3)
-		goto Compass_ProcessRxData_Fault;
-	azimuth -= SHIFT_AZIMUTH;
-	roll -= SHIFT_ROLL;
-	pitch -= SHIFT_PITCH;
-	temperature = 0.0;
-#elif COMPASS_MANUFACTURER == COMPASS_APS544
-	// and some time has passed..
-	if(ElapsedTimeLowRes(tCompassGapTimer) < 200)
-		return;
-	// the APS 544 answer will by typically..
-	// 	ROLL: +35.17825 MAGROLL: +198.24032
-	// 	PITCH: +90.14559 MAG: +0.43326
-	// 	HEAD: +26.76792 GRAV: +1.00101
-	// 	TEMP: +28.026 DA: 55.893
-	// where ROLL is gravity roll (or toolface), PITCH is inclination, HEAD is Azimuth,
-	// MAGROLL is magnetic roll, MAG is the total magnetic field, GRAV is the total gravity
-	// field , and DA is the magnetic field dip angle
-	// we have a message, process it
-	// should have 125 or so characters
-	if(m_nCompassRxCount<100)
-		goto Compass_ProcessRxData_Fault;
-	if(m_nCompassRxCount>200)
-		goto Compass_ProcessRxData_Fault;
-	strncpy(nMessage, (char const *)m_nCompassReceiveBuffer, m_nCompassRxCount);
-	pstr = strstr(nMessage, "ROLL");
-	if(pstr)
-	{
-		result = pstr - nMessage;
-		memmove(nMessage, nMessage+result, strlen(nMessage)-result);
+	if(pProfile->pfDecode(&reading))
+	{
+		Compass_StoreSurvey(&reading, &m_CompassSurveyData);
+		m_nCompassFrames++;
+		m_bCompassRx = TRUE;
 	}
-	else
-		goto Compass_ProcessRxData_Fault;
-	// we expect to get 4 values out of the string, and text must match
-	result = sscanf(nMessage, "ROLL:%f", &roll);
-	if(result!=1)
+	// clear the buffer
+	Compass_ClearBuffer();
+}
+
+/*******************************************************************************
+*       @details
+*   Applies the manufacturer's shifts and keeps the reading as a survey.
+*******************************************************************************/
+static void Compass_StoreSurvey(COMPASS_READING *pReading, SURVEY_DATA_STRUCT *pSurvey)
+{
+	const COMPASS_PROFILE *pProfile = &m_CompassProfiles[m_nCompassType];
+
+	pReading->fAzimuth -= pProfile->fShiftAzimuth;
+	pReading->fRoll -= pProfile->fShiftRoll;
+	pReading->fPitch -= pProfile->fShiftPitch;
+	pSurvey->nAzimuth = (U_INT16)(10.0f * pReading->fAzimuth);
+	pSurvey->nPitch = (U_INT16)(10.0f * pReading->fPitch);
+	pSurvey->nRoll = (U_INT16)(10.0f * pReading->fRoll);
+	pSurvey->nTemperature = (U_INT16)(10.0f * pReading->fTemperature);
+	pSurvey->metrics.nGtotal = (U_INT16)(pReading->fGtotal + 0.5f);
+	pSurvey->metrics.nHtotal = (U_INT16)((pReading->fHtotal / 10.0f) + 0.5f);
+	pSurvey->metrics.nDip = (INT16)(10.0f * pReading->fDip);
+	pSurvey->metrics.nTemperatureDrift = Compass_TemperatureDrift();
+	pSurvey->metrics.nSamples = pReading->nSamples;
+	pSurvey->metrics.nGtotalStd = (U_INT16)((10.0f * pReading->fGtotalStd) + 0.5f);
+	pSurvey->metrics.nHtotalStd = (U_INT16)(pReading->fHtotalStd + 0.5f);
+	pSurvey->isValid = TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Reads a decimal number ([+-]digits[.digits]) in place, leading spaces
+*   allowed, and moves the text pointer past it.  Digits past the precision
+*   of a REAL32 are skipped.
+*******************************************************************************/
+static BOOL Compass_ParseReal(const char **ppText, REAL32 *pfValue)
+{
+	const char *pText = *ppText;
+	U_INT32 nMantissa = 0;
+	U_BYTE nDigits = 0;
+	U_BYTE nDecimals = 0;
+	BOOL bNegative = FALSE;
+	BOOL bFraction = FALSE;
+	BOOL bAnyDigit = FALSE;
+
+	while(*pText == ' ')
 	{
-		goto Compass_ProcessRxData_Fault;
+		pText++;
 	}
-	pstr = strstr(nMessage, "PITCH");
-	if(pstr)
+	if((*pText == '-') || (*pText == '+'))
 	{
-		result = pstr - nMessage;
-		memmove(nMessage, nMessage+result, strlen(nMessage)-result);
+		bNegative = (BOOL)(*pText == '-');
+		pText++;
 	}
-	else
-		goto Compass_ProcessRxData_Fault;
-	result = sscanf(nMessage, "PITCH:%f", &pitch);
-	if(result!=1)
+	for( ; ; pText++)
+	{
+		if((*pText == '.') && !bFraction)
+		{
+			bFraction = TRUE;
+		}
+		else if((*pText >= '0') && (*pText <= '9'))
+		{
+			bAnyDigit = TRUE;
+			if(nDigits < COMPASS_MAX_DIGITS)
+			{
+				nMantissa = (nMantissa * 10) + (U_INT32)(*pText - '0');
+				if(nMantissa != 0)
+				{
+					nDigits++;
+				}
+				if(bFraction)
+				{
+					nDecimals++;
+				}
+			}
+			else if(!bFraction)
+			{
+				// integer part too long to be an angle or a temperature
+				return FALSE;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+	if(!bAnyDigit || (nDecimals > COMPASS_MAX_DIGITS))
 	{
-		goto Compass_ProcessRxData_Fault;
+		return FALSE;
 	}
-	pstr = strstr(nMessage, "HEAD");
-	if(pstr)
+	*pfValue = (REAL32)nMantissa / m_fPowersOfTen[nDecimals];
+	if(bNegative)
 	{
-		result = pstr - nMessage;
-		memmove(nMessage, nMessage+result, strlen(nMessage)-result);
+		*pfValue = -*pfValue;
+	}
+	*ppText = pText;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Finds "LABEL:" at the start of a word in the receive buffer and reads
+*   the number after it.
+*******************************************************************************/
+static BOOL Compass_ParseField(const char *pszLabel, REAL32 *pfValue)
+{
+	const char *pText = (const char *)m_nCompassReceiveBuffer;
+	U_INT16 nLength = (U_INT16)strlen(pszLabel);
+
+	while((pText = strstr(pText, pszLabel)) != NULL)
+	{
+		if(((pText == (const char *)m_nCompassReceiveBuffer) || (pText[-1] == ' ') ||
+		    (pText[-1] == '\t') || (pText[-1] == '\r') || (pText[-1] == '\n')) &&
+		   (pText[nLength] == ':'))
+		{
+			pText += nLength + 1;
+			return Compass_ParseReal(&pText, pfValue);
+		}
+		pText += nLength;
+	}
+	return FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   $VNRRG,08,+022.167,+000.754,+000.291*5E<cr><lf>
+*   yaw, pitch and roll, the framer has checked the sentence checksum.
+*******************************************************************************/
+static BOOL Compass_DecodeVectorNav(COMPASS_READING *pReading)
+{
+	const char *pText = (const char *)m_nCompassReceiveBuffer;
+
+	if(strncmp(pText, "$VNRRG,08,", 10) != 0)
+	{
+		return FALSE;
+	}
+	pText += 10;
+	if(!Compass_ParseReal(&pText, &pReading->fAzimuth) || (*pText++ != ','))
+	{
+		return FALSE;
+	}
+	if(!Compass_ParseReal(&pText, &pReading->fPitch) || (*pText++ != ','))
+	{
+		return FALSE;
+	}
+	if(!Compass_ParseReal(&pText, &pReading->fRoll) || (*pText != '*'))
+	{
+		return FALSE;
+	}
+	pReading->fTemperature = 0.0f;
+	// no field totals in this sentence
+	pReading->fGtotal = 0.0f;
+	pReading->fHtotal = 0.0f;
+	pReading->fDip = 0.0f;
+	pReading->fGtotalStd = 0.0f;
+	pReading->fHtotalStd = 0.0f;
+	pReading->nSamples = 1;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   The APS 544 answer will by typically..
+*   	ROLL: +35.17825 MAGROLL: +198.24032
+*   	PITCH: +90.14559 MAG: +0.43326
+*   	HEAD: +26.76792 GRAV: +1.00101
+*   	TEMP: +28.026 DA: 55.893
+*   where ROLL is gravity roll (or toolface), PITCH is inclination, HEAD is
+*   Azimuth, MAGROLL is magnetic roll, MAG is the total magnetic field, GRAV
+*   is the total gravity field, and DA is the magnetic field dip angle.
+*******************************************************************************/
+static BOOL Compass_DecodeAPS544(COMPASS_READING *pReading)
+{
+	if(!(Compass_ParseField("ROLL", &pReading->fRoll) &&
+	     Compass_ParseField("PITCH", &pReading->fPitch) &&
+	     Compass_ParseField("HEAD", &pReading->fAzimuth) &&
+	     Compass_ParseField("TEMP", &pReading->fTemperature)))
+	{
+		return FALSE;
+	}
+	// the totals are extra, older firmware leaves them out
+	if(Compass_ParseField("MAG", &pReading->fHtotal))
+	{
+		// gauss to nT
+		pReading->fHtotal *= 100000.0f;
 	}
 	else
-		goto Compass_ProcessRxData_Fault;
-	result = sscanf(nMessage, "HEAD:%f", &azimuth);
-	if(result!=1)
 	{
-		goto Compass_ProcessRxData_Fault;
+		pReading->fHtotal = 0.0f;
 	}
-	pstr = strstr(nMessage, "T:");
-	if(pstr)
+	if(Compass_ParseField("GRAV", &pReading->fGtotal))
 	{
-		result = pstr - nMessage;
-		memmove(nMessage, nMessage+result, strlen(nMessage)-result);
+		// G to mG
+		pReading->fGtotal *= 1000.0f;
 	}
 	else
-		goto Compass_ProcessRxData_Fault;
-	result = sscanf(nMessage, "T:%f", &temperature);
-	if(result!=1)
-	{
-		goto Compass_ProcessRxData_Fault;
-	}
-	azimuth -= SHIFT_AZIMUTH;
-	roll -= SHIFT_ROLL;
-	pitch -= SHIFT_PITCH;
-#elif COMPASS_MANUFACTURER == COMPASS_TENFOOT
-	// and some time has passed.. tenfoot responds in 400mS
-	if(ElapsedTimeLowRes(tCompassGapTimer) < 10)
-		return;
-	// the Tensteer answer will by typically..
-	// 	L Hx Hy Hz Gx Gy Gz T WV
-	//  where sensor values are 4 bytes, signed, >>12 bits??
-	// 	T is in degrees C
-	// 	WV is in volts
-	// there is a checksum??
-	// should have 33 bytes
-	if(m_nCompassRxCount < 30)
-		goto Compass_ProcessRxData_Fault;
-	if(m_nCompassRxCount > 36)
-		goto Compass_ProcessRxData_Fault;
+	{
+		pReading->fGtotal = 0.0f;
+	}
+	if(!Compass_ParseField("DA", &pReading->fDip))
+	{
+		pReading->fDip = 0.0f;
+	}
+	pReading->fGtotalStd = 0.0f;
+	pReading->fHtotalStd = 0.0f;
+	pReading->nSamples = 1;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   The Tensteer answer will by typically..
+*   	L Hx Hy Hz Gx Gy Gz T WV
+*   where sensor values are 4 bytes, signed, scaled by 4096, T is in degrees
+*   C and WV is in volts, followed by a one byte sum checked by the framer.
+*   The raw values go into the sample ring before they are turned into
+*   angles.
+*******************************************************************************/
+static BOOL Compass_DecodeTenfoot(COMPASS_READING *pReading)
+{
+	COMPASS_RAW_SAMPLE *pSample;
+	COMPASS_VECTORS vectors;
+	U_INT16 index;
+
+	pSample = &m_CompassSamples[m_nCompassSampleHead];
+	pSample->tTime = m_tCompassFrameTime;
 	index = 0;
-	// first character should be 'L'
-//	if(m_nCompassReceiveBuffer[index++] != 'L')
-//		goto Compass_ProcessRxData_Fault;
-	// we expect to get 8 values out of the message
 	// mag readings are in nT
-	TF_Hx = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
+	pSample->nHx = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
 	index+=4;
-	TF_Hy = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
+	pSample->nHy = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
 	index+=4;
-	TF_Hz = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
+	pSample->nHz = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
 	index+=4;
 	// the gravity Z axis is along the coaxial center line
 	// with connectors pointed to the sky,
 	// the Y axis points to the center of the earth with a -1000
 	// gravity is in mG, or 1000 is one earth gravity
-	TF_Gx = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
+	pSample->nGx = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
 	index+=4;
-	TF_Gy = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
+	pSample->nGy = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
 	index+=4;
-	TF_Gz = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
+	pSample->nGz = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
 	index+=4;
 	// temp is in deg C
-	TF_Temperature = GetTenfoot32(&m_nCompassReceiveBuffer[index]) / 4096.0;
-	index+=4;
-	// skip 4 for volts, dunt work anyhow
-	index+=4;
-	checksum1 = m_nCompassReceiveBuffer[index];
-	checksum2 = 0;
-	// checksum, skip the first char, up to check
-	for(index=0; index<(m_nCompassRxCount-1); index++)
+	pSample->nTemperature = GetTenfoot32(&m_nCompassReceiveBuffer[index]);
+	// skip the volts, dunt work anyhow
+	m_nCompassSampleHead = (m_nCompassSampleHead + 1) % COMPASS_SAMPLE_RING_SIZE;
+	if(m_nCompassSampleCount < COMPASS_SAMPLE_RING_SIZE)
 	{
-		checksum2 += m_nCompassReceiveBuffer[index];
+		m_nCompassSampleCount++;
 	}
-	if(checksum1 != checksum2)
-		goto Compass_ProcessRxData_Fault;
+	// the calibration is fitted to the raw field
+	if(CompassCal_GetState() == COMPASS_CAL_COLLECTING)
+	{
+		(void)CompassCal_AddSample((REAL32)(pSample->nHx / TENFOOT_SCALE),
+		                           (REAL32)(pSample->nHy / TENFOOT_SCALE),
+		                           (REAL32)(pSample->nHz / TENFOOT_SCALE));
+	}
+	Compass_CheckStationary();
+	vectors.fHx = pSample->nHx / TENFOOT_SCALE;
+	vectors.fHy = pSample->nHy / TENFOOT_SCALE;
+	vectors.fHz = pSample->nHz / TENFOOT_SCALE;
+	vectors.fGx = pSample->nGx / TENFOOT_SCALE;
+	vectors.fGy = pSample->nGy / TENFOOT_SCALE;
+	vectors.fGz = pSample->nGz / TENFOOT_SCALE;
+	vectors.fTemperature = pSample->nTemperature / TENFOOT_SCALE;
+	Compass_SolveTenfoot(&vectors, pReading);
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Azimuth, inclination and toolface from the magnetic and gravity vectors.
+*******************************************************************************/
+static void Compass_SolveTenfoot(const COMPASS_VECTORS *pVectors, COMPASS_READING *pReading)
+{
+	COMPASS_REAL TF_Hx, TF_Hy, TF_Hz; // in nT
+	COMPASS_REAL TF_Gx, TF_Gy, TF_Gz; // in mg
+	COMPASS_REAL TF_y;
+	COMPASS_REAL TF_x;
+	COMPASS_REAL TF_Gradial; // magnitude in x and y
+	COMPASS_REAL TF_Gmagnitude;
+	COMPASS_REAL TF_Hmagnitude;
+	COMPASS_REAL TF_MagneticToolface;
+	COMPASS_REAL TF_Inclination;
+	COMPASS_REAL TF_Toolface;
+	COMPASS_REAL TF_Azimuth;
+	COMPASS_REAL TF_Dip;
+	COMPASS_REAL TF_Field[3];
+
+	Compass_CorrectField(pVectors, TF_Field);
+	TF_Hx = TF_Field[0];
+	TF_Hy = TF_Field[1];
+	TF_Hz = TF_Field[2];
+	TF_Gx = pVectors->fGx;
+	TF_Gy = pVectors->fGy;
+	TF_Gz = pVectors->fGz;
 	// a bunch of stuff here to get the data..
 	// gravity radial (based on x and y)
 	//  G radial = sqrt(GX^2 + GY^2)
-	TF_Gradial = sqrt(TF_Gx*TF_Gx + TF_Gy*TF_Gy);
+	TF_Gradial = COMPASS_SQRT(TF_Gx*TF_Gx + TF_Gy*TF_Gy);
 	// gravity total magnitude (based on x, y and z)
 	//  G magnitude = sqrt(TF_Gx^2 + TF_Gy^2 + TF_Gz^2)
-	TF_Gmagnitude = sqrt(TF_Gx*TF_Gx + TF_Gy*TF_Gy + TF_Gz*TF_Gz);
+	TF_Gmagnitude = COMPASS_SQRT(TF_Gx*TF_Gx + TF_Gy*TF_Gy + TF_Gz*TF_Gz);
 	// inclination (pitch) in degrees:
 	//  INC = atan2(TF_Gz, TF_Gradial)
-	TF_Inclination = -1*(180.0 * atan2(TF_Gz, TF_Gradial) / M_PI); // in degrees
+	TF_Inclination = -(RADIANS_TO_DEGREES * COMPASS_ATAN2(TF_Gz, TF_Gradial)); // in degrees
 	// nah, try the APS method..
 //	TF_Inclination = 180.0 * acos(TF_Gx / TF_Gmagnitude) / M_PI; // in degrees
 	// highside degrees:
 	//  HS = arctan2(TF_Gx,-TF_Gy)
 	//  HS = HS - TF_OFFSET
 	//  bound the HS
-	TF_Toolface = 360.0 - (180.0 * atan2(TF_Gx,-TF_Gy) / M_PI); // in degrees
+	TF_Toolface = COMPASS_CONST(360.0) - (RADIANS_TO_DEGREES * COMPASS_ATAN2(TF_Gx,-TF_Gy)); // in degrees
 	// nah, try the APS method..
 //	TF_Toolface = 180.0 * atan2(TF_Gy, TF_Gz) / M_PI; // in degrees
 	// H_TOTAL = sqrt(TF_Hx^2 + TF_Hy^2 + TF_Hz^2)
-	TF_Hmagnitude = sqrt(TF_Hx*TF_Hx + TF_Hy*TF_Hy + TF_Hz*TF_Hz);
+	TF_Hmagnitude = COMPASS_SQRT(TF_Hx*TF_Hx + TF_Hy*TF_Hy + TF_Hz*TF_Hz);
 	// Azimuth degrees:
 	//  x = TF_Hx*TF_Gx*TF_Gz + TF_Hy*TF_Gy*TF_Gz + TF_Hz*(TF_Gradial^2)
 	TF_x = (TF_Hx * TF_Gx * TF_Gz) + (TF_Hy * TF_Gy * TF_Gz) + (TF_Hz * TF_Gradial * TF_Gradial);
@@ -352,23 +830,23 @@ void Compass_ProcessRxData(void)
 	TF_y = ( (TF_Hx * TF_Gy) - (TF_Hy * TF_Gx) ) * TF_Gmagnitude;
 	//  AZ = arctan2(TF_x, TF_y)
 	//TF_Azimuth = 360.0 - (180.0 * atan2(TF_x, TF_y) / M_PI); // in degrees
-	TF_Azimuth = (180*atan2(TF_y, TF_x))/M_PI;
+	TF_Azimuth = RADIANS_TO_DEGREES * COMPASS_ATAN2(TF_y, TF_x);
         //  AZ += DEC
 	// bound AZ
 	// DIP degrees:
 	//  y = (-Hx*Gx - Hy*Gy + Hz*Gz) / Gtotal
 	TF_y = (-(TF_Hx * TF_Gx) - (TF_Hy * TF_Gy) + (TF_Hz * TF_Gz) ) / TF_Gmagnitude;
 	//  x = sqrt(Htotal^2 - y^2)
-	TF_x = sqrt( (TF_Hmagnitude * TF_Hmagnitude) - (TF_y * TF_y) );
+	TF_x = COMPASS_SQRT( (TF_Hmagnitude * TF_Hmagnitude) - (TF_y * TF_y) );
 	//  if x=0, DIP = 90*sgn(y)
 	if(TF_x == 0)
 	{
-		TF_Dip = 180.0 * sin(TF_y) / M_PI; // in degrees
+		TF_Dip = RADIANS_TO_DEGREES * COMPASS_SIN(TF_y); // in degrees
 	}
 	else
 	{
 		//  else DIP = 180/( Pi * arctan(y/x) )
-		TF_Dip = 180.0 * atan2(TF_y, TF_x) / M_PI; // in degrees
+		TF_Dip = RADIANS_TO_DEGREES * COMPASS_ATAN2(TF_y, TF_x); // in degrees
 	}
 	// MTF degrees:
 	//  if INC > 10, MTF = HS + AZ
@@ -378,7 +856,7 @@ void Compass_ProcessRxData(void)
 	//   MTF = arctan2(TF_x, -TF_y)
 	// MTF = MTF - TF_OFFSET + DEC
 	// bound MTF
-	if(TF_Inclination > 10.0)
+	if(TF_Inclination > COMPASS_CONST(10.0))
 	{
 		TF_MagneticToolface = TF_Inclination + TF_Azimuth; // in degrees
 	}
@@ -386,28 +864,49 @@ void Compass_ProcessRxData(void)
 	{
 		TF_x = TF_Gmagnitude*TF_Hx + TF_Gx*TF_Hz;
 		TF_y = TF_Gmagnitude*TF_Hy + TF_Gy*TF_Hz;
-		TF_MagneticToolface = 180.0 * atan2( TF_x, -TF_y ) / M_PI; // in degrees
+		TF_MagneticToolface = RADIANS_TO_DEGREES * COMPASS_ATAN2( TF_x, -TF_y ); // in degrees
+	}
+	pReading->fAzimuth = TF_Azimuth;
+	pReading->fRoll = TF_Toolface;
+	pReading->fPitch = TF_Inclination;
+	pReading->fTemperature = pVectors->fTemperature / COMPASS_CONST(10.0);
+	pReading->fGtotal = TF_Gmagnitude;
+	pReading->fHtotal = TF_Hmagnitude;
+	pReading->fDip = TF_Dip;
+	pReading->fGtotalStd = 0.0f;
+	pReading->fHtotalStd = 0.0f;
+	pReading->nSamples = 1;
+}
+
+/*******************************************************************************
+*       @details
+*   The field with the hard and soft iron calibration in the NV block taken
+*   out, or as it came when the tool has not been calibrated.
+*******************************************************************************/
+static void Compass_CorrectField(const COMPASS_VECTORS *pVectors, COMPASS_REAL *pfField)
+{
+	REAL32 fOffset[3];
+	REAL32 fMatrix[9];
+	COMPASS_REAL fRaw[3];
+	U_BYTE nRow;
+
+	fRaw[0] = pVectors->fHx;
+	fRaw[1] = pVectors->fHy;
+	fRaw[2] = pVectors->fHz;
+	if(!GetMagCalibration(fOffset, fMatrix))
+	{
+		memcpy(pfField, fRaw, sizeof(fRaw));
+		return;
+	}
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		fRaw[nRow] -= fOffset[nRow];
+	}
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		pfField[nRow] = (fMatrix[(nRow * 3)] * fRaw[0]) + (fMatrix[(nRow * 3) + 1] * fRaw[1]) +
+		                (fMatrix[(nRow * 3) + 2] * fRaw[2]);
 	}
-	azimuth = TF_Azimuth - SHIFT_AZIMUTH;
-	roll = TF_Toolface - SHIFT_ROLL;
-	pitch = TF_Inclination - SHIFT_PITCH;
-//	pitch = TF_Pitch - SHIFT_PITCH;
-	temperature = TF_Temperature/10.0;
-#endif
-	m_CompassSurveyData.nAzimuth = (U_INT16)(10.0 * azimuth);
-	m_CompassSurveyData.nPitch = (U_INT16)(10.0 * pitch);
-	m_CompassSurveyData.nRoll = (U_INT16)(10.0 * roll);
-	m_CompassSurveyData.nTemperature = (U_INT16)(10.0 * temperature);
-	m_CompassSurveyData.isValid = TRUE;
-	// clear the buffer
-	Compass_ClearBuffer();
-	m_bCompassRx = TRUE;
-	return;
-Compass_ProcessRxData_Fault:
-//	m_CompassSurveyData.isValid = FALSE;
-	// clear the buffer
-	Compass_ClearBuffer();
-	return;
 }
 
 /*******************************************************************************
@@ -430,24 +929,98 @@ static INT32 GetTenfoot32(U_BYTE* packet)
     return value;
 }
 
+/*******************************************************************************
+*       @details
+*   Talk to one manufacturer: its baud rate and framing, from an empty
+*   buffer.
+*******************************************************************************/
+static void Compass_SelectType(U_BYTE nType)
+{
+	m_nCompassType = nType;
+	UART_SetBaudRate(CLIENT_COMPASS, m_CompassProfiles[nType].nBaudRate);
+	Compass_ClearReceiveBuffer();
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
+static void Compass_SendRequest(void)
+{
+	const char *pszRequest = m_CompassProfiles[m_nCompassType].pszRequest;
+
+	m_tSurveyInterval = ElapsedTimeLowRes(0);
+	// a reply starts after the request, drop any partial frame
+	if(!m_bCompassFrameReady)
+	{
+		Compass_ClearBuffer();
+		m_bCompassResync = FALSE;
+	}
+	// Compass_StateManager waited for the room
+	(void)UART_SendMessage(CLIENT_COMPASS, (const U_BYTE *)pszRequest, strlen(pszRequest));
+	m_bCompassRx = FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   The manufacturer saved in the NV block is asked first.  Without an
+*   answer each of the others is asked in turn, until one answers, and
+*   that one is saved.  A compass that stops answering is probed again.
+*******************************************************************************/
 void Compass_StateManager(void)
 {
+	// any state may send a request, and a refused one would be taken for
+	// a compass that did not answer, so wait for the queue to drain
+	if(UART_GetTxFree(CLIENT_COMPASS) < COMPASS_REQUEST_ROOM)
+	{
+		m_nCompassTxWaits++;
+		return;
+	}
 	switch(m_nCompassStateMachine)
 	{
 		case COMPASS_INIT:
-			m_nCompassStateMachine = COMPASS_CONNECTED;
-			m_tSurveyInterval = ElapsedTimeLowRes(0);
+			// NV values are loaded by now
+			if((GetCompassType() == COMPASS_UNKNOWN) || (GetCompassType() >= NUM_COMPASS_TYPES))
+			{
+				Compass_SelectType(COMPASS_TENFOOT);
+			}
+			else
+			{
+				Compass_SelectType(GetCompassType());
+			}
+			Compass_SendRequest();
+			m_nCompassStateMachine = COMPASS_DETECT;
+			break;
+		case COMPASS_DETECT:
+			if(m_bCompassRx == TRUE)
+			{
+				SetCompassType(m_nCompassType);
+				m_nCompassMissedReplies = 0;
+				m_nCompassStateMachine = COMPASS_CONNECTED;
+				Compass_SendRequest();
+			}
+			else if(ElapsedTimeLowRes(m_tSurveyInterval) >= COMPASS_DETECT_TIMEOUT)
+			{
+				Compass_SelectType((m_nCompassType % (NUM_COMPASS_TYPES - 1)) + 1);
+				Compass_SendRequest();
+			}
 			break;
 		case COMPASS_CONNECTED:
-			if( (ElapsedTimeLowRes(m_tSurveyInterval) >= 5000)//ONE_SECOND)
-			|| (m_bCompassRx == TRUE) )
+			if(m_bCompassRx == TRUE)
 			{
-				m_tSurveyInterval = ElapsedTimeLowRes(0);
-				UART_SendMessage(CLIENT_COMPASS, requestString, strlen((char const *)requestString));
-				m_bCompassRx = FALSE;
+				m_nCompassMissedReplies = 0;
+				if(ElapsedTimeLowRes(m_tSurveyInterval) >= m_nCompassStreamInterval)
+				{
+					Compass_SendRequest();
+				}
+			}
+			else if(ElapsedTimeLowRes(m_tSurveyInterval) >= COMPASS_SURVEY_INTERVAL)
+			{
+				if(++m_nCompassMissedReplies >= COMPASS_REDETECT_MISSES)
+				{
+					// start over with the one we had
+					m_nCompassStateMachine = COMPASS_DETECT;
+				}
+				Compass_SendRequest();
 			}
 			break;
 	}
@@ -499,6 +1072,459 @@ BOOL Compass_IsDataValid(void)
 static void Compass_ClearReceiveBuffer(void)
 {
 	memset(m_nCompassReceiveBuffer, 0, sizeof(m_nCompassReceiveBuffer));
-	m_nCompassRxCount = 0;
+	Compass_ClearBuffer();
+	m_bCompassResync = FALSE;
+}
+
+/*******************************************************************************
+*       @details
+*   0 asks again as soon as the compass answers, as it always has.
+*******************************************************************************/
+void Compass_SetStreamInterval(U_INT16 nInterval)
+{
+	if((nInterval != 0) && (nInterval < COMPASS_MIN_STREAM_INTERVAL))
+	{
+		nInterval = COMPASS_MIN_STREAM_INTERVAL;
+	}
+	else if(nInterval > COMPASS_SURVEY_INTERVAL)
+	{
+		nInterval = COMPASS_SURVEY_INTERVAL;
+	}
+	m_nCompassStreamInterval = nInterval;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 Compass_GetStreamInterval(void)
+{
+	return m_nCompassStreamInterval;
+}
+
+/*******************************************************************************
+*       @details
+*   One of the six vector components of a raw sample, 0 to 5 for Hx to Gz.
+*******************************************************************************/
+static REAL32 Compass_SampleAxis(const COMPASS_RAW_SAMPLE *pSample, U_BYTE nAxis)
+{
+	switch(nAxis)
+	{
+		case 0:
+			return (REAL32)pSample->nHx;
+		case 1:
+			return (REAL32)pSample->nHy;
+		case 2:
+			return (REAL32)pSample->nHz;
+		case 3:
+			return (REAL32)pSample->nGx;
+		case 4:
+			return (REAL32)pSample->nGy;
+		default:
+			return (REAL32)pSample->nGz;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The raw sample nAgo answers back, 0 for the newest.
+*******************************************************************************/
+static const COMPASS_RAW_SAMPLE *Compass_SampleAgo(U_BYTE nAgo)
+{
+	return &m_CompassSamples[(m_nCompassSampleHead + COMPASS_SAMPLE_RING_SIZE - 1 - nAgo) % COMPASS_SAMPLE_RING_SIZE];
+}
+
+/*******************************************************************************
+*       @details
+*   How many of the newest raw samples arrived in the last tWindow mS.
+*******************************************************************************/
+static U_BYTE Compass_SamplesInWindow(TIME_RT tWindow)
+{
+	U_BYTE nWindow;
+
+	for(nWindow = 0; nWindow < m_nCompassSampleCount; nWindow++)
+	{
+		if(ElapsedTimeLowRes(Compass_SampleAgo(nWindow)->tTime) > tWindow)
+		{
+			break;
+		}
+	}
+	return nWindow;
+}
+
+/*******************************************************************************
+*       @details
+*   Averages the newest nWindow raw samples into one reading.  The mean and
+*   spread of each axis is found first, then samples more than
+*   COMPASS_OUTLIER_SIGMA from the mean on any axis are dropped and the
+*   rest averaged again, with the spread of their total gravity and total
+*   field.  Returns the number of samples used.
+*******************************************************************************/
+static U_BYTE Compass_AverageSamples(U_BYTE nWindow, COMPASS_READING *pReading)
+{
+	const COMPASS_RAW_SAMPLE *pSample;
+	REAL32 fMean[6];
+	REAL32 fLimit[6];
+	REAL32 fSum[7];
+	REAL32 fValue;
+	REAL32 fStill[COMPASS_STILL_VALUES];
+	REAL32 fTotalRef[2];
+	REAL32 fTotalSum[2];
+	REAL32 fTotalSquares[2];
+	COMPASS_VECTORS vectors;
+	U_BYTE nUsed;
+	U_BYTE nSample;
+	U_BYTE nAxis;
+	BOOL bKeep;
+
+	if(nWindow == 0)
+	{
+		return 0;
+	}
+	// mean and spread of each axis
+	memset(fMean, 0, sizeof(fMean));
+	memset(fLimit, 0, sizeof(fLimit));
+	for(nSample = 0; nSample < nWindow; nSample++)
+	{
+		pSample = Compass_SampleAgo(nSample);
+		for(nAxis = 0; nAxis < 6; nAxis++)
+		{
+			fMean[nAxis] += Compass_SampleAxis(pSample, nAxis);
+		}
+	}
+	for(nAxis = 0; nAxis < 6; nAxis++)
+	{
+		fMean[nAxis] /= (REAL32)nWindow;
+	}
+	for(nSample = 0; nSample < nWindow; nSample++)
+	{
+		pSample = Compass_SampleAgo(nSample);
+		for(nAxis = 0; nAxis < 6; nAxis++)
+		{
+			fValue = Compass_SampleAxis(pSample, nAxis) - fMean[nAxis];
+			fLimit[nAxis] += fValue * fValue;
+		}
+	}
+	// compare squared distances, (k * sigma)^2 = k^2 * variance
+	for(nAxis = 0; nAxis < 6; nAxis++)
+	{
+		fLimit[nAxis] = (COMPASS_OUTLIER_SIGMA * COMPASS_OUTLIER_SIGMA) * fLimit[nAxis] / (REAL32)nWindow;
+	}
+	// average again without the outliers
+	memset(fSum, 0, sizeof(fSum));
+	memset(fTotalRef, 0, sizeof(fTotalRef));
+	memset(fTotalSum, 0, sizeof(fTotalSum));
+	memset(fTotalSquares, 0, sizeof(fTotalSquares));
+	nUsed = 0;
+	for(nSample = 0; nSample < nWindow; nSample++)
+	{
+		pSample = Compass_SampleAgo(nSample);
+		bKeep = TRUE;
+		for(nAxis = 0; nAxis < 6; nAxis++)
+		{
+			fValue = Compass_SampleAxis(pSample, nAxis) - fMean[nAxis];
+			if((fValue * fValue) > fLimit[nAxis])
+			{
+				bKeep = FALSE;
+				break;
+			}
+		}
+		if(bKeep)
+		{
+			for(nAxis = 0; nAxis < 6; nAxis++)
+			{
+				fSum[nAxis] += Compass_SampleAxis(pSample, nAxis);
+			}
+			fSum[6] += (REAL32)pSample->nTemperature;
+			// totals taken from the first sample kept, so the squares stay
+			// small enough for single precision
+			Compass_StillValues(pSample, fStill);
+			if(nUsed == 0)
+			{
+				fTotalRef[0] = fStill[3];
+				fTotalRef[1] = fStill[4];
+			}
+			for(nAxis = 0; nAxis < 2; nAxis++)
+			{
+				fValue = fStill[3 + nAxis] - fTotalRef[nAxis];
+				fTotalSum[nAxis] += fValue;
+				fTotalSquares[nAxis] += fValue * fValue;
+			}
+			nUsed++;
+		}
+	}
+	// fewer than 1 / COMPASS_OUTLIER_SIGMA^2 of the samples can be outliers
+	// on any one axis, so some are always left
+	if(nUsed == 0)
+	{
+		return 0;
+	}
+	vectors.fHx = fSum[0] / ((REAL32)nUsed * TENFOOT_SCALE);
+	vectors.fHy = fSum[1] / ((REAL32)nUsed * TENFOOT_SCALE);
+	vectors.fHz = fSum[2] / ((REAL32)nUsed * TENFOOT_SCALE);
+	vectors.fGx = fSum[3] / ((REAL32)nUsed * TENFOOT_SCALE);
+	vectors.fGy = fSum[4] / ((REAL32)nUsed * TENFOOT_SCALE);
+	vectors.fGz = fSum[5] / ((REAL32)nUsed * TENFOOT_SCALE);
+	vectors.fTemperature = fSum[6] / ((REAL32)nUsed * TENFOOT_SCALE);
+	Compass_SolveTenfoot(&vectors, pReading);
+	for(nAxis = 0; nAxis < 2; nAxis++)
+	{
+		fTotalSum[nAxis] /= (REAL32)nUsed;
+		fValue = (fTotalSquares[nAxis] / (REAL32)nUsed) - (fTotalSum[nAxis] * fTotalSum[nAxis]);
+		fTotalSquares[nAxis] = (fValue > 0.0f) ? sqrtf(fValue) : 0.0f;
+	}
+	pReading->fGtotalStd = fTotalSquares[0];
+	pReading->fHtotalStd = fTotalSquares[1];
+	pReading->nSamples = nUsed;
+	return nUsed;
+}
+
+/*******************************************************************************
+*       @details
+*   Replaces the survey with the average of the raw samples that arrived in
+*   the last tWindow mS.  Returns the number of samples used, 0 leaves the
+*   last survey as it was.
+*******************************************************************************/
+U_BYTE Compass_ReduceWindow(TIME_RT tWindow)
+{
+	COMPASS_READING reading;
+	U_BYTE nUsed;
+
+	nUsed = Compass_AverageSamples(Compass_SamplesInWindow(tWindow), &reading);
+	if(nUsed != 0)
+	{
+		Compass_StoreSurvey(&reading, &m_CompassSurveyData);
+	}
+	return nUsed;
+}
+
+/*******************************************************************************
+*       @details
+*   Looks at the raw samples of the still window after each new one.  The
+*   tool is still when the gravity vector, the total gravity and the total
+*   field barely vary over the whole window.  The first still window after
+*   the tool moves latches a survey, later ones in the same still period
+*   replace it only if their quality is as good or better.  Quality runs
+*   from 100 for no variation down to 0 at the still limits.
+*******************************************************************************/
+static void Compass_CheckStationary(void)
+{
+	static const REAL32 fLimit[COMPASS_STILL_ITEMS] =
+	{
+		COMPASS_STILL_G_VARIANCE,
+		COMPASS_STILL_GTOTAL_VARIANCE,
+		COMPASS_STILL_HTOTAL_VARIANCE
+	};
+	REAL32 fMean[COMPASS_STILL_VALUES];
+	REAL32 fValue[COMPASS_STILL_VALUES];
+	REAL32 fVariance[COMPASS_STILL_ITEMS];
+	REAL32 fWorst;
+	COMPASS_READING reading;
+	SURVEY_DATA_STRUCT survey;
+	U_BYTE nWindow;
+	U_BYTE nSample;
+	U_BYTE nItem;
+	U_BYTE nQuality;
+	U_BYTE nUsed;
+
+	nWindow = Compass_SamplesInWindow(m_tCompassStillWindow);
+	// the samples must reach back over the whole window, or fill the ring
+	if((nWindow < COMPASS_STILL_MIN_SAMPLES) ||
+	   ((nWindow == m_nCompassSampleCount) && (m_nCompassSampleCount < COMPASS_SAMPLE_RING_SIZE)))
+	{
+		m_bCompassStill = FALSE;
+		return;
+	}
+	memset(fMean, 0, sizeof(fMean));
+	memset(fVariance, 0, sizeof(fVariance));
+	for(nSample = 0; nSample < nWindow; nSample++)
+	{
+		Compass_StillValues(Compass_SampleAgo(nSample), fValue);
+		for(nItem = 0; nItem < COMPASS_STILL_VALUES; nItem++)
+		{
+			fMean[nItem] += fValue[nItem];
+		}
+	}
+	for(nItem = 0; nItem < COMPASS_STILL_VALUES; nItem++)
+	{
+		fMean[nItem] /= (REAL32)nWindow;
+	}
+	for(nSample = 0; nSample < nWindow; nSample++)
+	{
+		Compass_StillValues(Compass_SampleAgo(nSample), fValue);
+		for(nItem = 0; nItem < COMPASS_STILL_VALUES; nItem++)
+		{
+			fValue[nItem] -= fMean[nItem];
+			fValue[nItem] *= fValue[nItem];
+		}
+		// the three gravity axes count as one
+		fVariance[0] += fValue[0] + fValue[1] + fValue[2];
+		fVariance[1] += fValue[3];
+		fVariance[2] += fValue[4];
+	}
+	// the worst of the three, as a fraction of its limit
+	fWorst = 0.0f;
+	for(nItem = 0; nItem < COMPASS_STILL_ITEMS; nItem++)
+	{
+		fVariance[nItem] /= ((REAL32)nWindow * fLimit[nItem]);
+		if(fVariance[nItem] > fWorst)
+		{
+			fWorst = fVariance[nItem];
+		}
+	}
+	if(fWorst >= 1.0f)
+	{
+		m_bCompassStill = FALSE;
+		return;
+	}
+	// variance to rms, so the score falls off linearly with the noise
+	nQuality = (U_BYTE)(100.0f * (1.0f - sqrtf(fWorst)));
+	if(!m_bCompassStill || !m_CompassBestSurvey.isValid || (nQuality >= m_CompassBestSurvey.nQuality))
+	{
+		nUsed = Compass_AverageSamples(nWindow, &reading);
+		if(nUsed != 0)
+		{
+			Compass_StoreSurvey(&reading, &survey);
+			m_CompassBestSurvey.nAzimuth = survey.nAzimuth;
+			m_CompassBestSurvey.nPitch = survey.nPitch;
+			m_CompassBestSurvey.nRoll = survey.nRoll;
+			m_CompassBestSurvey.nTemperature = survey.nTemperature;
+			m_CompassBestSurvey.nQuality = nQuality;
+			m_CompassBestSurvey.nSamples = nUsed;
+			m_CompassBestSurvey.tLatched = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+			m_CompassBestSurvey.isValid = TRUE;
+		}
+	}
+	m_bCompassStill = TRUE;
 }
 
+/*******************************************************************************
+*       @details
+*   Gx, Gy, Gz and the total gravity in mG, and the total field in nT.
+*******************************************************************************/
+static void Compass_StillValues(const COMPASS_RAW_SAMPLE *pSample, REAL32 *pfValue)
+{
+	REAL32 fHx, fHy, fHz;
+
+	pfValue[0] = (REAL32)pSample->nGx / (REAL32)TENFOOT_SCALE;
+	pfValue[1] = (REAL32)pSample->nGy / (REAL32)TENFOOT_SCALE;
+	pfValue[2] = (REAL32)pSample->nGz / (REAL32)TENFOOT_SCALE;
+	pfValue[3] = sqrtf((pfValue[0] * pfValue[0]) + (pfValue[1] * pfValue[1]) + (pfValue[2] * pfValue[2]));
+	fHx = (REAL32)pSample->nHx / (REAL32)TENFOOT_SCALE;
+	fHy = (REAL32)pSample->nHy / (REAL32)TENFOOT_SCALE;
+	fHz = (REAL32)pSample->nHz / (REAL32)TENFOOT_SCALE;
+	pfValue[4] = sqrtf((fHx * fHx) + (fHy * fHy) + (fHz * fHz));
+}
+
+/*******************************************************************************
+*       @details
+*   How fast the Tenfoot temperature moves over the raw samples in the
+*   ring, in 0.1 degrees C per minute.  A survey taken while it still
+*   settles after a trip in is suspect.
+*******************************************************************************/
+static INT16 Compass_TemperatureDrift(void)
+{
+	const COMPASS_RAW_SAMPLE *pNewest;
+	const COMPASS_RAW_SAMPLE *pOldest;
+	TIME_RT tSpan;
+	REAL32 fDrift;
+
+	if((m_nCompassType != COMPASS_TENFOOT) || (m_nCompassSampleCount < 2))
+	{
+		return 0;
+	}
+	pNewest = Compass_SampleAgo(0);
+	pOldest = Compass_SampleAgo(m_nCompassSampleCount - 1);
+	tSpan = pNewest->tTime - pOldest->tTime;
+	if(tSpan == 0)
+	{
+		return 0;
+	}
+	// raw temperature is degrees C * 10 scaled by 4096
+	fDrift = (REAL32)(pNewest->nTemperature - pOldest->nTemperature) / (REAL32)TENFOOT_SCALE;
+	fDrift = fDrift * 60000.0f / (REAL32)tSpan;
+	if(fDrift > 32767.0f)
+	{
+		return 32767;
+	}
+	if(fDrift < -32767.0f)
+	{
+		return -32767;
+	}
+	return (INT16)fDrift;
+}
+
+/*******************************************************************************
+*       @details
+*   Copies the Gtotal, Htotal, dip and spread that went with the survey.
+*******************************************************************************/
+void Compass_GetSurveyMetrics(COMPASS_SURVEY_METRICS *pMetrics)
+{
+	*pMetrics = m_CompassSurveyData.metrics;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL Compass_IsStill(void)
+{
+	return m_bCompassStill;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void Compass_SetStillWindow(U_INT16 nWindow)
+{
+	m_tCompassStillWindow = nWindow;
+}
+
+/*******************************************************************************
+*       @details
+*   Copies the best survey of the latest still period, FALSE if the tool
+*   has not been still since power up.
+*******************************************************************************/
+BOOL Compass_GetBestSurvey(COMPASS_BEST_SURVEY *pSurvey)
+{
+	*pSurvey = m_CompassBestSurvey;
+	return m_CompassBestSurvey.isValid;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE Compass_GetType(void)
+{
+	return (m_nCompassStateMachine == COMPASS_CONNECTED) ? m_nCompassType : COMPASS_UNKNOWN;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 Compass_GetFrameCount(void)
+{
+	return m_nCompassFrames;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 Compass_GetChecksumErrorCount(void)
+{
+	return m_nCompassChecksumErrors;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 Compass_GetOverrunCount(void)
+{
+	return m_nCompassOverruns;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 Compass_GetTxWaitCount(void)
+{
+	return m_nCompassTxWaits;
+}
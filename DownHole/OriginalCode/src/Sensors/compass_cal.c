@@ -0,0 +1,500 @@
+/*******************************************************************************
+*       @brief      This source file contains the magnetometer hard and soft
+*                   iron calibration.
+*       @file       Downhole/src/Sensors/compass_cal.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include <math.h>
+#include "FlashMemory.h"
+#include "compass_cal.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// a sample closer than this to the last one adds nothing, about 3 degrees
+// of rotation in a 50000nT field
+#define COMPASS_CAL_MIN_SPACING         2500.0f
+// samples needed before a fit is tried, and the most that are summed
+#define COMPASS_CAL_MIN_SAMPLES         30
+#define COMPASS_CAL_MAX_SAMPLES         2000
+// longest over shortest ellipsoid axis that is still believed
+#define COMPASS_CAL_MAX_AXIS_RATIO      1.5
+// a pivot this small against its diagonal means the rotation did not cover
+// enough directions to pin the ellipsoid down
+#define COMPASS_CAL_MIN_PIVOT           1.0e-12
+// least variance of the field direction along any axis, a sphere gives 1/3
+// and a rotation that only sweeps a cap of less than about 45 degrees, or
+// turns about one axis, fits a wrong ellipsoid just as well as the right one
+#define COMPASS_CAL_MIN_SPREAD          0.02
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static BOOL CompassCal_Solve(REAL64 fMatrix[COMPASS_CAL_TERMS][COMPASS_CAL_TERMS], REAL64 *pfVector);
+static BOOL CompassCal_Eigen(REAL64 fMatrix[3][3], REAL64 fVectors[3][3]);
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static COMPASS_CAL_SUMS m_CompassCalSums;
+static U_BYTE m_nCompassCalState = COMPASS_CAL_IDLE;
+static U_INT16 m_nCompassCalResidual = 0;
+static U_BYTE m_nCompassCalSweeps = 0;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void CompassCal_Start(void)
+{
+	memset(&m_CompassCalSums, 0, sizeof(m_CompassCalSums));
+	m_nCompassCalResidual = 0;
+	m_nCompassCalState = COMPASS_CAL_COLLECTING;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void CompassCal_Cancel(void)
+{
+	memset(&m_CompassCalSums, 0, sizeof(m_CompassCalSums));
+	m_nCompassCalState = COMPASS_CAL_IDLE;
+}
+
+/*******************************************************************************
+*       @details
+*   Adds the sample to the normal equations of
+*   	A x^2 + B y^2 + C z^2 + 2D xy + 2E xz + 2F yz + 2G x + 2H y + 2I z = 1
+*   with the field scaled by the first sample so the sums stay near 1.
+*******************************************************************************/
+BOOL CompassCal_AddSample(REAL32 fHx, REAL32 fHy, REAL32 fHz)
+{
+	COMPASS_CAL_SUMS *pSums = &m_CompassCalSums;
+	REAL64 fTerm[COMPASS_CAL_TERMS];
+	REAL64 fX, fY, fZ;
+	REAL32 fDistance;
+	U_BYTE nRow;
+	U_BYTE nColumn;
+
+	if((m_nCompassCalState != COMPASS_CAL_COLLECTING) || (pSums->nSamples >= COMPASS_CAL_MAX_SAMPLES))
+	{
+		return FALSE;
+	}
+	if(pSums->nSamples == 0)
+	{
+		pSums->fScale = sqrt(((REAL64)fHx * fHx) + ((REAL64)fHy * fHy) + ((REAL64)fHz * fHz));
+		if(pSums->fScale == 0.0)
+		{
+			return FALSE;
+		}
+	}
+	else
+	{
+		fX = fHx - pSums->fLast[0];
+		fY = fHy - pSums->fLast[1];
+		fZ = fHz - pSums->fLast[2];
+		fDistance = (REAL32)sqrt((fX * fX) + (fY * fY) + (fZ * fZ));
+		if(fDistance < COMPASS_CAL_MIN_SPACING)
+		{
+			return FALSE;
+		}
+	}
+	pSums->fLast[0] = fHx;
+	pSums->fLast[1] = fHy;
+	pSums->fLast[2] = fHz;
+	fX = fHx / pSums->fScale;
+	fY = fHy / pSums->fScale;
+	fZ = fHz / pSums->fScale;
+	fTerm[0] = fX * fX;
+	fTerm[1] = fY * fY;
+	fTerm[2] = fZ * fZ;
+	fTerm[3] = 2.0 * fX * fY;
+	fTerm[4] = 2.0 * fX * fZ;
+	fTerm[5] = 2.0 * fY * fZ;
+	fTerm[6] = 2.0 * fX;
+	fTerm[7] = 2.0 * fY;
+	fTerm[8] = 2.0 * fZ;
+	for(nRow = 0; nRow < COMPASS_CAL_TERMS; nRow++)
+	{
+		for(nColumn = nRow; nColumn < COMPASS_CAL_TERMS; nColumn++)
+		{
+			pSums->fNormal[nRow][nColumn] += fTerm[nRow] * fTerm[nColumn];
+		}
+		pSums->fRight[nRow] += fTerm[nRow];
+	}
+	pSums->nSamples++;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Fits the samples collected so far and keeps the result in the NV block.
+*   A failed fit leaves the calibration in use as it was.
+*******************************************************************************/
+U_BYTE CompassCal_Finish(void)
+{
+	REAL32 fOffset[3];
+	REAL32 fMatrix[9];
+	REAL32 fResidual;
+
+	if(m_nCompassCalState != COMPASS_CAL_COLLECTING)
+	{
+		return m_nCompassCalState;
+	}
+	if((m_CompassCalSums.nSamples >= COMPASS_CAL_MIN_SAMPLES) &&
+	   CompassCal_Fit(&m_CompassCalSums, fOffset, fMatrix, &fResidual))
+	{
+		SetMagCalibration(TRUE, fOffset, fMatrix);
+		m_nCompassCalResidual = (fResidual < 65535.0f) ? (U_INT16)(fResidual + 0.5f) : 65535;
+		m_nCompassCalState = COMPASS_CAL_DONE;
+	}
+	else
+	{
+		m_nCompassCalState = COMPASS_CAL_FAILED;
+	}
+	return m_nCompassCalState;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE CompassCal_GetState(void)
+{
+	return m_nCompassCalState;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 CompassCal_GetSampleCount(void)
+{
+	return m_CompassCalSums.nSamples;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 CompassCal_GetResidual(void)
+{
+	return m_nCompassCalResidual;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE CompassCal_GetSweeps(void)
+{
+	return m_nCompassCalSweeps;
+}
+
+/*******************************************************************************
+*       @details
+*   Solves the normal equations for the ellipsoid
+*   	(h - c)' Q (h - c) = 1
+*   where the centre c is the hard iron offset.  Q = V diag(L) V' gives the
+*   soft iron matrix M = R V diag(sqrt(L)) V', with R the radius of the
+*   sphere of the same volume, so M (h - c) has the undistorted magnitude.
+*   The offset comes back in nT and the residual is the rms distance of the
+*   samples from the ellipsoid in nT.
+*   The normal sums are factored where they are, in the lower triangle the
+*   sums leave free, rather than in a copy that would more than double the
+*   stack the fit needs.  Their diagonal is lost, so the sums are used up.
+*******************************************************************************/
+BOOL CompassCal_Fit(COMPASS_CAL_SUMS *pSums, REAL32 *pfOffset, REAL32 *pfMatrix, REAL32 *pfResidual)
+{
+	REAL64 fParam[COMPASS_CAL_TERMS];
+	REAL64 fQ[3][3];
+	REAL64 fInverse[3][3];
+	REAL64 fVectors[3][3];
+	REAL64 fCentre[3];
+	REAL64 fRoot[3];
+	REAL64 fDeterminant;
+	REAL64 fK;
+	REAL64 fLongest;
+	REAL64 fShortest;
+	REAL64 fRadius;
+	REAL64 fError;
+	REAL64 fSum;
+	U_BYTE nRow;
+	U_BYTE nColumn;
+	U_BYTE nIndex;
+
+	m_nCompassCalSweeps = 0;
+	if(pSums->nSamples < COMPASS_CAL_TERMS)
+	{
+		return FALSE;
+	}
+	// the linear terms are 2h, so their block of the sums holds the spread
+	// of the samples
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		for(nColumn = nRow; nColumn < 3; nColumn++)
+		{
+			fQ[nRow][nColumn] = (pSums->fNormal[6 + nRow][6 + nColumn] / (4.0 * pSums->nSamples)) -
+			                    ((pSums->fRight[6 + nRow] * pSums->fRight[6 + nColumn]) / (4.0 * pSums->nSamples * pSums->nSamples));
+			fQ[nColumn][nRow] = fQ[nRow][nColumn];
+		}
+	}
+	if(!CompassCal_Eigen(fQ, fVectors))
+	{
+		return FALSE;
+	}
+	for(nIndex = 0; nIndex < 3; nIndex++)
+	{
+		if(fQ[nIndex][nIndex] < COMPASS_CAL_MIN_SPREAD)
+		{
+			return FALSE;
+		}
+	}
+	// least squares parameters
+	memcpy(fParam, pSums->fRight, sizeof(fParam));
+	if(!CompassCal_Solve(pSums->fNormal, fParam))
+	{
+		return FALSE;
+	}
+	// algebraic error, sum of (term . param - 1)^2 = p'Np - 2p'b + n, and
+	// at the least squares solution Np = b, so n - p'b
+	fError = (REAL64)pSums->nSamples;
+	for(nRow = 0; nRow < COMPASS_CAL_TERMS; nRow++)
+	{
+		fError -= fParam[nRow] * pSums->fRight[nRow];
+	}
+	// quadratic part and its inverse
+	fQ[0][0] = fParam[0];
+	fQ[1][1] = fParam[1];
+	fQ[2][2] = fParam[2];
+	fQ[0][1] = fQ[1][0] = fParam[3];
+	fQ[0][2] = fQ[2][0] = fParam[4];
+	fQ[1][2] = fQ[2][1] = fParam[5];
+	fInverse[0][0] = (fQ[1][1] * fQ[2][2]) - (fQ[1][2] * fQ[2][1]);
+	fInverse[0][1] = (fQ[0][2] * fQ[2][1]) - (fQ[0][1] * fQ[2][2]);
+	fInverse[0][2] = (fQ[0][1] * fQ[1][2]) - (fQ[0][2] * fQ[1][1]);
+	fInverse[1][1] = (fQ[0][0] * fQ[2][2]) - (fQ[0][2] * fQ[2][0]);
+	fInverse[1][2] = (fQ[0][2] * fQ[1][0]) - (fQ[0][0] * fQ[1][2]);
+	fInverse[2][2] = (fQ[0][0] * fQ[1][1]) - (fQ[0][1] * fQ[1][0]);
+	fInverse[1][0] = fInverse[0][1];
+	fInverse[2][0] = fInverse[0][2];
+	fInverse[2][1] = fInverse[1][2];
+	fDeterminant = (fQ[0][0] * fInverse[0][0]) + (fQ[0][1] * fInverse[1][0]) + (fQ[0][2] * fInverse[2][0]);
+	if(fDeterminant <= 0.0)
+	{
+		return FALSE;
+	}
+	// centre c = -Q^-1 (G, H, I), and the right hand side moved to it
+	fK = 1.0;
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		fCentre[nRow] = -((fInverse[nRow][0] * fParam[6]) + (fInverse[nRow][1] * fParam[7]) +
+		                  (fInverse[nRow][2] * fParam[8])) / fDeterminant;
+	}
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		for(nColumn = 0; nColumn < 3; nColumn++)
+		{
+			fK += fCentre[nRow] * fQ[nRow][nColumn] * fCentre[nColumn];
+		}
+	}
+	if(fK <= 0.0)
+	{
+		return FALSE;
+	}
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		for(nColumn = 0; nColumn < 3; nColumn++)
+		{
+			fQ[nRow][nColumn] /= fK;
+		}
+	}
+	// axes of the ellipsoid
+	if(!CompassCal_Eigen(fQ, fVectors))
+	{
+		return FALSE;
+	}
+	for(nIndex = 0; nIndex < 3; nIndex++)
+	{
+		if(fQ[nIndex][nIndex] <= 0.0)
+		{
+			return FALSE;
+		}
+		fRoot[nIndex] = sqrt(fQ[nIndex][nIndex]);
+	}
+	// the roots are inverse semi-axes
+	fLongest = fRoot[0];
+	fShortest = fRoot[0];
+	for(nIndex = 1; nIndex < 3; nIndex++)
+	{
+		fLongest = (fRoot[nIndex] > fLongest) ? fRoot[nIndex] : fLongest;
+		fShortest = (fRoot[nIndex] < fShortest) ? fRoot[nIndex] : fShortest;
+	}
+	if(fLongest > (COMPASS_CAL_MAX_AXIS_RATIO * fShortest))
+	{
+		return FALSE;
+	}
+	fRadius = 1.0 / cbrt(fRoot[0] * fRoot[1] * fRoot[2]);
+	for(nRow = 0; nRow < 3; nRow++)
+	{
+		for(nColumn = 0; nColumn < 3; nColumn++)
+		{
+			fSum = 0.0;
+			for(nIndex = 0; nIndex < 3; nIndex++)
+			{
+				fSum += fVectors[nRow][nIndex] * fRoot[nIndex] * fVectors[nColumn][nIndex];
+			}
+			pfMatrix[(nRow * 3) + nColumn] = (REAL32)(fRadius * fSum);
+		}
+		pfOffset[nRow] = (REAL32)(fCentre[nRow] * pSums->fScale);
+	}
+	// near the surface the algebraic error is 2 k times the radial error
+	// as a fraction of the radius, k the right hand side moved to c
+	fError = (fError > 0.0) ? sqrt(fError / (REAL64)pSums->nSamples) : 0.0;
+	*pfResidual = (REAL32)(fError * fRadius * pSums->fScale / (2.0 * fK));
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Cholesky solution of N p = b for the symmetric positive definite normal
+*   matrix, of which only the upper triangle is read.  The lower triangle
+*   and diagonal are overwritten with the factor, and the vector with the
+*   answer.
+*******************************************************************************/
+static BOOL CompassCal_Solve(REAL64 fMatrix[COMPASS_CAL_TERMS][COMPASS_CAL_TERMS], REAL64 *pfVector)
+{
+	REAL64 fSum;
+	U_BYTE nRow;
+	U_BYTE nColumn;
+	U_BYTE nIndex;
+
+	for(nColumn = 0; nColumn < COMPASS_CAL_TERMS; nColumn++)
+	{
+		fSum = fMatrix[nColumn][nColumn];
+		for(nIndex = 0; nIndex < nColumn; nIndex++)
+		{
+			fSum -= fMatrix[nColumn][nIndex] * fMatrix[nColumn][nIndex];
+		}
+		if(fSum <= (COMPASS_CAL_MIN_PIVOT * fMatrix[nColumn][nColumn]))
+		{
+			return FALSE;
+		}
+		fMatrix[nColumn][nColumn] = sqrt(fSum);
+		for(nRow = nColumn + 1; nRow < COMPASS_CAL_TERMS; nRow++)
+		{
+			// the upper triangle still holds the original
+			fSum = fMatrix[nColumn][nRow];
+			for(nIndex = 0; nIndex < nColumn; nIndex++)
+			{
+				fSum -= fMatrix[nRow][nIndex] * fMatrix[nColumn][nIndex];
+			}
+			fMatrix[nRow][nColumn] = fSum / fMatrix[nColumn][nColumn];
+		}
+	}
+	// L y = b, then L' p = y
+	for(nRow = 0; nRow < COMPASS_CAL_TERMS; nRow++)
+	{
+		fSum = pfVector[nRow];
+		for(nIndex = 0; nIndex < nRow; nIndex++)
+		{
+			fSum -= fMatrix[nRow][nIndex] * pfVector[nIndex];
+		}
+		pfVector[nRow] = fSum / fMatrix[nRow][nRow];
+	}
+	for(nRow = COMPASS_CAL_TERMS; nRow-- > 0; )
+	{
+		fSum = pfVector[nRow];
+		for(nIndex = nRow + 1; nIndex < COMPASS_CAL_TERMS; nIndex++)
+		{
+			fSum -= fMatrix[nIndex][nRow] * pfVector[nIndex];
+		}
+		pfVector[nRow] = fSum / fMatrix[nRow][nRow];
+	}
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   Cyclic Jacobi rotations until the symmetric matrix is diagonal.  The
+*   eigenvalues are left on its diagonal and the eigenvectors in the
+*   columns of fVectors.  FALSE if COMPASS_CAL_MAX_SWEEPS were not enough.
+*   The most sweeps any call of a fit took is kept for CompassCal_GetSweeps.
+*******************************************************************************/
+static BOOL CompassCal_Eigen(REAL64 fMatrix[3][3], REAL64 fVectors[3][3])
+{
+	static const U_BYTE nPairs[3][2] = { {0, 1}, {0, 2}, {1, 2} };
+	REAL64 fOff;
+	REAL64 fDiagonal;
+	REAL64 fTheta, fT, fC, fS;
+	REAL64 fP, fQ;
+	U_BYTE nSweep;
+	U_BYTE nPair;
+	U_BYTE nIndex;
+	U_BYTE p, q;
+
+	memset(fVectors, 0, 9 * sizeof(REAL64));
+	for(nIndex = 0; nIndex < 3; nIndex++)
+	{
+		fVectors[nIndex][nIndex] = 1.0;
+	}
+	for(nSweep = 0; nSweep < COMPASS_CAL_MAX_SWEEPS; nSweep++)
+	{
+		fOff = (fMatrix[0][1] * fMatrix[0][1]) + (fMatrix[0][2] * fMatrix[0][2]) + (fMatrix[1][2] * fMatrix[1][2]);
+		fDiagonal = (fMatrix[0][0] * fMatrix[0][0]) + (fMatrix[1][1] * fMatrix[1][1]) + (fMatrix[2][2] * fMatrix[2][2]);
+		if(fOff <= (1.0e-24 * fDiagonal))
+		{
+			m_nCompassCalSweeps = (nSweep > m_nCompassCalSweeps) ? nSweep : m_nCompassCalSweeps;
+			return TRUE;
+		}
+		for(nPair = 0; nPair < 3; nPair++)
+		{
+			p = nPairs[nPair][0];
+			q = nPairs[nPair][1];
+			if(fMatrix[p][q] == 0.0)
+			{
+				continue;
+			}
+			// rotation that zeroes [p][q]
+			fTheta = (fMatrix[q][q] - fMatrix[p][p]) / (2.0 * fMatrix[p][q]);
+			fT = 1.0 / (fabs(fTheta) + sqrt((fTheta * fTheta) + 1.0));
+			fT = (fTheta < 0.0) ? -fT : fT;
+			fC = 1.0 / sqrt((fT * fT) + 1.0);
+			fS = fT * fC;
+			for(nIndex = 0; nIndex < 3; nIndex++)
+			{
+				fP = fMatrix[nIndex][p];
+				fQ = fMatrix[nIndex][q];
+				fMatrix[nIndex][p] = (fC * fP) - (fS * fQ);
+				fMatrix[nIndex][q] = (fS * fP) + (fC * fQ);
+			}
+			for(nIndex = 0; nIndex < 3; nIndex++)
+			{
+				fP = fMatrix[p][nIndex];
+				fQ = fMatrix[q][nIndex];
+				fMatrix[p][nIndex] = (fC * fP) - (fS * fQ);
+				fMatrix[q][nIndex] = (fS * fP) + (fC * fQ);
+			}
+			for(nIndex = 0; nIndex < 3; nIndex++)
+			{
+				fP = fVectors[nIndex][p];
+				fQ = fVectors[nIndex][q];
+				fVectors[nIndex][p] = (fC * fP) - (fS * fQ);
+				fVectors[nIndex][q] = (fS * fP) + (fC * fQ);
+			}
+		}
+	}
+	m_nCompassCalSweeps = COMPASS_CAL_MAX_SWEEPS;
+	return FALSE;
+}
@@ -0,0 +1,232 @@
+/*!
+********************************************************************************
+*       @brief      This module keeps a timestamped log of the gamma count and
+*                   the latest inclination and toolface in the serial flash
+*                   event area, so data between surveys can be read later.
+*       @file       Downhole/src/SerialFlash/DataLog.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "main.h"
+#include "SysTick.h"
+#include "FlashMemory.h"
+#include "SensorManager_Gamma.h"
+#include "compass.h"
+#include "DataLog.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// limits of the record interval, seconds
+#define DATALOG_MIN_INTERVAL		1
+#define DATALOG_MAX_INTERVAL		3600
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static U_BYTE m_nLogState = DATALOG_STOPPED;
+// record again once the clear is done
+static BOOL m_bLogResume = FALSE;
+// take a record on the next service, without waiting an interval
+static BOOL m_bLogRecordNow = FALSE;
+static TIME_RT m_tLogLastRecord = 0;
+static U_INT16 m_nLogSession = 0;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void DataLog_TakeRecord(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   Counts the records already in the flash and carries on recording if the
+*   log was recording before the power went.
+*******************************************************************************/
+void DataLog_Initialize(void)
+{
+	DATALOG_RECORD record;
+	U_INT32 nCount;
+
+	nCount = Serflash_recover_events();
+	m_nLogSession = 0;
+	if((nCount != 0) && DataLog_GetRecord(nCount - 1, &record))
+	{
+		m_nLogSession = record.nSession + 1;
+	}
+	m_nLogState = DATALOG_STOPPED;
+	if(GetLogRecording())
+	{
+		DataLog_Start(GetLogInterval());
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void DataLog_Service(void)
+{
+	switch(m_nLogState)
+	{
+		case DATALOG_CLEARING:
+			if(Serflash_erase_last_event() == FALSE)
+			{
+				m_nLogSession = 0;
+				m_nLogState = m_bLogResume ? DATALOG_RECORDING : DATALOG_STOPPED;
+				m_bLogRecordNow = TRUE;
+			}
+			break;
+		case DATALOG_RECORDING:
+			if(m_bLogRecordNow ||
+			   (ElapsedTimeLowRes(m_tLogLastRecord) >= ((TIME_RT)GetLogInterval() * ONE_SECOND)))
+			{
+				DataLog_TakeRecord();
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void DataLog_TakeRecord(void)
+{
+	DATALOG_RECORD record;
+
+	m_bLogRecordNow = FALSE;
+	m_tLogLastRecord = ElapsedTimeLowRes(0);
+	if(DataLog_GetCount() >= DataLog_GetCapacity())
+	{
+		m_nLogState = DATALOG_FULL;
+		return;
+	}
+	memset(&record, 0, sizeof(record));
+	record.nMarker = DATALOG_MARKER;
+	record.nSession = m_nLogSession;
+	record.tTime = m_tLogLastRecord;
+	if(bValidGammaValues)
+	{
+		record.nFlags |= DATALOG_FLAG_GAMMA;
+		record.nGamma = GetCurrentGammaCount();
+		record.nGammaError = GetCurrentGammaError();
+	}
+	if(Compass_IsDataValid())
+	{
+		record.nFlags |= DATALOG_FLAG_COMPASS;
+		record.nInclination = Compass_GetSurveyPitch();
+		record.nToolface = Compass_GetSurveyRoll();
+	}
+	if(Serflash_program_event((U_BYTE *)&record, sizeof(record)) == 0)
+	{
+		m_nLogState = DATALOG_FULL;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void DataLog_Start(U_INT16 nInterval)
+{
+	if(nInterval < DATALOG_MIN_INTERVAL)
+		nInterval = DATALOG_MIN_INTERVAL;
+	if(nInterval > DATALOG_MAX_INTERVAL)
+		nInterval = DATALOG_MAX_INTERVAL;
+	SetLogRecording(TRUE, nInterval);
+	m_bLogResume = TRUE;
+	m_bLogRecordNow = TRUE;
+	if(m_nLogState != DATALOG_CLEARING)
+	{
+		m_nLogState = DATALOG_RECORDING;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void DataLog_Stop(void)
+{
+	SetLogRecording(FALSE, GetLogInterval());
+	m_bLogResume = FALSE;
+	if(m_nLogState != DATALOG_CLEARING)
+	{
+		m_nLogState = DATALOG_STOPPED;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   The pages are erased from the newest back, one each service, so the
+*   main loop is never held up for the whole area.
+*******************************************************************************/
+void DataLog_Clear(void)
+{
+	if(m_nLogState != DATALOG_CLEARING)
+	{
+		m_bLogResume = GetLogRecording();
+		m_nLogState = DATALOG_CLEARING;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE DataLog_GetState(void)
+{
+	return m_nLogState;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 DataLog_GetInterval(void)
+{
+	return GetLogInterval();
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 DataLog_GetCount(void)
+{
+	return GetEventRecordCount();
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 DataLog_GetCapacity(void)
+{
+	return GetEventRecordCapacity();
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL DataLog_GetRecord(U_INT32 nIndex, DATALOG_RECORD *pRecord)
+{
+	if(nIndex >= DataLog_GetCount())
+	{
+		return FALSE;
+	}
+	if(Serflash_get_event(nIndex, sizeof(DATALOG_RECORD), (U_BYTE *)pRecord) == 0)
+	{
+		return FALSE;
+	}
+	return (pRecord->nMarker == DATALOG_MARKER) ? TRUE : FALSE;
+}
@@ -0,0 +1,335 @@
+/*******************************************************************************
+*       @brief      This module takes a firmware image from uphole a chunk at
+*                   a time into the serial flash.  Each chunk carries a CRC,
+*                   a bitmap in the backup SRAM says which are in so a
+*                   transfer carries on after a reset or a lost link, and
+*                   the whole image is checked before the bootloader may
+*                   install it.
+*       @file       Downhole/src/SerialFlash/FirmwareUpdate.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include <stm32f4xx.h>
+#include "main.h"
+#include "crc.h"
+#include "FlashMemory.h"
+#include "FirmwareUpdate.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define FIRMWARE_CHUNKS_PER_PAGE	(CHIP_PAGE_SIZE / FIRMWARE_CHUNK_SIZE)
+
+// pages checked each service run, about 2mS of SPI
+#define FIRMWARE_VERIFY_PAGES		4
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// the record is at a fixed address so the bootloader can find it, the
+// linker script keeps the black box below it
+static FIRMWARE_UPDATE * const m_pUpdate = (FIRMWARE_UPDATE *)FIRMWARE_UPDATE_ADDRESS;
+
+// how far the check of the image has got, started over after a reset
+static U_INT32 m_nVerifyPage;
+static CRC32_CONTEXT m_VerifyCRC;
+// static for the DMA, and off the stack
+static U_BYTE m_nVerifyData[CHIP_PAGE_SIZE];
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void FirmwareUpdate_Clear(void);
+static void FirmwareUpdate_StartVerify(void);
+static BOOL FirmwareUpdate_IsReceived(U_INT16 nChunk);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*   The chunk count is taken from the bitmap, a reset between marking a
+*   chunk and counting it leaves the count one short.
+*******************************************************************************/
+void FirmwareUpdate_Initialize(void)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+	U_INT16 nChunk;
+
+	if((pUpdate->nMagic != FIRMWARE_UPDATE_MAGIC) || (pUpdate->nState > FIRMWARE_STATE_FAILED) ||
+	   (pUpdate->nSize > ((U_INT32)FIRMWARE_MAX_CHUNKS * FIRMWARE_CHUNK_SIZE)))
+	{
+		FirmwareUpdate_Clear();
+	}
+	pUpdate->nReceived = 0;
+	for(nChunk = 0; nChunk < FirmwareUpdate_GetChunkCount(); nChunk++)
+	{
+		if(FirmwareUpdate_IsReceived(nChunk))
+		{
+			pUpdate->nReceived++;
+		}
+	}
+	if(pUpdate->nState == FIRMWARE_STATE_VERIFYING)
+	{
+		FirmwareUpdate_StartVerify();
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   Reads FIRMWARE_VERIFY_PAGES pages of the image each run into the CRC,
+*   a half megabyte image takes about three seconds.
+*******************************************************************************/
+void FirmwareUpdate_Service(void)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+	U_INT32 nLength;
+	U_BYTE nPages;
+
+	if(pUpdate->nState != FIRMWARE_STATE_VERIFYING)
+	{
+		return;
+	}
+	for(nPages = 0; nPages < FIRMWARE_VERIFY_PAGES; nPages++)
+	{
+		if((m_nVerifyPage * CHIP_PAGE_SIZE) >= pUpdate->nSize)
+		{
+			break;
+		}
+		if(Serflash_read_firmware_page(m_nVerifyPage, m_nVerifyData) == 0)
+		{
+			pUpdate->nState = FIRMWARE_STATE_FAILED;
+			return;
+		}
+		nLength = pUpdate->nSize - (m_nVerifyPage * CHIP_PAGE_SIZE);
+		if(nLength > CHIP_PAGE_SIZE)
+		{
+			nLength = CHIP_PAGE_SIZE;
+		}
+		CRC32_Update(&m_VerifyCRC, m_nVerifyData, nLength);
+		m_nVerifyPage++;
+	}
+	if((m_nVerifyPage * CHIP_PAGE_SIZE) >= pUpdate->nSize)
+	{
+		pUpdate->nState = (CRC32_Finish(&m_VerifyCRC) == pUpdate->nCRC) ?
+			FIRMWARE_STATE_READY : FIRMWARE_STATE_FAILED;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*   An image that failed its check is taken again from the start, one of
+*   its chunks may have been spoilt in the flash.
+*******************************************************************************/
+BOOL FirmwareUpdate_Start(U_INT32 nSize, U_INT32 nCRC)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+
+	if((nSize == pUpdate->nSize) && (nCRC == pUpdate->nCRC) &&
+	   (pUpdate->nState != FIRMWARE_STATE_IDLE) && (pUpdate->nState != FIRMWARE_STATE_FAILED))
+	{
+		return TRUE;
+	}
+	FirmwareUpdate_Clear();
+	if(nSize == 0)
+	{
+		return TRUE;
+	}
+	if((nSize > GetFirmwareCapacity()) || (nSize > ((U_INT32)FIRMWARE_MAX_CHUNKS * FIRMWARE_CHUNK_SIZE)))
+	{
+		return FALSE;
+	}
+	pUpdate->nSize = nSize;
+	pUpdate->nCRC = nCRC;
+	pUpdate->nState = FIRMWARE_STATE_RECEIVING;
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*   A chunk is marked once it is in the flash, a reset before then only
+*   means it is sent again.  The first chunk of a page to arrive starts the
+*   page from blank.
+*******************************************************************************/
+U_BYTE FirmwareUpdate_WriteChunk(U_INT16 nChunk, const U_BYTE *pData, U_BYTE nLength, U_INT32 nCRC)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+	CRC32_CONTEXT crc;
+	U_BYTE nNumber[2];
+	U_INT32 nOffset;
+	U_INT32 nExpected;
+	U_INT16 nPageChunk;
+	U_BYTE nChunkOfPage;
+	BOOL bBlankPage;
+
+	if(pUpdate->nState != FIRMWARE_STATE_RECEIVING)
+	{
+		return FIRMWARE_CHUNK_NOT_RECEIVING;
+	}
+	if(nChunk >= FirmwareUpdate_GetChunkCount())
+	{
+		return FIRMWARE_CHUNK_BAD_NUMBER;
+	}
+	nOffset = (U_INT32)nChunk * FIRMWARE_CHUNK_SIZE;
+	nExpected = pUpdate->nSize - nOffset;
+	if(nExpected > FIRMWARE_CHUNK_SIZE)
+	{
+		nExpected = FIRMWARE_CHUNK_SIZE;
+	}
+	if(nLength != nExpected)
+	{
+		return FIRMWARE_CHUNK_BAD_NUMBER;
+	}
+	// the CRC covers the chunk number too, so a chunk is never kept in the
+	// wrong place
+	nNumber[0] = (U_BYTE)nChunk;
+	nNumber[1] = (U_BYTE)(nChunk >> 8);
+	CRC32_Start(&crc);
+	CRC32_Update(&crc, nNumber, sizeof(nNumber));
+	CRC32_Update(&crc, pData, nLength);
+	if(CRC32_Finish(&crc) != nCRC)
+	{
+		return FIRMWARE_CHUNK_BAD_CRC;
+	}
+	if(FirmwareUpdate_IsReceived(nChunk))
+	{
+		return FIRMWARE_CHUNK_OK;
+	}
+	bBlankPage = TRUE;
+	nPageChunk = nChunk - (nChunk % FIRMWARE_CHUNKS_PER_PAGE);
+	for(nChunkOfPage = 0; nChunkOfPage < FIRMWARE_CHUNKS_PER_PAGE; nChunkOfPage++)
+	{
+		if(FirmwareUpdate_IsReceived(nPageChunk + nChunkOfPage))
+		{
+			bBlankPage = FALSE;
+		}
+	}
+	if(Serflash_program_firmware(nOffset, pData, nLength, bBlankPage) == 0)
+	{
+		return FIRMWARE_CHUNK_FLASH_ERROR;
+	}
+	pUpdate->Received[nChunk / 8] |= (U_BYTE)(1 << (nChunk % 8));
+	pUpdate->nReceived++;
+	return FIRMWARE_CHUNK_OK;
+}
+
+/*******************************************************************************
+*       @details
+*   Asking again once the check has started, or is done, changes nothing.
+*******************************************************************************/
+BOOL FirmwareUpdate_Commit(U_INT32 nCRC)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+
+	if(nCRC != pUpdate->nCRC)
+	{
+		return FALSE;
+	}
+	if((pUpdate->nState == FIRMWARE_STATE_VERIFYING) || (pUpdate->nState == FIRMWARE_STATE_READY))
+	{
+		return TRUE;
+	}
+	if((pUpdate->nState != FIRMWARE_STATE_RECEIVING) ||
+	   (pUpdate->nReceived < FirmwareUpdate_GetChunkCount()))
+	{
+		return FALSE;
+	}
+	pUpdate->nState = FIRMWARE_STATE_VERIFYING;
+	FirmwareUpdate_StartVerify();
+	return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE FirmwareUpdate_GetState(void)
+{
+	return m_pUpdate->nState;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 FirmwareUpdate_GetSize(void)
+{
+	return m_pUpdate->nSize;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 FirmwareUpdate_GetCRC(void)
+{
+	return m_pUpdate->nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 FirmwareUpdate_GetChunkCount(void)
+{
+	return (U_INT16)((m_pUpdate->nSize + FIRMWARE_CHUNK_SIZE - 1) / FIRMWARE_CHUNK_SIZE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 FirmwareUpdate_GetReceivedCount(void)
+{
+	return m_pUpdate->nReceived;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE FirmwareUpdate_GetReceived(U_INT16 nIndex)
+{
+	if(nIndex >= (FIRMWARE_MAX_CHUNKS / 8))
+	{
+		return 0;
+	}
+	return m_pUpdate->Received[nIndex];
+}
+
+/*******************************************************************************
+*       @details
+*   The state goes first, so a reset part way never leaves a record that
+*   looks ready.
+*******************************************************************************/
+static void FirmwareUpdate_Clear(void)
+{
+	FIRMWARE_UPDATE *pUpdate = m_pUpdate;
+
+	pUpdate->nState = FIRMWARE_STATE_IDLE;
+	memset(pUpdate, 0, sizeof(FIRMWARE_UPDATE));
+	pUpdate->nMagic = FIRMWARE_UPDATE_MAGIC;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void FirmwareUpdate_StartVerify(void)
+{
+	m_nVerifyPage = 0;
+	CRC32_Start(&m_VerifyCRC);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL FirmwareUpdate_IsReceived(U_INT16 nChunk)
+{
+	return (m_pUpdate->Received[nChunk / 8] & (1 << (nChunk % 8))) ? TRUE : FALSE;
+}
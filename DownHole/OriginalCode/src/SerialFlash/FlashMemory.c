@@ -12,12 +12,14 @@
 //============================================================================//
 
 #include <stm32f4xx.h>
+#include <stddef.h>
 #include <string.h>
 #include "RealTimeClock.h"
 #include "main.h"
 #include "FlashMemory.h"
 #include "CommDriver_SPI.h"
 #include "SysTick.h"
+#include "compass.h"
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -31,18 +33,64 @@ const NVRAM_image NVRAM_defaults =
 {
 	1000, // INT16 nDownholeOnTime;
 	0, // U_BYTE bGamma;
+	COMPASS_UNKNOWN, // U_BYTE nCompassType;
+	FALSE, // U_BYTE bMagCalibrated;
+	0, // U_BYTE nMagCalSpare;
+	{ 0.0f, 0.0f, 0.0f }, // REAL32 fMagOffset[3];
+	{ 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f }, // REAL32 fMagMatrix[9];
+	10, // U_INT16 nLogInterval;
+	FALSE, // U_BYTE bLogRecording;
+	NV_LAYOUT_VERSION, // U_BYTE nLayoutVersion;
+	0, // U_INT16 nModemMode;
+	{ 0 }, // U_BYTE nModemSerial[MODEM_SN_LENGTH];
+	FALSE, // U_BYTE bModemConfigured;
+	0, // U_BYTE nModemSpare;
 };
 
 const NVRAM_image NVRAM_min =
 {
 	6, // INT16 nDownholeOnTime;
 	0, // U_BYTE bGamma;
+	COMPASS_UNKNOWN, // U_BYTE nCompassType;
+	FALSE, // U_BYTE bMagCalibrated;
+	0, // U_BYTE nMagCalSpare;
+	{ 0.0f, 0.0f, 0.0f }, // REAL32 fMagOffset[3];
+	{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }, // REAL32 fMagMatrix[9];
+	1, // U_INT16 nLogInterval;
+	FALSE, // U_BYTE bLogRecording;
+	NV_LAYOUT_VERSION, // U_BYTE nLayoutVersion;
+	0, // U_INT16 nModemMode;
+	{ 0 }, // U_BYTE nModemSerial[MODEM_SN_LENGTH];
+	FALSE, // U_BYTE bModemConfigured;
+	0, // U_BYTE nModemSpare;
 };
 
 const NVRAM_image NVRAM_max =
 {
 	4000, // INT16 nDownholeOnTime;
 	1, // U_BYTE bGamma;
+	COMPASS_TENFOOT, // U_BYTE nCompassType;
+	TRUE, // U_BYTE bMagCalibrated;
+	0, // U_BYTE nMagCalSpare;
+	{ 0.0f, 0.0f, 0.0f }, // REAL32 fMagOffset[3];
+	{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }, // REAL32 fMagMatrix[9];
+	3600, // U_INT16 nLogInterval;
+	TRUE, // U_BYTE bLogRecording;
+	NV_LAYOUT_VERSION, // U_BYTE nLayoutVersion;
+	0xFFFF, // U_INT16 nModemMode;
+	{ 0 }, // U_BYTE nModemSerial[MODEM_SN_LENGTH];
+	TRUE, // U_BYTE bModemConfigured;
+	0, // U_BYTE nModemSpare;
+};
+
+// bytes in the NV block of each layout, the CRC being the last 4 of them,
+// newest first
+static const U_INT16 NVRAM_layout_size[NV_LAYOUT_VERSION] =
+{
+	sizeof(NVRAM_image),                                        // 4
+	offsetof(NVRAM_image, nModemMode) + sizeof(U_INT32),        // 3
+	offsetof(NVRAM_image, nLogInterval) + sizeof(U_INT32),      // 2
+	offsetof(NVRAM_image, bMagCalibrated) + sizeof(U_INT32),    // 1
 };
 
 #define FLASH_PARTS_DEFINED 1
@@ -84,8 +132,8 @@ extern volatile U_INT16 NV_save_timer;
 
 static BOOL FLASH_WaitForReadyNow(TIME_RT milliseconds);
 static BOOL CalcCRC(U_BYTE *pData, U_INT16 nLength, U_INT32 *nResultCRC);
-static void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber);
-static void FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber);
+static BOOL FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber);
+static BOOL FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber);
 static void FLASH_FixTheNVChecksum(void);
 
 /*******************************************************************************
@@ -159,6 +207,20 @@ static void SendEmptyBytes(int len)
 	}
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void SendCommandAt(U_BYTE command, U_INT16 pageNumber, U_INT16 byteOffset)
+{
+	U_INT32 arguments = (command << 24) | (pageNumber << 10) | byteOffset;
+	int index = sizeof(arguments);
+	U_BYTE* args = (U_BYTE*) &arguments;
+	while(index--)
+	{
+		SPI_TransferByte(args[index]);
+	}
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -208,42 +270,71 @@ static void ErasePage(U_INT32 nPageNumber)
 
 /*******************************************************************************
 *       @details
+*   FALSE if the page did not come in whole, the buffer then holds part of
+*   it and part of whatever was there before.
 *******************************************************************************/
-void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber)
+BOOL FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber)
 {
-	if(page == NULL) return;
-	if(!IsValidPage(pageNumber)) return;
+	BOOL bRead;
+
+	if(page == NULL) return FALSE;
+	if(!IsValidPage(pageNumber)) return FALSE;
 	SPI_ResetTransferTimeOut();
 	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
 	SendCommand(SERFLASH45_READ_PAGE_OPCODE, pageNumber);
 	SendEmptyBytes(4);
-	ReceiveBytes(page, CHIP_PAGE_SIZE);
+	bRead = SPI_Transfer(NULL, page, CHIP_PAGE_SIZE);
 	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+	return bRead;
 }
 
 /*******************************************************************************
 *       @details
+*   Reads part of a page, starting byteOffset into it.
 *******************************************************************************/
-void FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber)
+static void FLASH_ReadBytes(U_BYTE *bytes, U_INT32 pageNumber, U_INT16 byteOffset, U_INT16 length)
 {
-	U_BYTE pageData[CHIP_PAGE_SIZE];
+	if(bytes == NULL) return;
+	if(!IsValidPage(pageNumber)) return;
+	SPI_ResetTransferTimeOut();
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+	SendCommandAt(SERFLASH45_READ_PAGE_OPCODE, pageNumber, byteOffset);
+	SendEmptyBytes(4);
+	ReceiveBytes(bytes, length);
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+}
+
+/*******************************************************************************
+*       @details
+*   The buffer is filled before the page is erased, so a transfer that does
+*   not finish leaves the page as it was.  FALSE if the page was not written.
+*******************************************************************************/
+BOOL FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber)
+{
+	// static for the DMA, and off the stack
+	static U_BYTE pageData[CHIP_PAGE_SIZE];
 //	U_INT32 pageCrc;
+	BOOL bSent;
 
 	if(Serial_Flash_Chip.ext_flash_working == FALSE)
 	{
-		return;
+		return FALSE;
 	}
 	if (IsValidPage(nPageNumber))
 	{
 		memcpy(pageData, page, CHIP_PAGE_SIZE);
 //		CalcCRC(pageData, CHIP_PAGE_SIZE, &pageCrc);
 		SPI_ResetTransferTimeOut();
-		ErasePage(nPageNumber);
 		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
 		SendCommand(SERFLASH45_WRITE_BUFFER1_OPCODE, nPageNumber);
-		SendBytes(pageData, CHIP_PAGE_SIZE);
+		bSent = SPI_Transfer(pageData, NULL, CHIP_PAGE_SIZE);
 //		SendBytes((U_BYTE*)&pageCrc, sizeof(pageCrc));
 		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+		if (!bSent)
+		{
+			return FALSE;
+		}
+		ErasePage(nPageNumber);
 		if (FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS))
 		{
 			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
@@ -251,20 +342,21 @@ void FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber)
 			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
 			if (FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS))
 			{
-				return;
+				return TRUE;
 			}
 			else
 			{
 				Serial_Flash_Chip.ext_flash_working = FALSE;
-				return;
+				return FALSE;
 			}
 		}
 		else
 		{
 			Serial_Flash_Chip.ext_flash_working = FALSE;
-			return;
+			return FALSE;
 		}
 	}
+	return FALSE;
 }
 
 /*******************************************************************************
@@ -291,6 +383,84 @@ U_INT32 GetEventRecordCount(void)
 	return Serial_Flash_Chip.event_number;
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 GetEventRecordCapacity(void)
+{
+	if(Serial_Flash_Chip.ext_flash_working == FALSE)
+	{
+		return 0ul;
+	}
+	return Serial_Flash_Chip.EVENTS_pages_available * EVENTS_PER_PAGE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL IsEventSlotBlank(U_BYTE *slot)
+{
+	return ((slot[0] == 0xFF) && (slot[1] == 0xFF)) ? TRUE : FALSE;
+}
+
+/****************************************************************************
+ * Function Name:   Serflash_recover_events
+ * after a power up, count the events already stored by finding the first
+ * blank slot, slots past it are always blank.  The count is kept from then
+ * on, so the flash is only searched once.
+ ****************************************************************************/
+U_INT32 Serflash_recover_events(void)
+{
+	U_INT32 next_slot;
+
+	Serial_Flash_Chip.event_buffer_page = EVENT_BUFFER_EMPTY;
+	if(Serial_Flash_Chip.ext_flash_working == FALSE)
+	{
+		return 0ul;
+	}
+	next_slot = Serflash_find_next_event_slot(EVENT_SLOT_SIZE);
+	if(next_slot == 0xFFFFFFFFul)
+	{
+		// no blank slot left, the area is full
+		Serial_Flash_Chip.event_number = GetEventRecordCapacity();
+	}
+	else
+	{
+		Serial_Flash_Chip.event_number = next_slot;
+	}
+	return Serial_Flash_Chip.event_number;
+}
+
+/****************************************************************************
+ * Function Name:   Serflash_erase_last_event
+ * erases the page with the newest events without waiting for the chip, call
+ * again until it returns FALSE.  Erasing from the top keeps every page past
+ * the last event blank, even if power goes part way through.
+ ****************************************************************************/
+BOOL Serflash_erase_last_event(void)
+{
+	U_INT32 a_page;
+
+	if(Serial_Flash_Chip.ext_flash_working == FALSE)
+	{
+		Serial_Flash_Chip.event_number = 0ul;
+		return FALSE;
+	}
+	if(FLASH_IsBusyNow())
+	{
+		return TRUE;
+	}
+	if(Serial_Flash_Chip.event_number == 0ul)
+	{
+		return FALSE;
+	}
+	a_page = (Serial_Flash_Chip.event_number - 1ul) / EVENTS_PER_PAGE;
+	Serial_Flash_Chip.event_number = a_page * EVENTS_PER_PAGE;
+	Serial_Flash_Chip.event_buffer_page = EVENT_BUFFER_EMPTY;
+	ErasePage( a_page + Serial_Flash_Chip.EVENTS_start_page );
+	return TRUE;
+}
+
 /******************************************************************************
  * Serflash_Events_Clear: erase all of the EVENT log flash space..
  ******************************************************************************/
@@ -309,62 +479,144 @@ void Serflash_Events_Clear(void)
 		a_page++;
 	}
 	Serial_Flash_Chip.event_number = 0ul;
+	Serial_Flash_Chip.event_buffer_page = EVENT_BUFFER_EMPTY;
 }
 
 /****************************************************************************
  * Function Name:   Serflash_find_next_event_slot
- * events are stored one per page, so return the integer number of the page
+ * return the number of the first blank event slot.  Pages fill in order, so
+ * a binary search on the first slot of each page finds the first blank page
+ * and only the page before it is read through.
  ****************************************************************************/
 U_INT32 Serflash_find_next_event_slot(U_INT32 event_block_size)
 {
-	U_INT32 loopy;
-	U_INT32 target_page;
+	U_INT32 low_page;
+	U_INT32 high_page;
+	U_INT32 middle_page;
+	U_INT32 slot;
+	U_BYTE slot_start[2];
 
-	if(Serial_Flash_Chip.ext_flash_working == FALSE)
+	if( (Serial_Flash_Chip.ext_flash_working == FALSE) || (event_block_size > EVENT_SLOT_SIZE) )
 	{
 		return 0xFFFFFFFFul;
 	}
-	// find the next available event location..
-	loopy = 0;
-	while(loopy < Serial_Flash_Chip.EVENTS_pages_available)
+	// pages below low_page are in use, pages from high_page up are blank
+	low_page = 0;
+	high_page = Serial_Flash_Chip.EVENTS_pages_available;
+	while(low_page < high_page)
 	{
-		target_page = Serial_Flash_Chip.EVENTS_start_page + loopy;
-		FLASH_ReadThePage(Serflash_page_data, target_page);
-		if( (Serflash_page_data[0]==0xFF) && (Serflash_page_data[1]==0xFF) ) return target_page;
-		loopy++;
+		middle_page = low_page + ((high_page - low_page) / 2);
+		FLASH_ReadBytes(slot_start, Serial_Flash_Chip.EVENTS_start_page + middle_page, 0, sizeof(slot_start));
+		if(IsEventSlotBlank(slot_start))
+		{
+			high_page = middle_page;
+		}
+		else
+		{
+			low_page = middle_page + 1;
+		}
+	}
+	if(low_page == 0)
+	{
+		return 0ul;
+	}
+	// the last page in use may be part full
+	if(!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.EVENTS_start_page + low_page - 1))
+	{
+		return 0xFFFFFFFFul;
+	}
+	for(slot = 0; slot < EVENTS_PER_PAGE; slot++)
+	{
+		if(IsEventSlotBlank(&Serflash_page_data[slot * EVENT_SLOT_SIZE])) break;
 	}
-	return 0xFFFFFFFFul;
+	slot += (low_page - 1) * EVENTS_PER_PAGE;
+	if(slot >= GetEventRecordCapacity())
+	{
+		return 0xFFFFFFFFul;
+	}
+	return slot;
 }
 
 /****************************************************************************
  * Function Name:   Serflash_program_event
+ * buffer 2 keeps a copy of the page being filled, so only the new slot is
+ * sent to the chip and the page is programmed without an erase, its blank
+ * slots still read 0xFF.  Buffer 1 is left to the NV block.
  ****************************************************************************/
 U_BYTE Serflash_program_event(U_BYTE *this_event, U_INT32 event_block_size)
 {
-	U_INT16 loopy;
 	U_INT32 a_page;
+	U_INT16 offset;
+	BOOL bSent;
 
 	if(Serial_Flash_Chip.ext_flash_working == FALSE)
 	{
 		return 0;
 	}
+	if(event_block_size > EVENT_SLOT_SIZE)
+	{
+		return 0;
+	}
 	// verify the next available event location..
-	U_INT32 partone = Serial_Flash_Chip.event_number;
-	U_INT32 parttwo = Serial_Flash_Chip.EVENTS_pages_available;
-	if( partone >= parttwo )
+	if( Serial_Flash_Chip.event_number >= GetEventRecordCapacity() )
 	{
 		// we are past the end of storage
 		return 0;
 	}
-	// what page do we store our event in?
-	a_page = partone + Serial_Flash_Chip.EVENTS_start_page;
-	// move the new data into the page buffer
-	for(loopy=0; loopy<event_block_size; loopy++)
+	// what page and slot do we store our event in?
+	a_page = (Serial_Flash_Chip.event_number / EVENTS_PER_PAGE) + Serial_Flash_Chip.EVENTS_start_page;
+	offset = (Serial_Flash_Chip.event_number % EVENTS_PER_PAGE) * EVENT_SLOT_SIZE;
+	SPI_ResetTransferTimeOut();
+	if(FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS) == FALSE)
+	{
+		Serial_Flash_Chip.ext_flash_working = FALSE;
+		return 0;
+	}
+	if(Serial_Flash_Chip.event_buffer_page != a_page)
 	{
-		Serflash_page_data[loopy] = *this_event++;
+		if(offset == 0)
+		{
+			// a new page, start from a blank buffer
+			memset(Serflash_page_data, 0xFF, CHIP_PAGE_SIZE);
+			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+			SendCommand(SERFLASH45_WRITE_BUFFER2_OPCODE, 0);
+			bSent = SPI_Transfer(Serflash_page_data, NULL, CHIP_PAGE_SIZE);
+			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+			// the buffer is only part blank, the page is tried again with
+			// the next event
+			if(!bSent)
+			{
+				return 0;
+			}
+		}
+		else
+		{
+			// carry on filling a page from before the power up
+			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+			SendCommand(SERFLASH45_PAGE_TO_BUF2_OPCODE, a_page);
+			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+			if(FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS) == FALSE)
+			{
+				Serial_Flash_Chip.ext_flash_working = FALSE;
+				return 0;
+			}
+		}
+		Serial_Flash_Chip.event_buffer_page = a_page;
+	}
+	// move the new event into its slot of the buffer
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+	SendCommandAt(SERFLASH45_WRITE_BUFFER2_OPCODE, 0, offset);
+	SendBytes(this_event, event_block_size);
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+	// program the buffer back into the device
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+	SendCommand(SERFLASH45_BUF2_TO_PAGE_OPCODE, a_page);
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+	if(FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS) == FALSE)
+	{
+		Serial_Flash_Chip.ext_flash_working = FALSE;
+		return 0;
 	}
-	// program the buffer row back into the device
-	FLASH_WriteThePage(Serflash_page_data, a_page);
 	// bump up the event number
 	Serial_Flash_Chip.event_number++;
 	return 1;
@@ -375,38 +627,131 @@ U_BYTE Serflash_program_event(U_BYTE *this_event, U_INT32 event_block_size)
  ****************************************************************************/
 U_BYTE Serflash_get_event(U_INT32 event_number, U_INT32 event_block_size, U_BYTE *theData )
 {
-//	U_INT32 loopy;
 	U_INT32 a_page;
+	U_INT16 offset;
 
 	if(Serial_Flash_Chip.ext_flash_working == FALSE)
 	{
 		return 0;
 	}
-	// verify the next available event location..
-	U_INT32 partone = event_number;
-//	U_INT32 partone = Serial_Flash_Chip.event_number;
-	U_INT32 parttwo = Serial_Flash_Chip.EVENTS_pages_available;
-	if( partone >= parttwo )
+	// block too large? Scram!
+	if(event_block_size > EVENT_SLOT_SIZE)
+	{
+		return 0;
+	}
+	// verify the event location..
+	if( event_number >= GetEventRecordCapacity() )
 	{
 		// we are past the end of storage
 		return 0;
 	}
-	// what page holds the event that we want?
-	a_page = partone + Serial_Flash_Chip.EVENTS_start_page;
-	FLASH_ReadThePage(Serflash_page_data, a_page);
-	if(event_block_size < sizeof(Serflash_page_data) )
+	// what page and slot hold the event that we want?
+	a_page = (event_number / EVENTS_PER_PAGE) + Serial_Flash_Chip.EVENTS_start_page;
+	offset = (event_number % EVENTS_PER_PAGE) * EVENT_SLOT_SIZE;
+	FLASH_ReadBytes(theData, a_page, offset, event_block_size);
+	// signal valid data..
+	return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 GetFirmwareCapacity(void)
+{
+	if(Serial_Flash_Chip.ext_flash_working == FALSE)
 	{
-		memcpy((void *)theData, Serflash_page_data, event_block_size);
-//		for(loopy=0; loopy<event_block_size; loopy++)
-//		{
-//			*theData = Serflash_page_data[loopy];
-//			theData++;
-//		}
-		// signal valid data..
-		return 1;
+		return 0ul;
 	}
-	// block too large? Scram!
-	return 0;
+	return FIRMWARE_IMAGE_PAGES * CHIP_PAGE_SIZE;
+}
+
+/****************************************************************************
+ * Function Name:   Serflash_program_firmware
+ * programs part of a page of the firmware image area, offset is from the
+ * start of the area.  Parts of a page arrive in any order, so the page is
+ * copied into buffer 1, the new bytes put in it and the page erased and
+ * programmed from it.  The first part of a page since the area was last
+ * used starts from a blank buffer instead, so nothing of an older image is
+ * kept.  Buffer 1 is only borrowed, the NV block refills all of it.
+ ****************************************************************************/
+U_BYTE Serflash_program_firmware(U_INT32 offset, const U_BYTE *theData, U_INT16 length, BOOL bBlankPage)
+{
+	U_INT32 a_page;
+	U_INT16 page_offset;
+	BOOL bSent;
+
+	if(Serial_Flash_Chip.ext_flash_working == FALSE)
+	{
+		return 0;
+	}
+	a_page = offset / CHIP_PAGE_SIZE;
+	page_offset = (U_INT16)(offset % CHIP_PAGE_SIZE);
+	if((a_page >= FIRMWARE_IMAGE_PAGES) || ((page_offset + length) > CHIP_PAGE_SIZE))
+	{
+		return 0;
+	}
+	a_page += Serial_Flash_Chip.FIRMWARE_start_page;
+	SPI_ResetTransferTimeOut();
+	if(FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS) == FALSE)
+	{
+		Serial_Flash_Chip.ext_flash_working = FALSE;
+		return 0;
+	}
+	if(bBlankPage)
+	{
+		memset(Serflash_page_data, 0xFF, CHIP_PAGE_SIZE);
+		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+		SendCommand(SERFLASH45_WRITE_BUFFER1_OPCODE, 0);
+		bSent = SPI_Transfer(Serflash_page_data, NULL, CHIP_PAGE_SIZE);
+		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+		if(!bSent)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+		SendCommand(SERFLASH45_PAGE_TO_BUF1_OPCODE, a_page);
+		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+		if(FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS) == FALSE)
+		{
+			Serial_Flash_Chip.ext_flash_working = FALSE;
+			return 0;
+		}
+	}
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+	SendCommandAt(SERFLASH45_WRITE_BUFFER1_OPCODE, 0, page_offset);
+	SendBytes((U_BYTE *)theData, length);
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, TRUE);
+	SendCommand(SERFLASH45_BUF1_TO_PAGE_ERASE_OPCODE, a_page);
+	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, FALSE);
+	// an erase and program takes longer than a program alone
+	if(FLASH_WaitForReadyNow(FIFTY_MILLI_SECONDS) == FALSE)
+	{
+		Serial_Flash_Chip.ext_flash_working = FALSE;
+		return 0;
+	}
+	return 1;
+}
+
+/****************************************************************************
+ * Function Name:   Serflash_read_firmware_page
+ * a_page counts from the start of the firmware image area
+ ****************************************************************************/
+U_BYTE Serflash_read_firmware_page(U_INT32 a_page, U_BYTE *theData)
+{
+	if((Serial_Flash_Chip.ext_flash_working == FALSE) || (a_page >= FIRMWARE_IMAGE_PAGES))
+	{
+		return 0;
+	}
+	// a log page erase may still be going
+	if(FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS) == FALSE)
+	{
+		return 0;
+	}
+	return FLASH_ReadThePage(theData, a_page + Serial_Flash_Chip.FIRMWARE_start_page) ? 1 : 0;
 }
 
 /****************************************************************************
@@ -426,7 +771,11 @@ U_BYTE Serflash_test_device(void)
 	// erase the test block.
 	ErasePage(Serial_Flash_Chip.NV_test_page);
 	// verify that FF's are all present.
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page);
+	if(!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page))
+	{
+		Serial_Flash_Chip.ext_flash_working = FALSE;
+		return 0;
+	}
 	for(loopy=0; loopy<num_test_bytes; loopy++)
 	{
 		if(Serflash_page_data[loopy] != 0xFF)
@@ -440,9 +789,13 @@ U_BYTE Serflash_test_device(void)
 	{
 		Serflash_page_data[loopy] = loopy;
 	}
-	FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page);
 	// verify that data is present.
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page);
+	if(!FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page) ||
+	   !FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page))
+	{
+		Serial_Flash_Chip.ext_flash_working = FALSE;
+		return 0;
+	}
 	for(loopy=0; loopy<num_test_bytes; loopy++)
 	{
 		if(Serflash_page_data[loopy] != (U_BYTE)loopy)
@@ -461,9 +814,28 @@ BOOL FLASH_CheckTheNVChecksum()
 {
 	// if good, return 1. If bad, return 0
 	U_INT32 calculatedCrc;
-	CalcCRC((U_BYTE *)&NVRAM_data, sizeof(NVRAM_image)-4, &calculatedCrc);
-	if (calculatedCrc == NVRAM_data.calculatedCrc)
-		return 1;
+	U_INT32 savedCrc;
+	U_INT16 nSize;
+	U_BYTE nLayout;
+
+	// newest layout first, a block saved by older code has its CRC at the
+	// end of its own layout
+	for(nLayout = 0; nLayout < NV_LAYOUT_VERSION; nLayout++)
+	{
+		nSize = NVRAM_layout_size[nLayout];
+		CalcCRC((U_BYTE *)&NVRAM_data, nSize-4, &calculatedCrc);
+		memcpy(&savedCrc, (U_BYTE *)&NVRAM_data + nSize-4, sizeof(savedCrc));
+		if (calculatedCrc == savedCrc)
+		{
+			// the parameters added since take their defaults, the next
+			// Serflash_check_NV_Block() saves the block in this layout
+			memcpy((U_BYTE *)&NVRAM_data + nSize-4, (const U_BYTE *)&NVRAM_defaults + nSize-4,
+			       sizeof(NVRAM_image) - nSize);
+			NVRAM_data.nLayoutVersion = NV_LAYOUT_VERSION;
+			FLASH_FixTheNVChecksum();
+			return 1;
+		}
+	}
 	return 0;
 }
 
@@ -496,8 +868,9 @@ U_BYTE Serflash_read_NV_Block(void)
 	howmuch_data = sizeof(NVRAM_data);
 	// yikes, if NVRAM_data grows beyond a page we are not prepared for it.
 	if(sizeof(NVRAM_data) > Serial_Flash_Chip.page_size) return 0;
-	// go get all of our data from flash
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+	// go get all of our data from flash, the block in memory is left as
+	// it was when the page does not come in whole
+	if(!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page)) return 0;
 	NV_data_pointer = (U_BYTE *)&NVRAM_data;
 	NV_storage_pointer = (U_BYTE *)&Serflash_page_data[0];
 	for(loopy=0; loopy < howmuch_data; loopy++)
@@ -537,8 +910,9 @@ U_BYTE Serflash_check_NV_Block(void)
 	// if a change, store the whole block to the flash.
 	// then leave and let the unit come around again.
 	// if we make it all the way through without writing a bit, we will flag a complete bit.
-	// pull the data into our buffer
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+	// pull the data into our buffer, without it there is nothing to
+	// compare with, so try again next time
+	if(!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page)) return 0;
 	NV_data_pointer = (U_BYTE *)&NVRAM_data;
 	NV_storage_pointer = (U_BYTE *)&Serflash_page_data[0];
 	for(loopy=0; loopy < howmuch_data; loopy++)
@@ -574,7 +948,7 @@ U_BYTE Serflash_check_NV_Block(void)
 			NV_data_pointer++;
 		}
 		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+		if(!FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page)) return 0;
 	}
 	return 1;
 }
@@ -620,10 +994,13 @@ void Serflash_read_DID_data(void)
 		FLASH_DATA[Serial_Flash_Chip.part_index].startof_page2;
 	Serial_Flash_Chip.EVENTS_start_page =
 		FLASH_DATA[Serial_Flash_Chip.part_index].startof_page3;
+	Serial_Flash_Chip.FIRMWARE_start_page =
+		Serial_Flash_Chip.Max_pages_available - FIRMWARE_IMAGE_PAGES;
 	Serial_Flash_Chip.EVENTS_pages_available =
-		FLASH_DATA[Serial_Flash_Chip.part_index].num_pages;
+		Serial_Flash_Chip.FIRMWARE_start_page;
 	U_INT32 partone = Serial_Flash_Chip.EVENTS_start_page;
 	Serial_Flash_Chip.EVENTS_pages_available -= partone;
+	Serial_Flash_Chip.event_buffer_page = EVENT_BUFFER_EMPTY;
 	g_tFlashIdleTimer = ElapsedTimeLowRes((TIME_RT)0);
 }
 
@@ -634,6 +1011,11 @@ void Set_NV_data_to_defaults(void)
 {
 	NVRAM_data.nDownholeOnTime = NVRAM_defaults.nDownholeOnTime;
 	NVRAM_data.bGamma = NVRAM_defaults.bGamma;
+	NVRAM_data.nCompassType = NVRAM_defaults.nCompassType;
+	SetMagCalibration(FALSE, NULL, NULL);
+	SetLogRecording(NVRAM_defaults.bLogRecording, NVRAM_defaults.nLogInterval);
+	SetModemConfig(FALSE, 0, NULL);
+	NVRAM_data.nLayoutVersion = NV_LAYOUT_VERSION;
 };
 
 /****************************************************************************
@@ -647,6 +1029,20 @@ void Check_NV_data_boundaries(void)
 	if( (NVRAM_data.bGamma < NVRAM_min.bGamma) ||
 		(NVRAM_data.bGamma > NVRAM_max.bGamma) )
 		NVRAM_data.bGamma = NVRAM_defaults.bGamma;
+	if( (NVRAM_data.nCompassType < NVRAM_min.nCompassType) ||
+		(NVRAM_data.nCompassType > NVRAM_max.nCompassType) )
+		NVRAM_data.nCompassType = NVRAM_defaults.nCompassType;
+	if( (NVRAM_data.bMagCalibrated < NVRAM_min.bMagCalibrated) ||
+		(NVRAM_data.bMagCalibrated > NVRAM_max.bMagCalibrated) )
+		SetMagCalibration(FALSE, NULL, NULL);
+	if( (NVRAM_data.bLogRecording < NVRAM_min.bLogRecording) ||
+		(NVRAM_data.bLogRecording > NVRAM_max.bLogRecording) ||
+		(NVRAM_data.nLogInterval < NVRAM_min.nLogInterval) ||
+		(NVRAM_data.nLogInterval > NVRAM_max.nLogInterval) )
+		SetLogRecording(NVRAM_defaults.bLogRecording, NVRAM_defaults.nLogInterval);
+	if( (NVRAM_data.bModemConfigured < NVRAM_min.bModemConfigured) ||
+		(NVRAM_data.bModemConfigured > NVRAM_max.bModemConfigured) )
+		SetModemConfig(FALSE, 0, NULL);
 };
 
 /*******************************************************************************
@@ -681,3 +1077,105 @@ BOOL GetGammaOnOff(void)
 	return NVRAM_data.bGamma;
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void SetCompassType(U_BYTE nType)
+{
+	NVRAM_data.nCompassType = nType;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE GetCompassType(void)
+{
+	return NVRAM_data.nCompassType;
+}
+
+/*******************************************************************************
+*       @details
+*   Keeps the offset and matrix fitted by the calibration, or puts back no
+*   offset and the identity matrix.
+*******************************************************************************/
+void SetMagCalibration(BOOL bCalibrated, const REAL32 *pfOffset, const REAL32 *pfMatrix)
+{
+	if(bCalibrated)
+	{
+		memcpy(NVRAM_data.fMagOffset, pfOffset, sizeof(NVRAM_data.fMagOffset));
+		memcpy(NVRAM_data.fMagMatrix, pfMatrix, sizeof(NVRAM_data.fMagMatrix));
+	}
+	else
+	{
+		memcpy(NVRAM_data.fMagOffset, NVRAM_defaults.fMagOffset, sizeof(NVRAM_data.fMagOffset));
+		memcpy(NVRAM_data.fMagMatrix, NVRAM_defaults.fMagMatrix, sizeof(NVRAM_data.fMagMatrix));
+	}
+	NVRAM_data.bMagCalibrated = bCalibrated ? TRUE : FALSE;
+	NVRAM_data.nMagCalSpare = 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL GetMagCalibration(REAL32 *pfOffset, REAL32 *pfMatrix)
+{
+	memcpy(pfOffset, NVRAM_data.fMagOffset, sizeof(NVRAM_data.fMagOffset));
+	memcpy(pfMatrix, NVRAM_data.fMagMatrix, sizeof(NVRAM_data.fMagMatrix));
+	return NVRAM_data.bMagCalibrated;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void SetLogRecording(BOOL bRecording, U_INT16 nInterval)
+{
+	NVRAM_data.bLogRecording = bRecording ? TRUE : FALSE;
+	NVRAM_data.nLogInterval = nInterval;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL GetLogRecording(void)
+{
+	return NVRAM_data.bLogRecording;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 GetLogInterval(void)
+{
+	return NVRAM_data.nLogInterval;
+}
+
+/*******************************************************************************
+*       @details
+*   Only the copy in RAM, the scheduler writes the NV block out once it
+*   differs from the flash.
+*******************************************************************************/
+void SetModemConfig(BOOL bConfigured, U_INT16 nMode, const U_BYTE *pSerial)
+{
+	if(bConfigured)
+	{
+		NVRAM_data.nModemMode = nMode;
+		memcpy(NVRAM_data.nModemSerial, pSerial, sizeof(NVRAM_data.nModemSerial));
+	}
+	else
+	{
+		NVRAM_data.nModemMode = NVRAM_defaults.nModemMode;
+		memcpy(NVRAM_data.nModemSerial, NVRAM_defaults.nModemSerial, sizeof(NVRAM_data.nModemSerial));
+	}
+	NVRAM_data.bModemConfigured = bConfigured ? TRUE : FALSE;
+	NVRAM_data.nModemSpare = 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL GetModemConfig(U_INT16 *pnMode, U_BYTE *pSerial)
+{
+	*pnMode = NVRAM_data.nModemMode;
+	memcpy(pSerial, NVRAM_data.nModemSerial, sizeof(NVRAM_data.nModemSerial));
+	return NVRAM_data.bModemConfigured;
+}
@@ -22,12 +22,20 @@
 #include "ModemDataRxHandler.h"
 #include "ModemDataTxHandler.h"
 #include "UtilityFunctions.h"
+#include "crc.h"
 #include "SerialCommon.h"
 #include "TargetProtocol.h"
 #include "compass.h"
+#include "compass_cal.h"
 #include "version.h"
 #include "SensorManager_Gamma.h"
-#include "Power.h"
+#include "DataLog.h"
+#include "SampleBuffer.h"
+#include "power.h"
+#include "Scheduler.h"
+#include "BlackBox.h"
+#include "FirmwareUpdate.h"
+#include "CommDriver_UART.h"
 #include "led.h" //whs 19nov2021 without this ... got compiler warn on LED code
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -37,6 +45,96 @@
 serport_type port;
 char sVersionString[20];
 char sDateString[20];
+// mS of streamed compass samples reduced into each survey, 0 sends the last
+static TIME_RT m_tCompassSurveyWindow;
+
+// survey metrics appended to the full data set, behind a version and a
+// length so the uphole reads the fields it knows and skips the rest
+#define FULL_DATA_EXTENSION_VERSION	2
+#define FULL_DATA_EXTENSION_LENGTH	15
+
+// what CMD_COMPASS_CALIBRATE asks for, each is answered with the status
+#define COMPASS_CAL_ACTION_STATUS	0
+#define COMPASS_CAL_ACTION_START	1
+#define COMPASS_CAL_ACTION_FINISH	2
+#define COMPASS_CAL_ACTION_CANCEL	3
+#define COMPASS_CAL_ACTION_CLEAR	4
+
+// what CMD_DATALOG_CONTROL asks for, each is answered with the log status
+#define DATALOG_ACTION_STATUS		0
+#define DATALOG_ACTION_START		1	// followed by the interval, seconds
+#define DATALOG_ACTION_STOP		2
+#define DATALOG_ACTION_CLEAR		3
+
+// most log records in one CMD_DATALOG_READ reply, keeps it under 0x80 bytes
+#define DATALOG_READ_MAX		7
+
+// CMD_GET_SAMPLE_BATCH reply, a header then samples of a fixed length.  The
+// batch is as many as fit in both the modem packet and what the uphole takes,
+// less the command, byte count and checksum.
+#define SAMPLE_BATCH_HEADER_LENGTH	9
+#define SAMPLE_BATCH_RECORD_LENGTH	19
+#define SAMPLE_BATCH_MAX_LENGTH		(MODEM_MAX_MESSAGE_LENGTH - 3)
+
+// CMD_GET_COMPACT_DATA_SET, the full data set with each number sent as a
+// zigzag varint of its change from the last frame the uphole has, unchanged
+// numbers left out, and a CRC-16 in place of the checksum
+#define COMPACT_DATA_VERSION		1
+// flags of the request
+#define COMPACT_REQUEST_IDENTITY	0x01	// send the version and date
+#define COMPACT_REQUEST_KEYFRAME	0x02	// the uphole has no frame to build on
+// flags of the frame
+#define COMPACT_FRAME_KEYFRAME		0x01	// changes are from zero
+#define COMPACT_FRAME_IDENTITY		0x02	// version and date follow the numbers
+// bits of the COMPACT_STATE field
+#define COMPACT_STATE_COMPASS		0x01
+#define COMPACT_STATE_GAMMA_VALID	0x02
+#define COMPACT_STATE_GAMMA_ON		0x04
+
+// most tasks in one CMD_GET_TASK_STATS reply, keeps it under 0x80 bytes
+#define TASK_STATS_MAX			5
+// flags of the request
+#define TASK_STATS_REQUEST_CLEAR	0x01	// start the statistics over once sent
+
+// most events in one CMD_GET_BLACK_BOX reply, keeps it under 0x80 bytes
+#define BLACK_BOX_READ_MAX		8
+// flags of the request
+#define BLACK_BOX_REQUEST_CLEAR		0x01	// empty the ring once sent
+
+// counters of the CMD_GET_LINK_STATS reply, in the order they are sent, a
+// later version only adds to the end
+enum {
+	LINK_STATS_DATALINK_MESSAGES,	// messages queued to the modem UART
+	LINK_STATS_DATALINK_BYTES,
+	LINK_STATS_DATALINK_STALLS,	// messages refused, the queue was full
+	LINK_STATS_DATALINK_DEPTH,	// bytes waiting to go now
+	LINK_STATS_DATALINK_MAX_DEPTH,
+	LINK_STATS_DATALINK_RX_OVERRUNS,
+	LINK_STATS_COMPASS_MESSAGES,	// the same of the compass UART
+	LINK_STATS_COMPASS_BYTES,
+	LINK_STATS_COMPASS_STALLS,
+	LINK_STATS_COMPASS_DEPTH,
+	LINK_STATS_COMPASS_MAX_DEPTH,
+	LINK_STATS_COMPASS_RX_OVERRUNS,
+	LINK_STATS_MODEM_HELD_FRAMES,	// modem frames sent a pass late
+	LINK_STATS_COMPASS_TX_WAITS,	// compass passes held for room
+	LINK_STATS_MODEM_RX_FRAMES,	// modem frames decoded
+	LINK_STATS_MODEM_RX_FRAMING_ERRORS,	// bad length or a stalled frame
+	LINK_STATS_MODEM_RX_CHECKSUM_ERRORS,
+	LINK_STATS_MODEM_RX_OVERFLOWS,	// replies dropped, their queue was full
+	LINK_STATS_COMPASS_RX_FRAMES,	// compass frames decoded
+	LINK_STATS_COMPASS_RX_CHECKSUM_ERRORS,
+	LINK_STATS_COMPASS_RX_DROPPED,	// bytes of a waiting or too long frame
+	LINK_STATS_COUNTERS
+};
+
+// CMD_FIRMWARE_CHUNK carries the chunk number before the data and its CRC-32
+// after it
+#define FIRMWARE_CHUNK_OVERHEAD		6
+
+// most received chunk bitmap bytes in one firmware status reply, keeps it
+// under 0x80 bytes
+#define FIRMWARE_BITMAP_READ_MAX	64
 
 typedef struct
 {
@@ -51,16 +149,79 @@ enum {
 	CMD_SEND_DOWNHOLE_ON_TIME,
 	CMD_SEND_DOWNHOLE_GAMMA_ENABLE,
         CMD_TURN_ON_SENSORS,
+	CMD_SET_COMPASS_STREAM,
+	CMD_GET_BEST_SURVEY,
+	CMD_SET_STILL_WINDOW,
+	CMD_COMPASS_CALIBRATE,
+	CMD_SET_GAMMA_WINDOW,
+	CMD_DATALOG_CONTROL,
+	CMD_DATALOG_READ,
+	CMD_GET_SAMPLE_BATCH,
+	CMD_GET_COMPACT_DATA_SET,
+	CMD_GET_TASK_STATS,
+	CMD_GET_BLACK_BOX,
+	CMD_FIRMWARE_START,
+	CMD_FIRMWARE_CHUNK,
+	CMD_FIRMWARE_STATUS,
+	CMD_FIRMWARE_COMMIT,
+	CMD_GET_LINK_STATS,
 	CMD_NUMBER_OF_COMMANDS
 };
 
+// numbers of the compact data set, in the order of the field mask bits
+enum {
+	COMPACT_STATE,
+	COMPACT_AZIMUTH,
+	COMPACT_PITCH,
+	COMPACT_ROLL,
+	COMPACT_TEMPERATURE,
+	COMPACT_GAMMA,
+	COMPACT_GAMMA_ERROR,
+	COMPACT_BATTERY,
+	COMPACT_SIGNAL,
+	COMPACT_TIME_LEFT,
+	COMPACT_GTOTAL,
+	COMPACT_HTOTAL,
+	COMPACT_DIP,
+	COMPACT_TEMPERATURE_DRIFT,
+	COMPACT_METRIC_SAMPLES,
+	COMPACT_GTOTAL_STD,
+	COMPACT_HTOTAL_STD,
+	COMPACT_SLEEP,		// parts per thousand of the time the core slept
+	COMPACT_BATTERY_MIN,	// lowest battery mV over 32mS
+	COMPACT_SIGNAL_MAX,	// highest peak detect mV over 32mS
+	COMPACT_FIELDS
+};
+
+// the last compact frame sent, and the one the uphole said it has
+static INT32 m_nCompactSent[COMPACT_FIELDS];
+static INT32 m_nCompactBase[COMPACT_FIELDS];
+static U_BYTE m_nCompactSequence = 0;
+static U_BYTE m_nCompactBaseSequence = 0;
+static BOOL m_bCompactSentValid = FALSE;
+static BOOL m_bCompactBaseValid = FALSE;
+// version and date go once each power up, or when asked for
+static BOOL m_bCompactIdentitySent = FALSE;
+
 static void clearTXbuffer(void);
 static void clearTXChecksum(void);
 static void pushTXbuffer(U_BYTE someTXData, U_BYTE addtoChecksum);
 static void pushTXbuffer16(U_INT16 someTXData, U_BYTE addtoChecksum);
 static void pushTXbufferi16(INT16 someTXData, U_BYTE addtoChecksum);
 static void pushTXbuffer32(U_INT32 someTXData, U_BYTE addtoChecksum);
+static void pushTXvarint(U_INT32 someTXData);
 static void RequestFullDataSend(void);
+static void RequestBestSurveySend(void);
+static void RequestCompassCalSend(void);
+static void RequestDataLogStatusSend(void);
+static void RequestDataLogRecordsSend(U_INT32 nFirst, U_BYTE nCount);
+static void RequestSampleBatchSend(U_BYTE nMaxSamples, U_BYTE nMaxLength);
+static void RequestCompactDataSend(U_BYTE nAck, U_BYTE nFlags);
+static void RequestTaskStatsSend(U_BYTE nFirst);
+static void RequestBlackBoxSend(U_BYTE nFirst);
+static void RequestLinkStatsSend(void);
+static void RequestFirmwareStatusSend(U_BYTE nCommand, U_INT16 nFirst);
+static void ReplyFirmwareChunk(U_INT16 nChunk, U_BYTE nResult);
 static void ReplyCommandAccepted(U_BYTE nCommand);
 
 /****************************************************************************
@@ -77,6 +238,8 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 	U_BYTE checksum;
 	U_BYTE nCmdID;
 	U_BYTE nNumberOfRXDataBytes;
+	U_INT16 nChunk;
+	U_BYTE nChunkResult;
 
 	if(nLength > 200) return;
 	// get the command ID
@@ -94,6 +257,10 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 	switch(nCmdID)
 	{
 		case CMD_SEND_FULL_DATA_SET:
+			if((Compass_GetStreamInterval() != 0) && (m_tCompassSurveyWindow != 0))
+			{
+				(void)Compass_ReduceWindow(m_tCompassSurveyWindow);
+			}
 			RequestFullDataSend();
 			break;
 		case CMD_SEND_DOWNHOLE_ON_TIME:
@@ -119,6 +286,163 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
                                 SetGammaPower(FALSE);  // whs added 19Nov2021
                         }
                         break;
+		case CMD_SET_COMPASS_STREAM:
+			if(nNumberOfRXDataBytes < 4)
+				break;
+			// request interval then survey window, both mS
+			Compass_SetStreamInterval(GetUnsignedShort(&theData[index]));
+			m_tCompassSurveyWindow = GetUnsignedShort(&theData[index + 2]);
+			ReplyCommandAccepted(nCmdID);
+			break;
+		case CMD_GET_BEST_SURVEY:
+			RequestBestSurveySend();
+			break;
+		case CMD_SET_STILL_WINDOW:
+			if(nNumberOfRXDataBytes < 2)
+				break;
+			// mS the tool must be still
+			Compass_SetStillWindow(GetUnsignedShort(&theData[index]));
+			ReplyCommandAccepted(nCmdID);
+			break;
+		case CMD_COMPASS_CALIBRATE:
+			if(nNumberOfRXDataBytes < 1)
+				break;
+			switch(GetUnsignedByte(&theData[index]))
+			{
+				case COMPASS_CAL_ACTION_START:
+					CompassCal_Start();
+					break;
+				case COMPASS_CAL_ACTION_FINISH:
+					(void)CompassCal_Finish();
+					break;
+				case COMPASS_CAL_ACTION_CANCEL:
+					CompassCal_Cancel();
+					break;
+				case COMPASS_CAL_ACTION_CLEAR:
+					CompassCal_Cancel();
+					SetMagCalibration(FALSE, NULL, NULL);
+					break;
+				default:
+					break;
+			}
+			RequestCompassCalSend();
+			break;
+		case CMD_SET_GAMMA_WINDOW:
+			if(nNumberOfRXDataBytes < 6)
+				break;
+			// slot period and window in mS, then dead time in nS
+			SetGammaWindow(GetUnsignedShort(&theData[index]),
+						   GetUnsignedShort(&theData[index + 2]),
+						   GetUnsignedShort(&theData[index + 4]));
+			ReplyCommandAccepted(nCmdID);
+			break;
+		case CMD_DATALOG_CONTROL:
+			if(nNumberOfRXDataBytes < 1)
+				break;
+			switch(GetUnsignedByte(&theData[index]))
+			{
+				case DATALOG_ACTION_START:
+					if(nNumberOfRXDataBytes < 3)
+						break;
+					DataLog_Start(GetUnsignedShort(&theData[index + 1]));
+					break;
+				case DATALOG_ACTION_STOP:
+					DataLog_Stop();
+					break;
+				case DATALOG_ACTION_CLEAR:
+					DataLog_Clear();
+					break;
+				default:
+					break;
+			}
+			RequestDataLogStatusSend();
+			break;
+		case CMD_DATALOG_READ:
+			if(nNumberOfRXDataBytes < 5)
+				break;
+			// first record wanted, then how many
+			RequestDataLogRecordsSend(GetUnsignedLong(&theData[index]),
+									  GetUnsignedByte(&theData[index + 4]));
+			break;
+		case CMD_GET_SAMPLE_BATCH:
+			if(nNumberOfRXDataBytes < 6)
+				break;
+			// the next sample wanted, the uphole has the ones before it
+			SampleBuffer_Release(GetUnsignedShort(&theData[index]));
+			// mS between samples, 0 keeps it
+			if(GetUnsignedShort(&theData[index + 2]) != 0)
+			{
+				SampleBuffer_SetInterval(GetUnsignedShort(&theData[index + 2]));
+			}
+			// most samples, and most data bytes the uphole takes in a reply
+			RequestSampleBatchSend(GetUnsignedByte(&theData[index + 4]),
+								   GetUnsignedByte(&theData[index + 5]));
+			break;
+		case CMD_GET_COMPACT_DATA_SET:
+			if(nNumberOfRXDataBytes < 2)
+				break;
+			if((Compass_GetStreamInterval() != 0) && (m_tCompassSurveyWindow != 0))
+			{
+				(void)Compass_ReduceWindow(m_tCompassSurveyWindow);
+			}
+			// the last frame the uphole has, then COMPACT_REQUEST_xxx
+			RequestCompactDataSend(GetUnsignedByte(&theData[index]),
+								   GetUnsignedByte(&theData[index + 1]));
+			break;
+		case CMD_GET_TASK_STATS:
+			if(nNumberOfRXDataBytes < 2)
+				break;
+			// first task wanted, then TASK_STATS_REQUEST_xxx
+			RequestTaskStatsSend(GetUnsignedByte(&theData[index]));
+			if(GetUnsignedByte(&theData[index + 1]) & TASK_STATS_REQUEST_CLEAR)
+			{
+				Scheduler_ClearStats();
+			}
+			break;
+		case CMD_GET_BLACK_BOX:
+			if(nNumberOfRXDataBytes < 2)
+				break;
+			// first event wanted, the oldest is 0, then BLACK_BOX_REQUEST_xxx
+			RequestBlackBoxSend(GetUnsignedByte(&theData[index]));
+			if(GetUnsignedByte(&theData[index + 1]) & BLACK_BOX_REQUEST_CLEAR)
+			{
+				BlackBox_Clear();
+			}
+			break;
+		case CMD_FIRMWARE_START:
+			if(nNumberOfRXDataBytes < 8)
+				break;
+			// image size then its CRC-32, a size of 0 drops the image
+			(void)FirmwareUpdate_Start(GetUnsignedLong(&theData[index]),
+									   GetUnsignedLong(&theData[index + 4]));
+			RequestFirmwareStatusSend(nCmdID, 0);
+			break;
+		case CMD_FIRMWARE_CHUNK:
+			if(nNumberOfRXDataBytes <= FIRMWARE_CHUNK_OVERHEAD)
+				break;
+			// chunk number, the data, then the CRC-32 of the number and data
+			nChunk = GetUnsignedShort(&theData[index]);
+			nChunkResult = FirmwareUpdate_WriteChunk(nChunk, &theData[index + 2],
+				nNumberOfRXDataBytes - FIRMWARE_CHUNK_OVERHEAD,
+				GetUnsignedLong(&theData[index + nNumberOfRXDataBytes - 4]));
+			ReplyFirmwareChunk(nChunk, nChunkResult);
+			break;
+		case CMD_FIRMWARE_STATUS:
+			if(nNumberOfRXDataBytes < 2)
+				break;
+			// first chunk of the bitmap wanted
+			RequestFirmwareStatusSend(nCmdID, GetUnsignedShort(&theData[index]));
+			break;
+		case CMD_FIRMWARE_COMMIT:
+			if(nNumberOfRXDataBytes < 4)
+				break;
+			// the image CRC-32 again, checking starts once every chunk is in
+			(void)FirmwareUpdate_Commit(GetUnsignedLong(&theData[index]));
+			RequestFirmwareStatusSend(nCmdID, 0);
+			break;
+		case CMD_GET_LINK_STATS:
+			RequestLinkStatsSend();
+			break;
 		default:
 		break;
 	}
@@ -197,6 +521,20 @@ static void pushTXbuffer32(U_INT32 someTXData, U_BYTE addtoChecksum)
 	pushTXbuffer( (U_BYTE)(someTXData >> 24), addtoChecksum );
 }
 
+/*******************************************************************************
+*       @details
+*   Seven bits at a time, low first, the top bit set on all but the last.
+*******************************************************************************/
+static void pushTXvarint(U_INT32 someTXData)
+{
+	while(someTXData >= 0x80)
+	{
+		pushTXbuffer( (U_BYTE)(someTXData | 0x80), TRUE );
+		someTXData >>= 7;
+	}
+	pushTXbuffer( (U_BYTE)someTXData, TRUE );
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -206,6 +544,7 @@ void RequestFullDataSend(void)
 	U_INT16 u16Data;
 	INT16 i16Data;
 	U_INT32 u32Data;
+	COMPASS_SURVEY_METRICS metrics;
 	char *sVersionString;
 #define DATE_STRING_LEN 16
 	char sDateString[DATE_STRING_LEN];
@@ -270,6 +609,553 @@ void RequestFullDataSend(void)
 	// on time left
 	u16Data = (U_INT16)(tTimePoweredUp / 1000ul);
 	pushTXbuffer16( u16Data, TRUE );
+	// survey metrics extension
+	Compass_GetSurveyMetrics(&metrics);
+	pushTXbuffer( FULL_DATA_EXTENSION_VERSION, TRUE );
+	pushTXbuffer( FULL_DATA_EXTENSION_LENGTH, TRUE );
+	pushTXbuffer16( metrics.nGtotal, TRUE );
+	pushTXbuffer16( metrics.nHtotal, TRUE );
+	pushTXbufferi16( metrics.nDip, TRUE );
+	pushTXbufferi16( metrics.nTemperatureDrift, TRUE );
+	pushTXbuffer( metrics.nSamples, TRUE );
+	pushTXbuffer16( metrics.nGtotalStd, TRUE );
+	pushTXbuffer16( metrics.nHtotalStd, TRUE );
+	// version 2, standard error of the gamma count, 0.1 counts per second
+	u16Data = GetCurrentGammaError();
+	pushTXbuffer16( u16Data, TRUE );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   The full data set, compact.  The numbers go as changes from the frame
+*   the uphole says it has, nAck, which is the last one sent or the one it
+*   was built on when that reply was lost.  Otherwise, or when asked, the
+*   changes are from zero.  Small changes take a byte, none take nothing.
+*******************************************************************************/
+static void RequestCompactDataSend(U_BYTE nAck, U_BYTE nFlags)
+{
+	INT32 nValues[COMPACT_FIELDS];
+	INT32 nChange;
+	U_INT32 nMask;
+	U_BYTE nField;
+	U_BYTE nFrameFlags;
+	U_BYTE dataCount;
+	COMPASS_SURVEY_METRICS metrics;
+	char *sVersionString;
+	char sDateString[DATE_STRING_LEN];
+
+	// what does the uphole have to build on?
+	if(((nFlags & COMPACT_REQUEST_KEYFRAME) == 0) && m_bCompactSentValid && (nAck == m_nCompactSequence))
+	{
+		memcpy(m_nCompactBase, m_nCompactSent, sizeof(m_nCompactBase));
+		m_nCompactBaseSequence = nAck;
+		m_bCompactBaseValid = TRUE;
+	}
+	else if((nFlags & COMPACT_REQUEST_KEYFRAME) || (nAck != m_nCompactBaseSequence))
+	{
+		m_bCompactBaseValid = FALSE;
+	}
+	// the same numbers as the full data set
+	nValues[COMPACT_STATE] = 0;
+	if((Compass_IsDataValid() == TRUE) && (PowerFlag != 0))
+		nValues[COMPACT_STATE] |= COMPACT_STATE_COMPASS;
+	if(bValidGammaValues)
+		nValues[COMPACT_STATE] |= COMPACT_STATE_GAMMA_VALID;
+	if(GetGammaOnOff())
+		nValues[COMPACT_STATE] |= COMPACT_STATE_GAMMA_ON;
+	nValues[COMPACT_AZIMUTH] = Compass_GetSurveyAzimuth();
+	nValues[COMPACT_PITCH] = Compass_GetSurveyPitch();
+	nValues[COMPACT_ROLL] = Compass_GetSurveyRoll();
+	nValues[COMPACT_TEMPERATURE] = (U_INT16)Compass_GetSurveyTemperature();
+	nValues[COMPACT_GAMMA] = GetCurrentGammaCount();
+	nValues[COMPACT_GAMMA_ERROR] = GetCurrentGammaError();
+	nValues[COMPACT_BATTERY] = GetBatteryInputVoltageU16();
+	nValues[COMPACT_SIGNAL] = GetPeakDetectInputU16();
+	nValues[COMPACT_TIME_LEFT] = (U_INT16)(tTimePoweredUp / 1000ul);
+	Compass_GetSurveyMetrics(&metrics);
+	nValues[COMPACT_GTOTAL] = metrics.nGtotal;
+	nValues[COMPACT_HTOTAL] = metrics.nHtotal;
+	nValues[COMPACT_DIP] = metrics.nDip;
+	nValues[COMPACT_TEMPERATURE_DRIFT] = metrics.nTemperatureDrift;
+	nValues[COMPACT_METRIC_SAMPLES] = metrics.nSamples;
+	nValues[COMPACT_GTOTAL_STD] = metrics.nGtotalStd;
+	nValues[COMPACT_HTOTAL_STD] = metrics.nHtotalStd;
+	nValues[COMPACT_SLEEP] = Power_GetSleepPermille();
+	nValues[COMPACT_BATTERY_MIN] = GetBatteryMinimumVoltageU16();
+	nValues[COMPACT_SIGNAL_MAX] = GetPeakDetectMaximumU16();
+	if(!m_bCompactBaseValid)
+	{
+		memset(m_nCompactBase, 0, sizeof(m_nCompactBase));
+	}
+	nFrameFlags = m_bCompactBaseValid ? 0 : COMPACT_FRAME_KEYFRAME;
+	if((nFlags & COMPACT_REQUEST_IDENTITY) || !m_bCompactIdentitySent)
+	{
+		nFrameFlags |= COMPACT_FRAME_IDENTITY;
+	}
+	m_nCompactSequence++;
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_COMPACT_DATA_SET, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer( COMPACT_DATA_VERSION, TRUE );
+	// this frame, the one it builds on, and COMPACT_FRAME_xxx
+	pushTXbuffer( m_nCompactSequence, TRUE );
+	pushTXbuffer( m_nCompactBaseSequence, TRUE );
+	pushTXbuffer( nFrameFlags, TRUE );
+	// a bit for each number that changed, then the changes in order
+	nMask = 0;
+	for(nField = 0; nField < COMPACT_FIELDS; nField++)
+	{
+		if(nValues[nField] != m_nCompactBase[nField])
+			nMask |= (1ul << nField);
+	}
+	pushTXvarint( nMask );
+	for(nField = 0; nField < COMPACT_FIELDS; nField++)
+	{
+		if((nMask & (1ul << nField)) == 0)
+			continue;
+		// zigzag, so small changes either way stay small
+		nChange = nValues[nField] - m_nCompactBase[nField];
+		pushTXvarint( ((U_INT32)nChange << 1) ^ (U_INT32)(nChange >> 31) );
+	}
+	if(nFrameFlags & COMPACT_FRAME_IDENTITY)
+	{
+		sVersionString = (char *)GetSWVersion();
+		for(dataCount=0; dataCount<MAX_VERSION_LEN; dataCount++)
+			pushTXbuffer( sVersionString[dataCount], TRUE );
+		memset(sDateString, 0, DATE_STRING_LEN);
+		strncpy(sDateString, __DATE__, DATE_STRING_LEN - 1);
+		for(dataCount = 0; dataCount < DATE_STRING_LEN; dataCount++)
+			pushTXbuffer( sDateString[dataCount], TRUE );
+		m_bCompactIdentitySent = TRUE;
+	}
+	memcpy(m_nCompactSent, nValues, sizeof(m_nCompactSent));
+	m_bCompactSentValid = TRUE;
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// CRC-16 of the command, byte count and data
+	pushTXbuffer16( CRC16_Calculate(port.tx.buffer, port.tx.head), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   The survey latched the last time the tool was still, and how good and
+*   how old it is.
+*******************************************************************************/
+static void RequestBestSurveySend(void)
+{
+	COMPASS_BEST_SURVEY survey;
+	U_INT32 u32Data;
+
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_BEST_SURVEY, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	// flag for a survey latched
+	pushTXbuffer( (U_BYTE)Compass_GetBestSurvey(&survey), TRUE );
+	// compass data
+	pushTXbufferi16( survey.nAzimuth, TRUE );
+	pushTXbufferi16( survey.nPitch, TRUE );
+	pushTXbufferi16( survey.nRoll, TRUE );
+	pushTXbufferi16( survey.nTemperature, TRUE );
+	// quality 0 to 100, and the samples averaged
+	pushTXbuffer( survey.nQuality, TRUE );
+	pushTXbuffer( survey.nSamples, TRUE );
+	// seconds since it was latched
+	u32Data = ElapsedTimeLowRes(survey.tLatched) / 1000ul;
+	if(u32Data > 0xFFFFul)
+	{
+		u32Data = 0xFFFFul;
+	}
+	pushTXbuffer16( (U_INT16)u32Data, TRUE );
+	// still right now
+	pushTXbuffer( (U_BYTE)Compass_IsStill(), TRUE );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Where the magnetometer calibration is, and whether one is in use.
+*******************************************************************************/
+static void RequestCompassCalSend(void)
+{
+	REAL32 fOffset[3];
+	REAL32 fMatrix[9];
+
+	clearTXbuffer();
+	pushTXbuffer( CMD_COMPASS_CALIBRATE, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	// COMPASS_CAL_xxx state
+	pushTXbuffer( CompassCal_GetState(), TRUE );
+	// field vectors collected, and the nT rms of the last fit
+	pushTXbuffer16( CompassCal_GetSampleCount(), TRUE );
+	pushTXbuffer16( CompassCal_GetResidual(), TRUE );
+	// calibration applied to the surveys
+	pushTXbuffer( (U_BYTE)GetMagCalibration(fOffset, fMatrix), TRUE );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Whether the log is recording, and how full it is.
+*******************************************************************************/
+static void RequestDataLogStatusSend(void)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_DATALOG_CONTROL, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	// DATALOG_xxx state and seconds between records
+	pushTXbuffer( DataLog_GetState(), TRUE );
+	pushTXbuffer16( DataLog_GetInterval(), TRUE );
+	// records stored, and how many fit
+	pushTXbuffer32( DataLog_GetCount(), TRUE );
+	pushTXbuffer32( DataLog_GetCapacity(), TRUE );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends up to DATALOG_READ_MAX log records starting at nFirst.  Fewer
+*   come back at the end of the log, none past it.
+*******************************************************************************/
+static void RequestDataLogRecordsSend(U_INT32 nFirst, U_BYTE nCount)
+{
+	DATALOG_RECORD record;
+	U_BYTE nSent;
+	U_BYTE nCountIndex;
+
+	if(nCount > DATALOG_READ_MAX)
+		nCount = DATALOG_READ_MAX;
+	clearTXbuffer();
+	pushTXbuffer( CMD_DATALOG_READ, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer32( nFirst, TRUE );
+	// placeholder for the number of records
+	nCountIndex = port.tx.head;
+	pushTXbuffer( 0, TRUE );
+	for(nSent = 0; nSent < nCount; nSent++)
+	{
+		if(!DataLog_GetRecord(nFirst + nSent, &record))
+			break;
+		pushTXbuffer( record.nFlags, TRUE );
+		pushTXbuffer16( record.nSession, TRUE );
+		pushTXbuffer32( record.tTime, TRUE );
+		pushTXbuffer16( record.nGamma, TRUE );
+		pushTXbuffer16( record.nGammaError, TRUE );
+		pushTXbufferi16( record.nInclination, TRUE );
+		pushTXbufferi16( record.nToolface, TRUE );
+	}
+	// go back and touch up the record count, it is in the checksum too
+	port.tx.buffer[nCountIndex] = nSent;
+	port.tx.checksum += nSent;
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the oldest samples kept, as many as nMaxSamples and as fit in
+*   nMaxLength data bytes and in one modem packet.  They stay until the
+*   uphole asks past them, so a lost reply is sent again.
+*******************************************************************************/
+static void RequestSampleBatchSend(U_BYTE nMaxSamples, U_BYTE nMaxLength)
+{
+	SAMPLE_RECORD sample;
+	U_BYTE nFit;
+	U_BYTE nSent;
+	U_BYTE nRemaining;
+
+	// how many fit in the smaller of the two
+	if(nMaxLength > SAMPLE_BATCH_MAX_LENGTH)
+		nMaxLength = SAMPLE_BATCH_MAX_LENGTH;
+	nFit = 0;
+	if(nMaxLength > SAMPLE_BATCH_HEADER_LENGTH)
+		nFit = (nMaxLength - SAMPLE_BATCH_HEADER_LENGTH) / SAMPLE_BATCH_RECORD_LENGTH;
+	if(nMaxSamples > nFit)
+		nMaxSamples = nFit;
+	if(nMaxSamples > SampleBuffer_GetCount())
+		nMaxSamples = SampleBuffer_GetCount();
+	nRemaining = SampleBuffer_GetCount() - nMaxSamples;
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_SAMPLE_BATCH, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	// sequence number of the first sample sent, the rest follow on
+	pushTXbuffer16( SampleBuffer_GetFirstSequence(), TRUE );
+	// mS between samples, and samples lost because nobody asked in time
+	pushTXbuffer16( SampleBuffer_GetInterval(), TRUE );
+	pushTXbuffer16( SampleBuffer_GetDropped(), TRUE );
+	// samples left for the next batch
+	pushTXbuffer( nRemaining, TRUE );
+	// bytes in each sample, a later version only adds to the end
+	pushTXbuffer( SAMPLE_BATCH_RECORD_LENGTH, TRUE );
+	pushTXbuffer( nMaxSamples, TRUE );
+	for(nSent = 0; nSent < nMaxSamples; nSent++)
+	{
+		(void)SampleBuffer_GetSample(nSent, &sample);
+		pushTXbuffer32( sample.tTime, TRUE );
+		pushTXbuffer( sample.nFlags, TRUE );
+		pushTXbufferi16( sample.nAzimuth, TRUE );
+		pushTXbufferi16( sample.nPitch, TRUE );
+		pushTXbufferi16( sample.nRoll, TRUE );
+		pushTXbuffer16( sample.nTemperature, TRUE );
+		pushTXbuffer16( sample.nGamma, TRUE );
+		pushTXbuffer16( sample.nGammaError, TRUE );
+		pushTXbuffer16( sample.nBattery, TRUE );
+	}
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the run statistics of up to TASK_STATS_MAX scheduler tasks starting
+*   at nFirst, with the number of tasks so the uphole knows when it has all.
+*******************************************************************************/
+static void RequestTaskStatsSend(U_BYTE nFirst)
+{
+	SCHEDULER_STATS stats;
+	const char *pName;
+	U_BYTE nSent;
+	U_BYTE nCountIndex;
+	U_BYTE nChar;
+
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_TASK_STATS, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer( Scheduler_GetTaskCount(), TRUE );
+	pushTXbuffer( nFirst, TRUE );
+	// placeholder for the number of tasks
+	nCountIndex = port.tx.head;
+	pushTXbuffer( 0, TRUE );
+	for(nSent = 0; nSent < TASK_STATS_MAX; nSent++)
+	{
+		if(!Scheduler_GetStats(nFirst + nSent, &stats))
+			break;
+		// name padded with spaces
+		pName = Scheduler_GetTaskName(nFirst + nSent);
+		for(nChar = 0; nChar < SCHEDULER_NAME_LENGTH; nChar++)
+		{
+			if(*pName != '\0')
+				pushTXbuffer( (U_BYTE)*pName++, TRUE );
+			else
+				pushTXbuffer( ' ', TRUE );
+		}
+		pushTXbuffer16( (U_INT16)Scheduler_GetTaskPeriod(nFirst + nSent), TRUE );
+		pushTXbuffer32( stats.nRuns, TRUE );
+		pushTXbuffer16( (stats.nMisses > 0xFFFF) ? 0xFFFF : (U_INT16)stats.nMisses, TRUE );
+		pushTXbuffer32( stats.nWorstMicroSeconds, TRUE );
+		pushTXbuffer32( stats.nAverageMicroSeconds, TRUE );
+	}
+	// go back and touch up the task count, it is in the checksum too
+	port.tx.buffer[nCountIndex] = nSent;
+	port.tx.checksum += nSent;
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the serial link counters, LINK_STATS_xxx, after the number of them.
+*******************************************************************************/
+static void RequestLinkStatsSend(void)
+{
+	U_INT32 nCounters[LINK_STATS_COUNTERS];
+	UART_TX_STATS stats;
+	U_BYTE nCounter;
+
+	UART_GetTxStats(CLIENT_DATA_LINK, &stats);
+	nCounters[LINK_STATS_DATALINK_MESSAGES] = stats.nMessages;
+	nCounters[LINK_STATS_DATALINK_BYTES] = stats.nBytes;
+	nCounters[LINK_STATS_DATALINK_STALLS] = stats.nStalls;
+	nCounters[LINK_STATS_DATALINK_DEPTH] = stats.nDepth;
+	nCounters[LINK_STATS_DATALINK_MAX_DEPTH] = stats.nMaxDepth;
+	nCounters[LINK_STATS_DATALINK_RX_OVERRUNS] = UART_GetRxOverruns(CLIENT_DATA_LINK);
+	UART_GetTxStats(CLIENT_COMPASS, &stats);
+	nCounters[LINK_STATS_COMPASS_MESSAGES] = stats.nMessages;
+	nCounters[LINK_STATS_COMPASS_BYTES] = stats.nBytes;
+	nCounters[LINK_STATS_COMPASS_STALLS] = stats.nStalls;
+	nCounters[LINK_STATS_COMPASS_DEPTH] = stats.nDepth;
+	nCounters[LINK_STATS_COMPASS_MAX_DEPTH] = stats.nMaxDepth;
+	nCounters[LINK_STATS_COMPASS_RX_OVERRUNS] = UART_GetRxOverruns(CLIENT_COMPASS);
+	nCounters[LINK_STATS_MODEM_HELD_FRAMES] = ModemData_GetHeldFrames();
+	nCounters[LINK_STATS_COMPASS_TX_WAITS] = Compass_GetTxWaitCount();
+	nCounters[LINK_STATS_MODEM_RX_FRAMES] = ModemData_GetRxFrameCount();
+	nCounters[LINK_STATS_MODEM_RX_FRAMING_ERRORS] = ModemData_GetRxFramingErrors();
+	nCounters[LINK_STATS_MODEM_RX_CHECKSUM_ERRORS] = ModemData_GetRxChecksumErrors();
+	nCounters[LINK_STATS_MODEM_RX_OVERFLOWS] = ModemData_GetRxOverflows();
+	nCounters[LINK_STATS_COMPASS_RX_FRAMES] = Compass_GetFrameCount();
+	nCounters[LINK_STATS_COMPASS_RX_CHECKSUM_ERRORS] = Compass_GetChecksumErrorCount();
+	nCounters[LINK_STATS_COMPASS_RX_DROPPED] = Compass_GetOverrunCount();
+
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_LINK_STATS, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer( LINK_STATS_COUNTERS, TRUE );
+	for(nCounter = 0; nCounter < LINK_STATS_COUNTERS; nCounter++)
+	{
+		pushTXbuffer32( nCounters[nCounter], TRUE );
+	}
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends up to BLACK_BOX_READ_MAX black box events starting at nFirst, after
+*   the reset counts, the least free stack and the number of events.  Each
+*   event goes with the name of the task that was running.
+*******************************************************************************/
+static void RequestBlackBoxSend(U_BYTE nFirst)
+{
+	BLACKBOX_EVENT event;
+	const char *pName;
+	U_BYTE nSent;
+	U_BYTE nCountIndex;
+	U_BYTE nChar;
+
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_BLACK_BOX, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer16( BlackBox_GetResets(), TRUE );
+	pushTXbuffer16( BlackBox_GetWatchdogResets(), TRUE );
+	pushTXbuffer16( BlackBox_GetStackFree(), TRUE );
+	pushTXbuffer( BlackBox_GetCount(), TRUE );
+	pushTXbuffer( nFirst, TRUE );
+	// placeholder for the number of events
+	nCountIndex = port.tx.head;
+	pushTXbuffer( 0, TRUE );
+	for(nSent = 0; nSent < BLACK_BOX_READ_MAX; nSent++)
+	{
+		if(!BlackBox_GetEvent(nFirst + nSent, &event))
+			break;
+		pushTXbuffer( event.nType, TRUE );
+		// name padded with spaces, all spaces between tasks
+		pName = Scheduler_GetTaskName(event.nTask);
+		for(nChar = 0; nChar < SCHEDULER_NAME_LENGTH; nChar++)
+		{
+			if(*pName != '\0')
+				pushTXbuffer( (U_BYTE)*pName++, TRUE );
+			else
+				pushTXbuffer( ' ', TRUE );
+		}
+		pushTXbuffer16( event.nData, TRUE );
+		pushTXbuffer32( event.tTime, TRUE );
+	}
+	// go back and touch up the event count, it is in the checksum too
+	port.tx.buffer[nCountIndex] = nSent;
+	port.tx.checksum += nSent;
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends the firmware update state, then up to FIRMWARE_BITMAP_READ_MAX
+*   bytes of the received chunk bitmap from the byte holding chunk nFirst.
+*   Answers start, status and commit, nCommand is the one asked.
+*******************************************************************************/
+static void RequestFirmwareStatusSend(U_BYTE nCommand, U_INT16 nFirst)
+{
+	U_INT16 nByte;
+	U_INT16 nBytes;
+	U_BYTE nSent;
+	U_BYTE nCountIndex;
+
+	nByte = nFirst / 8;
+	nBytes = (FirmwareUpdate_GetChunkCount() + 7) / 8;
+	clearTXbuffer();
+	pushTXbuffer( nCommand, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer( FirmwareUpdate_GetState(), TRUE );
+	pushTXbuffer32( FirmwareUpdate_GetSize(), TRUE );
+	pushTXbuffer32( FirmwareUpdate_GetCRC(), TRUE );
+	pushTXbuffer16( FirmwareUpdate_GetReceivedCount(), TRUE );
+	pushTXbuffer16( nByte * 8, TRUE );
+	// placeholder for the number of bitmap bytes
+	nCountIndex = port.tx.head;
+	pushTXbuffer( 0, TRUE );
+	for(nSent = 0; nSent < FIRMWARE_BITMAP_READ_MAX; nSent++)
+	{
+		if((nByte + nSent) >= nBytes)
+			break;
+		pushTXbuffer( FirmwareUpdate_GetReceived(nByte + nSent), TRUE );
+	}
+	// go back and touch up the bitmap byte count, it is in the checksum too
+	port.tx.buffer[nCountIndex] = nSent;
+	port.tx.checksum += nSent;
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), FALSE );
+	// send the charming lark
+	Modem_MessageToSend(port.tx.buffer, port.tx.head);
+}
+
+/*******************************************************************************
+*       @details
+*   Answers a firmware chunk with what became of it, FIRMWARE_CHUNK_xxx, and
+*   how many chunks are in.
+*******************************************************************************/
+static void ReplyFirmwareChunk(U_INT16 nChunk, U_BYTE nResult)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_FIRMWARE_CHUNK, FALSE );
+	// placeholder for the byte count
+	pushTXbuffer( 0, FALSE );
+	pushTXbuffer16( nChunk, TRUE );
+	pushTXbuffer( nResult, TRUE );
+	pushTXbuffer16( FirmwareUpdate_GetReceivedCount(), TRUE );
 	// go back and touch up the byte count
 	port.tx.buffer[1] = port.tx.checked_bytes;
 	// now push the checksum that we built up
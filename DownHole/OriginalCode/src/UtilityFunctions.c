@@ -44,4 +44,11 @@ U_BYTE GetUnsignedByte(U_BYTE* packet)
     U_BYTE value = 0;
     memcpy((void *)&value, (const void *)packet, sizeof(value));
     return value;
+}
+
+U_INT32 GetUnsignedLong(U_BYTE* packet)
+{
+    U_INT32 value = 0;
+    memcpy((void *)&value, (const void *)packet, sizeof(value));
+    return value;
 }
\ No newline at end of file
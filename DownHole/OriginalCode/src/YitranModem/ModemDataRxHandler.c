@@ -22,7 +22,11 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
-#define MODEM_RECEIVE_BUFFER_SIZE   512
+// a frame that stops arriving for this long is dropped, mS
+#define MODEM_RX_FRAME_TIMEOUT      50
+
+// replies of one type decoded while the one before is still being handled
+#define MODEM_REPLY_QUEUE_SIZE      4
 
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
@@ -30,52 +34,70 @@
 
 typedef enum {
 	MODEM_RX_WAITING_FOR_COMMAND,
-	MODEM_RX_WAITING_FOR_LENGTH,
+	MODEM_RX_WAITING_FOR_LENGTH_LOW,
+	MODEM_RX_WAITING_FOR_LENGTH_HIGH,
 	MODEM_RX_WAITING_FOR_TYPE,
 	MODEM_RX_WAITING_FOR_OPCODE,
-	MODEM_RX_WAITING_FOR_DATA
+	MODEM_RX_WAITING_FOR_DATA,
+	MODEM_RX_WAITING_FOR_CHECKSUM
 }MODEM_STATE_RX;
 
+// the replies waiting behind m_nResponse or m_nIndication, oldest first
+typedef struct
+{
+	MODEM_REPLY_DATA_STRUCT Replies[MODEM_REPLY_QUEUE_SIZE];
+	U_BYTE nFirst;
+	U_BYTE nCount;
+	U_INT32 nOverflows;		// replies dropped because the queue was full
+} MODEM_REPLY_QUEUE;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
-static MODEM_REPLY_TYPE getReplyOpCodeIndex(U_BYTE nOpCode);
-//static void modemData_ProcessRxMessage(void);
-//static MODEM_REPLY_TYPE getReplyType(U_BYTE nOpCode);
+static void modemData_DecodeByte(U_BYTE nData);
+static void modemData_DispatchRxMessage(void);
+static void modemData_StoreReply(MODEM_REPLY_DATA_STRUCT *pSlot, MODEM_REPLY_QUEUE *pQueue);
+static void modemData_NextReply(MODEM_REPLY_DATA_STRUCT *pSlot, MODEM_REPLY_QUEUE *pQueue);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
+// when the last bytes had arrived, stamped by the UART receive interrupt
 static TIME_RT tMessageGapTimer;
-static U_BYTE m_nModemReceiveBuffer[MODEM_RECEIVE_BUFFER_SIZE];
-static U_INT16 m_nModemReceiveBufferHead;
-static U_INT16 m_nModemReceiveBufferTail;
-//static MODEM_STATE_RX m_nModemStateMachine_RX;
+static MODEM_STATE_RX m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
 static MODEM_COMMAND_STRUCT m_nModemRxCommand;
-static U_BYTE  m_nModemReceivedLengthByteCount;
-//static U_INT16 m_nModemReceivedDataByteCount;
+static U_INT16 m_nModemReceivedDataByteCount;
+// bytes that are not a frame are one framing error until the next frame starts
+static BOOL m_bModemRxInSync = TRUE;
+static U_INT32 m_nModemRxFrameCount = 0;
+static U_INT32 m_nModemRxFramingErrors = 0;
+static U_INT32 m_nModemRxChecksumErrors = 0;
 static const MODEM_REPLY_DATA_STRUCT m_nDefaultModemReplyData = {0, INVALID_MODEM_REPLY, {0}, FALSE};
 MODEM_REPLY_DATA_STRUCT m_nResponse = {0, INVALID_MODEM_REPLY, {0}, FALSE};
 MODEM_REPLY_DATA_STRUCT m_nIndication = {0, INVALID_MODEM_REPLY, {0}, FALSE};
-static const U_BYTE m_nModemReplyOpCodeList[MAX_MODEM_REPLY] = {
-	MODEM_OPCODE_NOP,
-	MODEM_OPCODE_RESET,
-	MODEM_OPCODE_GO_ONLINE,
-	MODEM_OPCODE_GO_OFFLINE,
-	MODEM_OPCODE_GET_DEVICE_PARAM,
-	MODEM_OPCODE_SET_DEVICE_PARAM,
-	MODEM_OPCODE_SAVE_DEVICE_PARAM,
-	MODEM_OPCODE_GET_DB_SIZE,
-	MODEM_OPCODE_GET_NODE_INFO,
-	MODEM_OPCODE_DELETE_NODE_INFO,
-	MODEM_OPCODE_TX_PACKET,
-	MODEM_OPCODE_NET_ID_ASSIGNED,
-	MODEM_OPCODE_CONNECTIVITY_STATUS,
-	MODEM_OPCODE_CONNECTED_TO_NC,
-	MODEM_OPCODE_DISCONNECTED_FROM_NC,
-	MODEM_OPCODE_RX_PACKET,
+static MODEM_REPLY_QUEUE m_ResponseQueue;
+static MODEM_REPLY_QUEUE m_IndicationQueue;
+// opcode to reply type, every opcode not named is INVALID_MODEM_REPLY
+static const U_BYTE m_nModemReplyOpCodeIndex[256] = {
+	[0 ... 255]                         = INVALID_MODEM_REPLY,
+	[MODEM_OPCODE_NOP]                  = MODEM_RESPONSE_NOP,
+	[MODEM_OPCODE_RESET]                = MODEM_RESPONSE_RESET,
+	[MODEM_OPCODE_GO_ONLINE]            = MODEM_RESPONSE_GO_ONLINE,
+	[MODEM_OPCODE_GO_OFFLINE]           = MODEM_RESPONSE_GO_OFFLINE,
+	[MODEM_OPCODE_GET_DEVICE_PARAM]     = MODEM_RESPONSE_GET_PARAM,
+	[MODEM_OPCODE_SET_DEVICE_PARAM]     = MODEM_RESPONSE_SET_PARAM,
+	[MODEM_OPCODE_SAVE_DEVICE_PARAM]    = MODEM_RESPONSE_SAVE_PARAM,
+	[MODEM_OPCODE_GET_DB_SIZE]          = MODEM_RESPONSE_GET_DB_SIZE,
+	[MODEM_OPCODE_GET_NODE_INFO]        = MODEM_RESPONSE_GET_NODE_INFO,
+	[MODEM_OPCODE_DELETE_NODE_INFO]     = MODEM_RESPONSE_DELETE_NODE_INFO,
+	[MODEM_OPCODE_TX_PACKET]            = MODEM_RESPONSE_TX_PACKET,
+	[MODEM_OPCODE_NET_ID_ASSIGNED]      = MODEM_INDICATION_NET_ID_ASSIGNED,
+	[MODEM_OPCODE_CONNECTIVITY_STATUS]  = MODEM_INDICATION_CONNECTIVITY_STATUS,
+	[MODEM_OPCODE_CONNECTED_TO_NC]      = MODEM_INDICATION_CONNECTED_TO_NC,
+	[MODEM_OPCODE_DISCONNECTED_FROM_NC] = MODEM_INDICATION_DISCONNECTED_FROM_NC,
+	[MODEM_OPCODE_RX_PACKET]            = MODEM_INDICATION_RX_PACKET,
 };
 
 //============================================================================//
@@ -84,138 +106,266 @@ static const U_BYTE m_nModemReplyOpCodeList[MAX_MODEM_REPLY] = {
 
 /*******************************************************************************
 *       @details
+*       The response has been handled, the next one queued takes its place
+*       on the next pass.
 *******************************************************************************/
-static MODEM_REPLY_TYPE getReplyOpCodeIndex(U_BYTE nOpCode)
+void ModemData_ResetRxResponse(void)
 {
-	U_BYTE nIndex = 0;
-
-	do
-	{
-		if(m_nModemReplyOpCodeList[nIndex] == nOpCode)
-		{
-			return (MODEM_REPLY_TYPE)nIndex;
-		}
-	}
-	while(nIndex++ < MAX_MODEM_REPLY);
-	return INVALID_MODEM_REPLY;
-}//end getReplyOpCodeIndex
+	m_nResponse = m_nDefaultModemReplyData;
+}
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
-void ModemData_ResetRxResponse(void)
+void ModemData_ResetRxIndication(void)
 {
-	m_nResponse = m_nDefaultModemReplyData;
+	m_nIndication = m_nDefaultModemReplyData;
 }
 
 /*******************************************************************************
 *       @details
+*       Drops every response and indication not handled yet, for a modem
+*       that is starting over.
 *******************************************************************************/
-void ModemData_ResetRxIndication(void)
+void ModemData_FlushRx(void)
 {
+	m_nResponse = m_nDefaultModemReplyData;
 	m_nIndication = m_nDefaultModemReplyData;
+	m_ResponseQueue.nCount = 0;
+	m_IndicationQueue.nCount = 0;
 }
 
-// timed buffer method..
-
 /*******************************************************************************
 *       @details
+*       Drops a serial message part way through, after the UART lost some of
+*       the bytes received.  The decoder waits for the next command byte.
 *******************************************************************************/
-void ModemData_ReceiveData(U_BYTE nData)
+void ModemData_ResyncRx(void)
 {
-	m_nModemReceiveBuffer[m_nModemReceiveBufferHead++] = nData;
-	if(m_nModemReceiveBufferHead >= MODEM_RECEIVE_BUFFER_SIZE)
+	if(m_nModemStateMachine_RX != MODEM_RX_WAITING_FOR_COMMAND)
 	{
-		m_nModemReceiveBufferHead = 0;
+		m_nModemRxFramingErrors++;
+		m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
 	}
-	tMessageGapTimer = ElapsedTimeLowRes((TIME_RT)0);
-}//end ModemData_ReceiveRxData
+}
 
 /*******************************************************************************
 *       @details
+*       Decodes a span of bytes straight from the UART receive DMA buffer,
+*       tStamp is when the last of them had arrived.
 *******************************************************************************/
-U_BYTE getBufferByte(void)
+void ModemData_ReceiveData(const U_BYTE *pData, U_INT16 nLength, TIME_RT tStamp)
 {
-	U_BYTE nTempData = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-	if(m_nModemReceiveBufferTail >= MODEM_RECEIVE_BUFFER_SIZE)
+	while(nLength--)
 	{
-		m_nModemReceiveBufferTail = 0;
+		modemData_DecodeByte(*pData++);
 	}
-	return nTempData;
-} // getBufferByte
+	tMessageGapTimer = tStamp;
+}//end ModemData_ReceiveData
 
 /****************************************************************************
  *
  * Function Name:   ProcessModemBuffer
  *
- * Abstract:        wait for and process modem serial messages
+ * Abstract:        hand on the next queued reply, and drop a modem
+ *                  serial message that stopped part way
  *
  ****************************************************************************/
 void ProcessModemBuffer(void)
 {
-	U_BYTE nTempData;
-	U_INT16 nModemReceivedDataByteCount;
-	BOOL bResult;
-
-	// only process if there are characters
-	if(m_nModemReceiveBufferHead == m_nModemReceiveBufferTail) return;
-	// and some time has passed..
-	if(ElapsedTimeLowRes(tMessageGapTimer) < 10) return;
-	// we have a message, process it
-	nTempData = getBufferByte();
-	if((nTempData != CONFIGURATION_CONSTANT) && (nTempData != COMMAND_CONSTANT)) return;
-	m_nModemRxCommand.nCommand = nTempData;
-	m_nModemReceivedLengthByteCount = 0;
-	m_nModemRxCommand.nLength.AsBytes[m_nModemReceivedLengthByteCount++] = getBufferByte();
-	getBufferByte();
-	m_nModemRxCommand.nType = getBufferByte();
-	m_nModemRxCommand.nOpCode = getBufferByte();
-	nModemReceivedDataByteCount = 0;
-	while(nModemReceivedDataByteCount < (m_nModemRxCommand.nLength.AsHalfWord - 2))
+	// one queued reply of each type moves up once the last has been handled
+	modemData_NextReply(&m_nResponse, &m_ResponseQueue);
+	modemData_NextReply(&m_nIndication, &m_IndicationQueue);
+	// a frame that stopped part way is dropped, so the next one is not lost
+	if((m_nModemStateMachine_RX != MODEM_RX_WAITING_FOR_COMMAND) &&
+	   (ElapsedTimeLowRes(tMessageGapTimer) >= MODEM_RX_FRAME_TIMEOUT))
 	{
-		m_nModemRxCommand.nData[nModemReceivedDataByteCount++] = getBufferByte();
+		m_nModemRxFramingErrors++;
+		m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
 	}
-	m_nModemRxCommand.nCheckSum = getBufferByte();
-	bResult = computeCheckSum(&m_nModemRxCommand, FALSE);
-	if(bResult)
+} // end ProcessModemBuffer
+
+/*******************************************************************************
+*       @details
+*       One step of the frame state machine, the length is the full 16 bits
+*       and counts the type and opcode bytes, so it must be at least 2.
+*******************************************************************************/
+static void modemData_DecodeByte(U_BYTE nData)
+{
+	switch(m_nModemStateMachine_RX)
 	{
-		switch(m_nModemRxCommand.nCommand)
-		{
-			case CONFIGURATION_CONSTANT:
-				//This is for auto modem detection.
-				SetModemIsPresent(TRUE);
-				//Nothing else to do here.  This is the welcome message for firmware upgrade.
-				break;
-			case COMMAND_CONSTANT:
+		case MODEM_RX_WAITING_FOR_COMMAND:
+			if((nData != CONFIGURATION_CONSTANT) && (nData != COMMAND_CONSTANT))
 			{
-				switch(m_nModemRxCommand.nType)
+				if(m_bModemRxInSync)
 				{
-					case TYPE_RESPONSE: // 0x01
-						m_nResponse.nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
-						m_nResponse.eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
-						memcpy((void *)&m_nResponse.nData, (const void *)&m_nModemRxCommand.nData, m_nResponse.nLength);
-						if(m_nResponse.eReply != INVALID_MODEM_REPLY)
-						{
-							m_nResponse.bReplyReady = TRUE;
-						}
-						break;
-					case TYPE_INDICATION: // 0x02
-						m_nIndication.nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
-						m_nIndication.eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
-						memcpy((void *)&m_nIndication.nData, (const void *)&m_nModemRxCommand.nData, m_nIndication.nLength);
-						if(m_nIndication.eReply != INVALID_MODEM_REPLY)
-						{
-							m_nIndication.bReplyReady = TRUE;
-						}
-						break;
-					default:
-						break;
+					m_nModemRxFramingErrors++;
+					m_bModemRxInSync = FALSE;
 				}
+				break;
 			}
+			m_bModemRxInSync = TRUE;
+			m_nModemRxCommand.nCommand = nData;
+			m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_LENGTH_LOW;
+			break;
+		case MODEM_RX_WAITING_FOR_LENGTH_LOW:
+			m_nModemRxCommand.nLength.AsBytes[0] = nData;
+			m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_LENGTH_HIGH;
 			break;
+		case MODEM_RX_WAITING_FOR_LENGTH_HIGH:
+			m_nModemRxCommand.nLength.AsBytes[1] = nData;
+			if((m_nModemRxCommand.nLength.AsHalfWord < 2) ||
+			   (m_nModemRxCommand.nLength.AsHalfWord > (MODEM_MESSAGE_BUFFER_SIZE + 2)))
+			{
+				m_nModemRxFramingErrors++;
+				m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
+				break;
+			}
+			m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_TYPE;
+			break;
+		case MODEM_RX_WAITING_FOR_TYPE:
+			m_nModemRxCommand.nType = nData;
+			m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_OPCODE;
+			break;
+		case MODEM_RX_WAITING_FOR_OPCODE:
+			m_nModemRxCommand.nOpCode = nData;
+			m_nModemReceivedDataByteCount = 0;
+			m_nModemStateMachine_RX = (m_nModemRxCommand.nLength.AsHalfWord > 2) ?
+				MODEM_RX_WAITING_FOR_DATA : MODEM_RX_WAITING_FOR_CHECKSUM;
+			break;
+		case MODEM_RX_WAITING_FOR_DATA:
+			m_nModemRxCommand.nData[m_nModemReceivedDataByteCount++] = nData;
+			if(m_nModemReceivedDataByteCount >= (m_nModemRxCommand.nLength.AsHalfWord - 2))
+			{
+				m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_CHECKSUM;
+			}
+			break;
+		case MODEM_RX_WAITING_FOR_CHECKSUM:
+			m_nModemRxCommand.nCheckSum = nData;
+			m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
+			if(computeCheckSum(&m_nModemRxCommand, FALSE))
+			{
+				m_nModemRxFrameCount++;
+				modemData_DispatchRxMessage();
+			}
+			else
+			{
+				m_nModemRxChecksumErrors++;
+			}
+			break;
+		default:
+			m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
+			break;
+	}
+}
 
-			default:
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemData_DispatchRxMessage(void)
+{
+	switch(m_nModemRxCommand.nCommand)
+	{
+		case CONFIGURATION_CONSTANT:
+			//This is for auto modem detection.
+			SetModemIsPresent(TRUE);
+			//Nothing else to do here.  This is the welcome message for firmware upgrade.
+			break;
+		case COMMAND_CONSTANT:
+			switch(m_nModemRxCommand.nType)
+			{
+				case TYPE_RESPONSE: // 0x01
+					modemData_StoreReply(&m_nResponse, &m_ResponseQueue);
+					break;
+				case TYPE_INDICATION: // 0x02
+					modemData_StoreReply(&m_nIndication, &m_IndicationQueue);
+					break;
+				default:
+					break;
+			}
+			break;
+		default:
 			break;
-		}
 	}
-} // end ProcessModemBuffer
+}
+
+/*******************************************************************************
+*       @details
+*       A reply goes straight into its slot when the slot and the queue
+*       behind it are empty, otherwise to the end of the queue, so replies
+*       that arrive back to back are each handled in turn.
+*******************************************************************************/
+static void modemData_StoreReply(MODEM_REPLY_DATA_STRUCT *pSlot, MODEM_REPLY_QUEUE *pQueue)
+{
+	MODEM_REPLY_DATA_STRUCT *pReply;
+	MODEM_REPLY_TYPE eReply = (MODEM_REPLY_TYPE)m_nModemReplyOpCodeIndex[m_nModemRxCommand.nOpCode];
+
+	if(eReply == INVALID_MODEM_REPLY)
+	{
+		return;
+	}
+	if(!pSlot->bReplyReady && (pQueue->nCount == 0))
+	{
+		pReply = pSlot;
+	}
+	else if(pQueue->nCount < MODEM_REPLY_QUEUE_SIZE)
+	{
+		pReply = &pQueue->Replies[(pQueue->nFirst + pQueue->nCount) % MODEM_REPLY_QUEUE_SIZE];
+		pQueue->nCount++;
+	}
+	else
+	{
+		pQueue->nOverflows++;
+		return;
+	}
+	pReply->nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
+	pReply->eReply = eReply;
+	memcpy((void *)&pReply->nData, (const void *)&m_nModemRxCommand.nData, pReply->nLength);
+	pReply->bReplyReady = TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void modemData_NextReply(MODEM_REPLY_DATA_STRUCT *pSlot, MODEM_REPLY_QUEUE *pQueue)
+{
+	if(pSlot->bReplyReady || (pQueue->nCount == 0))
+	{
+		return;
+	}
+	*pSlot = pQueue->Replies[pQueue->nFirst];
+	pQueue->nFirst = (pQueue->nFirst + 1) % MODEM_REPLY_QUEUE_SIZE;
+	pQueue->nCount--;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 ModemData_GetRxFrameCount(void)
+{
+	return m_nModemRxFrameCount;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 ModemData_GetRxFramingErrors(void)
+{
+	return m_nModemRxFramingErrors;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 ModemData_GetRxChecksumErrors(void)
+{
+	return m_nModemRxChecksumErrors;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 ModemData_GetRxOverflows(void)
+{
+	return m_ResponseQueue.nOverflows + m_IndicationQueue.nOverflows;
+}
@@ -128,6 +128,12 @@ static U_INT16 m_nTxPacketTag = 0;
 ///@brief
 static U_INT32 m_nTxMessageTransactionCounter = 0;
 
+///@brief bytes of the frame in m_nModemTransmitBuffer the UART has not taken yet
+static U_INT16 m_nHeldFrameLength = 0;
+
+///@brief frames the UART queue had no room for when they were made
+static U_INT32 m_nHeldFrames = 0;
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -142,6 +148,7 @@ BOOL Modem_MessageToSend(U_BYTE *pData, U_INT32 nLength)
     if(m_nSendingMessage.bMessageInBuffer) return FALSE;
     if(pData == NULL) return FALSE;
     if(nLength == 0) return FALSE;
+    if(nLength > MODEM_MAX_MESSAGE_LENGTH) return FALSE;
     m_nSendingMessage.nMessageLength = nLength;
     memcpy((void*)m_nSendingMessage.nMessageData, (const void*)pData, m_nSendingMessage.nMessageLength);
     m_nSendingMessage.bMessageInBuffer = TRUE;
@@ -185,7 +192,7 @@ BOOL TxMessageSent(void)
 void ModemData_ProcessTxPacketRequest(void)
 {
     MODEM_TX_PACKET_STRUCT nPacketHeader;
-    U_BYTE nDataToTx[256];
+    U_BYTE nDataToTx[MODEM_MESSAGE_BUFFER_SIZE];
 
     nPacketHeader.nDataServiceType = 1;
     nPacketHeader.nPriority = 0;
@@ -212,7 +219,7 @@ void ModemData_ProcessTxPacketRequest(void)
     memcpy((void *)&nDataToTx[11], (const void*)&m_nTxMessageTransactionCounter, sizeof(m_nTxMessageTransactionCounter));
     memcpy((void *)&nDataToTx[15], (const void*)m_nSendingMessage.nMessageData, m_nSendingMessage.nMessageLength);
 
-    ModemData_ProcessRequest(MODEM_REQUEST_TX_PACKET, nDataToTx, (11 + 4 + m_nSendingMessage.nMessageLength));
+    ModemData_ProcessRequest(MODEM_REQUEST_TX_PACKET, nDataToTx, (MODEM_TX_PACKET_HEADER_LENGTH + m_nSendingMessage.nMessageLength));
     m_nSendingMessage.bMessageSent = TRUE;
 }
 
@@ -280,9 +287,56 @@ void ModemData_ProcessRequest(MODEM_REQUEST eOpCode, U_BYTE *pRequestData, U_INT
 
     nLength = copyMessageToTxBuffer();
 
-    UART_SendMessage(CLIENT_DATA_LINK, (const U_BYTE *)m_nModemTransmitBuffer, nLength);
+    // a full queue keeps the frame for ModemData_SendHeldRequest, it takes
+    // the place of any frame still held, which the modem would answer late
+    m_nHeldFrameLength = 0;
+    if(!UART_SendMessage(CLIENT_DATA_LINK, (const U_BYTE *)m_nModemTransmitBuffer, nLength))
+    {
+        m_nHeldFrameLength = nLength;
+        m_nHeldFrames++;
+    }
 }//end ModemData_ProcessRequest
 
+/*!
+********************************************************************************
+*       @details
+*   Tries again with the frame the UART queue had no room for, called each
+*   pass of the modem manager.
+*******************************************************************************/
+
+void ModemData_SendHeldRequest(void)
+{
+    if(m_nHeldFrameLength == 0)
+    {
+        return;
+    }
+    if(UART_SendMessage(CLIENT_DATA_LINK, (const U_BYTE *)m_nModemTransmitBuffer, m_nHeldFrameLength))
+    {
+        m_nHeldFrameLength = 0;
+    }
+}
+
+/*!
+********************************************************************************
+*       @details
+*   Drops a held frame, the modem is being reset and would not know it.
+*******************************************************************************/
+
+void ModemData_FlushTx(void)
+{
+    m_nHeldFrameLength = 0;
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+
+U_INT32 ModemData_GetHeldFrames(void)
+{
+    return m_nHeldFrames;
+}
+
 /*!
 ********************************************************************************
 *       @details
@@ -27,6 +27,8 @@
 #include "ModemResponseHandler.h"
 #include "ModemDriver.h"
 #include "UtilityFunctions.h"
+#include "BlackBox.h"
+#include "FlashMemory.h"
 
 //============================================================================//
 //      CONSTANTS                                                             //
@@ -48,6 +50,12 @@
 
 #endif
 
+// the modem does not take requests straight after its reset banner, the
+// first request is sent again this often, this many times, before the
+// usual response timeout applies
+#define MODEM_READY_POLL_TIME	TWO_HUNDRED_MILLI_SECONDS
+#define MODEM_READY_POLLS		4
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -71,6 +79,11 @@ typedef enum {
 static MODEM_STATE nModemManagerStateMachine = MODEM_HW_RESET;
 static MODEM_STATE nSavedModemManagerStateMachine = MODEM_HW_RESET;
 static BOOL bModemDiscovery = TRUE;
+// TRUE while the serial number alone is being checked against the record
+static BOOL bConfigCached = FALSE;
+// requests sent again since the reset banner, MODEM_READY_POLLS once the
+// modem has answered
+static U_BYTE nReadyPolls = MODEM_READY_POLLS;
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -91,6 +104,77 @@ void Initialize_Ytran_Modem(void)
 	nModemManagerStateMachine = MODEM_HW_RESET;
 	nSavedModemManagerStateMachine = MODEM_HW_RESET;
 	bModemDiscovery = TRUE;
+	bConfigCached = FALSE;
+	nReadyPolls = MODEM_READY_POLLS;
+}
+
+/*******************************************************************************
+*       @details
+*   TRUE when the NV block holds the mode and serial number this build sets,
+*   a new build that changes either starts over.  The NV block keeps them
+*   through a power cycle so a modem already set up needs only its serial
+*   number checked.
+*******************************************************************************/
+static BOOL ModemConfig_IsCached(void)
+{
+	U_BYTE nSerial[MODEM_SN_LENGTH];
+	U_INT16 nMode;
+
+	return GetModemConfig(&nMode, nSerial) &&
+		(nMode == CORRECT_NC_MODE) &&
+		(memcmp(nSerial, sSerialNumber, MODEM_SN_LENGTH) == 0);
+}
+
+/*******************************************************************************
+*       @details
+*   Written only when it changes, after both parameters were read back.
+*******************************************************************************/
+static void ModemConfig_Save(void)
+{
+	if(ModemConfig_IsCached())
+	{
+		return;
+	}
+	SetModemConfig(TRUE, CORRECT_NC_MODE, sSerialNumber);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void ModemConfig_Clear(void)
+{
+	SetModemConfig(FALSE, 0, NULL);
+}
+
+/*******************************************************************************
+*       @details
+*   TRUE when the response waiting is not the answer to the request eRequest
+*   sends.  A request sent again while the modem was starting can be
+*   answered twice, and the second answer must not be taken for the answer
+*   to the next request.  Both parameters come back as GET_PARAM, only the
+*   serial number is MODEM_SN_LENGTH long.
+*******************************************************************************/
+static BOOL ModemManager_IsStaleResponse(MODEM_STATE eRequest)
+{
+	BOOL bSerialNumber = (m_nResponse.nLength == (1 + MODEM_SN_LENGTH));
+	BOOL bSuccess = (m_nResponse.nData[REPLY_STATUS_INDEX] == COMMAND_SUCCESS);
+
+	switch(eRequest)
+	{
+		case MODEM_GET_NC_MODE:
+			return (m_nResponse.eReply != MODEM_RESPONSE_GET_PARAM) || (bSuccess && bSerialNumber);
+		case MODEM_GET_SERIAL_NUM:
+			return (m_nResponse.eReply != MODEM_RESPONSE_GET_PARAM) || (bSuccess && !bSerialNumber);
+		case MODEM_SET_NC_MODE:
+		case MODEM_SET_SERIAL_NUM:
+			return (m_nResponse.eReply != MODEM_RESPONSE_SET_PARAM);
+		case MODEM_SAVE_PARAM:
+			return (m_nResponse.eReply != MODEM_RESPONSE_SAVE_PARAM);
+		case MODEM_GO_ONLINE:
+			return (m_nResponse.eReply != MODEM_RESPONSE_GO_ONLINE);
+		default:
+			return FALSE;
+	}
 }
 
 /*******************************************************************************
@@ -100,6 +184,19 @@ void ModemManager(void)
 {
 	static TIME_RT tDelayTimeout;
 	static BOOL bFirstRunTrough = TRUE;
+	MODEM_STATE eRequest;
+
+	// a request the UART queue had no room for goes before anything new
+	ModemData_SendHeldRequest();
+
+	// an answer to some other request is dropped, the one waited for may
+	// still come
+	eRequest = (nModemManagerStateMachine == MODEM_RESPONSE_WAIT) ?
+		nSavedModemManagerStateMachine : nModemManagerStateMachine;
+	if(m_nResponse.bReplyReady && ModemManager_IsStaleResponse(eRequest))
+	{
+		ModemData_ResetRxResponse();
+	}
 
 	switch(nModemManagerStateMachine)
 	{
@@ -119,7 +216,8 @@ void ModemManager(void)
 			{
 				bFirstRunTrough = TRUE;
 				tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
-				ModemData_ResetRxResponse();
+				ModemData_FlushRx();
+				ModemData_FlushTx();
 				ModemDriver_PutInHardwareReset(FALSE);
 				nModemManagerStateMachine = MODEM_RESET_WAIT;
 			}
@@ -128,7 +226,7 @@ void ModemManager(void)
 		case MODEM_SW_RESET:
 		{
 			tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
-			ModemData_ResetRxResponse();
+			ModemData_FlushRx();
 			ModemData_ProcessRequest(MODEM_REQUEST_SW_RESET, NULL, 0);
 			nModemManagerStateMachine = MODEM_RESET_WAIT;
 		}
@@ -143,6 +241,12 @@ void ModemManager(void)
 				nModemManagerStateMachine = MODEM_RESET_DONE;
 				ModemData_ResetRxResponse();
 				bModemDiscovery = FALSE;
+				nReadyPolls = 0;
+			}
+			else if(m_nResponse.bReplyReady)
+			{
+				// from before the reset, the banner may be queued behind it
+				ModemData_ResetRxResponse();
 			}
 			else if(ElapsedTimeLowRes(tDelayTimeout) > FIVE_SECOND)
 			{
@@ -157,9 +261,16 @@ void ModemManager(void)
 		break;
 		case MODEM_RESET_DONE:
 		{
-			if(ElapsedTimeLowRes(tDelayTimeout) > ONE_SECOND)
+			// a modem set up before has its serial number read and goes
+			// on line if it is the one in the record, there is no waiting
+			// here, the first request is sent again until the modem answers
+			bConfigCached = ModemConfig_IsCached();
+			if(bConfigCached)
+			{
+				nModemManagerStateMachine = MODEM_GET_SERIAL_NUM;
+			}
+			else
 			{
-				tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
 				nModemManagerStateMachine = MODEM_GET_NC_MODE;
 			}
 		}
@@ -236,12 +347,20 @@ void ModemManager(void)
 				{
 					if(memcmp((const void *)&m_nResponse.nData[1],(const void *)&sSerialNumber[0], MODEM_SN_LENGTH) == 0)
 					{
+						ModemConfig_Save();
 						nModemManagerStateMachine = MODEM_GO_ONLINE;
 					}
+					else if(bConfigCached)
+					{
+						// another modem, its mode has not been checked
+						ModemConfig_Clear();
+						nModemManagerStateMachine = MODEM_GET_NC_MODE;
+					}
 					else
 					{
 						nModemManagerStateMachine = MODEM_SET_SERIAL_NUM;
 					}
+					bConfigCached = FALSE;
 				}
 				ModemData_ResetRxResponse();
 			}
@@ -312,8 +431,7 @@ void ModemManager(void)
 			{
 				tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
 //				tHeartBeatMonitor = ElapsedTimeLowRes(START_LOW_RES_TIMER);
-				ModemData_ResetRxResponse();
-				ModemData_ResetRxIndication();
+				ModemData_FlushRx();
 				ModemData_ProcessRequest(MODEM_REQUEST_GO_ONLINE, NULL, 0);
 				nSavedModemManagerStateMachine = nModemManagerStateMachine;
 				nModemManagerStateMachine = MODEM_RESPONSE_WAIT;
@@ -371,6 +489,15 @@ void ModemManager(void)
 		{
 			if(m_nResponse.bReplyReady)
 			{
+				nReadyPolls = MODEM_READY_POLLS;
+				nModemManagerStateMachine = nSavedModemManagerStateMachine;
+				nSavedModemManagerStateMachine = MODEM_HW_RESET;
+			}
+			else if((nReadyPolls < MODEM_READY_POLLS) &&
+				(ElapsedTimeLowRes(tDelayTimeout) > MODEM_READY_POLL_TIME))
+			{
+				// not taking requests yet, send it again
+				nReadyPolls++;
 				nModemManagerStateMachine = nSavedModemManagerStateMachine;
 				nSavedModemManagerStateMachine = MODEM_HW_RESET;
 			}
@@ -382,4 +509,6 @@ void ModemManager(void)
 		}
 		break;
 	}
+	BlackBox_SetModemState((U_BYTE)nModemManagerStateMachine,
+		nModemManagerStateMachine == MODEM_ONLINE);
 }
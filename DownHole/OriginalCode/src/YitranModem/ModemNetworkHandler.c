@@ -13,7 +13,7 @@
 
 #include <string.h>
 #include "main.h"
-#include "systick.h"
+#include "SysTick.h"
 #include "ModemDataHandler.h"
 #include "ModemNetworkHandler.h"
 #include "ModemDriver.h"
@@ -20,7 +20,7 @@
 #include "ModemNetworkHandler.h"
 #include "ModemResponseHandler.h"
 #include "ModemManager.h"
-#include "systick.h"
+#include "SysTick.h"
 #include "UtilityFunctions.h"
 
 //============================================================================//
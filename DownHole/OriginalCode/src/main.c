@@ -63,6 +63,7 @@ streams each.
 * DMA1 channel 4 stream 5 is used for the compass UART2 RX
 * DMA1 channel 4 stream 6 is used for the compass UART2 TX* DMA2 channel 2 stream 0 is used for the battery voltage AD conversion via ADC3.
 * DMA2 channel 0 stream 4 is used for the peak detector AD conversion via ADC1.
+* TIM2 triggers both AD conversions, 1000 a second, the DMAs run circular.
 * DMA2 channel 4 stream 5 is used for the data link UART1 RX
 * DMA2 channel 4 stream 7 is used for the data link UART1 TX
 */
@@ -88,9 +89,14 @@ streams each.
 #include "power.h"
 #include "RealTimeClock.h"
 #include "FlashMemory.h"
+#include "DataLog.h"
+#include "SampleBuffer.h"
 #include "compass.h"
 #include "SensorManager_Gamma.h"
 #include "SysTick.h"
+#include "Scheduler.h"
+#include "BlackBox.h"
+#include "FirmwareUpdate.h"
 #include "wdt.h"
 // whs 22Nov2021 added below to access Gamma power
 #include "TargetProtocol.h"
@@ -101,6 +107,7 @@ streams each.
 
 static void systemInit(void);
 static void setup_RCC(void);
+static void checkNVBlock(void);
 
 //============================================================================//
 //      VARIABLE DECLARATIONS                                                 //
@@ -115,6 +122,34 @@ TIME_RT tTimePoweredUp;
 //#define STOP_METHOD_EVENT 1
 //#define STOP_METHOD STOP_METHOD_INTERRUPT
 
+// what the run state does, in the order it is done each pass.  Tasks with a
+// period of 0 hand on what the interrupts brought in, so run every pass.
+static const SCHEDULER_TASK m_RunTasks[] =
+{
+	// function                     name    period                  deadline
+	// hands the serial data the receive interrupts have marked to the modem
+	// and compass, read in place from the DMA receiving buffer
+	{UART_ServiceRxBuffer,          "UART", 0,                      TWENTY_MILLI_SECONDS},
+	// drop a Yitran message that stopped part way
+	{ProcessModemBuffer,            "MDMB", 0,                      TWENTY_MILLI_SECONDS},
+	// process any rx characters coming back from the compass, before the
+	// state machine so it sees the reply this pass
+	{Compass_ProcessRxData,         "CMPR", 0,                      TWENTY_MILLI_SECONDS},
+	{Compass_StateManager,          "CMPS", 0,                      TWENTY_MILLI_SECONDS},
+	// the gamma window times its own slots
+	{UpdateGammaCountsThisPeriod,   "GAMA", TEN_MILLI_SECONDS,      TEN_MILLI_SECONDS},
+	{DataLog_Service,               "DLOG", TEN_MILLI_SECONDS,      TEN_MILLI_SECONDS},
+	{SampleBuffer_Service,          "SMPL", TEN_MILLI_SECONDS,      TEN_MILLI_SECONDS},
+	{ModemManager,                  "MDMM", TEN_MILLI_SECONDS,      TEN_MILLI_SECONDS},
+	{checkNVBlock,                  "NVBK", HUNDRED_MILLI_SECONDS,  FIFTY_MILLI_SECONDS},
+	// make sure that there are no goofy values
+	{Check_NV_data_boundaries,      "NVCK", ONE_SECOND,             HALF_SECOND},
+	// keeps the black box time alive and measures the stack
+	{BlackBox_Service,              "BBOX", HUNDRED_MILLI_SECONDS,  FIFTY_MILLI_SECONDS},
+	// checks a firmware image once every chunk is in
+	{FirmwareUpdate_Service,        "FWUP", TEN_MILLI_SECONDS,      TEN_MILLI_SECONDS},
+};
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -177,7 +212,6 @@ void change_wakeup_counter_seconds(U_INT16 time)
 
 int main(void)
 {
-	static U_INT16 analog_phase = 0;
     TIME_RT tTimeStarted;
 #if LEDUSE == 2
     TIME_RT tUtilityDelayTimer;
@@ -185,7 +219,6 @@ int main(void)
 #endif
     RTC_InitTypeDef RTC_InitStructure;
     BOOL result;
-    U_INT16 nCheckGammaDivider = 0;
 
     // the clock is setup in the system_stm32f4xx.c file..
     // internal oscillator is 16MHz (HSI_VALUE)
@@ -235,6 +268,8 @@ int main(void)
     // to avoid rewriting the kick everywhere, kicking the IWDG is now in the KickWatchdog function.
     // this will initialize SRAM as well as the RTC
     NVPower_Initialize(); // does not use systick or timers
+    // before the interrupts, the stack is painted
+    BlackBox_Initialize();
     SPI_Initialize(); // does not use systick or timers
     Initialize_UARTs(); // does not use systick or timers
     ADC_Initialize();
@@ -264,6 +299,9 @@ int main(void)
     Check_NV_data_boundaries();
 
     Initialize_Gamma_Sensor(); // after NV values are loaded
+    DataLog_Initialize();
+    // a firmware transfer carries on where it got to before the reset
+    FirmwareUpdate_Initialize();
     Initialize_Ytran_Modem();
 
     /* Enable the PWR clock */
@@ -315,34 +353,15 @@ int main(void)
     GPIO_WriteBit(GAMMA_POWER_PORT, GAMMA_POWER_PIN, Bit_SET);
     SetGammaPower(FALSE);  // whs added 19Nov2021    
     ADC_SetMeasurementDividerPower(1);
+    // battery and peak detect are sampled and filtered from here on
+    ADC_Start();
+    Scheduler_Initialize(m_RunTasks, sizeof(m_RunTasks) / sizeof(m_RunTasks[0]));
     tTimeStarted = ElapsedTimeLowRes(0);
     while (1)
     {
         tTimePoweredUp = ElapsedTimeLowRes(tTimeStarted);
 //        tTimeLeftmS = tTimeElapsed;
         KickWatchdog();
-		switch(analog_phase)
-		{
-			case 0:
-				ADC_SoftwareStartConv(ADC1);
-				analog_phase++;
-				break;
-			case 1:
-		        if(ElapsedTimeLowRes(tTimeStarted) > 1000) analog_phase++;
-				break;
-			case 2:
-//    SetStatusLEDState(1);
-				if(ADC_GetSoftwareStartConvStatus(ADC1) == 0)
-				{
-					PeakDetectInputu16 = (U_INT16)(3300u * (U_INT32)ADC_GetConversionValue(ADC1) / 4095u);
-					PeakDetectInputIsValid = TRUE;
-					analog_phase++;
-				}
-				break;
-			default:
-				// kick back, tasty waves..
-				break;
-		}
         switch(system_state)
         {
             case STATE_POWUP:
@@ -354,52 +373,12 @@ int main(void)
                         state_changed = 0;
 //                        tLiveTimer = ElapsedTimeLowRes(0);
                 }
-                // This function moves serial data from the DMA receiving buffer to the
-                // main receive buffer for the UART module.  It should be big enough to
-                // handle a full Cycle Handler's worth of data
-                UART_ServiceRxBufferDMA();
-                // This function moves serial data from the UART receiving buffer to the
-                // applications message buffer.  It should be big enough to handle a
-                // full Serial Message.
-                UART_ServiceRxBuffer();
-                // handle the Ytran RX buffer
-                ProcessModemBuffer();
-                // Run the state machine that manages the compass sensor
-                Compass_StateManager();
-                // process any rx characters coming back from the compass
-                Compass_ProcessRxData();
-                if(Ten_mS_tick_flag)
-                {
-                    Ten_mS_tick_flag = 0;
-                    // if any modem message was processed, we get a flag
-                    if(ProcessedCommsMessageFlag)
-                    {
-                            ProcessedCommsMessageFlag = 0;
-                    }
-                    nCheckGammaDivider++;
-                    if(nCheckGammaDivider >= 20)
-                    {
-                            // aiming for 200mS intervals
-                            // after the first 5 readings, a valid value is available
-                            nCheckGammaDivider = 0;
-                            UpdateGammaCountsThisPeriod();
-                    }
-                    ModemManager();
-                }
-                if(Hundred_mS_tick_flag)
-                {
-                    Hundred_mS_tick_flag = 0;
-                    Serflash_check_NV_Block();
-                }
-                if(Thousand_mS_tick_flag)
-                {
-                    Thousand_mS_tick_flag = 0;
-					ADC_Start();
-                    // make sure that there are no goofy values
-                    Check_NV_data_boundaries();
-                }
+                // every task that is due, see m_RunTasks
+                Scheduler_Run();
                 break;
         }
+        // sleep until the next task is due or serial data
+        Power_Idle();
     }
 
     return -1;
@@ -551,6 +530,26 @@ static void setup_RCC(void)
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_SPI1, ENABLE);
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1, ENABLE);
     RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART2, ENABLE);
-    // not sure if TMR2 is used at all
+    // TMR2 triggers the battery and peak detect conversions
     RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
 }
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   checkNVBlock()
+;
+; Description:
+;   Scheduler task for Serflash_check_NV_Block, whose result the loop never
+;   used.
+;
+; Reentrancy:
+;   No
+;
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void checkNVBlock(void)
+{
+    (void)Serflash_check_NV_Block();
+}
@@ -88,6 +88,10 @@ void prvGetRegistersFromStack(U_INT32 *pulFaultStackAddress )
   */
 void HardFault_Handler(void)
 {
+#ifdef HOST_BUILD
+	// the host simulation has no exception stack frame to unwind
+	__BKPT(0);
+#else
 	// see www.freertos.org/Debugging-Hard-Faults-On-Cortex-M-Microcontrollers.html
 	__asm volatile
 	(
@@ -111,6 +115,7 @@ void HardFault_Handler(void)
 //		" bx r2                                                        \n"
 //		" handler2_address_const: .word prvGetRegistersFromStack       \n"
 	);
+#endif
 }
 
 /**
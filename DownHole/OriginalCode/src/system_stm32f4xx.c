@@ -361,8 +361,12 @@
 /*!< Uncomment the following line if you need to relocate your vector Table in
      Internal SRAM. */
 /* #define VECT_TAB_SRAM */
-#define VECT_TAB_OFFSET  0x00 /*!< Vector Table base offset field.
+/* The application starts after the bootloader, FIRMWARE_BOOTLOADER_SIZE in
+   FirmwareUpdate.h, the bootloader is built with VECT_TAB_OFFSET=0x00 */
+#ifndef VECT_TAB_OFFSET
+#define VECT_TAB_OFFSET  0x8000 /*!< Vector Table base offset field.
                                    This value must be a multiple of 0x200. */
+#endif
 /******************************************************************************/
 
 /************************* PLL Parameters *************************************/
@@ -28,6 +28,9 @@ typedef enum
 	SPI_DEVICE_FRAM
 }SPI_DEVICE;
 
+// called from the DMA interrupt when a transfer ends, true if it completed
+typedef void (*SPI_TRANSFER_CALLBACK)(BOOL bComplete);
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -41,6 +44,10 @@ extern "C" {
 	void SPI_ResetTransferTimeOut(void);
 	BOOL SPI_ChipSelect(SPI_DEVICE nDevice, BOOL bSelect);
 	U_BYTE SPI_TransferByte(U_BYTE nDataByte);
+	BOOL SPI_StartTransfer(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength,
+		SPI_TRANSFER_CALLBACK pCallback);
+	BOOL SPI_IsTransferBusy(void);
+	BOOL SPI_Transfer(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength);
 
 #ifdef __cplusplus
 }
@@ -31,6 +31,12 @@ extern "C" {
 	U_INT16 GetDownholeBatteryVoltage(void);
         U_INT16 GetDownholeBattery2Voltage(void);
 	U_INT16 GetDownholeSignalStrength(void);
+	void SetDownholeSleepPermille(U_INT16 SleepPermille);
+	U_INT16 GetDownholeSleepPermille(void);
+	void SetDownholeBatteryMinimum(U_INT16 BatVoltage);
+	U_INT16 GetDownholeBatteryMinimum(void);
+	void SetDownholeSignalMaximum(U_INT16 SignalStrength);
+	U_INT16 GetDownholeSignalMaximum(void);
 //	U_INT32 GetDownholeTotalOnTime(void);
 	void SetAwakeTimeSetting(INT16 AwakeTimeSetting);
 	INT16 GetAwakeTimeSetting(void);
@@ -0,0 +1,66 @@
+/*******************************************************************************
+*       @brief      Header File for DownholeBlackBox.c.
+*       @file       Uphole/inc/DataManagers/DownholeBlackBox.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef DOWNHOLE_BLACK_BOX_H
+#define DOWNHOLE_BLACK_BOX_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// most events the downhole sends in one reply
+#define DOWNHOLE_BLACK_BOX_READ_MAX	8
+
+// characters of the task name sent with an event
+#define DOWNHOLE_EVENT_TASK_LENGTH	4
+
+// nType of an event
+#define DOWNHOLE_EVENT_RESET		1	// nData reset flags, modem state above
+#define DOWNHOLE_EVENT_STACK		2	// nData least free stack words
+#define DOWNHOLE_EVENT_MODEM_ONLINE	3	// nData modem state
+#define DOWNHOLE_EVENT_MODEM_OFFLINE	4	// nData modem state
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// one event of the downhole black box
+typedef struct
+{
+	U_BYTE nType;			// DOWNHOLE_EVENT_xxx
+	char sTask[DOWNHOLE_EVENT_TASK_LENGTH + 1];	// spaces when none was running
+	U_INT16 nData;
+	U_INT32 tTime;			// mS since that power up
+} DOWNHOLE_EVENT;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void DownholeBlackBox_StartDownload(void);
+	BOOL DownholeBlackBox_IsDownloading(void);
+	void DownholeBlackBox_ReceiveEvents(U_INT16 nResets, U_INT16 nWatchdogResets, U_INT16 nStackFree,
+		U_BYTE nTotal, U_BYTE nFirst, U_BYTE nCount, const DOWNHOLE_EVENT *pEvents);
+	void DownholeBlackBox_Service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DOWNHOLE_BLACK_BOX_H
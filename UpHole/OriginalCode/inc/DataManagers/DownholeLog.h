@@ -0,0 +1,75 @@
+/*******************************************************************************
+*       @brief      Header File for DownholeLog.c.
+*       @file       Uphole/inc/DataManagers/DownholeLog.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef DOWNHOLE_LOG_H
+#define DOWNHOLE_LOG_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// downhole log states, as the downhole sends them
+#define DOWNHOLE_LOG_STOPPED		0
+#define DOWNHOLE_LOG_RECORDING		1
+#define DOWNHOLE_LOG_CLEARING		2
+#define DOWNHOLE_LOG_FULL		3
+
+// nFlags of a record
+#define DOWNHOLE_LOG_FLAG_GAMMA		0x01	// gamma window was full
+#define DOWNHOLE_LOG_FLAG_COMPASS	0x02	// compass was answering
+
+// most records the downhole sends in one reply
+#define DOWNHOLE_LOG_READ_MAX		7
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// one record of the downhole gamma and inclination log
+typedef struct
+{
+	U_BYTE nFlags;			// DOWNHOLE_LOG_FLAG_xxx
+	U_INT16 nSession;		// downhole power ups since the log was cleared
+	U_INT32 tTime;			// mS since that power up
+	U_INT16 nGamma;			// counts per second
+	U_INT16 nGammaError;		// 0.1 counts per second
+	INT16 nInclination;		// degrees times 10
+	INT16 nToolface;		// degrees times 10
+} DOWNHOLE_LOG_RECORD;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void DownholeLog_SetStatus(U_BYTE nState, U_INT16 nInterval, U_INT32 nCount, U_INT32 nCapacity);
+	U_BYTE DownholeLog_GetState(void);
+	U_INT32 DownholeLog_GetCount(void);
+	BOOL DownholeLog_IsRecording(void);
+	void DownholeLog_SetRecording(BOOL bRecording);
+	void DownholeLog_Clear(void);
+	void DownholeLog_StartDownload(void);
+	BOOL DownholeLog_IsDownloading(void);
+	void DownholeLog_ReceiveRecords(U_INT32 nFirst, U_BYTE nCount, const DOWNHOLE_LOG_RECORD *pRecords);
+	void DownholeLog_Service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DOWNHOLE_LOG_H
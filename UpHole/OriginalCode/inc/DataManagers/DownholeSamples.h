@@ -0,0 +1,72 @@
+/*******************************************************************************
+*       @brief      Header File for DownholeSamples.c.
+*       @file       Uphole/inc/DataManagers/DownholeSamples.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef DOWNHOLE_SAMPLES_H
+#define DOWNHOLE_SAMPLES_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// nFlags of a sample, as the downhole sends them
+#define DOWNHOLE_SAMPLE_FLAG_COMPASS	0x01	// compass was answering
+#define DOWNHOLE_SAMPLE_FLAG_GAMMA	0x02	// gamma window was full
+
+// most samples asked for in one batch, the downhole sends fewer when they
+// do not fit in a modem packet
+#define DOWNHOLE_SAMPLES_READ_MAX	10
+
+// samples kept here, newest first
+#define DOWNHOLE_SAMPLES_HISTORY	32
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// one sample the downhole took between polls
+typedef struct
+{
+	U_INT32 tTime;			// downhole mS since power up
+	U_BYTE nFlags;			// DOWNHOLE_SAMPLE_FLAG_xxx
+	INT16 nAzimuth;			// degrees times 10
+	INT16 nPitch;			// degrees times 10
+	INT16 nRoll;			// degrees times 10
+	U_INT16 nTemperature;
+	U_INT16 nGamma;			// counts per second
+	U_INT16 nGammaError;		// 0.1 counts per second
+	U_INT16 nBattery;
+} DOWNHOLE_SAMPLE;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void DownholeSamples_Poll(U_INT32 tPollTime);
+	void DownholeSamples_ReceiveBatch(U_INT16 nFirst, U_INT16 nDropped, U_BYTE nRemaining,
+									  U_BYTE nCount, const DOWNHOLE_SAMPLE *pSamples);
+	void DownholeSamples_Service(void);
+	U_BYTE DownholeSamples_GetCount(void);
+	BOOL DownholeSamples_GetSample(U_BYTE nIndex, DOWNHOLE_SAMPLE *pSample);
+	U_INT16 DownholeSamples_GetDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DOWNHOLE_SAMPLES_H
@@ -0,0 +1,66 @@
+/*******************************************************************************
+*       @brief      Header File for DownholeTasks.c.
+*       @file       Uphole/inc/DataManagers/DownholeTasks.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef DOWNHOLE_TASKS_H
+#define DOWNHOLE_TASKS_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// most tasks the downhole sends in one reply
+#define DOWNHOLE_TASKS_READ_MAX		5
+
+// characters of a task name
+#define DOWNHOLE_TASK_NAME_LENGTH	4
+
+// most serial link counters kept from a reply, a newer downhole may send more
+#define DOWNHOLE_LINK_COUNTERS_MAX	24
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// run statistics of one downhole scheduler task
+typedef struct
+{
+	char sName[DOWNHOLE_TASK_NAME_LENGTH + 1];
+	U_INT16 nPeriod;		// mS between runs, 0 is every pass
+	U_INT32 nRuns;
+	U_INT16 nMisses;		// runs started past the deadline
+	U_INT32 nWorstMicroSeconds;
+	U_INT32 nAverageMicroSeconds;
+} DOWNHOLE_TASK;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void DownholeTasks_StartDownload(void);
+	void DownholeTasks_Clear(void);
+	BOOL DownholeTasks_IsDownloading(void);
+	void DownholeTasks_ReceiveTasks(U_BYTE nTotal, U_BYTE nFirst, U_BYTE nCount, const DOWNHOLE_TASK *pTasks);
+	void DownholeTasks_ReceiveLinkStats(U_BYTE nCount, const U_INT32 *pCounters);
+	void DownholeTasks_Service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DOWNHOLE_TASKS_H
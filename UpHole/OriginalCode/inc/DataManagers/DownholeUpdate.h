@@ -0,0 +1,77 @@
+/*******************************************************************************
+*       @brief      Header File for DownholeUpdate.c.
+*       @file       Uphole/inc/DataManagers/DownholeUpdate.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef DOWNHOLE_UPDATE_H
+#define DOWNHOLE_UPDATE_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// bytes of the image in a chunk, the last chunk has what is left
+#define DOWNHOLE_FIRMWARE_CHUNK_SIZE	128
+
+// most received chunk bitmap bytes the downhole sends in one reply
+#define DOWNHOLE_FIRMWARE_BITMAP_MAX	64
+
+// marks the header page of an image in the serial flash
+#define DOWNHOLE_IMAGE_MAGIC		0x44484657ul
+
+// state of the downhole update
+#define DOWNHOLE_FIRMWARE_IDLE		0	// it has no image
+#define DOWNHOLE_FIRMWARE_RECEIVING	1	// it is taking chunks
+#define DOWNHOLE_FIRMWARE_VERIFYING	2	// it is checking the whole image
+#define DOWNHOLE_FIRMWARE_READY		3	// installed at the next reset
+#define DOWNHOLE_FIRMWARE_FAILED	4	// the image did not check out
+
+// what became of a chunk
+#define DOWNHOLE_CHUNK_OK		0	// it is in, or was already
+#define DOWNHOLE_CHUNK_NOT_RECEIVING	1	// the downhole is not taking chunks
+#define DOWNHOLE_CHUNK_BAD_NUMBER	2	// no such chunk, or the wrong length
+#define DOWNHOLE_CHUNK_BAD_CRC		3	// spoilt on the way
+#define DOWNHOLE_CHUNK_FLASH_ERROR	4	// the downhole flash did not take it
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// the first page of the firmware image area, the image follows it
+typedef struct
+{
+	U_INT32 nMagic;			// DOWNHOLE_IMAGE_MAGIC
+	U_INT32 nSize;			// bytes of the image
+	U_INT32 nCRC;			// CRC32_Update of the image bytes
+} DOWNHOLE_IMAGE_HEADER;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void DownholeUpdate_Start(void);
+	BOOL DownholeUpdate_IsUpdating(void);
+	void DownholeUpdate_ReceiveStatus(U_BYTE nState, U_INT32 nSize, U_INT32 nCRC, U_INT16 nReceived,
+		U_INT16 nFirst, U_BYTE nCount, const U_BYTE *pBitmap);
+	void DownholeUpdate_ReceiveChunk(U_INT16 nChunk, U_BYTE nResult, U_INT16 nReceived);
+	void DownholeUpdate_Service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DOWNHOLE_UPDATE_H
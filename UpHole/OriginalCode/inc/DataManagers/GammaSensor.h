@@ -28,6 +28,8 @@ extern "C" {
 	void SetGammaPoweredState(U_BYTE gammaPoweredState);
 	void SetSurveyGamma(U_INT16 nData);
 	U_INT16 GetSurveyGamma(void);
+	void SetSurveyGammaError(U_INT16 nData);
+	U_INT16 GetSurveyGammaError(void);
 	U_BYTE GetGammaValidState(void);
 	U_BYTE GetGammaPoweredState(void);
 
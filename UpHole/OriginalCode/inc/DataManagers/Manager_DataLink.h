@@ -16,6 +16,48 @@
 
 #include "portable.h"
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// checks a survey failed, kept in the record as nSurveyFlags
+#define SURVEY_FLAG_GTOTAL		0x01	// total gravity off one G
+#define SURVEY_FLAG_HTOTAL		0x02	// total field moved from the last good survey
+#define SURVEY_FLAG_DIP			0x04	// dip moved from the last good survey
+#define SURVEY_FLAG_DRIFT		0x08	// compass temperature still settling
+#define SURVEY_FLAG_NOISY		0x10	// streamed samples too spread out
+
+// downhole magnetometer calibration states, as the downhole sends them
+#define COMPASS_CAL_IDLE		0
+#define COMPASS_CAL_COLLECTING		1
+#define COMPASS_CAL_DONE		2
+#define COMPASS_CAL_FAILED		3
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// survey metrics from the full data set extension, 0 when not reported
+typedef struct
+{
+	U_INT16 nGtotal;		// total gravity, mG
+	U_INT16 nHtotal;		// total field, 10 nT
+	INT16 nDip;			// dip, degrees times 10
+	INT16 nTemperatureDrift;	// 0.1 degrees C per minute
+	U_BYTE nSamples;		// raw samples averaged into the survey
+	U_INT16 nGtotalStd;		// spread of the total gravity, 0.1 mG
+	U_INT16 nHtotalStd;		// spread of the total field, nT
+} SURVEY_METRICS;
+
+// last magnetometer calibration status reported by the downhole
+typedef struct
+{
+	U_BYTE nState;			// COMPASS_CAL_xxx
+	U_INT16 nSamples;		// field vectors collected
+	U_INT16 nResidual;		// rms distance from the fitted ellipsoid, nT
+	BOOL bInUse;			// calibration applied to the surveys
+} COMPASS_CAL_STATUS;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -31,6 +73,15 @@ extern "C" {
 	void SetSurveyPitch(ANGLE_TIMES_TEN nData);
 	void SetSurveyRoll(ANGLE_TIMES_TEN nData);
 	void SetSurveyTemperature(INT16 nData);
+	void SetSurveyQuality(U_BYTE nQuality, U_INT16 nAge);
+	U_BYTE GetSurveyQuality(void);
+	U_INT16 GetSurveyAge(void);
+	void SetSurveyMetrics(const SURVEY_METRICS *pMetrics);
+	void ClearSurveyMetrics(void);
+	void GetSurveyMetrics(SURVEY_METRICS *pMetrics);
+	U_BYTE CheckSurveyMetrics(void);
+	void SetCompassCalStatus(const COMPASS_CAL_STATUS *pStatus);
+	void GetCompassCalStatus(COMPASS_CAL_STATUS *pStatus);
 	ANGLE_TIMES_TEN GetSurveyAzimuth(void);
 	ANGLE_TIMES_TEN GetSurveyPitch(void);
 	ANGLE_TIMES_TEN GetSurveyRoll(void);
@@ -25,6 +25,13 @@
 
 #define MAX_BOREHOLE_NAME_BYTES 16
 
+// kept in BOREHOLE_STATISTICS, in the battery backed SRAM, to tell the survey
+// log was written by this layout of STRUCT_RECORD_DATA.  Change the last byte
+// whenever the record, and with it RECORDS_PER_PAGE, changes.
+//  1   48 bytes, 10 records per page
+//  2   the survey quality metrics added, 56 bytes, 9 per page
+#define RECORD_LAYOUT_MAGIC     0x52454302ul
+
 typedef struct __STRUCT_RECORD_DATA__
 {
     TIME_RT tSurveyTimeStamp;
@@ -49,11 +56,17 @@ typedef struct __STRUCT_RECORD_DATA__
     INT16 GammaShotNumCorrected;
     BOOL InvalidDataFlag;
     BOOL branchWasSet;
+    U_INT16 nGtotal;        // mG, 0 when the downhole sent no metrics
+    U_INT16 nHtotal;        // 10 nT
+    INT16 nDip;             // degrees times 10
+    U_BYTE nSurveyFlags;    // SURVEY_FLAG_ checks the survey failed
+    U_BYTE nSurveySamples;  // compass samples averaged into the survey
 } STRUCT_RECORD_DATA;
 
 // a struct to hold info about the borehole
 typedef struct _BOREHOLE_STATISTICS
 {
+    U_INT32 nLayout;        // RECORD_LAYOUT_MAGIC
     char BoreholeName[MAX_BOREHOLE_NAME_BYTES];
     U_INT32 RecordCount;
     U_INT32 TotalLength;
@@ -89,6 +102,8 @@ typedef struct _NEWHOLE_INFO
 extern "C" {
 #endif
 
+    //  Converts a record table of layout 1, starts a new one for any other layout
+    void RECORD_Initialize(void);
     //  Prepares record table for writing
     void RECORD_OpenLoggingFile(void);
     //   Finalizes record table after writing
@@ -133,6 +133,10 @@ typedef enum __MSG_VALUES__
 	TXT_USB_WTF,
 	TXT_USB_UNM,
 	TXT_DATA_UPLOAD, //ZD 21Spetember2023 This is where the uploading data starts by giving it a text name for .h
+	TXT_DOWNHOLE_LOG_RECORD,
+	TXT_DOWNHOLE_LOG_DOWNLOAD,
+	TXT_DOWNHOLE_TASKS_DOWNLOAD,
+	TXT_DOWNHOLE_TASKS_CLEAR,
 	MAX_TXT_MSG// <---- Must be the LAST entry
 } TXT_VALUES;
 
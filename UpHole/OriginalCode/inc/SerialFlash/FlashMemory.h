@@ -51,6 +51,10 @@
 #define	AT45_PAGE_SIZE					512		// in 8 bit bytes
 #define CHIP_PAGE_SIZE 				AT45_PAGE_SIZE
 
+// the downhole firmware image takes the top of the chip, a header page then
+// the image, see DownholeUpdate.c.  Below it is the event area.
+#define FIRMWARE_IMAGE_PAGES			1025ul
+
 #define	PROD_ID_MWD	0x11
 
 // The available User Interface displayed language selections must be a
@@ -121,6 +125,7 @@ typedef struct {
 	U_INT32 Newhole_start_page;
 	U_INT32	EVENTS_start_page;
 	U_INT32	EVENTS_pages_available;
+	U_INT32	FIRMWARE_start_page;
 } Flash_chip_type;
 
 typedef struct
@@ -151,8 +156,8 @@ extern NVRAM_image NVRAM_data;
 extern BOREHOLE_STATISTICS boreholeStatistics;
 extern NEWHOLE_INFO newHole_tracker;
 
-void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber);
-void FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber);
+BOOL FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber);
+BOOL FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber);
 U_BYTE Serflash_test_device(void);
 U_BYTE Serflash_read_NV_Block(void);
 U_BYTE Serflash_check_NV_Block(void);
@@ -169,6 +174,7 @@ U_INT32 GetEventRecordCount(void);
 U_BYTE Serflash_program_event(U_BYTE *this_event, U_INT32 event_block_size);
 U_BYTE Serflash_get_event( U_INT32 event_number, U_INT32 event_block_size, U_BYTE *theData );
 void Serflash_Events_Clear(void);
+U_BYTE Serflash_read_firmware_page(U_INT32 a_page, U_BYTE *theData);
 void SetSerialNumber(char* serialNumber);
 char* GetSerialNumber(void);
 void SetModelNumber(char* modelNumber);
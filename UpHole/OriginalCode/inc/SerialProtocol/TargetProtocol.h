@@ -18,6 +18,9 @@
 
 //#define TP_COMM_BUFF_SIZE	255
 
+// longest message taken from the downhole
+#define TARGET_MAX_MESSAGE_LENGTH	200
+
 // interface numbers for the previous, please remove
 typedef enum
 {
@@ -32,6 +35,25 @@ typedef enum
 	TP_DOWNHOLE_STATUS,
 } TP_COMMS_INTERFACE;
 
+// what TargProtocol_RequestCompassCalibrate asks the downhole to do
+#define COMPASS_CAL_ACTION_STATUS	0	// only report
+#define COMPASS_CAL_ACTION_START	1	// start collecting, turn the tool
+#define COMPASS_CAL_ACTION_FINISH	2	// fit and keep the result
+#define COMPASS_CAL_ACTION_CANCEL	3	// stop collecting
+#define COMPASS_CAL_ACTION_CLEAR	4	// forget the stored calibration
+
+// what TargProtocol_RequestDataLog asks the downhole log to do
+#define DATALOG_ACTION_STATUS		0	// only report
+#define DATALOG_ACTION_START		1	// record every interval seconds
+#define DATALOG_ACTION_STOP		2
+#define DATALOG_ACTION_CLEAR		3	// erase, recording carries on after
+
+// flags of TargProtocol_RequestTaskStats
+#define TASK_STATS_REQUEST_CLEAR	0x01	// start the statistics over once sent
+
+// flags of TargProtocol_RequestBlackBox
+#define BLACK_BOX_REQUEST_CLEAR		0x01	// empty the ring once sent
+
 //============================================================================//
 //      VARIABLES EXPOSED                                                     //
 //============================================================================//
@@ -52,6 +74,21 @@ extern "C" {
 	void TargProtocol_RequestSendGammaEnable(BOOL bState);
 	void SetAwakeTimeTarget(INT16 aTime);
 	void TargProtocol_SetSensorPowerState(BOOL bState);
+	void TargProtocol_RequestCompassStream(U_INT16 nInterval, U_INT16 nWindow);
+	void TargProtocol_RequestBestSurvey(void); // ask for the latched still survey
+	void TargProtocol_RequestStillWindow(U_INT16 nWindow);
+	void TargProtocol_RequestCompassCalibrate(U_BYTE nAction);
+	void TargProtocol_RequestGammaWindow(U_INT16 nPeriod, U_INT16 nWindow, U_INT16 nDeadTime);
+	void TargProtocol_RequestDataLog(U_BYTE nAction, U_INT16 nInterval);
+	void TargProtocol_RequestDataLogRead(U_INT32 nFirst, U_BYTE nCount);
+	void TargProtocol_RequestSampleBatch(U_INT16 nNext, U_INT16 nInterval, U_BYTE nMaxSamples);
+	void TargProtocol_RequestTaskStats(U_BYTE nFirst, U_BYTE nFlags);
+	void TargProtocol_RequestBlackBox(U_BYTE nFirst, U_BYTE nFlags);
+	void TargProtocol_RequestLinkStats(void);
+	void TargProtocol_RequestFirmwareStart(U_INT32 nSize, U_INT32 nCRC);
+	void TargProtocol_SendFirmwareChunk(U_INT16 nChunk, const U_BYTE *pData, U_BYTE nLength);
+	void TargProtocol_RequestFirmwareStatus(U_INT16 nFirst);
+	void TargProtocol_RequestFirmwareCommit(U_INT32 nCRC);
 
 #ifdef __cplusplus
 }
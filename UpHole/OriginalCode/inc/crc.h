@@ -16,6 +16,25 @@
 
 #include "portable.h"
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// the CRC unit's register after a reset
+#define CRC32_INITIAL	0xFFFFFFFFul
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// a CRC-32 taken a piece at a time
+typedef struct
+{
+	U_INT32 nCRC;
+	U_INT32 nWord;		// bytes of a word not yet fed, the first lowest
+	U_BYTE nBytes;		// how many
+} CRC32_CONTEXT;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -27,6 +46,11 @@ extern "C" {
 	BOOL CalculateCRC(U_BYTE *pData, U_INT16 nLength, U_INT32 *nResultCRC);
 	void ResetCRC(U_INT32 *pCRC);
 	void CRC_CalculateOnByte(U_INT32 *pCRC, U_BYTE nData);
+	U_INT16 CRC16_Calculate(const U_BYTE *pData, U_INT16 nLength);
+	U_INT32 CRC32_Calculate(const U_INT32 *pData32, U_INT32 nWords);
+	void CRC32_Start(CRC32_CONTEXT *pContext);
+	void CRC32_Update(CRC32_CONTEXT *pContext, const U_BYTE *pData, U_INT32 nLength);
+	U_INT32 CRC32_Finish(const CRC32_CONTEXT *pContext);
 
 #ifdef __cplusplus
 }
@@ -195,7 +195,12 @@ FLASH_PAGE_STATUS FLASH_ReadPage(FLASH_PAGE * page, U_INT32 pageNumber)
 
 			SendCommand(READ_PAGE_OPCODE, pageNumber);
 			SendEmptyBytes(4);
-			ReceiveBytes(pageData.AsBytes, FLASH_PAGE_SIZE);
+			if (!SPI_Transfer(NULL, pageData.AsBytes, FLASH_PAGE_SIZE))
+			{
+				// part stale, neither good nor empty
+				SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
+				return FLASH_PAGE_CORRUPT;
+			}
 			ReceiveBytes((U_BYTE*) &pageCrc, sizeof(pageCrc));
 			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
 
@@ -228,19 +233,30 @@ FLASH_PAGE_STATUS FLASH_WritePage(FLASH_PAGE * page, U_INT32 nPageNumber)
 	if (IsValidPage(nPageNumber))
 	{
 		U_INT32 pageCrc;
+		BOOL bSent = false;
 		memcpy(pageData.AsBytes, page->AsBytes, FLASH_PAGE_SIZE);
 		CalculateCRC(pageData.AsBytes, sizeof(pageData.AsBytes), &pageCrc);
 
 		SPI_ResetTransferTimeOut();
-		ErasePage(nPageNumber);
 
+		// the buffer is filled before the erase, so the page is left alone
+		// when the transfer does not finish
 		if (SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true))
 		{
 			SendCommand(WRITE_BUFFER_OPCODE, nPageNumber);
-			SendBytes(pageData.AsBytes, FLASH_PAGE_SIZE);
-			SendBytes((U_BYTE*) &pageCrc, sizeof(pageCrc));
+			bSent = SPI_Transfer(pageData.AsBytes, NULL, FLASH_PAGE_SIZE);
+			if (bSent)
+			{
+				SendBytes((U_BYTE*) &pageCrc, sizeof(pageCrc));
+			}
 			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
 		}
+		if (!bSent)
+		{
+			return FLASH_PAGE_CORRUPT;
+		}
+
+		ErasePage(nPageNumber);
 
 		if (FLASH_WaitForReady(TWENTY_FIVE_MILLI_SECONDS))
 		{
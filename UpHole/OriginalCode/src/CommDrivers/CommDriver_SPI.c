@@ -18,6 +18,22 @@
 #include "CommDriver_SPI.h"
 #include "NVIC.h"
 #include "SysTick.h"
+#include "timer.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// SPI1 RX is DMA2 Stream 2 and TX DMA2 Stream 3, both on channel 3, Stream 0
+// is the ADC1 stream
+#define SPI_RX_DMA_STREAM	DMA2_Stream2
+#define SPI_TX_DMA_STREAM	DMA2_Stream3
+#define SPI_DMA_CHANNEL		DMA_Channel_3
+#define SPI_RX_DMA_FLAGS	(DMA_FLAG_TCIF2 | DMA_FLAG_HTIF2 | DMA_FLAG_TEIF2 | DMA_FLAG_DMEIF2 | DMA_FLAG_FEIF2)
+#define SPI_TX_DMA_FLAGS	(DMA_FLAG_TCIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_FEIF3)
+
+// a DataFlash page is about 1ms at 5MHz
+#define SPI_TRANSFER_TIMEOUT	TWENTY_FIVE_MILLI_SECONDS
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -25,6 +41,18 @@
 
 static U_INT16 m_nTimeout = 0;
 
+static volatile BOOL m_bTransferBusy = false;
+static SPI_TRANSFER_CALLBACK m_pTransferCallback = NULL;
+// clocked out when there is nothing to send, and where unwanted bytes go
+static U_BYTE m_nDummyTx = 0x00;
+static U_BYTE m_nDummyRx;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void SPI_FinishTransfer(BOOL bComplete);
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -123,6 +151,8 @@ void SPI_Initialize(void)
 	// Enable SPI1
 	SPI_CalculateCRC(SPI1, DISABLE);
 	SPI_Cmd(SPI1, ENABLE);
+
+	NVIC_InitIrq(NVIC_SPI1);
 }     // End SPI_Initialize()
 
 /*!
@@ -256,3 +286,227 @@ U_BYTE SPI_TransferByte(U_BYTE nDataByte)
 
 	return (SPI_ReceiveData(SPI1));
 }     // End SPI_TransferByte()
+
+/*!
+ ********************************************************************************
+ *       @details
+ *******************************************************************************/
+/*
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ ; Function:
+ ;   SPI_StartTransfer()
+ ;
+ ; Description:
+ ;   Starts DMA of a block to and from the device that has the bus.  The
+ ;   chip select is left as it is, the caller releases it once the transfer
+ ;   is over.
+ ;
+ ; Parameters:
+ ;   const U_BYTE* pTxData => bytes to send, NULL sends zeros
+ ;   U_BYTE* pRxData => where the bytes read go, NULL drops them
+ ;   U_INT16 nLength => number of bytes each way
+ ;   SPI_TRANSFER_CALLBACK pCallback => called from the DMA interrupt at the
+ ;                                      end, NULL to poll SPI_IsTransferBusy()
+ ;
+ ; Returns:
+ ;   BOOL => false if a transfer is running or the bus has timed out
+ ;
+ ; Reentrancy:
+ ;   No
+ ;
+ ; Assumptions:
+ ;   The buffers are in the main RAM, the DMA cannot reach the CCM RAM, and
+ ;   stay put until the transfer is over.
+ ;
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+BOOL SPI_StartTransfer(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength,
+	SPI_TRANSFER_CALLBACK pCallback)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+
+	if (m_bTransferBusy || (nLength == 0) || (m_nTimeout == 0))
+	{
+		return false;
+	}
+	m_bTransferBusy = true;
+	m_pTransferCallback = pCallback;
+
+	DMA_Cmd(SPI_RX_DMA_STREAM, DISABLE);
+	DMA_Cmd(SPI_TX_DMA_STREAM, DISABLE);
+	DMA_DeInit(SPI_RX_DMA_STREAM);
+	DMA_DeInit(SPI_TX_DMA_STREAM);
+
+	DMA_StructInit(&DMA_InitStructure);
+	DMA_InitStructure.DMA_Channel = SPI_DMA_CHANNEL;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (U_INT32) &SPI1->DR;
+	DMA_InitStructure.DMA_BufferSize = nLength;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+
+	// Receive, a higher priority than transmit so DR never overruns
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32) ((pRxData != NULL) ? pRxData : &m_nDummyRx);
+	DMA_InitStructure.DMA_MemoryInc = (pRxData != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+	DMA_Init(SPI_RX_DMA_STREAM, &DMA_InitStructure);
+
+	// Transmit
+	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32) ((pTxData != NULL) ? pTxData : &m_nDummyTx);
+	DMA_InitStructure.DMA_MemoryInc = (pTxData != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+	DMA_Init(SPI_TX_DMA_STREAM, &DMA_InitStructure);
+
+	DMA_ClearFlag(SPI_RX_DMA_STREAM, SPI_RX_DMA_FLAGS);
+	DMA_ClearFlag(SPI_TX_DMA_STREAM, SPI_TX_DMA_FLAGS);
+	DMA_ITConfig(SPI_RX_DMA_STREAM, DMA_IT_TC | DMA_IT_TE, (pCallback != NULL) ? ENABLE : DISABLE);
+	DMA_Cmd(SPI_RX_DMA_STREAM, ENABLE);
+	DMA_Cmd(SPI_TX_DMA_STREAM, ENABLE);
+	SPI_I2S_DMACmd(SPI1, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+	return true;
+}     // End SPI_StartTransfer()
+
+/*!
+ ********************************************************************************
+ *       @details
+ *******************************************************************************/
+/*
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ ; Function:
+ ;   SPI_IsTransferBusy()
+ ;
+ ; Description:
+ ;   true while a DMA transfer is running.
+ ;
+ ; Reentrancy:
+ ;   Yes
+ ;
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+BOOL SPI_IsTransferBusy(void)
+{
+	return m_bTransferBusy;
+}     // End SPI_IsTransferBusy()
+
+/*!
+ ********************************************************************************
+ *       @details
+ *******************************************************************************/
+/*
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ ; Function:
+ ;   SPI_Transfer()
+ ;
+ ; Description:
+ ;   Moves a block to and from the device that has the bus by DMA and waits
+ ;   for it, in place of a SPI_TransferByte() loop.  The end is polled, so it
+ ;   works with the interrupts off.  A transfer that does not finish times
+ ;   the bus out, as SPI_TransferByte() does.
+ ;
+ ; Parameters:
+ ;   const U_BYTE* pTxData => bytes to send, NULL sends zeros
+ ;   U_BYTE* pRxData => where the bytes read go, NULL drops them
+ ;   U_INT16 nLength => number of bytes each way
+ ;
+ ; Returns:
+ ;   BOOL => true if every byte was moved
+ ;
+ ; Reentrancy:
+ ;   No
+ ;
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+BOOL SPI_Transfer(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength)
+{
+	TIME_LR tStart;
+
+	if (!SPI_StartTransfer(pTxData, pRxData, nLength, NULL))
+	{
+		return false;
+	}
+	tStart = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	while (DMA_GetFlagStatus(SPI_RX_DMA_STREAM, DMA_FLAG_TCIF2) == RESET)
+	{
+		if ((DMA_GetFlagStatus(SPI_RX_DMA_STREAM, DMA_FLAG_TEIF2) == SET) ||
+			(ElapsedTimeLowRes(tStart) > SPI_TRANSFER_TIMEOUT))
+		{
+			m_nTimeout = 0;
+			SPI_FinishTransfer(false);
+			return false;
+		}
+	}
+	SPI_FinishTransfer(true);
+	return true;
+}     // End SPI_Transfer()
+
+/*!
+ ********************************************************************************
+ *       @details
+ *******************************************************************************/
+/*
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ ; Function:
+ ;   SPI_FinishTransfer()
+ ;
+ ; Description:
+ ;   Hands the bus back to SPI_TransferByte() and tells the caller.
+ ;
+ ; Parameters:
+ ;   BOOL bComplete => true if every byte was moved
+ ;
+ ; Reentrancy:
+ ;   No
+ ;
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+static void SPI_FinishTransfer(BOOL bComplete)
+{
+	SPI_TRANSFER_CALLBACK pCallback = m_pTransferCallback;
+
+	SPI_I2S_DMACmd(SPI1, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+	DMA_Cmd(SPI_TX_DMA_STREAM, DISABLE);
+	DMA_Cmd(SPI_RX_DMA_STREAM, DISABLE);
+	DMA_ITConfig(SPI_RX_DMA_STREAM, DMA_IT_TC | DMA_IT_TE, DISABLE);
+	DMA_ClearFlag(SPI_RX_DMA_STREAM, SPI_RX_DMA_FLAGS);
+	DMA_ClearFlag(SPI_TX_DMA_STREAM, SPI_TX_DMA_FLAGS);
+	m_pTransferCallback = NULL;
+	m_bTransferBusy = false;
+	if (pCallback != NULL)
+	{
+		pCallback(bComplete);
+	}
+}     // End SPI_FinishTransfer()
+
+/*!
+ ********************************************************************************
+ *       @details
+ *******************************************************************************/
+/*
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ ; Function:
+ ;   DMA2_Stream2_IRQHandler()
+ ;
+ ; Description:
+ ;   Handles DMA2_Stream2 interrupts, SPI1 RX.  Only enabled for a transfer
+ ;   started with a callback.
+ ;
+ ; Reentrancy:
+ ;   No
+ ;
+ ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ */
+void DMA2_Stream2_IRQHandler(void)
+{
+	if (DMA_GetITStatus(SPI_RX_DMA_STREAM, DMA_IT_TEIF2))
+	{
+		SPI_FinishTransfer(false);
+	}
+	else if (DMA_GetITStatus(SPI_RX_DMA_STREAM, DMA_IT_TCIF2))
+	{
+		SPI_FinishTransfer(true);
+	}
+}     // End DMA2_Stream2_IRQHandler()
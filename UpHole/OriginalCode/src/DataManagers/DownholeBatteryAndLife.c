@@ -24,6 +24,9 @@ static U_INT16 m_nBatteryVoltage2 = 0;
 static U_INT16 m_nSignalStrength = 0;
 static U_INT16 m_nAwakeTimeSetting = 0;
 static U_INT16 m_nCurrentAwakeTime = 0;
+static U_INT16 m_nSleepPermille = 0;
+static U_INT16 m_nBatteryMinimum = 0;
+static U_INT16 m_nSignalMaximum = 0;
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -75,6 +78,63 @@ U_INT16 GetDownholeSignalStrength(void)
 	return m_nSignalStrength;
 }
 
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetDownholeSleepPermille(U_INT16 SleepPermille)
+{
+	m_nSleepPermille = SleepPermille;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Parts per thousand of the time the downhole processor slept, only
+ *       sent with the compact data set.
+ *******************************************************************************/
+U_INT16 GetDownholeSleepPermille(void)
+{
+	return m_nSleepPermille;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetDownholeBatteryMinimum(U_INT16 BatVoltage)
+{
+	m_nBatteryMinimum = BatVoltage;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Lowest downhole battery voltage over 32mS since it powered up, the
+ *       sag under load.  0 until the downhole has one, only sent with the
+ *       compact data set.
+ *******************************************************************************/
+U_INT16 GetDownholeBatteryMinimum(void)
+{
+	if(m_nBatteryMinimum == 0)
+		return 0;
+	return m_nBatteryMinimum + 400;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetDownholeSignalMaximum(U_INT16 SignalStrength)
+{
+	m_nSignalMaximum = SignalStrength;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Strongest downhole signal over 32mS since it powered up, only sent
+ *       with the compact data set.
+ *******************************************************************************/
+U_INT16 GetDownholeSignalMaximum(void)
+{
+	return m_nSignalMaximum;
+}
+
 /*******************************************************************************
  *       @details
  *******************************************************************************/
@@ -0,0 +1,311 @@
+/*******************************************************************************
+ *       @brief      This module downloads the downhole black box, why the
+ *                   tool reset and what it was doing, over the modem to the
+ *                   PC port.
+ *       @file       Uphole/src/DataManagers/DownholeBlackBox.c
+ *       @date       October 2026
+ *       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+ *                   reserved.  Reproduction in whole or in part is prohibited
+ *                   without the prior written consent of the copyright holder.
+ *******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <string.h>
+#include "portable.h"
+#include "timer.h"
+#include "SysTick.h"
+#include "CommDriver_UART.h"
+#include "TargetProtocol.h"
+#include "UI_MainTab.h"
+#include "DownholeBlackBox.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// wait for a reply before asking again, and how many times to ask
+#define DOWNHOLE_BLACK_BOX_TIMEOUT	THREE_SECOND
+#define DOWNHOLE_BLACK_BOX_RETRIES	5
+// the PC port has one transmit buffer, give each line time to go out
+#define DOWNHOLE_BLACK_BOX_LINE_GAP	HUNDRED_MILLI_SECONDS
+#define DOWNHOLE_BLACK_BOX_LINE_LENGTH	100
+
+// the free stack the downhole sends when it is not measured
+#define DOWNHOLE_STACK_UNKNOWN		0xFFFF
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+typedef enum
+{
+	BLACK_BOX_IDLE,
+	BLACK_BOX_REQUEST,	// ask for the next events
+	BLACK_BOX_WAIT,		// waiting for them
+	BLACK_BOX_HEADER,	// writing the reset counts to the PC port
+	BLACK_BOX_SEND,		// writing the events to the PC port
+} BLACK_BOX_STATE;
+
+// the RCC CSR reset flags, bits 31 to 24, in the low byte of a reset event
+static const char * const m_sResetFlags[8] =
+{
+	"", "BOR ", "PIN ", "POR ", "SFT ", "IWDG ", "WWDG ", "LPWR "
+};
+
+static BLACK_BOX_STATE m_eBlackBox = BLACK_BOX_IDLE;
+static U_BYTE m_nBlackBoxNext;
+static U_BYTE m_nBlackBoxTotal;
+static U_BYTE m_nBlackBoxRetries;
+static TIME_LR m_tBlackBoxTimer;
+static U_INT16 m_nResets;
+static U_INT16 m_nWatchdogResets;
+static U_INT16 m_nStackFree;
+static DOWNHOLE_EVENT m_EventBatch[DOWNHOLE_BLACK_BOX_READ_MAX];
+static U_BYTE m_nBatchCount;
+static U_BYTE m_nBatchSent;
+static U_BYTE m_nHeaderSent;
+static char m_sBlackBoxLine[DOWNHOLE_BLACK_BOX_LINE_LENGTH];
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void DownholeBlackBox_SendHeaderLine(void);
+static void DownholeBlackBox_SendLine(void);
+static void DownholeBlackBox_FinishDownload(char *message);
+static BOOL DownholeBlackBox_TimedOut(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+ *       @details
+ *       The reset counts and the event count come with the first reply.
+ *******************************************************************************/
+void DownholeBlackBox_StartDownload(void)
+{
+	if(m_eBlackBox != BLACK_BOX_IDLE)
+	{
+		return;
+	}
+	ShowStatusMessage("Downloading Downhole Black Box, Please Wait...");
+	m_nBlackBoxNext = 0;
+	m_nBlackBoxTotal = 0;
+	m_nBlackBoxRetries = 0;
+	m_tBlackBoxTimer = ElapsedTimeLowRes(0);
+	m_eBlackBox = BLACK_BOX_REQUEST;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+BOOL DownholeBlackBox_IsDownloading(void)
+{
+	return m_eBlackBox != BLACK_BOX_IDLE;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Replies that are not the events asked for are repeats, drop them.
+ *******************************************************************************/
+void DownholeBlackBox_ReceiveEvents(U_INT16 nResets, U_INT16 nWatchdogResets, U_INT16 nStackFree,
+	U_BYTE nTotal, U_BYTE nFirst, U_BYTE nCount, const DOWNHOLE_EVENT *pEvents)
+{
+	if((m_eBlackBox != BLACK_BOX_WAIT) || (nFirst != m_nBlackBoxNext))
+	{
+		return;
+	}
+	if(nCount > DOWNHOLE_BLACK_BOX_READ_MAX)
+	{
+		nCount = DOWNHOLE_BLACK_BOX_READ_MAX;
+	}
+	memcpy(m_EventBatch, pEvents, nCount * sizeof(DOWNHOLE_EVENT));
+	m_nResets = nResets;
+	m_nWatchdogResets = nWatchdogResets;
+	m_nStackFree = nStackFree;
+	m_nBlackBoxTotal = nTotal;
+	m_nBatchCount = nCount;
+	m_nBatchSent = 0;
+	m_nBlackBoxRetries = 0;
+	m_tBlackBoxTimer = ElapsedTimeLowRes(0);
+	if(nFirst == 0)
+	{
+		m_nHeaderSent = 0;
+		m_eBlackBox = BLACK_BOX_HEADER;
+	}
+	else
+	{
+		m_eBlackBox = BLACK_BOX_SEND;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       Called every 10mS.
+ *******************************************************************************/
+void DownholeBlackBox_Service(void)
+{
+	switch(m_eBlackBox)
+	{
+		case BLACK_BOX_REQUEST:
+			if(ElapsedTimeLowRes(m_tBlackBoxTimer) < DOWNHOLE_BLACK_BOX_LINE_GAP)
+			{
+				break;
+			}
+			TargProtocol_RequestBlackBox(m_nBlackBoxNext, 0);
+			m_tBlackBoxTimer = ElapsedTimeLowRes(0);
+			m_eBlackBox = BLACK_BOX_WAIT;
+			break;
+		case BLACK_BOX_WAIT:
+			if(DownholeBlackBox_TimedOut())
+			{
+				TargProtocol_RequestBlackBox(m_nBlackBoxNext, 0);
+			}
+			break;
+		case BLACK_BOX_HEADER:
+			if(ElapsedTimeLowRes(m_tBlackBoxTimer) < DOWNHOLE_BLACK_BOX_LINE_GAP)
+			{
+				break;
+			}
+			m_tBlackBoxTimer = ElapsedTimeLowRes(0);
+			DownholeBlackBox_SendHeaderLine();
+			if(++m_nHeaderSent >= 3)
+			{
+				m_eBlackBox = BLACK_BOX_SEND;
+			}
+			break;
+		case BLACK_BOX_SEND:
+			if(ElapsedTimeLowRes(m_tBlackBoxTimer) < DOWNHOLE_BLACK_BOX_LINE_GAP)
+			{
+				break;
+			}
+			m_tBlackBoxTimer = ElapsedTimeLowRes(0);
+			if(m_nBatchSent < m_nBatchCount)
+			{
+				DownholeBlackBox_SendLine();
+				m_nBatchSent++;
+				break;
+			}
+			m_nBlackBoxNext += m_nBatchCount;
+			if((m_nBatchCount == 0) || (m_nBlackBoxNext >= m_nBlackBoxTotal))
+			{
+				DownholeBlackBox_FinishDownload("Downhole Black Box Done - Please Remove USB Cable");
+				break;
+			}
+			m_eBlackBox = BLACK_BOX_REQUEST;
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       TRUE when the reply is overdue and it is worth asking again, gives up
+ *       on the download after DOWNHOLE_BLACK_BOX_RETRIES.
+ *******************************************************************************/
+static BOOL DownholeBlackBox_TimedOut(void)
+{
+	if(ElapsedTimeLowRes(m_tBlackBoxTimer) < DOWNHOLE_BLACK_BOX_TIMEOUT)
+	{
+		return false;
+	}
+	m_tBlackBoxTimer = ElapsedTimeLowRes(0);
+	if(++m_nBlackBoxRetries > DOWNHOLE_BLACK_BOX_RETRIES)
+	{
+		DownholeBlackBox_FinishDownload("Downhole Black Box Failed - No Reply");
+		return false;
+	}
+	return true;
+}
+
+/*******************************************************************************
+ *       @details
+ *       The reset counts, then the heading of the event lines.
+ *******************************************************************************/
+static void DownholeBlackBox_SendHeaderLine(void)
+{
+	switch(m_nHeaderSent)
+	{
+		case 0:
+			snprintf(m_sBlackBoxLine, DOWNHOLE_BLACK_BOX_LINE_LENGTH,
+				"Resets, Watchdog Resets, Free Stack Words\r\n");
+			break;
+		case 1:
+			if(m_nStackFree == DOWNHOLE_STACK_UNKNOWN)
+			{
+				snprintf(m_sBlackBoxLine, DOWNHOLE_BLACK_BOX_LINE_LENGTH, "%u, %u, \r\n",
+					m_nResets, m_nWatchdogResets);
+			}
+			else
+			{
+				snprintf(m_sBlackBoxLine, DOWNHOLE_BLACK_BOX_LINE_LENGTH, "%u, %u, %u\r\n",
+					m_nResets, m_nWatchdogResets, m_nStackFree);
+			}
+			break;
+		default:
+			snprintf(m_sBlackBoxLine, DOWNHOLE_BLACK_BOX_LINE_LENGTH,
+				"Event, Task, Time, Reset Flags, Modem State, Free Stack Words\r\n");
+			break;
+	}
+	UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sBlackBoxLine, strlen(m_sBlackBoxLine));
+}
+
+/*******************************************************************************
+ *       @details
+ *       Writes one event as a CSV line, time in seconds.  A reset is stamped
+ *       with the task and the time the run before it had got to.
+ *******************************************************************************/
+static void DownholeBlackBox_SendLine(void)
+{
+	DOWNHOLE_EVENT *pEvent = &m_EventBatch[m_nBatchSent];
+	char sFlags[40];
+	U_BYTE nBit;
+	int nLength;
+
+	nLength = snprintf(m_sBlackBoxLine, DOWNHOLE_BLACK_BOX_LINE_LENGTH, "%s, %s, %.1f, ",
+		(pEvent->nType == DOWNHOLE_EVENT_RESET) ? "Reset" :
+		(pEvent->nType == DOWNHOLE_EVENT_STACK) ? "Stack" :
+		(pEvent->nType == DOWNHOLE_EVENT_MODEM_ONLINE) ? "Modem Online" :
+		(pEvent->nType == DOWNHOLE_EVENT_MODEM_OFFLINE) ? "Modem Offline" : "Unknown",
+		pEvent->sTask,
+		(double) pEvent->tTime / 1000.0);
+	switch(pEvent->nType)
+	{
+		case DOWNHOLE_EVENT_RESET:
+			sFlags[0] = 0;
+			for(nBit = 0; nBit < 8; nBit++)
+			{
+				if(pEvent->nData & (1 << nBit))
+				{
+					strcat(sFlags, m_sResetFlags[nBit]);
+				}
+			}
+			snprintf(&m_sBlackBoxLine[nLength], DOWNHOLE_BLACK_BOX_LINE_LENGTH - nLength, "%s, %u, \r\n",
+				sFlags, pEvent->nData >> 8);
+			break;
+		case DOWNHOLE_EVENT_STACK:
+			snprintf(&m_sBlackBoxLine[nLength], DOWNHOLE_BLACK_BOX_LINE_LENGTH - nLength, ", , %u\r\n",
+				pEvent->nData);
+			break;
+		default:
+			snprintf(&m_sBlackBoxLine[nLength], DOWNHOLE_BLACK_BOX_LINE_LENGTH - nLength, ", %u, \r\n",
+				pEvent->nData);
+			break;
+	}
+	UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sBlackBoxLine, strlen(m_sBlackBoxLine));
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static void DownholeBlackBox_FinishDownload(char *message)
+{
+	m_eBlackBox = BLACK_BOX_IDLE;
+	ShowStatusMessage(message);
+}
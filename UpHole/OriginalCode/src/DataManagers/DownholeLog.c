@@ -0,0 +1,299 @@
+/*******************************************************************************
+ *       @brief      This module keeps the status of the downhole gamma and
+ *                   inclination log, and downloads it over the modem to the
+ *                   PC port a few records at a time.
+ *       @file       Uphole/src/DataManagers/DownholeLog.c
+ *       @date       October 2026
+ *       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+ *                   reserved.  Reproduction in whole or in part is prohibited
+ *                   without the prior written consent of the copyright holder.
+ *******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <string.h>
+#include "portable.h"
+#include "timer.h"
+#include "SysTick.h"
+#include "CommDriver_UART.h"
+#include "TargetProtocol.h"
+#include "UI_MainTab.h"
+#include "DownholeLog.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// seconds between records when the downhole has not said
+#define DOWNHOLE_LOG_DEFAULT_INTERVAL	10
+// wait for a reply before asking again, and how many times to ask
+#define DOWNHOLE_LOG_TIMEOUT		THREE_SECOND
+#define DOWNHOLE_LOG_RETRIES		5
+// the PC port has one transmit buffer, give each line time to go out
+#define DOWNHOLE_LOG_LINE_GAP		HUNDRED_MILLI_SECONDS
+#define DOWNHOLE_LOG_LINE_LENGTH	100
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+typedef enum
+{
+	DOWNLOAD_IDLE,
+	DOWNLOAD_STATUS,	// waiting for the record count
+	DOWNLOAD_REQUEST,	// ask for the next records
+	DOWNLOAD_WAIT,		// waiting for them
+	DOWNLOAD_SEND,		// writing them to the PC port
+} DOWNLOAD_STATE;
+
+// last status the downhole reported
+static U_BYTE m_nLogState = DOWNHOLE_LOG_STOPPED;
+static U_INT16 m_nLogInterval = 0;
+static U_INT32 m_nLogCount = 0;
+static U_INT32 m_nLogCapacity = 0;
+static BOOL m_bLogStatusFresh = false;
+
+static DOWNLOAD_STATE m_eDownload = DOWNLOAD_IDLE;
+static U_INT32 m_nDownloadNext;
+static U_BYTE m_nDownloadRetries;
+static TIME_LR m_tDownloadTimer;
+static DOWNHOLE_LOG_RECORD m_DownloadBatch[DOWNHOLE_LOG_READ_MAX];
+static U_BYTE m_nBatchCount;
+static U_BYTE m_nBatchSent;
+static char m_sDownloadLine[DOWNHOLE_LOG_LINE_LENGTH];
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void DownholeLog_SendLine(void);
+static void DownholeLog_FinishDownload(char *message);
+static BOOL DownholeLog_TimedOut(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void DownholeLog_SetStatus(U_BYTE nState, U_INT16 nInterval, U_INT32 nCount, U_INT32 nCapacity)
+{
+	m_nLogState = nState;
+	m_nLogInterval = nInterval;
+	m_nLogCount = nCount;
+	m_nLogCapacity = nCapacity;
+	m_bLogStatusFresh = true;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_BYTE DownholeLog_GetState(void)
+{
+	return m_nLogState;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_INT32 DownholeLog_GetCount(void)
+{
+	return m_nLogCount;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+BOOL DownholeLog_IsRecording(void)
+{
+	return (m_nLogState == DOWNHOLE_LOG_RECORDING) || (m_nLogState == DOWNHOLE_LOG_FULL);
+}
+
+/*******************************************************************************
+ *       @details
+ *       The downhole answers with its status, which updates the display.
+ *******************************************************************************/
+void DownholeLog_SetRecording(BOOL bRecording)
+{
+	U_INT16 nInterval;
+
+	nInterval = m_nLogInterval ? m_nLogInterval : DOWNHOLE_LOG_DEFAULT_INTERVAL;
+	TargProtocol_RequestDataLog(bRecording ? DATALOG_ACTION_START : DATALOG_ACTION_STOP, nInterval);
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void DownholeLog_Clear(void)
+{
+	TargProtocol_RequestDataLog(DATALOG_ACTION_CLEAR, 0);
+}
+
+/*******************************************************************************
+ *       @details
+ *       Asks for the record count first, then reads the records in order.
+ *******************************************************************************/
+void DownholeLog_StartDownload(void)
+{
+	if(m_eDownload != DOWNLOAD_IDLE)
+	{
+		return;
+	}
+	ShowStatusMessage("Downloading Downhole Log, Please Wait...");
+	m_bLogStatusFresh = false;
+	m_nDownloadRetries = 0;
+	m_tDownloadTimer = ElapsedTimeLowRes(0);
+	TargProtocol_RequestDataLog(DATALOG_ACTION_STATUS, 0);
+	m_eDownload = DOWNLOAD_STATUS;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+BOOL DownholeLog_IsDownloading(void)
+{
+	return m_eDownload != DOWNLOAD_IDLE;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Replies that are not the records asked for are repeats, drop them.
+ *******************************************************************************/
+void DownholeLog_ReceiveRecords(U_INT32 nFirst, U_BYTE nCount, const DOWNHOLE_LOG_RECORD *pRecords)
+{
+	if((m_eDownload != DOWNLOAD_WAIT) || (nFirst != m_nDownloadNext))
+	{
+		return;
+	}
+	if(nCount > DOWNHOLE_LOG_READ_MAX)
+	{
+		nCount = DOWNHOLE_LOG_READ_MAX;
+	}
+	memcpy(m_DownloadBatch, pRecords, nCount * sizeof(DOWNHOLE_LOG_RECORD));
+	m_nBatchCount = nCount;
+	m_nBatchSent = 0;
+	m_nDownloadRetries = 0;
+	m_tDownloadTimer = ElapsedTimeLowRes(0);
+	m_eDownload = DOWNLOAD_SEND;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Called every 10mS.
+ *******************************************************************************/
+void DownholeLog_Service(void)
+{
+	switch(m_eDownload)
+	{
+		case DOWNLOAD_STATUS:
+			if(m_bLogStatusFresh)
+			{
+				snprintf(m_sDownloadLine, DOWNHOLE_LOG_LINE_LENGTH,
+					"Session, Time, Gamma, GammaError, Inclination, Toolface, Flags\r\n");
+				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sDownloadLine, strlen(m_sDownloadLine));
+				m_nDownloadNext = 0;
+				m_tDownloadTimer = ElapsedTimeLowRes(0);
+				m_eDownload = DOWNLOAD_REQUEST;
+			}
+			else if(DownholeLog_TimedOut())
+			{
+				TargProtocol_RequestDataLog(DATALOG_ACTION_STATUS, 0);
+			}
+			break;
+		case DOWNLOAD_REQUEST:
+			if(ElapsedTimeLowRes(m_tDownloadTimer) < DOWNHOLE_LOG_LINE_GAP)
+			{
+				break;
+			}
+			if(m_nDownloadNext >= m_nLogCount)
+			{
+				DownholeLog_FinishDownload("Downhole Log Done - Please Remove USB Cable");
+				break;
+			}
+			TargProtocol_RequestDataLogRead(m_nDownloadNext, DOWNHOLE_LOG_READ_MAX);
+			m_tDownloadTimer = ElapsedTimeLowRes(0);
+			m_eDownload = DOWNLOAD_WAIT;
+			break;
+		case DOWNLOAD_WAIT:
+			if(DownholeLog_TimedOut())
+			{
+				TargProtocol_RequestDataLogRead(m_nDownloadNext, DOWNHOLE_LOG_READ_MAX);
+			}
+			break;
+		case DOWNLOAD_SEND:
+			if(ElapsedTimeLowRes(m_tDownloadTimer) < DOWNHOLE_LOG_LINE_GAP)
+			{
+				break;
+			}
+			m_tDownloadTimer = ElapsedTimeLowRes(0);
+			if(m_nBatchSent < m_nBatchCount)
+			{
+				DownholeLog_SendLine();
+				m_nBatchSent++;
+				break;
+			}
+			if(m_nBatchCount == 0)
+			{
+				// the downhole has no more, even if the count said so
+				DownholeLog_FinishDownload("Downhole Log Done - Please Remove USB Cable");
+				break;
+			}
+			m_nDownloadNext += m_nBatchCount;
+			m_eDownload = DOWNLOAD_REQUEST;
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       TRUE when the reply is overdue and it is worth asking again, gives up
+ *       on the download after DOWNHOLE_LOG_RETRIES.
+ *******************************************************************************/
+static BOOL DownholeLog_TimedOut(void)
+{
+	if(ElapsedTimeLowRes(m_tDownloadTimer) < DOWNHOLE_LOG_TIMEOUT)
+	{
+		return false;
+	}
+	m_tDownloadTimer = ElapsedTimeLowRes(0);
+	if(++m_nDownloadRetries > DOWNHOLE_LOG_RETRIES)
+	{
+		DownholeLog_FinishDownload("Downhole Log Failed - No Reply");
+		return false;
+	}
+	return true;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Writes one record as a CSV line, time in seconds, angles in degrees.
+ *******************************************************************************/
+static void DownholeLog_SendLine(void)
+{
+	DOWNHOLE_LOG_RECORD *pRecord = &m_DownloadBatch[m_nBatchSent];
+
+	snprintf(m_sDownloadLine, DOWNHOLE_LOG_LINE_LENGTH, "%u, %.3f, %u, %.1f, %.1f, %.1f, %u\r\n",
+		pRecord->nSession,
+		(double) pRecord->tTime / 1000.0,
+		pRecord->nGamma,
+		(double) pRecord->nGammaError / 10.0,
+		(double) pRecord->nInclination / 10.0,
+		(double) pRecord->nToolface / 10.0,
+		pRecord->nFlags);
+	UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sDownloadLine, strlen(m_sDownloadLine));
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static void DownholeLog_FinishDownload(char *message)
+{
+	m_eDownload = DOWNLOAD_IDLE;
+	ShowStatusMessage(message);
+}
@@ -0,0 +1,218 @@
+/*******************************************************************************
+ *       @brief      This module polls the downhole for the samples it took
+ *                   since the last poll, several to a modem packet, and keeps
+ *                   the newest of them.
+ *       @file       Uphole/src/DataManagers/DownholeSamples.c
+ *       @date       October 2026
+ *       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+ *                   reserved.  Reproduction in whole or in part is prohibited
+ *                   without the prior written consent of the copyright holder.
+ *******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+#include "timer.h"
+#include "SysTick.h"
+#include "TargetProtocol.h"
+#include "GammaSensor.h"
+#include "DownholeBatteryAndLife.h"
+#include "Manager_DataLink.h"
+#include "DownholeSamples.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// samples the downhole takes in each poll time
+#define DOWNHOLE_SAMPLES_PER_POLL	8
+// the full data set still carries the version and the on time, ask for it
+// every so many polls
+#define DOWNHOLE_SAMPLES_FULL_DATA_EVERY	10
+// batches not answered before the downhole is taken to be one without them
+#define DOWNHOLE_SAMPLES_MAX_MISSES	3
+// gap before asking for the samples a batch had no room for
+#define DOWNHOLE_SAMPLES_GAP		TWO_HUNDRED_MILLI_SECONDS
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static DOWNHOLE_SAMPLE m_Samples[DOWNHOLE_SAMPLES_HISTORY];
+// where the next one goes, and how many are kept
+static U_BYTE m_nSampleNext = 0;
+static U_BYTE m_nSampleCount = 0;
+// sequence number of the next sample wanted
+static U_INT16 m_nNextSequence = 0;
+static U_INT16 m_nSamplesDropped = 0;
+// samples the last batch left behind
+static U_BYTE m_nSamplesRemaining = 0;
+static BOOL m_bBatchPending = false;
+static U_BYTE m_nBatchMisses = 0;
+static U_INT32 m_nPollCount = 0;
+static TIME_LR m_tBatchTimer;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void DownholeSamples_RequestBatch(U_INT16 nInterval);
+static void DownholeSamples_Show(const DOWNHOLE_SAMPLE *pSample);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+ *       @details
+ *       Called every poll time, tPollTime mS.  Asks for a batch of samples,
+ *       and for the full data set now and then.  A downhole that does not
+ *       answer batches is asked for the full data set instead, with a batch
+ *       now and then in case it is changed for one that does.
+ *******************************************************************************/
+void DownholeSamples_Poll(U_INT32 tPollTime)
+{
+	BOOL bFullData;
+
+	if(m_bBatchPending)
+	{
+		m_bBatchPending = false;
+		if(m_nBatchMisses < DOWNHOLE_SAMPLES_MAX_MISSES)
+		{
+			m_nBatchMisses++;
+		}
+	}
+	m_nPollCount++;
+	bFullData = ((m_nPollCount % DOWNHOLE_SAMPLES_FULL_DATA_EVERY) == 0);
+	if(m_nBatchMisses >= DOWNHOLE_SAMPLES_MAX_MISSES)
+	{
+		bFullData = !bFullData;
+	}
+	if(bFullData)
+	{
+		TargProtocol_RequestAllData();
+		return;
+	}
+	tPollTime /= DOWNHOLE_SAMPLES_PER_POLL;
+	if(tPollTime > 0xFFFF)
+	{
+		tPollTime = 0xFFFF;
+	}
+	DownholeSamples_RequestBatch((U_INT16)tPollTime);
+}
+
+/*******************************************************************************
+ *       @details
+ *       Asking for the next sequence tells the downhole it can drop the
+ *       samples before it.
+ *******************************************************************************/
+static void DownholeSamples_RequestBatch(U_INT16 nInterval)
+{
+	TargProtocol_RequestSampleBatch(m_nNextSequence, nInterval, DOWNHOLE_SAMPLES_READ_MAX);
+	m_bBatchPending = true;
+	m_nSamplesRemaining = 0;
+	m_tBatchTimer = ElapsedTimeLowRes(0);
+}
+
+/*******************************************************************************
+ *       @details
+ *       Samples before the one wanted were had already.  A batch that starts
+ *       past it lost some, and one that starts well before it comes from a
+ *       downhole that has powered up since, both are taken as they are.
+ *******************************************************************************/
+void DownholeSamples_ReceiveBatch(U_INT16 nFirst, U_INT16 nDropped, U_BYTE nRemaining,
+								  U_BYTE nCount, const DOWNHOLE_SAMPLE *pSamples)
+{
+	U_INT16 nSkip;
+	U_BYTE nIndex;
+
+	m_bBatchPending = false;
+	m_nBatchMisses = 0;
+	m_nSamplesDropped = nDropped;
+	m_nSamplesRemaining = nRemaining;
+	m_tBatchTimer = ElapsedTimeLowRes(0);
+	nSkip = (U_INT16)(m_nNextSequence - nFirst);
+	if(nSkip > nCount)
+	{
+		nSkip = 0;
+	}
+	for(nIndex = nSkip; nIndex < nCount; nIndex++)
+	{
+		m_Samples[m_nSampleNext] = pSamples[nIndex];
+		m_nSampleNext = (m_nSampleNext + 1) % DOWNHOLE_SAMPLES_HISTORY;
+		if(m_nSampleCount < DOWNHOLE_SAMPLES_HISTORY)
+		{
+			m_nSampleCount++;
+		}
+	}
+	m_nNextSequence = nFirst + nCount;
+	if(nCount > nSkip)
+	{
+		DownholeSamples_Show(&pSamples[nCount - 1]);
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       Called every 10mS, asks for what the last batch had no room for.
+ *******************************************************************************/
+void DownholeSamples_Service(void)
+{
+	if((m_nSamplesRemaining == 0) || m_bBatchPending)
+	{
+		return;
+	}
+	if(ElapsedTimeLowRes(m_tBatchTimer) >= DOWNHOLE_SAMPLES_GAP)
+	{
+		DownholeSamples_RequestBatch(0);
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       The newest sample goes to the display, as the full data set does.
+ *******************************************************************************/
+static void DownholeSamples_Show(const DOWNHOLE_SAMPLE *pSample)
+{
+	SetSurveyCommsState((pSample->nFlags & DOWNHOLE_SAMPLE_FLAG_COMPASS) ? true : false);
+	SetSurveyAzimuth(pSample->nAzimuth);
+	SetSurveyPitch(pSample->nPitch);
+	SetSurveyRoll(pSample->nRoll);
+	SetSurveyTemperature(pSample->nTemperature);
+	SetGammaValidState((pSample->nFlags & DOWNHOLE_SAMPLE_FLAG_GAMMA) ? 1 : 0);
+	SetSurveyGamma(pSample->nGamma);
+	SetSurveyGammaError(pSample->nGammaError);
+	SetDownholeBatteryVoltage(pSample->nBattery);
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_BYTE DownholeSamples_GetCount(void)
+{
+	return m_nSampleCount;
+}
+
+/*******************************************************************************
+ *       @details
+ *       nIndex 0 is the newest.
+ *******************************************************************************/
+BOOL DownholeSamples_GetSample(U_BYTE nIndex, DOWNHOLE_SAMPLE *pSample)
+{
+	if(nIndex >= m_nSampleCount)
+	{
+		return false;
+	}
+	*pSample = m_Samples[(m_nSampleNext + DOWNHOLE_SAMPLES_HISTORY - 1 - nIndex) % DOWNHOLE_SAMPLES_HISTORY];
+	return true;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_INT16 DownholeSamples_GetDropped(void)
+{
+	return m_nSamplesDropped;
+}
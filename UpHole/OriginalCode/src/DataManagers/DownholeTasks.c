@@ -0,0 +1,333 @@
+/*******************************************************************************
+ *       @brief      This module downloads the run statistics of the downhole
+ *                   scheduler tasks and the counters of its serial links
+ *                   over the modem to the PC port, followed by the downhole
+ *                   black box.
+ *       @file       Uphole/src/DataManagers/DownholeTasks.c
+ *       @date       October 2026
+ *       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+ *                   reserved.  Reproduction in whole or in part is prohibited
+ *                   without the prior written consent of the copyright holder.
+ *******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <string.h>
+#include "portable.h"
+#include "timer.h"
+#include "SysTick.h"
+#include "CommDriver_UART.h"
+#include "TargetProtocol.h"
+#include "UI_MainTab.h"
+#include "DownholeTasks.h"
+#include "DownholeBlackBox.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// wait for a reply before asking again, and how many times to ask
+#define DOWNHOLE_TASKS_TIMEOUT		THREE_SECOND
+#define DOWNHOLE_TASKS_RETRIES		5
+// the PC port has one transmit buffer, give each line time to go out
+#define DOWNHOLE_TASKS_LINE_GAP		HUNDRED_MILLI_SECONDS
+#define DOWNHOLE_TASKS_LINE_LENGTH	100
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+typedef enum
+{
+	TASKS_IDLE,
+	TASKS_REQUEST,		// ask for the next tasks
+	TASKS_WAIT,		// waiting for them
+	TASKS_SEND,		// writing them to the PC port
+	TASKS_LINK_REQUEST,	// ask for the serial link counters
+	TASKS_LINK_WAIT,	// waiting for them
+	TASKS_LINK_SEND,	// writing them to the PC port
+} TASKS_STATE;
+
+// names of the downhole serial link counters, in the order they are sent
+static const char * const m_sLinkCounters[] =
+{
+	"Datalink Messages",
+	"Datalink Bytes",
+	"Datalink Stalls",
+	"Datalink Queued Bytes",
+	"Datalink Most Queued Bytes",
+	"Datalink RX Overruns",
+	"Compass Messages",
+	"Compass Bytes",
+	"Compass Stalls",
+	"Compass Queued Bytes",
+	"Compass Most Queued Bytes",
+	"Compass RX Overruns",
+	"Modem Frames Held",
+	"Compass Requests Held",
+	"Modem RX Frames",
+	"Modem RX Framing Errors",
+	"Modem RX Checksum Errors",
+	"Modem RX Overflows",
+	"Compass RX Frames",
+	"Compass RX Checksum Errors",
+	"Compass RX Bytes Dropped",
+};
+
+static TASKS_STATE m_eTasks = TASKS_IDLE;
+static U_BYTE m_nTasksNext;
+static U_BYTE m_nTasksTotal;
+static U_BYTE m_nTasksRetries;
+static TIME_LR m_tTasksTimer;
+static DOWNHOLE_TASK m_TasksBatch[DOWNHOLE_TASKS_READ_MAX];
+static U_BYTE m_nBatchCount;
+static U_BYTE m_nBatchSent;
+static char m_sTasksLine[DOWNHOLE_TASKS_LINE_LENGTH];
+static U_INT32 m_nLinkCounters[DOWNHOLE_LINK_COUNTERS_MAX];
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void DownholeTasks_SendLine(void);
+static void DownholeTasks_SendLinkLine(void);
+static void DownholeTasks_FinishDownload(char *message);
+static BOOL DownholeTasks_TimedOut(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+ *       @details
+ *       The task count comes with the first reply.
+ *******************************************************************************/
+void DownholeTasks_StartDownload(void)
+{
+	if((m_eTasks != TASKS_IDLE) || DownholeBlackBox_IsDownloading())
+	{
+		return;
+	}
+	ShowStatusMessage("Downloading Downhole Tasks, Please Wait...");
+	snprintf(m_sTasksLine, DOWNHOLE_TASKS_LINE_LENGTH,
+		"Task, Period mS, Runs, Misses, Worst uS, Average uS\r\n");
+	UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sTasksLine, strlen(m_sTasksLine));
+	m_nTasksNext = 0;
+	m_nTasksTotal = 0;
+	m_nTasksRetries = 0;
+	m_tTasksTimer = ElapsedTimeLowRes(0);
+	m_eTasks = TASKS_REQUEST;
+}
+
+/*******************************************************************************
+ *       @details
+ *       The downhole answers with the first tasks, from before the clear,
+ *       which are dropped unless a download is waiting for them.
+ *******************************************************************************/
+void DownholeTasks_Clear(void)
+{
+	TargProtocol_RequestTaskStats(0, TASK_STATS_REQUEST_CLEAR);
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+BOOL DownholeTasks_IsDownloading(void)
+{
+	return m_eTasks != TASKS_IDLE;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Replies that are not the tasks asked for are repeats, drop them.
+ *******************************************************************************/
+void DownholeTasks_ReceiveTasks(U_BYTE nTotal, U_BYTE nFirst, U_BYTE nCount, const DOWNHOLE_TASK *pTasks)
+{
+	if((m_eTasks != TASKS_WAIT) || (nFirst != m_nTasksNext))
+	{
+		return;
+	}
+	if(nCount > DOWNHOLE_TASKS_READ_MAX)
+	{
+		nCount = DOWNHOLE_TASKS_READ_MAX;
+	}
+	memcpy(m_TasksBatch, pTasks, nCount * sizeof(DOWNHOLE_TASK));
+	m_nTasksTotal = nTotal;
+	m_nBatchCount = nCount;
+	m_nBatchSent = 0;
+	m_nTasksRetries = 0;
+	m_tTasksTimer = ElapsedTimeLowRes(0);
+	m_eTasks = TASKS_SEND;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Counters from a downhole newer than this table are written by number.
+ *******************************************************************************/
+void DownholeTasks_ReceiveLinkStats(U_BYTE nCount, const U_INT32 *pCounters)
+{
+	if(m_eTasks != TASKS_LINK_WAIT)
+	{
+		return;
+	}
+	if(nCount > DOWNHOLE_LINK_COUNTERS_MAX)
+	{
+		nCount = DOWNHOLE_LINK_COUNTERS_MAX;
+	}
+	memcpy(m_nLinkCounters, pCounters, nCount * sizeof(U_INT32));
+	m_nBatchCount = nCount;
+	m_nBatchSent = 0;
+	m_nTasksRetries = 0;
+	m_tTasksTimer = ElapsedTimeLowRes(0);
+	m_eTasks = TASKS_LINK_SEND;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Called every 10mS.
+ *******************************************************************************/
+void DownholeTasks_Service(void)
+{
+	switch(m_eTasks)
+	{
+		case TASKS_REQUEST:
+			if(ElapsedTimeLowRes(m_tTasksTimer) < DOWNHOLE_TASKS_LINE_GAP)
+			{
+				break;
+			}
+			TargProtocol_RequestTaskStats(m_nTasksNext, 0);
+			m_tTasksTimer = ElapsedTimeLowRes(0);
+			m_eTasks = TASKS_WAIT;
+			break;
+		case TASKS_WAIT:
+			if(DownholeTasks_TimedOut())
+			{
+				TargProtocol_RequestTaskStats(m_nTasksNext, 0);
+			}
+			break;
+		case TASKS_SEND:
+			if(ElapsedTimeLowRes(m_tTasksTimer) < DOWNHOLE_TASKS_LINE_GAP)
+			{
+				break;
+			}
+			m_tTasksTimer = ElapsedTimeLowRes(0);
+			if(m_nBatchSent < m_nBatchCount)
+			{
+				DownholeTasks_SendLine();
+				m_nBatchSent++;
+				break;
+			}
+			m_nTasksNext += m_nBatchCount;
+			if((m_nBatchCount == 0) || (m_nTasksNext >= m_nTasksTotal))
+			{
+				snprintf(m_sTasksLine, DOWNHOLE_TASKS_LINE_LENGTH, "Link Counter, Value\r\n");
+				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sTasksLine, strlen(m_sTasksLine));
+				m_eTasks = TASKS_LINK_REQUEST;
+				break;
+			}
+			m_eTasks = TASKS_REQUEST;
+			break;
+		case TASKS_LINK_REQUEST:
+			if(ElapsedTimeLowRes(m_tTasksTimer) < DOWNHOLE_TASKS_LINE_GAP)
+			{
+				break;
+			}
+			TargProtocol_RequestLinkStats();
+			m_tTasksTimer = ElapsedTimeLowRes(0);
+			m_eTasks = TASKS_LINK_WAIT;
+			break;
+		case TASKS_LINK_WAIT:
+			if(DownholeTasks_TimedOut())
+			{
+				TargProtocol_RequestLinkStats();
+			}
+			break;
+		case TASKS_LINK_SEND:
+			if(ElapsedTimeLowRes(m_tTasksTimer) < DOWNHOLE_TASKS_LINE_GAP)
+			{
+				break;
+			}
+			m_tTasksTimer = ElapsedTimeLowRes(0);
+			if(m_nBatchSent < m_nBatchCount)
+			{
+				DownholeTasks_SendLinkLine();
+				m_nBatchSent++;
+				break;
+			}
+			// the black box goes in the same file, it says when it is done
+			m_eTasks = TASKS_IDLE;
+			DownholeBlackBox_StartDownload();
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       TRUE when the reply is overdue and it is worth asking again, gives up
+ *       on the download after DOWNHOLE_TASKS_RETRIES.
+ *******************************************************************************/
+static BOOL DownholeTasks_TimedOut(void)
+{
+	if(ElapsedTimeLowRes(m_tTasksTimer) < DOWNHOLE_TASKS_TIMEOUT)
+	{
+		return false;
+	}
+	m_tTasksTimer = ElapsedTimeLowRes(0);
+	if(++m_nTasksRetries > DOWNHOLE_TASKS_RETRIES)
+	{
+		DownholeTasks_FinishDownload("Downhole Tasks Failed - No Reply");
+		return false;
+	}
+	return true;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Writes one task as a CSV line.
+ *******************************************************************************/
+static void DownholeTasks_SendLine(void)
+{
+	DOWNHOLE_TASK *pTask = &m_TasksBatch[m_nBatchSent];
+
+	snprintf(m_sTasksLine, DOWNHOLE_TASKS_LINE_LENGTH, "%s, %u, %lu, %u, %lu, %lu\r\n",
+		pTask->sName,
+		pTask->nPeriod,
+		(unsigned long) pTask->nRuns,
+		pTask->nMisses,
+		(unsigned long) pTask->nWorstMicroSeconds,
+		(unsigned long) pTask->nAverageMicroSeconds);
+	UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sTasksLine, strlen(m_sTasksLine));
+}
+
+/*******************************************************************************
+ *       @details
+ *       Writes one serial link counter as a CSV line.
+ *******************************************************************************/
+static void DownholeTasks_SendLinkLine(void)
+{
+	if(m_nBatchSent < (sizeof(m_sLinkCounters) / sizeof(m_sLinkCounters[0])))
+	{
+		snprintf(m_sTasksLine, DOWNHOLE_TASKS_LINE_LENGTH, "%s, %lu\r\n",
+			m_sLinkCounters[m_nBatchSent], (unsigned long) m_nLinkCounters[m_nBatchSent]);
+	}
+	else
+	{
+		snprintf(m_sTasksLine, DOWNHOLE_TASKS_LINE_LENGTH, "Counter %u, %lu\r\n",
+			m_nBatchSent, (unsigned long) m_nLinkCounters[m_nBatchSent]);
+	}
+	UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) m_sTasksLine, strlen(m_sTasksLine));
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static void DownholeTasks_FinishDownload(char *message)
+{
+	m_eTasks = TASKS_IDLE;
+	ShowStatusMessage(message);
+}
@@ -0,0 +1,394 @@
+/*******************************************************************************
+ *       @brief      This module sends the downhole a new firmware image from
+ *                   the serial flash over the modem, a chunk at a time.  The
+ *                   downhole says which chunks it has, so only the missing
+ *                   ones are sent and a transfer cut short carries on where
+ *                   it got to.
+ *       @file       Uphole/src/DataManagers/DownholeUpdate.c
+ *       @date       October 2026
+ *       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+ *                   reserved.  Reproduction in whole or in part is prohibited
+ *                   without the prior written consent of the copyright holder.
+ *******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <string.h>
+#include "portable.h"
+#include "timer.h"
+#include "SysTick.h"
+#include "FlashMemory.h"
+#include "TargetProtocol.h"
+#include "UI_MainTab.h"
+#include "DownholeUpdate.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// wait for a reply before asking again, and how many times to ask.  While
+// the downhole checks the image it is asked how it is going this often.
+#define DOWNHOLE_UPDATE_TIMEOUT		THREE_SECOND
+#define DOWNHOLE_UPDATE_RETRIES		5
+
+// the image follows the header page
+#define DOWNHOLE_IMAGE_FIRST_PAGE	1ul
+#define DOWNHOLE_IMAGE_MAX_SIZE		((FIRMWARE_IMAGE_PAGES - DOWNHOLE_IMAGE_FIRST_PAGE) * CHIP_PAGE_SIZE)
+
+// m_nPage when no image page is held
+#define DOWNHOLE_IMAGE_NO_PAGE		0xFFFFFFFFul
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+typedef enum
+{
+	UPDATE_IDLE,
+	UPDATE_START,		// waiting for the downhole to take the image
+	UPDATE_STATUS,		// waiting for the chunks it has
+	UPDATE_SEND,		// waiting for it to take a chunk
+	UPDATE_COMMIT,		// waiting for it to start checking the image
+	UPDATE_VERIFY,		// waiting for the check to finish
+} UPDATE_STATE;
+
+static UPDATE_STATE m_eUpdate = UPDATE_IDLE;
+static U_INT32 m_nImageSize;
+static U_INT32 m_nImageCRC;
+static U_INT16 m_nChunks;
+// the part of the downhole bitmap last asked for, from chunk m_nWindowFirst
+static U_INT16 m_nWindowFirst;
+static U_BYTE m_nWindow[DOWNHOLE_FIRMWARE_BITMAP_MAX];
+static U_BYTE m_nWindowBytes;
+static U_INT16 m_nChunk;	// the chunk being sent
+static U_BYTE m_nRetries;
+static TIME_LR m_tUpdateTimer;
+// the image page the chunks are being sent from
+static U_INT32 m_nPage = DOWNHOLE_IMAGE_NO_PAGE;
+static U_BYTE m_nPageData[CHIP_PAGE_SIZE];
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void DownholeUpdate_Next(UPDATE_STATE eState);
+static void DownholeUpdate_Request(void);
+static BOOL DownholeUpdate_FindMissing(void);
+static void DownholeUpdate_NextWindow(void);
+static void DownholeUpdate_SendChunk(void);
+static void DownholeUpdate_Finish(char *message);
+static BOOL DownholeUpdate_TimedOut(void);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+ *       @details
+ *       The image is in the firmware area of the serial flash, after a
+ *       DOWNHOLE_IMAGE_HEADER page.
+ *******************************************************************************/
+void DownholeUpdate_Start(void)
+{
+	DOWNHOLE_IMAGE_HEADER header;
+
+	if(m_eUpdate != UPDATE_IDLE)
+	{
+		return;
+	}
+	m_nPage = DOWNHOLE_IMAGE_NO_PAGE;
+	if(Serflash_read_firmware_page(0, m_nPageData) == 0)
+	{
+		ShowStatusMessage("Downhole Update Failed - No Image");
+		return;
+	}
+	memcpy(&header, m_nPageData, sizeof(header));
+	if((header.nMagic != DOWNHOLE_IMAGE_MAGIC) || (header.nSize == 0) ||
+	   (header.nSize > DOWNHOLE_IMAGE_MAX_SIZE))
+	{
+		ShowStatusMessage("Downhole Update Failed - No Image");
+		return;
+	}
+	m_nImageSize = header.nSize;
+	m_nImageCRC = header.nCRC;
+	m_nChunks = (U_INT16)((m_nImageSize + DOWNHOLE_FIRMWARE_CHUNK_SIZE - 1) / DOWNHOLE_FIRMWARE_CHUNK_SIZE);
+	m_nWindowFirst = 0;
+	ShowStatusMessage("Updating Downhole, Please Wait...");
+	DownholeUpdate_Next(UPDATE_START);
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+BOOL DownholeUpdate_IsUpdating(void)
+{
+	return m_eUpdate != UPDATE_IDLE;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Answers start, status and commit.  Start and commit send the bitmap
+ *       from chunk 0.  Replies for some other image, or part of the bitmap
+ *       not asked for, are repeats, drop them.
+ *******************************************************************************/
+void DownholeUpdate_ReceiveStatus(U_BYTE nState, U_INT32 nSize, U_INT32 nCRC, U_INT16 nReceived,
+	U_INT16 nFirst, U_BYTE nCount, const U_BYTE *pBitmap)
+{
+	if((m_eUpdate == UPDATE_IDLE) || (m_eUpdate == UPDATE_SEND))
+	{
+		return;
+	}
+	if((nSize != m_nImageSize) || (nCRC != m_nImageCRC))
+	{
+		if(m_eUpdate == UPDATE_START)
+		{
+			DownholeUpdate_Finish("Downhole Update Failed - Image Refused");
+		}
+		return;
+	}
+	switch(nState)
+	{
+		case DOWNHOLE_FIRMWARE_RECEIVING:
+			break;
+		case DOWNHOLE_FIRMWARE_VERIFYING:
+			// ask again once the timeout is up
+			m_nRetries = 0;
+			m_tUpdateTimer = ElapsedTimeLowRes(0);
+			m_eUpdate = UPDATE_VERIFY;
+			return;
+		case DOWNHOLE_FIRMWARE_READY:
+			DownholeUpdate_Finish("Downhole Update Done - Restart The Tool");
+			return;
+		case DOWNHOLE_FIRMWARE_FAILED:
+			DownholeUpdate_Finish("Downhole Update Failed - Bad Image");
+			return;
+		default:
+			DownholeUpdate_Finish("Downhole Update Failed - Image Refused");
+			return;
+	}
+	if(nReceived >= m_nChunks)
+	{
+		DownholeUpdate_Next(UPDATE_COMMIT);
+		return;
+	}
+	if((m_eUpdate == UPDATE_START) || (m_eUpdate == UPDATE_COMMIT) || (m_eUpdate == UPDATE_VERIFY))
+	{
+		m_nWindowFirst = 0;
+	}
+	if((nFirst != m_nWindowFirst) || (nCount > DOWNHOLE_FIRMWARE_BITMAP_MAX))
+	{
+		return;
+	}
+	memcpy(m_nWindow, pBitmap, nCount);
+	m_nWindowBytes = nCount;
+	m_nChunk = m_nWindowFirst;
+	if(DownholeUpdate_FindMissing())
+	{
+		DownholeUpdate_Next(UPDATE_SEND);
+	}
+	else
+	{
+		DownholeUpdate_NextWindow();
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       A chunk spoilt on the way is sent again, that counts as asking again.
+ *******************************************************************************/
+void DownholeUpdate_ReceiveChunk(U_INT16 nChunk, U_BYTE nResult, U_INT16 nReceived)
+{
+	if((m_eUpdate != UPDATE_SEND) || (nChunk != m_nChunk))
+	{
+		return;
+	}
+	switch(nResult)
+	{
+		case DOWNHOLE_CHUNK_OK:
+			m_nWindow[(nChunk - m_nWindowFirst) / 8] |= (U_BYTE)(1 << ((nChunk - m_nWindowFirst) % 8));
+			if(nReceived >= m_nChunks)
+			{
+				DownholeUpdate_Next(UPDATE_COMMIT);
+			}
+			else if(DownholeUpdate_FindMissing())
+			{
+				DownholeUpdate_Next(UPDATE_SEND);
+			}
+			else
+			{
+				DownholeUpdate_NextWindow();
+			}
+			break;
+		case DOWNHOLE_CHUNK_BAD_CRC:
+			if(++m_nRetries > DOWNHOLE_UPDATE_RETRIES)
+			{
+				DownholeUpdate_Finish("Downhole Update Failed - Bad Link");
+				break;
+			}
+			DownholeUpdate_Request();
+			break;
+		case DOWNHOLE_CHUNK_NOT_RECEIVING:
+			// the downhole dropped the image, start it again
+			DownholeUpdate_Next(UPDATE_START);
+			break;
+		default:
+			DownholeUpdate_Finish("Downhole Update Failed - Downhole Flash");
+			break;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       Called every 10mS.
+ *******************************************************************************/
+void DownholeUpdate_Service(void)
+{
+	if(m_eUpdate == UPDATE_IDLE)
+	{
+		return;
+	}
+	if(DownholeUpdate_TimedOut())
+	{
+		DownholeUpdate_Request();
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static void DownholeUpdate_Next(UPDATE_STATE eState)
+{
+	m_eUpdate = eState;
+	m_nRetries = 0;
+	DownholeUpdate_Request();
+}
+
+/*******************************************************************************
+ *       @details
+ *       Sends what the present state waits on the reply to.
+ *******************************************************************************/
+static void DownholeUpdate_Request(void)
+{
+	m_tUpdateTimer = ElapsedTimeLowRes(0);
+	switch(m_eUpdate)
+	{
+		case UPDATE_START:
+			TargProtocol_RequestFirmwareStart(m_nImageSize, m_nImageCRC);
+			break;
+		case UPDATE_STATUS:
+			TargProtocol_RequestFirmwareStatus(m_nWindowFirst);
+			break;
+		case UPDATE_SEND:
+			DownholeUpdate_SendChunk();
+			break;
+		case UPDATE_COMMIT:
+			TargProtocol_RequestFirmwareCommit(m_nImageCRC);
+			break;
+		case UPDATE_VERIFY:
+			TargProtocol_RequestFirmwareStatus(0);
+			break;
+		default:
+			break;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       Moves m_nChunk on to the next chunk of the window the downhole does
+ *       not have, FALSE when there is none left in it.
+ *******************************************************************************/
+static BOOL DownholeUpdate_FindMissing(void)
+{
+	U_INT16 nBit;
+
+	while(m_nChunk < m_nChunks)
+	{
+		nBit = m_nChunk - m_nWindowFirst;
+		if(nBit >= (m_nWindowBytes * 8))
+		{
+			break;
+		}
+		if((m_nWindow[nBit / 8] & (1 << (nBit % 8))) == 0)
+		{
+			return true;
+		}
+		m_nChunk++;
+	}
+	return false;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Asks for the next part of the bitmap, back to the start after the
+ *       last, so chunks lost on the way are sent on the next pass.
+ *******************************************************************************/
+static void DownholeUpdate_NextWindow(void)
+{
+	m_nWindowFirst += DOWNHOLE_FIRMWARE_BITMAP_MAX * 8;
+	if(m_nWindowFirst >= m_nChunks)
+	{
+		m_nWindowFirst = 0;
+	}
+	DownholeUpdate_Next(UPDATE_STATUS);
+}
+
+/*******************************************************************************
+ *       @details
+ *       Chunks go in order, so each image page is read once a pass.
+ *******************************************************************************/
+static void DownholeUpdate_SendChunk(void)
+{
+	U_INT32 nOffset;
+	U_INT32 nPage;
+	U_INT32 nLength;
+
+	nOffset = (U_INT32)m_nChunk * DOWNHOLE_FIRMWARE_CHUNK_SIZE;
+	nPage = DOWNHOLE_IMAGE_FIRST_PAGE + (nOffset / CHIP_PAGE_SIZE);
+	nLength = m_nImageSize - nOffset;
+	if(nLength > DOWNHOLE_FIRMWARE_CHUNK_SIZE)
+	{
+		nLength = DOWNHOLE_FIRMWARE_CHUNK_SIZE;
+	}
+	if(nPage != m_nPage)
+	{
+		if(Serflash_read_firmware_page(nPage, m_nPageData) == 0)
+		{
+			DownholeUpdate_Finish("Downhole Update Failed - No Image");
+			return;
+		}
+		m_nPage = nPage;
+	}
+	TargProtocol_SendFirmwareChunk(m_nChunk, &m_nPageData[nOffset % CHIP_PAGE_SIZE], (U_BYTE)nLength);
+}
+
+/*******************************************************************************
+ *       @details
+ *       TRUE when the reply is overdue and it is worth asking again, gives up
+ *       on the update after DOWNHOLE_UPDATE_RETRIES.  The downhole keeps what
+ *       it has, starting again carries on from there.
+ *******************************************************************************/
+static BOOL DownholeUpdate_TimedOut(void)
+{
+	if(ElapsedTimeLowRes(m_tUpdateTimer) < DOWNHOLE_UPDATE_TIMEOUT)
+	{
+		return false;
+	}
+	m_tUpdateTimer = ElapsedTimeLowRes(0);
+	if(++m_nRetries > DOWNHOLE_UPDATE_RETRIES)
+	{
+		DownholeUpdate_Finish("Downhole Update Failed - No Reply");
+		return false;
+	}
+	return true;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static void DownholeUpdate_Finish(char *message)
+{
+	m_eUpdate = UPDATE_IDLE;
+	ShowStatusMessage(message);
+}
@@ -18,6 +18,8 @@
 //============================================================================//
 
 static U_INT16 m_nSurveyGamma = 0;
+// standard error of the gamma count, 0.1 counts per second, 0 if not sent
+static U_INT16 m_nSurveyGammaError = 0;
 static U_BYTE bGammaValidValue = 0;
 static U_BYTE bGammaIsPowered = 0;
 
@@ -70,5 +72,21 @@ void SetSurveyGamma(U_INT16 nData)
  *******************************************************************************/
 U_INT16 GetSurveyGamma(void)
 {
-	return m_nSurveyGamma++;
+	return m_nSurveyGamma;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetSurveyGammaError(U_INT16 nData)
+{
+	m_nSurveyGammaError = nData;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_INT16 GetSurveyGammaError(void)
+{
+	return m_nSurveyGammaError;
 }
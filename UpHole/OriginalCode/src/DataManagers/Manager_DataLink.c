@@ -11,12 +11,23 @@
 //      INCLUDES                                                              //
 //============================================================================//
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stm32f4xx.h>
 #include "portable.h"
 #include "Manager_DataLink.h"
 #include "FlashMemory.h"
 
 #define sind(x) (sin((x) * PI / ONE_EIGHTY_DEGREES))
+
+// survey acceptance, the usual MWD field checks
+#define SURVEY_GTOTAL_NOMINAL		1000	// mG
+#define SURVEY_GTOTAL_TOLERANCE		3	// mG
+#define SURVEY_HTOTAL_TOLERANCE		30	// 10 nT
+#define SURVEY_DIP_TOLERANCE		5	// degrees times 10
+#define SURVEY_DRIFT_LIMIT		10	// 0.1 degrees C per minute
+#define SURVEY_GTOTAL_STD_LIMIT		30	// 0.1 mG
+#define SURVEY_HTOTAL_STD_LIMIT		150	// nT
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
@@ -28,6 +39,16 @@ static ANGLE_TIMES_TEN m_nSurveyRoll = 0;
 static ANGLE_TIMES_TEN m_nSurveyRollNotOffset = 0;
 static INT16 m_nSurveyTemperature = 0;
 static BOOL m_nSurveyValidity = 0;
+// quality (0 to 100) and age in seconds of a latched still survey
+static U_BYTE m_nSurveyQuality = 0;
+static U_INT16 m_nSurveyAge = 0;
+// Gtotal, Htotal, dip and spread of the survey
+static SURVEY_METRICS m_SurveyMetrics;
+// total field and dip of the last survey that passed, 0 for none yet
+static U_INT16 m_nReferenceHtotal = 0;
+static INT16 m_nReferenceDip = 0;
+// downhole magnetometer calibration, as last reported
+static COMPASS_CAL_STATUS m_CompassCalStatus;
 // we get a raw degrees value, and must provide a corrected one.
 // (all degrees in and out have the x10 tacked on)
 // the goal is to interpolate between two points.
@@ -199,6 +220,121 @@ void SetSurveyTemperature(INT16 nData)
 	m_nSurveyTemperature = nData;
 }
 
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetSurveyQuality(U_BYTE nQuality, U_INT16 nAge)
+{
+	m_nSurveyQuality = nQuality;
+	m_nSurveyAge = nAge;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_BYTE GetSurveyQuality(void)
+{
+	return m_nSurveyQuality;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+U_INT16 GetSurveyAge(void)
+{
+	return m_nSurveyAge;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetSurveyMetrics(const SURVEY_METRICS *pMetrics)
+{
+	m_SurveyMetrics = *pMetrics;
+}
+
+/*******************************************************************************
+ *       @details
+ *       For a downhole that sends no metrics, the survey is not checked.
+ *******************************************************************************/
+void ClearSurveyMetrics(void)
+{
+	memset(&m_SurveyMetrics, 0, sizeof(m_SurveyMetrics));
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void GetSurveyMetrics(SURVEY_METRICS *pMetrics)
+{
+	*pMetrics = m_SurveyMetrics;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void SetCompassCalStatus(const COMPASS_CAL_STATUS *pStatus)
+{
+	m_CompassCalStatus = *pStatus;
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+void GetCompassCalStatus(COMPASS_CAL_STATUS *pStatus)
+{
+	*pStatus = m_CompassCalStatus;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Checks the survey metrics and returns the SURVEY_FLAG_ bits of the
+ *       checks that failed.  The total gravity must be one G, the total
+ *       field and dip must match the last survey that passed, the compass
+ *       temperature must have settled and streamed samples must agree.  A
+ *       survey that passes becomes the reference for the next one.
+ *******************************************************************************/
+U_BYTE CheckSurveyMetrics(void)
+{
+	U_BYTE nFlags = 0;
+
+	// nothing reported, nothing to check
+	if(m_SurveyMetrics.nGtotal == 0)
+	{
+		return 0;
+	}
+	if(abs((INT32)m_SurveyMetrics.nGtotal - SURVEY_GTOTAL_NOMINAL) > SURVEY_GTOTAL_TOLERANCE)
+	{
+		nFlags |= SURVEY_FLAG_GTOTAL;
+	}
+	if((m_SurveyMetrics.nHtotal != 0) && (m_nReferenceHtotal != 0))
+	{
+		if(abs((INT32)m_SurveyMetrics.nHtotal - (INT32)m_nReferenceHtotal) > SURVEY_HTOTAL_TOLERANCE)
+		{
+			nFlags |= SURVEY_FLAG_HTOTAL;
+		}
+		if(abs((INT32)m_SurveyMetrics.nDip - (INT32)m_nReferenceDip) > SURVEY_DIP_TOLERANCE)
+		{
+			nFlags |= SURVEY_FLAG_DIP;
+		}
+	}
+	if(abs((INT32)m_SurveyMetrics.nTemperatureDrift) > SURVEY_DRIFT_LIMIT)
+	{
+		nFlags |= SURVEY_FLAG_DRIFT;
+	}
+	if((m_SurveyMetrics.nSamples > 1) &&
+	   ((m_SurveyMetrics.nGtotalStd > SURVEY_GTOTAL_STD_LIMIT) || (m_SurveyMetrics.nHtotalStd > SURVEY_HTOTAL_STD_LIMIT)))
+	{
+		nFlags |= SURVEY_FLAG_NOISY;
+	}
+	if((nFlags == 0) && (m_SurveyMetrics.nHtotal != 0))
+	{
+		m_nReferenceHtotal = m_SurveyMetrics.nHtotal;
+		m_nReferenceDip = m_SurveyMetrics.nDip;
+	}
+	return nFlags;
+}
+
 /*******************************************************************************
  *       @details
  *******************************************************************************/
@@ -44,6 +44,16 @@
 #define NULL_PAGE 0xFFFFFFFF
 #define BranchStatusCode 100
 
+// the survey log of layout 1, 48 byte records, 10 to a page
+#define LEGACY_RECORDS_PER_PAGE     10
+#define LEGACY_PAGE_FILLER          ((FLASH_PAGE_SIZE - 4) - (sizeof(LEGACY_RECORD_DATA) * LEGACY_RECORDS_PER_PAGE))
+
+// boreholeStats.nLayout while the layout 1 pages are being converted
+#define RECORD_LAYOUT_MIGRATING     0x52454300ul
+
+// PageNumber() can address no more pages than this
+#define RECORD_MAX_PAGES            256
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -63,15 +73,74 @@ typedef struct _NEWHOLE_INFO_PAGE
 	U_BYTE New_hole_filler[NEW_HOLE_FLASH_PAGE_FILLER];
 } NEWHOLE_INFO_PAGE;
 
+// STRUCT_RECORD_DATA as it was before the survey quality metrics, the same
+// fields at the same offsets
+typedef struct _LEGACY_RECORD_DATA
+{
+	TIME_RT tSurveyTimeStamp;
+	INT16 nAzimuth;
+	INT16 nPitch;
+	INT16 nRoll;
+	INT16 nTemperature;
+	INT16 nGamma;
+	INT16 nGTF;
+	INT16 Y;
+	INT16 X;
+	INT32 Z;
+	U_INT16 nRecordNumber;
+	U_INT16 nTotalLength;
+	RTC_DateTypeDef date;
+	INT16 StatusCode;
+	INT16 NumOfBranch;
+	INT16 NextBranchRecordNum;
+	INT16 PreviousBranchRecordNum;
+	INT16 PreviousRecordIndex;
+	INT16 GammaShotLock;
+	INT16 GammaShotNumCorrected;
+	BOOL InvalidDataFlag;
+	BOOL branchWasSet;
+} LEGACY_RECORD_DATA;
+
+// BOREHOLE_STATISTICS as it was, with no nLayout
+typedef struct _LEGACY_BOREHOLE_STATISTICS
+{
+	char BoreholeName[MAX_BOREHOLE_NAME_BYTES];
+	U_INT32 RecordCount;
+	U_INT32 TotalLength;
+	INT32 TotalDepth;
+	REAL32 TotalNorthings;
+	REAL32 TotalEastings;
+	LEGACY_RECORD_DATA MostRecentSurvey;
+	LEGACY_RECORD_DATA PreviousSurvey;
+	U_INT32 MergeIndex;
+	BOOL recordRetrieved;
+} LEGACY_BOREHOLE_STATISTICS;
+
+typedef struct _LEGACY_RECORD_PAGE
+{
+	U_INT32 number;
+	LEGACY_RECORD_DATA records[LEGACY_RECORDS_PER_PAGE];
+	U_BYTE filler[LEGACY_PAGE_FILLER];
+} LEGACY_RECORD_PAGE;
+
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
-static BOREHOLE_STATISTICS __attribute__((__section__(".bbramsection"))) boreholeStats;
-static RECORD_PAGE __attribute__((__section__(".bbramsection"))) m_WritePage;
+// The first two are the borehole statistics and the page being written as
+// firmware of layout 1 left them.  They keep their types and their place at
+// the start of .bbramsection, so the hole info that follows is found where
+// that firmware put it, and the statistics can be taken over at power up.
+static LEGACY_BOREHOLE_STATISTICS __attribute__((__section__(".bbramsection"))) m_LegacyStats;
+static LEGACY_RECORD_PAGE __attribute__((__section__(".bbramsection"), __used__)) m_LegacyWritePage;
 static NEWHOLE_INFO __attribute__((__section__(".bbramsection"))) newHole_tracker1;
 static NEWHOLE_INFO_PAGE __attribute__((__section__(".bbramsection"))) m_New_hole_info_WritePage;
 static BOOL __attribute__((__section__(".bbramsection"))) BranchSet;
 
+// placed after .bbramsection, see STM32F405VGTX_FLASH2.ld
+static BOREHOLE_STATISTICS __attribute__((__section__(".bbramrecords"))) boreholeStats;
+static RECORD_PAGE __attribute__((__section__(".bbramrecords"))) m_WritePage;
+static U_INT32 __attribute__((__section__(".bbramrecords"))) m_nMigratePages;
+
 static RECORD_PAGE m_ReadPage = { NULL_PAGE };
 static NEWHOLE_INFO_PAGE m_New_hole_info_ReadPage = { NULL_PAGE };
 static STRUCT_RECORD_DATA selectedSurveyRecord = { 0 };
@@ -82,6 +151,7 @@ static U_INT32 nBranchRecordNumber = 0;
 static BOOL ClearHoleDataSet = false;
 static INT16 TempBoreholeNumber = 0;
 static FLASH_PAGE page;
+static LEGACY_RECORD_PAGE m_LegacyReadPage = { NULL_PAGE };
 static INT16 GammaTemp = 0;
 
 //DAS STRUCT_RECORD_DATA record;
@@ -297,6 +367,133 @@ U_INT32 getLastRecordNumber(void)
 {
 	return boreholeStats.MostRecentSurvey.nRecordNumber - boreholeStats.MostRecentSurvey.GammaShotNumCorrected;
 }
+
+/*******************************************************************************
+ *       @details
+ *       A layout 1 record widened, the survey quality metrics and flags zero.
+ *******************************************************************************/
+static void LegacyRecordConvert(STRUCT_RECORD_DATA * record, const LEGACY_RECORD_DATA * legacy)
+{
+	RecordInit(record);
+	memcpy(record, legacy, sizeof(LEGACY_RECORD_DATA));
+}
+
+/*******************************************************************************
+ *       @details
+ *       TRUE if the layout 1 statistics look like a log, rather than the
+ *       random content of a battery backed SRAM that lost its battery.
+ *******************************************************************************/
+static BOOL LegacyStatsValid(void)
+{
+	return (m_LegacyStats.RecordCount >= 1) && (m_LegacyStats.RecordCount <= (RECORD_MAX_PAGES * RECORDS_PER_PAGE))
+			&& (m_LegacyStats.MostRecentSurvey.nRecordNumber <= m_LegacyStats.RecordCount)
+			&& (m_LegacyStats.MergeIndex <= m_LegacyStats.RecordCount);
+}
+
+/*******************************************************************************
+ *       @details
+ *       Takes over the layout 1 statistics and marks the conversion of the
+ *       record pages as begun, the number of new pages set before nLayout.
+ *******************************************************************************/
+static void LegacyStatsConvert(void)
+{
+	memset((void*) &boreholeStats, 0, sizeof(boreholeStats));
+	memcpy(boreholeStats.BoreholeName, m_LegacyStats.BoreholeName, sizeof(boreholeStats.BoreholeName));
+	boreholeStats.RecordCount = m_LegacyStats.RecordCount;
+	boreholeStats.TotalLength = m_LegacyStats.TotalLength;
+	boreholeStats.TotalDepth = m_LegacyStats.TotalDepth;
+	boreholeStats.TotalNorthings = m_LegacyStats.TotalNorthings;
+	boreholeStats.TotalEastings = m_LegacyStats.TotalEastings;
+	LegacyRecordConvert(&boreholeStats.MostRecentSurvey, &m_LegacyStats.MostRecentSurvey);
+	LegacyRecordConvert(&boreholeStats.PreviousSurvey, &m_LegacyStats.PreviousSurvey);
+	boreholeStats.MergeIndex = m_LegacyStats.MergeIndex;
+	boreholeStats.recordRetrieved = m_LegacyStats.recordRetrieved;
+	m_nMigratePages = (boreholeStats.RecordCount + RECORDS_PER_PAGE - 1) / RECORDS_PER_PAGE;
+	boreholeStats.nLayout = RECORD_LAYOUT_MIGRATING;
+}
+
+/*******************************************************************************
+ *       @details
+ *       Rewrites the layout 1 record pages in flash in the current layout.
+ *       New page k holds records 9k to 9k+8, which were in old pages k and
+ *       below, so working down from the last page never overwrites a page
+ *       still to be read.  m_nMigratePages counts down in the battery backed
+ *       SRAM, so a conversion cut short by a power down carries on where it
+ *       stopped.  The record 0 dummy and the rest of the last page are
+ *       converted as they are.  An old page that does not read back good
+ *       gives zeroed records, which show as empty rather than as nonsense.
+ *******************************************************************************/
+static void LegacyPagesConvert(void)
+{
+	BOOL bLegacyGood = false;
+	U_INT32 nRecord;
+	U_INT32 i;
+
+	while (m_nMigratePages > 0)
+	{
+		PageInit(&m_WritePage);
+		for (i = 0; i < RECORDS_PER_PAGE; i++)
+		{
+			nRecord = ((m_nMigratePages - 1) * RECORDS_PER_PAGE) + i;
+			if (nRecord >= boreholeStats.RecordCount)
+			{
+				break;
+			}
+			if (m_LegacyReadPage.number != (nRecord / LEGACY_RECORDS_PER_PAGE))
+			{
+				m_LegacyReadPage.number = nRecord / LEGACY_RECORDS_PER_PAGE;
+				bLegacyGood = FLASH_ReadPage(&page, m_LegacyReadPage.number + RECORD_AREA_BASE_ADDRESS) == FLASH_PAGE_GOOD;
+				memcpy(m_LegacyReadPage.records, &page, sizeof(m_LegacyReadPage.records));
+			}
+			if (bLegacyGood)
+			{
+				LegacyRecordConvert(&m_WritePage.records[i], &m_LegacyReadPage.records[nRecord % LEGACY_RECORDS_PER_PAGE]);
+			}
+		}
+		PageWrite(m_nMigratePages - 1);
+		m_nMigratePages--;
+	}
+}
+
+/*******************************************************************************
+ *       @details
+ *       The records, the page being written and the borehole statistics are
+ *       kept in the battery backed SRAM across a power down, and the record
+ *       pages in flash.  A log left by firmware of layout 1 is converted to
+ *       the current layout; anything else that does not carry the current
+ *       magic can not be read, so the log is started over rather than
+ *       misread.
+ *******************************************************************************/
+void RECORD_Initialize(void)
+{
+	if (boreholeStats.nLayout == RECORD_LAYOUT_MAGIC)
+	{
+		return;
+	}
+	if (boreholeStats.nLayout != RECORD_LAYOUT_MIGRATING)
+	{
+		if (!LegacyStatsValid())
+		{
+			RECORD_OpenLoggingFile();
+			return;
+		}
+		LegacyStatsConvert();
+	}
+	LegacyPagesConvert();
+	boreholeStats.nLayout = RECORD_LAYOUT_MAGIC;
+	// so a log of the current layout is never taken for one to convert
+	m_LegacyStats.RecordCount = 0;
+
+	// the page the next record goes in, as RECORD_InitBranchParam() leaves it
+	PageInit(&m_WritePage);
+	PageInit(&m_ReadPage);
+	if (PageOffset(boreholeStats.RecordCount) != 0)
+	{
+		PageRead(PageNumber(boreholeStats.RecordCount));
+		memcpy(m_WritePage.records, m_ReadPage.records, sizeof(m_WritePage.records));
+	}
+}
+
 /*******************************************************************************
  *       @details
  *******************************************************************************/
@@ -308,6 +505,7 @@ void RECORD_OpenLoggingFile(void)
 	NewHole_Info_PageInit(&m_New_hole_info_ReadPage);
 
 	memset((void*) &boreholeStats, 0, sizeof(boreholeStats));
+	boreholeStats.nLayout = RECORD_LAYOUT_MAGIC;
 	boreholeStats.RecordCount++;
 	nNewHoleRecordCount = 1;
 	memset((void*) &newHole_tracker1, 0, sizeof(newHole_tracker1));
@@ -486,6 +684,11 @@ static void MergeRecordCommon(STRUCT_RECORD_DATA * record)
 	boreholeStats.MostRecentSurvey.nTemperature = record->nTemperature;
 	boreholeStats.MostRecentSurvey.nGamma = record->nGamma;
 	boreholeStats.MostRecentSurvey.nGTF = record->nGTF;
+	boreholeStats.MostRecentSurvey.nGtotal = record->nGtotal;
+	boreholeStats.MostRecentSurvey.nHtotal = record->nHtotal;
+	boreholeStats.MostRecentSurvey.nDip = record->nDip;
+	boreholeStats.MostRecentSurvey.nSurveyFlags = record->nSurveyFlags;
+	boreholeStats.MostRecentSurvey.nSurveySamples = record->nSurveySamples;
 	if (boreholeStats.MostRecentSurvey.nRecordNumber > 0)
 	{
 		EASTING_NORTHING_DATA_STRUCT result;
@@ -722,6 +925,7 @@ void RECORD_removeLastRecord(void)
 	{
 		U_INT32 nRecordCountTemp = boreholeStats.RecordCount;
 		memset((void*) &boreholeStats, 0, sizeof(boreholeStats));
+		boreholeStats.nLayout = RECORD_LAYOUT_MAGIC;
 		boreholeStats.RecordCount = nRecordCountTemp;
 	}
 
@@ -741,6 +945,7 @@ void RECORD_InitNewHole(void)
 		U_INT32 nRecordCountTemp = boreholeStats.RecordCount;
 		Get_Save_NewHole_Info();
 		memset((void*) &boreholeStats, 0, sizeof(boreholeStats));
+		boreholeStats.nLayout = RECORD_LAYOUT_MAGIC;
 		boreholeStats.RecordCount = nRecordCountTemp;
 		nNewHoleRecordCount = 1;  // changed same as clear all hole
 		memset((void*) &selectedSurveyRecord, 0, sizeof(selectedSurveyRecord));
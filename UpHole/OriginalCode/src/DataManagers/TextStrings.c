@@ -136,7 +136,11 @@ static const char* const g_sEnglishTxtStrings[MAX_TXT_MSG]  = {
 	"Download Data To PC", //whs 15Feb2022 mod to Thumb Drive
 	"Write to USB File",
 	"Remove Thumb Drive",
-	"Upload Data To Magnestar" //ZD 21September2023 This is where the Text from the .h file becomes a displayable UI change with the text displaying what is written here without using a printf
+	"Upload Data To Magnestar", //ZD 21September2023 This is where the Text from the .h file becomes a displayable UI change with the text displaying what is written here without using a printf
+	"Record Downhole Log",
+	"Download Downhole Log",
+	"Download Downhole Diagnostics",
+	"Reset Downhole Tasks"
 };
 
 //============================================================================//
@@ -36,6 +36,7 @@
 #include "Compass_Panel.h"
 #include "Compass_Plot.h"
 #include "TargetProtocol.h"
+#include "DownholeSamples.h"
 #include "UI_EnterNewPipeLength.h"
 #include "tone_generator.h"
 
@@ -346,7 +347,7 @@ void LoggingManager(void)
 	if (tGetSurveyData == (TIME_LR) 0)
 	{
 		tGetSurveyData = ElapsedTimeLowRes(0);
-		TargProtocol_RequestAllData();
+		DownholeSamples_Poll((U_INT32)NVRAM_data.nCheckPollTime_sec * 1000);
 	} // whs 7Jan 2022 below was 1000 made it 2000.  This was a major fix !!!!
 	  // Caused  a periodic lockup
 	else if (ElapsedTimeLowRes(tGetSurveyData) > ((U_INT32)NVRAM_data.nCheckPollTime_sec * 1000))
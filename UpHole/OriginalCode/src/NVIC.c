@@ -118,6 +118,11 @@ void NVIC_InitIrq(enum NVIC_LIST eIRQ)
 			NVIC_Init(&NVIC_InitStructure);
 			break;
 		case NVIC_SPI1:
+			// Enable DMA2 Stream2 Channel3 (SPI1_RX), the end of a transfer
+			NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+			NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream2_IRQn;
+			NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+			NVIC_Init(&NVIC_InitStructure);
 			break;
 
 		case NVIC_UART1:
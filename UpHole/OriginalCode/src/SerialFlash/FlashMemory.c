@@ -165,17 +165,6 @@ BOOL FLASH_IsBusyNow(void)
 	return ((FLASH_ReadTheStatus() & FLASH_STATUS_BUSY_BIT) == FLASH_STATUS_BUSY);
 }
 
-/*******************************************************************************
- *       @details
- *******************************************************************************/
-static void SendBytes(U_BYTE * bytes, int len)
-{
-	for (int index = 0; index < len; index++)
-	{
-		SPI_TransferByte(bytes[index]);
-	}
-}
-
 /*******************************************************************************
  *       @details
  *******************************************************************************/
@@ -201,18 +190,6 @@ static void SendCommand(U_BYTE command, U_INT16 pageNumber)
 	}
 }
 
-/*******************************************************************************
- *       @details
- *******************************************************************************/
-static void ReceiveBytes(U_BYTE * bytes, U_INT16 length)
-{
-	U_INT16 index;
-	for (index = 0; index < length; index++)
-	{
-		bytes[index] = SPI_TransferByte(0x00);
-	}
-}
-
 /*******************************************************************************
  *       @details
  *******************************************************************************/
@@ -239,45 +216,57 @@ static void ErasePage(U_INT32 nPageNumber)
 
 /*******************************************************************************
  *       @details
+ *   false if the page did not come in whole, the buffer is then part stale.
  *******************************************************************************/
-void FLASH_ReadThePage(U_BYTE * page, U_INT32 pageNumber)
+BOOL FLASH_ReadThePage(U_BYTE * page, U_INT32 pageNumber)
 {
+	BOOL bRead;
+
 	if (page == NULL)
 	{
-		return;
+		return false;
 	}
 	if (!IsValidPage(pageNumber))
 	{
-		return;
+		return false;
 	}
 	SPI_ResetTransferTimeOut();
 	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true);
 	SendCommand(SERFLASH45_READ_PAGE_OPCODE, pageNumber);
 	SendEmptyBytes(4);
-	ReceiveBytes(page, CHIP_PAGE_SIZE);
+	bRead = SPI_Transfer(NULL, page, CHIP_PAGE_SIZE);
 	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
+	return bRead;
 }
 
 /*******************************************************************************
  *       @details
+ *   The buffer is filled ahead of the erase, a transfer that does not finish
+ *   leaves the page as it was.  false if the page was not written.
  *******************************************************************************/
-void FLASH_WriteThePage(U_BYTE * page, U_INT32 nPageNumber)
+BOOL FLASH_WriteThePage(U_BYTE * page, U_INT32 nPageNumber)
 {
-	U_BYTE pageData[CHIP_PAGE_SIZE];
+	// static for the DMA, and off the stack
+	static U_BYTE pageData[CHIP_PAGE_SIZE];
+	BOOL bSent;
 
 	if (Serial_Flash_Chip.ext_flash_working == false)
 	{
-		return;
+		return false;
 	}
 	if (IsValidPage(nPageNumber))
 	{
 		memcpy(pageData, page, CHIP_PAGE_SIZE);
 		SPI_ResetTransferTimeOut();
-		ErasePage(nPageNumber);
 		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true);
 		SendCommand(SERFLASH45_WRITE_BUFFER1_OPCODE, nPageNumber);
-		SendBytes(pageData, CHIP_PAGE_SIZE);
+		bSent = SPI_Transfer(pageData, NULL, CHIP_PAGE_SIZE);
 		SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
+		if (!bSent)
+		{
+			return false;
+		}
+		ErasePage(nPageNumber);
 		if (FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS))
 		{
 			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true);
@@ -285,20 +274,21 @@ void FLASH_WriteThePage(U_BYTE * page, U_INT32 nPageNumber)
 			SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
 			if (FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS))
 			{
-				return;
+				return true;
 			}
 			else
 			{
 				Serial_Flash_Chip.ext_flash_working = false;
-				return;
+				return false;
 			}
 		}
 		else
 		{
 			Serial_Flash_Chip.ext_flash_working = false;
-			return;
+			return false;
 		}
 	}
+	return false;
 }
 
 /*******************************************************************************
@@ -345,6 +335,19 @@ void Serflash_Events_Clear(void)
 	Serial_Flash_Chip.event_number = 0ul;
 }
 
+/****************************************************************************
+ * Function Name:   Serflash_read_firmware_page
+ * a_page counts from the start of the firmware image area, its header first
+ ****************************************************************************/
+U_BYTE Serflash_read_firmware_page(U_INT32 a_page, U_BYTE *theData)
+{
+	if ((Serial_Flash_Chip.ext_flash_working == false) || (a_page >= FIRMWARE_IMAGE_PAGES))
+	{
+		return 0;
+	}
+	return FLASH_ReadThePage(theData, a_page + Serial_Flash_Chip.FIRMWARE_start_page) ? 1 : 0;
+}
+
 /****************************************************************************
  * Function Name:   Serflash_find_next_event_slot
  * events are stored one per page, so return the integer number of the page
@@ -365,7 +368,10 @@ U_INT32 Serflash_find_next_event_slot(U_INT32 event_block_size)
 	while (loopy < Serial_Flash_Chip.EVENTS_pages_available)
 	{
 		target_page = Serial_Flash_Chip.EVENTS_start_page + loopy;
-		FLASH_ReadThePage(Serflash_page_data, target_page);
+		if (!FLASH_ReadThePage(Serflash_page_data, target_page))
+		{
+			return 0xFFFFFFFFul;
+		}
 		if ((Serflash_page_data[0] == 0xFF) && (Serflash_page_data[1] == 0xFF))
 		{
 			return target_page;
@@ -402,8 +408,12 @@ U_BYTE Serflash_program_event(U_BYTE * this_event, U_INT32 event_block_size)
 	{
 		Serflash_page_data[loopy] = *this_event++;
 	}
-	// program the buffer row back into the device
-	FLASH_WriteThePage(Serflash_page_data, a_page);
+	// program the buffer row back into the device, the event number stays
+	// on the page when it was not written
+	if (!FLASH_WriteThePage(Serflash_page_data, a_page))
+	{
+		return 0;
+	}
 	// bump up the event number
 	Serial_Flash_Chip.event_number++;
 	return 1;
@@ -430,7 +440,10 @@ U_BYTE Serflash_get_event(U_INT32 event_number, U_INT32 event_block_size, U_BYTE
 	}
 	// what page holds the event that we want?
 	a_page = partone + Serial_Flash_Chip.EVENTS_start_page;
-	FLASH_ReadThePage(Serflash_page_data, a_page);
+	if (!FLASH_ReadThePage(Serflash_page_data, a_page))
+	{
+		return 0;
+	}
 	if (event_block_size < sizeof(Serflash_page_data))
 	{
 		memcpy((void*) theData, Serflash_page_data, event_block_size);
@@ -458,7 +471,11 @@ U_BYTE Serflash_test_device(void)
 	// erase the test block.
 	ErasePage(Serial_Flash_Chip.NV_test_page);
 	// verify that FF's are all present.
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page);
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page))
+	{
+		Serial_Flash_Chip.ext_flash_working = false;
+		return 0;
+	}
 	for (loopy = 0; loopy < num_test_bytes; loopy++)
 	{
 		if (Serflash_page_data[loopy] != 0xFF)
@@ -472,9 +489,13 @@ U_BYTE Serflash_test_device(void)
 	{
 		Serflash_page_data[loopy] = loopy;
 	}
-	FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page);
 	// verify that data is present.
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page);
+	if (!FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page) ||
+	    !FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_test_page))
+	{
+		Serial_Flash_Chip.ext_flash_working = false;
+		return 0;
+	}
 	for (loopy = 0; loopy < num_test_bytes; loopy++)
 	{
 		if (Serflash_page_data[loopy] != (U_BYTE) loopy)
@@ -531,8 +552,12 @@ U_BYTE Serflash_read_NV_Block(void)
 	// yikes, if NVRAM_data grows beyond a page we are not prepared for it.
 	if (sizeof(NVRAM_data) > Serial_Flash_Chip.page_size)
 		return 0;
-	// go get all of our data from flash
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+	// go get all of our data from flash, what is in memory stays when the
+	// page does not come in whole
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page))
+	{
+		return 0;
+	}
 	NV_data_pointer = (U_BYTE*) &NVRAM_data;
 	NV_storage_pointer = (U_BYTE*) &Serflash_page_data[0];
 	for (loopy = 0; loopy < howmuch_data; loopy++)
@@ -578,8 +603,11 @@ U_BYTE Serflash_check_NV_Block(void)
 	// if a change, store the whole block to the flash.
 	// then leave and let the unit come around again.
 	// if we make it all the way through without writing a bit, we will flag a complete bit.
-	// pull the data into our buffer
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+	// pull the data into our buffer, or come around again for it
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page))
+	{
+		return 0;
+	}
 	NV_data_pointer = (U_BYTE*) &NVRAM_data;
 	NV_storage_pointer = (U_BYTE*) &Serflash_page_data[0];
 	for (loopy = 0; loopy < howmuch_data; loopy++)
@@ -615,7 +643,10 @@ U_BYTE Serflash_check_NV_Block(void)
 			NV_data_pointer++;
 		}
 		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+		if (!FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page))
+		{
+			return 0;
+		}
 	}
 	return 1;
 }
@@ -642,8 +673,12 @@ U_BYTE Serflash_read_Borehole_Block(void)
 	{
 		return 0;
 	}
-	// go get all of our data from flash
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page);
+	// go get all of our data from flash, what is in memory stays when the
+	// page does not come in whole
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page))
+	{
+		return 0;
+	}
 	Data_pointer = (U_BYTE*) &boreholeStatistics;
 	Storage_pointer = (U_BYTE*) &Serflash_page_data[0];
 	for (loopy = 0; loopy < howmuch_data; loopy++)
@@ -688,8 +723,11 @@ U_BYTE Serflash_check_Newhole_Block(void)
 	// if a change, store the whole block to the flash.
 	// then leave and let the unit come around again.
 	// if we make it all the way through without writing a bit, we will flag a complete bit.
-	// pull the data into our buffer
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page);
+	// pull the data into our buffer, or come around again for it
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page))
+	{
+		return 0;
+	}
 	Data_pointer = (U_BYTE*) &newHole_tracker;
 	Storage_pointer = (U_BYTE*) &Serflash_page_data[0];
 	for (loopy = 0; loopy < howmuch_data; loopy++)
@@ -722,7 +760,10 @@ U_BYTE Serflash_check_Newhole_Block(void)
 			Data_pointer++;
 		}
 		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page);
+		if (!FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page))
+		{
+			return 0;
+		}
 	}
 	return 1;
 }
@@ -749,8 +790,12 @@ U_BYTE Serflash_read_Newhole_Block(void)
 	{
 		return 0;
 	}
-	// go get all of our data from flash
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page);
+	// go get all of our data from flash, what is in memory stays when the
+	// page does not come in whole
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page))
+	{
+		return 0;
+	}
 	Data_pointer = (U_BYTE*) &newHole_tracker;
 	Storage_pointer = (U_BYTE*) &Serflash_page_data[0];
 	for (loopy = 0; loopy < howmuch_data; loopy++)
@@ -795,8 +840,11 @@ U_BYTE Serflash_check_Borehole_Block(void)
 	// if a change, store the whole block to the flash.
 	// then leave and let the unit come around again.
 	// if we make it all the way through without writing a bit, we will flag a complete bit.
-	// pull the data into our buffer
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page);
+	// pull the data into our buffer, or come around again for it
+	if (!FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page))
+	{
+		return 0;
+	}
 	Data_pointer = (U_BYTE*) &boreholeStatistics;
 	Storage_pointer = (U_BYTE*) &Serflash_page_data[0];
 	for (loopy = 0; loopy < howmuch_data; loopy++)
@@ -829,7 +877,10 @@ U_BYTE Serflash_check_Borehole_Block(void)
 			Data_pointer++;
 		}
 		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page);
+		if (!FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page))
+		{
+			return 0;
+		}
 	}
 	return 1;
 }
@@ -875,7 +926,8 @@ void Serflash_read_DID_data(void)
 	Serial_Flash_Chip.Borehole_start_page = FLASH_DATA[Serial_Flash_Chip.part_index].startof_page3;
 	Serial_Flash_Chip.Newhole_start_page = FLASH_DATA[Serial_Flash_Chip.part_index].startof_page4;
 	Serial_Flash_Chip.EVENTS_start_page = FLASH_DATA[Serial_Flash_Chip.part_index].startof_page5;
-	Serial_Flash_Chip.EVENTS_pages_available = FLASH_DATA[Serial_Flash_Chip.part_index].num_pages;
+	Serial_Flash_Chip.FIRMWARE_start_page = Serial_Flash_Chip.Max_pages_available - FIRMWARE_IMAGE_PAGES;
+	Serial_Flash_Chip.EVENTS_pages_available = Serial_Flash_Chip.FIRMWARE_start_page;
 	U_INT32 partone = Serial_Flash_Chip.EVENTS_start_page;
 	Serial_Flash_Chip.EVENTS_pages_available -= partone;
 	g_tFlashIdleTimer = ElapsedTimeLowRes((TIME_LR) 0);
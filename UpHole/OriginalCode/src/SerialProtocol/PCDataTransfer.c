@@ -85,8 +85,9 @@ static BOOL flag_start_dump = false;
 typedef enum
 {
     PCDT_STATE_IDLE, PCDT_STATE_SEND_INTRO, PCDT_STATE_SEND_LABELS1,
-    PCDT_STATE_SEND_LABELS2, PCDT_STATE_SEND_LABELS3, PCDT_STATE_GET_RECORD,
+    PCDT_STATE_SEND_LABELS2, PCDT_STATE_SEND_LABELS3, PCDT_STATE_SEND_LABELS4, PCDT_STATE_GET_RECORD,
     PCDT_STATE_SEND_LOG1, PCDT_STATE_SEND_LOG2, PCDT_STATE_SEND_LOG3, PCDT_STATE_SEND_LOG3B, PCDT_STATE_SEND_LOG3C,
+    PCDT_STATE_SEND_LOG3D,
     PCDT_STATE_SEND_LOG4, UnmountUSB, Holdon
 } PCDT_states;
 static PCDT_states SendLogToPC_state = PCDT_STATE_IDLE;
@@ -254,7 +255,20 @@ void PCPORT_StateMachine(void)  // whs 26Jan2022 should be ThumbDrivePort
 		case PCDT_STATE_SEND_LABELS3:
 			if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY3) // Check for elapsed time before proceeding
 			{
-				snprintf(nBuffer, 500, "Declin, DesiredAz, ToolFace, Statcode, #Branch, #BoreHole \r\n"); // Prepare message with labels
+				snprintf(nBuffer, 500, "Declin, DesiredAz, ToolFace, Statcode, #Branch, #BoreHole, "); // Prepare message with labels
+				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) nBuffer, strlen(nBuffer)); // Send the message over UART
+				tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR) 0); // Reset timer
+				SendLogToPC_state = PCDT_STATE_SEND_LABELS4; // Move to next state
+			}
+			break;
+
+			// Sending the Fourth set of labels, those of the columns after #BoreHole
+		case PCDT_STATE_SEND_LABELS4:
+			if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY3) // Check for elapsed time before proceeding
+			{
+				snprintf(nBuffer, 500, "Temp, GTF, NextBranchRec, PrevBranchRec, PrevRec, GammaShotLock, GammaShotNumCorr, "
+						"Invalid, BranchSet, TotalLength, TotalDepth, TotalNorthings, TotalEastings, "
+						"Gtotal(mG), Htotal(nT), Dip, Q \r\n"); // Prepare message with labels
 				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) nBuffer, strlen(nBuffer)); // Send the message over UART
 				tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR) 0); // Reset timer
 				SendLogToPC_state = PCDT_STATE_GET_RECORD; // Move to next state
@@ -400,13 +414,28 @@ void PCPORT_StateMachine(void)  // whs 26Jan2022 should be ThumbDrivePort
 			{
 				GetBoreholeStats(&bs);
 
-				snprintf(nBuffer, 1000, "%lu, %ld, %f, %f\n\r", // Create the message for the second part of the log data
+				snprintf(nBuffer, 1000, "%lu, %ld, %f, %f, ", // Create the message for the second part of the log data
 						bs.TotalLength,  //32
 						bs.TotalDepth,   //33
 						bs.TotalNorthings,  //34
 						bs.TotalEastings);  //35
 				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) nBuffer, strlen(nBuffer)); // Send the message via UART
 				tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR) 0); // Reset the timer
+				SendLogToPC_state = PCDT_STATE_SEND_LOG3D; // Move to the next state for sending the survey quality metrics
+			}
+			break;
+
+			// State for sending the survey quality metrics, zero for a survey the downhole sent none with
+		case PCDT_STATE_SEND_LOG3D:
+			if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY2) // Check if enough time has elapsed based on the low-res timer
+			{
+				snprintf(nBuffer, 500, "%u, %lu, %.1f, %s\n\r", // Create the message for the survey quality metrics
+						record.nGtotal,                                 //36
+						(U_INT32) record.nHtotal * 10ul,                //37
+						(REAL32) record.nDip / 10.0,                    //38
+						(record.nSurveyFlags != 0) ? "Q" : "");         //39
+				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*) nBuffer, strlen(nBuffer)); // Send the message via UART
+				tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR) 0); // Reset the timer
 				SendLogToPC_state = PCDT_STATE_SEND_LOG4; // Move to the next state for sending the fourth part of the log data
 			}
 			break;
@@ -508,6 +537,9 @@ void ProcessCsvLine(char * line)
 	double fTemp;
 	int iTemp;
 
+	// a file saved before the survey quality metrics were exported leaves them zero
+	memset(&record, 0, sizeof(record));
+
 	token = strtok((char*) line, ",");                   // 1
 	// the first token is the name
 
@@ -639,6 +671,27 @@ void ProcessCsvLine(char * line)
 	sscanf(token, "%lf", &fTemp);
 	bs.TotalEastings = (REAL32) fTemp;
 
+	token = strtok(NULL, ",");                          // 36
+	if ((token != NULL) && (sscanf(token, "%d", &iTemp) == 1))
+	{
+		record.nGtotal = iTemp;
+	}
+
+	token = strtok(NULL, ",");                          // 37
+	if ((token != NULL) && (sscanf(token, "%d", &iTemp) == 1))
+	{
+		record.nHtotal = iTemp / 10;
+	}
+
+	token = strtok(NULL, ",");                          // 38
+	if ((token != NULL) && (sscanf(token, "%lf", &fTemp) == 1))
+	{
+		record.nDip = (INT16) (fTemp * 10.0);
+	}
+
+	// the Q column says a check failed, not which, so the upload can not
+	// bring back the flags and leaves them clear
+
 	SetBoreholeStats(&bs);
 	StoreUploadedRecord(&record);
 }
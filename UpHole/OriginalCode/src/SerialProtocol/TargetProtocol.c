@@ -22,9 +22,15 @@
 #include "ModemDataRxHandler.h"
 #include "ModemDataTxHandler.h"
 #include "GammaSensor.h"
+#include "DownholeLog.h"
+#include "DownholeTasks.h"
+#include "DownholeBlackBox.h"
+#include "DownholeUpdate.h"
+#include "DownholeSamples.h"
 #include "DownholeBatteryAndLife.h"
 #include "Manager_Datalink.h"
 #include "UtilityFunctions.h"
+#include "crc.h"
 #include "SerialCommon.h"
 #include "TargetProtocol.h"
 #include "UI_DownholeTab.h"
@@ -53,9 +59,60 @@ enum {
 	CMD_SEND_DOWNHOLE_ON_TIME,
 	CMD_SEND_DOWNHOLE_GAMMA_ENABLE,
 	CMD_TURN_ON_SENSORS,
+	CMD_SET_COMPASS_STREAM,
+	CMD_GET_BEST_SURVEY,
+	CMD_SET_STILL_WINDOW,
+	CMD_COMPASS_CALIBRATE,
+	CMD_SET_GAMMA_WINDOW,
+	CMD_DATALOG_CONTROL,
+	CMD_DATALOG_READ,
+	CMD_GET_SAMPLE_BATCH,
+	CMD_GET_COMPACT_DATA_SET,
+	CMD_GET_TASK_STATS,
+	CMD_GET_BLACK_BOX,
+	CMD_FIRMWARE_START,
+	CMD_FIRMWARE_CHUNK,
+	CMD_FIRMWARE_STATUS,
+	CMD_FIRMWARE_COMMIT,
+	CMD_GET_LINK_STATS,
 	CMD_NUMBER_OF_COMMANDS
 };
 
+// numbers of the compact data set, in the order of the field mask bits
+enum {
+	COMPACT_STATE,
+	COMPACT_AZIMUTH,
+	COMPACT_PITCH,
+	COMPACT_ROLL,
+	COMPACT_TEMPERATURE,
+	COMPACT_GAMMA,
+	COMPACT_GAMMA_ERROR,
+	COMPACT_BATTERY,
+	COMPACT_SIGNAL,
+	COMPACT_TIME_LEFT,
+	COMPACT_GTOTAL,
+	COMPACT_HTOTAL,
+	COMPACT_DIP,
+	COMPACT_TEMPERATURE_DRIFT,
+	COMPACT_METRIC_SAMPLES,
+	COMPACT_GTOTAL_STD,
+	COMPACT_HTOTAL_STD,
+	COMPACT_SLEEP,
+	COMPACT_BATTERY_MIN,
+	COMPACT_SIGNAL_MAX,
+	COMPACT_FIELDS
+};
+
+// the last compact frame decoded, the downhole builds the next on it
+static INT32 m_nCompactValues[COMPACT_FIELDS];
+static U_BYTE m_nCompactSequence = 0;
+static BOOL m_bCompactValid = false;
+static BOOL m_bCompactIdentity = false;
+// a downhole that does not answer compact requests gets the full data set
+static BOOL m_bCompactPending = false;
+static U_BYTE m_nCompactMisses = 0;
+static U_INT32 m_nCompactPolls = 0;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -63,10 +120,37 @@ enum {
 static void clearTXbuffer(void);
 static void pushTXbuffer(U_BYTE someTXData, U_BYTE addtoChecksum);
 static void pushTXbuffer16(U_INT16 someTXData, U_BYTE addtoChecksum);
+static void pushTXbuffer32(U_INT32 someTXData, U_BYTE addtoChecksum);
 static void TargProtocol_RequestSendDownholeAwakeTime(U_INT16 awakeTime);
+static BOOL TargProtocol_ReadVarint(const U_BYTE *pData, U_BYTE nLength, U_BYTE *pIndex, U_INT32 *pValue);
+static void TargProtocol_DecodeCompactData(const U_BYTE *pData, U_BYTE nLength);
 
 #define MAX_VERSION_LEN 7
 #define	DATE_STRING_LEN 16
+// full data set is 0x30 bytes, newer downholes add a version, a length and
+// the survey metrics
+#define FULL_DATA_BASE_LENGTH		0x30
+#define FULL_DATA_METRICS_LENGTH	15
+#define FULL_DATA_MAX_LENGTH		0x80
+// a sample batch is a header then samples, a later downhole may send longer
+// samples with more on the end
+#define SAMPLE_BATCH_HEADER_LENGTH	9
+#define SAMPLE_BATCH_RECORD_LENGTH	19
+// compact data set, changes from the last frame as zigzag varints, a CRC-16
+// in place of the checksum
+#define COMPACT_DATA_VERSION		1
+#define COMPACT_DATA_HEADER_LENGTH	4
+#define COMPACT_REQUEST_IDENTITY	0x01	// send the version and date
+#define COMPACT_REQUEST_KEYFRAME	0x02	// we have no frame to build on
+#define COMPACT_FRAME_KEYFRAME		0x01	// changes are from zero
+#define COMPACT_FRAME_IDENTITY		0x02	// version and date follow the numbers
+#define COMPACT_STATE_COMPASS		0x01
+#define COMPACT_STATE_GAMMA_VALID	0x02
+#define COMPACT_STATE_GAMMA_ON		0x04
+// compact requests not answered before the full data set is asked for,
+// and how often a compact one is tried after that
+#define COMPACT_MAX_MISSES		3
+#define COMPACT_RETRY_EVERY		10
 /****************************************************************************
  *
  * Function Name:   ProcessTargetRXMessage
@@ -86,14 +170,57 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 	U_BYTE nNumberOfRXDataBytes;
 	INT16 Azimuth, Pitch, Roll;
 	U_INT16 GammaData;
+	U_INT16 GammaError;
 	U_INT16 Temperature;
 	U_INT16 BatteryVoltage;
     U_INT16 SignalStrength;
 	U_INT16 CurrentOnTime;
 	char *pVersionString;
 	char *pDateString;
+	U_BYTE surveyQuality;
+	U_INT16 surveyAge;
+	U_BYTE extensionVersion;
+	U_BYTE extensionLength;
+	BOOL bMetrics;
+	SURVEY_METRICS metrics;
+	COMPASS_CAL_STATUS calStatus;
+	DOWNHOLE_LOG_RECORD logRecords[DOWNHOLE_LOG_READ_MAX];
+	U_INT32 logFirst;
+	U_INT32 logCount;
+	U_INT32 logCapacity;
+	U_INT16 logInterval;
+	U_BYTE logState;
+	U_BYTE logRecordCount;
+	DOWNHOLE_SAMPLE samples[DOWNHOLE_SAMPLES_READ_MAX];
+	U_INT16 sampleFirst;
+	U_INT16 sampleDropped;
+	U_BYTE sampleRemaining;
+	U_BYTE sampleLength;
+	U_BYTE sampleCount;
+	DOWNHOLE_TASK tasks[DOWNHOLE_TASKS_READ_MAX];
+	U_BYTE taskTotal;
+	U_BYTE taskFirst;
+	U_BYTE taskCount;
+	DOWNHOLE_EVENT events[DOWNHOLE_BLACK_BOX_READ_MAX];
+	U_INT16 eventResets;
+	U_INT16 eventWatchdogResets;
+	U_INT16 eventStackFree;
+	U_BYTE eventTotal;
+	U_BYTE eventFirst;
+	U_BYTE eventCount;
+	U_BYTE firmwareState;
+	U_INT32 firmwareSize;
+	U_INT32 firmwareCRC;
+	U_INT16 firmwareReceived;
+	U_INT16 firmwareFirst;
+	U_BYTE firmwareCount;
+	U_BYTE firmwareBitmap;
+	U_INT16 firmwareChunk;
+	U_BYTE firmwareResult;
+	U_INT32 linkCounters[DOWNHOLE_LINK_COUNTERS_MAX];
+	U_BYTE linkTotal;
 
-	if(nLength > 200) return;
+	if(nLength > TARGET_MAX_MESSAGE_LENGTH) return;
 	index = 0;
 	// get the command ID
 	nCmdID = theData[index++];
@@ -101,7 +228,7 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 	{       // whs 17Dec2021 below downloads all Yitran data from Downhole
 		case CMD_GET_FULL_DATA_SET:
 			nNumberOfRXDataBytes = theData[index++];
-			if(nNumberOfRXDataBytes != 0x30)
+			if((nNumberOfRXDataBytes < FULL_DATA_BASE_LENGTH) || (nNumberOfRXDataBytes > FULL_DATA_MAX_LENGTH))
 			{
 				break;
 			}
@@ -143,6 +270,41 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 			// get the current awake on time, seconds u16
 			CurrentOnTime = GetUnsignedShort(&theData[index]);
 			index += 2;
+			// survey metrics extension, a later version only adds to the end
+			bMetrics = false;
+			GammaError = 0;
+			if(nNumberOfRXDataBytes >= (FULL_DATA_BASE_LENGTH + 2 + FULL_DATA_METRICS_LENGTH))
+			{
+				extensionVersion = theData[index];
+				extensionLength = theData[index + 1];
+				if((extensionVersion >= 1) && (extensionLength >= FULL_DATA_METRICS_LENGTH) &&
+				   ((FULL_DATA_BASE_LENGTH + 2 + extensionLength) <= nNumberOfRXDataBytes))
+				{
+					index += 2;
+					metrics.nGtotal = GetUnsignedShort(&theData[index]);
+					index += 2;
+					metrics.nHtotal = GetUnsignedShort(&theData[index]);
+					index += 2;
+					metrics.nDip = GetSignedShort(&theData[index]);
+					index += 2;
+					metrics.nTemperatureDrift = GetSignedShort(&theData[index]);
+					index += 2;
+					metrics.nSamples = theData[index++];
+					metrics.nGtotalStd = GetUnsignedShort(&theData[index]);
+					index += 2;
+					metrics.nHtotalStd = GetUnsignedShort(&theData[index]);
+					index += 2;
+					// version 1 left this spare
+					if(extensionVersion >= 2)
+					{
+						GammaError = GetUnsignedShort(&theData[index]);
+					}
+					index += 2;
+					bMetrics = true;
+				}
+			}
+			// skip whatever is left, the checksum follows the byte count
+			index = 2 + nNumberOfRXDataBytes;
 			// is all data valid?
 			// check after cmd and length up to checksum
 			checksum = 0;
@@ -161,15 +323,397 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 				SetGammaValidState(gammaValidState);
 				SetGammaPoweredState(gammaPoweredState);
 				SetSurveyGamma(GammaData);
+				SetSurveyGammaError(GammaError);
 				SetDownholeBatteryVoltage(BatteryVoltage);
 				SetDownholeSignalStrength(SignalStrength);
 				SetDownholeSWVersion(pVersionString, MAX_VERSION_LEN);
 				SetDownholeSWDate(pDateString, DATE_STRING_LEN);
 				SetCurrentAwakeTime(CurrentOnTime);
+				if(bMetrics)
+				{
+					SetSurveyMetrics(&metrics);
+				}
+				else
+				{
+					ClearSurveyMetrics();
+				}
+			}
+			break;
+		case CMD_GET_BEST_SURVEY:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes != 0x0E)
+			{
+				break;
+			}
+			// was the tool ever still?
+			surveyCommsState = theData[index++];
+			// get azimuth, pitch, and roll, signed 16
+			Azimuth = GetSignedShort(&theData[index]);
+			index += 2;
+			Pitch = GetSignedShort(&theData[index]);
+			index += 2;
+			Roll = GetSignedShort(&theData[index]);
+			index += 2;
+			// get temperature
+			Temperature = GetUnsignedShort(&theData[index]);
+			index += 2;
+			// quality 0 to 100, skip the number of samples
+			surveyQuality = theData[index++];
+			index++;
+			// seconds since the survey was latched
+			surveyAge = GetUnsignedShort(&theData[index]);
+			index += 2;
+			// skip the still right now flag
+			index++;
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if((checksum == theData[index]) && surveyCommsState)
+			{
+				SetSurveyCommsState(surveyCommsState);
+				SetSurveyAzimuth(Azimuth);
+				SetSurveyPitch(Pitch);
+				SetSurveyRoll(Roll);
+				SetSurveyTemperature(Temperature);
+				SetSurveyQuality(surveyQuality, surveyAge);
+			}
+			break;
+		case CMD_COMPASS_CALIBRATE:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes != 0x06)
+			{
+				break;
+			}
+			calStatus.nState = theData[index++];
+			calStatus.nSamples = GetUnsignedShort(&theData[index]);
+			index += 2;
+			calStatus.nResidual = GetUnsignedShort(&theData[index]);
+			index += 2;
+			calStatus.bInUse = theData[index++] ? TRUE : FALSE;
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				SetCompassCalStatus(&calStatus);
+				RepaintNow(&HomeFrame);
 			}
 			break;
+		case CMD_DATALOG_CONTROL:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes != 0x0B)
+			{
+				break;
+			}
+			logState = theData[index++];
+			logInterval = GetUnsignedShort(&theData[index]);
+			index += 2;
+			logCount = GetUnsignedLong(&theData[index]);
+			index += 4;
+			logCapacity = GetUnsignedLong(&theData[index]);
+			index += 4;
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeLog_SetStatus(logState, logInterval, logCount, logCapacity);
+				RepaintNow(&HomeFrame);
+			}
+			break;
+		case CMD_DATALOG_READ:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes < 5)
+			{
+				break;
+			}
+			logFirst = GetUnsignedLong(&theData[index]);
+			index += 4;
+			logRecordCount = theData[index++];
+			// 15 bytes a record
+			if((logRecordCount > DOWNHOLE_LOG_READ_MAX) ||
+			   (nNumberOfRXDataBytes != (5 + (logRecordCount * 15))))
+			{
+				break;
+			}
+			for(loopy=0; loopy<logRecordCount; loopy++)
+			{
+				logRecords[loopy].nFlags = theData[index++];
+				logRecords[loopy].nSession = GetUnsignedShort(&theData[index]);
+				index += 2;
+				logRecords[loopy].tTime = GetUnsignedLong(&theData[index]);
+				index += 4;
+				logRecords[loopy].nGamma = GetUnsignedShort(&theData[index]);
+				index += 2;
+				logRecords[loopy].nGammaError = GetUnsignedShort(&theData[index]);
+				index += 2;
+				logRecords[loopy].nInclination = GetSignedShort(&theData[index]);
+				index += 2;
+				logRecords[loopy].nToolface = GetSignedShort(&theData[index]);
+				index += 2;
+			}
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeLog_ReceiveRecords(logFirst, logRecordCount, logRecords);
+			}
+			break;
+		case CMD_GET_TASK_STATS:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes < 3)
+			{
+				break;
+			}
+			taskTotal = theData[index++];
+			taskFirst = theData[index++];
+			taskCount = theData[index++];
+			// 20 bytes a task
+			if((taskCount > DOWNHOLE_TASKS_READ_MAX) ||
+			   (nNumberOfRXDataBytes != (3 + (taskCount * 20))))
+			{
+				break;
+			}
+			for(loopy=0; loopy<taskCount; loopy++)
+			{
+				memcpy(tasks[loopy].sName, &theData[index], DOWNHOLE_TASK_NAME_LENGTH);
+				tasks[loopy].sName[DOWNHOLE_TASK_NAME_LENGTH] = 0;
+				index += DOWNHOLE_TASK_NAME_LENGTH;
+				tasks[loopy].nPeriod = GetUnsignedShort(&theData[index]);
+				index += 2;
+				tasks[loopy].nRuns = GetUnsignedLong(&theData[index]);
+				index += 4;
+				tasks[loopy].nMisses = GetUnsignedShort(&theData[index]);
+				index += 2;
+				tasks[loopy].nWorstMicroSeconds = GetUnsignedLong(&theData[index]);
+				index += 4;
+				tasks[loopy].nAverageMicroSeconds = GetUnsignedLong(&theData[index]);
+				index += 4;
+			}
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeTasks_ReceiveTasks(taskTotal, taskFirst, taskCount, tasks);
+			}
+			break;
+		case CMD_GET_BLACK_BOX:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes < 9)
+			{
+				break;
+			}
+			eventResets = GetUnsignedShort(&theData[index]);
+			index += 2;
+			eventWatchdogResets = GetUnsignedShort(&theData[index]);
+			index += 2;
+			eventStackFree = GetUnsignedShort(&theData[index]);
+			index += 2;
+			eventTotal = theData[index++];
+			eventFirst = theData[index++];
+			eventCount = theData[index++];
+			// 11 bytes an event
+			if((eventCount > DOWNHOLE_BLACK_BOX_READ_MAX) ||
+			   (nNumberOfRXDataBytes != (9 + (eventCount * 11))))
+			{
+				break;
+			}
+			for(loopy=0; loopy<eventCount; loopy++)
+			{
+				events[loopy].nType = theData[index++];
+				memcpy(events[loopy].sTask, &theData[index], DOWNHOLE_EVENT_TASK_LENGTH);
+				events[loopy].sTask[DOWNHOLE_EVENT_TASK_LENGTH] = 0;
+				index += DOWNHOLE_EVENT_TASK_LENGTH;
+				events[loopy].nData = GetUnsignedShort(&theData[index]);
+				index += 2;
+				events[loopy].tTime = GetUnsignedLong(&theData[index]);
+				index += 4;
+			}
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeBlackBox_ReceiveEvents(eventResets, eventWatchdogResets, eventStackFree,
+					eventTotal, eventFirst, eventCount, events);
+			}
+			break;
+		case CMD_FIRMWARE_START:
+		case CMD_FIRMWARE_STATUS:
+		case CMD_FIRMWARE_COMMIT:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes < 14)
+			{
+				break;
+			}
+			firmwareState = theData[index++];
+			firmwareSize = GetUnsignedLong(&theData[index]);
+			index += 4;
+			firmwareCRC = GetUnsignedLong(&theData[index]);
+			index += 4;
+			firmwareReceived = GetUnsignedShort(&theData[index]);
+			index += 2;
+			firmwareFirst = GetUnsignedShort(&theData[index]);
+			index += 2;
+			firmwareCount = theData[index++];
+			// then a bit a chunk from firmwareFirst
+			if((firmwareCount > DOWNHOLE_FIRMWARE_BITMAP_MAX) ||
+			   (nNumberOfRXDataBytes != (14 + firmwareCount)))
+			{
+				break;
+			}
+			firmwareBitmap = index;
+			index += firmwareCount;
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeUpdate_ReceiveStatus(firmwareState, firmwareSize, firmwareCRC, firmwareReceived,
+					firmwareFirst, firmwareCount, &theData[firmwareBitmap]);
+			}
+			break;
+		case CMD_FIRMWARE_CHUNK:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes != 5)
+			{
+				break;
+			}
+			firmwareChunk = GetUnsignedShort(&theData[index]);
+			index += 2;
+			firmwareResult = theData[index++];
+			firmwareReceived = GetUnsignedShort(&theData[index]);
+			index += 2;
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeUpdate_ReceiveChunk(firmwareChunk, firmwareResult, firmwareReceived);
+			}
+			break;
+		case CMD_GET_LINK_STATS:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes < 1)
+			{
+				break;
+			}
+			linkTotal = theData[index++];
+			// 4 bytes a counter, those past the ones known are skipped
+			if(nNumberOfRXDataBytes != (1 + (linkTotal * 4)))
+			{
+				break;
+			}
+			for(loopy=0; loopy<linkTotal; loopy++)
+			{
+				if(loopy < DOWNHOLE_LINK_COUNTERS_MAX)
+				{
+					linkCounters[loopy] = GetUnsignedLong(&theData[index]);
+				}
+				index += 4;
+			}
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeTasks_ReceiveLinkStats((linkTotal < DOWNHOLE_LINK_COUNTERS_MAX) ? linkTotal :
+					DOWNHOLE_LINK_COUNTERS_MAX, linkCounters);
+			}
+			break;
+		case CMD_GET_SAMPLE_BATCH:
+			nNumberOfRXDataBytes = theData[index++];
+			if(nNumberOfRXDataBytes < SAMPLE_BATCH_HEADER_LENGTH)
+			{
+				break;
+			}
+			sampleFirst = GetUnsignedShort(&theData[index]);
+			index += 2;
+			// skip the sample interval
+			index += 2;
+			sampleDropped = GetUnsignedShort(&theData[index]);
+			index += 2;
+			sampleRemaining = theData[index++];
+			sampleLength = theData[index++];
+			sampleCount = theData[index++];
+			if((sampleLength < SAMPLE_BATCH_RECORD_LENGTH) || (sampleCount > DOWNHOLE_SAMPLES_READ_MAX) ||
+			   (nNumberOfRXDataBytes != (SAMPLE_BATCH_HEADER_LENGTH + (sampleCount * sampleLength))))
+			{
+				break;
+			}
+			for(loopy=0; loopy<sampleCount; loopy++)
+			{
+				samples[loopy].tTime = GetUnsignedLong(&theData[index]);
+				samples[loopy].nFlags = theData[index + 4];
+				samples[loopy].nAzimuth = GetSignedShort(&theData[index + 5]);
+				samples[loopy].nPitch = GetSignedShort(&theData[index + 7]);
+				samples[loopy].nRoll = GetSignedShort(&theData[index + 9]);
+				samples[loopy].nTemperature = GetUnsignedShort(&theData[index + 11]);
+				samples[loopy].nGamma = GetUnsignedShort(&theData[index + 13]);
+				samples[loopy].nGammaError = GetUnsignedShort(&theData[index + 15]);
+				samples[loopy].nBattery = GetUnsignedShort(&theData[index + 17]);
+				index += sampleLength;
+			}
+			checksum = 0;
+			for(loopy=2; loopy<index; loopy++)
+			{
+				checksum += theData[loopy];
+			}
+			checksum = ~checksum;
+			if(checksum == theData[index])
+			{
+				DownholeSamples_ReceiveBatch(sampleFirst, sampleDropped, sampleRemaining, sampleCount, samples);
+			}
+			break;
+		case CMD_GET_COMPACT_DATA_SET:
+			nNumberOfRXDataBytes = theData[index++];
+			if((nNumberOfRXDataBytes < COMPACT_DATA_HEADER_LENGTH) ||
+			   (nLength < (U_INT16)(2 + nNumberOfRXDataBytes + 2)))
+			{
+				break;
+			}
+			// CRC-16 of the command, byte count and data
+			if(CRC16_Calculate(theData, 2 + nNumberOfRXDataBytes) !=
+			   GetUnsignedShort(&theData[2 + nNumberOfRXDataBytes]))
+			{
+				break;
+			}
+			TargProtocol_DecodeCompactData(&theData[index], nNumberOfRXDataBytes);
+			break;
 		case CMD_SEND_DOWNHOLE_ON_TIME:
 		case CMD_SEND_DOWNHOLE_GAMMA_ENABLE:
+		case CMD_SET_COMPASS_STREAM:
+		case CMD_SET_STILL_WINDOW:
+		case CMD_SET_GAMMA_WINDOW:
 			nNumberOfRXDataBytes = theData[index++];
 			if(nNumberOfRXDataBytes != 0)
 			{
@@ -231,6 +775,18 @@ static void pushTXbuffer16(U_INT16 someTXData, U_BYTE addtoChecksum)
 	pushTXbuffer( (U_BYTE)(someTXData >> 8), addtoChecksum );
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void pushTXbuffer32(U_INT32 someTXData, U_BYTE addtoChecksum)
+{
+	// order matches simple memcpy on the other end, match endian
+	pushTXbuffer( (U_BYTE)(someTXData & 0xFF), addtoChecksum );
+	pushTXbuffer( (U_BYTE)(someTXData >> 8), addtoChecksum );
+	pushTXbuffer( (U_BYTE)(someTXData >> 16), addtoChecksum );
+	pushTXbuffer( (U_BYTE)(someTXData >> 24), addtoChecksum );
+}
+
 
 
 /*******************************************************************************
@@ -238,6 +794,33 @@ static void pushTXbuffer16(U_INT16 someTXData, U_BYTE addtoChecksum)
 *******************************************************************************/
 void TargProtocol_RequestAllData(void)
 {
+	if(m_bCompactPending)
+	{
+		m_bCompactPending = false;
+		if(m_nCompactMisses < COMPACT_MAX_MISSES)
+		{
+			m_nCompactMisses++;
+		}
+	}
+	m_nCompactPolls++;
+	if((m_nCompactMisses < COMPACT_MAX_MISSES) || ((m_nCompactPolls % COMPACT_RETRY_EVERY) == 0))
+	{
+		// the last frame we have, and whether we need the version and date
+		clearTXbuffer();
+		pushTXbuffer( CMD_GET_COMPACT_DATA_SET, false );
+		// placeholder for the byte count
+		pushTXbuffer( 0, false );
+		pushTXbuffer( m_nCompactSequence, true );
+		pushTXbuffer( (m_bCompactIdentity ? 0 : COMPACT_REQUEST_IDENTITY) |
+					  (m_bCompactValid ? 0 : COMPACT_REQUEST_KEYFRAME), true );
+		// go back and touch up the byte count
+		port.tx.buffer[1] = port.tx.checked_bytes;
+		// now push the checksum that we built up
+		pushTXbuffer( getTXChecksum(), false );
+		Modem_MessageToSend(port.tx.buffer, port.tx.count);
+		m_bCompactPending = true;
+		return;
+	}
 	// for request sensor data, there is no data attached to the message
 	clearTXbuffer();
 	pushTXbuffer( CMD_GET_FULL_DATA_SET, false );
@@ -248,6 +831,127 @@ void TargProtocol_RequestAllData(void)
 	Modem_MessageToSend(port.tx.buffer, port.tx.count);
 }
 
+/*******************************************************************************
+*       @details
+*   Seven bits at a time, low first, the top bit set on all but the last.
+*******************************************************************************/
+static BOOL TargProtocol_ReadVarint(const U_BYTE *pData, U_BYTE nLength, U_BYTE *pIndex, U_INT32 *pValue)
+{
+	U_BYTE nShift;
+
+	*pValue = 0;
+	for(nShift = 0; nShift < 35; nShift += 7)
+	{
+		if(*pIndex >= nLength)
+		{
+			return false;
+		}
+		*pValue |= (U_INT32)(pData[*pIndex] & 0x7F) << nShift;
+		if((pData[(*pIndex)++] & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/*******************************************************************************
+*       @details
+*   Adds the changes to the last frame, or to zero for a key frame, and
+*   shows the result as the full data set does.  A frame built on one we do
+*   not have is dropped, and the next request asks for a key frame.
+*   Numbers past the ones we know are skipped.  A version we do not know is
+*   not decoded at all, the full data set is asked for instead.
+*******************************************************************************/
+static void TargProtocol_DecodeCompactData(const U_BYTE *pData, U_BYTE nLength)
+{
+	INT32 nValues[COMPACT_FIELDS];
+	U_INT32 nMask;
+	U_INT32 nChange;
+	U_BYTE nField;
+	U_BYTE nIndex;
+	U_BYTE nFlags;
+	SURVEY_METRICS metrics;
+
+	m_bCompactPending = false;
+	if(pData[0] != COMPACT_DATA_VERSION)
+	{
+		m_bCompactValid = false;
+		m_nCompactMisses = COMPACT_MAX_MISSES;
+		return;
+	}
+	m_nCompactMisses = 0;
+	nFlags = pData[3];
+	if(nFlags & COMPACT_FRAME_KEYFRAME)
+	{
+		memset(nValues, 0, sizeof(nValues));
+	}
+	else if(m_bCompactValid && (pData[2] == m_nCompactSequence))
+	{
+		memcpy(nValues, m_nCompactValues, sizeof(nValues));
+	}
+	else
+	{
+		m_bCompactValid = false;
+		return;
+	}
+	nIndex = COMPACT_DATA_HEADER_LENGTH;
+	if(!TargProtocol_ReadVarint(pData, nLength, &nIndex, &nMask))
+	{
+		return;
+	}
+	for(nField = 0; nField < 32; nField++)
+	{
+		if((nMask & (1ul << nField)) == 0)
+			continue;
+		if(!TargProtocol_ReadVarint(pData, nLength, &nIndex, &nChange))
+		{
+			return;
+		}
+		if(nField < COMPACT_FIELDS)
+		{
+			nValues[nField] += (INT32)(nChange >> 1) ^ -(INT32)(nChange & 1);
+		}
+	}
+	if(nFlags & COMPACT_FRAME_IDENTITY)
+	{
+		if((nIndex + MAX_VERSION_LEN + DATE_STRING_LEN) > nLength)
+		{
+			return;
+		}
+		SetDownholeSWVersion((char *)&pData[nIndex], MAX_VERSION_LEN);
+		nIndex += MAX_VERSION_LEN;
+		SetDownholeSWDate((char *)&pData[nIndex], DATE_STRING_LEN);
+		m_bCompactIdentity = true;
+	}
+	memcpy(m_nCompactValues, nValues, sizeof(m_nCompactValues));
+	m_nCompactSequence = pData[1];
+	m_bCompactValid = true;
+	SetSurveyCommsState((nValues[COMPACT_STATE] & COMPACT_STATE_COMPASS) ? 1 : 0);
+	SetSurveyAzimuth((ANGLE_TIMES_TEN)nValues[COMPACT_AZIMUTH]);
+	SetSurveyPitch((ANGLE_TIMES_TEN)nValues[COMPACT_PITCH]);
+	SetSurveyRoll((ANGLE_TIMES_TEN)nValues[COMPACT_ROLL]);
+	SetSurveyTemperature((INT16)nValues[COMPACT_TEMPERATURE]);
+	SetGammaValidState((nValues[COMPACT_STATE] & COMPACT_STATE_GAMMA_VALID) ? 1 : 0);
+	SetGammaPoweredState((nValues[COMPACT_STATE] & COMPACT_STATE_GAMMA_ON) ? 1 : 0);
+	SetSurveyGamma((U_INT16)nValues[COMPACT_GAMMA]);
+	SetSurveyGammaError((U_INT16)nValues[COMPACT_GAMMA_ERROR]);
+	SetDownholeBatteryVoltage((U_INT16)nValues[COMPACT_BATTERY]);
+	SetDownholeSignalStrength((U_INT16)nValues[COMPACT_SIGNAL]);
+	SetCurrentAwakeTime((U_INT16)nValues[COMPACT_TIME_LEFT]);
+	SetDownholeSleepPermille((U_INT16)nValues[COMPACT_SLEEP]);
+	SetDownholeBatteryMinimum((U_INT16)nValues[COMPACT_BATTERY_MIN]);
+	SetDownholeSignalMaximum((U_INT16)nValues[COMPACT_SIGNAL_MAX]);
+	metrics.nGtotal = (U_INT16)nValues[COMPACT_GTOTAL];
+	metrics.nHtotal = (U_INT16)nValues[COMPACT_HTOTAL];
+	metrics.nDip = (INT16)nValues[COMPACT_DIP];
+	metrics.nTemperatureDrift = (INT16)nValues[COMPACT_TEMPERATURE_DRIFT];
+	metrics.nSamples = (U_BYTE)nValues[COMPACT_METRIC_SAMPLES];
+	metrics.nGtotalStd = (U_INT16)nValues[COMPACT_GTOTAL_STD];
+	metrics.nHtotalStd = (U_INT16)nValues[COMPACT_HTOTAL_STD];
+	SetSurveyMetrics(&metrics);
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -256,6 +960,7 @@ void TargProtocol_RequestSensorData_log(void)
 	// converted.. we just log the data that is on the screen at the moment.
 	// then we setup a message to turn off sensors when done.
 	STRUCT_RECORD_DATA record;
+	SURVEY_METRICS metrics;
 	SetSurveyTime(RTC_GetSeconds());
 	record.tSurveyTimeStamp = RTC_GetSeconds();
 	RTC_GetDate(RTC_Format_BIN, &record.date);
@@ -272,6 +977,13 @@ void TargProtocol_RequestSensorData_log(void)
 	record.nGamma = GetSurveyGamma();
 	record.nTemperature = GetSurveyTemperature();
 	record.nGTF = GetGTF();
+	// keep how good the survey was, and flag it if it fails the checks
+	GetSurveyMetrics(&metrics);
+	record.nGtotal = metrics.nGtotal;
+	record.nHtotal = metrics.nHtotal;
+	record.nDip = metrics.nDip;
+	record.nSurveySamples = metrics.nSamples;
+	record.nSurveyFlags = CheckSurveyMetrics();
 	LoggingManager_RecordRetrieved(&record, GetSurveyGamma());
 	TargProtocol_SetSensorPowerState(false);
 	SurveyTakenFlag = false;
@@ -335,3 +1047,315 @@ void TargProtocol_SetSensorPowerState(BOOL bState)
 	pushTXbuffer( getTXChecksum(), false );
 	Modem_MessageToSend(port.tx.buffer, port.tx.count);
 }
+
+/*******************************************************************************
+*       @details
+*   Asks the downhole to request compass samples every nInterval mS and to
+*   average the last nWindow mS of them into each survey.  0 for either
+*   goes back to one reading per survey.
+*******************************************************************************/
+void TargProtocol_RequestCompassStream(U_INT16 nInterval, U_INT16 nWindow)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_SET_COMPASS_STREAM, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer16( nInterval, true );
+	pushTXbuffer16( nWindow, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks the downhole for the survey it latched the last time the tool was
+*   still.
+*******************************************************************************/
+void TargProtocol_RequestBestSurvey(void)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_BEST_SURVEY, false );
+	// no data bytes sent, 0 length
+	pushTXbuffer( 0, false );
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Sets how many mS the tool must be still before the downhole latches a
+*   survey.
+*******************************************************************************/
+void TargProtocol_RequestStillWindow(U_INT16 nWindow)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_SET_STILL_WINDOW, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer16( nWindow, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Starts, finishes, cancels or clears the downhole magnetometer
+*   calibration, COMPASS_CAL_ACTION_xxx.  The downhole answers with where
+*   the calibration is.
+*******************************************************************************/
+void TargProtocol_RequestCompassCalibrate(U_BYTE nAction)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_COMPASS_CALIBRATE, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer( nAction, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Sets the downhole gamma slot period and window, both mS, and the
+*   detector dead time in nS, 0 for none.  A longer window is less noisy
+*   but slower to follow the formation.
+*******************************************************************************/
+void TargProtocol_RequestGammaWindow(U_INT16 nPeriod, U_INT16 nWindow, U_INT16 nDeadTime)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_SET_GAMMA_WINDOW, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer16( nPeriod, true );
+	pushTXbuffer16( nWindow, true );
+	pushTXbuffer16( nDeadTime, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Starts, stops or clears the downhole gamma and inclination log,
+*   DATALOG_ACTION_xxx.  The interval in seconds only goes with a start.
+*   The downhole answers with the log status.
+*******************************************************************************/
+void TargProtocol_RequestDataLog(U_BYTE nAction, U_INT16 nInterval)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_DATALOG_CONTROL, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer( nAction, true );
+	if(nAction == DATALOG_ACTION_START)
+	{
+		pushTXbuffer16( nInterval, true );
+	}
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks for nCount downhole log records starting at nFirst.
+*******************************************************************************/
+void TargProtocol_RequestDataLogRead(U_INT32 nFirst, U_BYTE nCount)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_DATALOG_READ, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer32( nFirst, true );
+	pushTXbuffer( nCount, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks for the run statistics of the downhole scheduler tasks from nFirst
+*   on, nFlags is TASK_STATS_REQUEST_xxx.
+*******************************************************************************/
+void TargProtocol_RequestTaskStats(U_BYTE nFirst, U_BYTE nFlags)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_TASK_STATS, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer( nFirst, true );
+	pushTXbuffer( nFlags, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks for the downhole black box events from nFirst on, the oldest is 0,
+*   nFlags is BLACK_BOX_REQUEST_xxx.
+*******************************************************************************/
+void TargProtocol_RequestBlackBox(U_BYTE nFirst, U_BYTE nFlags)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_BLACK_BOX, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer( nFirst, true );
+	pushTXbuffer( nFlags, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Starts the downhole taking a firmware image, or carrying on with the one
+*   of the same size and CRC.  It answers with what it has.
+*******************************************************************************/
+void TargProtocol_RequestFirmwareStart(U_INT32 nSize, U_INT32 nCRC)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_FIRMWARE_START, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer32( nSize, true );
+	pushTXbuffer32( nCRC, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Sends chunk nChunk of the image with the CRC-32 of its number and bytes,
+*   the message checksum alone lets too much through for firmware.
+*******************************************************************************/
+void TargProtocol_SendFirmwareChunk(U_INT16 nChunk, const U_BYTE *pData, U_BYTE nLength)
+{
+	CRC32_CONTEXT crc;
+	U_BYTE nNumber[2];
+	U_BYTE loopy;
+
+	nNumber[0] = (U_BYTE)nChunk;
+	nNumber[1] = (U_BYTE)(nChunk >> 8);
+	CRC32_Start(&crc);
+	CRC32_Update(&crc, nNumber, sizeof(nNumber));
+	CRC32_Update(&crc, pData, nLength);
+	clearTXbuffer();
+	pushTXbuffer( CMD_FIRMWARE_CHUNK, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer16( nChunk, true );
+	for(loopy=0; loopy<nLength; loopy++)
+	{
+		pushTXbuffer( pData[loopy], true );
+	}
+	pushTXbuffer32( CRC32_Finish(&crc), true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks which chunks the downhole has, from chunk nFirst on.
+*******************************************************************************/
+void TargProtocol_RequestFirmwareStatus(U_INT16 nFirst)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_FIRMWARE_STATUS, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer16( nFirst, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Has the downhole check the whole image against nCRC, once every chunk is
+*   in it.
+*******************************************************************************/
+void TargProtocol_RequestFirmwareCommit(U_INT32 nCRC)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_FIRMWARE_COMMIT, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer32( nCRC, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks for the counters of the downhole serial links.
+*******************************************************************************/
+void TargProtocol_RequestLinkStats(void)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_LINK_STATS, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
+
+/*******************************************************************************
+*       @details
+*   Asks for the samples the downhole took from nNext on, which also tells it
+*   the ones before were had.  nInterval is the mS between samples, 0 keeps
+*   it.  The downhole sends as many as fit in a reply we take.
+*******************************************************************************/
+void TargProtocol_RequestSampleBatch(U_INT16 nNext, U_INT16 nInterval, U_BYTE nMaxSamples)
+{
+	clearTXbuffer();
+	pushTXbuffer( CMD_GET_SAMPLE_BATCH, false );
+	// placeholder for the byte count
+	pushTXbuffer( 0, false );
+	pushTXbuffer16( nNext, true );
+	pushTXbuffer16( nInterval, true );
+	pushTXbuffer( nMaxSamples, true );
+	// most data bytes, less the command, byte count and checksum
+	pushTXbuffer( TARGET_MAX_MESSAGE_LENGTH - 3, true );
+	// go back and touch up the byte count
+	port.tx.buffer[1] = port.tx.checked_bytes;
+	// now push the checksum that we built up
+	pushTXbuffer( getTXChecksum(), false );
+	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+}
@@ -30,6 +30,8 @@
 #include "UI_DownholeMainPanel.h"
 #include "version.h"
 #include "LoggingManager.h"
+#include "DownholeLog.h"
+#include "DownholeTasks.h"
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
@@ -41,6 +43,9 @@ static void Show(TAB_ENTRY* tab);
 static void TimerElapsed(TAB_ENTRY* tab);
 static void ShowDownholeVoltageTabDiag(char* message1, int rowbit);
 static void ShowDownholeVoltageTabDiag2(char* message1, int rowbit);
+static void DownloadDownholeLog(MENU_ITEM* item);
+static void DownloadDownholeTasks(MENU_ITEM* item);
+static void ClearDownholeTasks(MENU_ITEM* item);
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
@@ -48,6 +53,11 @@ static MENU_ITEM DownholeMenu[] =
 {
 	CREATE_BOOLEAN_FIELD(TXT_GAMMA_ON_OFF,			&LabelFrame1, &ValueFrame1,
 		CurrrentLabelFrame,     GetGammaPoweredState,	TargProtocol_RequestSendGammaEnable),
+	CREATE_BOOLEAN_FIELD(TXT_DOWNHOLE_LOG_RECORD,	&LabelFrame2, &ValueFrame2,
+		CurrrentLabelFrame,     DownholeLog_IsRecording,	DownholeLog_SetRecording),
+	CREATE_MENU_ITEM(TXT_DOWNHOLE_LOG_DOWNLOAD, &LabelFrame3, DownloadDownholeLog),
+	CREATE_MENU_ITEM(TXT_DOWNHOLE_TASKS_DOWNLOAD, &LabelFrame4, DownloadDownholeTasks),
+	CREATE_MENU_ITEM(TXT_DOWNHOLE_TASKS_CLEAR, &LabelFrame5, ClearDownholeTasks),
 };
 
 //============================================================================//
@@ -89,13 +99,15 @@ static void Paint(TAB_ENTRY * tab)
 	TabWindowPaint(tab);
 	U_BYTE nMenuCount = tab->MenuSize(tab);
 
-	snprintf(text, 100, "Downhole Voltage:         %.2f", (double) GetDownholeBatteryVoltage() / 1000);
+	snprintf(text, 100, "Downhole Voltage:         %.2f  Min %.2f", (double) GetDownholeBatteryVoltage() / 1000,
+		(double) GetDownholeBatteryMinimum() / 1000);
 	ShowDownholeVoltageTabDiag(text, ((nMenuCount + 0) * 15) + 4);
 
 	snprintf(text, 100, "Downhole Batt 2 Voltage:         %.2f", (double) GetDownholeBattery2Voltage() / 1000);
 	ShowDownholeVoltageTabDiag2(text, ((nMenuCount + 1) * 15) + 4);
 
-	snprintf(text, 100, "Downhole Signal Strength:        %d", GetDownholeSignalStrength());
+	snprintf(text, 100, "Downhole Signal Strength:        %d  Max %d", GetDownholeSignalStrength(),
+		GetDownholeSignalMaximum());
 	ShowDownholeVoltageTabDiag(text, ((nMenuCount + 2) * 15) + 4);
 
 	snprintf(text, 100, "Dwn Software Version:     %s  %s", GetDownholeSWVersion(), GetDownholeSWDate());
@@ -104,6 +116,12 @@ static void Paint(TAB_ENTRY * tab)
 	snprintf(text, 100, "Uph Software Version:     %s", GetSWVersion());
 	ShowDownholeVoltageTabDiag(text, ((nMenuCount + 4) * 15) + 4);
 
+	snprintf(text, 100, "Downhole Log Records:     %lu", (unsigned long) DownholeLog_GetCount());
+	ShowDownholeVoltageTabDiag(text, ((nMenuCount + 5) * 15) + 4);
+
+	snprintf(text, 100, "Downhole Duty Cycle:      %.1f%%", (double) (1000 - GetDownholeSleepPermille()) / 10);
+	ShowDownholeVoltageTabDiag(text, ((nMenuCount + 6) * 15) + 4);
+
 	if (LoggingManager_IsConnected()) // whs 10Dec2021 yitran modem is connected to Downhole
 	{
 		awakeTime = GetAwakeTimeLeft();
@@ -167,3 +185,34 @@ static void ShowDownholeVoltageTabDiag2(char * message1, int rowbit)
 	area.ptBottomRight.nRow = area.ptTopLeft.nRow + 16;
 	UI_DisplayStringLeftJustified(message1, &area);
 }
+
+/*******************************************************************************
+ *       @details
+ *       Writes the downhole log to the USB file, a few records at a time.
+ *******************************************************************************/
+static void DownloadDownholeLog(MENU_ITEM* item)
+{
+	item = item;
+	DownholeLog_StartDownload();
+}
+
+/*******************************************************************************
+ *       @details
+ *       Writes the run statistics of the downhole tasks to the USB file, then
+ *       the black box.
+ *******************************************************************************/
+static void DownloadDownholeTasks(MENU_ITEM* item)
+{
+	item = item;
+	DownholeTasks_StartDownload();
+}
+
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static void ClearDownholeTasks(MENU_ITEM* item)
+{
+	item = item;
+	DownholeTasks_Clear();
+	ShowStatusMessage("Downhole Tasks Reset");
+}
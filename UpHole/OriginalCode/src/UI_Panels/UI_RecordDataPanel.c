@@ -222,6 +222,10 @@ static void RecordData_Paint(TAB_ENTRY * tab)
 			{
 				snprintf(strValue, 100, "-G%d", record.nRecordNumber - record.GammaShotNumCorrected);
 			}
+			else if (record.nSurveyFlags != 0)
+			{
+				snprintf(strValue, 100, "%dQ", record.nRecordNumber - record.GammaShotNumCorrected); // Q for failed quality checks
+			}
 			else
 			{
 				snprintf(strValue, 100, "%d", record.nRecordNumber - record.GammaShotNumCorrected);
@@ -28,6 +28,7 @@
 #include "ModemResponseHandler.h"
 #include "ModemDriver.h"
 #include "UtilityFunctions.h"
+#include "crc.h"
 
 //============================================================================//
 //      CONSTANTS                                                             //
@@ -49,6 +50,15 @@
 
 #endif
 
+// marks the record as written, the backup SRAM is all 0xFF after the backup
+// power was lost, and changes whenever MODEM_CONFIG does
+#define MODEM_CONFIG_MAGIC		0x4D434631ul
+
+// the modem does not take requests straight after its reset banner, the
+// first request is sent again this often, this many times, before the
+// usual response timeout applies
+#define MODEM_READY_POLL_TIME	TWO_HUNDRED_MILLI_SECONDS
+#define MODEM_READY_POLLS		4
 
 typedef enum {
     MODEM_HW_RESET,
@@ -66,11 +76,23 @@ typedef enum {
     MODEM_RESPONSE_WAIT,
 } MODEM_STATE;
 
+// the operation mode and serial number the modem was last found to have,
+// kept through a reset and a power cycle so a modem already set up needs
+// only its serial number checked
+typedef struct
+{
+	U_INT32 nMagic;			// MODEM_CONFIG_MAGIC
+	U_INT16 nMode;			// operation mode, table 6 index 0x31
+	U_BYTE nSerial[MODEM_SN_LENGTH];
+	U_INT32 nCRC;			// CRC32_Update of nMode then nSerial
+} MODEM_CONFIG;
+
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
 static U_INT16 m_nNodeToDelete = 0;
+static MODEM_CONFIG __attribute__((__section__(".bbramsection"))) m_ModemConfig;
 volatile BOOL WakeUpModemReset = 0;
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -93,6 +115,78 @@ void InitModem(void)
     //Nothing to do anymore, but not ready to remove yet
 }
 
+/*******************************************************************************
+ *       @details
+ *******************************************************************************/
+static U_INT32 ModemConfig_GetCRC(const MODEM_CONFIG *pConfig)
+{
+	CRC32_CONTEXT nContext;
+
+	CRC32_Start(&nContext);
+	CRC32_Update(&nContext, (const U_BYTE*) &pConfig->nMode, sizeof(pConfig->nMode));
+	CRC32_Update(&nContext, pConfig->nSerial, MODEM_SN_LENGTH);
+	return CRC32_Finish(&nContext);
+}
+
+/*******************************************************************************
+ *       @details
+ *   true when the record is whole and holds the mode and serial number this
+ *   build sets, a new build that changes either starts over.
+ *******************************************************************************/
+static BOOL ModemConfig_IsCached(void)
+{
+	return (m_ModemConfig.nMagic == MODEM_CONFIG_MAGIC) && (m_ModemConfig.nCRC == ModemConfig_GetCRC(&m_ModemConfig))
+		&& (m_ModemConfig.nMode == CORRECT_NC_MODE) && (memcmp(m_ModemConfig.nSerial, sSerialNumber, MODEM_SN_LENGTH) == 0);
+}
+
+/*******************************************************************************
+ *       @details
+ *   Written only when it changes, after both parameters were read back.
+ *******************************************************************************/
+static void ModemConfig_Save(void)
+{
+	if (ModemConfig_IsCached())
+	{
+		return;
+	}
+	m_ModemConfig.nMagic = 0;
+	m_ModemConfig.nMode = CORRECT_NC_MODE;
+	memcpy(m_ModemConfig.nSerial, sSerialNumber, MODEM_SN_LENGTH);
+	m_ModemConfig.nCRC = ModemConfig_GetCRC(&m_ModemConfig);
+	m_ModemConfig.nMagic = MODEM_CONFIG_MAGIC;
+}
+
+/*******************************************************************************
+ *       @details
+ *   true when the response waiting is not the answer to the request
+ *   eRequest sends.  A request sent again while the modem was starting can
+ *   be answered twice, and the second answer must not be taken for the
+ *   answer to the next request.  Both parameters come back as GET_PARAM,
+ *   only the serial number is MODEM_SN_LENGTH long.
+ *******************************************************************************/
+static BOOL ModemManager_IsStaleResponse(MODEM_STATE eRequest)
+{
+	BOOL bSerialNumber = (m_nResponse.nLength == (1 + MODEM_SN_LENGTH));
+	BOOL bSuccess = (m_nResponse.nData[REPLY_STATUS_INDEX] == COMMAND_SUCCESS);
+
+	switch (eRequest)
+	{
+		case MODEM_GET_NC_MODE:
+			return (m_nResponse.eReply != MODEM_RESPONSE_GET_PARAM) || (bSuccess && bSerialNumber);
+		case MODEM_GET_SERIAL_NUM:
+			return (m_nResponse.eReply != MODEM_RESPONSE_GET_PARAM) || (bSuccess && !bSerialNumber);
+		case MODEM_SET_NC_MODE:
+		case MODEM_SET_SERIAL_NUM:
+			return (m_nResponse.eReply != MODEM_RESPONSE_SET_PARAM);
+		case MODEM_SAVE_PARAM:
+			return (m_nResponse.eReply != MODEM_RESPONSE_SAVE_PARAM);
+		case MODEM_GO_ONLINE:
+			return (m_nResponse.eReply != MODEM_RESPONSE_GO_ONLINE);
+		default:
+			return false;
+	}
+}
+
 /*!
 ********************************************************************************
 *       @details
@@ -115,12 +209,27 @@ void ModemManager(void)
 	static TIME_LR tDelayTimeout;
 	static TIME_LR tHeartBeatMonitor;
 	static BOOL bNetworkManagerBusy = false;
+	// true while the serial number alone is being checked against the record
+	static BOOL bConfigCached = false;
+	// requests sent again since the reset banner, MODEM_READY_POLLS once the
+	// modem has answered
+	static U_BYTE nReadyPolls = MODEM_READY_POLLS;
+
+	MODEM_STATE eRequest;
 
 	if (WakeUpModemReset == 1)
 	{
 		nModemManagerStateMachine = MODEM_SW_RESET;
 	}
 
+	// an answer to some other request is dropped, the one waited for may
+	// still come
+	eRequest = (nModemManagerStateMachine == MODEM_RESPONSE_WAIT) ? nSavedModemManagerStateMachine : nModemManagerStateMachine;
+	if (m_nResponse.bReplyReady && ModemManager_IsStaleResponse(eRequest))
+	{
+		ModemData_ResetRxResponse();
+	}
+
 	switch (nModemManagerStateMachine)
 	{
 		default:
@@ -163,6 +272,7 @@ void ModemManager(void)
 				nModemManagerStateMachine = MODEM_RESET_DONE;
 				ModemData_ResetRxResponse();
 				bModemDiscovery = false;
+				nReadyPolls = 0;
 			}
 			else if (ElapsedTimeLowRes(tDelayTimeout) > FIVE_SECOND)
 			{
@@ -177,9 +287,16 @@ void ModemManager(void)
 			break;
 		case MODEM_RESET_DONE:
 		{
-			if (ElapsedTimeLowRes(tDelayTimeout) > ONE_SECOND)
+			// a modem set up before has its serial number read and goes
+			// on line if it is the one in the record, there is no waiting
+			// here, the first request is sent again until the modem answers
+			bConfigCached = ModemConfig_IsCached();
+			if (bConfigCached)
+			{
+				nModemManagerStateMachine = MODEM_GET_SERIAL_NUM;
+			}
+			else
 			{
-				tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
 				nModemManagerStateMachine = MODEM_GET_NC_MODE;
 			}
 		}
@@ -252,12 +369,20 @@ void ModemManager(void)
 				{
 					if (memcmp((const void*) &m_nResponse.nData[1], (const void*) &sSerialNumber[0], MODEM_SN_LENGTH) == 0)
 					{
+						ModemConfig_Save();
 						nModemManagerStateMachine = MODEM_GO_ONLINE;
 					}
+					else if (bConfigCached)
+					{
+						// another modem, its mode has not been checked
+						m_ModemConfig.nMagic = 0;
+						nModemManagerStateMachine = MODEM_GET_NC_MODE;
+					}
 					else
 					{
 						nModemManagerStateMachine = MODEM_SET_SERIAL_NUM;
 					}
+					bConfigCached = false;
 				}
 				ModemData_ResetRxResponse();
 			}
@@ -445,6 +570,14 @@ void ModemManager(void)
 		{
 			if (m_nResponse.bReplyReady)
 			{
+				nReadyPolls = MODEM_READY_POLLS;
+				nModemManagerStateMachine = nSavedModemManagerStateMachine;
+				nSavedModemManagerStateMachine = MODEM_HW_RESET;
+			}
+			else if ((nReadyPolls < MODEM_READY_POLLS) && (ElapsedTimeLowRes(tDelayTimeout) > MODEM_READY_POLL_TIME))
+			{
+				// not taking requests yet, send it again
+				nReadyPolls++;
 				nModemManagerStateMachine = nSavedModemManagerStateMachine;
 				nSavedModemManagerStateMachine = MODEM_HW_RESET;
 			}
@@ -41,7 +41,13 @@
 #include "UI_BoxSetupTab.h"
 #include "TargetProtocol.h"
 #include "PCDataTransfer.h"
+#include "DownholeLog.h"
+#include "DownholeTasks.h"
+#include "DownholeBlackBox.h"
+#include "DownholeUpdate.h"
+#include "DownholeSamples.h"
 #include "LoggingManager.h"
+#include "RecordManager.h"
 #include "tone_generator.h"
 
 //============================================================================//
@@ -163,6 +169,8 @@ int main(void)
 	// whether checksum is OK or not, check boundaries
 	//-------------------------------------------------------------
 	Check_NV_data_boundaries();
+	// a survey log kept in another record layout is started over
+	RECORD_Initialize();
 
 	InitPeriodicEvents();
 	KickWatchdog();
@@ -201,6 +209,11 @@ int main(void)
 				LoggingManager();
 				PCPORT_StateMachine();
 				PCPORT_UPLOAD_StateMachine();
+				DownholeLog_Service();
+				DownholeTasks_Service();
+				DownholeBlackBox_Service();
+				DownholeUpdate_Service();
+				DownholeSamples_Service();
 			}
 		}
 		if (Hundred_mS_tick_flag)